@@ -0,0 +1,229 @@
+// Contains the benchmark of the auto exposure controller with a simulated sensor.
+/*
+   A simulated 12-bit sensor renders a fixed scene, the fractal pattern taken as radiance, with the
+   exposure time and gain the controller set a given number of frames earlier, adding shot and read
+   noise and clipping at full scale. The controller of include/AutoExposureController.h sees the
+   statistics of these frames as it would in the Preview state of Grab_StateMachine.
+
+   Each case starts too dark or too bright and runs until the brightness settled. Reported are the frames
+   until the brightness stays within 0.1 stops of its final value, the overshoot beyond the final value in
+   stops, the number of direction reversals and the final brightness. The cases without accounting for the
+   frames in flight show why the controller skips them.
+   Options: -size <width>x<height> (default 640x480), -latency <frames> (default 3), -frames <n> (default 120).
+*/
+
+#ifndef INCLUDED_BENCHAUTOEXPOSURE_H_9043316
+#define INCLUDED_BENCHAUTOEXPOSURE_H_9043316
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "../include/AutoExposureController.h"
+
+#include <cmath>
+#include <deque>
+
+namespace Benchmark
+{
+    // Renders a scene with a linear sensor response. The settings take effect after a latency of some frames.
+    class CSimulatedSensor
+    {
+    public:
+        // The scene is scaled so that the given exposure at 0 dB yields a mean of targetBrightness.
+        CSimulatedSensor( uint32_t width, uint32_t height, double referenceExposure, double targetBrightness, uint32_t latency)
+            : m_width( width)
+            , m_height( height)
+            , m_latency( latency)
+            , m_noiseState( 12345)
+        {
+            SampleImageCreator::SFractalSettings settings;
+            settings.Width = width;
+            settings.Height = height;
+            settings.PixelType = Pylon::PixelType_Mono12;
+            const Pylon::CPylonImage scene = SampleImageCreator::RenderFractal( settings);
+            const uint16_t* pScene = static_cast<const uint16_t*>(scene.GetBuffer());
+            m_radiance.resize( static_cast<size_t>(width) * height);
+            double sum = 0.0;
+            for (size_t i = 0; i < m_radiance.size(); ++i)
+            {
+                m_radiance[i] = static_cast<float>(pScene[i]);
+                sum += pScene[i];
+            }
+            // Electrons per radiance unit and us at 0 dB, 4095 is full scale.
+            m_scale = targetBrightness * 4095.0 * m_radiance.size() / (sum * referenceExposure);
+            m_frame.resize( m_radiance.size());
+        }
+
+        // Sets exposure and gain. Frames rendered during the next latency calls still use the previous settings.
+        void SetExposureAndGain( double exposure, double gain)
+        {
+            m_pending.push_back( SPendingSettings( exposure, gain, m_latency));
+        }
+
+        // Renders the next frame and returns its pixels.
+        const std::vector<uint16_t>& RenderFrame()
+        {
+            while (!m_pending.empty() && m_pending.front().FramesLeft == 0)
+            {
+                m_exposure = m_pending.front().Exposure;
+                m_gain = m_pending.front().Gain;
+                m_pending.pop_front();
+            }
+            for (size_t i = 0; i < m_pending.size(); ++i)
+            {
+                --m_pending[i].FramesLeft;
+            }
+
+            const float scale = static_cast<float>(m_scale * m_exposure * std::pow( 10.0, m_gain / 20.0));
+            const float noiseScale = static_cast<float>(std::pow( 10.0, m_gain / 20.0));
+            for (size_t i = 0; i < m_radiance.size(); ++i)
+            {
+                m_noiseState ^= m_noiseState << 13;
+                m_noiseState ^= m_noiseState >> 17;
+                m_noiseState ^= m_noiseState << 5;
+                const float signal = m_radiance[i] * scale;
+                // Shot noise grows with the square root of the signal, read noise is 2 DN before the gain.
+                const float noise = (static_cast<float>(m_noiseState & 0xFFFF) / 32768.0f - 1.0f) * (std::sqrt( signal) + 2.0f * noiseScale);
+                m_frame[i] = static_cast<uint16_t>(std::max( 0.0f, std::min( 4095.0f, signal + noise)));
+            }
+            return m_frame;
+        }
+
+        void Reset( double exposure, double gain)
+        {
+            m_exposure = exposure;
+            m_gain = gain;
+            m_pending.clear();
+        }
+
+    private:
+        struct SPendingSettings
+        {
+            SPendingSettings( double exposure, double gain, uint32_t framesLeft)
+                : Exposure( exposure)
+                , Gain( gain)
+                , FramesLeft( framesLeft)
+            {
+            }
+
+            double Exposure;
+            double Gain;
+            uint32_t FramesLeft;
+        };
+
+        uint32_t m_width;
+        uint32_t m_height;
+        uint32_t m_latency;
+        uint32_t m_noiseState;
+        double m_scale;
+        double m_exposure;
+        double m_gain;
+        std::vector<float> m_radiance;
+        std::vector<uint16_t> m_frame;
+        std::deque<SPendingSettings> m_pending;
+    };
+
+    inline void RunAutoExposureBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace Pylon;
+
+        uint32_t width = 640;
+        uint32_t height = 480;
+        if (GetCommandLineOption( argc, argv, "-size") != NULL)
+        {
+            GetBenchmarkFrameSize( argc, argv, width, height);
+        }
+        const char* latencyValue = GetCommandLineOption( argc, argv, "-latency");
+        const uint32_t latency = latencyValue != NULL ? std::max( 0, atoi( latencyValue)) : 3;
+        const char* framesValue = GetCommandLineOption( argc, argv, "-frames");
+        const uint32_t frameCount = framesValue != NULL ? std::max( 10, atoi( framesValue)) : 120;
+
+        const double referenceExposure = 10000.0;
+        const SAutoExposureSettings defaults;
+        CSimulatedSensor sensor( width, height, referenceExposure, defaults.TargetBrightness, latency);
+
+        struct SAutoExposureCase
+        {
+            const char* Name;
+            double StartStops;      // Start exposure relative to the correct one.
+            double Speed;
+            bool AccountForFramesInFlight;
+        };
+        const SAutoExposureCase cases[] =
+        {
+            { "dark -6 stops speed=0.3", -6.0, 0.3, true },
+            { "dark -6 stops speed=0.6", -6.0, 0.6, true },
+            { "dark -6 stops speed=1.0", -6.0, 1.0, true },
+            { "bright +4 stops speed=0.6", 4.0, 0.6, true },
+            { "bright +4 stops speed=1.0", 4.0, 1.0, true },
+            { "dark -6 stops speed=0.6 ignoring frames in flight", -6.0, 0.6, false },
+            { "bright +4 stops speed=1.0 ignoring frames in flight", 4.0, 1.0, false }
+        };
+
+        CFrameStatisticsCalculator calculator;
+        SFrameStatistics statistics;
+        for (size_t c = 0; c < sizeof( cases) / sizeof( cases[0]); ++c)
+        {
+            SAutoExposureSettings settings;
+            settings.Speed = cases[c].Speed;
+            settings.FramesInFlight = cases[c].AccountForFramesInFlight ? latency : 0;
+            const double startExposure = referenceExposure * std::pow( 2.0, cases[c].StartStops);
+            CAutoExposureController controller( settings, 1, startExposure, 0.0);
+            sensor.Reset( startExposure, 0.0);
+
+            std::vector<double> brightness;
+            CStopwatch stopwatch;
+            for (uint32_t n = 0; n < frameCount; ++n)
+            {
+                const std::vector<uint16_t>& frame = sensor.RenderFrame();
+                calculator.Compute( &frame[0], PixelType_Mono12, width, height, 0, statistics);
+                brightness.push_back( statistics.GetMean() / statistics.MaxValue);
+                if (controller.Update( 0, statistics))
+                {
+                    sensor.SetExposureAndGain( controller.GetExposure(), controller.GetGain());
+                }
+            }
+            const double seconds = stopwatch.GetSeconds();
+
+            // The final brightness is the mean of the last ten frames.
+            double finalBrightness = 0.0;
+            for (size_t n = brightness.size() - 10; n < brightness.size(); ++n)
+            {
+                finalBrightness += brightness[n] / 10.0;
+            }
+            size_t convergenceFrame = brightness.size();
+            while (convergenceFrame > 0 && std::fabs( std::log( brightness[convergenceFrame - 1] / finalBrightness) / std::log( 2.0)) < 0.1)
+            {
+                --convergenceFrame;
+            }
+            const double direction = cases[c].StartStops < 0.0 ? 1.0 : -1.0;
+            double overshootStops = 0.0;
+            uint32_t reversals = 0;
+            for (size_t n = 0; n < brightness.size(); ++n)
+            {
+                if (brightness[n] > 0.0)
+                {
+                    overshootStops = std::max( overshootStops, direction * std::log( brightness[n] / finalBrightness) / std::log( 2.0));
+                }
+                if (n >= 2 && (brightness[n] - brightness[n - 1]) * (brightness[n - 1] - brightness[n - 2]) < 0.0
+                    && std::fabs( brightness[n] - brightness[n - 1]) > 0.02 * finalBrightness)
+                {
+                    ++reversals;
+                }
+            }
+
+            SBenchmarkResult result;
+            result.Benchmark = "ae";
+            result.Case = cases[c].Name;
+            result.Add( "latency_frames", latency)
+                .Add( "convergence_frames", static_cast<double>(convergenceFrame))
+                .Add( "overshoot_stops", overshootStops)
+                .Add( "reversals", reversals)
+                .Add( "final_brightness", finalBrightness)
+                .Add( "changes", static_cast<double>(controller.GetChangeCount()))
+                .Add( "ms_per_frame", seconds / frameCount * 1e3);
+            report.Add( result);
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHAUTOEXPOSURE_H_9043316 */
@@ -0,0 +1,200 @@
+// Contains the benchmark of exposure and gain bracketing.
+/*
+   A synthetic frame source grabs a bracket job of include/BracketJob.h three ways:
+       launch per step     a source is created, started, triggered and stopped for every step, like one
+                           invocation of Grab_command_line per step without the process start itself
+       write after frame   one grab, the parameters of a step are written after the last frame of the
+                           previous step arrived
+       staged              one grab, the parameters are written while the last frame of the previous step
+                           is read out, as Grab_command_line does with -job
+   Starting grabbing and every parameter write and software trigger take the emulated camera latencies.
+
+   Reported are the time of the bracket, its frame rate, the time the sensor needs for the frames alone,
+   i.e. the first exposure and one readout or exposure per frame, and its share of the bracket time.
+   Frames whose ExposureTime or Gain chunk differs from their step are counted as wrong.
+   Options: -fps <sensor rate> (default 100), -bracket-t <exposures_us> (default 1000:8000:x2),
+   -bracket-g <gains_db> (default 0,6), -frames <per step> (default 2), -repeat <n> (default 3),
+   -write-latency <us> (default 1000), -start-latency <ms> (default 150), -stop-latency <ms> (default 30).
+*/
+
+#ifndef INCLUDED_BENCHBRACKET_H_6618027
+#define INCLUDED_BENCHBRACKET_H_6618027
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "../include/SyntheticFrameSource.h"
+#include "../include/BracketJob.h"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace Benchmark
+{
+    // Counts the frames of a bracket and compares their chunks with the steps.
+    class CBracketBenchmarkHandler : public Pylon::CSyntheticImageEventHandler
+    {
+    public:
+        explicit CBracketBenchmarkHandler( const std::vector<Pylon::SBracketStep>& steps)
+            : m_steps( steps)
+            , m_step( 0)
+            , m_stepFrame( 0)
+            , m_frameCount( 0)
+            , m_wrongFrameCount( 0)
+        {
+        }
+
+        // Starts counting the frames of the first step.
+        void Reset()
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            m_step = 0;
+            m_stepFrame = 0;
+            m_frameCount = 0;
+        }
+
+        virtual void OnImageGrabbed( Pylon::CSyntheticFrameSource& /*camera*/, const Pylon::CSyntheticGrabResultPtr& ptrGrabResult)
+        {
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                if (m_stepFrame == m_steps[m_step].FrameCount && m_step + 1 < m_steps.size())
+                {
+                    ++m_step;
+                    m_stepFrame = 0;
+                }
+                if (ptrGrabResult->ChunkExposureTime.GetValue() != m_steps[m_step].ExposureTime || ptrGrabResult->ChunkGain.GetValue() != m_steps[m_step].Gain)
+                {
+                    ++m_wrongFrameCount;
+                }
+                ++m_stepFrame;
+                ++m_frameCount;
+            }
+            m_condition.notify_all();
+        }
+
+        // Waits until count frames arrived since the last reset. Returns false on timeout.
+        bool WaitForFrames( size_t count, unsigned int timeoutMs)
+        {
+            std::unique_lock<std::mutex> lock( m_lock);
+            return m_condition.wait_for( lock, std::chrono::milliseconds( timeoutMs), [this, count]() { return m_frameCount >= count; });
+        }
+
+        size_t GetWrongFrameCount() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_wrongFrameCount;
+        }
+
+    private:
+        const std::vector<Pylon::SBracketStep>& m_steps;
+        mutable std::mutex m_lock;
+        std::condition_variable m_condition;
+        size_t m_step;
+        size_t m_stepFrame;
+        size_t m_frameCount;
+        size_t m_wrongFrameCount;
+    };
+
+    inline void RunBracketBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace Pylon;
+
+        const uint32_t repeat = GetBenchmarkRepeat( argc, argv, 3);
+        const char* framesOption = GetCommandLineOption( argc, argv, "-frames");
+        const char* exposureOption = GetCommandLineOption( argc, argv, "-bracket-t");
+        const char* gainOption = GetCommandLineOption( argc, argv, "-bracket-g");
+        const char* fpsOption = GetCommandLineOption( argc, argv, "-fps");
+        const char* writeLatencyOption = GetCommandLineOption( argc, argv, "-write-latency");
+        const char* startLatencyOption = GetCommandLineOption( argc, argv, "-start-latency");
+        const char* stopLatencyOption = GetCommandLineOption( argc, argv, "-stop-latency");
+
+        const size_t framesPerStep = framesOption != NULL ? std::max( 1, atoi( framesOption)) : 2;
+        const std::vector<SBracketStep> steps = GetBracketSteps(
+            ParseBracketValues( exposureOption != NULL ? exposureOption : "1000:8000:x2"),
+            ParseBracketValues( gainOption != NULL ? gainOption : "0,6"),
+            framesPerStep);
+        const size_t frameCount = GetBracketFrameCount( steps);
+
+        SSyntheticFrameSourceSettings settings;
+        settings.Width = 640;
+        settings.Height = 480;
+        settings.CycleLength = 1;
+        settings.FrameRate = fpsOption != NULL ? atof( fpsOption) : 100.0;
+        settings.WriteLatencyUs = writeLatencyOption != NULL ? atof( writeLatencyOption) : 1000.0;
+        settings.StartLatencyMs = startLatencyOption != NULL ? atof( startLatencyOption) : 150.0;
+        settings.StopLatencyMs = stopLatencyOption != NULL ? atof( stopLatencyOption) : 30.0;
+
+        // The sensor needs the first exposure and then a readout per frame, or an exposure if it is longer.
+        const double readoutMs = 1e3 / settings.FrameRate;
+        double sensorMs = steps[0].ExposureTime / 1e3;
+        for (size_t i = 0; i < steps.size(); ++i)
+        {
+            sensorMs += steps[i].FrameCount * std::max( readoutMs, steps[i].ExposureTime / 1e3);
+        }
+
+        const char* const caseNames[] = { "launch per step", "write after frame", "staged" };
+        for (int c = 0; c < 3; ++c)
+        {
+            std::vector<double> bracketMs;
+            size_t wrongFrameCount = 0;
+            for (uint32_t r = 0; r < repeat; ++r)
+            {
+                if (c == 0)
+                {
+                    CStopwatch stopwatch;
+                    for (size_t i = 0; i < steps.size(); ++i)
+                    {
+                        const std::vector<SBracketStep> step( 1, steps[i]);
+                        CSyntheticFrameSource camera( settings);
+                        CBracketBenchmarkHandler* pHandler = new CBracketBenchmarkHandler( step);
+                        camera.RegisterImageEventHandler( pHandler, RegistrationMode_Append, Cleanup_Delete);
+                        pHandler->Reset();
+                        ConfigureSoftwareTrigger( camera);
+                        camera.StartGrabbing( GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+                        TriggerBracket( camera, step, false, [pHandler]( size_t count) { pHandler->WaitForFrames( count, 5000); });
+                        if (!pHandler->WaitForFrames( step[0].FrameCount, 5000))
+                        {
+                            throw RUNTIME_EXCEPTION( "The bracket frames did not arrive.");
+                        }
+                        camera.StopGrabbing();
+                        wrongFrameCount += pHandler->GetWrongFrameCount();
+                    }
+                    bracketMs.push_back( stopwatch.GetSeconds() * 1e3);
+                }
+                else
+                {
+                    CSyntheticFrameSource camera( settings);
+                    CBracketBenchmarkHandler* pHandler = new CBracketBenchmarkHandler( steps);
+                    camera.RegisterImageEventHandler( pHandler, RegistrationMode_Append, Cleanup_Delete);
+                    pHandler->Reset();
+                    ConfigureSoftwareTrigger( camera);
+                    camera.StartGrabbing( GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+                    // The start of the grab is not part of the bracket, it is paid once per session.
+                    CStopwatch stopwatch;
+                    TriggerBracket( camera, steps, c == 2, [pHandler]( size_t count) { pHandler->WaitForFrames( count, 5000); });
+                    if (!pHandler->WaitForFrames( frameCount, 5000))
+                    {
+                        throw RUNTIME_EXCEPTION( "The bracket frames did not arrive.");
+                    }
+                    bracketMs.push_back( stopwatch.GetSeconds() * 1e3);
+                    camera.StopGrabbing();
+                    wrongFrameCount += pHandler->GetWrongFrameCount();
+                }
+            }
+
+            const double medianMs = GetPercentile( bracketMs, 50.0);
+            SBenchmarkResult result;
+            result.Benchmark = "bracket";
+            result.Case = caseNames[c];
+            result.Add( "steps", static_cast<double>(steps.size()))
+                .Add( "frames", static_cast<double>(frameCount))
+                .Add( "bracket_ms", medianMs)
+                .Add( "fps", frameCount / medianMs * 1e3)
+                .Add( "sensor_ms", sensorMs)
+                .Add( "sensor_share", sensorMs / medianMs)
+                .Add( "wrong_frames", static_cast<double>(wrongFrameCount));
+            report.Add( result);
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHBRACKET_H_6618027 */
@@ -0,0 +1,188 @@
+// Contains the benchmark of the burst with a trigger per frame and with the FrameBurstStart trigger.
+/*
+   Synthetic frame sources grab bursts the two ways Grab_StateMachine can: with a software trigger per
+   frame, waiting for each camera to be ready for the next trigger, and with one FrameBurstStart trigger
+   per camera, after which the sensor delivers the frames at its frame rate. Every software trigger is a
+   control transaction taking the write latency, like TriggerSoftware on a USB camera.
+
+   Reported are the medians over the bursts of the time from the first trigger until the last frame of
+   every camera arrived, and the frame rate and interval jitter computed from the chunk time stamps with
+   include/FrameTiming.h, together with the largest frame interval seen.
+   Options: -cameras <n> (default 2), -size <width>x<height> (default 640x480), -fps <sensor rate> (default 100),
+   -repeat <n> bursts (default 5), -burst <n> frames (default 15), -write-latency <us> (default 1000),
+   -jitter <us> (default 50).
+*/
+
+#ifndef INCLUDED_BENCHBURST_H_5529174
+#define INCLUDED_BENCHBURST_H_5529174
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "../include/SyntheticFrameSource.h"
+#include "../include/FrameTiming.h"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace Benchmark
+{
+    // Collects the chunk time stamps of the burst frames per camera.
+    class CBurstBenchmarkHandler : public Pylon::CSyntheticImageEventHandler
+    {
+    public:
+        explicit CBurstBenchmarkHandler( size_t cameraCount)
+            : m_timeStamps( cameraCount)
+        {
+        }
+
+        void Reset()
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            for (size_t i = 0; i < m_timeStamps.size(); ++i)
+            {
+                m_timeStamps[i].clear();
+            }
+        }
+
+        virtual void OnImageGrabbed( Pylon::CSyntheticFrameSource& camera, const Pylon::CSyntheticGrabResultPtr& ptrGrabResult)
+        {
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                m_timeStamps[static_cast<size_t>(camera.GetCameraContext())].push_back( 1e-9 * ptrGrabResult->ChunkTimestamp.GetValue());
+            }
+            m_condition.notify_all();
+        }
+
+        // Waits until every camera delivered count frames. Returns false on timeout.
+        bool WaitForFrames( size_t count, unsigned int timeoutMs)
+        {
+            std::unique_lock<std::mutex> lock( m_lock);
+            return m_condition.wait_for( lock, std::chrono::milliseconds( timeoutMs), [this, count]()
+            {
+                for (size_t i = 0; i < m_timeStamps.size(); ++i)
+                {
+                    if (m_timeStamps[i].size() < count)
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            });
+        }
+
+        std::vector<double> GetTimeStamps( size_t camera) const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_timeStamps[camera];
+        }
+
+    private:
+        mutable std::mutex m_lock;
+        std::condition_variable m_condition;
+        std::vector< std::vector<double> > m_timeStamps;
+    };
+
+    inline void RunBurstBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace Pylon;
+
+        const char* value = NULL;
+        const size_t cameraCount = (value = GetCommandLineOption( argc, argv, "-cameras")) != NULL ? std::max( 1, atoi( value)) : 2;
+        const uint32_t repeat = GetBenchmarkRepeat( argc, argv, 5);
+        const uint32_t burstFrames = (value = GetCommandLineOption( argc, argv, "-burst")) != NULL ? std::max( 2, atoi( value)) : 15;
+
+        SSyntheticFrameSourceSettings settings;
+        settings.Width = 640;
+        settings.Height = 480;
+        if (GetCommandLineOption( argc, argv, "-size") != NULL)
+        {
+            GetBenchmarkFrameSize( argc, argv, settings.Width, settings.Height);
+        }
+        settings.FrameRate = (value = GetCommandLineOption( argc, argv, "-fps")) != NULL ? atof( value) : 100.0;
+        settings.CycleLength = 1;
+        settings.WriteLatencyUs = (value = GetCommandLineOption( argc, argv, "-write-latency")) != NULL ? atof( value) : 1000.0;
+        settings.JitterUs = (value = GetCommandLineOption( argc, argv, "-jitter")) != NULL ? atof( value) : 50.0;
+
+        for (int isHardwareBurst = 0; isHardwareBurst < 2; ++isHardwareBurst)
+        {
+            CSyntheticFrameSourceArray cameras( cameraCount, settings);
+            CBurstBenchmarkHandler* pHandler = new CBurstBenchmarkHandler( cameraCount);
+            for (size_t i = 0; i < cameraCount; ++i)
+            {
+                // The handler is shared, only the first registration deletes it.
+                cameras[i].RegisterImageEventHandler( pHandler, RegistrationMode_Append, i == 0 ? Cleanup_Delete : Cleanup_None);
+                cameras[i].MaxNumBuffer = static_cast<int>(burstFrames + 2);
+                ConfigureSoftwareTrigger( cameras[i]);
+                if (isHardwareBurst)
+                {
+                    cameras[i].TriggerSelector.SetValue( Basler_UsbCameraParams::TriggerSelector_FrameBurstStart);
+                    cameras[i].AcquisitionBurstFrameCount.SetValue( burstFrames);
+                }
+                cameras[i].StartGrabbing( GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+            }
+
+            std::vector<double> burstMs;
+            std::vector<double> frameRates;
+            std::vector<double> jitterMs;
+            double maxIntervalMs = 0.0;
+            for (uint32_t r = 0; r < repeat; ++r)
+            {
+                pHandler->Reset();
+                CStopwatch stopwatch;
+                if (isHardwareBurst)
+                {
+                    for (size_t i = 0; i < cameraCount; ++i)
+                    {
+                        WaitForBurstTriggerReady( cameras[i], 1000);
+                        cameras[i].ExecuteSoftwareTrigger();
+                    }
+                }
+                else
+                {
+                    for (uint32_t j = 0; j < burstFrames; ++j)
+                    {
+                        for (size_t i = 0; i < cameraCount; ++i)
+                        {
+                            cameras[i].WaitForFrameTriggerReady( 1000, TimeoutHandling_ThrowException);
+                            cameras[i].ExecuteSoftwareTrigger();
+                        }
+                    }
+                }
+                if (!pHandler->WaitForFrames( burstFrames, 5000))
+                {
+                    throw RUNTIME_EXCEPTION( "The burst frames did not arrive.");
+                }
+                burstMs.push_back( stopwatch.GetSeconds() * 1e3);
+
+                for (size_t i = 0; i < cameraCount; ++i)
+                {
+                    const SFrameTiming timing = GetFrameTiming( pHandler->GetTimeStamps( i));
+                    frameRates.push_back( timing.FrameRate);
+                    jitterMs.push_back( timing.IntervalJitter * 1e3);
+                    maxIntervalMs = std::max( maxIntervalMs, timing.MaxInterval * 1e3);
+                }
+                // The sensor is idle before the next burst.
+                for (size_t i = 0; i < cameraCount; ++i)
+                {
+                    cameras[i].WaitForFrameTriggerReady( 1000, TimeoutHandling_ThrowException);
+                }
+            }
+            cameras.StopGrabbing();
+
+            SBenchmarkResult result;
+            result.Benchmark = "burst";
+            result.Case = isHardwareBurst ? "FrameBurstStart trigger" : "trigger per frame";
+            result.Add( "cameras", static_cast<double>(cameraCount))
+                .Add( "frames", burstFrames)
+                .Add( "sensor_fps", settings.FrameRate)
+                .Add( "burst_ms", GetPercentile( burstMs, 50.0))
+                .Add( "fps", GetPercentile( frameRates, 50.0))
+                .Add( "jitter_ms", GetPercentile( jitterMs, 50.0))
+                .Add( "max_interval_ms", maxIntervalMs)
+                .Add( "triggers_per_camera", isHardwareBurst ? 1 : burstFrames);
+            report.Add( result);
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHBURST_H_5529174 */
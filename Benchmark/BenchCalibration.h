@@ -0,0 +1,259 @@
+// Contains the benchmark and the check of the dark-frame and flat-field correction.
+/*
+   A synthetic Mono12 sensor has a dark level of 64 DN with a fixed pattern of 4 DN rms and 0.01 % hot pixels,
+   a response varying by 3 % rms from pixel to pixel, shot noise of 1 DN per electron and 3 DN read noise.
+   16 dark and 16 flat frames of 2000 DN are stacked by CBurstStacker into the masters, and the calibration
+   is stored in and looked up from CSensorCalibrationCache of include/SensorCalibration.h.
+
+   A noise free synthetic scene, scaled to 0-3000 DN, is taken with the sensor and corrected:
+       accuracy    the rms difference to the scene before (minus the mean dark level) and after the
+                   correction, i.e. the fixed pattern left, and the largest difference of the fixed point
+                   correction to the same correction in floating point
+       correct     the time to correct a frame in place and its share of the frame period at the burst rate,
+                   compared with the floating point correction of a straightforward offline implementation
+       lookup      the time to store the calibration, the first lookup, which maps the file, and the lookups
+                   after a change of the exposure time, alternating between a stored key and a missing one
+   Options: -size <width>x<height> (default 2592x1944), -repeat <n> (default 20), -fps <burst rate> (default 14),
+   -dir <directory of the calibration> (default the current directory), -keep.
+*/
+
+#ifndef INCLUDED_BENCHCALIBRATION_H_9517402
+#define INCLUDED_BENCHCALIBRATION_H_9517402
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "../include/BurstStacker.h"
+#include "../include/SensorCalibration.h"
+
+#include <random>
+
+namespace Benchmark
+{
+    // The fixed pattern and the response of every pixel of the synthetic sensor.
+    struct SSyntheticSensor
+    {
+        std::vector<float> Dark;
+        std::vector<float> Response;
+
+        // Takes the scene, in DN. Adds temporal noise if pRandom is not NULL.
+        void Expose( const std::vector<float>& scene, std::mt19937* pRandom, std::vector<uint16_t>& frame) const
+        {
+            std::normal_distribution<float> normal;
+            frame.resize( scene.size());
+            for (size_t i = 0; i < scene.size(); ++i)
+            {
+                const float signal = scene[i] * Response[i];
+                float value = Dark[i] + signal + 0.5f;
+                if (pRandom != NULL)
+                {
+                    value += normal( *pRandom) * std::sqrt( signal + 9.0f);
+                }
+                frame[i] = static_cast<uint16_t>(std::min( std::max( value, 0.0f), 4095.0f));
+            }
+        }
+    };
+
+    inline void RunCalibrationBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace SampleImageCreator;
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        GetBenchmarkFrameSize( argc, argv, width, height);
+        const uint32_t repeat = GetBenchmarkRepeat( argc, argv, 20);
+        const char* value = NULL;
+        const double frameRate = (value = Pylon::GetCommandLineOption( argc, argv, "-fps")) != NULL ? atof( value) : 14.0;
+        const std::string directory = (value = Pylon::GetCommandLineOption( argc, argv, "-dir")) != NULL ? value : ".";
+        bool isKept = false;
+        for (int i = 1; i < argc; ++i)
+        {
+            isKept = isKept || strcmp( argv[i], "-keep") == 0;
+        }
+
+        const size_t pixelCount = static_cast<size_t>(width) * height;
+        std::mt19937 random( 2718);
+        std::normal_distribution<float> normal;
+        std::uniform_real_distribution<float> uniform( 0.0f, 1.0f);
+        SSyntheticSensor sensor;
+        sensor.Dark.resize( pixelCount);
+        sensor.Response.resize( pixelCount);
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            sensor.Dark[i] = 64.0f + 4.0f * normal( random) + (uniform( random) < 0.0001f ? 200.0f : 0.0f);
+            sensor.Response[i] = 1.0f + 0.03f * normal( random);
+        }
+
+        // The masters, stacked like a burst.
+        Pylon::CBurstStacker darkStacker;
+        Pylon::CBurstStacker flatStacker;
+        darkStacker.Reset();
+        flatStacker.Reset();
+        const uint32_t masterFrameCount = 16;
+        const std::vector<float> black( pixelCount, 0.0f);
+        const std::vector<float> flat( pixelCount, 2000.0f);
+        std::vector<uint16_t> frame;
+        for (uint32_t f = 0; f < masterFrameCount; ++f)
+        {
+            sensor.Expose( black, &random, frame);
+            darkStacker.Add( &frame[0], Pylon::PixelType_Mono12, width, height, 0);
+            sensor.Expose( flat, &random, frame);
+            flatStacker.Add( &frame[0], Pylon::PixelType_Mono12, width, height, 0);
+        }
+        darkStacker.Finish();
+        flatStacker.Finish();
+        const uint16_t* pDark = static_cast<const uint16_t*>(darkStacker.GetImage().GetBuffer());
+        const uint16_t* pFlat = static_cast<const uint16_t*>(flatStacker.GetImage().GetBuffer());
+
+        Pylon::SSensorCalibrationKey key;
+        key.SerialNumber = "BENCH0001";
+        key.ExposureTime = 10000.0;
+        key.Gain = 0.0;
+        key.Width = width;
+        key.Height = height;
+        key.PixelType = Pylon::PixelType_Mono12;
+        Pylon::SSensorCalibrationKey missingKey = key;
+        missingKey.ExposureTime = 12000.0;
+
+        double storeSeconds = 0.0;
+        double firstLookupSeconds = 0.0;
+        std::shared_ptr<const Pylon::CSensorCalibration> ptrCalibration;
+        std::string fileName;
+        {
+            Pylon::CSensorCalibrationCache writer( directory);
+            fileName = writer.GetFileName( key);
+            CStopwatch stopwatch;
+            writer.Store( key, pDark, pFlat, masterFrameCount, masterFrameCount);
+            storeSeconds = stopwatch.GetSeconds();
+        }
+        std::unique_ptr<Pylon::CSensorCalibrationCache> ptrCache( new Pylon::CSensorCalibrationCache( directory));
+        {
+            CStopwatch stopwatch;
+            ptrCalibration = ptrCache->Find( key);
+            firstLookupSeconds = stopwatch.GetSeconds();
+        }
+        if (!ptrCalibration)
+        {
+            throw RUNTIME_EXCEPTION( "The stored calibration %s was not found.", fileName.c_str());
+        }
+
+        // Accuracy on the noise free scene.
+        SFractalSettings fractalSettings;
+        fractalSettings.Width = width;
+        fractalSettings.Height = height;
+        fractalSettings.PixelType = Pylon::PixelType_Mono12;
+        const Pylon::CPylonImage image = RenderFractal( fractalSettings);
+        const uint16_t* pPixels = static_cast<const uint16_t*>(image.GetBuffer());
+        std::vector<float> scene( pixelCount);
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            scene[i] = pPixels[i] * (3000.0f / 4095.0f);
+        }
+        std::vector<uint16_t> raw;
+        sensor.Expose( scene, NULL, raw);
+
+        // The floating point correction from the masters, as an offline implementation would do it.
+        std::vector<float> gains( pixelCount);
+        double flatMean = 0.0;
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            flatMean += std::max( static_cast<int>(pFlat[i]) - static_cast<int>(pDark[i]), 0);
+        }
+        flatMean /= pixelCount;
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            const int signal = static_cast<int>(pFlat[i]) - static_cast<int>(pDark[i]);
+            gains[i] = signal > 0 ? static_cast<float>(flatMean / signal) : 1.0f;
+        }
+        std::vector<float> reference( pixelCount);
+        auto correctFloat = [&]()
+        {
+            for (size_t i = 0; i < pixelCount; ++i)
+            {
+                reference[i] = std::min( std::max( (static_cast<float>(raw[i]) - pDark[i]) * gains[i], 0.0f), 4095.0f);
+            }
+        };
+
+        std::vector<uint16_t> corrected( pixelCount);
+        ptrCalibration->Correct( &raw[0], 0, &corrected[0], 0);
+        correctFloat();
+        double beforeSquareSum = 0.0;
+        double afterSquareSum = 0.0;
+        double maxDeviation = 0.0;
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            beforeSquareSum += (raw[i] - 64.0 - scene[i]) * (raw[i] - 64.0 - scene[i]);
+            afterSquareSum += (corrected[i] - scene[i]) * (corrected[i] - scene[i]);
+            maxDeviation = std::max( maxDeviation, std::abs( corrected[i] - static_cast<double>(reference[i])));
+        }
+        {
+            SBenchmarkResult result;
+            result.Benchmark = "calibration";
+            result.Case = "accuracy";
+            result.Add( "master_frames", masterFrameCount)
+                .Add( "rms_before", std::sqrt( beforeSquareSum / pixelCount))
+                .Add( "rms_after", std::sqrt( afterSquareSum / pixelCount))
+                .Add( "max_fixed_vs_float", maxDeviation);
+            report.Add( result);
+        }
+
+        // Throughput, in place like the samples correct the grab buffers.
+        {
+            std::vector<uint16_t> buffer( raw);
+            CStopwatch stopwatch;
+            for (uint32_t r = 0; r < repeat; ++r)
+            {
+                memcpy( &buffer[0], &raw[0], pixelCount * sizeof( uint16_t));
+                ptrCalibration->Correct( &buffer[0], 0, &buffer[0], 0);
+            }
+            const double seconds = stopwatch.GetSeconds() / repeat;
+            CStopwatch floatStopwatch;
+            for (uint32_t r = 0; r < repeat; ++r)
+            {
+                correctFloat();
+            }
+            const double floatSeconds = floatStopwatch.GetSeconds() / repeat;
+
+            SBenchmarkResult result;
+            result.Benchmark = "calibration";
+            result.Case = "correct";
+            result.Add( "ms_per_frame", seconds * 1e3)
+                .Add( "fps", 1.0 / seconds)
+                .Add( "period_share", seconds * frameRate)
+                .Add( "float_ms_per_frame", floatSeconds * 1e3)
+                .Add( "speedup", floatSeconds / seconds)
+                .Add( "checksum", buffer[pixelCount / 2] + reference[pixelCount / 2]);
+            report.Add( result);
+        }
+
+        {
+            const uint32_t lookupCount = 100000;
+            size_t foundCount = 0;
+            CStopwatch stopwatch;
+            for (uint32_t i = 0; i < lookupCount; ++i)
+            {
+                foundCount += ptrCache->Find( i % 2 == 0 ? key : missingKey) ? 1 : 0;
+            }
+            const double seconds = stopwatch.GetSeconds() / lookupCount;
+
+            SBenchmarkResult result;
+            result.Benchmark = "calibration";
+            result.Case = "lookup";
+            result.Add( "store_ms", storeSeconds * 1e3)
+                .Add( "first_lookup_ms", firstLookupSeconds * 1e3)
+                .Add( "lookup_us", seconds * 1e6)
+                .Add( "found_share", static_cast<double>(foundCount) / lookupCount)
+                .Add( "file_mb", (ptrCalibration->GetHeader().GainMapOffset + pixelCount * sizeof( uint16_t)) / 1048576.0);
+            report.Add( result);
+        }
+
+        // Windows removes mapped files only after the mapping is closed.
+        ptrCalibration.reset();
+        ptrCache.reset();
+        if (!isKept)
+        {
+            remove( fileName.c_str());
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHCALIBRATION_H_9517402 */
@@ -0,0 +1,268 @@
+// Contains the benchmark of the lossless 12-bit codec.
+/*
+   Compresses frames with the codec in include/Lossless12Codec.h with one thread and all hardware
+   threads and decodes them again, checking that the decoded frames are identical. Reported are the
+   compression ratio and the encode and decode data rates in MB of uncompressed image data per second.
+   For comparison the frames are saved as .png files the way the samples do, and, if the program is
+   built with HAVE_ZSTD or HAVE_LZ4 and linked to the libraries, compressed with zstd and LZ4.
+
+   The input are recorded frames given with -replay <file>[,<file>...] (frame containers or .raw files,
+   see include/FrameReplayReader.h). Without recordings synthetic Mono12 and BayerGB12 frames are used,
+   with deterministic noise added because the smooth fractal compresses far better than a sensor image.
+   Options: -replay <files>, -frames <n> (default 8), -size <width>x<height>, -repeat <n> (default 3),
+   -dir <dir> (the first directory is used for the .png files).
+*/
+
+#ifndef INCLUDED_BENCHCODEC_H_3390517
+#define INCLUDED_BENCHCODEC_H_3390517
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "BenchStorage.h"
+#include "../include/FrameReplayReader.h"
+#include "../include/Lossless12Codec.h"
+
+#if defined(HAVE_ZSTD)
+#    include <zstd.h>
+#endif
+#if defined(HAVE_LZ4)
+#    include <lz4.h>
+#endif
+
+namespace Benchmark
+{
+    // Frames of one pixel format used as codec input.
+    struct SCodecInput
+    {
+        std::string Name;
+        Pylon::EPixelType PixelType;
+        uint32_t Width;
+        uint32_t Height;
+        std::vector< std::vector<uint8_t> > Frames;
+    };
+
+    // Adds noise with a standard deviation growing with the signal, like the shot noise of a sensor.
+    inline void AddSensorNoise( std::vector<uint8_t>& frame, uint32_t seed)
+    {
+        uint16_t* pPixels = reinterpret_cast<uint16_t*>(&frame[0]);
+        const size_t pixelCount = frame.size() / sizeof( uint16_t);
+        uint32_t state = seed * 2654435761u + 1;
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            // The sum of two uniform values approximates a bell shaped distribution.
+            const int32_t uniform = static_cast<int32_t>(state & 0xFF) + static_cast<int32_t>((state >> 8) & 0xFF) - 255;
+            const int32_t amplitude = 2 + static_cast<int32_t>(pPixels[i] >> 8);
+            const int32_t value = static_cast<int32_t>(pPixels[i]) + uniform * amplitude / 128;
+            pPixels[i] = static_cast<uint16_t>(std::min( 4095, std::max( 0, value)));
+        }
+    }
+
+    inline std::vector<SCodecInput> GetCodecInputs( int argc, char* argv[])
+    {
+        const char* framesValue = Pylon::GetCommandLineOption( argc, argv, "-frames");
+        const uint32_t frameCount = framesValue != NULL ? std::max( 1, atoi( framesValue)) : 8;
+        std::vector<SCodecInput> inputs;
+
+        const char* replayValue = Pylon::GetCommandLineOption( argc, argv, "-replay");
+        if (replayValue != NULL)
+        {
+            Pylon::CFrameReplayReader reader;
+            reader.Open( SplitList( replayValue));
+            SCodecInput input;
+            input.Name = "recorded";
+            for (size_t i = 0; i < std::min<size_t>( frameCount, reader.GetFrameCount()); ++i)
+            {
+                const Pylon::SFrameContainerRecord& record = reader.GetRecord( i);
+                const Pylon::EPixelType pixelType = static_cast<Pylon::EPixelType>(record.PixelType);
+                if (!Pylon::CLossless12Encoder::IsSupported( pixelType) || record.PaddingX != 0
+                    || (!input.Frames.empty() && (pixelType != input.PixelType || record.Width != input.Width || record.Height != input.Height)))
+                {
+                    continue;
+                }
+                input.PixelType = pixelType;
+                input.Width = record.Width;
+                input.Height = record.Height;
+                input.Frames.push_back( std::vector<uint8_t>( reader.GetImageSize( i)));
+                reader.ReadFrame( i, &input.Frames.back()[0], input.Frames.back().size());
+            }
+            if (input.Frames.empty())
+            {
+                throw RUNTIME_EXCEPTION( "The recordings contain no unpadded 16-bit frames of a uniform format.");
+            }
+            input.Name += std::string( " ") + GetPixelTypeName( input.PixelType);
+            inputs.push_back( input);
+            return inputs;
+        }
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        GetBenchmarkFrameSize( argc, argv, width, height);
+        const Pylon::EPixelType pixelTypes[] = { Pylon::PixelType_Mono12, Pylon::PixelType_BayerGB12 };
+        for (size_t p = 0; p < sizeof( pixelTypes) / sizeof( pixelTypes[0]); ++p)
+        {
+            SampleImageCreator::SFractalSettings settings;
+            settings.Width = width;
+            settings.Height = height;
+            settings.PixelType = pixelTypes[p];
+            SampleImageCreator::CFractalFramePool pool;
+            pool.Create( settings, frameCount);
+
+            SCodecInput input;
+            input.Name = std::string( "synthetic ") + GetPixelTypeName( pixelTypes[p]);
+            input.PixelType = pixelTypes[p];
+            input.Width = width;
+            input.Height = height;
+            for (uint32_t i = 0; i < frameCount; ++i)
+            {
+                const uint8_t* pFrame = static_cast<const uint8_t*>(pool.GetFrame( i));
+                input.Frames.push_back( std::vector<uint8_t>( pFrame, pFrame + pool.GetFrameSize()));
+                AddSensorNoise( input.Frames.back(), i);
+            }
+            inputs.push_back( input);
+        }
+        return inputs;
+    }
+
+    inline SBenchmarkResult MakeCodecResult( const SCodecInput& input, const char* codecName, double imageBytes, double compressedBytes, double encodeSeconds, double decodeSeconds)
+    {
+        SBenchmarkResult result;
+        result.Benchmark = "codec";
+        result.Case = std::string( codecName) + " " + input.Name;
+        result.Add( "ratio", imageBytes / compressedBytes)
+            .Add( "encode_mb_per_s", imageBytes / encodeSeconds * 1e-6);
+        if (decodeSeconds > 0.0)
+        {
+            result.Add( "decode_mb_per_s", imageBytes / decodeSeconds * 1e-6);
+        }
+        return result;
+    }
+
+    inline void RunCodecBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        const uint32_t repeat = GetBenchmarkRepeat( argc, argv, 3);
+        const std::vector<SCodecInput> inputs = GetCodecInputs( argc, argv);
+        const unsigned int hardwareThreads = std::max( 1u, std::thread::hardware_concurrency());
+
+        for (size_t n = 0; n < inputs.size(); ++n)
+        {
+            const SCodecInput& input = inputs[n];
+            const size_t frameSize = input.Frames[0].size();
+            const double imageBytes = static_cast<double>(frameSize) * input.Frames.size() * repeat;
+
+            const unsigned int threadCounts[] = { 1, hardwareThreads };
+            for (size_t t = 0; t < sizeof( threadCounts) / sizeof( threadCounts[0]); ++t)
+            {
+                if (t > 0 && threadCounts[t] == threadCounts[0])
+                {
+                    continue;
+                }
+                Pylon::SLossless12Settings settings;
+                settings.NumThreads = threadCounts[t];
+                Pylon::CLossless12Encoder encoder( settings);
+                std::vector< std::vector<uint8_t> > encoded( input.Frames.size());
+                std::vector<uint8_t> decoded( frameSize);
+                double compressedBytes = 0.0;
+
+                CStopwatch stopwatch;
+                for (uint32_t r = 0; r < repeat; ++r)
+                {
+                    for (size_t i = 0; i < input.Frames.size(); ++i)
+                    {
+                        compressedBytes += encoder.Encode( &input.Frames[i][0], input.PixelType, input.Width, input.Height, 0, encoded[i]);
+                    }
+                }
+                const double encodeSeconds = stopwatch.GetSeconds();
+
+                stopwatch.Restart();
+                for (uint32_t r = 0; r < repeat; ++r)
+                {
+                    for (size_t i = 0; i < input.Frames.size(); ++i)
+                    {
+                        Pylon::DecodeLossless12( &encoded[i][0], encoded[i].size(), &decoded[0], decoded.size());
+                        if (r == 0 && decoded != input.Frames[i])
+                        {
+                            throw RUNTIME_EXCEPTION( "The lossless codec changed frame %u of %s.", static_cast<unsigned int>(i), input.Name.c_str());
+                        }
+                    }
+                }
+                const double decodeSeconds = stopwatch.GetSeconds();
+
+                char codecName[64];
+                sprintf( codecName, "lossless12 threads=%u", threadCounts[t]);
+                SBenchmarkResult result = MakeCodecResult( input, codecName, imageBytes, compressedBytes, encodeSeconds, decodeSeconds);
+                report.Add( result.Add( "threads", threadCounts[t]));
+            }
+
+            // The .png files are written once, their size is the compressed size. Decoding is not measured.
+            {
+                const std::string fileName = GetBenchmarkDirectories( argc, argv).front() + "/bench-codec.png";
+                double compressedBytes = 0.0;
+                CStopwatch stopwatch;
+                for (size_t i = 0; i < input.Frames.size(); ++i)
+                {
+                    Pylon::SavePngFrame( fileName.c_str(), const_cast<uint8_t*>(&input.Frames[i][0]), frameSize, input.PixelType, input.Width, input.Height, 0);
+                    struct stat info;
+                    compressedBytes += stat( fileName.c_str(), &info) == 0 ? static_cast<double>(info.st_size) : 0.0;
+                }
+                const double encodeSeconds = stopwatch.GetSeconds();
+                remove( fileName.c_str());
+                const double pngImageBytes = static_cast<double>(frameSize) * input.Frames.size();
+                report.Add( MakeCodecResult( input, "png file", pngImageBytes, compressedBytes, encodeSeconds, 0.0));
+            }
+
+#if defined(HAVE_ZSTD)
+            {
+                std::vector<uint8_t> compressed( ZSTD_compressBound( frameSize));
+                std::vector<uint8_t> decoded( frameSize);
+                double compressedBytes = 0.0;
+                double encodeSeconds = 0.0;
+                double decodeSeconds = 0.0;
+                for (uint32_t r = 0; r < repeat; ++r)
+                {
+                    for (size_t i = 0; i < input.Frames.size(); ++i)
+                    {
+                        CStopwatch stopwatch;
+                        const size_t size = ZSTD_compress( &compressed[0], compressed.size(), &input.Frames[i][0], frameSize, 1);
+                        encodeSeconds += stopwatch.GetSeconds();
+                        compressedBytes += size;
+                        stopwatch.Restart();
+                        ZSTD_decompress( &decoded[0], decoded.size(), &compressed[0], size);
+                        decodeSeconds += stopwatch.GetSeconds();
+                    }
+                }
+                report.Add( MakeCodecResult( input, "zstd level=1", imageBytes, compressedBytes, encodeSeconds, decodeSeconds));
+            }
+#endif
+
+#if defined(HAVE_LZ4)
+            {
+                std::vector<char> compressed( LZ4_compressBound( static_cast<int>(frameSize)));
+                std::vector<char> decoded( frameSize);
+                double compressedBytes = 0.0;
+                double encodeSeconds = 0.0;
+                double decodeSeconds = 0.0;
+                for (uint32_t r = 0; r < repeat; ++r)
+                {
+                    for (size_t i = 0; i < input.Frames.size(); ++i)
+                    {
+                        CStopwatch stopwatch;
+                        const int size = LZ4_compress_default( reinterpret_cast<const char*>(&input.Frames[i][0]), &compressed[0],
+                            static_cast<int>(frameSize), static_cast<int>(compressed.size()));
+                        encodeSeconds += stopwatch.GetSeconds();
+                        compressedBytes += size;
+                        stopwatch.Restart();
+                        LZ4_decompress_safe( &compressed[0], &decoded[0], size, static_cast<int>(decoded.size()));
+                        decodeSeconds += stopwatch.GetSeconds();
+                    }
+                }
+                report.Add( MakeCodecResult( input, "lz4", imageBytes, compressedBytes, encodeSeconds, decodeSeconds));
+            }
+#endif
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHCODEC_H_3390517 */
@@ -0,0 +1,148 @@
+// Contains the benchmark of the fractal pattern engine.
+/*
+   Compares the throughput in megapixels per second of the original scalar generators in
+   SampleImageCreator::Reference with the SIMD pattern engine for the camera pixel formats, both
+   precisions and one thread versus all hardware threads.
+   Options: -size <width>x<height> (default 2592x1944), -repeat <n> (default 5).
+*/
+
+#ifndef INCLUDED_BENCHFRACTAL_H_8731642
+#define INCLUDED_BENCHFRACTAL_H_8731642
+
+#include "BenchmarkReport.h"
+#include "../include/FrameSourceSelection.h"
+#include "../include/SampleImageCreator.h"
+
+namespace Benchmark
+{
+    // Returns the frame size given with -size, or the default of the 5 MP sensor.
+    inline void GetBenchmarkFrameSize( int argc, char* argv[], uint32_t& width, uint32_t& height)
+    {
+        width = 2592;
+        height = 1944;
+        const char* value = Pylon::GetCommandLineOption( argc, argv, "-size");
+        if (value != NULL)
+        {
+            unsigned int w = 0;
+            unsigned int h = 0;
+            if (sscanf( value, "%ux%u", &w, &h) != 2 || w == 0 || h == 0)
+            {
+                throw RUNTIME_EXCEPTION( "Invalid frame size %s. Expected <width>x<height>.", value);
+            }
+            width = w;
+            height = h;
+        }
+    }
+
+    inline uint32_t GetBenchmarkRepeat( int argc, char* argv[], uint32_t defaultRepeat)
+    {
+        const char* value = Pylon::GetCommandLineOption( argc, argv, "-repeat");
+        return value != NULL ? std::max( 1, atoi( value)) : defaultRepeat;
+    }
+
+    inline const char* GetPixelTypeName( Pylon::EPixelType pixelType)
+    {
+        switch (pixelType)
+        {
+        case Pylon::PixelType_Mono8: return "Mono8";
+        case Pylon::PixelType_Mono12: return "Mono12";
+        case Pylon::PixelType_BayerGB12: return "BayerGB12";
+        case Pylon::PixelType_RGB8packed: return "RGB8packed";
+        default: return "Other";
+        }
+    }
+
+    inline void RunFractalBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace SampleImageCreator;
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        GetBenchmarkFrameSize( argc, argv, width, height);
+        const uint32_t repeat = GetBenchmarkRepeat( argc, argv, 5);
+        const double megapixels = width * static_cast<double>(height) * 1e-6;
+
+        // The reference generators are slow, they are measured once.
+        {
+            CStopwatch stopwatch;
+            Pylon::CPylonImage julia = Reference::CreateJuliaFractal( Pylon::PixelType_Mono8, width, height);
+            const double juliaSeconds = stopwatch.GetSeconds();
+            stopwatch.Restart();
+            Pylon::CPylonImage mandelbrot = Reference::CreateMandelbrotFractal( Pylon::PixelType_Mono8, width, height);
+            const double mandelbrotSeconds = stopwatch.GetSeconds();
+
+            SBenchmarkResult result;
+            result.Benchmark = "fractal";
+            result.Case = "reference Mono8";
+            result.Add( "julia_mp_per_s", megapixels / juliaSeconds).Add( "mandelbrot_mp_per_s", megapixels / mandelbrotSeconds);
+            report.Add( result);
+        }
+
+        const Pylon::EPixelType pixelTypes[] = { Pylon::PixelType_Mono8, Pylon::PixelType_Mono12, Pylon::PixelType_BayerGB12 };
+        const EFractalPrecision precisions[] = { FractalPrecision_Float, FractalPrecision_Double };
+        const unsigned int threadCounts[] = { 1, std::max( 1u, std::thread::hardware_concurrency()) };
+
+        for (size_t p = 0; p < sizeof( pixelTypes) / sizeof( pixelTypes[0]); ++p)
+        {
+            std::vector<uint8_t> buffer( static_cast<size_t>(width) * height * FractalBytesPerPixel( pixelTypes[p]));
+            for (size_t q = 0; q < sizeof( precisions) / sizeof( precisions[0]); ++q)
+            {
+                for (size_t t = 0; t < sizeof( threadCounts) / sizeof( threadCounts[0]); ++t)
+                {
+                    if (t > 0 && threadCounts[t] == threadCounts[0])
+                    {
+                        continue;
+                    }
+                    SFractalSettings settings;
+                    settings.Width = width;
+                    settings.Height = height;
+                    settings.PixelType = pixelTypes[p];
+                    settings.Precision = precisions[q];
+                    settings.NumThreads = threadCounts[t];
+
+                    double seconds[2] = { 0.0, 0.0 };
+                    for (int type = 0; type < 2; ++type)
+                    {
+                        settings.Type = type == 0 ? FractalType_Julia : FractalType_Mandelbrot;
+                        CStopwatch stopwatch;
+                        for (uint32_t i = 0; i < repeat; ++i)
+                        {
+                            settings.Phase = static_cast<double>(i) / repeat;
+                            RenderFractal( settings, &buffer[0], width * FractalBytesPerPixel( pixelTypes[p]));
+                        }
+                        seconds[type] = stopwatch.GetSeconds() / repeat;
+                    }
+
+                    char caseName[128];
+                    sprintf( caseName, "engine %s %s threads=%u", GetPixelTypeName( pixelTypes[p]),
+                        precisions[q] == FractalPrecision_Float ? "float" : "double",
+                        threadCounts[t]);
+                    SBenchmarkResult result;
+                    result.Benchmark = "fractal";
+                    result.Case = caseName;
+                    result.Add( "julia_mp_per_s", megapixels / seconds[0]).Add( "mandelbrot_mp_per_s", megapixels / seconds[1]);
+                    report.Add( result);
+                }
+            }
+        }
+
+        // Time to fill the frame cycle the synthetic frame source replays.
+        {
+            SFractalSettings settings;
+            settings.Width = width;
+            settings.Height = height;
+            settings.PixelType = Pylon::PixelType_Mono12;
+            CStopwatch stopwatch;
+            CFractalFramePool pool;
+            pool.Create( settings, 8);
+
+            SBenchmarkResult result;
+            result.Benchmark = "fractal";
+            result.Case = "frame pool Mono12 cycle=8";
+            result.Add( "create_ms", stopwatch.GetSeconds() * 1e3);
+            report.Add( result);
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHFRACTAL_H_8731642 */
@@ -0,0 +1,339 @@
+// Contains the benchmark and the check of the TCP frame streaming of include/FrameStreamServer.h.
+/*
+   The benchmark publishes Mono12 frames to a CFrameStreamServer on the loopback interface and receives
+   them with CFrameStreamClient threads, which compare every frame with the frame published.
+       clients         1, 2 and 4 clients of the full stream, the frames published as fast as the buffers
+                       come back, like a camera with MaxNumBuffer buffers, the throughput. Most frames are
+                       dropped, the clients get as many as the sockets carry.
+       checksum        1 client, the server computing the checksums and the client checking them
+       checksum cropped  the same for frames cropped by 3 pixels from a wider buffer, sent row by row with
+                       rows that are no multiple of 8 bytes
+       preview         1 client of the preview stream, decimated by 4
+       slow client     2 clients at -rate fps, one sleeping 50 ms per frame, which must not hold up the
+                       publisher or the other client
+   Reported are the Gbit/s sent in total and per client, the CPU cores used per stream, the time of
+   Publish() and the fraction of the frames dropped. The CPU time is that of the process, it includes
+   the clients receiving on the loopback interface. A client must not get a corrupt frame, frames out of
+   order or, in the slow client case, hold up the publisher.
+   -tcp-client <host>:<port> runs a client of a server like that of Grab_StateMachine -serve, it reports
+   the frames received per second and checks them, -preview subscribes to the preview stream.
+   Options: -size <width>x<height> (default 2592x1944), -frames <n> per case (default 300), -rate <fps>
+   (default 30), -queue <n> (default 2).
+*/
+
+#ifndef INCLUDED_BENCHFRAMESTREAM_H_3307251
+#define INCLUDED_BENCHFRAMESTREAM_H_3307251
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "BenchStorage.h"
+#include "../include/FrameStreamServer.h"
+
+#include <thread>
+
+namespace Benchmark
+{
+    // A client thread of the benchmark, receives and checks the frames until the server stops.
+    class CFrameStreamBenchClient
+    {
+    public:
+        CFrameStreamBenchClient( uint16_t port, Pylon::EFrameStream stream, const std::vector<uint16_t>* pReference, uint32_t sleepMs)
+            : m_pReference( pReference)
+            , m_sleepMs( sleepMs)
+            , m_receivedCount( 0)
+            , m_corruptCount( 0)
+            , m_droppedCount( 0)
+        {
+            m_client.Connect( "127.0.0.1", port, stream);
+            m_thread = std::thread( &CFrameStreamBenchClient::Receive, this);
+        }
+
+        // Waits until the server closed the connection, throws the error of the client.
+        void Join()
+        {
+            m_thread.join();
+            if (!m_error.empty())
+            {
+                throw RUNTIME_EXCEPTION( "%s", m_error.c_str());
+            }
+            if (m_corruptCount != 0)
+            {
+                throw RUNTIME_EXCEPTION( "A client got %u corrupt frames.", static_cast<unsigned int>(m_corruptCount));
+            }
+        }
+
+        uint64_t GetReceivedCount() const
+        {
+            return m_receivedCount;
+        }
+
+        uint64_t GetDroppedCount() const
+        {
+            return m_droppedCount;
+        }
+
+    private:
+        void Receive()
+        {
+            try
+            {
+                Pylon::SFrameStreamHeader header;
+                std::vector<uint8_t> rows;
+                while (m_client.Receive( header, rows))
+                {
+                    ++m_receivedCount;
+                    m_droppedCount = header.DroppedCount;
+                    // The first 3 pixels hold the frame number, the others are those of the reference.
+                    if (m_pReference != NULL && header.Stream == Pylon::FrameStream_Full)
+                    {
+                        const uint16_t* pPixels = reinterpret_cast<const uint16_t*>(&rows[0]);
+                        const uint64_t frameNumber = pPixels[0] | static_cast<uint64_t>(pPixels[1]) << 12 | static_cast<uint64_t>(pPixels[2]) << 24;
+                        if (rows.size() != m_pReference->size() * sizeof( uint16_t) || frameNumber != (header.FrameNumber & 0xFFFFFFFFFULL)
+                            || memcmp( pPixels + 3, &(*m_pReference)[3], rows.size() - 3 * sizeof( uint16_t)) != 0)
+                        {
+                            ++m_corruptCount;
+                        }
+                    }
+                    if (m_sleepMs != 0)
+                    {
+                        std::this_thread::sleep_for( std::chrono::milliseconds( m_sleepMs));
+                    }
+                }
+            }
+            catch (const GenICam::GenericException& e)
+            {
+                m_error = std::string( "A client failed: ") + e.GetDescription();
+                // The server drops the client and releases the frames queued for it.
+                m_client.Close();
+            }
+        }
+
+        Pylon::CFrameStreamClient m_client;
+        std::thread m_thread;
+        const std::vector<uint16_t>* m_pReference;
+        uint32_t m_sleepMs;
+        uint64_t m_receivedCount;
+        uint64_t m_corruptCount;
+        uint64_t m_droppedCount;
+        std::string m_error;
+    };
+
+    // Receives the frames of a server until it stops, see -tcp-client.
+    inline void RunFrameStreamClient( const char* address, bool isPreview)
+    {
+        using namespace Pylon;
+
+        const std::string host( address, strchr( address, ':') != NULL ? strchr( address, ':') : address + strlen( address));
+        const int port = strchr( address, ':') != NULL ? atoi( strchr( address, ':') + 1) : 5600;
+        CFrameStreamClient client;
+        client.Connect( host, static_cast<uint16_t>(port), isPreview ? FrameStream_Preview : FrameStream_Full);
+
+        SFrameStreamHeader header;
+        std::vector<uint8_t> rows;
+        CStopwatch stopwatch;
+        uint64_t receivedCount = 0;
+        uint64_t bytes = 0;
+        while (client.Receive( header, rows))
+        {
+            ++receivedCount;
+            bytes += rows.size();
+            if (stopwatch.GetSeconds() >= 1.0)
+            {
+                printf( "Frame %llu, %ux%u, %.1f fps, %.2f Gbit/s, %llu dropped\n", static_cast<unsigned long long>(header.FrameNumber),
+                    header.Width, header.Height, receivedCount / stopwatch.GetSeconds(), bytes * 8e-9 / stopwatch.GetSeconds(),
+                    static_cast<unsigned long long>(header.DroppedCount));
+                stopwatch.Restart();
+                receivedCount = 0;
+                bytes = 0;
+            }
+        }
+        printf( "The server closed the connection after %llu frames.\n", static_cast<unsigned long long>(client.GetReceivedCount()));
+    }
+
+    inline void RunFrameStreamBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace Pylon;
+
+        const char* value = NULL;
+        if ((value = GetCommandLineOption( argc, argv, "-tcp-client")) != NULL)
+        {
+            RunFrameStreamClient( value, HasCommandLineFlag( argc, argv, "-preview"));
+            return;
+        }
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        GetBenchmarkFrameSize( argc, argv, width, height);
+        const uint32_t frameCount = (value = GetCommandLineOption( argc, argv, "-frames")) != NULL ? static_cast<uint32_t>(std::max( 1, atoi( value))) : 300;
+        const double rate = (value = GetCommandLineOption( argc, argv, "-rate")) != NULL ? std::max( 1.0, atof( value)) : 30.0;
+        const uint32_t queueDepth = (value = GetCommandLineOption( argc, argv, "-queue")) != NULL ? static_cast<uint32_t>(std::max( 1, atoi( value))) : 2;
+
+        // 12-bit values, the frame number goes into the first 3 pixels.
+        std::vector<uint16_t> reference( static_cast<size_t>(width) * height);
+        for (size_t i = 0; i < reference.size(); ++i)
+        {
+            reference[i] = static_cast<uint16_t>((i * 7 + i / width * 13) & 0xFFF);
+        }
+
+        struct SCase
+        {
+            const char* Name;
+            uint32_t ClientCount;
+            EFrameStream Stream;
+            bool ComputeChecksum;
+            bool IsSlow;
+            bool IsCropped;
+        };
+        const SCase cases[] =
+        {
+            { "clients", 1, FrameStream_Full, false, false, false },
+            { "clients", 2, FrameStream_Full, false, false, false },
+            { "clients", 4, FrameStream_Full, false, false, false },
+            { "checksum", 1, FrameStream_Full, true, false, false },
+            { "checksum cropped", 1, FrameStream_Full, true, false, true },
+            { "preview", 1, FrameStream_Preview, false, false, false },
+            { "slow client", 2, FrameStream_Full, false, true, false }
+        };
+
+        // The frames of the cropped case, the left width - 3 pixels of every row of the buffer.
+        const uint32_t croppedWidth = width > 3 ? width - 3 : width;
+        std::vector<uint16_t> croppedReference;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            croppedReference.insert( croppedReference.end(), reference.begin() + static_cast<size_t>(y) * width,
+                reference.begin() + static_cast<size_t>(y) * width + croppedWidth);
+        }
+
+        for (size_t c = 0; c < sizeof( cases) / sizeof( cases[0]); ++c)
+        {
+            const SCase& benchCase = cases[c];
+            const uint32_t viewWidth = benchCase.IsCropped ? croppedWidth : width;
+            const std::vector<uint16_t>& sentReference = benchCase.IsCropped ? croppedReference : reference;
+            SFrameStreamSettings settings;
+            settings.BindAddress = "127.0.0.1";
+            settings.QueueDepth = queueDepth;
+            settings.ComputeChecksum = benchCase.ComputeChecksum;
+            settings.Preview.Decimation = 4;
+            CFrameStreamServer server( settings);
+            server.Start( 0);
+
+            std::vector<CFrameStreamBenchClient*> clients;
+            for (uint32_t i = 0; i < benchCase.ClientCount; ++i)
+            {
+                clients.push_back( new CFrameStreamBenchClient( server.GetPort(), benchCase.Stream, &sentReference, benchCase.IsSlow && i == 0 ? 50 : 0));
+            }
+            for (int waited = 0; server.GetClientCount() < benchCase.ClientCount; waited += 10)
+            {
+                if (waited > 5000)
+                {
+                    throw RUNTIME_EXCEPTION( "Only %u of %u clients connected.", static_cast<unsigned int>(server.GetClientCount()), benchCase.ClientCount);
+                }
+                std::this_thread::sleep_for( std::chrono::milliseconds( 10));
+            }
+
+            // The buffers of the "camera", a buffer is reused once no queue holds it.
+            std::vector< std::shared_ptr< std::vector<uint16_t> > > buffers;
+            for (uint32_t i = 0; i < (queueDepth + 1) * benchCase.ClientCount + 2; ++i)
+            {
+                buffers.push_back( std::make_shared< std::vector<uint16_t> >( reference));
+            }
+
+            std::vector<double> publishSeconds;
+            CCpuStopwatch stopwatch;
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (uint32_t f = 0; f < frameCount; ++f)
+            {
+                if (benchCase.IsSlow)
+                {
+                    std::this_thread::sleep_until( start + std::chrono::microseconds( static_cast<int64_t>(f * 1e6 / rate)));
+                }
+                std::shared_ptr< std::vector<uint16_t> > ptrBuffer;
+                for (size_t b = 0; !ptrBuffer; b = (b + 1) % buffers.size())
+                {
+                    if (buffers[b].use_count() == 1)
+                    {
+                        ptrBuffer = buffers[b];
+                    }
+                    else if (b + 1 == buffers.size())
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+                uint16_t* pPixels = &(*ptrBuffer)[0];
+                pPixels[0] = static_cast<uint16_t>(f & 0xFFF);
+                pPixels[1] = static_cast<uint16_t>((f >> 12) & 0xFFF);
+                pPixels[2] = static_cast<uint16_t>((f >> 24) & 0xFFF);
+                CFrameView view( pPixels, PixelType_Mono12, viewWidth, height, width * sizeof( uint16_t), ptrBuffer);
+                ptrBuffer.reset();
+
+                CStopwatch publishStopwatch;
+                server.Publish( view, f, static_cast<int64_t>(f));
+                publishSeconds.push_back( publishStopwatch.GetSeconds());
+            }
+            // Waits for the queues to be sent.
+            for (bool isSending = true; isSending; )
+            {
+                isSending = false;
+                for (size_t b = 0; b < buffers.size(); ++b)
+                {
+                    isSending = isSending || (benchCase.Stream == FrameStream_Full && !benchCase.IsSlow && buffers[b].use_count() != 1);
+                }
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1));
+            }
+            const double seconds = stopwatch.GetSeconds();
+            const double cpuCores = stopwatch.GetCpuCores();
+            const std::vector<SFrameStreamClientStatistics> statistics = server.GetClientStatistics();
+            server.Stop();
+
+            uint64_t bytesSent = 0;
+            uint64_t droppedCount = 0;
+            for (size_t i = 0; i < statistics.size(); ++i)
+            {
+                bytesSent += statistics[i].BytesSent;
+                droppedCount += statistics[i].DroppedCount;
+            }
+            uint64_t receivedCount = 0;
+            for (size_t i = 0; i < clients.size(); ++i)
+            {
+                clients[i]->Join();
+                receivedCount += clients[i]->GetReceivedCount();
+            }
+            if (receivedCount + droppedCount != static_cast<uint64_t>(frameCount) * benchCase.ClientCount && !benchCase.IsSlow)
+            {
+                throw RUNTIME_EXCEPTION( "The clients got %u and dropped %u of %u frames.", static_cast<unsigned int>(receivedCount),
+                    static_cast<unsigned int>(droppedCount), frameCount * benchCase.ClientCount);
+            }
+            const double maxPublishSeconds = *std::max_element( publishSeconds.begin(), publishSeconds.end());
+            if (benchCase.IsSlow)
+            {
+                // The slow client is the first one, the other must get the frames at the rate they are published.
+                if (clients[1]->GetReceivedCount() < frameCount * 9 / 10 || maxPublishSeconds > 0.05)
+                {
+                    throw RUNTIME_EXCEPTION( "The slow client held up the others, the fast client got %u of %u frames, Publish() took up to %.1f ms.",
+                        static_cast<unsigned int>(clients[1]->GetReceivedCount()), frameCount, maxPublishSeconds * 1e3);
+                }
+            }
+            for (size_t i = 0; i < clients.size(); ++i)
+            {
+                delete clients[i];
+            }
+
+            SBenchmarkResult result;
+            result.Benchmark = "tcp";
+            result.Case = benchCase.Name;
+            result.Add( "clients", benchCase.ClientCount)
+                .Add( "frame_mb", sentReference.size() * sizeof( uint16_t) / 1048576.0)
+                .Add( "publish_fps", frameCount / seconds)
+                .Add( "client_fps", receivedCount / seconds / benchCase.ClientCount)
+                .Add( "gbit_s", bytesSent * 8e-9 / seconds)
+                .Add( "gbit_s_per_client", bytesSent * 8e-9 / seconds / benchCase.ClientCount)
+                .Add( "cpu_per_stream", cpuCores / benchCase.ClientCount)
+                .Add( "publish_us", GetPercentile( publishSeconds, 50.0) * 1e6)
+                .Add( "publish_max_us", maxPublishSeconds * 1e6)
+                .Add( "dropped", static_cast<double>(droppedCount) / (static_cast<double>(frameCount) * benchCase.ClientCount));
+            report.Add( result);
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHFRAMESTREAM_H_3307251 */
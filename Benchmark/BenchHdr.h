@@ -0,0 +1,218 @@
+// Contains the benchmark and the check of the HDR merge.
+/*
+   A radiance map is made from a synthetic Mono12 frame, stretched exponentially over 14 stops, and exposed
+   with exposure times 1, 4 and 16 ms: the values are the radiance times the exposure time plus a black level
+   of 64 DN, rounded and clipped to 12 bits. The frames are merged by CHdrMerger of include/HdrMerge.h and
+   compared with the radiance times the longest exposure time:
+       exact     without noise, reported are the largest and the mean error relative to the radiance of
+                 pixels above 64 DN in the longest exposure, where the rounding of the values is about 1 %
+       noisy     with shot and read noise of the model the merge assumes, reported is the rms error relative
+                 to the error of the ideal inverse variance average of the unsaturated frames, about 1
+   The share of the pixels saturated in the longest exposure shows how much of the range needs the others.
+   The benchmark fails if the exact merge is off by more than 2 %, or 0.5 % on average, or if the noisy
+   merge has more than 1.2 times the error of the ideal average.
+
+   Then the merge of 3 frames of 2592x1944 is timed on one thread and on all threads. Reported are the time per
+   merge, the rate of input frames merged and its ratio to the frame rate of the burst, which must be at least 1
+   for the merge to keep up with the camera.
+   Options: -size <width>x<height> (default 2592x1944), -repeat <n> (default 10), -fps <burst rate> (default 14).
+*/
+
+#ifndef INCLUDED_BENCHHDR_H_4427180
+#define INCLUDED_BENCHHDR_H_4427180
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "../include/HdrMerge.h"
+
+#include <random>
+
+namespace Benchmark
+{
+    // Exposes the radiance, in DN per ms, for exposureMs. Adds the noise of the settings if pRandom is not NULL.
+    inline void ExposeRadiance( const std::vector<float>& radiance, double exposureMs, const Pylon::SHdrMergeSettings& settings,
+        std::mt19937* pRandom, std::vector<uint16_t>& frame)
+    {
+        std::normal_distribution<double> normal;
+        frame.resize( radiance.size());
+        for (size_t i = 0; i < radiance.size(); ++i)
+        {
+            const double signal = radiance[i] * exposureMs;
+            double value = signal + settings.BlackLevel;
+            if (pRandom != NULL)
+            {
+                value += normal( *pRandom) * std::sqrt( settings.ConversionGain * signal + settings.ReadNoise * settings.ReadNoise);
+            }
+            frame[i] = static_cast<uint16_t>(std::min( std::max( value + 0.5, 0.0), 4095.0));
+        }
+    }
+
+    inline void RunHdrBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace SampleImageCreator;
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        GetBenchmarkFrameSize( argc, argv, width, height);
+        const uint32_t repeat = GetBenchmarkRepeat( argc, argv, 10);
+        const char* fpsValue = Pylon::GetCommandLineOption( argc, argv, "-fps");
+        const double frameRate = fpsValue != NULL ? atof( fpsValue) : 14.0;
+
+        SFractalSettings fractalSettings;
+        fractalSettings.Width = width;
+        fractalSettings.Height = height;
+        fractalSettings.PixelType = Pylon::PixelType_Mono12;
+        const Pylon::CPylonImage image = RenderFractal( fractalSettings);
+
+        Pylon::SHdrMergeSettings settings;
+        settings.BlackLevel = 64.0;
+        settings.SaturationLevel = 4000.0;
+
+        // Up to just below saturation in the shortest exposure, 14 stops down from there.
+        const double exposuresMs[] = { 1.0, 4.0, 16.0 };
+        const size_t frameCount = sizeof( exposuresMs) / sizeof( exposuresMs[0]);
+        const double maxExposureMs = exposuresMs[frameCount - 1];
+        const double maxRadiance = (settings.SaturationLevel - settings.BlackLevel - 64.0) / exposuresMs[0];
+        // The fractal has few levels, mostly dark ones. Their rank averaged with a horizontal ramp covers the stops evenly.
+        const uint16_t* pPixels = static_cast<const uint16_t*>(image.GetBuffer());
+        std::vector<double> rank( 4097, 0.0);
+        for (size_t i = 0; i < static_cast<size_t>(width) * height; ++i)
+        {
+            rank[std::min<uint16_t>( pPixels[i], 4095) + 1] += 1.0;
+        }
+        for (size_t v = 1; v < rank.size(); ++v)
+        {
+            rank[v] += rank[v - 1];
+        }
+        std::vector<float> radiance( static_cast<size_t>(width) * height);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                const size_t i = static_cast<size_t>(y) * width + x;
+                const double level = (rank[std::min<uint16_t>( pPixels[i], 4095)] / radiance.size() + static_cast<double>(x) / width) / 2.0;
+                radiance[i] = static_cast<float>(maxRadiance * std::pow( 2.0, (level - 1.0) * 14.0));
+            }
+        }
+
+        std::vector< std::vector<uint16_t> > frames( frameCount);
+        std::vector<Pylon::SHdrFrame> hdrFrames( frameCount);
+        for (size_t i = 0; i < frameCount; ++i)
+        {
+            hdrFrames[i].PixelType = Pylon::PixelType_Mono12;
+            hdrFrames[i].Width = width;
+            hdrFrames[i].Height = height;
+            hdrFrames[i].ExposureTime = exposuresMs[i] * 1e3;
+        }
+
+        std::mt19937 random( 12345);
+        for (int noisy = 0; noisy < 2; ++noisy)
+        {
+            for (size_t i = 0; i < frameCount; ++i)
+            {
+                ExposeRadiance( radiance, exposuresMs[i], settings, noisy != 0 ? &random : NULL, frames[i]);
+                hdrFrames[i].pBuffer = &frames[i][0];
+            }
+            Pylon::CHdrMerger merger( settings);
+            merger.Merge( hdrFrames);
+            const float* pMerged = merger.GetRadiance();
+
+            double maxError = 0.0;
+            double errorSum = 0.0;
+            double normalizedSquareSum = 0.0;
+            size_t checkedCount = 0;
+            size_t saturatedCount = 0;
+            for (size_t p = 0; p < radiance.size(); ++p)
+            {
+                const double expected = radiance[p] * maxExposureMs;
+                const double error = pMerged[p] - expected;
+                if (expected + settings.BlackLevel >= settings.SaturationLevel)
+                {
+                    ++saturatedCount;
+                }
+                if (noisy == 0)
+                {
+                    if (expected >= 64.0)
+                    {
+                        maxError = std::max( maxError, std::abs( error) / expected);
+                        errorSum += std::abs( error) / expected;
+                        ++checkedCount;
+                    }
+                    continue;
+                }
+                // The variance of the ideal average of the frames that are not saturated, on the scale of the longest exposure.
+                double inverseVariance = 0.0;
+                for (size_t i = 0; i < frameCount; ++i)
+                {
+                    const double signal = radiance[p] * exposuresMs[i];
+                    if (signal + settings.BlackLevel < settings.SaturationLevel)
+                    {
+                        const double scale = maxExposureMs / exposuresMs[i];
+                        inverseVariance += 1.0 / (scale * scale * (settings.ConversionGain * signal + settings.ReadNoise * settings.ReadNoise));
+                    }
+                }
+                normalizedSquareSum += error * error * inverseVariance;
+                ++checkedCount;
+            }
+
+            // The rounding to DN bounds the exact error, the noisy merge must be about as good as the ideal average.
+            const double meanError = errorSum / std::max<size_t>( checkedCount, 1);
+            const double rmsErrorVsIdeal = std::sqrt( normalizedSquareSum / std::max<size_t>( checkedCount, 1));
+            if (noisy == 0 && (!(maxError <= 0.02) || !(meanError <= 0.005)))
+            {
+                throw RUNTIME_EXCEPTION( "The merge without noise has a relative error of %g, %g on average.", maxError, meanError);
+            }
+            if (noisy != 0 && !(rmsErrorVsIdeal <= 1.2))
+            {
+                throw RUNTIME_EXCEPTION( "The error of the noisy merge is %g times the one of the ideal average.", rmsErrorVsIdeal);
+            }
+
+            SBenchmarkResult result;
+            result.Benchmark = "hdr";
+            result.Case = noisy != 0 ? "noisy" : "exact";
+            result.Add( "frames", static_cast<double>(frameCount))
+                .Add( "dynamic_range", merger.GetMaxRadiance() / settings.ReadNoise);
+            if (noisy == 0)
+            {
+                result.Add( "max_rel_error", maxError)
+                    .Add( "mean_rel_error", meanError);
+            }
+            else
+            {
+                result.Add( "rms_error_vs_ideal", rmsErrorVsIdeal);
+            }
+            result.Add( "saturated_share", static_cast<double>(saturatedCount) / radiance.size());
+            report.Add( result);
+        }
+
+        const unsigned int threadCounts[] = { 1, 0 };
+        for (size_t t = 0; t < sizeof( threadCounts) / sizeof( threadCounts[0]); ++t)
+        {
+            Pylon::SHdrMergeSettings timedSettings = settings;
+            timedSettings.NumThreads = threadCounts[t];
+            Pylon::CHdrMerger merger( timedSettings);
+
+            // The first merge allocates the result.
+            merger.Merge( hdrFrames);
+            CStopwatch stopwatch;
+            for (uint32_t r = 0; r < repeat; ++r)
+            {
+                merger.Merge( hdrFrames);
+            }
+            const double seconds = stopwatch.GetSeconds() / repeat;
+
+            const unsigned int numThreads = threadCounts[t] != 0 ? threadCounts[t] : std::thread::hardware_concurrency();
+            SBenchmarkResult result;
+            result.Benchmark = "hdr";
+            result.Case = threadCounts[t] == 1 ? "merge 1 thread" : "merge all threads";
+            result.Add( "threads", static_cast<double>(numThreads))
+                .Add( "ms_per_merge", seconds * 1e3)
+                .Add( "input_fps", frameCount / seconds)
+                .Add( "burst_ratio", frameCount / seconds / frameRate)
+                .Add( "checksum", merger.GetRadiance()[radiance.size() / 2]);
+            report.Add( result);
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHHDR_H_4427180 */
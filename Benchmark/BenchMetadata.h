@@ -0,0 +1,207 @@
+// Contains the benchmark and the check of the frame metadata log.
+/*
+   The records of a run at 14 fps are appended to a CFrameMetadataWriter of include/FrameMetadataLog.h
+   and queried with a CFrameMetadataReader:
+       append      the time per record, the log being written block by block, and the bytes per record
+       reopen      the log is opened again and continued, the records must follow the earlier ones
+       query       the frames within windows of 1 to 60 s at random positions, found by the binary search
+                   of FindFrames() or by reading the host times of all records, as a scan of the file
+                   names or a CSV would
+   Both queries must find the same frames and the records must read back as written, including a record
+   appended with an earlier time, which gets the time of the previous record.
+   Options: -frames <n> (default 1000000), -queries <n> (default 1000), -dir <directory of the log>
+   (default the current directory), -keep.
+*/
+
+#ifndef INCLUDED_BENCHMETADATA_H_2718450
+#define INCLUDED_BENCHMETADATA_H_2718450
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "BenchStorage.h"
+#include "BenchTimeSeries.h"
+#include "../include/FrameMetadataLog.h"
+
+#include <random>
+
+namespace Benchmark
+{
+    // The record of frame f of the benchmark.
+    inline Pylon::SFrameMetadata GetBenchmarkFrameMetadata( size_t f)
+    {
+        Pylon::SFrameMetadata metadata;
+        metadata.HostTime = 1700000000000000000LL + static_cast<int64_t>(f) * 71428571;
+        metadata.CameraTime = static_cast<int64_t>(f) * 71428571 + 12345;
+        metadata.FrameCounter = f + 1;
+        metadata.ExposureTime = 10000.0 + f % 7;
+        metadata.Gain = 3.0;
+        metadata.ChunkExposureTime = metadata.ExposureTime - 0.5;
+        metadata.ChunkGain = f % 2 == 0 ? 3.0 : std::numeric_limits<double>::quiet_NaN();
+        metadata.Burst = static_cast<uint32_t>(f / 15 + 1);
+        metadata.FrameIndex = static_cast<uint32_t>(f % 15);
+        metadata.CrcStatus = f % 1000 == 999 ? Pylon::FrameCrcStatus_Failed : Pylon::FrameCrcStatus_Ok;
+        return metadata;
+    }
+
+    inline bool IsSameFrameMetadata( const Pylon::SFrameMetadata& a, const Pylon::SFrameMetadata& b)
+    {
+        // NaN compares unequal to itself.
+        return a.HostTime == b.HostTime && a.CameraTime == b.CameraTime && a.FrameCounter == b.FrameCounter && a.ExposureTime == b.ExposureTime
+            && a.Gain == b.Gain && a.ChunkExposureTime == b.ChunkExposureTime && (a.ChunkGain == b.ChunkGain || (a.ChunkGain != a.ChunkGain && b.ChunkGain != b.ChunkGain))
+            && a.Burst == b.Burst && a.FrameIndex == b.FrameIndex && a.CrcStatus == b.CrcStatus;
+    }
+
+    inline void RunMetadataBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace Pylon;
+
+        const char* value = NULL;
+        const size_t frameCount = (value = GetCommandLineOption( argc, argv, "-frames")) != NULL ? std::max( 2, atoi( value)) : 1000000;
+        const size_t queryCount = (value = GetCommandLineOption( argc, argv, "-queries")) != NULL ? std::max( 1, atoi( value)) : 1000;
+        const std::string directory = (value = GetCommandLineOption( argc, argv, "-dir")) != NULL ? value : ".";
+        const std::string fileName = directory + "/bench-metadata.meta";
+        remove( fileName.c_str());
+
+        // The first half, then the second half after opening the log again. The frame in the middle has an earlier time.
+        const size_t outOfOrderFrame = frameCount / 2 + 1;
+        std::vector<double> nsPerRecord;
+        size_t reopenedCount = 0;
+        {
+            CFrameMetadataWriter writer;
+            CStopwatch stopwatch;
+            writer.Open( fileName, "21234567");
+            for (size_t f = 0; f < frameCount / 2; ++f)
+            {
+                writer.Append( GetBenchmarkFrameMetadata( f));
+            }
+            writer.Close();
+            nsPerRecord.push_back( stopwatch.GetSeconds() / (frameCount / 2) * 1e9);
+
+            stopwatch.Restart();
+            writer.Open( fileName, "21234567");
+            reopenedCount = writer.GetRecordCount();
+            for (size_t f = frameCount / 2; f < frameCount; ++f)
+            {
+                SFrameMetadata metadata = GetBenchmarkFrameMetadata( f);
+                if (f == outOfOrderFrame)
+                {
+                    metadata.HostTime -= 1000000000;
+                }
+                writer.Append( metadata);
+            }
+            writer.Close();
+            nsPerRecord.push_back( stopwatch.GetSeconds() / (frameCount - frameCount / 2) * 1e9);
+        }
+        if (reopenedCount != frameCount / 2)
+        {
+            throw RUNTIME_EXCEPTION( "The reopened log has %u records instead of %u.", static_cast<unsigned int>(reopenedCount), static_cast<unsigned int>(frameCount / 2));
+        }
+
+        CStopwatch openStopwatch;
+        CFrameMetadataReader reader( fileName);
+        const double openSeconds = openStopwatch.GetSeconds();
+        if (reader.GetRecordCount() != frameCount || reader.GetSerialNumber() != "21234567")
+        {
+            throw RUNTIME_EXCEPTION( "The log has %u records of %s.", static_cast<unsigned int>(reader.GetRecordCount()), reader.GetSerialNumber().c_str());
+        }
+        for (size_t f = 0; f < frameCount; ++f)
+        {
+            SFrameMetadata expected = GetBenchmarkFrameMetadata( f);
+            if (f == outOfOrderFrame)
+            {
+                expected.HostTime = GetBenchmarkFrameMetadata( f - 1).HostTime;
+            }
+            if (!IsSameFrameMetadata( reader.GetRecord( f), expected))
+            {
+                throw RUNTIME_EXCEPTION( "Record %u of the log differs from the one appended.", static_cast<unsigned int>(f));
+            }
+        }
+
+        // Windows of 1 to 60 s, starting anywhere in the run and up to 10 s before or after it.
+        std::mt19937 random( 2718);
+        const int64_t runStart = reader.GetHostTime( 0);
+        const int64_t runEnd = reader.GetHostTime( frameCount - 1);
+        std::uniform_int_distribution<int64_t> starts( runStart - 10000000000LL, runEnd + 10000000000LL);
+        std::uniform_int_distribution<int64_t> lengths( 1000000000LL, 60000000000LL);
+        std::vector<int64_t> windowStarts( queryCount);
+        std::vector<int64_t> windowEnds( queryCount);
+        for (size_t q = 0; q < queryCount; ++q)
+        {
+            windowStarts[q] = starts( random);
+            windowEnds[q] = windowStarts[q] + lengths( random);
+        }
+
+        std::vector<double> searchSeconds;
+        std::vector<double> scanSeconds;
+        size_t foundCount = 0;
+        for (size_t q = 0; q < queryCount; ++q)
+        {
+            CStopwatch stopwatch;
+            size_t first = 0;
+            size_t last = 0;
+            reader.FindFrames( windowStarts[q], windowEnds[q], first, last);
+            searchSeconds.push_back( stopwatch.GetSeconds());
+
+            stopwatch.Restart();
+            size_t scanFirst = frameCount;
+            size_t scanLast = 0;
+            for (size_t f = 0; f < frameCount; ++f)
+            {
+                const int64_t hostTime = reader.GetHostTime( f);
+                if (hostTime >= windowStarts[q] && hostTime <= windowEnds[q])
+                {
+                    scanFirst = std::min( scanFirst, f);
+                    scanLast = f + 1;
+                }
+            }
+            scanSeconds.push_back( stopwatch.GetSeconds());
+            if (scanLast == 0)
+            {
+                scanFirst = scanLast = first;
+            }
+            if (first != scanFirst || last != scanLast)
+            {
+                throw RUNTIME_EXCEPTION( "The binary search found the frames [%u, %u) instead of [%u, %u).", static_cast<unsigned int>(first),
+                    static_cast<unsigned int>(last), static_cast<unsigned int>(scanFirst), static_cast<unsigned int>(scanLast));
+            }
+            foundCount += last - first;
+        }
+        const double fileMegabytes = GetFileMegabytes( fileName);
+        reader.Close();
+        if (!HasCommandLineFlag( argc, argv, "-keep"))
+        {
+            remove( fileName.c_str());
+        }
+
+        SBenchmarkResult appendResult;
+        appendResult.Benchmark = "metadata";
+        appendResult.Case = "append";
+        appendResult.Add( "records", static_cast<double>(frameCount))
+            .Add( "ns_per_record", GetPercentile( nsPerRecord, 50.0))
+            .Add( "bytes_per_record", fileMegabytes * 1048576.0 / frameCount)
+            .Add( "open_ms", openSeconds * 1e3);
+        report.Add( appendResult);
+
+        const double medianScan = GetPercentile( scanSeconds, 50.0);
+        const double medianSearch = GetPercentile( searchSeconds, 50.0);
+        SBenchmarkResult scanResult;
+        scanResult.Benchmark = "metadata";
+        scanResult.Case = "query scan";
+        scanResult.Add( "queries", static_cast<double>(queryCount))
+            .Add( "us_per_query", medianScan * 1e6)
+            .Add( "speedup", 1.0)
+            .Add( "frames_found", static_cast<double>(foundCount));
+        report.Add( scanResult);
+
+        SBenchmarkResult searchResult;
+        searchResult.Benchmark = "metadata";
+        searchResult.Case = "query search";
+        searchResult.Add( "queries", static_cast<double>(queryCount))
+            .Add( "us_per_query", medianSearch * 1e6)
+            .Add( "speedup", medianSearch > 0.0 ? medianScan / medianSearch : 0.0)
+            .Add( "frames_found", static_cast<double>(foundCount));
+        report.Add( searchResult);
+    }
+}
+
+#endif /* INCLUDED_BENCHMETADATA_H_2718450 */
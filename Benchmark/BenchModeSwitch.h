@@ -0,0 +1,333 @@
+// Contains the benchmark of the switch between preview and burst.
+/*
+   Two synthetic frame sources switch repeatedly from free-running preview to a triggered burst and back,
+   once the way Grab_StateMachine did it before, stopping and restarting the grab with the other trigger
+   configuration, and once with CAcquisitionModeSwitch of include/AcquisitionModeSwitch.h, which keeps
+   the grab running and toggles TriggerMode. The sources emulate the time a camera takes to start and to
+   stop grabbing and to write a parameter. These latencies are measured first on the pylon camera
+   emulator, enabled by Benchmark.cpp, and reported as the emulator case. The switch itself cannot run on
+   the emulator: CAcquisitionModeSwitch needs the USB camera parameters, TimestampLatch among them, and
+   the Timestamp chunk, which the emulator does not provide.
+
+   Reported are the medians over the cycles of the time until all cameras accept triggers, until the
+   first burst frame of every camera arrived and, after the burst, until the first preview frame of every
+   camera arrived, counted from the request to switch. Preview frames still arriving after the switch to
+   the burst are counted as stale frames, the live switch rejects them by their time stamp.
+   Options: -cameras <n> (default 2), -size <width>x<height> (default 640x480), -fps <rate> (default 30),
+   -repeat <n> cycles (default 5), -burst <n> frames (default 5), -start-latency <ms>, -stop-latency <ms>
+   and -write-latency <us> instead of the latencies measured on the emulator, e.g. 150, 50 and 1000 for a
+   USB camera.
+*/
+
+#ifndef INCLUDED_BENCHMODESWITCH_H_1935727
+#define INCLUDED_BENCHMODESWITCH_H_1935727
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "../include/SyntheticFrameSource.h"
+#include "../include/AcquisitionModeSwitch.h"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace Benchmark
+{
+    // Records the arrival of the frames and classifies them as preview or burst frames.
+    class CModeSwitchBenchmarkHandler : public Pylon::CSyntheticImageEventHandler
+    {
+    public:
+        CModeSwitchBenchmarkHandler( size_t cameraCount, Pylon::CAcquisitionModeSwitch<Pylon::CSyntheticFrameSourceArray>* pModeSwitch)
+            : m_pModeSwitch( pModeSwitch)
+            , m_isBurst( false)
+            , m_previewFrames( cameraCount, 0)
+            , m_burstFrames( cameraCount, 0)
+            , m_staleFrames( 0)
+        {
+        }
+
+        // Starts counting the frames of a burst or of the preview.
+        void Reset( bool isBurst)
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            m_isBurst = isBurst;
+            m_previewFrames.assign( m_previewFrames.size(), 0);
+            m_burstFrames.assign( m_burstFrames.size(), 0);
+        }
+
+        virtual void OnImageGrabbed( Pylon::CSyntheticFrameSource& camera, const Pylon::CSyntheticGrabResultPtr& ptrGrabResult)
+        {
+            const size_t index = static_cast<size_t>(camera.GetCameraContext());
+            // Without the mode switch the grab is restarted, every frame of a triggered grab is a burst frame.
+            const bool isTriggered = m_pModeSwitch != NULL
+                ? m_pModeSwitch->IsTriggeredFrame( index, static_cast<int64_t>(ptrGrabResult->GetTimeStamp()))
+                : camera.TriggerMode.GetValue() == Basler_UsbCameraParams::TriggerMode_On;
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                if (m_isBurst && isTriggered)
+                {
+                    ++m_burstFrames[index];
+                }
+                else if (m_isBurst)
+                {
+                    ++m_staleFrames;
+                }
+                else
+                {
+                    ++m_previewFrames[index];
+                }
+            }
+            m_condition.notify_all();
+        }
+
+        // Waits until every camera delivered at least count frames of the current kind. Returns false on timeout.
+        bool WaitForFrames( size_t count, unsigned int timeoutMs)
+        {
+            std::unique_lock<std::mutex> lock( m_lock);
+            return m_condition.wait_for( lock, std::chrono::milliseconds( timeoutMs), [this, count]()
+            {
+                const std::vector<size_t>& frames = m_isBurst ? m_burstFrames : m_previewFrames;
+                return *std::min_element( frames.begin(), frames.end()) >= count;
+            });
+        }
+
+        size_t GetStaleFrames() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_staleFrames;
+        }
+
+    private:
+        Pylon::CAcquisitionModeSwitch<Pylon::CSyntheticFrameSourceArray>* m_pModeSwitch;
+        mutable std::mutex m_lock;
+        std::condition_variable m_condition;
+        bool m_isBurst;
+        std::vector<size_t> m_previewFrames;
+        std::vector<size_t> m_burstFrames;
+        size_t m_staleFrames;
+    };
+
+    // Triggers a burst on all cameras and waits for it. Returns the time until the first frame of every camera arrived.
+    inline double TriggerModeSwitchBurst( Pylon::CSyntheticFrameSourceArray& cameras, CModeSwitchBenchmarkHandler& handler,
+        uint32_t burstFrames, const CStopwatch& stopwatch)
+    {
+        double firstFrameSeconds = 0.0;
+        for (uint32_t j = 0; j < burstFrames; ++j)
+        {
+            for (size_t i = 0; i < cameras.GetSize(); ++i)
+            {
+                cameras[i].WaitForFrameTriggerReady( 1000, Pylon::TimeoutHandling_ThrowException);
+                cameras[i].ExecuteSoftwareTrigger();
+            }
+            if (j == 0)
+            {
+                if (!handler.WaitForFrames( 1, 5000))
+                {
+                    throw RUNTIME_EXCEPTION( "The first burst frame did not arrive.");
+                }
+                firstFrameSeconds = stopwatch.GetSeconds();
+            }
+        }
+        if (!handler.WaitForFrames( burstFrames, 5000))
+        {
+            throw RUNTIME_EXCEPTION( "The burst frames did not arrive.");
+        }
+        return firstFrameSeconds;
+    }
+
+    // Measures on the camera emulator the medians of the time StartGrabbing and StopGrabbing take and of
+    // the time a write of TriggerMode takes while grabbing. The write latency stays 0 if the emulator has no TriggerMode.
+    inline void MeasureEmulatorLatencies( uint32_t repeat, double& startLatencyMs, double& stopLatencyMs, double& writeLatencyUs)
+    {
+        using namespace Pylon;
+
+        CDeviceInfo info;
+        info.SetDeviceClass( "BaslerCamEmu");
+        CInstantCamera camera( CTlFactory::GetInstance().CreateFirstDevice( info));
+        camera.Open();
+        const GenApi::CEnumerationPtr triggerMode( camera.GetNodeMap().GetNode( "TriggerMode"));
+        const bool isWritable = triggerMode.IsValid() && GenApi::IsWritable( triggerMode);
+        const uint32_t writeCount = 10;
+
+        std::vector<double> startMs;
+        std::vector<double> stopMs;
+        std::vector<double> writeUs;
+        for (uint32_t r = 0; r < repeat; ++r)
+        {
+            CStopwatch stopwatch;
+            camera.StartGrabbing( GrabStrategy_OneByOne, GrabLoop_ProvidedByUser);
+            startMs.push_back( stopwatch.GetSeconds() * 1e3);
+            if (isWritable)
+            {
+                stopwatch.Restart();
+                for (uint32_t w = 0; w < writeCount; ++w)
+                {
+                    triggerMode->FromString( w % 2 == 0 ? "On" : "Off");
+                }
+                writeUs.push_back( stopwatch.GetSeconds() / writeCount * 1e6);
+            }
+            stopwatch.Restart();
+            camera.StopGrabbing();
+            stopMs.push_back( stopwatch.GetSeconds() * 1e3);
+        }
+        camera.Close();
+
+        startLatencyMs = GetPercentile( startMs, 50.0);
+        stopLatencyMs = GetPercentile( stopMs, 50.0);
+        writeLatencyUs = writeUs.empty() ? 0.0 : GetPercentile( writeUs, 50.0);
+    }
+
+    inline void RunModeSwitchBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace Pylon;
+
+        const char* value = NULL;
+        const size_t cameraCount = (value = GetCommandLineOption( argc, argv, "-cameras")) != NULL ? std::max( 1, atoi( value)) : 2;
+        const uint32_t repeat = GetBenchmarkRepeat( argc, argv, 5);
+        const uint32_t burstFrames = (value = GetCommandLineOption( argc, argv, "-burst")) != NULL ? std::max( 1, atoi( value)) : 5;
+
+        SSyntheticFrameSourceSettings settings;
+        settings.Width = 640;
+        settings.Height = 480;
+        if (GetCommandLineOption( argc, argv, "-size") != NULL)
+        {
+            GetBenchmarkFrameSize( argc, argv, settings.Width, settings.Height);
+        }
+        settings.FrameRate = (value = GetCommandLineOption( argc, argv, "-fps")) != NULL ? atof( value) : 30.0;
+        settings.CycleLength = 1;
+
+        double emulatorStartMs = 0.0;
+        double emulatorStopMs = 0.0;
+        double emulatorWriteUs = 0.0;
+        MeasureEmulatorLatencies( repeat, emulatorStartMs, emulatorStopMs, emulatorWriteUs);
+        {
+            SBenchmarkResult result;
+            result.Benchmark = "switch";
+            result.Case = "emulator";
+            result.Add( "start_ms", emulatorStartMs)
+                .Add( "stop_ms", emulatorStopMs)
+                .Add( "write_us", emulatorWriteUs);
+            report.Add( result);
+        }
+        settings.StartLatencyMs = (value = GetCommandLineOption( argc, argv, "-start-latency")) != NULL ? atof( value) : emulatorStartMs;
+        settings.StopLatencyMs = (value = GetCommandLineOption( argc, argv, "-stop-latency")) != NULL ? atof( value) : emulatorStopMs;
+        settings.WriteLatencyUs = (value = GetCommandLineOption( argc, argv, "-write-latency")) != NULL ? atof( value) : emulatorWriteUs;
+
+        for (int isLive = 0; isLive < 2; ++isLive)
+        {
+            CSyntheticFrameSourceArray cameras( cameraCount, settings);
+            std::vector<CCameraParameterCache*> caches;
+            for (size_t i = 0; i < cameraCount; ++i)
+            {
+                caches.push_back( new CCameraParameterCache());
+            }
+            CAcquisitionModeSwitch<CSyntheticFrameSourceArray> modeSwitch( cameras, caches);
+            CModeSwitchBenchmarkHandler* pHandler = new CModeSwitchBenchmarkHandler( cameraCount, isLive ? &modeSwitch : NULL);
+            for (size_t i = 0; i < cameraCount; ++i)
+            {
+                // The handler is shared, only the first registration deletes it.
+                cameras[i].RegisterImageEventHandler( pHandler, RegistrationMode_Append, i == 0 ? Cleanup_Delete : Cleanup_None);
+                cameras[i].Open();
+            }
+
+            // Preview, as before in Grab_StateMachine with two buffers or live with buffers for the burst.
+            pHandler->Reset( false);
+            for (size_t i = 0; i < cameraCount; ++i)
+            {
+                cameras[i].MaxNumBuffer = static_cast<int>(isLive ? burstFrames + 2 : 2);
+                if (isLive)
+                {
+                    ConfigureSoftwareTrigger( cameras[i]);
+                    caches[i]->Write( "TriggerMode", cameras[i].TriggerMode, Basler_UsbCameraParams::TriggerMode_Off);
+                }
+                else
+                {
+                    ConfigureContinuousAcquisition( cameras[i]);
+                }
+                cameras[i].StartGrabbing( GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+            }
+            pHandler->WaitForFrames( 2, 5000);
+
+            std::vector<double> toBurstMs;
+            std::vector<double> firstBurstFrameMs;
+            std::vector<double> toPreviewMs;
+            for (uint32_t r = 0; r < repeat; ++r)
+            {
+                // Preview to burst. After a restart no preview frames can arrive any more.
+                CStopwatch stopwatch;
+                if (isLive)
+                {
+                    pHandler->Reset( true);
+                    modeSwitch.SwitchToTriggered();
+                }
+                else
+                {
+                    cameras.StopGrabbing();
+                    pHandler->Reset( true);
+                    for (size_t i = 0; i < cameraCount; ++i)
+                    {
+                        cameras[i].Open();
+                        cameras[i].GainAuto.SetValue( Basler_UsbCameraParams::GainAuto_Off);
+                        cameras[i].Gain.SetValue( 0.0);
+                        cameras[i].ExposureTime.SetValue( 10000.0);
+                        cameras[i].MaxNumBuffer = static_cast<int>(burstFrames);
+                        ConfigureSoftwareTrigger( cameras[i]);
+                        cameras[i].StartGrabbing( burstFrames, GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+                    }
+                }
+                for (size_t i = 0; i < cameraCount; ++i)
+                {
+                    cameras[i].WaitForFrameTriggerReady( 1000, TimeoutHandling_ThrowException);
+                }
+                toBurstMs.push_back( stopwatch.GetSeconds() * 1e3);
+                firstBurstFrameMs.push_back( TriggerModeSwitchBurst( cameras, *pHandler, burstFrames, stopwatch) * 1e3);
+
+                // Burst to preview.
+                stopwatch.Restart();
+                pHandler->Reset( false);
+                if (isLive)
+                {
+                    modeSwitch.SwitchToFreeRun();
+                }
+                else
+                {
+                    for (size_t i = 0; i < cameraCount; ++i)
+                    {
+                        cameras[i].StopGrabbing();
+                        cameras[i].Open();
+                        cameras[i].GainAuto.SetValue( Basler_UsbCameraParams::GainAuto_Off);
+                        cameras[i].Gain.SetValue( 0.0);
+                        cameras[i].ExposureTime.SetValue( 10000.0);
+                        cameras[i].MaxNumBuffer = 2;
+                        ConfigureContinuousAcquisition( cameras[i]);
+                        cameras[i].StartGrabbing( GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+                    }
+                }
+                if (!pHandler->WaitForFrames( 1, 5000))
+                {
+                    throw RUNTIME_EXCEPTION( "The first preview frame did not arrive.");
+                }
+                toPreviewMs.push_back( stopwatch.GetSeconds() * 1e3);
+                // Some preview frames before the next switch, as in the sample.
+                pHandler->WaitForFrames( 3, 5000);
+            }
+            cameras.StopGrabbing();
+
+            SBenchmarkResult result;
+            result.Benchmark = "switch";
+            result.Case = isLive ? "live trigger mode switch" : "restart grab";
+            result.Add( "cameras", static_cast<double>(cameraCount))
+                .Add( "to_burst_ms", GetPercentile( toBurstMs, 50.0))
+                .Add( "first_burst_frame_ms", GetPercentile( firstBurstFrameMs, 50.0))
+                .Add( "to_preview_ms", GetPercentile( toPreviewMs, 50.0))
+                .Add( "stale_frames", static_cast<double>(pHandler->GetStaleFrames()));
+            report.Add( result);
+
+            for (size_t i = 0; i < cameraCount; ++i)
+            {
+                delete caches[i];
+            }
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHMODESWITCH_H_1935727 */
@@ -0,0 +1,179 @@
+// Contains the benchmark of the node access by name and through CameraNodeAccess.h.
+/*
+   The nodes are read from the pylon camera emulator, enabled by Benchmark.cpp, whose node map is like
+   the one of a camera. For every frame the image AOI and the pixel format of the camera and the
+   ChunkTimestamp of a grab result are read:
+       camera string   CIntegerPtr( control.GetNode( "Width")) and so on for the AOI and the pixel format
+       camera cached   CAoiNodesT of include/CameraNodeAccess.h, looked up once
+       chunk string    CIntegerPtr( ptrGrabResult->GetChunkDataNodeMap().GetNode( "ChunkTimestamp"))
+       chunk cached    CChunkIntegerNodeCache, looked up once per buffer
+   The chunk cases cycle through the grab results of as many buffers as Grab_StateMachine uses for a
+   burst. Reported are the time per frame, the speedup over the lookup by name and, for the chunk cache,
+   the lookups by name done. Both ways must read the same values. The chunk cases are skipped if the
+   emulator has no chunk features.
+   Options: -frames <n> (default 1000000), -repeat <n> (default 5).
+*/
+
+#ifndef INCLUDED_BENCHNODES_H_6402957
+#define INCLUDED_BENCHNODES_H_6402957
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "../include/CameraNodeAccess.h"
+#include "../include/FrameSourceSelection.h"
+
+namespace Benchmark
+{
+    // Reads the image AOI and the pixel format by name, as the samples did.
+    inline int64_t ReadAoiByName( GenApi::INodeMap& control)
+    {
+        const GenApi::CIntegerPtr width( control.GetNode( "Width"));
+        const GenApi::CIntegerPtr height( control.GetNode( "Height"));
+        const GenApi::CIntegerPtr offsetX( control.GetNode( "OffsetX"));
+        const GenApi::CIntegerPtr offsetY( control.GetNode( "OffsetY"));
+        const GenApi::CEnumerationPtr pixelFormat( control.GetNode( "PixelFormat"));
+        return width->GetValue() + height->GetValue() + offsetX->GetValue() + offsetY->GetValue() + pixelFormat->GetIntValue();
+    }
+
+    inline void AddNodeResult( CBenchmarkReport& report, const char* benchmarkCase, size_t frameCount, const std::vector<double>& nsPerFrame,
+        double referenceNsPerFrame, int64_t checksum, double lookupCount)
+    {
+        const double medianNsPerFrame = GetPercentile( nsPerFrame, 50.0);
+        SBenchmarkResult result;
+        result.Benchmark = "nodes";
+        result.Case = benchmarkCase;
+        result.Add( "frames", static_cast<double>(frameCount))
+            .Add( "ns_per_frame", medianNsPerFrame)
+            .Add( "speedup", referenceNsPerFrame > 0.0 ? referenceNsPerFrame / medianNsPerFrame : 1.0)
+            .Add( "lookups", lookupCount)
+            .Add( "checksum", static_cast<double>(checksum % 1000000));
+        report.Add( result);
+    }
+
+    inline void RunNodeBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace Pylon;
+
+        const char* value = NULL;
+        const size_t frameCount = (value = GetCommandLineOption( argc, argv, "-frames")) != NULL ? std::max( 1, atoi( value)) : 1000000;
+        const uint32_t repeat = GetBenchmarkRepeat( argc, argv, 5);
+        const size_t bufferCount = 17;
+
+        CDeviceInfo info;
+        info.SetDeviceClass( "BaslerCamEmu");
+        CInstantCamera camera( CTlFactory::GetInstance().CreateFirstDevice( info));
+        camera.Open();
+        GenApi::INodeMap& control = camera.GetNodeMap();
+
+        // The image AOI and the pixel format.
+        {
+            std::vector<double> stringNsPerFrame;
+            int64_t stringChecksum = 0;
+            for (uint32_t r = 0; r < repeat; ++r)
+            {
+                stringChecksum = 0;
+                CStopwatch stopwatch;
+                for (size_t f = 0; f < frameCount; ++f)
+                {
+                    stringChecksum += ReadAoiByName( control);
+                }
+                stringNsPerFrame.push_back( stopwatch.GetSeconds() / frameCount * 1e9);
+            }
+
+            std::vector<double> cachedNsPerFrame;
+            int64_t cachedChecksum = 0;
+            CAoiNodesT<CInstantCamera> aoi;
+            aoi.Resolve( camera);
+            for (uint32_t r = 0; r < repeat; ++r)
+            {
+                cachedChecksum = 0;
+                CStopwatch stopwatch;
+                for (size_t f = 0; f < frameCount; ++f)
+                {
+                    cachedChecksum += aoi.GetWidth() + aoi.GetHeight() + aoi.GetOffsetX() + aoi.GetOffsetY() + aoi.GetPixelFormat();
+                }
+                cachedNsPerFrame.push_back( stopwatch.GetSeconds() / frameCount * 1e9);
+            }
+            if (cachedChecksum != stringChecksum)
+            {
+                throw RUNTIME_EXCEPTION( "The cached AOI nodes read other values than the nodes looked up by name.");
+            }
+
+            AddNodeResult( report, "camera string", frameCount, stringNsPerFrame, 0.0, stringChecksum, 5.0 * frameCount);
+            AddNodeResult( report, "camera cached", frameCount, cachedNsPerFrame, GetPercentile( stringNsPerFrame, 50.0), cachedChecksum, 5.0);
+        }
+
+        // The ChunkTimestamp of the grab results.
+        const GenApi::CBooleanPtr chunkModeActive( control.GetNode( "ChunkModeActive"));
+        if (!chunkModeActive.IsValid() || !GenApi::IsWritable( chunkModeActive))
+        {
+            return;
+        }
+        chunkModeActive->SetValue( true);
+        GenApi::CEnumerationPtr( control.GetNode( "ChunkSelector"))->FromString( "Timestamp");
+        GenApi::CBooleanPtr( control.GetNode( "ChunkEnable"))->SetValue( true);
+
+        camera.MaxNumBuffer = static_cast<int>(bufferCount);
+        camera.StartGrabbing( bufferCount);
+        std::vector<CGrabResultPtr> grabResults;
+        while (grabResults.size() < bufferCount && camera.IsGrabbing())
+        {
+            CGrabResultPtr ptrGrabResult;
+            camera.RetrieveResult( 5000, ptrGrabResult, TimeoutHandling_ThrowException);
+            grabResults.push_back( ptrGrabResult);
+        }
+        if (grabResults.empty())
+        {
+            camera.StopGrabbing();
+            throw RUNTIME_EXCEPTION( "The camera emulator delivered no frames.");
+        }
+
+        std::vector<double> stringNsPerFrame;
+        int64_t stringChecksum = 0;
+        for (uint32_t r = 0; r < repeat; ++r)
+        {
+            stringChecksum = 0;
+            CStopwatch stopwatch;
+            for (size_t f = 0; f < frameCount; ++f)
+            {
+                const GenApi::CIntegerPtr chunkTimestamp( grabResults[f % grabResults.size()]->GetChunkDataNodeMap().GetNode( "ChunkTimestamp"));
+                if (chunkTimestamp.IsValid() && GenApi::IsReadable( chunkTimestamp))
+                {
+                    stringChecksum += chunkTimestamp->GetValue() + 1;
+                }
+            }
+            stringNsPerFrame.push_back( stopwatch.GetSeconds() / frameCount * 1e9);
+        }
+
+        std::vector<double> cachedNsPerFrame;
+        int64_t cachedChecksum = 0;
+        CChunkIntegerNodeCache chunkTimestamp( "ChunkTimestamp");
+        for (uint32_t r = 0; r < repeat; ++r)
+        {
+            cachedChecksum = 0;
+            CStopwatch stopwatch;
+            for (size_t f = 0; f < frameCount; ++f)
+            {
+                int64_t timestamp = 0;
+                if (chunkTimestamp.TryGetValue( grabResults[f % grabResults.size()], timestamp))
+                {
+                    cachedChecksum += timestamp + 1;
+                }
+            }
+            cachedNsPerFrame.push_back( stopwatch.GetSeconds() / frameCount * 1e9);
+        }
+        grabResults.clear();
+        camera.StopGrabbing();
+        chunkTimestamp.Clear();
+        if (cachedChecksum != stringChecksum)
+        {
+            throw RUNTIME_EXCEPTION( "The cached chunk node read other values than the node looked up by name.");
+        }
+
+        AddNodeResult( report, "chunk string", frameCount, stringNsPerFrame, 0.0, stringChecksum, static_cast<double>(frameCount));
+        AddNodeResult( report, "chunk cached", frameCount, cachedNsPerFrame, GetPercentile( stringNsPerFrame, 50.0), cachedChecksum,
+            static_cast<double>(chunkTimestamp.GetLookupCount()));
+    }
+}
+
+#endif /* INCLUDED_BENCHNODES_H_6402957 */
@@ -0,0 +1,145 @@
+// Contains the benchmark of the preview renderer.
+/*
+   Measures CPreviewRenderer of include/PreviewRenderer.h on synthetic Mono12 and BayerGB12 frames on one
+   thread, binning and sub-sampling by 2 and 4, with auto contrast. As baseline the conversion of the full
+   frame to 8 bits with a lookup table is measured, Mono8 for mono and RGB8 with the color of each Bayer
+   cell repeated over its four pixels for Bayer frames, which is the least a display of the full frame costs.
+
+   Reported are the time per frame and the share of one core the preview takes per camera at the frame
+   rate of the camera, which should stay below 5 %.
+   Options: -size <width>x<height> (default 2592x1944), -repeat <n> (default 20), -fps <rate> (default 14).
+*/
+
+#ifndef INCLUDED_BENCHPREVIEW_H_2174903
+#define INCLUDED_BENCHPREVIEW_H_2174903
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "../include/PreviewRenderer.h"
+
+namespace Benchmark
+{
+    // The full-resolution conversion the renderer is compared with. Returns a checksum to keep the compiler from dropping the loop.
+    inline double ConvertFullFrame( const uint16_t* pPixels, uint32_t width, uint32_t height, bool isBayer, const std::vector<uint8_t>& lut,
+        std::vector<uint8_t>& output)
+    {
+        const size_t channelCount = isBayer ? 3 : 1;
+        output.resize( static_cast<size_t>(width) * height * channelCount);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const uint16_t* pRow = pPixels + static_cast<size_t>(y) * width;
+            uint8_t* pOut = &output[static_cast<size_t>(y) * width * channelCount];
+            if (!isBayer)
+            {
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    pOut[x] = lut[std::min<uint32_t>( pRow[x], 4095)];
+                }
+                continue;
+            }
+            // BayerGB: G B in the even rows, R G in the odd rows.
+            const uint16_t* pCell = pPixels + static_cast<size_t>(y & ~1u) * width;
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                const uint32_t cellX = x & ~1u;
+                const uint32_t g = (pCell[cellX] + pCell[width + cellX + 1] + 1) >> 1;
+                pOut[3 * x] = lut[std::min<uint32_t>( pCell[width + cellX], 4095)];
+                pOut[3 * x + 1] = lut[std::min<uint32_t>( g, 4095)];
+                pOut[3 * x + 2] = lut[std::min<uint32_t>( pCell[cellX + 1], 4095)];
+            }
+        }
+        return output[output.size() / 2];
+    }
+
+    inline void RunPreviewBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace SampleImageCreator;
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        GetBenchmarkFrameSize( argc, argv, width, height);
+        const uint32_t repeat = GetBenchmarkRepeat( argc, argv, 20);
+        const char* fpsValue = Pylon::GetCommandLineOption( argc, argv, "-fps");
+        const double frameRate = fpsValue != NULL ? atof( fpsValue) : 14.0;
+
+        struct SPreviewCase
+        {
+            const char* Name;
+            uint32_t Decimation;
+            Pylon::EPreviewReduction Reduction;
+        };
+        const SPreviewCase cases[] =
+        {
+            { "bin 2", 2, Pylon::PreviewReduction_Binning },
+            { "bin 4", 4, Pylon::PreviewReduction_Binning },
+            { "subsample 2", 2, Pylon::PreviewReduction_Subsampling },
+            { "subsample 4", 4, Pylon::PreviewReduction_Subsampling }
+        };
+
+        const Pylon::EPixelType pixelTypes[] = { Pylon::PixelType_Mono12, Pylon::PixelType_BayerGB12 };
+        for (size_t p = 0; p < sizeof( pixelTypes) / sizeof( pixelTypes[0]); ++p)
+        {
+            SFractalSettings settings;
+            settings.Width = width;
+            settings.Height = height;
+            settings.PixelType = pixelTypes[p];
+            const Pylon::CPylonImage image = RenderFractal( settings);
+            const std::string pixelTypeName = GetPixelTypeName( pixelTypes[p]);
+            const bool isBayer = Pylon::IsBayer( pixelTypes[p]);
+
+            {
+                std::vector<uint8_t> lut( 4096);
+                for (size_t v = 0; v < lut.size(); ++v)
+                {
+                    lut[v] = static_cast<uint8_t>(255.0 * std::pow( v / 4095.0, 1.0 / 2.2) + 0.5);
+                }
+                std::vector<uint8_t> output;
+                double checksum = 0.0;
+                CStopwatch stopwatch;
+                for (uint32_t r = 0; r < repeat; ++r)
+                {
+                    checksum += ConvertFullFrame( static_cast<const uint16_t*>(image.GetBuffer()), width, height, isBayer, lut, output);
+                }
+                const double seconds = stopwatch.GetSeconds() / repeat;
+
+                SBenchmarkResult result;
+                result.Benchmark = "preview";
+                result.Case = "full frame " + pixelTypeName;
+                result.Add( "ms_per_frame", seconds * 1e3)
+                    .Add( "core_percent", seconds * frameRate * 100.0)
+                    .Add( "output_kb", output.size() / 1024.0)
+                    .Add( "checksum", checksum / repeat);
+                report.Add( result);
+            }
+
+            for (size_t c = 0; c < sizeof( cases) / sizeof( cases[0]); ++c)
+            {
+                Pylon::SPreviewSettings previewSettings;
+                previewSettings.Decimation = cases[c].Decimation;
+                previewSettings.Reduction = cases[c].Reduction;
+                Pylon::CPreviewRenderer renderer( previewSettings);
+
+                // The first frame allocates the buffers.
+                renderer.Render( image.GetBuffer(), pixelTypes[p], width, height, 0);
+                CStopwatch stopwatch;
+                for (uint32_t r = 0; r < repeat; ++r)
+                {
+                    renderer.Render( image.GetBuffer(), pixelTypes[p], width, height, 0);
+                }
+                const double seconds = stopwatch.GetSeconds() / repeat;
+
+                SBenchmarkResult result;
+                result.Benchmark = "preview";
+                result.Case = std::string( cases[c].Name) + " " + pixelTypeName;
+                result.Add( "ms_per_frame", seconds * 1e3)
+                    .Add( "core_percent", seconds * frameRate * 100.0)
+                    .Add( "output_kb", renderer.GetImage().GetImageSize() / 1024.0)
+                    .Add( "black_point", renderer.GetBlackPoint())
+                    .Add( "white_point", renderer.GetWhitePoint());
+                report.Add( result);
+            }
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHPREVIEW_H_2174903 */
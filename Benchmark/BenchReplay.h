@@ -0,0 +1,173 @@
+// Contains the benchmark of the replay of recorded frames.
+/*
+   Records synthetic frames to a frame container and replays them through the image event handler of
+   the synthetic frame source as fast as possible, once with a handler doing nothing and once with a
+   handler reading every pixel, and with the original timing. Reported are the replay frame rate and
+   data rate, the CPU load and, for the original timing, the mean deviation of the delivery intervals
+   from the recorded ones.
+   Options: -dir <dir> (the first directory is used), -frames <n> (default 100), -size <width>x<height>.
+*/
+
+#ifndef INCLUDED_BENCHREPLAY_H_5820374
+#define INCLUDED_BENCHREPLAY_H_5820374
+
+#include "BenchmarkReport.h"
+#include "BenchStorage.h"
+#include "../include/SyntheticFrameSource.h"
+
+#include <atomic>
+#include <cmath>
+
+namespace Benchmark
+{
+    // Counts the replayed frames and optionally reads their pixels.
+    class CReplayBenchmarkHandler : public Pylon::CSyntheticImageEventHandler
+    {
+    public:
+        explicit CReplayBenchmarkHandler( bool readPixels)
+            : m_readPixels( readPixels)
+            , m_frameCount( 0)
+            , m_checksum( 0)
+        {
+        }
+
+        virtual void OnImageGrabbed( Pylon::CSyntheticFrameSource& /*camera*/, const Pylon::CSyntheticGrabResultPtr& ptrGrabResult)
+        {
+            if (m_readPixels)
+            {
+                const uint16_t* pPixels = static_cast<const uint16_t*>(ptrGrabResult->GetBuffer());
+                const size_t pixelCount = ptrGrabResult->GetImageSize() / sizeof( uint16_t);
+                uint64_t sum = 0;
+                for (size_t i = 0; i < pixelCount; ++i)
+                {
+                    sum += pPixels[i];
+                }
+                m_checksum += sum;
+            }
+            m_deliveryTimes.push_back( m_stopwatch.GetSeconds());
+            m_timeStamps.push_back( ptrGrabResult->GetTimeStamp());
+            ++m_frameCount;
+        }
+
+        size_t GetFrameCount() const
+        {
+            return m_frameCount;
+        }
+
+        // Mean absolute deviation of the delivery intervals from the recorded intervals in seconds.
+        double GetMeanTimingError() const
+        {
+            double error = 0.0;
+            for (size_t i = 1; i < m_deliveryTimes.size(); ++i)
+            {
+                const double recorded = (static_cast<int64_t>(m_timeStamps[i]) - static_cast<int64_t>(m_timeStamps[i - 1])) * 1e-9;
+                error += fabs( (m_deliveryTimes[i] - m_deliveryTimes[i - 1]) - recorded);
+            }
+            return m_deliveryTimes.size() > 1 ? error / (m_deliveryTimes.size() - 1) : 0.0;
+        }
+
+    private:
+        bool m_readPixels;
+        std::atomic<size_t> m_frameCount;
+        uint64_t m_checksum;
+        CStopwatch m_stopwatch;
+        std::vector<double> m_deliveryTimes;
+        std::vector<uint64_t> m_timeStamps;
+    };
+
+    inline void RunReplayBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace Pylon;
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        GetBenchmarkFrameSize( argc, argv, width, height);
+        const char* framesValue = GetCommandLineOption( argc, argv, "-frames");
+        const uint32_t frameCount = framesValue != NULL ? std::max( 1, atoi( framesValue)) : 100;
+        const std::string fileName = GetBenchmarkDirectories( argc, argv).front() + "/bench-replay.frames";
+
+        // Record the frames with the time stamps of a camera running at 14 fps.
+        {
+            SampleImageCreator::SFractalSettings settings;
+            settings.Width = width;
+            settings.Height = height;
+            settings.PixelType = PixelType_Mono12;
+            SampleImageCreator::CFractalFramePool pool;
+            pool.Create( settings, 8);
+
+            CFrameContainerWriter writer;
+            writer.Open( fileName.c_str());
+            for (uint32_t i = 0; i < frameCount; ++i)
+            {
+                SFrameContainerRecord record;
+                memset( &record, 0, sizeof( record));
+                record.PixelType = PixelType_Mono12;
+                record.Width = width;
+                record.Height = height;
+                record.TimeStamp = static_cast<uint64_t>(i) * 71428571;
+                record.BlockID = i;
+                record.ImageNumber = i + 1;
+                writer.Append( record, pool.GetFrame( i), pool.GetFrameSize());
+            }
+            writer.Close();
+        }
+
+        struct SReplayCase
+        {
+            const char* Name;
+            EReplayTiming Timing;
+            bool ReadPixels;
+        };
+        const SReplayCase cases[] =
+        {
+            { "asap no-op handler", ReplayTiming_AsFastAsPossible, false },
+            { "asap reading handler", ReplayTiming_AsFastAsPossible, true },
+            { "original timing", ReplayTiming_Original, false }
+        };
+
+        for (size_t c = 0; c < sizeof( cases) / sizeof( cases[0]); ++c)
+        {
+            SSyntheticFrameSourceSettings settings;
+            settings.Pattern = SyntheticPattern_Replay;
+            settings.ReplayFileNames.push_back( fileName);
+            settings.ReplayTiming = cases[c].Timing;
+
+            CSyntheticFrameSource source( settings);
+            CReplayBenchmarkHandler* pHandler = new CReplayBenchmarkHandler( cases[c].ReadPixels);
+            source.RegisterImageEventHandler( pHandler, RegistrationMode_Append, Cleanup_Delete);
+            source.Open();
+
+            CCpuStopwatch stopwatch;
+            source.StartGrabbing( GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+            while (source.IsGrabbing())
+            {
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1));
+            }
+            // Stopping waits for the handler to finish the last frame.
+            source.StopGrabbing();
+            const double seconds = stopwatch.GetSeconds();
+            const double cpuCores = stopwatch.GetCpuCores();
+
+            const size_t frameSize = static_cast<size_t>(width) * height * sizeof( uint16_t);
+            SBenchmarkResult result;
+            result.Benchmark = "replay";
+            result.Case = cases[c].Name;
+            result.Add( "frames", static_cast<double>(pHandler->GetFrameCount()))
+                .Add( "frames_per_s", pHandler->GetFrameCount() / seconds)
+                .Add( "mb_per_s", pHandler->GetFrameCount() * static_cast<double>(frameSize) / seconds * 1e-6)
+                .Add( "cpu_cores", cpuCores);
+            if (cases[c].Timing == ReplayTiming_Original)
+            {
+                result.Add( "mean_timing_error_ms", pHandler->GetMeanTimingError() * 1e3);
+            }
+            report.Add( result);
+        }
+
+        if (!HasCommandLineFlag( argc, argv, "-keep"))
+        {
+            remove( fileName.c_str());
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHREPLAY_H_5820374 */
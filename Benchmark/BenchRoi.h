@@ -0,0 +1,309 @@
+// Contains the benchmark of the image AOI switches of include/RoiController.h.
+/*
+   A synthetic frame source grabs with the full sensor and with an AOI centered on the sensor, switched
+   by CRoiController. The source emulates the time a camera takes to start and to stop grabbing and to
+   write a parameter, and its frame period shrinks with the AOI height like the readout of a CMOS sensor:
+       full sensor   the frame rate and the payload of the full sensor
+       roi           the frame rate, the payload and their gain over the full sensor, the latency of the
+                     restarts from the full sensor to the AOI (median and maximum) and back, until the first
+                     frame with the new AOI arrived, and the buffers allocated by the restarts
+       move          the AOI follows a target on the sensor, the offsets are written while grabbing.
+                     Reported are the latency until the first frame at the new position and the frames lost
+       buffer factory  the start and stop cycles of the instant camera with MaxNumBuffer buffers of the two
+                     payloads, allocated by new[] as Grab_StateMachine did and by CPooledBufferFactory
+   Options: -size <width>x<height> of the sensor (default 2592x1944), -roi <width>x<height> (default
+   640x480), -fps <rate> of the full sensor (default 14), -frames <n> per frame rate (default 10),
+   -repeat <n> switches (default 5), -start-latency <ms> (default 50), -stop-latency <ms> (default 20),
+   -write-latency <us> (default 300).
+*/
+
+#ifndef INCLUDED_BENCHROI_H_5297340
+#define INCLUDED_BENCHROI_H_5297340
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "../include/SyntheticFrameSource.h"
+#include "../include/RoiController.h"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace Benchmark
+{
+    typedef Pylon::CRoiController<Pylon::CSyntheticFrameSource> CSyntheticRoiController;
+
+    // Counts the frames delivered with the AOI applied last and their time stamps.
+    class CRoiBenchmarkHandler : public Pylon::CSyntheticImageEventHandler
+    {
+    public:
+        explicit CRoiBenchmarkHandler( CSyntheticRoiController& controller)
+            : m_controller( controller)
+            , m_frames( 0)
+            , m_skippedFrames( 0)
+            , m_payloadBytes( 0)
+            , m_firstTimeStamp( 0)
+            , m_lastTimeStamp( 0)
+        {
+        }
+
+        void Reset()
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            m_frames = 0;
+            m_payloadBytes = 0;
+        }
+
+        virtual void OnImageGrabbed( Pylon::CSyntheticFrameSource& /*camera*/, const Pylon::CSyntheticGrabResultPtr& ptrGrabResult)
+        {
+            m_controller.OnFrame( ptrGrabResult);
+            const Pylon::SRoi roi = m_controller.GetRoi();
+            const bool isApplied = ptrGrabResult->GetOffsetX() == roi.OffsetX && ptrGrabResult->GetOffsetY() == roi.OffsetY
+                && ptrGrabResult->GetWidth() == roi.Width && ptrGrabResult->GetHeight() == roi.Height;
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                m_skippedFrames += static_cast<size_t>(ptrGrabResult->GetNumberOfSkippedImages());
+                if (!isApplied)
+                {
+                    return;
+                }
+                if (m_frames == 0)
+                {
+                    m_firstTimeStamp = ptrGrabResult->GetTimeStamp();
+                }
+                m_lastTimeStamp = ptrGrabResult->GetTimeStamp();
+                m_payloadBytes = ptrGrabResult->GetPayloadSize();
+                ++m_frames;
+            }
+            m_condition.notify_all();
+        }
+
+        // Waits until count frames with the applied AOI arrived since Reset(). Returns false on timeout.
+        bool WaitForFrames( size_t count, unsigned int timeoutMs)
+        {
+            std::unique_lock<std::mutex> lock( m_lock);
+            return m_condition.wait_for( lock, std::chrono::milliseconds( timeoutMs), [this, count]() { return m_frames >= count; });
+        }
+
+        // The frame rate by the time stamps of the frames since Reset().
+        double GetFrameRate() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_frames > 1 && m_lastTimeStamp > m_firstTimeStamp ? (m_frames - 1) * 1e9 / (m_lastTimeStamp - m_firstTimeStamp) : 0.0;
+        }
+
+        size_t GetPayloadBytes() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_payloadBytes;
+        }
+
+        size_t GetSkippedFrames() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_skippedFrames;
+        }
+
+    private:
+        CSyntheticRoiController& m_controller;
+        mutable std::mutex m_lock;
+        std::condition_variable m_condition;
+        size_t m_frames;
+        size_t m_skippedFrames;
+        size_t m_payloadBytes;
+        uint64_t m_firstTimeStamp;
+        uint64_t m_lastTimeStamp;
+    };
+
+    // Applies the requested AOI and measures the frame rate and the payload with it.
+    inline void GrabRoiFrames( CSyntheticRoiController& controller, CRoiBenchmarkHandler& handler, size_t frameCount,
+        double& frameRate, size_t& payloadBytes)
+    {
+        handler.Reset();
+        controller.Apply( true);
+        if (!handler.WaitForFrames( frameCount, 10000))
+        {
+            throw RUNTIME_EXCEPTION( "The frames with the new AOI did not arrive.");
+        }
+        frameRate = handler.GetFrameRate();
+        payloadBytes = handler.GetPayloadBytes();
+    }
+
+    inline void RunRoiBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace Pylon;
+
+        const char* value = NULL;
+        const size_t frameCount = (value = GetCommandLineOption( argc, argv, "-frames")) != NULL ? std::max( 2, atoi( value)) : 10;
+        const uint32_t repeat = GetBenchmarkRepeat( argc, argv, 5);
+        unsigned int roiWidth = 640;
+        unsigned int roiHeight = 480;
+        if ((value = GetCommandLineOption( argc, argv, "-roi")) != NULL && (sscanf( value, "%ux%u", &roiWidth, &roiHeight) != 2 || roiWidth == 0 || roiHeight == 0))
+        {
+            throw RUNTIME_EXCEPTION( "Invalid AOI size %s. Expected <width>x<height>.", value);
+        }
+
+        SSyntheticFrameSourceSettings settings;
+        GetBenchmarkFrameSize( argc, argv, settings.Width, settings.Height);
+        settings.PixelType = PixelType_Mono8;
+        settings.FrameRate = (value = GetCommandLineOption( argc, argv, "-fps")) != NULL ? atof( value) : 14.0;
+        settings.CycleLength = 1;
+        settings.StartLatencyMs = (value = GetCommandLineOption( argc, argv, "-start-latency")) != NULL ? atof( value) : 50.0;
+        settings.StopLatencyMs = (value = GetCommandLineOption( argc, argv, "-stop-latency")) != NULL ? atof( value) : 20.0;
+        settings.WriteLatencyUs = (value = GetCommandLineOption( argc, argv, "-write-latency")) != NULL ? atof( value) : 300.0;
+
+        CSyntheticFrameSource camera( settings);
+        CSyntheticRoiController controller( camera);
+        CRoiBenchmarkHandler* pHandler = new CRoiBenchmarkHandler( controller);
+        camera.RegisterImageEventHandler( pHandler, RegistrationMode_Append, Cleanup_Delete);
+        camera.Open();
+        camera.PixelFormat.SetValue( Basler_UsbCameraParams::PixelFormat_Mono8);
+        camera.MaxNumBuffer = 4;
+        controller.SetStartGrabbing( [&camera]() { camera.StartGrabbing( GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera); });
+        controller.Open();
+        const SRoiLimits limits = controller.GetLimits();
+        const SRoi roi = GetCenteredRoi( limits, roiWidth, roiHeight, limits.SensorWidth / 2, limits.SensorHeight / 2);
+
+        camera.StartGrabbing( GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+        const size_t firstAllocationCount = camera.GetBufferAllocationCount();
+        double fullFrameRate = 0.0;
+        size_t fullPayloadBytes = 0;
+        controller.RequestFullSensor();
+        GrabRoiFrames( controller, *pHandler, frameCount, fullFrameRate, fullPayloadBytes);
+
+        // The frame rate is measured once per AOI, the following switches wait for one frame.
+        double roiFrameRate = 0.0;
+        size_t roiPayloadBytes = 0;
+        for (uint32_t r = 0; r < repeat; ++r)
+        {
+            double frameRate = 0.0;
+            size_t payloadBytes = 0;
+            controller.Request( roi);
+            GrabRoiFrames( controller, *pHandler, r == 0 ? frameCount : 1, r == 0 ? roiFrameRate : frameRate, r == 0 ? roiPayloadBytes : payloadBytes);
+            controller.RequestFullSensor();
+            GrabRoiFrames( controller, *pHandler, 1, frameRate, payloadBytes);
+        }
+        // The restarts alternate between the AOI and the full sensor.
+        const std::vector<double> restartLatencies = controller.GetRestartLatencies();
+        std::vector<double> toRoiLatencies;
+        std::vector<double> toFullLatencies;
+        for (size_t i = 0; i < restartLatencies.size(); ++i)
+        {
+            (i % 2 == 0 ? toRoiLatencies : toFullLatencies).push_back( restartLatencies[i]);
+        }
+        const size_t restartAllocationCount = camera.GetBufferAllocationCount() - firstAllocationCount;
+
+        // The AOI follows a target around the center of the sensor.
+        {
+            double frameRate = 0.0;
+            size_t payloadBytes = 0;
+            controller.Request( roi);
+            GrabRoiFrames( controller, *pHandler, 1, frameRate, payloadBytes);
+        }
+        const size_t skippedBeforeMoves = pHandler->GetSkippedFrames();
+        for (uint32_t m = 0; m < 4 * repeat; ++m)
+        {
+            const double angle = 2.0 * 3.14159265358979 * m / (4 * repeat);
+            controller.RequestCenter( limits.SensorWidth * (0.5 + 0.25 * cos( angle)), limits.SensorHeight * (0.5 + 0.25 * sin( angle)));
+            pHandler->Reset();
+            if (controller.Apply( false) != RoiSwitch_Move || !pHandler->WaitForFrames( 1, 5000))
+            {
+                throw RUNTIME_EXCEPTION( "The AOI was not moved while grabbing.");
+            }
+        }
+        const std::vector<double> moveLatencies = controller.GetMoveLatencies();
+        const size_t skippedMoveFrames = pHandler->GetSkippedFrames() - skippedBeforeMoves;
+        camera.StopGrabbing();
+
+        {
+            SBenchmarkResult result;
+            result.Benchmark = "roi";
+            result.Case = "full sensor";
+            result.Add( "width", static_cast<double>(limits.SensorWidth))
+                .Add( "height", static_cast<double>(limits.SensorHeight))
+                .Add( "fps", fullFrameRate)
+                .Add( "payload_kb", fullPayloadBytes / 1024.0)
+                .Add( "mb_per_s", fullFrameRate * fullPayloadBytes / 1048576.0);
+            report.Add( result);
+        }
+        {
+            SBenchmarkResult result;
+            result.Benchmark = "roi";
+            result.Case = "roi";
+            result.Add( "width", static_cast<double>(roi.Width))
+                .Add( "height", static_cast<double>(roi.Height))
+                .Add( "fps", roiFrameRate)
+                .Add( "payload_kb", roiPayloadBytes / 1024.0)
+                .Add( "mb_per_s", roiFrameRate * roiPayloadBytes / 1048576.0)
+                .Add( "payload_reduction", roiPayloadBytes > 0 ? static_cast<double>(fullPayloadBytes) / roiPayloadBytes : 0.0)
+                .Add( "fps_gain", fullFrameRate > 0.0 ? roiFrameRate / fullFrameRate : 0.0)
+                .Add( "restart_median_ms", GetPercentile( toRoiLatencies, 50.0) * 1e3)
+                .Add( "restart_max_ms", GetPercentile( toRoiLatencies, 100.0) * 1e3)
+                .Add( "restart_to_full_ms", GetPercentile( toFullLatencies, 50.0) * 1e3)
+                .Add( "restart_allocations", static_cast<double>(restartAllocationCount));
+            report.Add( result);
+        }
+        {
+            SBenchmarkResult result;
+            result.Benchmark = "roi";
+            result.Case = "move";
+            result.Add( "moves", static_cast<double>(moveLatencies.size()))
+                .Add( "move_median_ms", GetPercentile( moveLatencies, 50.0) * 1e3)
+                .Add( "move_max_ms", GetPercentile( moveLatencies, 100.0) * 1e3)
+                .Add( "lost_frames", static_cast<double>(skippedMoveFrames));
+            report.Add( result);
+        }
+
+        // The buffers of the instant camera for starts alternating between the two payloads.
+        {
+            const size_t bufferCount = 10;
+            const size_t cycleCount = 1000;
+            std::vector<void*> buffers( bufferCount);
+            std::vector<intptr_t> contexts( bufferCount);
+
+            CStopwatch newStopwatch;
+            for (size_t c = 0; c < cycleCount; ++c)
+            {
+                const size_t payloadBytes = c % 2 == 0 ? fullPayloadBytes : roiPayloadBytes;
+                for (size_t i = 0; i < bufferCount; ++i)
+                {
+                    buffers[i] = new uint8_t[payloadBytes];
+                    static_cast<uint8_t*>(buffers[i])[0] = 0;
+                }
+                for (size_t i = 0; i < bufferCount; ++i)
+                {
+                    delete[] static_cast<uint8_t*>(buffers[i]);
+                }
+            }
+            const double newSeconds = newStopwatch.GetSeconds();
+
+            CPooledBufferFactory factory;
+            CStopwatch pooledStopwatch;
+            for (size_t c = 0; c < cycleCount; ++c)
+            {
+                const size_t payloadBytes = c % 2 == 0 ? fullPayloadBytes : roiPayloadBytes;
+                for (size_t i = 0; i < bufferCount; ++i)
+                {
+                    factory.AllocateBuffer( payloadBytes, &buffers[i], contexts[i]);
+                    static_cast<uint8_t*>(buffers[i])[0] = 0;
+                }
+                for (size_t i = 0; i < bufferCount; ++i)
+                {
+                    factory.FreeBuffer( buffers[i], contexts[i]);
+                }
+            }
+            const double pooledSeconds = pooledStopwatch.GetSeconds();
+
+            SBenchmarkResult result;
+            result.Benchmark = "roi";
+            result.Case = "buffer factory";
+            result.Add( "cycles", static_cast<double>(cycleCount))
+                .Add( "new_us_per_cycle", newSeconds / cycleCount * 1e6)
+                .Add( "new_allocations", static_cast<double>(cycleCount * bufferCount))
+                .Add( "pooled_us_per_cycle", pooledSeconds / cycleCount * 1e6)
+                .Add( "pooled_allocations", static_cast<double>(factory.GetAllocationCount()));
+            report.Add( result);
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHROI_H_5297340 */
@@ -0,0 +1,312 @@
+// Contains the benchmark of the hand-off of frames to other processes through include/SharedFrameRing.h.
+/*
+   The benchmark publishes Mono8 frames to a CSharedFrameRingWriter and starts 1 to 4 reader processes,
+   copies of this program started with -shm-reader, that read every pixel of each frame in place, check
+   the frame number written into it and measure the time from the publication to the acquisition.
+       paced       frames published at -rate fps, the latency of the hand-off
+       unpaced     frames published as fast as the copy into the ring allows, the throughput
+   Reported are the publish rate and the time of Publish(), the mean rate read per reader, the median
+   and 99th percentile of the latency, the mean CPU load of a reader in cores and the fraction of the
+   frames the readers missed. A paced reader waits in Acquire() between the frames, its latency and CPU
+   load are the ones of the wait, which sleeps after 50 us. Missed frames
+   are expected for unpaced publishing when the readers are slower than the writer, the writer never
+   waits. A reader must not get a frame with the wrong number.
+   Options: -size <width>x<height> (default 2592x1944), -frames <n> per case (default 500), -rate <fps>
+   (default 200), -readers <n> (default 4), -slots <n> (default 8), -dir <directory of the result files>
+   (default the current directory).
+*/
+
+#ifndef INCLUDED_BENCHSHAREDRING_H_4630751
+#define INCLUDED_BENCHSHAREDRING_H_4630751
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "../include/SharedFrameRing.h"
+
+#include <thread>
+
+#if !defined(_WIN32)
+#    include <sys/wait.h>
+#endif
+
+namespace Benchmark
+{
+    struct SSharedRingReaderResult
+    {
+        SSharedRingReaderResult()
+            : Received( 0)
+            , Overruns( 0)
+            , Invalid( 0)
+            , LatencyMedianNs( 0.0)
+            , LatencyP99Ns( 0.0)
+            , Seconds( 0.0)
+            , CpuCores( 0.0)
+        {
+        }
+
+        uint64_t Received;
+        uint64_t Overruns;
+        uint64_t Invalid;
+        double LatencyMedianNs;
+        double LatencyP99Ns;
+        double Seconds;
+        double CpuCores;
+    };
+
+    // The reader process: reads the frames of the ring until the writer closes it and writes its result to a file.
+    inline void RunSharedRingReader( const char* ringName, const char* resultFileName)
+    {
+        using namespace Pylon;
+
+        CSharedFrameRingReader ring;
+        for (int waited = 0; !ring.Open( ringName); waited += 10)
+        {
+            if (waited > 5000)
+            {
+                throw RUNTIME_EXCEPTION( "There is no frame ring %s.", ringName);
+            }
+            std::this_thread::sleep_for( std::chrono::milliseconds( 10));
+        }
+
+        SSharedRingReaderResult result;
+        std::vector<double> latencies;
+        uint64_t checksum = 0;
+        int64_t firstTime = 0;
+        int64_t lastTime = 0;
+        CSharedFrame frame;
+        CCpuStopwatch cpuStopwatch;
+        for (;;)
+        {
+            if (!ring.Acquire( frame, 100))
+            {
+                if (ring.IsClosed())
+                {
+                    break;
+                }
+                continue;
+            }
+            lastTime = GetHostTimeNs();
+            firstTime = firstTime != 0 ? firstTime : lastTime;
+            const double latency = static_cast<double>(lastTime - frame.GetPublishTime());
+
+            // Reads the frame like an analysis would.
+            const uint64_t* pWords = static_cast<const uint64_t*>(frame.GetBuffer());
+            const size_t wordCount = frame.GetSize() / sizeof( uint64_t);
+            uint64_t sum = 0;
+            for (size_t i = 0; i < wordCount; ++i)
+            {
+                sum += pWords[i];
+            }
+            const uint64_t frameNumber = wordCount != 0 ? pWords[0] : 0;
+            if (!ring.Release( frame))
+            {
+                continue;
+            }
+            checksum += sum;
+            latencies.push_back( latency);
+            ++result.Received;
+            if (frameNumber != frame.GetFrameNumber())
+            {
+                ++result.Invalid;
+            }
+        }
+        result.Overruns = ring.GetOverrunCount();
+        result.LatencyMedianNs = latencies.empty() ? 0.0 : GetPercentile( latencies, 50.0);
+        result.LatencyP99Ns = latencies.empty() ? 0.0 : GetPercentile( latencies, 99.0);
+        result.Seconds = (lastTime - firstTime) * 1e-9;
+        result.CpuCores = cpuStopwatch.GetCpuCores();
+
+        FILE* pFile = fopen( resultFileName, "w");
+        if (pFile == NULL)
+        {
+            throw RUNTIME_EXCEPTION( "Could not create %s.", resultFileName);
+        }
+        fprintf( pFile, "%llu %llu %llu %.0f %.0f %.9f %.6f %llu\n", static_cast<unsigned long long>(result.Received), static_cast<unsigned long long>(result.Overruns),
+            static_cast<unsigned long long>(result.Invalid), result.LatencyMedianNs, result.LatencyP99Ns, result.Seconds, result.CpuCores, static_cast<unsigned long long>(checksum));
+        fclose( pFile);
+    }
+
+    // A started reader process.
+    class CSharedRingReaderProcess
+    {
+    public:
+        CSharedRingReaderProcess( const char* program, const std::string& ringName, const std::string& resultFileName)
+            : m_resultFileName( resultFileName)
+        {
+            remove( resultFileName.c_str());
+#if defined(_WIN32)
+            std::string commandLine = std::string( "\"") + program + "\" -b shm -shm-reader " + ringName + " -shm-result \"" + resultFileName + "\"";
+            STARTUPINFOA startupInfo;
+            memset( &startupInfo, 0, sizeof( startupInfo));
+            startupInfo.cb = sizeof( startupInfo);
+            PROCESS_INFORMATION processInfo;
+            if (!CreateProcessA( NULL, &commandLine[0], NULL, NULL, FALSE, 0, NULL, NULL, &startupInfo, &processInfo))
+            {
+                throw RUNTIME_EXCEPTION( "Could not start the reader process %s.", program);
+            }
+            CloseHandle( processInfo.hThread);
+            m_hProcess = processInfo.hProcess;
+#else
+            m_pid = fork();
+            if (m_pid == 0)
+            {
+                const char* arguments[] = { program, "-b", "shm", "-shm-reader", ringName.c_str(), "-shm-result", resultFileName.c_str(), NULL };
+                execvp( program, const_cast<char* const*>(arguments));
+                _exit( 127);
+            }
+            if (m_pid < 0)
+            {
+                throw RUNTIME_EXCEPTION( "Could not start the reader process %s.", program);
+            }
+#endif
+        }
+
+        // Waits for the process to end and returns its result.
+        SSharedRingReaderResult Wait()
+        {
+#if defined(_WIN32)
+            WaitForSingleObject( m_hProcess, INFINITE);
+            CloseHandle( m_hProcess);
+#else
+            int status = 0;
+            waitpid( m_pid, &status, 0);
+#endif
+            SSharedRingReaderResult result;
+            unsigned long long received = 0, overruns = 0, invalid = 0, checksum = 0;
+            FILE* pFile = fopen( m_resultFileName.c_str(), "r");
+            const bool isRead = pFile != NULL && fscanf( pFile, "%llu %llu %llu %lf %lf %lf %lf %llu", &received, &overruns, &invalid,
+                &result.LatencyMedianNs, &result.LatencyP99Ns, &result.Seconds, &result.CpuCores, &checksum) == 8;
+            if (pFile != NULL)
+            {
+                fclose( pFile);
+                remove( m_resultFileName.c_str());
+            }
+            if (!isRead)
+            {
+                throw RUNTIME_EXCEPTION( "The reader process did not write %s.", m_resultFileName.c_str());
+            }
+            result.Received = received;
+            result.Overruns = overruns;
+            result.Invalid = invalid;
+            return result;
+        }
+
+    private:
+        std::string m_resultFileName;
+#if defined(_WIN32)
+        HANDLE m_hProcess;
+#else
+        pid_t m_pid;
+#endif
+    };
+
+    inline void RunSharedRingBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace Pylon;
+
+        const char* value = NULL;
+        if ((value = GetCommandLineOption( argc, argv, "-shm-reader")) != NULL)
+        {
+            const char* resultFileName = GetCommandLineOption( argc, argv, "-shm-result");
+            RunSharedRingReader( value, resultFileName != NULL ? resultFileName : "bench-shm-result.txt");
+            return;
+        }
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        GetBenchmarkFrameSize( argc, argv, width, height);
+        const uint32_t frameCount = (value = GetCommandLineOption( argc, argv, "-frames")) != NULL ? static_cast<uint32_t>(std::max( 1, atoi( value))) : 500;
+        const double rate = (value = GetCommandLineOption( argc, argv, "-rate")) != NULL ? std::max( 1.0, atof( value)) : 200.0;
+        const uint32_t maxReaderCount = (value = GetCommandLineOption( argc, argv, "-readers")) != NULL ? static_cast<uint32_t>(std::max( 1, atoi( value))) : 4;
+        const uint32_t slotCount = (value = GetCommandLineOption( argc, argv, "-slots")) != NULL ? static_cast<uint32_t>(std::max( 1, atoi( value))) : 8;
+        const std::string directory = (value = GetCommandLineOption( argc, argv, "-dir")) != NULL ? value : ".";
+
+        // The frames differ in their first 8 bytes, the frame number.
+        const size_t frameSize = (static_cast<size_t>(width) * height + 7) & ~static_cast<size_t>(7);
+        std::vector<uint64_t> frame( frameSize / sizeof( uint64_t));
+        for (size_t i = 0; i < frame.size(); ++i)
+        {
+            frame[i] = i * 0x9E3779B97F4A7C15ULL;
+        }
+
+        for (uint32_t readerCount = 1; readerCount <= maxReaderCount; ++readerCount)
+        {
+            for (int isPaced = 1; isPaced >= 0; --isPaced)
+            {
+                char ringName[64];
+                sprintf( ringName, "bench-shm-%u", static_cast<unsigned int>(GetHostTimeNs() % 1000000000));
+                CSharedFrameRingWriter ring;
+                ring.Create( ringName, slotCount, frameSize);
+
+                std::vector<CSharedRingReaderProcess*> readers;
+                for (uint32_t r = 0; r < readerCount; ++r)
+                {
+                    char resultFileName[512];
+                    sprintf( resultFileName, "%s/%s-%u.txt", directory.c_str(), ringName, r);
+                    readers.push_back( new CSharedRingReaderProcess( argv[0], ringName, resultFileName));
+                }
+                for (int waited = 0; ring.GetReaderCount() < readerCount; waited += 10)
+                {
+                    if (waited > 10000)
+                    {
+                        ring.Close();
+                        throw RUNTIME_EXCEPTION( "Only %u of %u reader processes opened the frame ring.", ring.GetReaderCount(), readerCount);
+                    }
+                    std::this_thread::sleep_for( std::chrono::milliseconds( 10));
+                }
+
+                std::vector<double> publishSeconds;
+                const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                for (uint32_t f = 0; f < frameCount; ++f)
+                {
+                    if (isPaced)
+                    {
+                        std::this_thread::sleep_until( start + std::chrono::microseconds( static_cast<int64_t>(f * 1e6 / rate)));
+                    }
+                    frame[0] = f;
+                    CStopwatch stopwatch;
+                    ring.Publish( &frame[0], frameSize, PixelType_Mono8, width, height, 0, f);
+                    publishSeconds.push_back( stopwatch.GetSeconds());
+                }
+                const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+                ring.Close();
+
+                double readRate = 0.0;
+                double readerCpu = 0.0;
+                double missed = 0.0;
+                std::vector<double> medians;
+                std::vector<double> p99s;
+                for (size_t r = 0; r < readers.size(); ++r)
+                {
+                    const SSharedRingReaderResult result = readers[r]->Wait();
+                    delete readers[r];
+                    if (result.Invalid != 0)
+                    {
+                        throw RUNTIME_EXCEPTION( "A reader got %u frames with the wrong frame number.", static_cast<unsigned int>(result.Invalid));
+                    }
+                    readRate += result.Seconds > 0.0 ? result.Received / result.Seconds / readers.size() : 0.0;
+                    readerCpu += result.CpuCores / readers.size();
+                    missed += static_cast<double>(frameCount - std::min<uint64_t>( result.Received, frameCount)) / frameCount / readers.size();
+                    medians.push_back( result.LatencyMedianNs);
+                    p99s.push_back( result.LatencyP99Ns);
+                }
+
+                SBenchmarkResult benchmarkResult;
+                benchmarkResult.Benchmark = "shm";
+                benchmarkResult.Case = isPaced ? "paced" : "unpaced";
+                benchmarkResult.Add( "readers", readerCount)
+                    .Add( "frame_mb", frameSize / 1048576.0)
+                    .Add( "publish_fps", frameCount / seconds)
+                    .Add( "publish_us", GetPercentile( publishSeconds, 50.0) * 1e6)
+                    .Add( "read_fps", readRate)
+                    .Add( "latency_us", GetPercentile( medians, 50.0) * 1e-3)
+                    .Add( "latency_p99_us", *std::max_element( p99s.begin(), p99s.end()) * 1e-3)
+                    .Add( "reader_cpu", readerCpu)
+                    .Add( "missed", missed);
+                report.Add( benchmarkResult);
+            }
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHSHAREDRING_H_4630751 */
@@ -0,0 +1,128 @@
+// Contains the benchmark of the burst stacking.
+/*
+   A synthetic Mono12 frame, scaled to 0-3000 DN, is the noise free scene of a burst of 15 frames with shot
+   noise of 1 DN per electron and 3 DN read noise. The burst is stacked by CBurstStacker of
+   include/BurstStacker.h in every mode, once with the noise alone and once with 0.1 % of the pixels of every
+   frame replaced by outliers of 4095 DN, like hot pixels or particles.
+
+   Reported per mode are the time to add a frame, its share of the frame period at the burst rate, the time to
+   finish the stack on all threads, the memory held by the stacker, the rms difference to the scene of a
+   single frame and of the stacked frame, and their ratio, the gain in SNR. Without outliers the mean gains
+   the square root of the frame count, 3.9 for 15 frames. The benchmark fails if a mode gains less than 0.7
+   times the square root of the frames it stacked.
+   Options: -size <width>x<height> (default 2592x1944), -frames <n> (default 15), -fps <burst rate> (default 14).
+*/
+
+#ifndef INCLUDED_BENCHSTACK_H_7702315
+#define INCLUDED_BENCHSTACK_H_7702315
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "../include/BurstStacker.h"
+
+#include <random>
+
+namespace Benchmark
+{
+    // The rms difference of a frame to the scene.
+    inline double GetRmsDifference( const uint16_t* pFrame, const std::vector<float>& scene)
+    {
+        double squareSum = 0.0;
+        for (size_t i = 0; i < scene.size(); ++i)
+        {
+            squareSum += (pFrame[i] - scene[i]) * (pFrame[i] - scene[i]);
+        }
+        return std::sqrt( squareSum / scene.size());
+    }
+
+    inline void RunStackBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace SampleImageCreator;
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        GetBenchmarkFrameSize( argc, argv, width, height);
+        const char* value = NULL;
+        const size_t frameCount = (value = Pylon::GetCommandLineOption( argc, argv, "-frames")) != NULL ? std::max( 1, atoi( value)) : 15;
+        const double frameRate = (value = Pylon::GetCommandLineOption( argc, argv, "-fps")) != NULL ? atof( value) : 14.0;
+
+        SFractalSettings fractalSettings;
+        fractalSettings.Width = width;
+        fractalSettings.Height = height;
+        fractalSettings.PixelType = Pylon::PixelType_Mono12;
+        const Pylon::CPylonImage image = RenderFractal( fractalSettings);
+        const uint16_t* pPixels = static_cast<const uint16_t*>(image.GetBuffer());
+        std::vector<float> scene( static_cast<size_t>(width) * height);
+        for (size_t i = 0; i < scene.size(); ++i)
+        {
+            scene[i] = pPixels[i] * (3000.0f / 4095.0f);
+        }
+
+        const Pylon::EStackMode modes[] = { Pylon::StackMode_Mean, Pylon::StackMode_SigmaClippedMean, Pylon::StackMode_Median };
+        std::mt19937 random( 4711);
+        for (int withOutliers = 0; withOutliers < 2; ++withOutliers)
+        {
+            std::normal_distribution<float> normal;
+            std::uniform_real_distribution<float> uniform( 0.0f, 1.0f);
+            std::vector< std::vector<uint16_t> > frames( frameCount, std::vector<uint16_t>( scene.size()));
+            for (size_t f = 0; f < frameCount; ++f)
+            {
+                for (size_t i = 0; i < scene.size(); ++i)
+                {
+                    const float noisy = scene[i] + normal( random) * std::sqrt( scene[i] + 9.0f) + 0.5f;
+                    frames[f][i] = withOutliers != 0 && uniform( random) < 0.001f ? 4095 : static_cast<uint16_t>(std::min( std::max( noisy, 0.0f), 4095.0f));
+                }
+            }
+            const double singleRms = GetRmsDifference( &frames[0][0], scene);
+
+            for (size_t m = 0; m < sizeof( modes) / sizeof( modes[0]); ++m)
+            {
+                Pylon::SBurstStackSettings settings;
+                settings.Mode = modes[m];
+                Pylon::CBurstStacker stacker( settings);
+
+                // The first stack allocates the buffers.
+                for (int pass = 0; pass < 2; ++pass)
+                {
+                    stacker.Reset();
+                    CStopwatch addStopwatch;
+                    for (size_t f = 0; f < frameCount; ++f)
+                    {
+                        stacker.Add( &frames[f][0], Pylon::PixelType_Mono12, width, height, 0);
+                    }
+                    const double addSeconds = addStopwatch.GetSeconds() / frameCount;
+                    CStopwatch finishStopwatch;
+                    stacker.Finish();
+                    const double finishSeconds = finishStopwatch.GetSeconds();
+                    if (pass == 0)
+                    {
+                        continue;
+                    }
+
+                    const double stackRms = GetRmsDifference( static_cast<const uint16_t*>(stacker.GetImage().GetBuffer()), scene);
+                    // The median has about 80 % of the gain of the mean, the outliers cost the mean a little more.
+                    // The sigma clipped mean and the median stack at most MaxFrames frames.
+                    const size_t stackedCount = modes[m] == Pylon::StackMode_Mean ? frameCount : std::min( frameCount, settings.MaxFrames);
+                    if (!(singleRms / stackRms >= 0.7 * std::sqrt( static_cast<double>(stackedCount))))
+                    {
+                        throw RUNTIME_EXCEPTION( "The %s stack gains only %g in SNR.", Pylon::GetStackModeName( modes[m]), singleRms / stackRms);
+                    }
+                    SBenchmarkResult result;
+                    result.Benchmark = "stack";
+                    result.Case = std::string( Pylon::GetStackModeName( modes[m])) + (withOutliers != 0 ? " outliers" : " noise");
+                    result.Add( "frames", static_cast<double>(frameCount))
+                        .Add( "add_ms", addSeconds * 1e3)
+                        .Add( "add_period_share", addSeconds * frameRate)
+                        .Add( "finish_ms", finishSeconds * 1e3)
+                        .Add( "memory_mb", stacker.GetMemorySize() / 1048576.0)
+                        .Add( "single_rms", singleRms)
+                        .Add( "stack_rms", stackRms)
+                        .Add( "snr_gain", singleRms / stackRms);
+                    report.Add( result);
+                }
+            }
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHSTACK_H_7702315 */
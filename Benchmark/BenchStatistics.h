@@ -0,0 +1,144 @@
+// Contains the benchmark of the frame statistics.
+/*
+   Measures CFrameStatisticsCalculator on synthetic Mono8, Mono12 and BayerGB12 frames on one thread:
+   with and without histogram, with sub-sampling and with a centered ROI of a quarter of the frame. As
+   baseline a straightforward per-pixel loop computing the same values is measured. Reported are the
+   time per frame, the megapixels of the full frame per second and the frame rate one core sustains.
+   Options: -size <width>x<height> (default 2592x1944), -repeat <n> (default 20).
+*/
+
+#ifndef INCLUDED_BENCHSTATISTICS_H_7745012
+#define INCLUDED_BENCHSTATISTICS_H_7745012
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "../include/FrameStatistics.h"
+
+namespace Benchmark
+{
+    // The per-pixel loop the calculator is compared with. Returns a checksum to keep the compiler from dropping the loop.
+    template <typename PixelT>
+    inline double ComputeReferenceStatistics( const PixelT* pPixels, uint32_t width, uint32_t height, bool isBayer, std::vector<uint32_t>& histogram)
+    {
+        static const int c_bayerGbChannels[4] = { 1, 2, 0, 1 };
+        double sum[3] = { 0.0, 0.0, 0.0 };
+        double sumSquares[3] = { 0.0, 0.0, 0.0 };
+        uint64_t count[3] = { 0, 0, 0 };
+        uint64_t saturated = 0;
+        histogram.assign( Pylon::c_frameStatisticsBins, 0);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                const uint32_t v = std::min<uint32_t>( pPixels[static_cast<size_t>(y) * width + x], Pylon::c_frameStatisticsBins - 1);
+                const int channel = isBayer ? c_bayerGbChannels[(y & 1) * 2 + (x & 1)] : 0;
+                sum[channel] += v;
+                sumSquares[channel] += static_cast<double>(v) * v;
+                ++count[channel];
+                ++histogram[v];
+                saturated += v >= 4095 ? 1 : 0;
+            }
+        }
+        return (sum[0] + sum[1] + sum[2] + sumSquares[0] * 1e-9 + saturated) / (count[0] + count[1] + count[2]);
+    }
+
+    inline void RunStatisticsBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace SampleImageCreator;
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        GetBenchmarkFrameSize( argc, argv, width, height);
+        const uint32_t repeat = GetBenchmarkRepeat( argc, argv, 20);
+        const double megapixels = width * static_cast<double>(height) * 1e-6;
+
+        struct SStatisticsCase
+        {
+            const char* Name;
+            bool ComputeHistogram;
+            uint32_t Subsample;
+            bool CenterRoi;
+        };
+        const SStatisticsCase cases[] =
+        {
+            { "histogram", true, 1, false },
+            { "histogram subsample=2", true, 2, false },
+            { "histogram center roi", true, 1, true },
+            { "moments", false, 1, false },
+            { "moments subsample=2", false, 2, false }
+        };
+
+        const Pylon::EPixelType pixelTypes[] = { Pylon::PixelType_Mono8, Pylon::PixelType_Mono12, Pylon::PixelType_BayerGB12 };
+        for (size_t p = 0; p < sizeof( pixelTypes) / sizeof( pixelTypes[0]); ++p)
+        {
+            SFractalSettings settings;
+            settings.Width = width;
+            settings.Height = height;
+            settings.PixelType = pixelTypes[p];
+            const Pylon::CPylonImage image = RenderFractal( settings);
+            const std::string pixelTypeName = GetPixelTypeName( pixelTypes[p]);
+
+            {
+                std::vector<uint32_t> histogram;
+                double checksum = 0.0;
+                CStopwatch stopwatch;
+                for (uint32_t r = 0; r < repeat; ++r)
+                {
+                    if (pixelTypes[p] == Pylon::PixelType_Mono8)
+                    {
+                        checksum += ComputeReferenceStatistics( static_cast<const uint8_t*>(image.GetBuffer()), width, height, false, histogram);
+                    }
+                    else
+                    {
+                        checksum += ComputeReferenceStatistics( static_cast<const uint16_t*>(image.GetBuffer()), width, height,
+                            Pylon::IsBayer( pixelTypes[p]), histogram);
+                    }
+                }
+                const double seconds = stopwatch.GetSeconds() / repeat;
+
+                SBenchmarkResult result;
+                result.Benchmark = "stats";
+                result.Case = "reference " + pixelTypeName;
+                result.Add( "ms_per_frame", seconds * 1e3)
+                    .Add( "mp_per_s", megapixels / seconds)
+                    .Add( "frames_per_s", 1.0 / seconds)
+                    .Add( "checksum", checksum / repeat);
+                report.Add( result);
+            }
+
+            for (size_t c = 0; c < sizeof( cases) / sizeof( cases[0]); ++c)
+            {
+                Pylon::SFrameStatisticsSettings statisticsSettings;
+                statisticsSettings.ComputeHistogram = cases[c].ComputeHistogram;
+                statisticsSettings.Subsample = cases[c].Subsample;
+                if (cases[c].CenterRoi)
+                {
+                    statisticsSettings.RoiX = width / 4;
+                    statisticsSettings.RoiY = height / 4;
+                    statisticsSettings.RoiWidth = width / 2;
+                    statisticsSettings.RoiHeight = height / 2;
+                }
+                Pylon::CFrameStatisticsCalculator calculator( statisticsSettings);
+                Pylon::SFrameStatistics statistics;
+
+                CStopwatch stopwatch;
+                for (uint32_t r = 0; r < repeat; ++r)
+                {
+                    calculator.Compute( image.GetBuffer(), pixelTypes[p], width, height, 0, statistics);
+                }
+                const double seconds = stopwatch.GetSeconds() / repeat;
+
+                SBenchmarkResult result;
+                result.Benchmark = "stats";
+                result.Case = std::string( cases[c].Name) + " " + pixelTypeName;
+                result.Add( "ms_per_frame", seconds * 1e3)
+                    .Add( "mp_per_s", megapixels / seconds)
+                    .Add( "frames_per_s", 1.0 / seconds)
+                    .Add( "mean", statistics.GetMean());
+                report.Add( result);
+            }
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHSTATISTICS_H_7745012 */
@@ -0,0 +1,232 @@
+// Contains the benchmark of the frame storage path.
+/*
+   Stores synthetic 2592x1944 Mono12 and BayerGB12 frames with the functions in include/FrameStorage.h
+   the samples use: a .raw file per frame, a .png file per frame, both (the default of the samples), a
+   frame container and a frame container with losslessly compressed frames. For each target directory, pixel format and mode the frame rate, the data rate, the
+   mean and 99th percentile time for storing one frame and the CPU load are reported.
+   The frame content is deterministic, so runs can be compared. Files are deleted after each case.
+   Options: -dir <dir>[,<dir>...] (default /dev/shm and the current directory, on Windows the current
+   directory), -frames <n> (default 30), -size <width>x<height>, -modes <mode>[,<mode>...], -keep.
+   Without an explicit sync the numbers include the operating system's write cache. Use enough frames
+   to exceed it when measuring a real disk.
+*/
+
+#ifndef INCLUDED_BENCHSTORAGE_H_2296513
+#define INCLUDED_BENCHSTORAGE_H_2296513
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "../include/FrameStorage.h"
+
+#include <sys/stat.h>
+
+namespace Benchmark
+{
+    // Splits a comma separated list.
+    inline std::vector<std::string> SplitList( const std::string& list)
+    {
+        std::vector<std::string> items;
+        size_t start = 0;
+        while (start <= list.size())
+        {
+            const size_t end = std::min( list.find( ',', start), list.size());
+            if (end > start)
+            {
+                items.push_back( list.substr( start, end - start));
+            }
+            start = end + 1;
+        }
+        return items;
+    }
+
+    inline bool IsDirectory( const std::string& path)
+    {
+        struct stat info;
+        return stat( path.c_str(), &info) == 0 && (info.st_mode & S_IFDIR) != 0;
+    }
+
+    inline std::vector<std::string> GetBenchmarkDirectories( int argc, char* argv[])
+    {
+        const char* value = Pylon::GetCommandLineOption( argc, argv, "-dir");
+        if (value != NULL)
+        {
+            return SplitList( value);
+        }
+        std::vector<std::string> directories;
+#if !defined(_WIN32)
+        if (IsDirectory( "/dev/shm"))
+        {
+            directories.push_back( "/dev/shm");
+        }
+#endif
+        directories.push_back( ".");
+        return directories;
+    }
+
+    inline bool HasCommandLineFlag( int argc, char* argv[], const char* flag)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            if (strcmp( argv[i], flag) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Stores frameCount frames of the pool in the given mode. Returns the time for storing each frame in seconds.
+    inline std::vector<double> StoreFrames( const SampleImageCreator::CFractalFramePool& pool, Pylon::EFrameStorageMode mode,
+        const std::string& directory, uint32_t frameCount, std::vector<std::string>& createdFiles)
+    {
+        const SampleImageCreator::SFractalSettings& settings = pool.GetSettings();
+        const char* formatName = GetPixelTypeName( settings.PixelType);
+        std::vector<double> latencies;
+        latencies.reserve( frameCount);
+        char fileName[512];
+
+        Pylon::CFrameContainerWriter container;
+        const bool isContainer = mode == Pylon::FrameStorageMode_Container || mode == Pylon::FrameStorageMode_CompressedContainer;
+        if (isContainer)
+        {
+            if (mode == Pylon::FrameStorageMode_CompressedContainer)
+            {
+                Pylon::SLossless12Settings codecSettings;
+                codecSettings.NumThreads = 0;
+                container.SetEncoding( Pylon::FrameEncoding_Lossless12, codecSettings);
+            }
+            sprintf( fileName, "%s/bench-%s.frames", directory.c_str(), formatName);
+            container.Open( fileName);
+            createdFiles.push_back( fileName);
+        }
+
+        for (uint32_t i = 0; i < frameCount; ++i)
+        {
+            // The pool is read only, the storage functions take a non-const buffer like the grab results provide.
+            void* pBuffer = const_cast<void*>(pool.GetFrame( i));
+            CStopwatch stopwatch;
+
+            if (isContainer)
+            {
+                Pylon::SFrameContainerRecord record;
+                memset( &record, 0, sizeof( record));
+                record.PixelType = settings.PixelType;
+                record.Width = settings.Width;
+                record.Height = settings.Height;
+                record.TimeStamp = static_cast<uint64_t>(i) * 71428571; // 14 fps in ns.
+                record.BlockID = i + 1;
+                record.ImageNumber = i + 1;
+                container.Append( record, pBuffer, pool.GetFrameSize());
+            }
+            if (mode == Pylon::FrameStorageMode_RawAndPng || mode == Pylon::FrameStorageMode_Raw)
+            {
+                sprintf( fileName, "%s/bench-%s-%u.raw", directory.c_str(), formatName, i);
+                if (!Pylon::WriteRawFrame( fileName, pBuffer, pool.GetFrameSize()))
+                {
+                    throw RUNTIME_EXCEPTION( "Could not write %s.", fileName);
+                }
+                createdFiles.push_back( fileName);
+            }
+            if (mode == Pylon::FrameStorageMode_RawAndPng || mode == Pylon::FrameStorageMode_Png)
+            {
+                sprintf( fileName, "%s/bench-%s-%u.png", directory.c_str(), formatName, i);
+                Pylon::SavePngFrame( fileName, pBuffer, pool.GetFrameSize(), settings.PixelType, settings.Width, settings.Height, 0);
+                createdFiles.push_back( fileName);
+            }
+
+            latencies.push_back( stopwatch.GetSeconds());
+        }
+
+        // Closing the container writes the buffered frames, this is accounted to the last frame.
+        CStopwatch closeStopwatch;
+        container.Close();
+        if (!latencies.empty())
+        {
+            latencies.back() += closeStopwatch.GetSeconds();
+        }
+        return latencies;
+    }
+
+    inline void RunStorageBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace SampleImageCreator;
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        GetBenchmarkFrameSize( argc, argv, width, height);
+        const char* framesValue = Pylon::GetCommandLineOption( argc, argv, "-frames");
+        const uint32_t frameCount = framesValue != NULL ? std::max( 1, atoi( framesValue)) : 30;
+        const std::vector<std::string> directories = GetBenchmarkDirectories( argc, argv);
+        const bool keepFiles = HasCommandLineFlag( argc, argv, "-keep");
+
+        std::vector<Pylon::EFrameStorageMode> modes;
+        const char* modesValue = Pylon::GetCommandLineOption( argc, argv, "-modes");
+        if (modesValue != NULL)
+        {
+            const std::vector<std::string> names = SplitList( modesValue);
+            for (size_t i = 0; i < names.size(); ++i)
+            {
+                modes.push_back( Pylon::GetFrameStorageMode( names[i].c_str()));
+            }
+        }
+        else
+        {
+            modes.push_back( Pylon::FrameStorageMode_Raw);
+            modes.push_back( Pylon::FrameStorageMode_Png);
+            modes.push_back( Pylon::FrameStorageMode_RawAndPng);
+            modes.push_back( Pylon::FrameStorageMode_Container);
+            modes.push_back( Pylon::FrameStorageMode_CompressedContainer);
+        }
+
+        const Pylon::EPixelType pixelTypes[] = { Pylon::PixelType_Mono12, Pylon::PixelType_BayerGB12 };
+        for (size_t p = 0; p < sizeof( pixelTypes) / sizeof( pixelTypes[0]); ++p)
+        {
+            SFractalSettings settings;
+            settings.Width = width;
+            settings.Height = height;
+            settings.PixelType = pixelTypes[p];
+            CFractalFramePool pool;
+            pool.Create( settings, 8);
+
+            for (size_t d = 0; d < directories.size(); ++d)
+            {
+                for (size_t m = 0; m < modes.size(); ++m)
+                {
+                    std::vector<std::string> createdFiles;
+                    CCpuStopwatch stopwatch;
+                    const std::vector<double> latencies = StoreFrames( pool, modes[m], directories[d], frameCount, createdFiles);
+                    const double seconds = stopwatch.GetSeconds();
+                    const double cpuCores = stopwatch.GetCpuCores();
+
+                    if (!keepFiles)
+                    {
+                        for (size_t i = 0; i < createdFiles.size(); ++i)
+                        {
+                            remove( createdFiles[i].c_str());
+                        }
+                    }
+
+                    double meanLatency = 0.0;
+                    for (size_t i = 0; i < latencies.size(); ++i)
+                    {
+                        meanLatency += latencies[i];
+                    }
+                    meanLatency /= latencies.size();
+
+                    SBenchmarkResult result;
+                    result.Benchmark = "storage";
+                    result.Case = std::string( GetFrameStorageModeName( modes[m])) + " " + GetPixelTypeName( pixelTypes[p]) + " " + directories[d];
+                    result.Add( "frames", frameCount)
+                        .Add( "frames_per_s", frameCount / seconds)
+                        .Add( "mb_per_s", frameCount * static_cast<double>(pool.GetFrameSize()) / seconds * 1e-6)
+                        .Add( "mean_latency_ms", meanLatency * 1e3)
+                        .Add( "p99_latency_ms", GetPercentile( latencies, 99.0) * 1e3)
+                        .Add( "cpu_cores", cpuCores);
+                    report.Add( result);
+                }
+            }
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHSTORAGE_H_2296513 */
@@ -0,0 +1,198 @@
+// Contains the benchmark and the check of streaming long bursts with bounded memory.
+/*
+   A free-running synthetic Mono12 source delivers a burst of 10,000 frames, which the image event handler
+   passes to CBurstStreamWriter of include/BurstStreamWriter.h, returning every buffer to the source right
+   away. Kept as grab results the burst would need one buffer per frame, reported as pinned_mb.
+
+   The resident memory of the process is sampled by the handler every 64 frames. Reported are the memory
+   after the first tenth of the burst, when the arena and the buffers are in use, the peak after it and
+   their difference, which stays near 0 however long the burst is. Also reported are the frames written,
+   dropped for lack of a free slot and skipped by the source for lack of a buffer, the largest number of
+   frames queued for the writer and the rate written to disk. The container is read back to check that
+   every frame written is in it, in the order of the frame numbers.
+   Options: -size <width>x<height> (default 320x240), -frames <n> (default 10000), -fps <sensor rate> (default 500),
+   -arena <MB> (default 64), -dir <directory of the container> (default the current directory), -keep.
+*/
+
+#ifndef INCLUDED_BENCHSTREAM_H_2290415
+#define INCLUDED_BENCHSTREAM_H_2290415
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "BenchStorage.h"
+#include "../include/SyntheticFrameSource.h"
+#include "../include/BurstStreamWriter.h"
+#include "../include/FrameReplayReader.h"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace Benchmark
+{
+    // Streams the first frames of a source and samples the resident memory.
+    class CStreamBenchmarkHandler : public Pylon::CSyntheticImageEventHandler
+    {
+    public:
+        CStreamBenchmarkHandler( Pylon::CBurstStreamWriter& writer, size_t frameCount)
+            : m_writer( writer)
+            , m_frameCount( frameCount)
+            , m_grabbedCount( 0)
+            , m_skippedCount( 0)
+            , m_warmResidentBytes( 0)
+            , m_peakResidentBytes( 0)
+        {
+        }
+
+        virtual void OnImageGrabbed( Pylon::CSyntheticFrameSource& camera, const Pylon::CSyntheticGrabResultPtr& ptrGrabResult)
+        {
+            if (m_grabbedCount >= m_frameCount)
+            {
+                return;
+            }
+            m_writer.Add( ptrGrabResult, static_cast<uint32_t>(camera.GetCameraContext()));
+            m_skippedCount += static_cast<size_t>(ptrGrabResult->GetNumberOfSkippedImages());
+
+            if (m_grabbedCount % 64 == 0 || m_grabbedCount + 1 == m_frameCount)
+            {
+                const size_t residentBytes = GetProcessResidentBytes();
+                if (m_grabbedCount < m_frameCount / 10)
+                {
+                    m_warmResidentBytes = residentBytes;
+                }
+                else
+                {
+                    m_peakResidentBytes = std::max( m_peakResidentBytes, residentBytes);
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                ++m_grabbedCount;
+            }
+            m_condition.notify_all();
+        }
+
+        // Waits until the frames of the burst arrived. Returns false on timeout.
+        bool WaitForBurst( unsigned int timeoutMs)
+        {
+            std::unique_lock<std::mutex> lock( m_lock);
+            return m_condition.wait_for( lock, std::chrono::milliseconds( timeoutMs), [this]() { return m_grabbedCount >= m_frameCount; });
+        }
+
+        size_t GetSkippedCount() const
+        {
+            return m_skippedCount;
+        }
+
+        size_t GetWarmResidentBytes() const
+        {
+            return m_warmResidentBytes;
+        }
+
+        size_t GetPeakResidentBytes() const
+        {
+            return std::max( m_peakResidentBytes, m_warmResidentBytes);
+        }
+
+    private:
+        Pylon::CBurstStreamWriter& m_writer;
+        const size_t m_frameCount;
+        size_t m_grabbedCount;
+        size_t m_skippedCount;
+        size_t m_warmResidentBytes;
+        size_t m_peakResidentBytes;
+        std::mutex m_lock;
+        std::condition_variable m_condition;
+    };
+
+    inline void RunStreamBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace Pylon;
+
+        const char* value = NULL;
+        const size_t frameCount = (value = GetCommandLineOption( argc, argv, "-frames")) != NULL ? std::max( 1, atoi( value)) : 10000;
+        const std::string directory = (value = GetCommandLineOption( argc, argv, "-dir")) != NULL ? value : ".";
+        const std::string fileName = directory + "/bench-stream.frames";
+
+        SSyntheticFrameSourceSettings settings;
+        settings.Width = 320;
+        settings.Height = 240;
+        if (GetCommandLineOption( argc, argv, "-size") != NULL)
+        {
+            GetBenchmarkFrameSize( argc, argv, settings.Width, settings.Height);
+        }
+        settings.FrameRate = (value = GetCommandLineOption( argc, argv, "-fps")) != NULL ? atof( value) : 500.0;
+        settings.CycleLength = 4;
+
+        SBurstStreamSettings streamSettings;
+        streamSettings.ArenaSize = static_cast<size_t>((value = GetCommandLineOption( argc, argv, "-arena")) != NULL ? std::max( 1, atoi( value)) : 64) * 1024 * 1024;
+        CBurstStreamWriter writer( streamSettings);
+        writer.Open( fileName.c_str());
+
+        CSyntheticFrameSource source( settings);
+        CStreamBenchmarkHandler* pHandler = new CStreamBenchmarkHandler( writer, frameCount);
+        source.RegisterImageEventHandler( pHandler, RegistrationMode_Append, Cleanup_Delete);
+        // As many buffers as Grab_StateMachine uses for a burst of 15 frames.
+        source.MaxNumBuffer = 17;
+        source.Open();
+
+        CCpuStopwatch stopwatch;
+        source.StartGrabbing( GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+        const bool isComplete = pHandler->WaitForBurst( static_cast<unsigned int>(frameCount / settings.FrameRate * 2000.0) + 10000);
+        source.StopGrabbing();
+        const double grabSeconds = stopwatch.GetSeconds();
+        writer.Close();
+        const double seconds = stopwatch.GetSeconds();
+        const double cpuCores = stopwatch.GetCpuCores();
+        if (!isComplete)
+        {
+            throw RUNTIME_EXCEPTION( "The burst of %u frames did not arrive.", static_cast<unsigned int>(frameCount));
+        }
+
+        // Every frame written is in the container, in order.
+        size_t storedCount = 0;
+        {
+            CFrameReplayReader reader;
+            reader.Open( std::vector<std::string>( 1, fileName));
+            storedCount = reader.GetFrameCount();
+            for (size_t i = 1; i < storedCount; ++i)
+            {
+                if (reader.GetRecord( i).ImageNumber <= reader.GetRecord( i - 1).ImageNumber)
+                {
+                    throw RUNTIME_EXCEPTION( "Frame %u of the stream is out of order.", static_cast<unsigned int>(i));
+                }
+            }
+        }
+        if (storedCount != writer.GetWrittenCount() || writer.GetWrittenCount() + writer.GetDroppedCount() != frameCount)
+        {
+            throw RUNTIME_EXCEPTION( "The stream holds %u of %u frames.", static_cast<unsigned int>(storedCount), static_cast<unsigned int>(frameCount));
+        }
+
+        const double frameSize = settings.Width * static_cast<double>(settings.Height) * SyntheticBytesPerPixel( settings.PixelType);
+        SBenchmarkResult result;
+        result.Benchmark = "stream";
+        result.Case = "burst";
+        result.Add( "frames", static_cast<double>(frameCount))
+            .Add( "written", static_cast<double>(writer.GetWrittenCount()))
+            .Add( "dropped", static_cast<double>(writer.GetDroppedCount()))
+            .Add( "skipped", static_cast<double>(pHandler->GetSkippedCount()))
+            .Add( "fps", frameCount / grabSeconds)
+            .Add( "write_mb_per_s", writer.GetBytesWritten() / seconds / 1048576.0)
+            .Add( "cpu_cores", cpuCores)
+            .Add( "arena_mb", writer.GetArenaSize() / 1048576.0)
+            .Add( "max_queued", static_cast<double>(writer.GetMaxQueuedCount()))
+            .Add( "slots", static_cast<double>(writer.GetSlotCount()))
+            .Add( "pinned_mb", frameCount * frameSize / 1048576.0)
+            .Add( "rss_warm_mb", pHandler->GetWarmResidentBytes() / 1048576.0)
+            .Add( "rss_peak_mb", pHandler->GetPeakResidentBytes() / 1048576.0)
+            .Add( "rss_growth_mb", (static_cast<double>(pHandler->GetPeakResidentBytes()) - pHandler->GetWarmResidentBytes()) / 1048576.0);
+        report.Add( result);
+
+        if (!HasCommandLineFlag( argc, argv, "-keep"))
+        {
+            remove( fileName.c_str());
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHSTREAM_H_2290415 */
@@ -0,0 +1,174 @@
+// Contains the benchmark and the check of the frame time series.
+/*
+   The times of a run of 2 cameras at 14 fps with 50 us of jitter and a lost frame every 1000 frames are
+   recorded in CFrameTimeSeries of include/FrameTimeSeries.h and summarized:
+       record      the time to set the host and the camera time of a frame, with the columns allocated
+                   for the run by Reset() and growing by chunks from empty
+       summary     the time of GetFrameTiming() of a column compared with GetFrameTiming() of FrameTiming.h
+                   on the times as double seconds, and the largest relative difference of their figures
+       export      the time and the size of the CSV and the binary export
+   Options: -frames <n> (default 100000), -repeat <n> (default 20), -dir <directory of the exports>
+   (default the current directory), -keep.
+*/
+
+#ifndef INCLUDED_BENCHTIMESERIES_H_3864207
+#define INCLUDED_BENCHTIMESERIES_H_3864207
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "BenchStorage.h"
+#include "../include/FrameTimeSeries.h"
+
+#include <random>
+
+namespace Benchmark
+{
+    inline double GetRelativeDifference( double a, double b)
+    {
+        return std::abs( a - b) / std::max( std::abs( b), 1e-300);
+    }
+
+    inline double GetFileMegabytes( const std::string& fileName)
+    {
+        FILE* pFile = fopen( fileName.c_str(), "rb");
+        if (pFile == NULL)
+        {
+            return 0.0;
+        }
+        fseek( pFile, 0, SEEK_END);
+        const long size = ftell( pFile);
+        fclose( pFile);
+        return size / 1048576.0;
+    }
+
+    inline void RunTimeSeriesBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace Pylon;
+
+        const char* value = NULL;
+        const size_t frameCount = (value = GetCommandLineOption( argc, argv, "-frames")) != NULL ? std::max( 2, atoi( value)) : 100000;
+        const uint32_t repeat = GetBenchmarkRepeat( argc, argv, 20);
+        const std::string directory = (value = GetCommandLineOption( argc, argv, "-dir")) != NULL ? value : ".";
+        const size_t cameraCount = 2;
+
+        std::mt19937 random( 1414);
+        std::normal_distribution<double> jitter( 0.0, 50000.0);
+        std::vector< std::vector<int64_t> > hostTimes( cameraCount, std::vector<int64_t>( frameCount));
+        std::vector< std::vector<int64_t> > cameraTimes( cameraCount, std::vector<int64_t>( frameCount));
+        for (size_t i = 0; i < cameraCount; ++i)
+        {
+            int64_t frameStart = 1000000000LL * static_cast<int64_t>(i + 1);
+            for (size_t f = 0; f < frameCount; ++f)
+            {
+                frameStart += 71428571 * (f % 1000 == 999 ? 2 : 1);
+                cameraTimes[i][f] = frameStart + static_cast<int64_t>(jitter( random));
+                hostTimes[i][f] = cameraTimes[i][f] + 3000000 + static_cast<int64_t>(std::abs( jitter( random)));
+            }
+        }
+
+        CFrameTimeSeries series;
+        for (int isReserved = 1; isReserved >= 0; --isReserved)
+        {
+            std::vector<double> nsPerFrame;
+            for (uint32_t r = 0; r < repeat; ++r)
+            {
+                // From empty, the chunks of the previous pass are freed.
+                if (!isReserved)
+                {
+                    series = CFrameTimeSeries();
+                }
+                series.Reset( cameraCount, isReserved ? frameCount : 0);
+                CStopwatch stopwatch;
+                for (size_t f = 0; f < frameCount; ++f)
+                {
+                    for (size_t i = 0; i < cameraCount; ++i)
+                    {
+                        series.SetHostTime( i, f, hostTimes[i][f]);
+                        series.SetCameraTime( i, f, cameraTimes[i][f]);
+                    }
+                }
+                nsPerFrame.push_back( stopwatch.GetSeconds() / (frameCount * cameraCount) * 1e9);
+            }
+
+            SBenchmarkResult result;
+            result.Benchmark = "timeseries";
+            result.Case = isReserved ? "record reserved" : "record growing";
+            result.Add( "frames", static_cast<double>(frameCount))
+                .Add( "cameras", static_cast<double>(cameraCount))
+                .Add( "ns_per_frame", GetPercentile( nsPerFrame, 50.0))
+                .Add( "checksum", static_cast<double>(series.GetCameraTimes( 1)[frameCount / 2] % 1000));
+            report.Add( result);
+        }
+
+        {
+            std::vector<double> seconds( frameCount);
+            for (size_t f = 0; f < frameCount; ++f)
+            {
+                seconds[f] = 1e-9 * cameraTimes[0][f];
+            }
+            SFrameTiming timing;
+            CStopwatch stopwatch;
+            for (uint32_t r = 0; r < repeat; ++r)
+            {
+                timing = GetFrameTiming( series.GetCameraTimes( 0));
+            }
+            const double columnSeconds = stopwatch.GetSeconds() / repeat;
+            SFrameTiming reference;
+            CStopwatch referenceStopwatch;
+            for (uint32_t r = 0; r < repeat; ++r)
+            {
+                reference = GetFrameTiming( seconds);
+            }
+            const double referenceSeconds = referenceStopwatch.GetSeconds() / repeat;
+
+            const double difference = std::max( std::max( GetRelativeDifference( timing.MeanInterval, reference.MeanInterval),
+                GetRelativeDifference( timing.IntervalJitter, reference.IntervalJitter)),
+                std::max( GetRelativeDifference( timing.MinInterval, reference.MinInterval), GetRelativeDifference( timing.MaxInterval, reference.MaxInterval)));
+            if (timing.FrameCount != reference.FrameCount || difference > 1e-6)
+            {
+                throw RUNTIME_EXCEPTION( "The timing of the time series differs from the reference by %g.", difference);
+            }
+
+            SBenchmarkResult result;
+            result.Benchmark = "timeseries";
+            result.Case = "summary";
+            result.Add( "frames", static_cast<double>(frameCount))
+                .Add( "us_per_summary", columnSeconds * 1e6)
+                .Add( "reference_us", referenceSeconds * 1e6)
+                .Add( "speedup", referenceSeconds / columnSeconds)
+                .Add( "fps", timing.FrameRate)
+                .Add( "jitter_ms", timing.IntervalJitter * 1e3)
+                .Add( "max_interval_ms", timing.MaxInterval * 1e3)
+                .Add( "max_rel_difference", difference);
+            report.Add( result);
+        }
+
+        {
+            const std::string csvName = directory + "/bench-times.csv";
+            const std::string binaryName = directory + "/bench-times.bin";
+            CStopwatch csvStopwatch;
+            series.WriteCsv( csvName.c_str());
+            const double csvSeconds = csvStopwatch.GetSeconds();
+            CStopwatch binaryStopwatch;
+            series.WriteBinary( binaryName.c_str());
+            const double binarySeconds = binaryStopwatch.GetSeconds();
+
+            SBenchmarkResult result;
+            result.Benchmark = "timeseries";
+            result.Case = "export";
+            result.Add( "csv_ms", csvSeconds * 1e3)
+                .Add( "csv_mb", GetFileMegabytes( csvName))
+                .Add( "binary_ms", binarySeconds * 1e3)
+                .Add( "binary_mb", GetFileMegabytes( binaryName));
+            report.Add( result);
+
+            if (!HasCommandLineFlag( argc, argv, "-keep"))
+            {
+                remove( csvName.c_str());
+                remove( binaryName.c_str());
+            }
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHTIMESERIES_H_3864207 */
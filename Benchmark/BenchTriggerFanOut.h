@@ -0,0 +1,153 @@
+// Contains the benchmark of the skew between the exposures of cameras triggered together.
+/*
+   2 to 8 synthetic frame sources are triggered for -sets frames each, once one after the other as
+   Grab_Syncronous did it and once with CTriggerFanOut of include/TriggerFanOut.h. The skew of every set
+   is the spread of the Timestamp chunks of its frames on the host clock, with the clock offsets measured
+   by GetCameraClockOffset(). The sources emulate the time a software trigger takes, the default is an
+   assumed value for USB cameras; sequential triggering adds it once per camera.
+   Reported are the median, 99th percentile and maximum skew of the sets, the median spread of the host
+   times the triggers were fired and the largest uncertainty of the clock offsets.
+   Options: -cameras <n> (default 8), -sets <n> (default 50), -write-latency <us> (default 250),
+   -no-pin.
+*/
+
+#ifndef INCLUDED_BENCHTRIGGERFANOUT_H_5530718
+#define INCLUDED_BENCHTRIGGERFANOUT_H_5530718
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "BenchStorage.h"
+#include "../include/SyntheticFrameSource.h"
+#include "../include/TriggerFanOut.h"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace Benchmark
+{
+    // Stores the Timestamp chunks of the frames of every camera.
+    class CTriggerFanOutBenchmarkHandler : public Pylon::CSyntheticImageEventHandler
+    {
+    public:
+        CTriggerFanOutBenchmarkHandler( Pylon::CFrameTimeSeries& times)
+            : m_times( times)
+            , m_frameCounts( times.GetCameraCount(), 0)
+        {
+        }
+
+        virtual void OnImageGrabbed( Pylon::CSyntheticFrameSource& camera, const Pylon::CSyntheticGrabResultPtr& ptrGrabResult)
+        {
+            const size_t index = static_cast<size_t>(camera.GetCameraContext());
+            m_times.SetCameraTime( index, m_frameCounts[index], ptrGrabResult->ChunkTimestamp.GetValue());
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                ++m_frameCounts[index];
+            }
+            m_condition.notify_all();
+        }
+
+        // Waits until every camera delivered count frames. Returns false on timeout.
+        bool WaitForFrames( size_t count, unsigned int timeoutMs)
+        {
+            std::unique_lock<std::mutex> lock( m_lock);
+            return m_condition.wait_for( lock, std::chrono::milliseconds( timeoutMs), [this, count]()
+            {
+                return *std::min_element( m_frameCounts.begin(), m_frameCounts.end()) >= count;
+            });
+        }
+
+    private:
+        Pylon::CFrameTimeSeries& m_times;
+        std::mutex m_lock;
+        std::condition_variable m_condition;
+        std::vector<size_t> m_frameCounts;
+    };
+
+    inline void RunTriggerFanOutBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace Pylon;
+
+        const char* value = NULL;
+        const size_t maxCameraCount = (value = GetCommandLineOption( argc, argv, "-cameras")) != NULL ? std::max( 2, atoi( value)) : 8;
+        const uint32_t setCount = (value = GetCommandLineOption( argc, argv, "-sets")) != NULL ? std::max( 1, atoi( value)) : 50;
+
+        SSyntheticFrameSourceSettings settings;
+        settings.Width = 320;
+        settings.Height = 240;
+        settings.PixelType = PixelType_Mono8;
+        settings.FrameRate = 500.0;
+        settings.CycleLength = 1;
+        settings.WriteLatencyUs = (value = GetCommandLineOption( argc, argv, "-write-latency")) != NULL ? atof( value) : 250.0;
+        STriggerFanOutSettings fanOutSettings;
+        fanOutSettings.PinThreads = !HasCommandLineFlag( argc, argv, "-no-pin");
+
+        for (size_t cameraCount = 2; cameraCount <= maxCameraCount; ++cameraCount)
+        {
+            for (int isCoordinated = 0; isCoordinated < 2; ++isCoordinated)
+            {
+                CSyntheticFrameSourceArray cameras( cameraCount, settings);
+                CFrameTimeSeries times( cameraCount, setCount);
+                CTriggerFanOutBenchmarkHandler* pHandler = new CTriggerFanOutBenchmarkHandler( times);
+                std::vector<SCameraClockOffset> offsets;
+                for (size_t i = 0; i < cameraCount; ++i)
+                {
+                    // The handler is shared, only the first registration deletes it.
+                    cameras[i].RegisterImageEventHandler( pHandler, RegistrationMode_Append, i == 0 ? Cleanup_Delete : Cleanup_None);
+                    cameras[i].Open();
+                    cameras[i].ExposureTime.SetValue( 100.0);
+                    ConfigureSoftwareTrigger( cameras[i]);
+                    cameras[i].StartGrabbing( GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+                    offsets.push_back( GetCameraClockOffset( cameras[i]));
+                }
+
+                CTriggerFanOut<CSyntheticFrameSourceArray> fanOut( cameras, fanOutSettings);
+                std::vector<double> fireSkews;
+                std::vector<int64_t> fireTimes;
+                for (uint32_t s = 0; s < setCount; ++s)
+                {
+                    const bool isFired = isCoordinated ? fanOut.Fire() : FireSequentially( cameras, fanOutSettings.ReadyTimeoutMs, &fireTimes);
+                    if (!isFired)
+                    {
+                        throw RUNTIME_EXCEPTION( "The cameras were not ready for trigger set %u.", s);
+                    }
+                    if (isCoordinated)
+                    {
+                        fireTimes = fanOut.GetFireTimes();
+                    }
+                    fireSkews.push_back( static_cast<double>(*std::max_element( fireTimes.begin(), fireTimes.end()) - *std::min_element( fireTimes.begin(), fireTimes.end())));
+                }
+                const bool isComplete = pHandler->WaitForFrames( setCount, 5000);
+                cameras.StopGrabbing();
+                if (!isComplete)
+                {
+                    throw RUNTIME_EXCEPTION( "The frames of the trigger sets did not arrive.");
+                }
+
+                const std::vector<int64_t> skewsNs = GetTriggerSkewsNs( times, offsets);
+                if (skewsNs.size() != setCount)
+                {
+                    throw RUNTIME_EXCEPTION( "%u of %u trigger sets have the time stamps of all cameras.", static_cast<unsigned int>(skewsNs.size()), setCount);
+                }
+                std::vector<double> skews( skewsNs.begin(), skewsNs.end());
+                int64_t uncertaintyNs = 0;
+                for (size_t i = 0; i < offsets.size(); ++i)
+                {
+                    uncertaintyNs = std::max( uncertaintyNs, offsets[i].UncertaintyNs);
+                }
+
+                SBenchmarkResult result;
+                result.Benchmark = "trigger";
+                result.Case = isCoordinated ? "coordinated" : "sequential";
+                result.Add( "cameras", static_cast<double>(cameraCount))
+                    .Add( "skew_us", GetPercentile( skews, 50.0) * 1e-3)
+                    .Add( "skew_p99_us", GetPercentile( skews, 99.0) * 1e-3)
+                    .Add( "skew_max_us", *std::max_element( skews.begin(), skews.end()) * 1e-3)
+                    .Add( "fire_skew_us", GetPercentile( fireSkews, 50.0) * 1e-3)
+                    .Add( "offset_uncertainty_us", uncertaintyNs * 1e-3);
+                report.Add( result);
+            }
+        }
+    }
+}
+
+#endif /* INCLUDED_BENCHTRIGGERFANOUT_H_5530718 */
@@ -0,0 +1,197 @@
+// Contains the benchmark of the frame views of include/FrameView.h.
+/*
+   Several consumers each take their own rectangle of the same Mono12 frame and sum its pixels row by row.
+   The rectangles are extracted per frame:
+       copy image   copied into a new CPylonImage per rectangle, as the samples did
+       copy reused  copied into buffers allocated once
+       view         cropped from a CFrameView of the frame, without copying
+   Reported are the time per frame of the extraction alone and with the consumers, and the speedup of the
+   views over the copies into images. All cases must give the same sums. The Bayer check crops a
+   BayerGB12 frame at every phase and requires the statistics of the views to find the colors in their
+   places.
+   Options: -size <width>x<height> (default 2592x1944), -rois <n> (default 8), -roi <width>x<height>
+   (default 256x256), -repeat <n> frames (default 50).
+*/
+
+#ifndef INCLUDED_BENCHVIEWS_H_8024613
+#define INCLUDED_BENCHVIEWS_H_8024613
+
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "../include/FrameView.h"
+#include "../include/FrameStatistics.h"
+
+namespace Benchmark
+{
+    // The consumer of a rectangle, the sum of its pixels.
+    inline uint64_t SumViewPixels( const Pylon::CFrameView& view)
+    {
+        uint64_t sum = 0;
+        for (uint32_t y = 0; y < view.GetHeight(); ++y)
+        {
+            const uint16_t* pRow = view.GetRow<uint16_t>( y);
+            for (uint32_t x = 0; x < view.GetWidth(); ++x)
+            {
+                sum += pRow[x];
+            }
+        }
+        return sum;
+    }
+
+    inline void AddViewResult( CBenchmarkReport& report, const char* benchmarkCase, size_t roiCount, const std::vector<double>& extractSeconds,
+        const std::vector<double>& totalSeconds, double referenceTotalSeconds, uint64_t checksum)
+    {
+        const double total = GetPercentile( totalSeconds, 50.0);
+        SBenchmarkResult result;
+        result.Benchmark = "views";
+        result.Case = benchmarkCase;
+        result.Add( "rois", static_cast<double>(roiCount))
+            .Add( "extract_us", GetPercentile( extractSeconds, 50.0) * 1e6)
+            .Add( "total_us", total * 1e6)
+            .Add( "speedup", referenceTotalSeconds > 0.0 ? referenceTotalSeconds / total : 1.0)
+            .Add( "checksum", static_cast<double>(checksum % 1000000));
+        report.Add( result);
+    }
+
+    // Checks that the views of a Bayer frame cropped at every phase keep the colors of the pixels.
+    inline void CheckBayerViews( uint32_t width, uint32_t height)
+    {
+        using namespace Pylon;
+
+        // BayerGB: green and blue in the even rows, red and green in the odd rows.
+        std::vector<uint16_t> frame( static_cast<size_t>(width) * height);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                frame[static_cast<size_t>(y) * width + x] = static_cast<uint16_t>((x + y) % 2 == 0 ? 200 : y % 2 == 0 ? 300 : 100);
+            }
+        }
+        const CFrameView view( &frame[0], PixelType_BayerGB12, width, height, width * sizeof( uint16_t));
+        SFrameStatisticsSettings settings;
+        settings.ComputeHistogram = false;
+        CFrameStatisticsCalculator calculator( settings);
+        for (uint32_t phase = 0; phase < 4; ++phase)
+        {
+            const CFrameView crops[2] = { view.Crop( phase & 1, phase >> 1, width - 2, height - 2), view.CropBayerCells( phase & 1, phase >> 1, width - 4, height - 4) };
+            for (int c = 0; c < 2; ++c)
+            {
+                SFrameStatistics statistics;
+                calculator.Compute( crops[c].GetBuffer(), crops[c].GetPixelType(), crops[c].GetWidth(), crops[c].GetHeight(), crops[c].GetPaddingX(), statistics);
+                if (statistics.Channels[StatisticsChannel_Red].Mean != 100.0 || statistics.Channels[StatisticsChannel_Green].Mean != 200.0
+                    || statistics.Channels[StatisticsChannel_Blue].Mean != 300.0)
+                {
+                    throw RUNTIME_EXCEPTION( "The Bayer view cropped at %u, %u has the colors %g, %g, %g.", phase & 1, phase >> 1,
+                        statistics.Channels[StatisticsChannel_Red].Mean, statistics.Channels[StatisticsChannel_Green].Mean, statistics.Channels[StatisticsChannel_Blue].Mean);
+                }
+            }
+        }
+    }
+
+    inline void RunViewBenchmark( int argc, char* argv[], CBenchmarkReport& report)
+    {
+        using namespace Pylon;
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        GetBenchmarkFrameSize( argc, argv, width, height);
+        const uint32_t repeat = GetBenchmarkRepeat( argc, argv, 50);
+        const char* value = NULL;
+        const size_t roiCount = (value = GetCommandLineOption( argc, argv, "-rois")) != NULL ? std::max( 1, atoi( value)) : 8;
+        unsigned int roiWidth = 256;
+        unsigned int roiHeight = 256;
+        if ((value = GetCommandLineOption( argc, argv, "-roi")) != NULL
+            && (sscanf( value, "%ux%u", &roiWidth, &roiHeight) != 2 || roiWidth == 0 || roiHeight == 0 || roiWidth > width || roiHeight > height))
+        {
+            throw RUNTIME_EXCEPTION( "Invalid rectangle size %s. Expected <width>x<height> within the frame.", value);
+        }
+
+        // The frame is owned like a grab result, by a shared pointer held by the views.
+        std::shared_ptr< std::vector<uint16_t> > ptrFrame = std::make_shared< std::vector<uint16_t> >( static_cast<size_t>(width) * height);
+        for (size_t i = 0; i < ptrFrame->size(); ++i)
+        {
+            (*ptrFrame)[i] = static_cast<uint16_t>((i * 2654435761u) >> 20 & 0xFFF);
+        }
+        std::vector<uint32_t> roiX( roiCount);
+        std::vector<uint32_t> roiY( roiCount);
+        for (size_t r = 0; r < roiCount; ++r)
+        {
+            // Spread over the frame, at odd and even positions.
+            roiX[r] = static_cast<uint32_t>((r * 7919 + 13) % (width - roiWidth + 1));
+            roiY[r] = static_cast<uint32_t>((r * 104729 + 7) % (height - roiHeight + 1));
+        }
+
+        std::vector<double> imageExtract, imageTotal, reusedExtract, reusedTotal, viewExtract, viewTotal;
+        uint64_t imageChecksum = 0;
+        uint64_t reusedChecksum = 0;
+        uint64_t viewChecksum = 0;
+        std::vector< std::vector<uint16_t> > reusedBuffers( roiCount, std::vector<uint16_t>( static_cast<size_t>(roiWidth) * roiHeight));
+        for (uint32_t f = 0; f < repeat; ++f)
+        {
+            const CFrameView frame( &(*ptrFrame)[0], PixelType_Mono12, width, height, width * sizeof( uint16_t), ptrFrame);
+
+            {
+                imageChecksum = 0;
+                CStopwatch stopwatch;
+                std::vector<CPylonImage> images( roiCount);
+                for (size_t r = 0; r < roiCount; ++r)
+                {
+                    images[r] = CPylonImage::Create( PixelType_Mono12, roiWidth, roiHeight);
+                    frame.Crop( roiX[r], roiY[r], roiWidth, roiHeight).CopyTo( images[r].GetBuffer(), roiWidth * sizeof( uint16_t));
+                }
+                imageExtract.push_back( stopwatch.GetSeconds());
+                for (size_t r = 0; r < roiCount; ++r)
+                {
+                    imageChecksum += SumViewPixels( CFrameView( images[r].GetBuffer(), PixelType_Mono12, roiWidth, roiHeight, roiWidth * sizeof( uint16_t)));
+                }
+                imageTotal.push_back( stopwatch.GetSeconds());
+            }
+            {
+                reusedChecksum = 0;
+                CStopwatch stopwatch;
+                for (size_t r = 0; r < roiCount; ++r)
+                {
+                    frame.Crop( roiX[r], roiY[r], roiWidth, roiHeight).CopyTo( &reusedBuffers[r][0], roiWidth * sizeof( uint16_t));
+                }
+                reusedExtract.push_back( stopwatch.GetSeconds());
+                for (size_t r = 0; r < roiCount; ++r)
+                {
+                    reusedChecksum += SumViewPixels( CFrameView( &reusedBuffers[r][0], PixelType_Mono12, roiWidth, roiHeight, roiWidth * sizeof( uint16_t)));
+                }
+                reusedTotal.push_back( stopwatch.GetSeconds());
+            }
+            {
+                viewChecksum = 0;
+                CStopwatch stopwatch;
+                std::vector<CFrameView> views( roiCount);
+                for (size_t r = 0; r < roiCount; ++r)
+                {
+                    views[r] = frame.Crop( roiX[r], roiY[r], roiWidth, roiHeight);
+                }
+                viewExtract.push_back( stopwatch.GetSeconds());
+                for (size_t r = 0; r < roiCount; ++r)
+                {
+                    viewChecksum += SumViewPixels( views[r]);
+                }
+                viewTotal.push_back( stopwatch.GetSeconds());
+            }
+        }
+        if (reusedChecksum != imageChecksum || viewChecksum != imageChecksum)
+        {
+            throw RUNTIME_EXCEPTION( "The views gave other sums than the copies.");
+        }
+        // Only the test holds the frame once the views are released.
+        if (ptrFrame.use_count() != 1)
+        {
+            throw RUNTIME_EXCEPTION( "The views did not release the frame.");
+        }
+        CheckBayerViews( 64, 48);
+
+        const double referenceTotal = GetPercentile( imageTotal, 50.0);
+        AddViewResult( report, "copy image", roiCount, imageExtract, imageTotal, 0.0, imageChecksum);
+        AddViewResult( report, "copy reused", roiCount, reusedExtract, reusedTotal, referenceTotal, reusedChecksum);
+        AddViewResult( report, "view", roiCount, viewExtract, viewTotal, referenceTotal, viewChecksum);
+    }
+}
+
+#endif /* INCLUDED_BENCHVIEWS_H_8024613 */
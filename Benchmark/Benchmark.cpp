@@ -0,0 +1,136 @@
+// Benchmark.cpp
+/*
+   This program measures the throughput of the image processing building blocks used by the samples.
+   It does not need a camera, the input frames are created synthetically and the node maps are the ones
+   of the pylon camera emulator.
+
+   Usage: Benchmark [-b <name>] [-json <file>] [benchmark options]
+   Without -b all benchmarks are run. The results are printed and, with -json, written to a file.
+*/
+
+// Include files to use the PYLON API.
+#include <pylon/PylonIncludes.h>
+
+// Include files of the benchmarks.
+#include "BenchmarkReport.h"
+#include "BenchFractal.h"
+#include "BenchStorage.h"
+#include "BenchReplay.h"
+#include "BenchCodec.h"
+#include "BenchStatistics.h"
+#include "BenchAutoExposure.h"
+#include "BenchModeSwitch.h"
+#include "BenchBurst.h"
+#include "BenchPreview.h"
+#include "BenchBracket.h"
+#include "BenchHdr.h"
+#include "BenchStack.h"
+#include "BenchCalibration.h"
+#include "BenchStream.h"
+#include "BenchTimeSeries.h"
+#include "BenchNodes.h"
+#include "BenchRoi.h"
+#include "BenchViews.h"
+#include "BenchMetadata.h"
+#include "BenchSharedRing.h"
+#include "BenchFrameStream.h"
+#include "BenchTriggerFanOut.h"
+
+// Namespace for using pylon objects.
+using namespace Pylon;
+
+// Namespace for using cout.
+using namespace std;
+
+typedef void (*BenchmarkFunction_t)( int argc, char* argv[], Benchmark::CBenchmarkReport& report);
+
+struct SBenchmarkEntry
+{
+    const char* Name;
+    BenchmarkFunction_t Function;
+};
+
+// The benchmarks that can be selected with -b.
+static const SBenchmarkEntry c_benchmarks[] =
+{
+    { "fractal", Benchmark::RunFractalBenchmark },
+    { "storage", Benchmark::RunStorageBenchmark },
+    { "replay", Benchmark::RunReplayBenchmark },
+    { "codec", Benchmark::RunCodecBenchmark },
+    { "stats", Benchmark::RunStatisticsBenchmark },
+    { "ae", Benchmark::RunAutoExposureBenchmark },
+    { "switch", Benchmark::RunModeSwitchBenchmark },
+    { "burst", Benchmark::RunBurstBenchmark },
+    { "preview", Benchmark::RunPreviewBenchmark },
+    { "bracket", Benchmark::RunBracketBenchmark },
+    { "hdr", Benchmark::RunHdrBenchmark },
+    { "stack", Benchmark::RunStackBenchmark },
+    { "calibration", Benchmark::RunCalibrationBenchmark },
+    { "stream", Benchmark::RunStreamBenchmark },
+    { "timeseries", Benchmark::RunTimeSeriesBenchmark },
+    { "nodes", Benchmark::RunNodeBenchmark },
+    { "roi", Benchmark::RunRoiBenchmark },
+    { "views", Benchmark::RunViewBenchmark },
+    { "metadata", Benchmark::RunMetadataBenchmark },
+    { "shm", Benchmark::RunSharedRingBenchmark },
+    { "tcp", Benchmark::RunFrameStreamBenchmark },
+    { "trigger", Benchmark::RunTriggerFanOutBenchmark }
+};
+
+int main(int argc, char* argv[])
+{
+    // The exit code of the program.
+    int exitCode = 0;
+
+    // The node access benchmark reads the node map of the pylon camera emulator.
+    if (getenv( "PYLON_CAMEMU") == NULL)
+    {
+        EnableCameraEmulator( 1);
+    }
+
+    // Automagically call PylonInitialize and PylonTerminate to ensure the pylon runtime system
+    // is initialized during the lifetime of this object.
+    Pylon::PylonAutoInitTerm autoInitTerm;
+
+    try
+    {
+        const char* selected = GetCommandLineOption( argc, argv, "-b");
+        Benchmark::CBenchmarkReport report;
+        bool found = false;
+
+        for (size_t i = 0; i < sizeof( c_benchmarks) / sizeof( c_benchmarks[0]); ++i)
+        {
+            if (selected == NULL || strcmp( selected, c_benchmarks[i].Name) == 0)
+            {
+                found = true;
+                c_benchmarks[i].Function( argc, argv, report);
+            }
+        }
+
+        if (!found)
+        {
+            cerr << "Unknown benchmark " << selected << ". Available:";
+            for (size_t i = 0; i < sizeof( c_benchmarks) / sizeof( c_benchmarks[0]); ++i)
+            {
+                cerr << " " << c_benchmarks[i].Name;
+            }
+            cerr << endl;
+            return 1;
+        }
+
+        const char* jsonFileName = GetCommandLineOption( argc, argv, "-json");
+        if (jsonFileName != NULL)
+        {
+            report.WriteJson( jsonFileName);
+        }
+    }
+    catch (GenICam::GenericException &e)
+    {
+        // Error handling.
+        cerr << "An exception occurred." << endl
+        << e.GetDescription() << endl;
+        exitCode = 1;
+    }
+
+    return exitCode;
+}
@@ -0,0 +1,236 @@
+// Contains the measurement helpers and the result report of the benchmark program.
+/*
+   Every benchmark adds its results as named metrics to a CBenchmarkReport. The report prints one line
+   per result and can write all results to a JSON file for comparing runs.
+*/
+
+#ifndef INCLUDED_BENCHMARKREPORT_H_6402215
+#define INCLUDED_BENCHMARKREPORT_H_6402215
+
+#include <pylon/PylonIncludes.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#    include <psapi.h>
+#else
+#    include <sys/resource.h>
+#    include <unistd.h>
+#endif
+
+namespace Benchmark
+{
+    // Measures wall clock time.
+    class CStopwatch
+    {
+    public:
+        CStopwatch()
+            : m_start( std::chrono::steady_clock::now())
+        {
+        }
+
+        void Restart()
+        {
+            m_start = std::chrono::steady_clock::now();
+        }
+
+        double GetSeconds() const
+        {
+            return std::chrono::duration<double>( std::chrono::steady_clock::now() - m_start).count();
+        }
+
+    private:
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    // Returns the user and kernel CPU time consumed by all threads of the process so far.
+    inline double GetProcessCpuSeconds()
+    {
+#if defined(_WIN32)
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+        if (!GetProcessTimes( GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+        {
+            return 0.0;
+        }
+        const double kernel = ((static_cast<uint64_t>(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime) * 1e-7;
+        const double user = ((static_cast<uint64_t>(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime) * 1e-7;
+        return kernel + user;
+#else
+        struct rusage usage;
+        if (getrusage( RUSAGE_SELF, &usage) != 0)
+        {
+            return 0.0;
+        }
+        return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+#endif
+    }
+
+    // Returns the memory of the process currently resident in RAM, the working set on Windows, in bytes.
+    inline size_t GetProcessResidentBytes()
+    {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters;
+        if (!GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters)))
+        {
+            return 0;
+        }
+        return counters.WorkingSetSize;
+#else
+        FILE* pFile = fopen( "/proc/self/statm", "r");
+        if (pFile == NULL)
+        {
+            return 0;
+        }
+        unsigned long totalPages = 0;
+        unsigned long residentPages = 0;
+        const int count = fscanf( pFile, "%lu %lu", &totalPages, &residentPages);
+        fclose( pFile);
+        return count == 2 ? static_cast<size_t>(residentPages) * static_cast<size_t>(sysconf( _SC_PAGESIZE)) : 0;
+#endif
+    }
+
+    // Measures the wall clock time and the CPU time of a section. The CPU load is given in cores, 1.0 is one fully used core.
+    class CCpuStopwatch
+    {
+    public:
+        CCpuStopwatch()
+            : m_cpuStart( GetProcessCpuSeconds())
+        {
+        }
+
+        void Restart()
+        {
+            m_wall.Restart();
+            m_cpuStart = GetProcessCpuSeconds();
+        }
+
+        double GetSeconds() const
+        {
+            return m_wall.GetSeconds();
+        }
+
+        double GetCpuSeconds() const
+        {
+            return GetProcessCpuSeconds() - m_cpuStart;
+        }
+
+        double GetCpuCores() const
+        {
+            const double wall = GetSeconds();
+            return wall > 0.0 ? GetCpuSeconds() / wall : 0.0;
+        }
+
+    private:
+        CStopwatch m_wall;
+        double m_cpuStart;
+    };
+
+    // Returns the percentile p (0..100) of the samples using the nearest rank.
+    inline double GetPercentile( std::vector<double> samples, double p)
+    {
+        if (samples.empty())
+        {
+            return 0.0;
+        }
+        std::sort( samples.begin(), samples.end());
+        const size_t rank = static_cast<size_t>(p / 100.0 * (samples.size() - 1) + 0.5);
+        return samples[std::min( rank, samples.size() - 1)];
+    }
+
+    // The result of one benchmark case.
+    struct SBenchmarkResult
+    {
+        std::string Benchmark;
+        std::string Case;
+        std::vector< std::pair<std::string, double> > Metrics;
+
+        SBenchmarkResult& Add( const std::string& name, double value)
+        {
+            Metrics.push_back( std::make_pair( name, value));
+            return *this;
+        }
+    };
+
+    class CBenchmarkReport
+    {
+    public:
+        // Adds a result and prints it.
+        void Add( const SBenchmarkResult& result)
+        {
+            m_results.push_back( result);
+
+            std::cout << result.Benchmark << " / " << result.Case << ":";
+            for (size_t i = 0; i < result.Metrics.size(); ++i)
+            {
+                std::cout << " " << result.Metrics[i].first << "=" << result.Metrics[i].second;
+            }
+            std::cout << std::endl;
+        }
+
+        const std::vector<SBenchmarkResult>& GetResults() const
+        {
+            return m_results;
+        }
+
+        void WriteJson( const std::string& fileName) const
+        {
+            FILE* pFile = fopen( fileName.c_str(), "w");
+            if (!pFile)
+            {
+                throw RUNTIME_EXCEPTION( "Could not create the report file %s.", fileName.c_str());
+            }
+            fprintf( pFile, "{\n  \"results\": [\n");
+            for (size_t i = 0; i < m_results.size(); ++i)
+            {
+                const SBenchmarkResult& result = m_results[i];
+                fprintf( pFile, "    {\"benchmark\": \"%s\", \"case\": \"%s\"", Escape( result.Benchmark).c_str(), Escape( result.Case).c_str());
+                for (size_t j = 0; j < result.Metrics.size(); ++j)
+                {
+                    // JSON has no NaN or infinity, a metric that is not a finite number is written as null.
+                    const double value = result.Metrics[j].second;
+                    if (std::isfinite( value))
+                    {
+                        fprintf( pFile, ", \"%s\": %.6g", Escape( result.Metrics[j].first).c_str(), value);
+                    }
+                    else
+                    {
+                        fprintf( pFile, ", \"%s\": null", Escape( result.Metrics[j].first).c_str());
+                    }
+                }
+                fprintf( pFile, "}%s\n", i + 1 < m_results.size() ? "," : "");
+            }
+            fprintf( pFile, "  ]\n}\n");
+            fclose( pFile);
+        }
+
+    private:
+        static std::string Escape( const std::string& text)
+        {
+            std::string escaped;
+            for (size_t i = 0; i < text.size(); ++i)
+            {
+                if (text[i] == '"' || text[i] == '\\')
+                {
+                    escaped += '\\';
+                }
+                escaped += text[i];
+            }
+            return escaped;
+        }
+
+        std::vector<SBenchmarkResult> m_results;
+    };
+}
+
+#endif /* INCLUDED_BENCHMARKREPORT_H_6402215 */
@@ -19,30 +19,12 @@
 // Namespace for using pylon objects.
 using namespace Pylon;
 
-#if defined( USE_1394 )
-// Settings to use Basler IEEE 1394 cameras.
-#include <pylon/1394/Basler1394InstantCamera.h>
-typedef Pylon::CBasler1394InstantCamera Camera_t;
-typedef Pylon::CBasler1394ImageEventHandler ImageEventHandler_t; // Or use Camera_t::ImageEventHandler_t
-typedef Pylon::CBasler1394GrabResultPtr GrabResultPtr_t; // Or use Camera_t::GrabResultPtr_t
-using namespace Basler_IIDC1394CameraParams;
-#elif defined ( USE_GIGE )
-// Settings to use Basler GigE cameras.
-#include <pylon/gige/BaslerGigEInstantCamera.h>
-typedef Pylon::CBaslerGigEInstantCamera Camera_t;
-typedef Pylon::CBaslerGigEImageEventHandler ImageEventHandler_t; // Or use Camera_t::ImageEventHandler_t
-typedef Pylon::CBaslerGigEGrabResultPtr GrabResultPtr_t; // Or use Camera_t::GrabResultPtr_t
-using namespace Basler_GigECameraParams;
-#elif defined( USE_USB )
-// Settings to use Basler USB cameras.
-#include <pylon/usb/BaslerUsbInstantCamera.h>
-typedef Pylon::CBaslerUsbInstantCamera Camera_t;
-typedef Pylon::CBaslerUsbImageEventHandler ImageEventHandler_t; // Or use Camera_t::ImageEventHandler_t
-typedef Pylon::CBaslerUsbGrabResultPtr GrabResultPtr_t; // Or use Camera_t::GrabResultPtr_t
-using namespace Basler_UsbCameraParams;
-#else
-#error camera type is not specified. For example, define USE_GIGE for using GigE cameras
-#endif
+// Settings to use the cameras of the transport selected above.
+#include "../include/CameraTransport.h"
+
+// Include files used by samples.
+#include "../include/FrameSourceSelection.h"
+#include "../include/CameraNodeAccess.h"
 
 // Namespace for using cout.
 using namespace std;
@@ -51,20 +33,23 @@ using namespace std;
 class CSampleImageEventHandler : public ImageEventHandler_t
 {
 public:
+    CSampleImageEventHandler()
+        : m_chunkTimestamp( "ChunkTimestamp")
+    {
+    }
+
     virtual void OnImageGrabbed( Camera_t& camera, const GrabResultPtr_t& ptrGrabResult)
     {
         // The chunk data is attached to the grab result and can be accessed anywhere.
 
         // Generic parameter access:
         // This shows the access via the chunk data node map. This method is available for all grab result types.
-        GenApi::CIntegerPtr chunkTimestamp( ptrGrabResult->GetChunkDataNodeMap().GetNode( "ChunkTimestamp"));
-
-        // Access the chunk data attached to the result.
-        // Before accessing the chunk data, you should check to see
-        // if the chunk is readable. When it is readable, the buffer
-        // contains the requested chunk data.
-        //if ( IsReadable( chunkTimestamp))
-          //  cout << "OnImageGrabbed: TimeStamp (Result) accessed via node map: " << chunkTimestamp->GetValue() << endl;
+        // The node is looked up by name once per buffer, see include/CameraNodeAccess.h.
+        int64_t timestamp = 0;
+        if (m_chunkTimestamp.TryGetValue( ptrGrabResult, timestamp))
+        {
+            //cout << "OnImageGrabbed: TimeStamp (Result) accessed via node map: " << timestamp << endl;
+        }
 
         // Native parameter access:
         // When using the device specific grab results the chunk data can be accessed
@@ -72,144 +57,170 @@ public:
         //if ( IsReadable(ptrGrabResult->ChunkTimestamp))
           //  cout << "OnImageGrabbed: TimeStamp (Result) accessed via result member: " << ptrGrabResult->ChunkTimestamp.GetValue() << endl;
     }
+
+private:
+    CChunkIntegerNodeCache m_chunkTimestamp;
 };
 
 // Number of images to be grabbed.
 static const uint32_t c_countOfImagesToGrab = 30;
 
-int main(int argc, char* argv[])
+// Grabs the images and prints the time stamp deltas. Used for cameras and for the synthetic frame source.
+template <typename CameraT>
+void GrabChunkImages( CameraT& camera)
 {
-    // The exit code of the sample application.
-    int exitCode = 0;
-
-    // Automagically call PylonInitialize and PylonTerminate to ensure the pylon runtime system
-    // is initialized during the lifetime of this object.
-    Pylon::PylonAutoInitTerm autoInitTerm;
-
-    try
+    // Start the grabbing of c_countOfImagesToGrab images.
+    // The camera device is parameterized with a default configuration which
+    // sets up free-running continuous acquisition.
+    camera.StartGrabbing( c_countOfImagesToGrab);
+
+    // This smart pointer will receive the grab result data.
+    typename CameraT::GrabResultPtr_t ptrGrabResult;
+	int64_t _PrevTimestamp = 0; 
+	int64_t _CurrTimestamp = 0; 
+
+    // Camera.StopGrabbing() is called automatically by the RetrieveResult() method
+    // when c_countOfImagesToGrab images have been retrieved.
+    while( camera.IsGrabbing())
     {
-        // Only look for cameras supported by Camera_t
-        CDeviceInfo info;
-        info.SetDeviceClass( Camera_t::DeviceClass());
-
-        // Create an instant camera object with the first found camera device that matches the specified device class.
-        Camera_t camera( CTlFactory::GetInstance().CreateFirstDevice( info));
-
-        // Print the model name of the camera.
-        cout << "Using device " << camera.GetDeviceInfo().GetModelName() << endl;
+        // Wait for an image and then retrieve it. A timeout of 5000 ms is used.
+        // RetrieveResult calls the image event handler's OnImageGrabbed method.
+        camera.RetrieveResult( 5000, ptrGrabResult, TimeoutHandling_ThrowException);
 
-        // Register an image event handler that accesses the chunk data.
-        camera.RegisterImageEventHandler( new CSampleImageEventHandler, RegistrationMode_Append, Cleanup_Delete);
-
-        // Open the camera.
-        camera.Open();
-
-		camera.PixelFormat.SetValue(PixelFormat_Mono12);
+#ifdef PYLON_WIN_BUILD
+        // Display the image
+        Pylon::DisplayImage(1, ptrGrabResult);
+#endif
 
-		camera.Gain.SetValue(0);
-		camera.ExposureTime.SetValue(50000);
+        //cout << "GrabSucceeded: " << ptrGrabResult->GrabSucceeded() << endl;
 
-        // A GenICam node map is required for accessing chunk data. That's why a small node map is required for each grab result.
-        // Creating a node map can be time consuming, because node maps are created by parsing an XML description file.
-        // The node maps are usually created dynamically when StartGrabbing() is called.
-        // To avoid a delay caused by node map creation in StartGrabbing() you have the option to create
-        // a static pool of node maps once before grabbing.
-        //camera.StaticChunkNodeMapPoolSize = camera.MaxNumBuffer.GetValue();
+        // The result data is automatically filled with received chunk data.
+        // (Note:  This is not the case when using the low-level API)
+        //cout << "SizeX: " << ptrGrabResult->GetWidth() << endl;
+        //cout << "SizeY: " << ptrGrabResult->GetHeight() << endl;
+        //const uint8_t *pImageBuffer = (uint8_t *) ptrGrabResult->GetBuffer();
+        //cout << "Gray value of first pixel: " << (uint32_t) pImageBuffer[0] << endl;
 
-        // Enable chunks in general.
-        if (GenApi::IsWritable(camera.ChunkModeActive))
+        // Check to see if a buffer containing chunk data has been received.
+        if (PayloadType_ChunkData != ptrGrabResult->GetPayloadType())
         {
-            camera.ChunkModeActive.SetValue(true);
+            throw RUNTIME_EXCEPTION( "Unexpected payload type received.");
         }
-        else
+
+        // Since we have activated the CRC Checksum feature, we can check
+        // the integrity of the buffer first.
+        // Note: Enabling the CRC Checksum feature is not a prerequisite for using
+        // chunks. Chunks can also be handled when the CRC Checksum feature is deactivated.
+        /*if (ptrGrabResult->HasCRC() && ptrGrabResult->CheckCRC() == false)
         {
-            throw RUNTIME_EXCEPTION( "The camera doesn't support chunk features");
+            throw RUNTIME_EXCEPTION( "Image was damaged!");
         }
+		*/
+
+        // Access the chunk data attached to the result.
+        // Before accessing the chunk data, you should check to see
+        // if the chunk is readable. When it is readable, the buffer
+        // contains the requested chunk data.
+        if (IsReadable(ptrGrabResult->ChunkTimestamp))
+			_CurrTimestamp = ptrGrabResult->ChunkTimestamp.GetValue();
+
+		
+		cout << "TimeStamp Delta (Result): " << (_CurrTimestamp - _PrevTimestamp) << endl;
 
-        // Enable time stamp chunks.
-        camera.ChunkSelector.SetValue(ChunkSelector_Timestamp);
-        camera.ChunkEnable.SetValue(true);
 
+		_PrevTimestamp = _CurrTimestamp; 
 #ifndef USE_USB // USB camera devices provide generic counters. An explicit FrameCounter value is not provided by USB camera devices.
-        // Enable frame counter chunks.
-        camera.ChunkSelector.SetValue(ChunkSelector_Framecounter);
-        camera.ChunkEnable.SetValue(true);
+        if (IsReadable(ptrGrabResult->ChunkFramecounter))
+            cout << "FrameCounter (Result): " << ptrGrabResult->ChunkFramecounter.GetValue() << endl;
 #endif
 
-        // Enable CRC checksum chunks.
-        camera.ChunkSelector.SetValue(ChunkSelector_PayloadCRC16);
-        camera.ChunkEnable.SetValue(true);
+        //cout << endl;
+    }
+}
 
-        // Start the grabbing of c_countOfImagesToGrab images.
-        // The camera device is parameterized with a default configuration which
-        // sets up free-running continuous acquisition.
-        camera.StartGrabbing( c_countOfImagesToGrab);
+int main(int argc, char* argv[])
+{
+    // The exit code of the sample application.
+    int exitCode = 0;
 
-        // This smart pointer will receive the grab result data.
-        GrabResultPtr_t ptrGrabResult;
-		int64_t _PrevTimestamp = 0; 
-		int64_t _CurrTimestamp = 0; 
+    // Automagically call PylonInitialize and PylonTerminate to ensure the pylon runtime system
+    // is initialized during the lifetime of this object.
+    Pylon::PylonAutoInitTerm autoInitTerm;
 
-        // Camera.StopGrabbing() is called automatically by the RetrieveResult() method
-        // when c_countOfImagesToGrab images have been retrieved.
-        while( camera.IsGrabbing())
+    try
+    {
+        // Select the frame source, see include/FrameSourceSelection.h.
+        // The camera emulator does not provide the chunk features of Camera_t, use the synthetic frame source instead.
+        EFrameSource frameSource = GetFrameSource( argc, argv);
+        if (frameSource == FrameSource_Emulator)
+        {
+            throw RUNTIME_EXCEPTION( "The camera emulator does not support chunk features. Use -source synthetic.");
+        }
+        if (frameSource == FrameSource_Synthetic)
+        {
+            CSyntheticFrameSource syntheticCamera( GetSyntheticSettings( argc, argv));
+            cout << "Using device " << syntheticCamera.GetDeviceInfo().GetModelName() << endl;
+            GrabChunkImages( syntheticCamera);
+        }
+        else
         {
-            // Wait for an image and then retrieve it. A timeout of 5000 ms is used.
-            // RetrieveResult calls the image event handler's OnImageGrabbed method.
-            camera.RetrieveResult( 5000, ptrGrabResult, TimeoutHandling_ThrowException);
+            // Only look for cameras supported by Camera_t
+            CDeviceInfo info;
+            info.SetDeviceClass( Camera_t::DeviceClass());
 
-#ifdef PYLON_WIN_BUILD
-            // Display the image
-            Pylon::DisplayImage(1, ptrGrabResult);
-#endif
+            // Create an instant camera object with the first found camera device that matches the specified device class.
+            Camera_t camera( CTlFactory::GetInstance().CreateFirstDevice( info));
+
+            // Print the model name of the camera.
+            cout << "Using device " << camera.GetDeviceInfo().GetModelName() << endl;
+
+            // Register an image event handler that accesses the chunk data.
+            camera.RegisterImageEventHandler( new CSampleImageEventHandler, RegistrationMode_Append, Cleanup_Delete);
 
-            //cout << "GrabSucceeded: " << ptrGrabResult->GrabSucceeded() << endl;
+            // Open the camera.
+            camera.Open();
 
-            // The result data is automatically filled with received chunk data.
-            // (Note:  This is not the case when using the low-level API)
-            //cout << "SizeX: " << ptrGrabResult->GetWidth() << endl;
-            //cout << "SizeY: " << ptrGrabResult->GetHeight() << endl;
-            //const uint8_t *pImageBuffer = (uint8_t *) ptrGrabResult->GetBuffer();
-            //cout << "Gray value of first pixel: " << (uint32_t) pImageBuffer[0] << endl;
+			camera.PixelFormat.SetValue(PixelFormat_Mono12);
 
-            // Check to see if a buffer containing chunk data has been received.
-            if (PayloadType_ChunkData != ptrGrabResult->GetPayloadType())
+			camera.Gain.SetValue(0);
+			camera.ExposureTime.SetValue(50000);
+
+            // A GenICam node map is required for accessing chunk data. That's why a small node map is required for each grab result.
+            // Creating a node map can be time consuming, because node maps are created by parsing an XML description file.
+            // The node maps are usually created dynamically when StartGrabbing() is called.
+            // To avoid a delay caused by node map creation in StartGrabbing() you have the option to create
+            // a static pool of node maps once before grabbing.
+            //camera.StaticChunkNodeMapPoolSize = camera.MaxNumBuffer.GetValue();
+
+            // Enable chunks in general.
+            if (GenApi::IsWritable(camera.ChunkModeActive))
             {
-                throw RUNTIME_EXCEPTION( "Unexpected payload type received.");
+                camera.ChunkModeActive.SetValue(true);
             }
-
-            // Since we have activated the CRC Checksum feature, we can check
-            // the integrity of the buffer first.
-            // Note: Enabling the CRC Checksum feature is not a prerequisite for using
-            // chunks. Chunks can also be handled when the CRC Checksum feature is deactivated.
-            /*if (ptrGrabResult->HasCRC() && ptrGrabResult->CheckCRC() == false)
+            else
             {
-                throw RUNTIME_EXCEPTION( "Image was damaged!");
+                throw RUNTIME_EXCEPTION( "The camera doesn't support chunk features");
             }
-			*/
-
-            // Access the chunk data attached to the result.
-            // Before accessing the chunk data, you should check to see
-            // if the chunk is readable. When it is readable, the buffer
-            // contains the requested chunk data.
-            if (IsReadable(ptrGrabResult->ChunkTimestamp))
-				_CurrTimestamp = ptrGrabResult->ChunkTimestamp.GetValue();
 
-			
-			cout << "TimeStamp Delta (Result): " << (_CurrTimestamp - _PrevTimestamp) << endl;
+            // Enable time stamp chunks.
+            camera.ChunkSelector.SetValue(ChunkSelector_Timestamp);
+            camera.ChunkEnable.SetValue(true);
 
-
-			_PrevTimestamp = _CurrTimestamp; 
 #ifndef USE_USB // USB camera devices provide generic counters. An explicit FrameCounter value is not provided by USB camera devices.
-            if (IsReadable(ptrGrabResult->ChunkFramecounter))
-                cout << "FrameCounter (Result): " << ptrGrabResult->ChunkFramecounter.GetValue() << endl;
+            // Enable frame counter chunks.
+            camera.ChunkSelector.SetValue(ChunkSelector_Framecounter);
+            camera.ChunkEnable.SetValue(true);
 #endif
 
-            //cout << endl;
-        }
+            // Enable CRC checksum chunks.
+            camera.ChunkSelector.SetValue(ChunkSelector_PayloadCRC16);
+            camera.ChunkEnable.SetValue(true);
 
-        // Disable chunk mode.
-        camera.ChunkModeActive.SetValue(false);
+            GrabChunkImages( camera);
+
+            // Disable chunk mode.
+            camera.ChunkModeActive.SetValue(false);
+        }
     }
     catch (GenICam::GenericException &e)
     {
@@ -1,5 +1,9 @@
 #include <pylon/PylonIncludes.h>
 #include <pylon/usb/BaslerUsbCamera.h>
+#include "../include/FrameStatistics.h"
+#include "../include/FrameView.h"
+#include "../include/RoiController.h"
+#include "../include/FrameSourceSelection.h"
 #include <ostream>
 using namespace Pylon;
 using namespace Basler_UsbCameraParams;
@@ -11,6 +15,9 @@ typedef CBaslerUsbCamera Camera_t;
 static const size_t c_maxCamerasToUse = 2;
 const int numGrabs = 20;
 const int numBuffers = 20;
+// An AOI in the center of the sensor set with -roi <width>x<height>, 0 for the full sensor. The buffers are sized by the payload of the AOI.
+static int64_t RoiWidth = 0;
+static int64_t RoiHeight = 0;
 
 static vector<int64_t> c_PrevTime(c_maxCamerasToUse, 0);
 static vector<int64_t> c_CurrTime(c_maxCamerasToUse, 0);
@@ -37,17 +44,45 @@ static vector<vector<MyContext*>> c_MyContextArray(c_maxCamerasToUse, vector<MyC
 
 
 
-void ProcessImage(unsigned char* pImage, int imageSizeX, int imageSizeY)
+static CFrameStatisticsCalculator c_Statistics;
+
+void ProcessImage(const CFrameView& image)
 {
-	//cout << "Camera: x" << imageSizeX << " Y: " << imageSizeY << endl;
+	//cout << "Camera: x" << image.GetWidth() << " Y: " << image.GetHeight() << endl;
+
+	SFrameStatistics statistics;
+	c_Statistics.Compute(image.GetBuffer(), image.GetPixelType(), image.GetWidth(), image.GetHeight(), image.GetPaddingX(), statistics);
+	cout << "Mean: " << statistics.GetMean() << " Saturated: " << statistics.SaturatedFraction * 100.0 << "% Black: " << statistics.BlackFraction * 100.0 << "%";
 
-	// Do something with the image data
+	// The center quarter, read in place.
+	const CFrameView center = image.Crop(image.GetWidth() / 4, image.GetHeight() / 4, image.GetWidth() / 2, image.GetHeight() / 2);
+	c_Statistics.Compute(center.GetBuffer(), center.GetPixelType(), center.GetWidth(), center.GetHeight(), center.GetPaddingX(), statistics);
+	cout << " Center mean: " << statistics.GetMean() << endl;
 }
 
 
-int main()
+int main(int argc, char* argv[])
 {
 	PylonAutoInitTerm autoInitTerm;
+
+	// Select the frame source, see include/FrameSourceSelection.h. The sample grabs through the stream grabbers of the
+	// low level camera API, which neither the camera emulator nor the synthetic frame source provide.
+	try
+	{
+		if (GetFrameSource(argc, argv) != FrameSource_Camera)
+			throw RUNTIME_EXCEPTION("This sample grabs through the stream grabbers of cameras only. Use Grab_UsingGrabLoopThread or Grab_command_line with -source emulator or synthetic.");
+	}
+	catch (GenICam::GenericException &e)
+	{
+		cerr << e.GetDescription() << endl;
+		return 1;
+	}
+
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		if (strcmp(argv[i], "-roi") == 0)
+			sscanf(argv[i + 1], "%lldx%lld", (long long*)&RoiWidth, (long long*)&RoiHeight);
+	}
 	//const int numGrabs = 30;
 
 	try
@@ -74,11 +109,12 @@ int main()
 		{
 			c_CamArray[i]->Open();
 			c_CamArray[i]->PixelFormat.SetValue(PixelFormat_Mono8);
-			// Maximized AOI
-			c_CamArray[i]->OffsetX.SetValue(0);
-			c_CamArray[i]->OffsetY.SetValue(0);
-			c_CamArray[i]->Width.SetValue(c_CamArray[i]->Width.GetMax());
-			c_CamArray[i]->Height.SetValue(c_CamArray[i]->Height.GetMax());
+			// Maximized AOI, or the AOI of -roi fitted to the sensor
+			const SRoiLimits limits = GetRoiLimits(*c_CamArray[i]);
+			const SRoi roi = RoiWidth > 0 && RoiHeight > 0
+				? GetCenteredRoi(limits, RoiWidth, RoiHeight, limits.SensorWidth / 2, limits.SensorHeight / 2) : GetFullSensorRoi(limits);
+			WriteRoi(*c_CamArray[i], roi);
+			cout << "Camera " << i << " AOI: " << roi.Width << "x" << roi.Height << "+" << roi.OffsetX << "+" << roi.OffsetY << endl;
 			// Continuous mode, no external trigger used
 			c_CamArray[i]->TriggerSelector.SetValue(TriggerSelector_FrameBurstStart);
 			c_CamArray[i]->TriggerMode.SetValue(TriggerMode_On);
@@ -169,7 +205,8 @@ int main()
 							cout << "TimeStamp Cam"<< i << ": " << (c_CurrTime[i] * 0.000000001) << " dT:" << ((c_CurrTime[i] - c_PrevTime[i])*0.000000001) << endl;
 							c_PrevTime[i] = c_CurrTime[i];
 						}
-						ProcessImage((unsigned char*)c_GrabResArray[i]->Buffer(), c_GrabResArray[i]->GetSizeX(), c_GrabResArray[i]->GetSizeY());
+						// The cameras are set to Mono8, the rows are not padded.
+						ProcessImage(CFrameView(c_GrabResArray[i]->Buffer(), PixelType_Mono8, c_GrabResArray[i]->GetSizeX(), c_GrabResArray[i]->GetSizeY(), c_GrabResArray[i]->GetSizeX()));
 					}
 					else 
 					{
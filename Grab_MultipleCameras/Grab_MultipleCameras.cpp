@@ -20,18 +20,14 @@ image event handlers. Please note that this is not shown in this example.
 
 #define USE_USB
 
-#if defined(USE_USB)
-// Settings to use Basler USB cameras.
-#include <pylon/usb/BaslerUsbInstantCamera.h>
-#include <pylon/usb/BaslerUsbInstantCameraArray.h>
-typedef Pylon::CBaslerUsbInstantCamera Camera_t;
-typedef Pylon::CBaslerUsbImageEventHandler ImageEventHandler_t; // Or use Camera_t::ImageEventHandler_t
-typedef Pylon::CBaslerUsbGrabResultPtr GrabResultPtr_t; // Or use Camera_t::GrabResultPtr_t
-using namespace Basler_UsbCameraParams;
-#endif
+// Settings to use the cameras of the transport selected above.
+#include "../include/CameraTransport.h"
 
 #include "../include/ConfigurationEventPrinter.h"
 #include "../include/ImageEventPrinter.h"
+#include "../include/PreviewRenderer.h"
+#include "../include/FrameTimeSeries.h"
+#include "../include/FrameSourceSelection.h"
 
 #include <time.h>
 
@@ -52,19 +48,24 @@ static vector<double> _PC_frame_start(c_maxCamerasToUse, 0.0);
 static vector<double> _PC_frame_stop(c_maxCamerasToUse, 0.0);
 static vector<int> _PC_frame_count(c_maxCamerasToUse, 0);
 
-static vector<vector<double>> _PC_frame_time_table(c_maxCamerasToUse*2, vector<double>(c_countOfImagesToGrab, 0.0));
+// Host and camera times of the frames in ns, sized by the cameras found.
+static CFrameTimeSeries _Frame_times;
+static vector<CPreviewRenderer> _Preview_renderers(c_maxCamerasToUse);
 
 static char IsBurstStarted = 0;
 static int c_FrameSetTriggered = -1;
 
-class CSampleImageEventHandler : public CBaslerUsbImageEventHandler //CImageEventHandler //CBaslerUsbImageEventHandler
+// Records the frame times. Instantiated for cameras and for the synthetic frame source.
+template <typename ImageEventHandlerT, typename CameraT, typename GrabResultPtrT>
+class CSampleImageEventHandlerT : public ImageEventHandlerT //CImageEventHandler //CBaslerUsbImageEventHandler
 {
 public:
-	virtual void OnImageGrabbed(CBaslerUsbInstantCamera& camera, const CBaslerUsbGrabResultPtr& ptrGrabResult)
+	virtual void OnImageGrabbed(CameraT& camera, const GrabResultPtrT& ptrGrabResult)
 	{
 		intptr_t cameraContextValue = ptrGrabResult->GetCameraContext();
 		_PC_frame_stop[cameraContextValue] = (double)clock() / CLOCKS_PER_SEC;
-		Pylon::DisplayImage(cameraContextValue, ptrGrabResult);
+		if (_Preview_renderers[cameraContextValue].Render(ptrGrabResult))
+			Pylon::DisplayImage(cameraContextValue, _Preview_renderers[cameraContextValue].GetImage());
 
 		if (PayloadType_ChunkData != ptrGrabResult->GetPayloadType()) throw RUNTIME_EXCEPTION("Unexpected payload type received.");
 
@@ -73,11 +74,11 @@ public:
 		{
 			
 			int _frame_index = _PC_frame_count[cameraContextValue];
-			_PC_frame_time_table[2*cameraContextValue][_frame_index] = _PC_frame_stop[cameraContextValue];// (double)clock() / CLOCKS_PER_SEC;
+			_Frame_times.SetHostTime(cameraContextValue, _frame_index, GetHostTimeNs());
 			
 			if (IsReadable(ptrGrabResult->ChunkTimestamp))
 			{
-				_PC_frame_time_table[2*cameraContextValue+1][_frame_index] = 0.000000001*(double)ptrGrabResult->ChunkTimestamp.GetValue();
+				_Frame_times.SetCameraTime(cameraContextValue, _frame_index, ptrGrabResult->ChunkTimestamp.GetValue());
 			}
 
 			_PC_frame_count[cameraContextValue] += 1;
@@ -90,187 +91,258 @@ public:
 	}
 };
 
+typedef CSampleImageEventHandlerT<ImageEventHandler_t, Camera_t, GrabResultPtr_t> CSampleImageEventHandler;
+typedef CSampleImageEventHandlerT<CSyntheticImageEventHandler, CSyntheticFrameSource, CSyntheticGrabResultPtr> CSyntheticSampleImageEventHandler;
+
+// Enables the Timestamp chunks the frame times are taken from.
+void EnableTimestampChunks(Camera_t& camera)
+{
+	if (GenApi::IsWritable(camera.ChunkModeActive))
+	{
+		camera.ChunkModeActive.SetValue(true);
+	}
+	else
+	{
+		throw RUNTIME_EXCEPTION("The camera doesn't support chunk features");
+	}
+
+	// Enable time stamp chunks.
+	camera.ChunkSelector.SetValue(ChunkSelector_Timestamp);
+	camera.ChunkEnable.SetValue(true);
+}
+
+// The synthetic frame source always delivers the Timestamp chunk when chunks are active.
+void EnableTimestampChunks(CSyntheticFrameSource& camera)
+{
+	camera.ChunkModeActive.SetValue(true);
+}
+
+// A software trigger starts a burst of c_countOfImagesToGrab frames.
+template <typename CameraT>
+void ConfigureBurstTrigger(CameraT& camera)
+{
+	camera.TriggerSelector.SetValue(TriggerSelector_FrameBurstStart);
+	camera.TriggerMode.SetValue(TriggerMode_On);
+	camera.TriggerSource.SetValue(TriggerSource_Software);
+	camera.AcquisitionBurstFrameCount.SetValue(c_countOfImagesToGrab);
+}
+
+// Starts the acquisition of a camera with AcquisitionStart.
+void StartAcquisition(Camera_t& camera)
+{
+	camera.AcquisitionStart.Execute();
+}
+
+// The synthetic frame source has no AcquisitionStart, it acquires while grabbing.
+void StartAcquisition(CSyntheticFrameSource& camera)
+{
+	camera.StartGrabbing(GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+}
+
+// The intervals to the previous frame of every camera in seconds, host and camera time.
 void PrintTimeTable()
 {
-	for (size_t i = 0; i < c_countOfImagesToGrab - 1; ++i)
+	size_t frameCount = 0;
+	for (size_t j = 0; j < _Frame_times.GetCameraCount(); ++j)
+	{
+		frameCount = max(frameCount, _Frame_times.GetFrameCount(j));
+	}
+	for (size_t i = 1; i < frameCount; ++i)
 	{
 		cout << "Camera";
-		//for (size_t j = 0; j < c_maxCamerasToUse; ++j)
-		for (size_t j = 0; j < c_maxCamerasToUse; ++j)
+		for (size_t j = 0; j < _Frame_times.GetCameraCount(); ++j)
 		{
-			cout << " #" << j << ": " << _PC_frame_time_table[2*j][i + 1] - _PC_frame_time_table[2*j][i] << " Cam Time:" << _PC_frame_time_table[2*j + 1][i + 1] - _PC_frame_time_table[2*j + 1][i];
-
+			const CFrameTimeColumn& hostTimes = _Frame_times.GetHostTimes(j);
+			const CFrameTimeColumn& cameraTimes = _Frame_times.GetCameraTimes(j);
+			cout << " #" << j << ": " << (i < hostTimes.GetSize() ? 1e-9 * (hostTimes[i] - hostTimes[i - 1]) : 0.0)
+				<< " Cam Time:" << (i < cameraTimes.GetSize() ? 1e-9 * (cameraTimes[i] - cameraTimes[i - 1]) : 0.0);
 		}
 		cout << endl;
 	}
 }
 
 
-int main(int argc, char* argv[])
+// Starts the acquisition and triggers the cameras when "t" is entered.
+template <typename CameraArrayT>
+void TriggerBursts(CameraArrayT& cameras)
 {
-	// The exit code of the sample application.
-	int exitCode = 0;
-
-	Pylon::PylonAutoInitTerm autoInitTerm;
-
-	try
+	//cameras.StartGrabbing(10, GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+	for (size_t i = 0; i < cameras.GetSize(); ++i)
 	{
+		//cameras[i].StartGrabbing(c_countOfImagesToGrab, GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+		//cameras[i].StartGrabbing(GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+		StartAcquisition(cameras[i]);
+	}
+
+	//while (!finished)
+	//{
+	//	// Execute a trigger software command to apply a software acquisition
+	//	// start trigger signal to the camera
+	//	camera.TriggerSoftware.Execute();
+	//	// Perform the required functions to parameterize the frame start
+	//	// trigger, to trigger 5 frame starts, and to retrieve 5 frames here
+	//}
+	//camera.AcquisitionStop.Execute();
 
-		CDeviceInfo info;
-		info.SetDeviceClass(Camera_t::DeviceClass());
+	cerr << endl << "Enter \"t\" to trigger the camera or \"e\" to exit and press enter? (t/e)" << endl << endl;
 
-		// Get the transport layer factory.
-		CTlFactory& tlFactory = CTlFactory::GetInstance();
+	char key;
+	cin.get(key);
 
-		// Get all attached devices and exit application if no device is found.
-		DeviceInfoList_t devices;
-		if (tlFactory.EnumerateDevices(devices) == 0)
+	if ((key == 't' || key == 'T'))
+	{
+		for (size_t i = 0; i < cameras.GetSize(); ++i)
 		{
-			throw RUNTIME_EXCEPTION("No camera present.");
+			// Execute the software trigger. Wait up to 100 ms for the camera to be ready for trigger.
+			//while(1)
+			//{
+				cameras[i].ExecuteSoftwareTrigger();
+			//}
 		}
-		CBaslerUsbInstantCameraArray cameras(min(devices.size(), c_maxCamerasToUse));
-
-		int CamNmbr = devices.size();
 
-		// Create and attach all Pylon Devices.
-		for (size_t i = 0; i < CamNmbr; ++i)
+		for (size_t i = 0; i < cameras.GetSize(); ++i)
 		{
-			cameras[i].Attach(tlFactory.CreateDevice(devices[i]));
-
-			//cameras[i].RegisterConfiguration(new CSoftwareTriggerConfiguration, RegistrationMode_ReplaceAll, Cleanup_Delete);
-			//cameras[i].RegisterConfiguration(new CConfigurationEventPrinter, RegistrationMode_Append, Cleanup_Delete);
-
-			cameras[i].RegisterImageEventHandler(new CSampleImageEventHandler, RegistrationMode_ReplaceAll, Cleanup_Delete);
-
-			cameras[i].MaxNumBuffer = c_countOfImagesToGrab;
-
-			cameras[i].Open();
-
-			//cameras[i].PixelFormat.SetValue(PixelFormat_Mono12);
-			cameras[i].AcquisitionMode.SetValue(AcquisitionMode_Continuous);
-
-			cameras[i].TriggerSelector.SetValue(TriggerSelector_FrameBurstStart);
+			cameras[i].TriggerSelector.SetValue(TriggerSelector_FrameStart);
 			cameras[i].TriggerMode.SetValue(TriggerMode_On);
 			cameras[i].TriggerSource.SetValue(TriggerSource_Software);
-			cameras[i].AcquisitionBurstFrameCount.SetValue(c_countOfImagesToGrab);
+		}
+		for (size_t i = 0; i < cameras.GetSize(); ++i)
+		{
+			// Execute the software trigger. Wait up to 100 ms for the camera to be ready for trigger.
+			if (cameras[i].WaitForFrameTriggerReady(100, TimeoutHandling_ThrowException))
+			{
+				_PC_frame_start[i] = (double)clock() / CLOCKS_PER_SEC;
+				cameras[i].ExecuteSoftwareTrigger();
+				c_FrameSetTriggered++;
+			}
+		}
 
-			//cameras[i].AcquisitionMode.SetValue(AcquisitionMode_Continuous);
-			//cameras[i].AcquisitionBurstFrameCount.SetValue(c_countOfImagesToGrab);
 
 
-			cameras[i].Gain.SetValue(0);
-			cameras[i].ExposureTime.SetValue(50000);
-			// Print the model name of the camera.
-			cout << "Using device " << cameras[i].GetDeviceInfo().GetModelName() << endl;
+		//IsBurstStarted = 1;
+	}
 
 
-			if (GenApi::IsWritable(cameras[i].ChunkModeActive))
-			{
-				cameras[i].ChunkModeActive.SetValue(true);
-			}
-			else
-			{
-				throw RUNTIME_EXCEPTION("The camera doesn't support chunk features");
-			}
 
-			// Enable time stamp chunks.
-			cameras[i].ChunkSelector.SetValue(ChunkSelector_Timestamp);
-			cameras[i].ChunkEnable.SetValue(true);
 
-		}
 
-		//cameras.StartGrabbing(10, GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
-		for (size_t i = 0; i < cameras.GetSize(); ++i)
-		{
-			//cameras[i].StartGrabbing(c_countOfImagesToGrab, GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
-			//cameras[i].StartGrabbing(GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
-			cameras[i].AcquisitionStart.Execute();
-		}
 
-		//while (!finished)
-		//{
-		//	// Execute a trigger software command to apply a software acquisition
-		//	// start trigger signal to the camera
-		//	camera.TriggerSoftware.Execute();
-		//	// Perform the required functions to parameterize the frame start
-		//	// trigger, to trigger 5 frame starts, and to retrieve 5 frames here
-		//}
-		//camera.AcquisitionStop.Execute();
 
-		cerr << endl << "Enter \"t\" to trigger the camera or \"e\" to exit and press enter? (t/e)" << endl << endl;
 
-		char key;
+	do
+	{
+		
 		cin.get(key);
-
+		
 		if ((key == 't' || key == 'T'))
 		{
 			for (size_t i = 0; i < cameras.GetSize(); ++i)
 			{
 				// Execute the software trigger. Wait up to 100 ms for the camera to be ready for trigger.
-				//while(1)
-				//{
-					cameras[i].TriggerSoftware.Execute();
-				//}
-			}
-
-			for (size_t i = 0; i < cameras.GetSize(); ++i)
-			{
-				cameras[i].TriggerSelector.SetValue(TriggerSelector_FrameStart);
-				cameras[i].TriggerMode.SetValue(TriggerMode_On);
-				cameras[i].TriggerSource.SetValue(TriggerSource_Software);
-			}
-			for (size_t i = 0; i < cameras.GetSize(); ++i)
-			{
-				// Execute the software trigger. Wait up to 100 ms for the camera to be ready for trigger.
-				if (cameras[i].WaitForFrameTriggerReady(100, TimeoutHandling_ThrowException))
+				if (cameras[i].WaitForFrameTriggerReady(5000, TimeoutHandling_ThrowException))
 				{
 					_PC_frame_start[i] = (double)clock() / CLOCKS_PER_SEC;
-					cameras[i].TriggerSoftware.Execute();
-					c_FrameSetTriggered++;
+					cameras[i].ExecuteSoftwareTrigger();
+					//c_FrameSetTriggered++;
 				}
 			}
-
-
-
 			//IsBurstStarted = 1;
 		}
+			
+		
 
 
 
 
+	} while (((key != 'e') && (key != 'E')) );
+}
 
+int main(int argc, char* argv[])
+{
+	// The exit code of the sample application.
+	int exitCode = 0;
 
+	Pylon::PylonAutoInitTerm autoInitTerm;
 
-
-		do
+	try
+	{
+		// Select the frame source, see include/FrameSourceSelection.h.
+		const EFrameSource frameSource = GetFrameSource(argc, argv);
+		if (frameSource == FrameSource_Emulator)
 		{
-			
-			cin.get(key);
-			
-			if ((key == 't' || key == 'T'))
+			throw RUNTIME_EXCEPTION("The camera emulator does not provide the USB camera features used by this sample. Use -source synthetic.");
+		}
+		if (frameSource == FrameSource_Synthetic)
+		{
+			// The synthetic frame source counterpart of the cameras below.
+			CSyntheticFrameSourceArray cameras(c_maxCamerasToUse, GetSyntheticSettings(argc, argv));
+			_Frame_times.Reset(cameras.GetSize(), c_countOfImagesToGrab);
+			for (size_t i = 0; i < cameras.GetSize(); ++i)
 			{
-				for (size_t i = 0; i < cameras.GetSize(); ++i)
-				{
-					// Execute the software trigger. Wait up to 100 ms for the camera to be ready for trigger.
-					if (cameras[i].WaitForFrameTriggerReady(5000, TimeoutHandling_ThrowException))
-					{
-						_PC_frame_start[i] = (double)clock() / CLOCKS_PER_SEC;
-						cameras[i].ExecuteSoftwareTrigger();
-						//c_FrameSetTriggered++;
-					}
-				}
-				//IsBurstStarted = 1;
+				cameras[i].RegisterImageEventHandler(new CSyntheticSampleImageEventHandler, RegistrationMode_ReplaceAll, Cleanup_Delete);
+				cameras[i].MaxNumBuffer = c_countOfImagesToGrab;
+				cameras[i].Open();
+				ConfigureBurstTrigger(cameras[i]);
+				cameras[i].Gain.SetValue(0);
+				cameras[i].ExposureTime.SetValue(50000);
+				cout << "Using device " << cameras[i].GetDeviceInfo().GetModelName() << endl;
+				EnableTimestampChunks(cameras[i]);
 			}
-				
-			
+			TriggerBursts(cameras);
+		}
+		else
+		{
+			CDeviceInfo info;
+			info.SetDeviceClass(Camera_t::DeviceClass());
+
+			// Get the transport layer factory.
+			CTlFactory& tlFactory = CTlFactory::GetInstance();
 
+			// Get all attached devices and exit application if no device is found.
+			DeviceInfoList_t devices;
+			if (tlFactory.EnumerateDevices(devices) == 0)
+			{
+				throw RUNTIME_EXCEPTION("No camera present.");
+			}
+			CameraArray_t cameras(min(devices.size(), c_maxCamerasToUse));
+			_Frame_times.Reset(cameras.GetSize(), c_countOfImagesToGrab);
+
+			int CamNmbr = devices.size();
+
+			// Create and attach all Pylon Devices.
+			for (size_t i = 0; i < CamNmbr; ++i)
+			{
+				cameras[i].Attach(tlFactory.CreateDevice(devices[i]));
+
+				//cameras[i].RegisterConfiguration(new CSoftwareTriggerConfiguration, RegistrationMode_ReplaceAll, Cleanup_Delete);
+				//cameras[i].RegisterConfiguration(new CConfigurationEventPrinter, RegistrationMode_Append, Cleanup_Delete);
+
+				cameras[i].RegisterImageEventHandler(new CSampleImageEventHandler, RegistrationMode_ReplaceAll, Cleanup_Delete);
 
+				cameras[i].MaxNumBuffer = c_countOfImagesToGrab;
 
+				cameras[i].Open();
 
-		} while (((key != 'e') && (key != 'E')) );
+				//cameras[i].PixelFormat.SetValue(PixelFormat_Mono12);
+				cameras[i].AcquisitionMode.SetValue(AcquisitionMode_Continuous);
 
+				ConfigureBurstTrigger(cameras[i]);
 
+				//cameras[i].AcquisitionMode.SetValue(AcquisitionMode_Continuous);
+				//cameras[i].AcquisitionBurstFrameCount.SetValue(c_countOfImagesToGrab);
 
+
+				cameras[i].Gain.SetValue(0);
+				cameras[i].ExposureTime.SetValue(50000);
+				// Print the model name of the camera.
+				cout << "Using device " << cameras[i].GetDeviceInfo().GetModelName() << endl;
+
+
+				EnableTimestampChunks(cameras[i]);
+			}
+
+			TriggerBursts(cameras);
+		}
 	}
 	catch (GenICam::GenericException &e)
 	{
@@ -7,24 +7,71 @@
 #define USE_USB
 using namespace Pylon;
 
-#include <pylon/usb/BaslerUsbInstantCamera.h>
-#include <pylon/usb/BaslerUsbInstantCameraArray.h>
-//#include <pylon/usb/BaslerUsbDeviceInfo.h>
-typedef Pylon::CBaslerUsbInstantCamera Camera_t;
-typedef Pylon::CBaslerUsbImageEventHandler ImageEventHandler_t; // Or use Camera_t::ImageEventHandler_t
-typedef Pylon::CBaslerUsbGrabResultPtr GrabResultPtr_t; // Or use Camera_t::GrabResultPtr_t
+#if defined(USE_SYNTHETIC)
+// Settings to use the synthetic frame source instead of cameras, see include/SyntheticFrameSource.h.
+#include "../include/FrameSourceSelection.h"
+typedef Pylon::CSyntheticFrameSource Camera_t;
+typedef Pylon::CSyntheticFrameSourceArray CameraArray_t;
+typedef Pylon::CSyntheticImageEventHandler ImageEventHandler_t;
+typedef Pylon::CSyntheticGrabResultPtr GrabResultPtr_t;
 using namespace Basler_UsbCameraParams;
+#else
+// Settings to use the cameras of the transport selected above.
+#include "../include/CameraTransport.h"
+#include "../include/FrameSourceSelection.h"
+
+void ConfigureSoftwareTrigger(Camera_t& camera)
+{
+	CSoftwareTriggerConfiguration().OnOpened(camera);
+}
+
+bool IsFrameBurstStartAvailable(Camera_t& camera)
+{
+	return GenApi::IsAvailable(camera.TriggerSelector.GetEntry(TriggerSelector_FrameBurstStart)) && GenApi::IsWritable(camera.AcquisitionBurstFrameCount);
+}
+
+// WaitForFrameTriggerReady waits for FrameTriggerWait, a burst trigger is accepted on FrameBurstTriggerWait.
+bool WaitForBurstTriggerReady(Camera_t& camera, unsigned int timeoutMs)
+{
+	camera.AcquisitionStatusSelector.SetValue(AcquisitionStatusSelector_FrameBurstTriggerWait);
+	for (unsigned int waited = 0; !camera.AcquisitionStatus.GetValue(); ++waited)
+	{
+		if (waited >= timeoutMs)
+			return false;
+		WaitObject::Sleep(1);
+	}
+	return true;
+}
+#endif
 #include "../include/ConfigurationEventPrinter.h"
 #include "../include/ImageEventPrinter.h"
+#include "../include/FrameStorage.h"
+#include "../include/FrameStatistics.h"
+#include "../include/AutoExposureController.h"
+#include "../include/CameraParameterCache.h"
+#include "../include/AcquisitionModeSwitch.h"
+#include "../include/FrameTiming.h"
+#include "../include/FrameTimeSeries.h"
+#include "../include/PreviewRenderer.h"
+#include "../include/BurstStacker.h"
+#include "../include/SensorCalibration.h"
+#include "../include/BurstStreamWriter.h"
+#include "../include/RoiController.h"
+#include "../include/FrameMetadataLog.h"
+#include "../include/SharedFrameRing.h"
+#include "../include/FrameStreamServer.h"
 
 
 using namespace std;
 
 
 #include <time.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
 
 enum GrabState { Start, Preview, Burst, Teardown };
-enum KeyAction { NoAction, GainIncrease, GainDecrease, ExposureIncrease, ExposureDecrease, BurstGrab, Quit};
+enum KeyAction { NoAction, GainIncrease, GainDecrease, ExposureIncrease, ExposureDecrease, BurstGrab, AutoExposureToggle, BurstModeToggle, StackModeToggle, DarkCapture, FlatCapture, StreamBurstGrab, RoiToggle, Quit};
 
 static const size_t c_maxCamerasToUse = 1;
 static const uint32_t c_countOfImagesToGrab = 15;
@@ -41,102 +88,234 @@ static char filename[] = "Burst";
 static double Gain = 0.0;
 static double GainStep = 3.0;
 
-CBaslerUsbInstantCameraArray* cameras;
-
-static vector<vector<double>> _PC_frame_time_table(c_maxCamerasToUse * 2, vector<double>(c_countOfImagesToGrab, 0.0));
+// Burst with one FrameBurstStart trigger per camera, the sensor delivers the frames at its frame rate.
+// Cameras lacking the burst trigger, or all cameras with HardwareBurst off, are triggered per frame.
+static bool HardwareBurst = true;
+static double BurstFrameRate = 0.0; // Frame rate limit of the cameras, 0 for the maximum of the sensor.
+
+// The frames of a burst are stacked as they arrive into one frame saved after the burst, see include/BurstStacker.h.
+static EStackMode BurstStackMode = StackMode_Mean;
+
+// Dark and flat masters are captured as mean stacked bursts, 'd' with the lens covered, then 'f' of a uniformly lit
+// scene with the same exposure and gain, which is why both stop the auto exposure. The calibration is stored in CalibrationDirectory, and burst frames of a
+// camera with a calibration for its exposure, gain and AOI are corrected, see include/SensorCalibration.h.
+enum CalibrationCapture { CalibrationCapture_None, CalibrationCapture_Dark, CalibrationCapture_Flat };
+static CalibrationCapture _Calibration_capture = CalibrationCapture_None;
+static string CalibrationDirectory = ".";
+static CSensorCalibrationCache* _Calibration_cache = NULL;
+
+// A streaming burst copies its frames into a staging arena and writes them to a frame container while grabbing,
+// the buffers go back to the driver at once, so its length is not limited by MaxNumBuffer, see include/BurstStreamWriter.h.
+static uint32_t StreamBurstFrameCount = 10000;
+static size_t StreamArenaSize = 256 * 1024 * 1024;
+static CBurstStreamWriter* _Burst_stream = NULL;
+static atomic<bool> _Is_streaming_burst(false);
+
+// 'r' cycles the image AOI through the full sensor, an AOI of RoiWidth x RoiHeight in the center and one following the
+// brightest spot during Preview. A smaller AOI cuts the payload and raises the frame rate, see include/RoiController.h.
+enum RoiMode { RoiMode_Full, RoiMode_Center, RoiMode_Follow };
+static RoiMode _Roi_mode = RoiMode_Full;
+static int64_t RoiWidth = 640;
+static int64_t RoiHeight = 480;
+static vector<CRoiController<Camera_t>*> _Roi_controllers;
+
+// Every burst frame gets a record in the metadata log of its camera, <filename>-<serial>.meta, appended to across runs:
+// times, exposure and gain as set and, if the camera delivers the chunks, as exposed, the frame counter and the CRC status.
+// The records are written after each burst, see include/FrameMetadataLog.h.
+static vector<CFrameMetadataWriter*> _Frame_metadata;
+
+// With -publish <name> every frame is also published to the shared memory ring <name>-<camera> for analysis processes on
+// this host, which read them in place, see include/SharedFrameRing.h. The slots hold a full sensor frame of 16-bit pixels.
+static string PublishName;
+static uint32_t PublishSlotCount = 8;
+static vector<CSharedFrameRingWriter*> _Frame_rings;
+
+// With -serve <port> every frame is also sent to the TCP clients of camera i on port <port>+i, full or as a preview,
+// see include/FrameStreamServer.h. The queues of the clients hold grab results, MaxNumBuffer grows by their depth.
+// Burst frames are published as stored, after the calibration corrected them, frames a burst skips are not published.
+static int ServePort = -1;
+static SFrameStreamSettings ServeSettings;
+static vector<CFrameStreamServer*> _Frame_servers;
+
+// Auto exposure during Preview. Exposure is the BW exposure, color cameras use Exposure*ColorExposureMultiplier.
+static bool AutoExposure = true;
+static double AutoExposureTargetBW = 0.35;
+static double AutoExposureTargetColor = 0.35;
+static CAutoExposureController* _AutoExposure = NULL;
+static std::mutex _AutoExposureLock;
+
+CameraArray_t* cameras;
+
+// Host and camera times of the frames of the last burst in ns, sized by the camera count and the burst length.
+static CFrameTimeSeries _Frame_times;
+static string FrameTimesFormat; // csv or bin to store the times of every burst, empty to not store them.
+static vector<vector<SFrameStatistics>> _Frame_statistics(c_maxCamerasToUse, vector<SFrameStatistics>(c_countOfImagesToGrab));
+static vector<CFrameStatisticsCalculator> _Statistics_calculators(c_maxCamerasToUse);
+static vector<CPreviewRenderer> _Preview_renderers(c_maxCamerasToUse);
+static vector<CBurstStacker> _Burst_stackers(c_maxCamerasToUse);
+static vector<string> _Camera_serials(c_maxCamerasToUse);
+static vector<shared_ptr<const CSensorCalibration>> _Calibrations(c_maxCamerasToUse);
+static vector<SSensorCalibrationKey> _Dark_master_keys(c_maxCamerasToUse);
+static vector<vector<uint16_t>> _Dark_masters(c_maxCamerasToUse);
+static vector<size_t> _Dark_master_frame_counts(c_maxCamerasToUse, 0);
 static vector<bool> _IsCameraBW(c_maxCamerasToUse, 0);
+static vector<bool> _Is_hardware_burst(c_maxCamerasToUse, false);
+// Parameter writes go through the caches, see include/CameraParameterCache.h.
+static vector<CCameraParameterCache*> _Parameter_caches;
+// The cameras grab continuously, Preview and Burst switch between free-running and triggered acquisition.
+static CAcquisitionModeSwitch<CameraArray_t>* _Mode_switch = NULL;
+static chrono::steady_clock::time_point _Preview_switch_start;
+static atomic<bool> _Is_preview_switch_pending(false);
 static vector<int> _PC_triggered_frame_count(c_maxCamerasToUse, 0);
 static vector<int> _PC_captured_frame_count(c_maxCamerasToUse, 0);
 
-class MyBufferFactory;
-static vector<MyBufferFactory *> _ImageBuffers(c_maxCamerasToUse);
+// The buffers are kept across grabs, restarts with a smaller AOI allocate none.
+static vector<CPooledBufferFactory*> _ImageBuffers(c_maxCamerasToUse);
 
 
-static vector<vector<CBaslerUsbGrabResultPtr>> _Grab_results(c_maxCamerasToUse, vector<CBaslerUsbGrabResultPtr>(c_countOfImagesToGrab));
+static vector<vector<GrabResultPtr_t>> _Grab_results(c_maxCamerasToUse, vector<GrabResultPtr_t>(c_countOfImagesToGrab));
 
 
 void ProcessMessage(KeyAction Action);
+void _QueueExposureAndGain();
+void _QueueCameraSettings(size_t, int);
+void _PrintParameterWriteStatistics();
+void _StopStreaming();
+void _ConfigureBurstTrigger(size_t);
+void _PrintBurstTiming();
 void PrintTimeTable();
+void _StoreFrameTimes(int, char*);
 void _StoreFrames(int, char*);
-
-class MyBufferFactory : public IBufferFactory
+void _StoreStackedFrames(int, char*);
+void _StoreCalibrationFrames();
+void _StreamBurstGrab();
+void _OpenFrameMetadata();
+void _CreateFrameRings();
+void _StartFrameServers();
+int _GetServedBufferCount();
+void _FlushFrameMetadata();
+void _PublishFrame(size_t, const GrabResultPtr_t&);
+SFrameMetadata _GetFrameMetadata(size_t, const GrabResultPtr_t&, int);
+
+class CSampleImageEventHandler : public ImageEventHandler_t
 {
 public:
-	MyBufferFactory()
-		: m_lastBufferContext(1000)
+	virtual void OnImageGrabbed(Camera_t& camera, const GrabResultPtr_t& ptrGrabResult)
 	{
-	}
+		intptr_t cameraContextValue = ptrGrabResult->GetCameraContext();
 
-	virtual ~MyBufferFactory()
-	{
-	}
+		GrabResultPtr_t ptrGrabResultUsb = ptrGrabResult;
 
-	virtual void AllocateBuffer(size_t bufferSize, void** pCreatedBuffer, intptr_t& bufferContext)
-	{
-		try
+		if (_Roi_controllers[cameraContextValue]->OnFrame(ptrGrabResultUsb))
 		{
-			*pCreatedBuffer = new uint8_t[bufferSize];
-			bufferContext = ++m_lastBufferContext;
-
-			cout << "Created buffer " << bufferContext << ", " << *pCreatedBuffer << endl;
+			const SRoi roi = _Roi_controllers[cameraContextValue]->GetRoi();
+			cout << "First frame with AOI " << roi.Width << "x" << roi.Height << "+" << roi.OffsetX << "+" << roi.OffsetY << " after: "
+				<< _Roi_controllers[cameraContextValue]->GetLastLatency() * 1e3 << " ms" << endl;
 		}
-		catch (const std::exception&)
+
+		// Burst frames are published once they are corrected, see below.
+		if (G_State != Burst)
+			_PublishFrame(cameraContextValue, ptrGrabResultUsb);
+
+		#ifdef PYLON_WIN_BUILD
+			// Shows a reduced 8-bit preview instead of converting the full frame.
+			if (_Preview_renderers[cameraContextValue].Render(ptrGrabResultUsb))
+				Pylon::DisplayImage(cameraContextValue, _Preview_renderers[cameraContextValue].GetImage());
+		#endif
+
+		if (G_State == Preview && AutoExposure)
 		{
-			if (*pCreatedBuffer != NULL)
+			SFrameStatistics statistics;
+			if (_Statistics_calculators[cameraContextValue].Compute(ptrGrabResultUsb, statistics))
 			{
-				delete[] * pCreatedBuffer;
-				*pCreatedBuffer = NULL;
+				std::lock_guard<std::mutex> lock(_AutoExposureLock);
+				if (_AutoExposure->Update(cameraContextValue, statistics))
+				{
+					Exposure = _AutoExposure->GetExposure();
+					Gain = _AutoExposure->GetGain();
+					_QueueExposureAndGain();
+				}
 			}
-
-			throw;
 		}
-	}
-
-	virtual void FreeBuffer(void* pCreatedBuffer, intptr_t bufferContext)
-	{
-		uint8_t* p = reinterpret_cast<uint8_t*>(pCreatedBuffer);
-		delete[] p;
-		cout << "Freed buffer " << bufferContext << ", " << pCreatedBuffer << endl;
-	}
 
-	virtual void DestroyBufferFactory()
-	{
-		delete this;
-	}
-
-protected:
-	unsigned long m_lastBufferContext;
-};
-
-
-
-class CSampleImageEventHandler : public CImageEventHandler
-{
-public:
-	virtual void OnImageGrabbed(CInstantCamera& camera, const CGrabResultPtr& ptrGrabResult)
-	{
-		intptr_t cameraContextValue = ptrGrabResult->GetCameraContext();
+		// Writes the changes queued since the last frame of this camera, repeated key presses result in one write.
+		if (G_State == Preview)
+		{
+			_Parameter_caches[cameraContextValue]->Flush();
 
-		CBaslerUsbGrabResultPtr ptrGrabResultUsb = ptrGrabResult;
+			if (_Is_preview_switch_pending.exchange(false))
+			{
+				cout << "First Preview frame after: " << chrono::duration<double, milli>(chrono::steady_clock::now() - _Preview_switch_start).count() << " ms" << endl;
+			}
 
-		#ifdef PYLON_WIN_BUILD
-			Pylon::DisplayImage(cameraContextValue, ptrGrabResultUsb);
-		#endif
+			// The AOI is moved while grabbing when the spot leaves the middle half of it, the size stays.
+			double x = 0.0;
+			double y = 0.0;
+			if (_Roi_mode == RoiMode_Follow && GetBrightCentroid(ptrGrabResultUsb, x, y))
+			{
+				const SRoi roi = _Roi_controllers[cameraContextValue]->GetRoi();
+				if (abs(x - (roi.OffsetX + roi.Width / 2)) > roi.Width / 4 || abs(y - (roi.OffsetY + roi.Height / 2)) > roi.Height / 4)
+				{
+					_Roi_controllers[cameraContextValue]->RequestCenter(x, y);
+					_Roi_controllers[cameraContextValue]->Apply(false);
+				}
+			}
+		}
 
 		if (G_State == Burst)
 		{
+			// Frames exposed before the switch to triggered acquisition are preview frames.
+			if (IsReadable(ptrGrabResultUsb->ChunkTimestamp) && !_Mode_switch->IsTriggeredFrame(cameraContextValue, ptrGrabResultUsb->ChunkTimestamp.GetValue()))
+			{
+				cout << "Preview frame skipped" << endl;
+				return;
+			}
+
 			int _frame_index = 0;
 			_frame_index = _PC_captured_frame_count[cameraContextValue];
+			if (_frame_index >= (int)(_Is_streaming_burst ? StreamBurstFrameCount : c_countOfImagesToGrab))
+				return;
 			
-			cout << "Frame Grabbed      #: " << _frame_index << endl;
+			if (!_Is_streaming_burst)
+				cout << "Frame Grabbed      #: " << _frame_index << endl;
+
+			// The calibration of the burst is looked up with its first frame, the exposure and gain do not change during a burst.
+			if (_Calibration_capture == CalibrationCapture_None)
+			{
+				if (_frame_index == 0)
+				{
+					const double exposure = _IsCameraBW[cameraContextValue] ? Exposure : Exposure*ColorExposureMultiplier;
+					_Calibrations[cameraContextValue] = _Calibration_cache->Find(GetSensorCalibrationKey(_Camera_serials[cameraContextValue], exposure, Gain, ptrGrabResultUsb));
+				}
+				if (_Calibrations[cameraContextValue])
+					_Calibrations[cameraContextValue]->Correct(ptrGrabResultUsb);
+			}
+			// The frame servers send from the buffer later, it must not change after this.
+			_PublishFrame(cameraContextValue, ptrGrabResultUsb);
 
 			if (IsReadable(ptrGrabResultUsb->ChunkTimestamp))
 			{
-				_PC_frame_time_table[2 * cameraContextValue + 1][_frame_index] = 0.000000001*(double)ptrGrabResultUsb->ChunkTimestamp.GetValue();
+				_Frame_times.SetCameraTime(cameraContextValue, _frame_index, ptrGrabResultUsb->ChunkTimestamp.GetValue());
+			}
+			// A hardware burst has one trigger and a streaming burst is triggered ahead, the PC time is the arrival of the frames.
+			if (_Is_hardware_burst[cameraContextValue] || _Is_streaming_burst)
+			{
+				_Frame_times.SetHostTime(cameraContextValue, _frame_index, GetHostTimeNs());
+			}
+			_Frame_metadata[cameraContextValue]->Append(_GetFrameMetadata(cameraContextValue, ptrGrabResultUsb, _frame_index));
+
+			// The frame is copied, the buffer returns to the driver with the return of the handler. Dropped frames are counted by the stream.
+			if (_Is_streaming_burst)
+			{
+				_Burst_stream->Add(ptrGrabResultUsb, (uint32_t)cameraContextValue);
+				_PC_captured_frame_count[cameraContextValue] += 1;
+				return;
 			}
 			
 			
 			_Grab_results[cameraContextValue][_frame_index] = ptrGrabResultUsb;
+			_Statistics_calculators[cameraContextValue].Compute(ptrGrabResultUsb, _Frame_statistics[cameraContextValue][_frame_index]);
+			_Burst_stackers[cameraContextValue].Add(ptrGrabResultUsb);
 
 			
 
@@ -147,33 +326,78 @@ public:
 };
 
 
-void _BurstGrab()
+// Starts grabbing unless the cameras already grab. The buffers hold a burst and two preview frames.
+void _StartStreaming()
 {
+	if (cameras->operator[](0).IsGrabbing())
+		return;
+
 	for (size_t i = 0; i < cameras->GetSize(); ++i)
 	{
-		if (cameras->operator[](i).IsGrabbing())
-			cameras->operator[](i).StopGrabbing();
-
 		cameras->operator[](i).Open();
-		cameras->operator[](i).GainAuto.SetValue(GainAuto_Off);
-		cameras->operator[](i).Gain.SetValue(int(Gain));
-		if (_IsCameraBW[i])
-			cameras->operator[](i).ExposureTime.SetValue(Exposure);
-		else
-			cameras->operator[](i).ExposureTime.SetValue(Exposure*ColorExposureMultiplier);
-		cameras->operator[](i).MaxNumBuffer = c_countOfImagesToGrab;
+		ConfigureSoftwareTrigger(cameras->operator[](i));
+		_ConfigureBurstTrigger(i);
+		// The configuration wrote TriggerMode past the cache.
+		_Parameter_caches[i]->Invalidate();
+		_QueueCameraSettings(i, c_countOfImagesToGrab + 2 + _GetServedBufferCount());
+		if (_Is_hardware_burst[i])
+		{
+			_Parameter_caches[i]->Queue("AcquisitionBurstFrameCount", cameras->operator[](i).AcquisitionBurstFrameCount, (int64_t)c_countOfImagesToGrab);
+		}
+		_Parameter_caches[i]->Queue("AcquisitionFrameRateEnable", cameras->operator[](i).AcquisitionFrameRateEnable, BurstFrameRate > 0.0);
+		if (BurstFrameRate > 0.0)
+		{
+			_Parameter_caches[i]->Queue("AcquisitionFrameRate", cameras->operator[](i).AcquisitionFrameRate, BurstFrameRate);
+		}
+	}
+	FlushParameterCaches(_Parameter_caches);
+
+	for (size_t i = 0; i < cameras->GetSize(); ++i)
+	{
+		cameras->operator[](i).StartGrabbing(GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+	}
+}
+
+void _BurstGrab()
+{
+	const chrono::steady_clock::time_point switchStart = chrono::steady_clock::now();
+	_StartStreaming();
+	// Exposure and gain changes not yet written by the preview.
+	FlushParameterCaches(_Parameter_caches);
 
+	_Frame_times.Reset(cameras->GetSize(), c_countOfImagesToGrab);
+	for (size_t i = 0; i < cameras->GetSize(); ++i)
+	{
 		_PC_triggered_frame_count[i] = 0;
 		_PC_captured_frame_count[i] = 0;
+		_Burst_stackers[i].SetMode(_Calibration_capture != CalibrationCapture_None ? StackMode_Mean : BurstStackMode);
+		_Burst_stackers[i].Reset();
+	}
+	_Mode_switch->SwitchToTriggered();
+	cout << "Switch to Burst: " << chrono::duration<double, milli>(chrono::steady_clock::now() - switchStart).count() << " ms" << endl;
 
-		CSoftwareTriggerConfiguration().OnOpened(cameras->operator[](i));
-		cameras->operator[](i).StartGrabbing(c_countOfImagesToGrab, GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+	// One trigger starts the whole burst of a camera.
+	for (size_t i = 0; i < cameras->GetSize(); ++i)
+	{
+		if (!_Is_hardware_burst[i])
+			continue;
+		if (WaitForBurstTriggerReady(cameras->operator[](i), 1000))
+		{
+			cameras->operator[](i).ExecuteSoftwareTrigger();
+			cout << "Burst Triggered    #: " << c_countOfImagesToGrab << " frames" << endl;
+		}
+		else
+		{
+			cout << "Camera " << i << " not ready for the burst trigger" << endl;
+		}
 	}
 
 	for (size_t j = 0; j < c_countOfImagesToGrab; ++j)
 	{
 		for (size_t i = 0; i < cameras->GetSize(); ++i)
 		{
+			if (_Is_hardware_burst[i])
+				continue;
 			if (cameras->operator[](i).WaitForFrameTriggerReady(1000, TimeoutHandling_ThrowException))
 			{
 				cameras->operator[](i).ExecuteSoftwareTrigger();
@@ -183,27 +407,40 @@ void _BurstGrab()
 				cout << "Frame Triggered    #: " << _PC_triggered_frame_count[i] << endl;
 
 				WaitObject::Sleep(10);
-				_PC_frame_time_table[2 * i][j] = (double)clock() / CLOCKS_PER_SEC;
+				_Frame_times.SetHostTime(i, j, GetHostTimeNs());
 			}
 		}
 	}
 
-	unsigned char IsBurst = 1;
-
-	while (IsBurst > 0)
+	// The cameras keep grabbing, the burst is complete when every camera delivered its frames.
+	for (int waited = 0; ; waited += 10)
 	{
+		bool IsBurst = false;
 		for (size_t i = 0; i < cameras->GetSize(); ++i)
 		{
-			IsBurst = 0;
-			WaitObject::Sleep(50);
-			if (cameras->operator[](i).IsGrabbing()) IsBurst++;
+			if (_PC_captured_frame_count[i] < (int)c_countOfImagesToGrab) IsBurst = true;
 		}
+		if (!IsBurst)
+			break;
+		if (waited > 5000)
+		{
+			cout << "Burst incomplete" << endl;
+			break;
+		}
+		WaitObject::Sleep(10);
 	}
 
 	PrintTimeTable();
+	_PrintBurstTiming();
 
 	BurstCounter++;
+	_StoreFrameTimes(BurstCounter, filename);
+	_FlushFrameMetadata();
 	//_StoreFrames(BurstCounter, filename);
+	if (_Calibration_capture != CalibrationCapture_None)
+		_StoreCalibrationFrames();
+	else
+		_StoreStackedFrames(BurstCounter, filename);
 
 	for (size_t j = 0; j < c_countOfImagesToGrab; ++j)
 	{
@@ -216,12 +453,84 @@ void _BurstGrab()
 	ProcessMessage(NoAction);
 };
 
+// Streams StreamBurstFrameCount frames per camera to one frame container, triggering until every camera delivered them.
+void _StreamBurstGrab()
+{
+	_StartStreaming();
+	FlushParameterCaches(_Parameter_caches);
+
+	char stream_filename[512];
+	sprintf(stream_filename, "%s-%d-stream.frames", filename, BurstCounter + 1);
+	_Burst_stream->Open(stream_filename);
+	_Frame_times.Reset(cameras->GetSize(), StreamBurstFrameCount);
+	for (size_t i = 0; i < cameras->GetSize(); ++i)
+	{
+		_PC_captured_frame_count[i] = 0;
+	}
+	_Is_streaming_burst = true;
+	_Mode_switch->SwitchToTriggered();
+	cout << "Streaming Burst    #: " << StreamBurstFrameCount << " frames to " << stream_filename << endl;
+
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	chrono::steady_clock::time_point lastProgress = start;
+	int lastCapturedCount = 0;
+	for (;;)
+	{
+		bool IsBurst = false;
+		int capturedCount = 0;
+		for (size_t i = 0; i < cameras->GetSize(); ++i)
+		{
+			capturedCount += _PC_captured_frame_count[i];
+			if (_PC_captured_frame_count[i] >= (int)StreamBurstFrameCount)
+				continue;
+			IsBurst = true;
+			// A FrameBurstStart trigger delivers AcquisitionBurstFrameCount frames, the frames past the end are ignored.
+			if (_Is_hardware_burst[i] ? WaitForBurstTriggerReady(cameras->operator[](i), 10)
+				: cameras->operator[](i).WaitForFrameTriggerReady(10, TimeoutHandling_Return))
+			{
+				cameras->operator[](i).ExecuteSoftwareTrigger();
+			}
+		}
+		if (!IsBurst)
+			break;
+
+		const chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		if (capturedCount != lastCapturedCount)
+		{
+			if (capturedCount / 1000 != lastCapturedCount / 1000)
+				cout << "Frames Streamed    #: " << capturedCount << "  queued: " << _Burst_stream->GetQueuedCount() << "  dropped: " << _Burst_stream->GetDroppedCount() << endl;
+			lastCapturedCount = capturedCount;
+			lastProgress = now;
+		}
+		else if (now - lastProgress > chrono::seconds(5))
+		{
+			cout << "Burst incomplete" << endl;
+			break;
+		}
+	}
+	_Is_streaming_burst = false;
+	const double grabSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	_Burst_stream->Close();
+	const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	printf("Streamed %u frames in %.2f s (%.1f fps), written: %u  dropped: %u  queued max: %u of %u slots  arena: %.0f MB  disk: %.1f MB/s\n",
+		(unsigned int)_Burst_stream->GetAddedCount(), grabSeconds, _Burst_stream->GetAddedCount() / grabSeconds,
+		(unsigned int)_Burst_stream->GetWrittenCount(), (unsigned int)_Burst_stream->GetDroppedCount(), (unsigned int)_Burst_stream->GetMaxQueuedCount(),
+		(unsigned int)_Burst_stream->GetSlotCount(), _Burst_stream->GetArenaSize() / 1048576.0, _Burst_stream->GetBytesWritten() / seconds / 1048576.0);
+	_PrintBurstTiming();
+
+	BurstCounter++;
+	_StoreFrameTimes(BurstCounter, filename);
+	_FlushFrameMetadata();
+	ProcessMessage(NoAction);
+}
+
 void _StoreFrames(int Label, char *filename)
 {
 
 	for (size_t i = 0; i < cameras->GetSize(); ++i)
 	{
-		char camSerialNumber[100];
+		const char* camSerialNumber = _Camera_serials[i].c_str();
 		char camColor[50];
 		
 		if (_IsCameraBW[i] == true)
@@ -242,21 +551,15 @@ void _StoreFrames(int Label, char *filename)
 				void* Vbuffer = _Grab_results[i][j]->GetBuffer();
 				uint32_t Vwidth = _Grab_results[i][j]->GetWidth();
 				uint32_t Vheight = _Grab_results[i][j]->GetHeight();
-				FILE* pFile;
 				char raw_filename[512];
-				sprintf(raw_filename, "%s-%s-%iX%i-%u-%d-%d.raw", filename, camColor, Vwidth, Vheight, camSerialNumber, Label, j);
-				pFile = fopen(raw_filename, "wb");
-				if (pFile) fwrite(Vbuffer, 1, VbufferSize, pFile);
-				else printf("Can't open file");
-				fclose(pFile);
-
-				CPylonImage imageToSave;
-				imageToSave.AttachGrabResultBuffer(_Grab_results[i][j]);
+				sprintf(raw_filename, "%s-%s-%iX%i-%s-%d-%d.raw", filename, camColor, Vwidth, Vheight, camSerialNumber, Label, j);
+				if (!WriteRawFrame(raw_filename, Vbuffer, VbufferSize))
+					printf("Can't open file");
 
 				char bmp_filename[512];
-				sprintf(bmp_filename, "%s-%iX%i-%u-%d-%d.png", filename, Vwidth, Vheight, camSerialNumber, Label, j);
+				sprintf(bmp_filename, "%s-%iX%i-%s-%d-%d.png", filename, Vwidth, Vheight, camSerialNumber, Label, j);
 
-				imageToSave.Save(ImageFileFormat_Png, bmp_filename);
+				SavePngFrame(bmp_filename, Vbuffer, VbufferSize, _Grab_results[i][j]->GetPixelType(), Vwidth, Vheight, _Grab_results[i][j]->GetPaddingX());
 
 			}
 		}
@@ -266,20 +569,194 @@ void _StoreFrames(int Label, char *filename)
 
 };
 
+// Finishes the stacks of the burst and saves one frame per camera.
+void _StoreStackedFrames(int Label, char *filename)
+{
+	for (size_t i = 0; i < cameras->GetSize(); ++i)
+	{
+		if (_Burst_stackers[i].GetFrameCount() == 0)
+			continue;
+
+		const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		_Burst_stackers[i].Finish();
+		const CPylonImage& stack = _Burst_stackers[i].GetImage();
+		cout << "Camera " << i << " stacked " << _Burst_stackers[i].GetFrameCount() << (_Calibrations[i] ? " corrected" : "") << " frames, "
+			<< GetStackModeName(_Burst_stackers[i].GetMode()) << ": " << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+
+		char raw_filename[512];
+		sprintf(raw_filename, "%s-%s-%iX%i-%u-%d-%s.raw", filename, _IsCameraBW[i] ? "BW" : "Color", stack.GetWidth(), stack.GetHeight(), (unsigned int)i, Label,
+			GetStackModeName(_Burst_stackers[i].GetMode()));
+		if (!WriteRawFrame(raw_filename, stack.GetBuffer(), stack.GetImageSize()))
+			printf("Can't open file");
+
+		char png_filename[512];
+		sprintf(png_filename, "%s-%iX%i-%u-%d-%s.png", filename, stack.GetWidth(), stack.GetHeight(), (unsigned int)i, Label, GetStackModeName(_Burst_stackers[i].GetMode()));
+		SavePngFrame(png_filename, const_cast<void*>(stack.GetBuffer()), stack.GetImageSize(), stack.GetPixelType(), stack.GetWidth(), stack.GetHeight(), 0);
+	}
+}
+
+// Keeps the stacked dark, or stores the calibration from the kept dark and the stacked flat.
+void _StoreCalibrationFrames()
+{
+	for (size_t i = 0; i < cameras->GetSize(); ++i)
+	{
+		if (_Burst_stackers[i].GetFrameCount() == 0 || !_Grab_results[i][0].IsValid() || !CSensorCalibration::IsSupported(_Grab_results[i][0]->GetPixelType()))
+		{
+			cout << "Camera " << i << " has no frames to calibrate with" << endl;
+			continue;
+		}
+		_Burst_stackers[i].Finish();
+		const CPylonImage& master = _Burst_stackers[i].GetImage();
+		const uint16_t* pMaster = static_cast<const uint16_t*>(master.GetBuffer());
+		const double exposure = _IsCameraBW[i] ? Exposure : Exposure*ColorExposureMultiplier;
+		const SSensorCalibrationKey key = GetSensorCalibrationKey(_Camera_serials[i], exposure, Gain, _Grab_results[i][0]);
+
+		if (_Calibration_capture == CalibrationCapture_Dark)
+		{
+			_Dark_masters[i].assign(pMaster, pMaster + master.GetImageSize() / sizeof(uint16_t));
+			_Dark_master_keys[i] = key;
+			_Dark_master_frame_counts[i] = _Burst_stackers[i].GetFrameCount();
+			cout << "Camera " << i << " dark master of " << _Dark_master_frame_counts[i] << " frames for " << GetSensorCalibrationName(key) << endl;
+		}
+		else if (_Dark_masters[i].empty() || GetSensorCalibrationName(_Dark_master_keys[i]) != GetSensorCalibrationName(key))
+		{
+			cout << "Camera " << i << " has no dark master for " << GetSensorCalibrationName(key) << ", capture it with 'd' first" << endl;
+		}
+		else
+		{
+			_Calibration_cache->Store(key, &_Dark_masters[i][0], pMaster, (uint32_t)_Dark_master_frame_counts[i], (uint32_t)_Burst_stackers[i].GetFrameCount());
+			cout << "Camera " << i << " calibration stored in " << _Calibration_cache->GetFileName(key) << endl;
+		}
+	}
+	_Calibration_capture = CalibrationCapture_None;
+}
+
+// The intervals to the previous frame of every camera in seconds, host and camera time, and the statistics of the frame.
 void PrintTimeTable()
 {
-	for (size_t i = 0; i < c_countOfImagesToGrab - 1; ++i)
+	size_t frameCount = 0;
+	for (size_t j = 0; j < cameras->GetSize(); ++j)
+	{
+		frameCount = max(frameCount, min(_Frame_times.GetFrameCount(j), (size_t)c_countOfImagesToGrab));
+	}
+	for (size_t i = 1; i < frameCount; ++i)
 	{
 		cout << "Camera";
-		//for (size_t j = 0; j < c_maxCamerasToUse; ++j)
-		for (size_t j = 0; j < c_maxCamerasToUse; ++j)
+		for (size_t j = 0; j < cameras->GetSize(); ++j)
 		{
-			cout << " #" << j << ": " << _PC_frame_time_table[2 * j][i + 1] - _PC_frame_time_table[2 * j][i] << " Cam Time:" << _PC_frame_time_table[2 * j + 1][i + 1] - _PC_frame_time_table[2 * j + 1][i];
+			const CFrameTimeColumn& hostTimes = _Frame_times.GetHostTimes(j);
+			const CFrameTimeColumn& cameraTimes = _Frame_times.GetCameraTimes(j);
+			cout << " #" << j << ": " << (i < hostTimes.GetSize() ? 1e-9 * (hostTimes[i] - hostTimes[i - 1]) : 0.0)
+				<< " Cam Time:" << (i < cameraTimes.GetSize() ? 1e-9 * (cameraTimes[i] - cameraTimes[i - 1]) : 0.0);
+			cout << " Mean:" << _Frame_statistics[j][i].GetMean() << " Sat:" << _Frame_statistics[j][i].SaturatedFraction * 100.0 << "%";
 		}
 		cout << endl;
 	}
 }
 
+// Opens the metadata log of every camera, the records of earlier runs are kept.
+void _OpenFrameMetadata()
+{
+	for (size_t i = 0; i < cameras->GetSize(); ++i)
+	{
+		char metadata_filename[512];
+		sprintf(metadata_filename, "%s-%s.meta", filename, _Camera_serials[i].c_str());
+		_Frame_metadata.push_back(new CFrameMetadataWriter());
+		_Frame_metadata[i]->Open(metadata_filename, _Camera_serials[i]);
+		cout << "Frame metadata of camera " << i << ": " << metadata_filename << ", " << _Frame_metadata[i]->GetRecordCount() << " records" << endl;
+	}
+}
+
+// Creates the frame ring of every camera for -publish.
+void _CreateFrameRings()
+{
+	if (PublishName.empty())
+		return;
+
+	for (size_t i = 0; i < cameras->GetSize(); ++i)
+	{
+		char ring_name[256];
+		sprintf(ring_name, "%s-%u", PublishName.c_str(), (unsigned int)i);
+		const SRoiLimits limits = _Roi_controllers[i]->GetLimits();
+		_Frame_rings.push_back(new CSharedFrameRingWriter());
+		_Frame_rings[i]->Create(ring_name, PublishSlotCount, (size_t)(limits.SensorWidth * limits.SensorHeight * 2));
+		cout << "Publishing the frames of camera " << i << " to " << ring_name << endl;
+	}
+}
+
+// Starts the frame server of every camera for -serve.
+void _StartFrameServers()
+{
+	if (ServePort < 0)
+		return;
+
+	for (size_t i = 0; i < cameras->GetSize(); ++i)
+	{
+		_Frame_servers.push_back(new CFrameStreamServer(ServeSettings));
+		_Frame_servers[i]->Start((uint16_t)(ServePort + i));
+		cout << "Serving the frames of camera " << i << " on port " << _Frame_servers[i]->GetPort() << endl;
+	}
+}
+
+// Publishes a frame to the frame ring and the frame server of its camera.
+void _PublishFrame(size_t i, const GrabResultPtr_t& ptrGrabResult)
+{
+	const int64_t timestamp = IsReadable(ptrGrabResult->ChunkTimestamp) ? ptrGrabResult->ChunkTimestamp.GetValue() : 0;
+	if (!_Frame_rings.empty())
+		_Frame_rings[i]->Publish(ptrGrabResult, timestamp);
+	if (!_Frame_servers.empty())
+		_Frame_servers[i]->Publish(ptrGrabResult, timestamp);
+}
+
+// The buffers the queues of the frame server clients can hold.
+int _GetServedBufferCount()
+{
+	return ServePort < 0 ? 0 : (int)(ServeSettings.MaxClients * ServeSettings.QueueDepth);
+}
+
+// Writes the records of the burst. The cameras no longer append to them once the burst is complete.
+void _FlushFrameMetadata()
+{
+	for (size_t i = 0; i < _Frame_metadata.size(); ++i)
+	{
+		_Frame_metadata[i]->Flush();
+	}
+}
+
+// The record of a burst frame, called by the grab thread of the camera.
+SFrameMetadata _GetFrameMetadata(size_t i, const GrabResultPtr_t& ptrGrabResult, int frameIndex)
+{
+	SFrameMetadata metadata;
+	metadata.HostTime = GetFrameMetadataTimeNs();
+	if (IsReadable(ptrGrabResult->ChunkTimestamp))
+		metadata.CameraTime = ptrGrabResult->ChunkTimestamp.GetValue();
+	metadata.FrameCounter = ptrGrabResult->GetBlockID();
+	metadata.ExposureTime = _IsCameraBW[i] ? Exposure : Exposure*ColorExposureMultiplier;
+	metadata.Gain = Gain;
+	if (IsReadable(ptrGrabResult->ChunkExposureTime))
+		metadata.ChunkExposureTime = ptrGrabResult->ChunkExposureTime.GetValue();
+	if (IsReadable(ptrGrabResult->ChunkGain))
+		metadata.ChunkGain = ptrGrabResult->ChunkGain.GetValue();
+	metadata.Burst = (uint32_t)BurstCounter + 1;
+	metadata.FrameIndex = (uint32_t)frameIndex;
+	metadata.CrcStatus = GetFrameCrcStatus(ptrGrabResult);
+	return metadata;
+}
+
+// Stores the times of the frames of the burst in the format selected with -times.
+void _StoreFrameTimes(int Label, char *filename)
+{
+	if (FrameTimesFormat.empty())
+		return;
+
+	char times_filename[512];
+	sprintf(times_filename, "%s-%d-times.%s", filename, Label, FrameTimesFormat.c_str());
+	if (FrameTimesFormat == "csv")
+		_Frame_times.WriteCsv(times_filename);
+	else
+		_Frame_times.WriteBinary(times_filename);
+}
+
 
 KeyAction ParseKey(char key)
 {
@@ -295,6 +772,20 @@ KeyAction ParseKey(char key)
 		return ExposureDecrease;
 	else if (key == 'E')
 		return ExposureIncrease;
+	else if ((key == 'a' || key == 'A'))
+		return AutoExposureToggle;
+	else if ((key == 'h' || key == 'H'))
+		return BurstModeToggle;
+	else if ((key == 's' || key == 'S'))
+		return StackModeToggle;
+	else if ((key == 'd' || key == 'D'))
+		return DarkCapture;
+	else if ((key == 'f' || key == 'F'))
+		return FlatCapture;
+	else if ((key == 'l' || key == 'L'))
+		return StreamBurstGrab;
+	else if ((key == 'r' || key == 'R'))
+		return RoiToggle;
 	else return NoAction;
 };
 
@@ -311,6 +802,13 @@ void PrintState(char* Head, GrabState State, KeyAction Action)
 		case ExposureIncrease: ActionStr = "Exposure Increase"; break;
 		case ExposureDecrease:  ActionStr = "Exposure Decrease"; break;
 		case BurstGrab: ActionStr = "Burst Grab";  break;
+		case AutoExposureToggle: ActionStr = "Auto Exposure Toggle";  break;
+		case BurstModeToggle: ActionStr = "Burst Mode Toggle";  break;
+		case StackModeToggle: ActionStr = "Stack Mode Toggle";  break;
+		case DarkCapture: ActionStr = "Dark Capture";  break;
+		case FlatCapture: ActionStr = "Flat Capture";  break;
+		case StreamBurstGrab: ActionStr = "Streaming Burst Grab";  break;
+		case RoiToggle: ActionStr = "ROI Toggle";  break;
 		case Quit: ActionStr = "Quit";   break;
 		default: break;
 	}
@@ -326,9 +824,127 @@ void PrintState(char* Head, GrabState State, KeyAction Action)
 	cout << Head << "State:  " << StateStr << "    Action: " << ActionStr << endl;
 }
 
-void _Quit(){};
+void _Quit()
+{
+	_StopStreaming();
+	_PrintParameterWriteStatistics();
+	for (size_t i = 0; i < _Frame_metadata.size(); ++i)
+	{
+		_Frame_metadata[i]->Close();
+	}
+	// The readers see that no more frames follow.
+	for (size_t i = 0; i < _Frame_rings.size(); ++i)
+	{
+		_Frame_rings[i]->Close();
+	}
+	for (size_t i = 0; i < _Frame_servers.size(); ++i)
+	{
+		_Frame_servers[i]->Stop();
+	}
+};
+
+// Queues Exposure and Gain for all cameras. In Preview each camera writes them with its next frame.
+void _QueueExposureAndGain()
+{
+	for (size_t i = 0; i < cameras->GetSize(); ++i)
+	{
+		_Parameter_caches[i]->Queue("Gain", cameras->operator[](i).Gain, Gain);
+		_Parameter_caches[i]->Queue("ExposureTime", cameras->operator[](i).ExposureTime, _IsCameraBW[i] ? Exposure : Exposure*ColorExposureMultiplier);
+	}
+}
+
+// Queues the settings written before grabbing starts.
+void _QueueCameraSettings(size_t i, int maxNumBuffer)
+{
+	_Parameter_caches[i]->Queue("GainAuto", cameras->operator[](i).GainAuto, GainAuto_Off);
+	_Parameter_caches[i]->Queue("Gain", cameras->operator[](i).Gain, Gain);
+	_Parameter_caches[i]->Queue("ExposureTime", cameras->operator[](i).ExposureTime, _IsCameraBW[i] ? Exposure : Exposure*ColorExposureMultiplier);
+	_Parameter_caches[i]->Queue("MaxNumBuffer", cameras->operator[](i).MaxNumBuffer, maxNumBuffer);
+}
+
+// Selects the trigger of the burst. Called after ConfigureSoftwareTrigger, before grabbing starts.
+// The mode switch toggles TriggerMode of the selected trigger, FrameStart or FrameBurstStart.
+void _ConfigureBurstTrigger(size_t i)
+{
+	Camera_t& camera = cameras->operator[](i);
+	_Is_hardware_burst[i] = HardwareBurst && IsFrameBurstStartAvailable(camera);
+	if (HardwareBurst && !_Is_hardware_burst[i])
+	{
+		cout << "Camera " << i << " lacks FrameBurstStart, the burst is triggered per frame" << endl;
+	}
+
+	camera.TriggerSelector.SetValue(TriggerSelector_FrameStart);
+	if (_Is_hardware_burst[i])
+	{
+		camera.TriggerMode.SetValue(TriggerMode_Off);
+		camera.TriggerSelector.SetValue(TriggerSelector_FrameBurstStart);
+		camera.TriggerMode.SetValue(TriggerMode_On);
+		camera.TriggerSource.SetValue(TriggerSource_Software);
+	}
+}
+
+// Frame rate and interval jitter of the burst from the Timestamp chunks.
+void _PrintBurstTiming()
+{
+	for (size_t i = 0; i < cameras->GetSize(); ++i)
+	{
+		const SFrameTiming timing = GetFrameTiming(_Frame_times.GetCameraTimes(i));
+		printf("Camera %u %-17s frames: %2u  rate: %7.2f fps  interval: %7.3f ms  jitter: %6.3f ms  min: %7.3f ms  max: %7.3f ms\n",
+			(unsigned int)i, _Is_hardware_burst[i] ? "FrameBurstStart" : "trigger per frame", (unsigned int)timing.FrameCount, timing.FrameRate,
+			timing.MeanInterval * 1e3, timing.IntervalJitter * 1e3, timing.MinInterval * 1e3, timing.MaxInterval * 1e3);
+	}
+}
+
+void _PrintParameterWriteStatistics()
+{
+	for (size_t i = 0; i < _Parameter_caches.size(); ++i)
+	{
+		const map<string, SParameterWriteStatistics> statistics = _Parameter_caches[i]->GetStatistics();
+		for (map<string, SParameterWriteStatistics>::const_iterator it = statistics.begin(); it != statistics.end(); ++it)
+		{
+			printf("Camera %u %-26s requests: %4u  writes: %4u  saved: %4u  mean: %6.3f ms  max: %6.3f ms\n",
+				(unsigned int)i, it->first.c_str(), (unsigned int)it->second.Requests, (unsigned int)it->second.Transactions,
+				(unsigned int)it->second.GetSaved(), it->second.GetMeanSeconds() * 1e3, it->second.MaxSeconds * 1e3);
+		}
+	}
+}
+
+void _CreateAutoExposure()
+{
+	SAutoExposureSettings settings;
+	// The exposure limits apply to all cameras, the color cameras expose longer.
+	settings.MaxExposure = 100000.0 / ColorExposureMultiplier;
+	settings.MaxGain = 21.0;
+	// The frame being exposed and the one being transferred when a change is written, plus one waiting for the handler.
+	settings.FramesInFlight = 3;
+
+	_AutoExposure = new CAutoExposureController(settings, cameras->GetSize(), Exposure, Gain);
+	for (size_t i = 0; i < cameras->GetSize(); ++i)
+	{
+		_AutoExposure->SetTargetBrightness(i, _IsCameraBW[i] ? AutoExposureTargetBW : AutoExposureTargetColor);
+	}
+}
+
+// Manual exposure and gain changes switch the auto exposure off.
+void _StopAutoExposure()
+{
+	std::lock_guard<std::mutex> lock(_AutoExposureLock);
+	if (AutoExposure)
+	{
+		AutoExposure = false;
+		cout << "Auto Exposure: Off" << endl;
+	}
+}
 
-void _StopPreview()
+void _AutoExposureToggle()
+{
+	std::lock_guard<std::mutex> lock(_AutoExposureLock);
+	AutoExposure = !AutoExposure;
+	_AutoExposure->SetExposureAndGain(Exposure, Gain);
+	cout << "Auto Exposure: " << (AutoExposure ? "On" : "Off") << endl;
+}
+
+void _StopStreaming()
 {
 	for (size_t i = 0; i < cameras->GetSize(); ++i)
 	{
@@ -343,65 +959,94 @@ void _StartPreview()
 	{
 		cout << "++++++  Preview: Start" << endl;
 
-		for (size_t i = 0; i < cameras->GetSize(); ++i)
+		_Preview_switch_start = chrono::steady_clock::now();
+		_Is_preview_switch_pending = true;
+		_StartStreaming();
+		_Mode_switch->SwitchToFreeRun();
 		{
-			if (cameras->operator[](i).IsGrabbing())
-				cameras->operator[](i).StopGrabbing();
+			std::lock_guard<std::mutex> lock(_AutoExposureLock);
+			_AutoExposure->SetExposureAndGain(Exposure, Gain);
+		}
+		cout << "Switch to Preview: " << chrono::duration<double, milli>(chrono::steady_clock::now() - _Preview_switch_start).count() << " ms" << endl;
+	}
+};
 
-			cameras->operator[](i).Open();
-			cameras->operator[](i).GainAuto.SetValue(GainAuto_Off);
-			cameras->operator[](i).Gain.SetValue(int(Gain));
-		
-			if (_IsCameraBW[i])
-				cameras->operator[](i).ExposureTime.SetValue(Exposure);
-			else
-				cameras->operator[](i).ExposureTime.SetValue(Exposure*ColorExposureMultiplier);
 
-			cameras->operator[](i).MaxNumBuffer = 2;
+// The burst trigger is configured before grabbing starts, the grab is restarted once.
+void _BurstModeToggle()
+{
+	HardwareBurst = !HardwareBurst;
+	cout << "Burst Mode: " << (HardwareBurst ? "FrameBurstStart" : "Trigger per frame") << endl;
+	_StopStreaming();
+	_StartPreview();
+}
 
-			CAcquireContinuousConfiguration().OnOpened(cameras->operator[](i));
-			cameras->operator[](i).StartGrabbing(GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
-		}
+// Moves the AOI while grabbing if only its position changes, else the grab is restarted once for all cameras.
+void _RoiToggle()
+{
+	_Roi_mode = _Roi_mode == RoiMode_Full ? RoiMode_Center : _Roi_mode == RoiMode_Center ? RoiMode_Follow : RoiMode_Full;
+	cout << "ROI Mode: " << (_Roi_mode == RoiMode_Full ? "Full sensor" : _Roi_mode == RoiMode_Center ? "Center" : "Follow") << endl;
+
+	bool isRestart = false;
+	for (size_t i = 0; i < cameras->GetSize(); ++i)
+	{
+		const SRoiLimits limits = _Roi_controllers[i]->GetLimits();
+		if (_Roi_mode == RoiMode_Full)
+			_Roi_controllers[i]->RequestFullSensor();
+		else if (_Roi_mode == RoiMode_Center)
+			_Roi_controllers[i]->Request(GetCenteredRoi(limits, RoiWidth, RoiHeight, limits.SensorWidth / 2, limits.SensorHeight / 2));
+		_Roi_controllers[i]->Apply(false);
+		isRestart = isRestart || _Roi_controllers[i]->IsPending();
 	}
-};
+	if (!isRestart)
+		return;
 
+	_StopStreaming();
+	for (size_t i = 0; i < cameras->GetSize(); ++i)
+	{
+		_Roi_controllers[i]->Apply(true);
+	}
+	_StartPreview();
+}
 
+// Takes effect with the next burst.
+void _StackModeToggle()
+{
+	BurstStackMode = BurstStackMode == StackMode_Mean ? StackMode_SigmaClippedMean : BurstStackMode == StackMode_SigmaClippedMean ? StackMode_Median : StackMode_Mean;
+	cout << "Stack Mode: " << GetStackModeName(BurstStackMode) << endl;
+}
 
 void _GainIncrease()
-{ 
+{
+	_StopAutoExposure();
 	Gain = Gain + GainStep; 
 	if (Gain > 23.79 ) Gain = 21.0;
-	for (size_t i = 0; i < cameras->GetSize(); ++i)
-	{
-		cameras->operator[](i).Gain.SetValue(Gain);
-	}
+	_QueueExposureAndGain();
 	cout << "Camera Gain: " << Gain << " dB" << endl;
 };
 
 void _GainDecrease()
 {
+	_StopAutoExposure();
 	Gain = Gain - GainStep;
 	if (Gain < 0.0) Gain = 0.0;
-	for (size_t i = 0; i < cameras->GetSize(); ++i)
-	{
-		cameras->operator[](i).Gain.SetValue(Gain);
-	}
+	_QueueExposureAndGain();
 	cout << "Camera Gain: " << Gain << " dB" << endl;
 };
 
 void _ExposureIncrease()
 {
+	_StopAutoExposure();
 	Exposure = Exposure * ExposureStep;
+	_QueueExposureAndGain();
 	for (size_t i = 0; i < cameras->GetSize(); ++i)
 	{
 		if (_IsCameraBW[i])
 		{
-			cameras->operator[](i).ExposureTime.SetValue(Exposure);
 			cout << "Camera BW Exposure: " << Exposure << " mks" << endl;
 		}
 		else
 		{
-			cameras->operator[](i).ExposureTime.SetValue(Exposure*ColorExposureMultiplier);
 			cout << "Camera Color Exposure: " << Exposure*ColorExposureMultiplier << " mks" << endl;
 		}
 	}
@@ -409,18 +1054,18 @@ void _ExposureIncrease()
 
 void _ExposureDecrease()
 {
+	_StopAutoExposure();
 	Exposure = Exposure / ExposureStep;
+	_QueueExposureAndGain();
 
 	for (size_t i = 0; i < cameras->GetSize(); ++i)
 	{
 		if (_IsCameraBW[i])
 		{
-			cameras->operator[](i).ExposureTime.SetValue(Exposure);
 			cout << "Camera BW Exposure: " << Exposure << " mks" << endl;
 		}
 		else
 		{
-			cameras->operator[](i).ExposureTime.SetValue(Exposure*ColorExposureMultiplier);
 			cout << "Camera Color Exposure: " << Exposure*ColorExposureMultiplier << " mks" << endl;
 		}
 	}
@@ -455,7 +1100,14 @@ void ProcessMessage(KeyAction Action)
 				case GainDecrease: _GainDecrease(); break;
 				case ExposureIncrease: _ExposureIncrease(); break;
 				case ExposureDecrease: _ExposureDecrease(); break;
-				case BurstGrab: _StopPreview(); G_State = Burst; _BurstGrab(); break;
+				case AutoExposureToggle: _AutoExposureToggle(); break;
+				case BurstModeToggle: _BurstModeToggle(); break;
+				case StackModeToggle: _StackModeToggle(); break;
+				case DarkCapture: _StopAutoExposure(); G_State = Burst; _Calibration_capture = CalibrationCapture_Dark; _BurstGrab(); break;
+				case FlatCapture: _StopAutoExposure(); G_State = Burst; _Calibration_capture = CalibrationCapture_Flat; _BurstGrab(); break;
+				case BurstGrab: G_State = Burst; _BurstGrab(); break;
+				case StreamBurstGrab: G_State = Burst; _StreamBurstGrab(); break;
+				case RoiToggle: _RoiToggle(); break;
 				case Quit: G_State = Teardown; _Quit(); break;
 				default: break;
 			}
@@ -493,12 +1145,80 @@ void ProcessMessage(KeyAction Action)
 	return;
 }
 
+// The frame source is selected when building, USE_SYNTHETIC grabs from synthetic frame sources and otherwise the cameras of
+// Camera_t are used. The globals and handlers of this sample are typed on Camera_t, so -source and SAMPLE_FRAME_SOURCE
+// cannot switch at run time and are checked against the build.
+void CheckFrameSource(int argc, char* argv[])
+{
+	const EFrameSource frameSource = GetFrameSource(argc, argv);
+#if defined(USE_SYNTHETIC)
+	if (frameSource != FrameSource_Synthetic && (GetCommandLineOption(argc, argv, "-source") != NULL || getenv("SAMPLE_FRAME_SOURCE") != NULL))
+		throw RUNTIME_EXCEPTION("This build grabs from synthetic frame sources. Build without USE_SYNTHETIC to grab from cameras.");
+#else
+	if (frameSource == FrameSource_Emulator)
+		throw RUNTIME_EXCEPTION("The camera emulator does not provide the USB camera features used by this sample. Use -source synthetic with a build defining USE_SYNTHETIC.");
+	if (frameSource == FrameSource_Synthetic)
+		throw RUNTIME_EXCEPTION("This build grabs from cameras. Define USE_SYNTHETIC to grab from synthetic frame sources.");
+#endif
+}
+
 int main(int argc, char* argv[])
 {
 
     int exitCode = 0;
+    try
+    {
+        CheckFrameSource(argc, argv);
+    }
+    catch (GenICam::GenericException &e)
+    {
+        cerr << e.GetDescription() << endl;
+        return 1;
+    }
     Pylon::PylonAutoInitTerm autoInitTerm;
-	
+
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		if (strcmp(argv[i], "-stack") == 0)
+			BurstStackMode = GetStackMode(argv[i + 1]);
+		else if (strcmp(argv[i], "-calibration") == 0)
+			CalibrationDirectory = argv[i + 1];
+		else if (strcmp(argv[i], "-stream-frames") == 0)
+			StreamBurstFrameCount = (uint32_t)max(1, atoi(argv[i + 1]));
+		else if (strcmp(argv[i], "-stream-arena") == 0)
+			StreamArenaSize = (size_t)max(1, atoi(argv[i + 1])) * 1024 * 1024;
+		else if (strcmp(argv[i], "-times") == 0)
+			FrameTimesFormat = strcmp(argv[i + 1], "csv") == 0 ? "csv" : "bin";
+		else if (strcmp(argv[i], "-roi") == 0)
+			sscanf(argv[i + 1], "%lldx%lld", (long long*)&RoiWidth, (long long*)&RoiHeight);
+		else if (strcmp(argv[i], "-publish") == 0)
+			PublishName = argv[i + 1];
+		else if (strcmp(argv[i], "-publish-slots") == 0)
+			PublishSlotCount = (uint32_t)max(1, atoi(argv[i + 1]));
+		else if (strcmp(argv[i], "-serve") == 0)
+			ServePort = max(0, atoi(argv[i + 1]));
+	}
+	_Calibration_cache = new CSensorCalibrationCache(CalibrationDirectory);
+	SBurstStreamSettings streamSettings;
+	streamSettings.ArenaSize = StreamArenaSize;
+	_Burst_stream = new CBurstStreamWriter(streamSettings);
+
+#if defined(USE_SYNTHETIC)
+	SSyntheticFrameSourceSettings syntheticSettings = GetSyntheticSettings(argc, argv);
+	cameras = new CameraArray_t(c_maxCamerasToUse, syntheticSettings);
+
+	for (size_t i = 0; i < cameras->GetSize(); ++i)
+	{
+		cameras->operator[](i).RegisterImageEventHandler(new CSampleImageEventHandler, RegistrationMode_Append, Cleanup_Delete);
+		cameras->operator[](i).Open();
+
+		_IsCameraBW[i] = syntheticSettings.PixelType != PixelType_BayerGB12;
+		_Camera_serials[i] = GetCalibrationSerialNumber(cameras->operator[](i));
+		_Parameter_caches.push_back(new CCameraParameterCache());
+		_Parameter_caches[i]->Write("ExposureTime", cameras->operator[](i).ExposureTime, _IsCameraBW[i] ? Exposure : Exposure*ColorExposureMultiplier);
+		cout << "Using device " << cameras->operator[](i).GetDeviceInfo().GetModelName() << endl;
+	}
+#else
 	CDeviceInfo info;
 	info.SetDeviceClass(Camera_t::DeviceClass());
 	CTlFactory& tlFactory = CTlFactory::GetInstance();
@@ -511,7 +1231,7 @@ int main(int argc, char* argv[])
 
 	int cam_num = devices.size();
 
-	cameras = new CBaslerUsbInstantCameraArray(min(devices.size(), c_maxCamerasToUse));
+	cameras = new CameraArray_t(min(devices.size(), c_maxCamerasToUse));
 	// Create and attach all Pylon Devices.
 	for (size_t i = 0; i < cameras->GetSize(); ++i)
 	{
@@ -523,10 +1243,11 @@ int main(int argc, char* argv[])
 
 		
 
-		_ImageBuffers[i] = new MyBufferFactory();
+		_ImageBuffers[i] = new CPooledBufferFactory();
 		cameras->operator[](i).SetBufferFactory(_ImageBuffers[i], Cleanup_None);
 
 		CDeviceInfo & diRef = devices[i];
+		_Camera_serials[i] = GetCalibrationSerialNumber(cameras->operator[](i));
 
 		if (diRef.GetModelName().find(GenICam::gcstring("acA2500-14uc")) != GenICam::gcstring::_npos())
 		{
@@ -543,10 +1264,8 @@ int main(int argc, char* argv[])
 
 		//cameras->operator[](i).Gain.SetValue(0);
 	
-		if (_IsCameraBW[i])
-			cameras->operator[](i).ExposureTime.SetValue(Exposure);
-		else 
-			cameras->operator[](i).ExposureTime.SetValue(Exposure*ColorExposureMultiplier);
+		_Parameter_caches.push_back(new CCameraParameterCache());
+		_Parameter_caches[i]->Write("ExposureTime", cameras->operator[](i).ExposureTime, _IsCameraBW[i] ? Exposure : Exposure*ColorExposureMultiplier);
 		cout << "Using device " << cameras->operator[](i).GetDeviceInfo().GetModelName() << endl;
 
 		if (GenApi::IsWritable(cameras->operator[](i).ChunkModeActive))
@@ -560,10 +1279,37 @@ int main(int argc, char* argv[])
 
 		cameras->operator[](i).ChunkSelector.SetValue(ChunkSelector_Timestamp);
 		cameras->operator[](i).ChunkEnable.SetValue(true);
+		// The exposure, gain and payload CRC of every frame for the metadata log, where the camera has them.
+		const ChunkSelectorEnums metadataChunks[] = { ChunkSelector_ExposureTime, ChunkSelector_Gain, ChunkSelector_PayloadCRC16 };
+		for (size_t c = 0; c < sizeof(metadataChunks) / sizeof(metadataChunks[0]); ++c)
+		{
+			if (GenApi::IsAvailable(cameras->operator[](i).ChunkSelector.GetEntry(metadataChunks[c])))
+			{
+				cameras->operator[](i).ChunkSelector.SetValue(metadataChunks[c]);
+				cameras->operator[](i).ChunkEnable.SetValue(true);
+			}
+		}
+
+		// The buffers of a burst and two preview frames for the full sensor, every smaller AOI fits into them.
+		_ImageBuffers[i]->Reserve(c_countOfImagesToGrab + 2 + _GetServedBufferCount(), (size_t)cameras->operator[](i).PayloadSize.GetValue());
+	}
+#endif
+	for (size_t i = 0; i < cameras->GetSize(); ++i)
+	{
+		_Roi_controllers.push_back(new CRoiController<Camera_t>(cameras->operator[](i)));
+		_Roi_controllers[i]->Open();
 	}
 
     try
     {    
+		// The log files, the shared memory rings and the server ports can fail to open, e.g. when they are in use.
+		_OpenFrameMetadata();
+		_CreateFrameRings();
+		_StartFrameServers();
+
+		_CreateAutoExposure();
+		_Mode_switch = new CAcquisitionModeSwitch<CameraArray_t>(*cameras, _Parameter_caches);
+
 		char key;
 	
 		ProcessMessage(Action);
@@ -20,18 +20,15 @@ image event handlers. Please note that this is not shown in this example.
 
 #define USE_USB
 
-#if defined(USE_USB)
-// Settings to use Basler USB cameras.
-#include <pylon/usb/BaslerUsbInstantCamera.h>
-#include <pylon/usb/BaslerUsbInstantCameraArray.h>
-typedef Pylon::CBaslerUsbInstantCamera Camera_t;
-typedef Pylon::CBaslerUsbImageEventHandler ImageEventHandler_t; // Or use Camera_t::ImageEventHandler_t
-typedef Pylon::CBaslerUsbGrabResultPtr GrabResultPtr_t; // Or use Camera_t::GrabResultPtr_t
-using namespace Basler_UsbCameraParams;
-#endif
+// Settings to use the cameras of the transport selected above.
+#include "../include/CameraTransport.h"
 
 #include "../include/ConfigurationEventPrinter.h"
 #include "../include/ImageEventPrinter.h"
+#include "../include/PreviewRenderer.h"
+#include "../include/FrameTimeSeries.h"
+#include "../include/TriggerFanOut.h"
+#include "../include/FrameSourceSelection.h"
 
 #include <time.h>
 
@@ -52,19 +49,28 @@ static vector<double> _PC_frame_start(c_maxCamerasToUse, 0.0);
 static vector<double> _PC_frame_stop(c_maxCamerasToUse, 0.0);
 static vector<int> _PC_frame_count(c_maxCamerasToUse, 0);
 
-static vector<vector<double>> _PC_frame_time_table(c_maxCamerasToUse * 2, vector<double>(c_countOfImagesToGrab + 3, 0.0));
+// Host and camera times of the frames in ns, sized by the cameras found.
+static CFrameTimeSeries _Frame_times;
+static vector<CPreviewRenderer> _Preview_renderers(c_maxCamerasToUse);
+
+static int c_FrameSetTriggered = 0;
 
-static char IsBurstStarted = 0;
-static int c_FrameSetTriggered = -1;
+// The triggers of a frame set are fired together by CTriggerFanOut, with -sequential one after the other.
+// The skew of the sets is measured from the Timestamp chunks with the clock offsets of the cameras, see include/TriggerFanOut.h.
+static bool IsSequentialTrigger = false;
+static vector<SCameraClockOffset> _Clock_offsets;
 
-class CSampleImageEventHandler : public CBaslerUsbImageEventHandler //CImageEventHandler //CBaslerUsbImageEventHandler
+// Records the frame times. Instantiated for cameras and for the synthetic frame source.
+template <typename ImageEventHandlerT, typename CameraT, typename GrabResultPtrT>
+class CSampleImageEventHandlerT : public ImageEventHandlerT //CImageEventHandler //CBaslerUsbImageEventHandler
 {
 public:
-	virtual void OnImageGrabbed(CBaslerUsbInstantCamera& camera, const CBaslerUsbGrabResultPtr& ptrGrabResult)
+	virtual void OnImageGrabbed(CameraT& camera, const GrabResultPtrT& ptrGrabResult)
 	{
 		intptr_t cameraContextValue = ptrGrabResult->GetCameraContext();
 		_PC_frame_stop[cameraContextValue] = (double)clock() / CLOCKS_PER_SEC;
-		Pylon::DisplayImage(cameraContextValue, ptrGrabResult);
+		if (_Preview_renderers[cameraContextValue].Render(ptrGrabResult))
+			Pylon::DisplayImage(cameraContextValue, _Preview_renderers[cameraContextValue].GetImage());
 
 		if (PayloadType_ChunkData != ptrGrabResult->GetPayloadType()) throw RUNTIME_EXCEPTION("Unexpected payload type received.");
 
@@ -72,153 +78,203 @@ public:
 		if (_PC_frame_count[cameraContextValue] < c_countOfImagesToGrab)
 		{
 			int _frame_index = _PC_frame_count[cameraContextValue];
-			_PC_frame_time_table[2*cameraContextValue][_frame_index] = _PC_frame_stop[cameraContextValue];// (double)clock() / CLOCKS_PER_SEC;
+			_Frame_times.SetHostTime(cameraContextValue, _frame_index, GetHostTimeNs());
 
 			if (IsReadable(ptrGrabResult->ChunkTimestamp))
 			{
-				_PC_frame_time_table[2*cameraContextValue + 1][_frame_index] = 0.000000001*(double)ptrGrabResult->ChunkTimestamp.GetValue();
+				_Frame_times.SetCameraTime(cameraContextValue, _frame_index, ptrGrabResult->ChunkTimestamp.GetValue());
 			}
 
 			_PC_frame_count[cameraContextValue] += 1;
 
 			_PrevTimestamp[cameraContextValue] = _CurrTimestamp[cameraContextValue];
-
-			camera.ExecuteSoftwareTrigger();
-			_PC_frame_start[cameraContextValue] = (double)clock() / CLOCKS_PER_SEC;
 		}
 	}
 };
 
+typedef CSampleImageEventHandlerT<ImageEventHandler_t, Camera_t, GrabResultPtr_t> CSampleImageEventHandler;
+typedef CSampleImageEventHandlerT<CSyntheticImageEventHandler, CSyntheticFrameSource, CSyntheticGrabResultPtr> CSyntheticSampleImageEventHandler;
+
+// Enables the Timestamp chunks the frame times and the trigger skew are taken from.
+void EnableTimestampChunks(Camera_t& camera)
+{
+	if (GenApi::IsWritable(camera.ChunkModeActive))
+	{
+		camera.ChunkModeActive.SetValue(true);
+	}
+	else
+	{
+		throw RUNTIME_EXCEPTION("The camera doesn't support chunk features");
+	}
+
+	// Enable time stamp chunks.
+	camera.ChunkSelector.SetValue(ChunkSelector_Timestamp);
+	camera.ChunkEnable.SetValue(true);
+}
+
+// The synthetic frame source always delivers the Timestamp chunk when chunks are active.
+void EnableTimestampChunks(CSyntheticFrameSource& camera)
+{
+	camera.ChunkModeActive.SetValue(true);
+}
+
+// The intervals to the previous frame of every camera in seconds, host and camera time.
 void PrintTimeTable()
 {
-	for (size_t i = 0; i < c_countOfImagesToGrab; ++i)
+	size_t frameCount = 0;
+	for (size_t j = 0; j < _Frame_times.GetCameraCount(); ++j)
+	{
+		frameCount = max(frameCount, _Frame_times.GetFrameCount(j));
+	}
+	for (size_t i = 1; i < frameCount; ++i)
 	{
 		cout << "Camera";
-		//for (size_t j = 0; j < c_maxCamerasToUse; ++j)
-		for (size_t j = 0; j < c_maxCamerasToUse; ++j)
+		for (size_t j = 0; j < _Frame_times.GetCameraCount(); ++j)
 		{
-			cout << " #" << j << ": " << _PC_frame_time_table[2*j][i + 1] - _PC_frame_time_table[2*j][i] << " Cam Time:" << _PC_frame_time_table[2*j + 1][i + 1] - _PC_frame_time_table[2*j + 1][i];
+			const CFrameTimeColumn& hostTimes = _Frame_times.GetHostTimes(j);
+			const CFrameTimeColumn& cameraTimes = _Frame_times.GetCameraTimes(j);
+			cout << " #" << j << ": " << (i < hostTimes.GetSize() ? 1e-9 * (hostTimes[i] - hostTimes[i - 1]) : 0.0)
+				<< " Cam Time:" << (i < cameraTimes.GetSize() ? 1e-9 * (cameraTimes[i] - cameraTimes[i - 1]) : 0.0);
 		}
 		cout << endl;
 	}
 }
 
-
-int main(int argc, char* argv[])
+// The spread of the exposure starts of the frame sets on the host clock.
+void PrintTriggerSkew()
 {
-	// The exit code of the sample application.
-	int exitCode = 0;
+	vector<int64_t> skews = GetTriggerSkewsNs(_Frame_times, _Clock_offsets);
+	if (skews.empty())
+		return;
 
-	Pylon::PylonAutoInitTerm autoInitTerm;
-
-	try
+	sort(skews.begin(), skews.end());
+	int64_t uncertainty = 0;
+	for (size_t i = 0; i < _Clock_offsets.size(); ++i)
 	{
+		uncertainty = max(uncertainty, _Clock_offsets[i].UncertaintyNs);
+	}
+	cout << (IsSequentialTrigger ? "Sequential" : "Coordinated") << " trigger skew of " << skews.size() << " sets: median " << 1e-3 * skews[skews.size() / 2]
+		<< " us, max " << 1e-3 * skews.back() << " us, clock offsets +-" << 1e-3 * uncertainty << " us" << endl;
+}
 
-		CDeviceInfo info;
-		info.SetDeviceClass(Camera_t::DeviceClass());
-
-		// Get the transport layer factory.
-		CTlFactory& tlFactory = CTlFactory::GetInstance();
-
-		// Get all attached devices and exit application if no device is found.
-		DeviceInfoList_t devices;
-		if (tlFactory.EnumerateDevices(devices) == 0)
-		{
-			throw RUNTIME_EXCEPTION("No camera present.");
-		}
-		CBaslerUsbInstantCameraArray cameras(min(devices.size(), c_maxCamerasToUse));
-
-		// Create and attach all Pylon Devices.
-		for (size_t i = 0; i < cameras.GetSize(); ++i)
-		{
-			cameras[i].Attach(tlFactory.CreateDevice(devices[i]));
-
-			cameras[i].RegisterConfiguration(new CSoftwareTriggerConfiguration, RegistrationMode_ReplaceAll, Cleanup_Delete);
-			cameras[i].RegisterConfiguration(new CConfigurationEventPrinter, RegistrationMode_Append, Cleanup_Delete);
-
-			//cameras[i].RegisterImageEventHandler(new CImageEventPrinter, RegistrationMode_Append, Cleanup_Delete);
-			cameras[i].RegisterImageEventHandler(new CSampleImageEventHandler, RegistrationMode_Append, Cleanup_Delete);
 
-			cameras[i].Open();
+// Starts grabbing and triggers the frame sets when "t" is entered.
+template <typename CameraArrayT>
+void TriggerFrameSets(CameraArrayT& cameras)
+{
+	//cameras.StartGrabbing(10, GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+	for (size_t i = 0; i < cameras.GetSize(); ++i)
+	{
+		cameras[i].StartGrabbing(c_countOfImagesToGrab, GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+		_Clock_offsets.push_back(GetCameraClockOffset(cameras[i]));
+	}
+	CTriggerFanOut<CameraArrayT> fanOut(cameras);
 
-			//cameras[i].PixelFormat.SetValue(PixelFormat_Mono12);
 
-			cameras[i].Gain.SetValue(0);
-			cameras[i].ExposureTime.SetValue(50000);
-			// Print the model name of the camera.
-			cout << "Using device " << cameras[i].GetDeviceInfo().GetModelName() << endl;
+	cerr << endl << "Enter \"t\" to trigger the cameras or \"e\" to exit and press enter? (t/e)" << endl << endl;
 
+	char key;
+	do
+	{
+		cin.get(key);
 
-			if (GenApi::IsWritable(cameras[i].ChunkModeActive))
+		// Triggers all frame sets, each when every camera is ready for it.
+		while ((key == 't' || key == 'T') && c_FrameSetTriggered < (int)c_countOfImagesToGrab)
+		{
+			if (IsSequentialTrigger ? !FireSequentially(cameras, 300) : !fanOut.Fire())
 			{
-				cameras[i].ChunkModeActive.SetValue(true);
+				throw RUNTIME_EXCEPTION("The cameras were not ready for frame set %d.", c_FrameSetTriggered);
 			}
-			else
+			for (size_t i = 0; i < cameras.GetSize(); ++i)
 			{
-				throw RUNTIME_EXCEPTION("The camera doesn't support chunk features");
+				_PC_frame_start[i] = (double)clock() / CLOCKS_PER_SEC;
 			}
-
-			// Enable time stamp chunks.
-			cameras[i].ChunkSelector.SetValue(ChunkSelector_Timestamp);
-			cameras[i].ChunkEnable.SetValue(true);
-
+			c_FrameSetTriggered++;
 		}
+	} while ((key != 'e') && (key != 'E'));
+}
 
-		//cameras.StartGrabbing(10, GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
-		for (size_t i = 0; i < cameras.GetSize(); ++i)
-		{
-			cameras[i].StartGrabbing(c_countOfImagesToGrab, GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
-		}
-
-
-		cerr << endl << "Enter \"t\" to trigger the camera or \"e\" to exit and press enter? (t/e)" << endl << endl;
-
-		char key;
+int main(int argc, char* argv[])
+{
+	// The exit code of the sample application.
+	int exitCode = 0;
 
+	Pylon::PylonAutoInitTerm autoInitTerm;
 
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-sequential") == 0)
+			IsSequentialTrigger = true;
+	}
 
-		do
+	try
+	{
+		// Select the frame source, see include/FrameSourceSelection.h.
+		const EFrameSource frameSource = GetFrameSource(argc, argv);
+		if (frameSource == FrameSource_Emulator)
+		{
+			throw RUNTIME_EXCEPTION("The camera emulator does not provide the USB camera features used by this sample. Use -source synthetic.");
+		}
+		if (frameSource == FrameSource_Synthetic)
 		{
-			if (IsBurstStarted == 0)
+			// The synthetic frame source counterpart of the cameras below.
+			CSyntheticFrameSourceArray cameras(c_maxCamerasToUse, GetSyntheticSettings(argc, argv));
+			_Frame_times.Reset(cameras.GetSize(), c_countOfImagesToGrab);
+			for (size_t i = 0; i < cameras.GetSize(); ++i)
 			{
-				cin.get(key);
+				cameras[i].RegisterImageEventHandler(new CSyntheticSampleImageEventHandler, RegistrationMode_Append, Cleanup_Delete);
+				cameras[i].Open();
+				ConfigureSoftwareTrigger(cameras[i]);
+				cameras[i].Gain.SetValue(0);
+				cameras[i].ExposureTime.SetValue(50000);
+				cout << "Using device " << cameras[i].GetDeviceInfo().GetModelName() << endl;
+				EnableTimestampChunks(cameras[i]);
 			}
-			else key = 't';
+			TriggerFrameSets(cameras);
+		}
+		else
+		{
+			CDeviceInfo info;
+			info.SetDeviceClass(Camera_t::DeviceClass());
+
+			// Get the transport layer factory.
+			CTlFactory& tlFactory = CTlFactory::GetInstance();
 
-			if ((key == 't' || key == 'T'))
+			// Get all attached devices and exit application if no device is found.
+			DeviceInfoList_t devices;
+			if (tlFactory.EnumerateDevices(devices) == 0)
 			{
-				for (size_t i = 0; i < cameras.GetSize(); ++i)
-				{
-					// Execute the software trigger. Wait up to 100 ms for the camera to be ready for trigger.
-					if (cameras[i].WaitForFrameTriggerReady(300, TimeoutHandling_ThrowException))
-					{
-						_PC_frame_start[i] = (double)clock() / CLOCKS_PER_SEC;
-						cameras[i].ExecuteSoftwareTrigger();
-						c_FrameSetTriggered++;
-					}
-				}
-				IsBurstStarted = 1;
+				throw RUNTIME_EXCEPTION("No camera present.");
 			}
+			CameraArray_t cameras(min(devices.size(), c_maxCamerasToUse));
+			_Frame_times.Reset(cameras.GetSize(), c_countOfImagesToGrab);
 
-
-			//else
+			// Create and attach all Pylon Devices.
+			for (size_t i = 0; i < cameras.GetSize(); ++i)
 			{
-				/*for (size_t i = 0; i < cameras.GetSize(); ++i)
-				{
-				//cout << "Trigger run " << endl;
-				_PC_frame_start[i] = (double)clock() / CLOCKS_PER_SEC;
-				cameras[i].ExecuteSoftwareTrigger();
-				c_FrameSetTriggered++;
-				}*/
-			}
+				cameras[i].Attach(tlFactory.CreateDevice(devices[i]));
+
+				cameras[i].RegisterConfiguration(new CSoftwareTriggerConfiguration, RegistrationMode_ReplaceAll, Cleanup_Delete);
+				cameras[i].RegisterConfiguration(new CConfigurationEventPrinter, RegistrationMode_Append, Cleanup_Delete);
 
+				//cameras[i].RegisterImageEventHandler(new CImageEventPrinter, RegistrationMode_Append, Cleanup_Delete);
+				cameras[i].RegisterImageEventHandler(new CSampleImageEventHandler, RegistrationMode_Append, Cleanup_Delete);
 
+				cameras[i].Open();
 
+				//cameras[i].PixelFormat.SetValue(PixelFormat_Mono12);
 
-		} while (((key != 'e') && (key != 'E')) || (c_FrameSetTriggered < c_countOfImagesToGrab));
+				cameras[i].Gain.SetValue(0);
+				cameras[i].ExposureTime.SetValue(50000);
+				// Print the model name of the camera.
+				cout << "Using device " << cameras[i].GetDeviceInfo().GetModelName() << endl;
 
 
+				EnableTimestampChunks(cameras[i]);
+			}
 
+			TriggerFrameSets(cameras);
+		}
 	}
 	catch (GenICam::GenericException &e)
 	{
@@ -229,6 +285,7 @@ int main(int argc, char* argv[])
 	}
 
 	PrintTimeTable();
+	PrintTriggerSkew();
 
 	// Comment the following two lines to disable waiting on exit.
 	cerr << endl << "Press Enter to exit." << endl;
@@ -13,6 +13,7 @@
 // Include files used by samples.
 #include "../include/ConfigurationEventPrinter.h"
 #include "../include/ImageEventPrinter.h"
+#include "../include/FrameSourceSelection.h"
 
 // Namespace for using pylon objects.
 using namespace Pylon;
@@ -20,11 +21,12 @@ using namespace Pylon;
 // Namespace for using cout.
 using namespace std;
 
-//Example of an image event handler.
-class CSampleImageEventHandler : public CImageEventHandler
+//Example of an image event handler. Instantiated for cameras and for the synthetic frame source.
+template <typename ImageEventHandlerT, typename CameraT, typename GrabResultPtrT>
+class CSampleImageEventHandlerT : public ImageEventHandlerT
 {
 public:
-    virtual void OnImageGrabbed( CInstantCamera& camera, const CGrabResultPtr& ptrGrabResult)
+    virtual void OnImageGrabbed( CameraT& camera, const GrabResultPtrT& ptrGrabResult)
     {
 #ifdef PYLON_WIN_BUILD
         // Display the image
@@ -37,60 +39,104 @@ public:
     }
 };
 
+typedef CSampleImageEventHandlerT<CImageEventHandler, CInstantCamera, CGrabResultPtr> CSampleImageEventHandler;
+typedef CSampleImageEventHandlerT<CSyntheticImageEventHandler, CSyntheticFrameSource, CSyntheticGrabResultPtr> CSyntheticSampleImageEventHandler;
+
+// Waits for user input to trigger the camera or exit the program.
+template <typename CameraT>
+void RunTriggerLoop( CameraT& camera)
+{
+    cerr << endl << "Enter \"t\" to trigger the camera or \"e\" to exit and press enter? (t/e)" << endl << endl;
+
+    char key;
+    do
+    {
+        cin.get(key);
+        if ( (key == 't' || key == 'T'))
+        {
+            // Execute the software trigger. Wait up to 100 ms for the camera to be ready for trigger.
+            if ( camera.WaitForFrameTriggerReady( 100, TimeoutHandling_ThrowException))
+            {
+                camera.ExecuteSoftwareTrigger();
+            }
+        }
+    }
+    while ( (key != 'e') && (key != 'E'));
+}
+
 int main(int argc, char* argv[])
 {
     // The exit code of the sample application.
     int exitCode = 0;
 
+    // Select the frame source, see include/FrameSourceSelection.h.
+    // The camera emulator must be enabled before the pylon runtime is initialized.
+    EFrameSource frameSource = FrameSource_Camera;
+    try
+    {
+        frameSource = GetFrameSource( argc, argv);
+    }
+    catch (GenICam::GenericException &e)
+    {
+        cerr << e.GetDescription() << endl;
+        return 1;
+    }
+    if (frameSource == FrameSource_Emulator)
+    {
+        EnableCameraEmulator( 1);
+    }
+
     // Automagically call PylonInitialize and PylonTerminate to ensure the pylon runtime system
     // is initialized during the lifetime of this object.
     Pylon::PylonAutoInitTerm autoInitTerm;
 
     try
     {
-        // Create an instant camera object for the camera device found first.
-        CInstantCamera camera( CTlFactory::GetInstance().CreateFirstDevice());
-
-        // Register the standard configuration event handler for enabling software triggering.
-        // The software trigger configuration handler replaces the default configuration
-        // as all currently registered configuration handlers are removed by setting the registration mode to RegistrationMode_ReplaceAll.
-        camera.RegisterConfiguration( new CSoftwareTriggerConfiguration, RegistrationMode_ReplaceAll, Cleanup_Delete);
+        if (frameSource == FrameSource_Synthetic)
+        {
+            // The synthetic frame source counterpart of the steps below.
+            CSyntheticFrameSource syntheticCamera( GetSyntheticSettings( argc, argv));
+            ConfigureSoftwareTrigger( syntheticCamera);
+            syntheticCamera.RegisterImageEventHandler( new CSyntheticSampleImageEventHandler, RegistrationMode_Append, Cleanup_Delete);
+            syntheticCamera.StartGrabbing( GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+            RunTriggerLoop( syntheticCamera);
+        }
+        else
+        {
+            // Create an instant camera object for the camera device found first.
+            CDeviceInfo info;
+            if (frameSource == FrameSource_Emulator)
+            {
+                info.SetDeviceClass( GetFrameSourceDeviceClass( frameSource, info.GetDeviceClass()));
+            }
+            CInstantCamera camera( CTlFactory::GetInstance().CreateFirstDevice( info));
 
-        // For demonstration purposes only, add a sample configuration event handler to print out information
-        // about camera use.
-        camera.RegisterConfiguration( new CConfigurationEventPrinter, RegistrationMode_Append, Cleanup_Delete);
+            // Register the standard configuration event handler for enabling software triggering.
+            // The software trigger configuration handler replaces the default configuration
+            // as all currently registered configuration handlers are removed by setting the registration mode to RegistrationMode_ReplaceAll.
+            camera.RegisterConfiguration( new CSoftwareTriggerConfiguration, RegistrationMode_ReplaceAll, Cleanup_Delete);
 
-        // The image event printer serves as sample image processing.
-        // When using the grab loop thread provided by the Instant Camera object, an image event handler processing the grab
-        // results must be created and registered.
-        camera.RegisterImageEventHandler( new CImageEventPrinter, RegistrationMode_Append, Cleanup_Delete);
+            // For demonstration purposes only, add a sample configuration event handler to print out information
+            // about camera use.
+            camera.RegisterConfiguration( new CConfigurationEventPrinter, RegistrationMode_Append, Cleanup_Delete);
 
-        // For demonstration purposes only, register another image event handler.
-        camera.RegisterImageEventHandler( new CSampleImageEventHandler, RegistrationMode_Append, Cleanup_Delete);
+            // The image event printer serves as sample image processing.
+            // When using the grab loop thread provided by the Instant Camera object, an image event handler processing the grab
+            // results must be created and registered.
+            camera.RegisterImageEventHandler( new CImageEventPrinter, RegistrationMode_Append, Cleanup_Delete);
 
-        // Start the grabbing using the grab loop thread, by setting the grabLoopType parameter
-        // to GrabLoop_ProvidedByInstantCamera. The grab results are delivered to the image event handlers.
-        // The GrabStrategy_OneByOne default grab strategy is used.
-        camera.StartGrabbing( GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+            // For demonstration purposes only, register another image event handler.
+            camera.RegisterImageEventHandler( new CSampleImageEventHandler, RegistrationMode_Append, Cleanup_Delete);
 
-        cerr << endl << "Enter \"t\" to trigger the camera or \"e\" to exit and press enter? (t/e)" << endl << endl;
+            // Start the grabbing using the grab loop thread, by setting the grabLoopType parameter
+            // to GrabLoop_ProvidedByInstantCamera. The grab results are delivered to the image event handlers.
+            // The GrabStrategy_OneByOne default grab strategy is used.
+            camera.StartGrabbing( GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
 
-        // Wait for user input to trigger the camera or exit the program.
-        // The grabbing is stopped, the device is closed and destroyed automatically when the camera object goes out of scope.
-        char key;
-        do
-        {
-            cin.get(key);
-            if ( (key == 't' || key == 'T'))
-            {
-                // Execute the software trigger. Wait up to 100 ms for the camera to be ready for trigger.
-                if ( camera.WaitForFrameTriggerReady( 100, TimeoutHandling_ThrowException))
-                {
-                    camera.ExecuteSoftwareTrigger();
-                }
-            }
+            // Wait for user input to trigger the camera or exit the program.
+            // The grabbing is stopped, the device is closed and destroyed automatically when the camera object goes out of scope.
+            RunTriggerLoop( camera);
         }
-        while ( (key != 'e') && (key != 'E'));
     }
     catch (GenICam::GenericException &e)
     {
@@ -15,68 +15,508 @@ using namespace std;
 
 // Settings to use  Basler USB cameras.
 #include <pylon/usb/BaslerUsbInstantCamera.h>
+#include <pylon/usb/BaslerUsbInstantCameraArray.h>
 //typedef Pylon::CBaslerUsbInstantCamera Camera_t;
 using namespace Basler_UsbCameraParams;
 
+// Include files used by samples.
+#include "../include/FrameSourceSelection.h"
+#include "../include/FrameStorage.h"
+#include "../include/FrameTiming.h"
+#include "../include/CameraParameterCache.h"
+#include "../include/ConcurrentCapture.h"
+#include "../include/BracketJob.h"
+#include "../include/HdrMerge.h"
+#include "../include/FrameMetadataLog.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 //bool ConfigureCamera()
 
 // Number of images to be grabbed.
 static const uint32_t c_countOfImagesToGrab = 2;
-int CaptureImages(CDeviceInfo CameraID, PixelFormatEnums PixFormat,int Gain, int ShutterMks, int CapturesNmb,char *filename,  int Counter )
-	{
-		char camSerialNumber[100];
-		CBaslerUsbInstantCamera _Camera(CTlFactory::GetInstance().CreateFirstDevice(CameraID));
-		_Camera.Open();
-				
-		sprintf(camSerialNumber,"%s", _Camera.DeviceUserID.GetValue().c_str() );
 
-		if ( GenApi::IsAvailable( _Camera.PixelFormat.GetEntry(PixFormat)))
-			_Camera.PixelFormat.SetValue(PixFormat);
+void ConfigureSoftwareTrigger(CBaslerUsbInstantCamera& camera)
+{
+	CSoftwareTriggerConfiguration().OnOpened(camera);
+}
 
+// Enables the chunks the metadata of bracket frames is taken from.
+void EnableBracketChunks(CBaslerUsbInstantCamera& camera)
+{
+	camera.ChunkModeActive.SetValue(true);
+	camera.ChunkSelector.SetValue(ChunkSelector_Timestamp);
+	camera.ChunkEnable.SetValue(true);
+	camera.ChunkSelector.SetValue(ChunkSelector_ExposureTime);
+	camera.ChunkEnable.SetValue(true);
+	camera.ChunkSelector.SetValue(ChunkSelector_Gain);
+	camera.ChunkEnable.SetValue(true);
+}
+
+void EnableBracketChunks(CSyntheticFrameSource& camera)
+{
+	camera.ChunkModeActive.SetValue(true);
+}
+
+// Sets the exposure of an opened camera or synthetic frame source.
+template <typename CameraT>
+void ConfigureCapture(CameraT& _Camera, int Gain, int ShutterMks)
+	{
 		_Camera.Gain.SetValue(Gain);
 		_Camera.ExposureTime.SetValue(ShutterMks);
 
 		_Camera.MaxNumBuffer = 10;
+	}
+
+// Saves a grabbed frame in the files of the storage mode and appends its record to the metadata log of the camera,
+// <filename>-<serial>.meta as in Grab_StateMachine, see include/FrameMetadataLog.h. The counter is the burst of the record.
+template <typename GrabResultPtrT>
+void StoreFrame(const GrabResultPtrT& ptrGrabResult, char *filename, const char *camSerialNumber, int Counter, int imageCounter, EFrameStorageMode StorageMode, CFrameContainerWriter& container,
+	double ExposureTime, double Gain, CFrameMetadataWriter& metadataLog)
+	{
+		SFrameMetadata metadata;
+		metadata.HostTime = GetFrameMetadataTimeNs();
+		if (IsReadable(ptrGrabResult->ChunkTimestamp))
+			metadata.CameraTime = ptrGrabResult->ChunkTimestamp.GetValue();
+		metadata.FrameCounter = ptrGrabResult->GetBlockID();
+		metadata.ExposureTime = ExposureTime;
+		metadata.Gain = Gain;
+		if (IsReadable(ptrGrabResult->ChunkExposureTime))
+			metadata.ChunkExposureTime = ptrGrabResult->ChunkExposureTime.GetValue();
+		if (IsReadable(ptrGrabResult->ChunkGain))
+			metadata.ChunkGain = ptrGrabResult->ChunkGain.GetValue();
+		metadata.Burst = static_cast<uint32_t>(Counter);
+		metadata.FrameIndex = static_cast<uint32_t>(imageCounter);
+		metadata.CrcStatus = GetFrameCrcStatus(ptrGrabResult);
+		if (!metadataLog.IsOpen())
+		{
+			char metadata_filename[512];
+			sprintf( metadata_filename, "%s-%s.meta", filename, camSerialNumber);
+			metadataLog.Open(metadata_filename, camSerialNumber);
+		}
+		metadataLog.Append(metadata);
+
+		size_t VbufferSize = ptrGrabResult->GetImageSize();
+		void* Vbuffer = ptrGrabResult->GetBuffer();
+		uint32_t Vwidth = ptrGrabResult->GetWidth();
+		uint32_t Vheight = ptrGrabResult->GetHeight();
+
+		if (StorageMode == FrameStorageMode_Container || StorageMode == FrameStorageMode_CompressedContainer)
+		{
+			if (!container.IsOpen())
+			{
+				if (StorageMode == FrameStorageMode_CompressedContainer)
+				{
+					// Compress on all cores so that the encoder keeps up with the camera.
+					SLossless12Settings codecSettings;
+					codecSettings.NumThreads = 0;
+					container.SetEncoding(FrameEncoding_Lossless12, codecSettings);
+				}
+				char container_filename[512];
+				sprintf( container_filename, "%s-%iX%i-%s-%d.frames",filename,Vwidth,Vheight, camSerialNumber, Counter);
+				container.Open(container_filename);
+			}
+			container.Append(ptrGrabResult);
+		}
+
+		if (StorageMode == FrameStorageMode_RawAndPng || StorageMode == FrameStorageMode_Raw)
+		{
+			char raw_filename[512];
+			sprintf( raw_filename, "%s-%iX%i-%s-%d-%d.raw",filename,Vwidth,Vheight, camSerialNumber, Counter, imageCounter);
+			if (!WriteRawFrame(raw_filename, Vbuffer, VbufferSize))
+				printf("Can't open file");
+		}
+
+		if (StorageMode == FrameStorageMode_RawAndPng || StorageMode == FrameStorageMode_Png)
+		{
+			char bmp_filename[512];
+			sprintf( bmp_filename, "%s-%iX%i-%s-%d-%d.png",filename,Vwidth,Vheight, camSerialNumber, Counter, imageCounter);
+
+			SavePngFrame(bmp_filename, Vbuffer, VbufferSize, ptrGrabResult->GetPixelType(), Vwidth, Vheight, ptrGrabResult->GetPaddingX());
+		}
+	}
+
+// Captures and saves the images of an opened camera or synthetic frame source.
+template <typename CameraT>
+int CaptureFromCamera(CameraT& _Camera, int Gain, int ShutterMks, int CapturesNmb, char *filename, int Counter, EFrameStorageMode StorageMode)
+	{
+		char camSerialNumber[100];
+				
+		sprintf(camSerialNumber,"%s", _Camera.DeviceUserID.GetValue().c_str() );
+
+		ConfigureCapture(_Camera, Gain, ShutterMks);
 		_Camera.StartGrabbing(CapturesNmb);
 
-		CGrabResultPtr ptrGrabResult;
+		typename CameraT::GrabResultPtr_t ptrGrabResult;
 		int imageCounter = 0;
+		CFrameContainerWriter container;
+		CFrameMetadataWriter metadataLog;
 
 		while ( _Camera.IsGrabbing())
 		{
 			_Camera.RetrieveResult( 10000, ptrGrabResult, TimeoutHandling_ThrowException);
 			if (ptrGrabResult->GrabSucceeded())
 			{
-				const uint16_t *pImageBuffer = (uint16_t *) ptrGrabResult->GetBuffer();
-				size_t VbufferSize = ptrGrabResult->GetImageSize();
-				void* Vbuffer = ptrGrabResult->GetBuffer();
-				uint32_t Vwidth = ptrGrabResult->GetWidth();
-				uint32_t Vheight = ptrGrabResult->GetHeight();
-				FILE* pFile;
-				char raw_filename[512];
-				sprintf( raw_filename, "%s-%iX%i-%u-%d-%d.raw",filename,Vwidth,Vheight, camSerialNumber, Counter, imageCounter);
-				pFile = fopen(raw_filename,"wb");
-				if (pFile ) fwrite(Vbuffer,1,VbufferSize,pFile); 
-				else printf("Can't open file");
-				fclose(pFile);
+				StoreFrame(ptrGrabResult, filename, camSerialNumber, Counter, imageCounter, StorageMode, container, ShutterMks, Gain, metadataLog);
+
+				imageCounter++;
+			}
+			else cout << "Error: " << ptrGrabResult->GetErrorCode() << " " << ptrGrabResult->GetErrorDescription() << endl;
+		}
+		container.Close();
+		metadataLog.Close();
+		
+		return 0;
+	}
+
+// Host times in seconds of the frames of one camera of a concurrent capture, see include/ConcurrentCapture.h.
+struct SCameraCaptureTiming
+{
+	SCameraCaptureTiming() : StartTime(0.0) {}
 
-				CPylonImage imageToSave;
-				imageToSave.AttachGrabResultBuffer( ptrGrabResult);
+	double StartTime;
+	vector<double> TriggerTimes;
+	vector<double> ArrivalTimes;
+};
 
-				char bmp_filename[512];
-				sprintf( bmp_filename, "%s-%iX%i-%u-%d-%d.png",filename,Vwidth,Vheight, camSerialNumber, Counter, imageCounter);
+// Captures from all cameras at once, each with its own grab and save thread. The cameras are opened.
+template <typename CameraT>
+int CaptureConcurrently(vector<CameraT*>& cameras, int Gain, int ShutterMks, int CapturesNmb, char *filename, int Counter, EFrameStorageMode StorageMode, ECaptureSync Sync)
+	{
+		typedef std::chrono::steady_clock Clock_t;
+		const Clock_t::time_point origin = Clock_t::now();
+		auto getTime = [origin]() { return std::chrono::duration<double>(Clock_t::now() - origin).count(); };
+
+		const size_t cameraCount = cameras.size();
+		const bool isTriggered = Sync == CaptureSync_SoftwareTrigger;
+		// With the software trigger the trigger thread waits at the barrier too.
+		const size_t threadCount = isTriggered ? cameraCount + 1 : cameraCount;
+		CStartBarrier barrier(threadCount);
+		vector<SCameraCaptureTiming> timings(cameraCount);
+		std::unique_ptr<std::atomic<int>[]> storedCounts(new std::atomic<int>[cameraCount]);
+		for (size_t i = 0; i < cameraCount; ++i)
+			storedCounts[i] = 0;
+
+		RunInParallel(threadCount, [&](size_t i)
+		{
+			try
+			{
+				if (i == cameraCount)
+				{
+					// The trigger thread. Every frame is triggered on all cameras as soon as all of them are ready,
+					// leaving a buffer free in each camera for the frame it stores meanwhile.
+					if (!barrier.Wait())
+						return;
+					const unsigned int readyTimeoutMs = 1000 + ShutterMks / 1000;
+					for (int frame = 0; frame < CapturesNmb && !barrier.IsCancelled(); ++frame)
+					{
+						for (size_t c = 0; c < cameraCount; ++c)
+						{
+							while (frame - storedCounts[c] >= cameras[c]->MaxNumBuffer.GetValue() - 1 && !barrier.IsCancelled())
+								std::this_thread::sleep_for(std::chrono::milliseconds(1));
+							cameras[c]->WaitForFrameTriggerReady(readyTimeoutMs, TimeoutHandling_ThrowException);
+						}
+						for (size_t c = 0; c < cameraCount; ++c)
+						{
+							cameras[c]->ExecuteSoftwareTrigger();
+							timings[c].TriggerTimes.push_back(getTime());
+						}
+					}
+					return;
+				}
 
-				imageToSave.Save( ImageFileFormat_Png, bmp_filename);
+				CameraT& _Camera = *cameras[i];
+				char camSerialNumber[100];
+				sprintf(camSerialNumber,"%s", _Camera.DeviceUserID.GetValue().c_str() );
+
+				ConfigureCapture(_Camera, Gain, ShutterMks);
+				if (isTriggered)
+				{
+					ConfigureSoftwareTrigger(_Camera);
+					_Camera.StartGrabbing(CapturesNmb);
+					if (!barrier.Wait())
+						return;
+				}
+				else
+				{
+					if (!barrier.Wait())
+						return;
+					_Camera.StartGrabbing(CapturesNmb);
+				}
+				timings[i].StartTime = getTime();
 
+				typename CameraT::GrabResultPtr_t ptrGrabResult;
+				int imageCounter = 0;
+				CFrameContainerWriter container;
+				CFrameMetadataWriter metadataLog;
 
-				imageCounter++;
+				while ( _Camera.IsGrabbing() && !barrier.IsCancelled())
+				{
+					_Camera.RetrieveResult( 10000, ptrGrabResult, TimeoutHandling_ThrowException);
+					timings[i].ArrivalTimes.push_back(getTime());
+					if (ptrGrabResult->GrabSucceeded())
+					{
+						StoreFrame(ptrGrabResult, filename, camSerialNumber, Counter, imageCounter, StorageMode, container, ShutterMks, Gain, metadataLog);
+
+						imageCounter++;
+					}
+					else cout << "Error: " << ptrGrabResult->GetErrorCode() << " " << ptrGrabResult->GetErrorDescription() << endl;
+					++storedCounts[i];
+				}
+				container.Close();
+				metadataLog.Close();
 			}
-			else cout << "Error: " << ptrGrabResult->GetErrorCode() << " " << ptrGrabResult->GetErrorDescription() << endl;
+			catch (...)
+			{
+				// Releases the other threads, RunInParallel passes the exception on.
+				barrier.Cancel();
+				throw;
+			}
+		});
+
+		printf("%-12s %8s %12s %10s %12s %14s\n", "Camera", "Frames", "Capture ms", "fps", "Jitter ms", "Latency ms");
+		vector<vector<double>> arrivalTimes(cameraCount);
+		vector<vector<double>> triggerTimes(cameraCount);
+		for (size_t i = 0; i < cameraCount; ++i)
+		{
+			const SCameraCaptureTiming& timing = timings[i];
+			const SFrameTiming frameTiming = GetFrameTiming(timing.ArrivalTimes);
+			const double captureMs = timing.ArrivalTimes.empty() ? 0.0 : 1e3 * (timing.ArrivalTimes.back() - timing.StartTime);
+
+			// The time from the trigger to the arrival of the frame, for the software trigger.
+			double latencyMs = 0.0;
+			const size_t triggeredCount = std::min(timing.TriggerTimes.size(), timing.ArrivalTimes.size());
+			for (size_t j = 0; j < triggeredCount; ++j)
+				latencyMs += 1e3 * (timing.ArrivalTimes[j] - timing.TriggerTimes[j]) / triggeredCount;
+
+			printf("%-12s %8u %12.1f %10.2f %12.3f %14.2f\n", cameras[i]->DeviceUserID.GetValue().c_str(), static_cast<unsigned int>(timing.ArrivalTimes.size()),
+				captureMs, frameTiming.FrameRate, 1e3 * frameTiming.IntervalJitter, latencyMs);
+			arrivalTimes[i] = timing.ArrivalTimes;
+			triggerTimes[i] = timing.TriggerTimes;
+		}
+
+		const SCaptureSkew arrivalSkew = GetCaptureSkew(arrivalTimes);
+		printf("Arrival skew over %u frame sets: first %.3f ms, mean %.3f ms, max %.3f ms\n", static_cast<unsigned int>(arrivalSkew.FrameSetCount),
+			1e3 * arrivalSkew.FirstSkew, 1e3 * arrivalSkew.MeanSkew, 1e3 * arrivalSkew.MaxSkew);
+		if (isTriggered)
+		{
+			const SCaptureSkew triggerSkew = GetCaptureSkew(triggerTimes);
+			printf("Trigger skew: mean %.3f ms, max %.3f ms\n", 1e3 * triggerSkew.MeanSkew, 1e3 * triggerSkew.MaxSkew);
+		}
+		printf("Captured from %u cameras in %.1f ms\n", static_cast<unsigned int>(cameraCount), 1e3 * getTime());
+
+		return 0;
+	}
+
+// Grabs the steps of a bracket job back to back. The parameters of each step are written while the last frame of
+// the previous step is read out, see include/BracketJob.h. The frames are saved like single captures, and a
+// metadata file lists the step, the requested exposure and gain and the chunk values of every frame.
+// With MergeHdr the frames are kept and merged into one linear float image, see include/HdrMerge.h.
+template <typename CameraT>
+int CaptureBracketFromCamera(CameraT& _Camera, const vector<SBracketStep>& Steps, char *filename, int Counter, EFrameStorageMode StorageMode, bool MergeHdr)
+	{
+		char camSerialNumber[100];
+		sprintf(camSerialNumber,"%s", _Camera.DeviceUserID.GetValue().c_str() );
+
+		_Camera.MaxNumBuffer = 10;
+		ConfigureSoftwareTrigger(_Camera);
+		EnableBracketChunks(_Camera);
+
+		char metadata_filename[512];
+		sprintf( metadata_filename, "%s-%s-%d-bracket.csv", filename, camSerialNumber, Counter);
+		FILE* pMetadata = fopen(metadata_filename, "w");
+		if (pMetadata == NULL)
+			throw RUNTIME_EXCEPTION( "Could not create the bracket metadata file %s.", metadata_filename);
+		fprintf(pMetadata, "frame,step,exposure_us,gain_db,chunk_exposure_us,chunk_gain_db,timestamp_ns\n");
+
+		const size_t frameCount = GetBracketFrameCount(Steps);
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		_Camera.StartGrabbing(frameCount);
+
+		// Frames retrieved and released, the trigger thread keeps a buffer free for every triggered frame.
+		std::mutex lock;
+		std::condition_variable released;
+		size_t releasedCount = 0;
+		bool isStopped = false;
+		vector< vector<uint8_t> > hdrBuffers;
+		vector<SHdrFrame> hdrFrames;
+
+		RunInParallel(2, [&](size_t thread)
+		{
+			if (thread == 0)
+			{
+				TriggerBracket(_Camera, Steps, true, [&](size_t count)
+				{
+					std::unique_lock<std::mutex> waitLock(lock);
+					released.wait(waitLock, [&]() { return releasedCount >= count || isStopped; });
+					if (isStopped)
+						throw RUNTIME_EXCEPTION( "The bracket was stopped.");
+				});
+				return;
+			}
+
+			try
+			{
+				typename CameraT::GrabResultPtr_t ptrGrabResult;
+				CFrameContainerWriter container;
+				CFrameMetadataWriter metadataLog;
+				size_t step = 0;
+				size_t stepEnd = Steps[0].FrameCount;
+				for (int imageCounter = 0; _Camera.IsGrabbing(); ++imageCounter)
+				{
+					_Camera.RetrieveResult( 10000, ptrGrabResult, TimeoutHandling_ThrowException);
+					// The frames arrive in the order of the steps.
+					while (static_cast<size_t>(imageCounter) >= stepEnd && step + 1 < Steps.size())
+						stepEnd += Steps[++step].FrameCount;
+
+					if (ptrGrabResult->GrabSucceeded())
+					{
+						StoreFrame(ptrGrabResult, filename, camSerialNumber, Counter, imageCounter, StorageMode, container, Steps[step].ExposureTime, Steps[step].Gain, metadataLog);
+
+						fprintf(pMetadata, "%d,%u,%.1f,%.2f,%.1f,%.2f,%lld\n", imageCounter, static_cast<unsigned int>(step), Steps[step].ExposureTime, Steps[step].Gain,
+							IsReadable(ptrGrabResult->ChunkExposureTime) ? ptrGrabResult->ChunkExposureTime.GetValue() : -1.0,
+							IsReadable(ptrGrabResult->ChunkGain) ? ptrGrabResult->ChunkGain.GetValue() : -1.0,
+							IsReadable(ptrGrabResult->ChunkTimestamp) ? static_cast<long long>(ptrGrabResult->ChunkTimestamp.GetValue()) : -1LL);
+
+						if (MergeHdr && CHdrMerger::IsSupported(ptrGrabResult->GetPixelType()))
+						{
+							const uint8_t* pBuffer = static_cast<const uint8_t*>(ptrGrabResult->GetBuffer());
+							hdrBuffers.push_back(vector<uint8_t>(pBuffer, pBuffer + ptrGrabResult->GetImageSize()));
+							SHdrFrame frame;
+							frame.PixelType = ptrGrabResult->GetPixelType();
+							frame.Width = ptrGrabResult->GetWidth();
+							frame.Height = ptrGrabResult->GetHeight();
+							frame.PaddingX = ptrGrabResult->GetPaddingX();
+							frame.ExposureTime = IsReadable(ptrGrabResult->ChunkExposureTime) ? ptrGrabResult->ChunkExposureTime.GetValue() : Steps[step].ExposureTime;
+							frame.Gain = IsReadable(ptrGrabResult->ChunkGain) ? ptrGrabResult->ChunkGain.GetValue() : Steps[step].Gain;
+							hdrFrames.push_back(frame);
+						}
+					}
+					else cout << "Error: " << ptrGrabResult->GetErrorCode() << " " << ptrGrabResult->GetErrorDescription() << endl;
+
+					ptrGrabResult.Release();
+					{
+						std::lock_guard<std::mutex> releaseLock(lock);
+						++releasedCount;
+					}
+					released.notify_all();
+				}
+				container.Close();
+				metadataLog.Close();
+			}
+			catch (...)
+			{
+				{
+					std::lock_guard<std::mutex> releaseLock(lock);
+					isStopped = true;
+				}
+				released.notify_all();
+				throw;
+			}
+		});
+		fclose(pMetadata);
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("Bracket of %u steps, %u frames in %.1f ms, %.2f fps. Metadata in %s\n", static_cast<unsigned int>(Steps.size()), static_cast<unsigned int>(frameCount),
+			1e3 * seconds, frameCount / seconds, metadata_filename);
+
+		if (MergeHdr)
+		{
+			if (hdrFrames.empty())
+			{
+				printf("No frames with 16 bits per pixel to merge, HDR skipped.\n");
+				return 0;
+			}
+			for (size_t i = 0; i < hdrFrames.size(); ++i)
+				hdrFrames[i].pBuffer = &hdrBuffers[i][0];
+
+			const std::chrono::steady_clock::time_point mergeStart = std::chrono::steady_clock::now();
+			CHdrMerger merger;
+			merger.Merge(hdrFrames);
+			const double mergeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - mergeStart).count();
+
+			char hdr_filename[512];
+			sprintf( hdr_filename, "%s-%iX%i-%s-%d-hdr-float.raw", filename, merger.GetWidth(), merger.GetHeight(), camSerialNumber, Counter);
+			FILE* pHdr = fopen(hdr_filename, "wb");
+			if (pHdr == NULL)
+				throw RUNTIME_EXCEPTION( "Could not create the HDR file %s.", hdr_filename);
+			const size_t pixelCount = static_cast<size_t>(merger.GetWidth()) * merger.GetHeight();
+			const bool isWritten = fwrite(merger.GetRadiance(), sizeof(float), pixelCount, pHdr) == pixelCount;
+			fclose(pHdr);
+			if (!isWritten)
+				throw RUNTIME_EXCEPTION( "Could not write the HDR file %s.", hdr_filename);
+			printf("HDR merge of %u frames in %.1f ms, values up to %.0f in %s\n", static_cast<unsigned int>(hdrFrames.size()), 1e3 * mergeSeconds,
+				merger.GetMaxRadiance(), hdr_filename);
 		}
-		
 		return 0;
 	}
 
+int CaptureImages(CDeviceInfo CameraID, PixelFormatEnums PixFormat,int Gain, int ShutterMks, int CapturesNmb,char *filename,  int Counter, EFrameStorageMode StorageMode, const vector<SBracketStep>& Steps, bool MergeHdr )
+	{
+		CBaslerUsbInstantCamera _Camera(CTlFactory::GetInstance().CreateFirstDevice(CameraID));
+		_Camera.Open();
+
+		if ( GenApi::IsAvailable( _Camera.PixelFormat.GetEntry(PixFormat)))
+			_Camera.PixelFormat.SetValue(PixFormat);
+
+		if (!Steps.empty())
+			return CaptureBracketFromCamera(_Camera, Steps, filename, Counter, StorageMode, MergeHdr);
+		return CaptureFromCamera(_Camera, Gain, ShutterMks, CapturesNmb, filename, Counter, StorageMode);
+	}
+
+// Captures from all given cameras concurrently. The cameras are opened in parallel as well.
+int CaptureConcurrentImages(const DeviceInfoList_t& CameraIDs, PixelFormatEnums PixFormat, int Gain, int ShutterMks, int CapturesNmb, char *filename, int Counter, EFrameStorageMode StorageMode, ECaptureSync Sync)
+	{
+		CBaslerUsbInstantCameraArray cameras(CameraIDs.size());
+		vector<CBaslerUsbInstantCamera*> pCameras;
+		for (size_t i = 0; i < CameraIDs.size(); ++i)
+		{
+			cameras[i].Attach(CTlFactory::GetInstance().CreateDevice(CameraIDs[i]));
+			pCameras.push_back(&cameras[i]);
+		}
+
+		RunInParallel(pCameras.size(), [&pCameras, PixFormat](size_t i)
+		{
+			pCameras[i]->Open();
+			if ( GenApi::IsAvailable( pCameras[i]->PixelFormat.GetEntry(PixFormat)))
+				pCameras[i]->PixelFormat.SetValue(PixFormat);
+		});
+
+		return CaptureConcurrently(pCameras, Gain, ShutterMks, CapturesNmb, filename, Counter, StorageMode, Sync);
+	}
+
+// Captures from a synthetic frame source standing in for the requested camera type.
+int CaptureSyntheticImages(SSyntheticFrameSourceSettings Settings, PixelFormatEnums PixFormat, int Gain, int ShutterMks, int CapturesNmb, char *filename, int Counter, EFrameStorageMode StorageMode, const vector<SBracketStep>& Steps, bool MergeHdr)
+	{
+		Settings.PixelType = SyntheticPixelType(PixFormat);
+		CSyntheticFrameSource _Camera(Settings);
+		_Camera.Open();
+
+		if (!Steps.empty())
+			return CaptureBracketFromCamera(_Camera, Steps, filename, Counter, StorageMode, MergeHdr);
+		return CaptureFromCamera(_Camera, Gain, ShutterMks, CapturesNmb, filename, Counter, StorageMode);
+	}
+
+// Captures concurrently from synthetic frame sources standing in for CameraCount cameras.
+int CaptureConcurrentSyntheticImages(SSyntheticFrameSourceSettings Settings, size_t CameraCount, PixelFormatEnums PixFormat, int Gain, int ShutterMks, int CapturesNmb, char *filename, int Counter, EFrameStorageMode StorageMode, ECaptureSync Sync)
+	{
+		Settings.PixelType = SyntheticPixelType(PixFormat);
+		CSyntheticFrameSourceArray cameras(CameraCount, Settings);
+		vector<CSyntheticFrameSource*> pCameras;
+		for (size_t i = 0; i < CameraCount; ++i)
+		{
+			cameras[i].Open();
+			pCameras.push_back(&cameras[i]);
+		}
+
+		return CaptureConcurrently(pCameras, Gain, ShutterMks, CapturesNmb, filename, Counter, StorageMode, Sync);
+	}
+
 
 int main(int argc, char* argv[])
 {
@@ -100,6 +540,10 @@ int main(int argc, char* argv[])
 	char camType[100];
 	char camSerialNumber[100];
 	int _counter = 0;
+	EFrameStorageMode _storageMode = FrameStorageMode_RawAndPng;
+	ECaptureSync _captureSync = CaptureSync_Sequential;
+	vector<SBracketStep> _bracketSteps;
+	bool _mergeHdr = false;
 
 	std::string iT("-t");
 	std::string iG("-g");
@@ -110,7 +554,7 @@ int main(int argc, char* argv[])
 
 	if (argc < 5) 
 	{ // Check the value of argc. If not enough parameters have been passed, inform user and exit.
-        std::cout << "Usage is -t <shutter_time_mks> -g <gain_db> -n <num_to_capture> -f <filename> -c <counter_number> -b <color/bw>\n"; // Inform the user of how to use the program
+        std::cout << "Usage is -t <shutter_time_mks> -g <gain_db> -n <num_to_capture> -f <filename> -c <counter_number> -b <color/bw> [-source camera/synthetic] [-storage raw+png/raw/png/container/compressed] [-concurrent sequential/barrier/trigger] [-cameras <n> with -source synthetic] [-job <bracket_file> | -bracket-t <exposures_mks> -bracket-g <gains_db>] [-hdr]\n"; // Inform the user of how to use the program
         std::cin.get();
         exit(0);
     }
@@ -178,6 +622,54 @@ int main(int argc, char* argv[])
 
     try
     {
+		if (GetCommandLineOption(argc, argv, "-storage") != NULL)
+			_storageMode = GetFrameStorageMode(GetCommandLineOption(argc, argv, "-storage"));
+		if (GetCommandLineOption(argc, argv, "-concurrent") != NULL)
+			_captureSync = GetCaptureSync(GetCommandLineOption(argc, argv, "-concurrent"));
+
+		// Exposure and gain bracketing with -n frames per step, see include/BracketJob.h.
+		const size_t _framesPerStep = static_cast<size_t>(std::max(1, _capture_nmb));
+		if (GetCommandLineOption(argc, argv, "-job") != NULL)
+			_bracketSteps = ReadBracketJob(GetCommandLineOption(argc, argv, "-job"), _framesPerStep);
+		else if (GetCommandLineOption(argc, argv, "-bracket-t") != NULL || GetCommandLineOption(argc, argv, "-bracket-g") != NULL)
+		{
+			const char* exposures = GetCommandLineOption(argc, argv, "-bracket-t");
+			const char* gains = GetCommandLineOption(argc, argv, "-bracket-g");
+			_bracketSteps = GetBracketSteps(exposures != NULL ? ParseBracketValues(exposures) : vector<double>(1, _shutter),
+				gains != NULL ? ParseBracketValues(gains) : vector<double>(1, _gain), _framesPerStep);
+		}
+		if (!_bracketSteps.empty() && _captureSync != CaptureSync_Sequential)
+			throw RUNTIME_EXCEPTION( "Bracketing captures from one camera after the other. Omit -concurrent.");
+		// Merges the frames of the bracket into one HDR image.
+		for (int i = 1; i < argc; ++i)
+			if (strcmp(argv[i], "-hdr") == 0)
+				_mergeHdr = true;
+		if (_mergeHdr && _bracketSteps.empty())
+			throw RUNTIME_EXCEPTION( "-hdr merges the frames of a bracket. Use it with -job or -bracket-t.");
+
+		// Capture from a synthetic frame source instead of a camera, see include/FrameSourceSelection.h.
+		if (GetFrameSource(argc, argv) == FrameSource_Synthetic)
+		{
+			if (_captureSync != CaptureSync_Sequential)
+			{
+				const char* cameraCount = GetCommandLineOption(argc, argv, "-cameras");
+				const size_t _cameraCount = cameraCount != NULL ? std::max(1, atoi(cameraCount)) : 2;
+				if (_CameraColorTypeRequested == CameraColorType_Color)
+					CaptureConcurrentSyntheticImages(GetSyntheticSettings(argc, argv), _cameraCount, PixelFormat_BayerGB12, _gain, _shutter, _capture_nmb, filename, _counter, _storageMode, _captureSync);
+				else if (_CameraColorTypeRequested == CameraColorType_BW)
+					CaptureConcurrentSyntheticImages(GetSyntheticSettings(argc, argv), _cameraCount, PixelFormat_Mono12, _gain, _shutter, _capture_nmb, filename, _counter, _storageMode, _captureSync);
+			}
+			else if (_CameraColorTypeRequested == CameraColorType_Color)
+				CaptureSyntheticImages(GetSyntheticSettings(argc, argv), PixelFormat_BayerGB12, _gain, _shutter, _capture_nmb, filename, _counter, _storageMode, _bracketSteps, _mergeHdr);
+			else if (_CameraColorTypeRequested == CameraColorType_BW)
+				CaptureSyntheticImages(GetSyntheticSettings(argc, argv), PixelFormat_Mono12, _gain, _shutter, _capture_nmb, filename, _counter, _storageMode, _bracketSteps, _mergeHdr);
+			return exitCode;
+		}
+		else if (GetFrameSource(argc, argv) == FrameSource_Emulator)
+		{
+			throw RUNTIME_EXCEPTION( "The camera emulator does not provide the USB camera features used by this sample. Use -source synthetic.");
+		}
+
 		int c_maxCamerasToUse = 5;
 
 		CTlFactory& tlFactory = CTlFactory::GetInstance();
@@ -186,6 +678,8 @@ int main(int argc, char* argv[])
         if ( tlFactory.EnumerateDevices(devices) == 0 ) throw RUNTIME_EXCEPTION( "No camera present.");
      
 		CBaslerUsbInstantCamera  *_pCamera = NULL;
+		// The cameras captured from concurrently, all of the requested color type.
+		DeviceInfoList_t _selectedDevices;
 		
 		for (DeviceInfoList::iterator it = devices.begin(); it != devices.end();  ++it)
         {
@@ -205,7 +699,10 @@ int main(int argc, char* argv[])
 			{
 				if(_CameraColorTypeRequested == CameraColorType_Color)//configure camera color
 				{
-					 CaptureImages(di,PixelFormat_BayerGB12,_gain,_shutter,_capture_nmb,filename,_counter);
+					if (_captureSync == CaptureSync_Sequential)
+						CaptureImages(di,PixelFormat_BayerGB12,_gain,_shutter,_capture_nmb,filename,_counter,_storageMode,_bracketSteps,_mergeHdr);
+					else
+						_selectedDevices.push_back(di);
 				}
 				else if(_CameraColorTypeRequested ==CameraColorType_BW)
 				{
@@ -220,7 +717,10 @@ int main(int argc, char* argv[])
 			{
 				if(_CameraColorTypeRequested == CameraColorType_BW)
 				{
-					 CaptureImages(di,PixelFormat_Mono12,_gain,_shutter,_capture_nmb,filename,_counter);
+					if (_captureSync == CaptureSync_Sequential)
+						CaptureImages(di,PixelFormat_Mono12,_gain,_shutter,_capture_nmb,filename,_counter,_storageMode,_bracketSteps,_mergeHdr);
+					else
+						_selectedDevices.push_back(di);
 					//configure camera BW
 					/*_pCamera = new CBaslerUsbInstantCamera( CTlFactory::GetInstance().CreateFirstDevice(di));
 					_pCamera->Open();
@@ -245,6 +745,12 @@ int main(int argc, char* argv[])
 
         }
 
+		if (!_selectedDevices.empty())
+		{
+			const PixelFormatEnums _pixelFormat = _CameraColorTypeRequested == CameraColorType_Color ? PixelFormat_BayerGB12 : PixelFormat_Mono12;
+			CaptureConcurrentImages(_selectedDevices, _pixelFormat, _gain, _shutter, _capture_nmb, filename, _counter, _storageMode, _captureSync);
+		}
+
         
     }
     catch (GenICam::GenericException &e)
@@ -0,0 +1,113 @@
+// Contains the switch between free-running and triggered acquisition without restarting the grab.
+/*
+   Stopping the grab, changing the trigger configuration and starting the grab again costs a camera
+   hundreds of milliseconds: the acquisition is stopped, the stream buffers are deregistered and
+   registered again and the acquisition restarts. CAcquisitionModeSwitch keeps the cameras grabbing with
+   buffers for both modes and only writes TriggerMode, one write per camera, on all cameras in parallel
+   through their parameter caches. Loading a user set is not possible while grabbing and the sequencer
+   does not switch the trigger mode, so toggling TriggerMode is the only way that keeps the stream.
+
+   Frames exposed before the switch to triggered acquisition still arrive afterwards. Right after the
+   switch the camera clock is latched with TimestampLatch, and IsTriggeredFrame() rejects frames with an
+   earlier Timestamp chunk. The cameras must deliver the Timestamp chunk and be configured for software
+   triggering, e.g. with CSoftwareTriggerConfiguration, before they start grabbing. The switch writes
+   TriggerMode of the selected trigger, FrameStart or FrameBurstStart with the other one switched off.
+*/
+
+#ifndef INCLUDED_ACQUISITIONMODESWITCH_H_8820461
+#define INCLUDED_ACQUISITIONMODESWITCH_H_8820461
+
+#include <pylon/PylonIncludes.h>
+#include <pylon/usb/BaslerUsbInstantCamera.h>
+#include "CameraParameterCache.h"
+
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace Pylon
+{
+    template <typename CameraArrayT>
+    class CAcquisitionModeSwitch
+    {
+    public:
+        // The cameras are not accessed here, they may still be unconfigured.
+        CAcquisitionModeSwitch( CameraArrayT& cameras, std::vector<CCameraParameterCache*>& caches)
+            : m_cameras( cameras)
+            , m_caches( caches)
+            , m_fences( caches.size(), std::numeric_limits<int64_t>::max())
+            , m_isTriggered( false)
+            , m_lastSwitchSeconds( 0.0)
+        {
+        }
+
+        // Switches all cameras to triggered acquisition while they keep grabbing.
+        void SwitchToTriggered()
+        {
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            std::vector<int64_t> fences( m_fences.size());
+            RunInParallel( m_caches.size(), [this, &fences]( size_t i)
+            {
+                m_caches[i]->Write( "TriggerMode", m_cameras[i].TriggerMode, Basler_UsbCameraParams::TriggerMode_On);
+                m_cameras[i].TimestampLatch.Execute();
+                fences[i] = m_cameras[i].TimestampLatchValue.GetValue();
+            });
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                m_fences = fences;
+                m_isTriggered = true;
+            }
+            m_lastSwitchSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+        }
+
+        // Switches all cameras to free-running acquisition while they keep grabbing.
+        void SwitchToFreeRun()
+        {
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                m_fences.assign( m_fences.size(), std::numeric_limits<int64_t>::max());
+                m_isTriggered = false;
+            }
+            RunInParallel( m_caches.size(), [this]( size_t i)
+            {
+                m_caches[i]->Write( "TriggerMode", m_cameras[i].TriggerMode, Basler_UsbCameraParams::TriggerMode_Off);
+            });
+            m_lastSwitchSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+        }
+
+        bool IsTriggered() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_isTriggered;
+        }
+
+        // Returns true if a frame of the camera with the given Timestamp chunk was exposed after the switch
+        // to triggered acquisition. May be called from the grab loop threads.
+        bool IsTriggeredFrame( size_t camera, int64_t timeStamp) const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_isTriggered && timeStamp >= m_fences[camera];
+        }
+
+        // Duration of the last switch in seconds.
+        double GetLastSwitchSeconds() const
+        {
+            return m_lastSwitchSeconds;
+        }
+
+    private:
+        CAcquisitionModeSwitch( const CAcquisitionModeSwitch&);
+        CAcquisitionModeSwitch& operator=( const CAcquisitionModeSwitch&);
+
+        CameraArrayT& m_cameras;
+        std::vector<CCameraParameterCache*>& m_caches;
+        mutable std::mutex m_lock;
+        std::vector<int64_t> m_fences;      // Camera time of the switch to triggered acquisition.
+        bool m_isTriggered;
+        double m_lastSwitchSeconds;
+    };
+}
+
+#endif /* INCLUDED_ACQUISITIONMODESWITCH_H_8820461 */
@@ -0,0 +1,252 @@
+// Contains a software auto exposure and gain controller.
+/*
+   CAutoExposureController adjusts exposure time and gain so that the mean brightness of the frames
+   reaches a target, measured with the histogram statistics of FrameStatistics.h. The error is computed
+   in stops (powers of two of the exposure), a configurable fraction of it is corrected per update. The
+   highlight constraint limits the correction so that no more than HighlightFraction of the pixels end up
+   above HighlightLevel, which also pulls the exposure down quickly when the frame is clipped.
+
+   A change of exposure or gain only shows in frames exposed after the change reached the camera. The
+   frames already exposed or in the buffers still have the old settings, so after each change the
+   controller ignores FramesInFlight frames of every camera. Without this the loop would correct the
+   same error several times and oscillate.
+
+   Several cameras can share one controller, e.g. a BW and a color camera whose exposures differ by a
+   fixed factor. Each camera has its own target brightness. The controller waits for a frame of every
+   camera and applies the smallest correction, so that no camera is pushed into clipping.
+   The exposure is raised first and the gain only when the exposure reached its maximum, and the gain is
+   lowered first, which keeps the noise low.
+*/
+
+#ifndef INCLUDED_AUTOEXPOSURECONTROLLER_H_2607794
+#define INCLUDED_AUTOEXPOSURECONTROLLER_H_2607794
+
+#include "FrameStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace Pylon
+{
+    // Gain in dB that doubles the signal.
+    static const double c_decibelsPerStop = 6.0205999132796239;
+
+    struct SAutoExposureSettings
+    {
+        SAutoExposureSettings()
+            : TargetBrightness( 0.35)
+            , HighlightLevel( 0.95)
+            , HighlightFraction( 0.01)
+            , Speed( 0.6)
+            , MaxStepStops( 2.0)
+            , ToleranceStops( 0.1)
+            , FramesInFlight( 2)
+            , MinExposure( 20.0)
+            , MaxExposure( 200000.0)
+            , MinGain( 0.0)
+            , MaxGain( 23.79)
+        {
+        }
+
+        double TargetBrightness;    // Target mean as fraction of the largest pixel value.
+        double HighlightLevel;      // Fraction of the largest pixel value regarded as highlight.
+        double HighlightFraction;   // Fraction of the pixels allowed above HighlightLevel.
+        double Speed;               // Fraction of the error corrected per update, 1 corrects it at once.
+        double MaxStepStops;        // Largest change per update.
+        double ToleranceStops;      // Errors below this are not corrected.
+        uint32_t FramesInFlight;    // Frames arriving with the old settings after a change.
+        double MinExposure;         // Exposure time limits in us.
+        double MaxExposure;
+        double MinGain;             // Gain limits in dB.
+        double MaxGain;
+    };
+
+    // Returns the correction in stops that brings the frame to the target brightness without clipping more
+    // than the allowed fraction of highlights. Positive values brighten. Requires the histogram.
+    inline double GetExposureErrorStops( const SFrameStatistics& statistics, double targetBrightness, const SAutoExposureSettings& settings)
+    {
+        if (statistics.PixelCount == 0 || statistics.Histogram.empty())
+        {
+            return 0.0;
+        }
+
+        // Darkest value of the brightest HighlightFraction of the pixels.
+        const uint64_t highlightCount = static_cast<uint64_t>(settings.HighlightFraction * statistics.PixelCount);
+        uint64_t count = 0;
+        uint32_t highlight = statistics.MaxValue;
+        while (highlight > 0 && count + statistics.Histogram[highlight] <= highlightCount)
+        {
+            count += statistics.Histogram[highlight];
+            --highlight;
+        }
+
+        // A black frame has no information about the scene, it is brightened by the largest step.
+        const double mean = statistics.GetMean();
+        if (mean <= 0.0)
+        {
+            return settings.MaxStepStops;
+        }
+        double errorStops = std::log( targetBrightness * statistics.MaxValue / mean) / std::log( 2.0);
+        if (highlight == statistics.MaxValue)
+        {
+            // The highlights are clipped, their level is unknown. The correction grows with the excess of clipped pixels.
+            const double clippedRatio = statistics.Histogram[statistics.MaxValue] / std::max( 1.0, settings.HighlightFraction * statistics.PixelCount);
+            errorStops = std::min( errorStops, std::log( settings.HighlightLevel / std::max( 1.0, clippedRatio)) / std::log( 2.0));
+        }
+        else if (highlight > 0)
+        {
+            errorStops = std::min( errorStops, std::log( settings.HighlightLevel * statistics.MaxValue / highlight) / std::log( 2.0));
+        }
+        return errorStops;
+    }
+
+    class CAutoExposureController
+    {
+    public:
+        CAutoExposureController( const SAutoExposureSettings& settings, size_t cameraCount, double exposure, double gain)
+            : m_settings( settings)
+            , m_cameras( cameraCount)
+            , m_exposure( exposure)
+            , m_gain( gain)
+            , m_changeCount( 0)
+        {
+            for (size_t i = 0; i < m_cameras.size(); ++i)
+            {
+                m_cameras[i].TargetBrightness = settings.TargetBrightness;
+            }
+        }
+
+        const SAutoExposureSettings& GetSettings() const
+        {
+            return m_settings;
+        }
+
+        void SetTargetBrightness( size_t camera, double targetBrightness)
+        {
+            m_cameras[camera].TargetBrightness = targetBrightness;
+        }
+
+        double GetTargetBrightness( size_t camera) const
+        {
+            return m_cameras[camera].TargetBrightness;
+        }
+
+        // Takes over exposure and gain set from outside, e.g. by a key press. The frames in flight are skipped as after an own change.
+        void SetExposureAndGain( double exposure, double gain)
+        {
+            m_exposure = exposure;
+            m_gain = gain;
+            RestartMeasurement();
+        }
+
+        // Call for every frame of a camera. Returns true if exposure or gain changed and have to be written to the cameras.
+        bool Update( size_t camera, const SFrameStatistics& statistics)
+        {
+            SCameraState& state = m_cameras[camera];
+            if (state.FramesSinceChange++ < m_settings.FramesInFlight)
+            {
+                return false;
+            }
+            state.ErrorStops = GetExposureErrorStops( statistics, state.TargetBrightness, m_settings);
+            state.HasError = true;
+
+            double errorStops = 0.0;
+            for (size_t i = 0; i < m_cameras.size(); ++i)
+            {
+                if (!m_cameras[i].HasError)
+                {
+                    return false;
+                }
+                errorStops = i == 0 ? m_cameras[i].ErrorStops : std::min( errorStops, m_cameras[i].ErrorStops);
+            }
+            for (size_t i = 0; i < m_cameras.size(); ++i)
+            {
+                m_cameras[i].HasError = false;
+            }
+
+            if (std::fabs( errorStops) < m_settings.ToleranceStops)
+            {
+                return false;
+            }
+            const double stepStops = std::max( -m_settings.MaxStepStops, std::min( m_settings.MaxStepStops, errorStops * m_settings.Speed));
+            if (!ApplyStep( stepStops))
+            {
+                return false;
+            }
+            RestartMeasurement();
+            ++m_changeCount;
+            return true;
+        }
+
+        double GetExposure() const
+        {
+            return m_exposure;
+        }
+
+        double GetGain() const
+        {
+            return m_gain;
+        }
+
+        // Number of changes made by the controller.
+        uint64_t GetChangeCount() const
+        {
+            return m_changeCount;
+        }
+
+    private:
+        struct SCameraState
+        {
+            SCameraState()
+                : TargetBrightness( 0.0)
+                , FramesSinceChange( 0)
+                , HasError( false)
+                , ErrorStops( 0.0)
+            {
+            }
+
+            double TargetBrightness;
+            uint32_t FramesSinceChange;
+            bool HasError;
+            double ErrorStops;
+        };
+
+        void RestartMeasurement()
+        {
+            for (size_t i = 0; i < m_cameras.size(); ++i)
+            {
+                m_cameras[i].FramesSinceChange = 0;
+                m_cameras[i].HasError = false;
+            }
+        }
+
+        // Distributes the new total exposure to exposure time and gain. Returns false if the limits leave nothing to change.
+        bool ApplyStep( double stepStops)
+        {
+            const double logExposure = std::log( m_exposure) / std::log( 2.0);
+            const double totalStops = logExposure + m_gain / c_decibelsPerStop + stepStops;
+            const double minStops = std::log( m_settings.MinExposure) / std::log( 2.0);
+            const double maxStops = std::log( m_settings.MaxExposure) / std::log( 2.0);
+
+            const double exposureStops = std::max( minStops, std::min( maxStops, totalStops - m_settings.MinGain / c_decibelsPerStop));
+            const double gain = std::max( m_settings.MinGain, std::min( m_settings.MaxGain, (totalStops - exposureStops) * c_decibelsPerStop));
+            const double exposure = std::pow( 2.0, exposureStops);
+            if (std::fabs( exposure - m_exposure) < 1e-6 * m_exposure && std::fabs( gain - m_gain) < 1e-6)
+            {
+                return false;
+            }
+            m_exposure = exposure;
+            m_gain = gain;
+            return true;
+        }
+
+        SAutoExposureSettings m_settings;
+        std::vector<SCameraState> m_cameras;
+        double m_exposure;
+        double m_gain;
+        uint64_t m_changeCount;
+    };
+}
+
+#endif /* INCLUDED_AUTOEXPOSURECONTROLLER_H_2607794 */
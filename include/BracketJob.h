@@ -0,0 +1,206 @@
+// Contains exposure and gain bracketing: the steps of a bracket job and their triggering.
+/*
+   A bracket job is a list of steps, each an exposure time in us, a gain in dB and a number of frames.
+   The steps are read from a job file with one step per line
+       <exposure_us> <gain_db> [<frames>]
+   where empty lines and lines starting with # are skipped, or built from lists of exposure times and
+   gains, all combinations with the exposure time changing fastest. A list is either comma separated,
+       1000,2000,5000
+   or a range <first>:<last>:<step>, where a step starting with x is a factor:
+       1000:16000:x2       1000, 2000, 4000, 8000, 16000
+
+   TriggerBracket() grabs the steps with software triggers from a camera that grabs and is configured for
+   software triggering. The parameters of a step are staged: they are written as soon as the camera accepts
+   the next trigger, which on a camera with overlapping exposure is when the last frame of the previous step
+   is read out. A frame is exposed with the parameters written before its trigger, so the bracket runs at
+   the rate of the sensor unless a write takes longer than the readout. Without staging the parameters are
+   written after the last frame of the previous step arrived, like separate captures per step.
+*/
+
+#ifndef INCLUDED_BRACKETJOB_H_2961584
+#define INCLUDED_BRACKETJOB_H_2961584
+
+#include <pylon/PylonIncludes.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Pylon
+{
+    struct SBracketStep
+    {
+        SBracketStep()
+            : ExposureTime( 0.0)
+            , Gain( 0.0)
+            , FrameCount( 1)
+        {
+        }
+
+        double ExposureTime;        // us
+        double Gain;                // dB
+        size_t FrameCount;
+    };
+
+    // The most values a list or a range may have.
+    static const size_t c_maxBracketValues = 1000;
+
+    // Parses a comma separated list or a range of values, see above.
+    inline std::vector<double> ParseBracketValues( const char* text)
+    {
+        std::vector<double> values;
+        double first = 0.0;
+        double last = 0.0;
+        char step[32] = { 0 };
+        if (sscanf( text, "%lf:%lf:%31s", &first, &last, step) == 3)
+        {
+            const bool isFactor = step[0] == 'x';
+            const double increment = atof( isFactor ? step + 1 : step);
+            // The negated comparisons also reject NaN.
+            if (isFactor ? !(increment > 1.0) : !(increment > 0.0))
+            {
+                throw RUNTIME_EXCEPTION( "Invalid step of the range %s.", text);
+            }
+            // A factor never leaves 0 and never reaches a positive last value from a negative first one.
+            if (isFactor && !(first > 0.0))
+            {
+                throw RUNTIME_EXCEPTION( "The range %s with a factor must start above 0.", text);
+            }
+            // The tolerance keeps the last value of ranges with fractional steps.
+            for (double value = first; value <= last * (1.0 + 1e-9); value = isFactor ? value * increment : value + increment)
+            {
+                if (values.size() == c_maxBracketValues)
+                {
+                    throw RUNTIME_EXCEPTION( "The range %s has more than %u values.", text, static_cast<unsigned int>(c_maxBracketValues));
+                }
+                values.push_back( value);
+            }
+            return values;
+        }
+
+        const char* pValue = text;
+        while (*pValue != '\0')
+        {
+            if (values.size() == c_maxBracketValues)
+            {
+                throw RUNTIME_EXCEPTION( "The value list %s has more than %u values.", text, static_cast<unsigned int>(c_maxBracketValues));
+            }
+            char* pEnd = NULL;
+            values.push_back( strtod( pValue, &pEnd));
+            if (pEnd == pValue || (*pEnd != ',' && *pEnd != '\0'))
+            {
+                throw RUNTIME_EXCEPTION( "Invalid value list %s.", text);
+            }
+            pValue = *pEnd == ',' ? pEnd + 1 : pEnd;
+        }
+        return values;
+    }
+
+    // Returns the steps of all combinations of the exposure times and gains, the exposure time changing fastest.
+    inline std::vector<SBracketStep> GetBracketSteps( const std::vector<double>& exposureTimes, const std::vector<double>& gains, size_t framesPerStep)
+    {
+        std::vector<SBracketStep> steps;
+        for (size_t g = 0; g < gains.size(); ++g)
+        {
+            for (size_t e = 0; e < exposureTimes.size(); ++e)
+            {
+                SBracketStep step;
+                step.ExposureTime = exposureTimes[e];
+                step.Gain = gains[g];
+                step.FrameCount = framesPerStep;
+                steps.push_back( step);
+            }
+        }
+        return steps;
+    }
+
+    // Reads the steps of a job file. Steps without a frame count take framesPerStep frames.
+    inline std::vector<SBracketStep> ReadBracketJob( const char* fileName, size_t framesPerStep)
+    {
+        FILE* pFile = fopen( fileName, "r");
+        if (pFile == NULL)
+        {
+            throw RUNTIME_EXCEPTION( "Could not open the bracket job %s.", fileName);
+        }
+
+        std::vector<SBracketStep> steps;
+        char line[256];
+        int lineNumber = 0;
+        while (fgets( line, sizeof( line), pFile) != NULL)
+        {
+            ++lineNumber;
+            const char* pText = line + strspn( line, " \t");
+            if (*pText == '#' || *pText == '\r' || *pText == '\n' || *pText == '\0')
+            {
+                continue;
+            }
+
+            SBracketStep step;
+            unsigned int frameCount = 0;
+            const int fieldCount = sscanf( pText, "%lf %lf %u", &step.ExposureTime, &step.Gain, &frameCount);
+            if (fieldCount < 2)
+            {
+                fclose( pFile);
+                throw RUNTIME_EXCEPTION( "Invalid step in line %d of the bracket job %s.", lineNumber, fileName);
+            }
+            step.FrameCount = fieldCount == 3 ? frameCount : framesPerStep;
+            steps.push_back( step);
+        }
+        fclose( pFile);
+        return steps;
+    }
+
+    inline size_t GetBracketFrameCount( const std::vector<SBracketStep>& steps)
+    {
+        size_t frameCount = 0;
+        for (size_t i = 0; i < steps.size(); ++i)
+        {
+            frameCount += steps[i].FrameCount;
+        }
+        return frameCount;
+    }
+
+    // Triggers the frames of the steps. waitForFrames( n) is called with the number of frames that must have been
+    // retrieved and released before the next trigger: to keep a buffer free for every triggered frame, and without
+    // staging to wait for the last frame of a step. Returns the number of triggered frames.
+    template <typename CameraT>
+    size_t TriggerBracket( CameraT& camera, const std::vector<SBracketStep>& steps, bool isStaged, const std::function<void( size_t)>& waitForFrames)
+    {
+        const size_t bufferCount = static_cast<size_t>(std::max<int64_t>( 2, camera.MaxNumBuffer.GetValue()));
+        size_t triggeredCount = 0;
+        for (size_t i = 0; i < steps.size(); ++i)
+        {
+            if (i == 0 || steps[i].ExposureTime != steps[i - 1].ExposureTime || steps[i].Gain != steps[i - 1].Gain)
+            {
+                if (!isStaged)
+                {
+                    waitForFrames( triggeredCount);
+                }
+                // The previous frame is exposed once the camera accepts the next trigger.
+                const unsigned int timeoutMs = 1000 + static_cast<unsigned int>((i == 0 ? 0.0 : steps[i - 1].ExposureTime) / 1000.0);
+                camera.WaitForFrameTriggerReady( timeoutMs, TimeoutHandling_ThrowException);
+                camera.ExposureTime.SetValue( steps[i].ExposureTime);
+                camera.Gain.SetValue( steps[i].Gain);
+            }
+
+            const unsigned int timeoutMs = 1000 + static_cast<unsigned int>(steps[i].ExposureTime / 1000.0);
+            for (size_t j = 0; j < steps[i].FrameCount; ++j)
+            {
+                if (triggeredCount + 1 >= bufferCount)
+                {
+                    waitForFrames( triggeredCount + 2 - bufferCount);
+                }
+                camera.WaitForFrameTriggerReady( timeoutMs, TimeoutHandling_ThrowException);
+                camera.ExecuteSoftwareTrigger();
+                ++triggeredCount;
+            }
+        }
+        return triggeredCount;
+    }
+}
+
+#endif /* INCLUDED_BRACKETJOB_H_2961584 */
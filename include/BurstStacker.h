@@ -0,0 +1,540 @@
+// Contains the stacking of the frames of a burst of a static scene into one frame with less temporal noise.
+/*
+   CBurstStacker takes the frames of a burst one by one as they arrive and combines them into one frame of
+   the same pixel type in one of three modes:
+       mean      the frames are added to 32-bit sums as they arrive and the sums are divided by the frame
+                 count at the end. Only the sums are held, one frame of memory whatever the burst length.
+                 The noise drops by the square root of the frame count, but every outlier, like a hot pixel
+                 or a moving object, is averaged in.
+       sigma     sigma-clipped mean: the mean of the values of a pixel within ClipSigma standard deviations
+                 of their mean. Needs all frames, which are copied as they arrive.
+       median    the median of the values of a pixel, of the two middle values for even frame counts. Needs
+                 all frames, rejects outliers best, but is noisier than the mean by about 25 %.
+   The mode is selected on the command line with -stack mean|sigma|median.
+
+   The sums are formed with SSE2 or, if the compiler targets it, AVX2. The clipping combines 4 or 8 pixels of
+   all frames in registers, the median sorts 8 or 16 pixels of all frames with a network of min and max.
+   When the stack is finished, the frame is split into strips of rows combined in parallel.
+   Supported are 16-bit frames like Mono12 or BayerGB12; pixels are combined independently, so Bayer frames
+   give a Bayer frame.
+*/
+
+#ifndef INCLUDED_BURSTSTACKER_H_5130962
+#define INCLUDED_BURSTSTACKER_H_5130962
+
+#include <pylon/PylonIncludes.h>
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#    include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace Pylon
+{
+    enum EStackMode
+    {
+        StackMode_Mean,
+        StackMode_SigmaClippedMean,
+        StackMode_Median
+    };
+
+    inline EStackMode GetStackMode( const char* name)
+    {
+        if (strcmp( name, "mean") == 0)
+        {
+            return StackMode_Mean;
+        }
+        if (strcmp( name, "sigma") == 0)
+        {
+            return StackMode_SigmaClippedMean;
+        }
+        if (strcmp( name, "median") == 0)
+        {
+            return StackMode_Median;
+        }
+        throw RUNTIME_EXCEPTION( "Unknown stack mode %s. Use mean, sigma or median.", name);
+    }
+
+    inline const char* GetStackModeName( EStackMode mode)
+    {
+        switch (mode)
+        {
+        case StackMode_Mean: return "mean";
+        case StackMode_SigmaClippedMean: return "sigma";
+        case StackMode_Median: return "median";
+        default: return "unknown";
+        }
+    }
+
+    struct SBurstStackSettings
+    {
+        SBurstStackSettings()
+            : Mode( StackMode_Mean)
+            , ClipSigma( 3.0)
+            , MaxFrames( 64)
+            , StripRows( 32)
+            , NumThreads( 0)
+        {
+        }
+
+        EStackMode Mode;
+        double ClipSigma;           // Values further from the mean are not used by the sigma-clipped mean.
+        size_t MaxFrames;           // Frames held by sigma and median, further frames are ignored.
+        uint32_t StripRows;         // Rows per strip combined by one thread.
+        unsigned int NumThreads;    // 0 uses one thread per hardware thread.
+    };
+
+    namespace BurstStackerDetail
+    {
+        // Frames the vectorized median sorts in registers held on the stack, larger stacks take the scalar median.
+        const size_t c_maxVectorMedianFrames = 64;
+
+        inline void AccumulateRow( const uint16_t* pRow, uint32_t width, uint32_t* pSums)
+        {
+            uint32_t x = 0;
+#if defined(__AVX2__)
+            for (; x + 16 <= width; x += 16)
+            {
+                const __m256i values = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(pRow + x));
+                __m256i* pLow = reinterpret_cast<__m256i*>(pSums + x);
+                __m256i* pHigh = reinterpret_cast<__m256i*>(pSums + x + 8);
+                _mm256_storeu_si256( pLow, _mm256_add_epi32( _mm256_loadu_si256( pLow), _mm256_cvtepu16_epi32( _mm256_castsi256_si128( values))));
+                _mm256_storeu_si256( pHigh, _mm256_add_epi32( _mm256_loadu_si256( pHigh), _mm256_cvtepu16_epi32( _mm256_extracti128_si256( values, 1))));
+            }
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+            const __m128i zero = _mm_setzero_si128();
+            for (; x + 8 <= width; x += 8)
+            {
+                const __m128i values = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pRow + x));
+                __m128i* pLow = reinterpret_cast<__m128i*>(pSums + x);
+                __m128i* pHigh = reinterpret_cast<__m128i*>(pSums + x + 4);
+                _mm_storeu_si128( pLow, _mm_add_epi32( _mm_loadu_si128( pLow), _mm_unpacklo_epi16( values, zero)));
+                _mm_storeu_si128( pHigh, _mm_add_epi32( _mm_loadu_si128( pHigh), _mm_unpackhi_epi16( values, zero)));
+            }
+#endif
+            for (; x < width; ++x)
+            {
+                pSums[x] += pRow[x];
+            }
+        }
+
+        inline void SigmaClipPixelsScalar( const uint16_t* const* pRows, size_t frameCount, float clipSigma, uint32_t first, uint32_t width, uint16_t* pOut)
+        {
+            for (uint32_t x = first; x < width; ++x)
+            {
+                float sum = 0.0f;
+                for (size_t i = 0; i < frameCount; ++i)
+                {
+                    sum += pRows[i][x];
+                }
+                const float mean = sum / frameCount;
+                float squareSum = 0.0f;
+                for (size_t i = 0; i < frameCount; ++i)
+                {
+                    squareSum += (pRows[i][x] - mean) * (pRows[i][x] - mean);
+                }
+                const float limit = clipSigma * clipSigma * squareSum / frameCount;
+                float clippedSum = 0.0f;
+                float clippedCount = 0.0f;
+                for (size_t i = 0; i < frameCount; ++i)
+                {
+                    if ((pRows[i][x] - mean) * (pRows[i][x] - mean) <= limit)
+                    {
+                        clippedSum += pRows[i][x];
+                        clippedCount += 1.0f;
+                    }
+                }
+                pOut[x] = static_cast<uint16_t>((clippedCount > 0.0f ? clippedSum / clippedCount : mean) + 0.5f);
+            }
+        }
+
+        // The mean of the values within clipSigma standard deviations of the mean, one pass each for mean, deviation and clipped mean.
+        inline void SigmaClipRow( const uint16_t* const* pRows, size_t frameCount, float clipSigma, uint32_t width, uint16_t* pOut)
+        {
+            uint32_t x = 0;
+            const float inverseCount = 1.0f / frameCount;
+#if defined(__AVX2__)
+            const __m256 limitFactor = _mm256_set1_ps( clipSigma * clipSigma * inverseCount);
+            const __m256 one = _mm256_set1_ps( 1.0f);
+            const __m256 half = _mm256_set1_ps( 0.5f);
+            for (; x + 8 <= width; x += 8)
+            {
+                __m256 sum = _mm256_setzero_ps();
+                for (size_t i = 0; i < frameCount; ++i)
+                {
+                    sum = _mm256_add_ps( sum, _mm256_cvtepi32_ps( _mm256_cvtepu16_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>(pRows[i] + x)))));
+                }
+                const __m256 mean = _mm256_mul_ps( sum, _mm256_set1_ps( inverseCount));
+                __m256 squareSum = _mm256_setzero_ps();
+                for (size_t i = 0; i < frameCount; ++i)
+                {
+                    const __m256 deviation = _mm256_sub_ps( _mm256_cvtepi32_ps( _mm256_cvtepu16_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>(pRows[i] + x)))), mean);
+                    squareSum = _mm256_add_ps( squareSum, _mm256_mul_ps( deviation, deviation));
+                }
+                const __m256 limit = _mm256_mul_ps( squareSum, limitFactor);
+                __m256 clippedSum = _mm256_setzero_ps();
+                __m256 clippedCount = _mm256_setzero_ps();
+                for (size_t i = 0; i < frameCount; ++i)
+                {
+                    const __m256 value = _mm256_cvtepi32_ps( _mm256_cvtepu16_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>(pRows[i] + x))));
+                    const __m256 deviation = _mm256_sub_ps( value, mean);
+                    const __m256 isInside = _mm256_cmp_ps( _mm256_mul_ps( deviation, deviation), limit, _CMP_LE_OQ);
+                    clippedSum = _mm256_add_ps( clippedSum, _mm256_and_ps( isInside, value));
+                    clippedCount = _mm256_add_ps( clippedCount, _mm256_and_ps( isInside, one));
+                }
+                // With clipSigma below 1 all values can be clipped, then the mean is taken as in the scalar loop.
+                const __m256 clippedMean = _mm256_div_ps( clippedSum, _mm256_max_ps( clippedCount, one));
+                const __m256 isClipped = _mm256_cmp_ps( clippedCount, _mm256_setzero_ps(), _CMP_GT_OQ);
+                const __m256i result = _mm256_cvttps_epi32( _mm256_add_ps( _mm256_blendv_ps( mean, clippedMean, isClipped), half));
+                int32_t values[8];
+                _mm256_storeu_si256( reinterpret_cast<__m256i*>(values), result);
+                for (int j = 0; j < 8; ++j)
+                {
+                    pOut[x + j] = static_cast<uint16_t>(values[j]);
+                }
+            }
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+            const __m128 limitFactor = _mm_set1_ps( clipSigma * clipSigma * inverseCount);
+            const __m128 one = _mm_set1_ps( 1.0f);
+            const __m128 half = _mm_set1_ps( 0.5f);
+            const __m128i zero = _mm_setzero_si128();
+            for (; x + 4 <= width; x += 4)
+            {
+                __m128 sum = _mm_setzero_ps();
+                for (size_t i = 0; i < frameCount; ++i)
+                {
+                    sum = _mm_add_ps( sum, _mm_cvtepi32_ps( _mm_unpacklo_epi16( _mm_loadl_epi64( reinterpret_cast<const __m128i*>(pRows[i] + x)), zero)));
+                }
+                const __m128 mean = _mm_mul_ps( sum, _mm_set1_ps( inverseCount));
+                __m128 squareSum = _mm_setzero_ps();
+                for (size_t i = 0; i < frameCount; ++i)
+                {
+                    const __m128 deviation = _mm_sub_ps( _mm_cvtepi32_ps( _mm_unpacklo_epi16( _mm_loadl_epi64( reinterpret_cast<const __m128i*>(pRows[i] + x)), zero)), mean);
+                    squareSum = _mm_add_ps( squareSum, _mm_mul_ps( deviation, deviation));
+                }
+                const __m128 limit = _mm_mul_ps( squareSum, limitFactor);
+                __m128 clippedSum = _mm_setzero_ps();
+                __m128 clippedCount = _mm_setzero_ps();
+                for (size_t i = 0; i < frameCount; ++i)
+                {
+                    const __m128 value = _mm_cvtepi32_ps( _mm_unpacklo_epi16( _mm_loadl_epi64( reinterpret_cast<const __m128i*>(pRows[i] + x)), zero));
+                    const __m128 deviation = _mm_sub_ps( value, mean);
+                    const __m128 isInside = _mm_cmple_ps( _mm_mul_ps( deviation, deviation), limit);
+                    clippedSum = _mm_add_ps( clippedSum, _mm_and_ps( isInside, value));
+                    clippedCount = _mm_add_ps( clippedCount, _mm_and_ps( isInside, one));
+                }
+                const __m128 clippedMean = _mm_div_ps( clippedSum, _mm_max_ps( clippedCount, one));
+                const __m128 isClipped = _mm_cmpgt_ps( clippedCount, _mm_setzero_ps());
+                const __m128 average = _mm_or_ps( _mm_and_ps( isClipped, clippedMean), _mm_andnot_ps( isClipped, mean));
+                const __m128i result = _mm_cvttps_epi32( _mm_add_ps( average, half));
+                int32_t values[4];
+                _mm_storeu_si128( reinterpret_cast<__m128i*>(values), result);
+                for (int j = 0; j < 4; ++j)
+                {
+                    pOut[x + j] = static_cast<uint16_t>(values[j]);
+                }
+            }
+#endif
+            SigmaClipPixelsScalar( pRows, frameCount, clipSigma, x, width, pOut);
+        }
+
+        inline void MedianPixelsScalar( const uint16_t* const* pRows, size_t frameCount, uint32_t first, uint32_t width, uint16_t* pOut)
+        {
+            std::vector<uint16_t> values( frameCount);
+            for (uint32_t x = first; x < width; ++x)
+            {
+                for (size_t i = 0; i < frameCount; ++i)
+                {
+                    values[i] = pRows[i][x];
+                }
+                std::sort( values.begin(), values.end());
+                const size_t middle = frameCount / 2;
+                pOut[x] = frameCount % 2 != 0 ? values[middle] : static_cast<uint16_t>((values[middle - 1] + values[middle] + 1) >> 1);
+            }
+        }
+
+        // Sorts the values of every pixel with an odd-even transposition network and takes the middle.
+        inline void MedianRow( const uint16_t* const* pRows, size_t frameCount, uint32_t width, uint16_t* pOut)
+        {
+            uint32_t x = 0;
+            const size_t middle = frameCount / 2;
+#if defined(__AVX2__)
+            __m256i values[c_maxVectorMedianFrames];
+            for (; frameCount <= c_maxVectorMedianFrames && x + 16 <= width; x += 16)
+            {
+                for (size_t i = 0; i < frameCount; ++i)
+                {
+                    values[i] = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(pRows[i] + x));
+                }
+                for (size_t pass = 0; pass < frameCount; ++pass)
+                {
+                    for (size_t i = pass & 1; i + 1 < frameCount; i += 2)
+                    {
+                        const __m256i low = _mm256_min_epu16( values[i], values[i + 1]);
+                        values[i + 1] = _mm256_max_epu16( values[i], values[i + 1]);
+                        values[i] = low;
+                    }
+                }
+                _mm256_storeu_si256( reinterpret_cast<__m256i*>(pOut + x),
+                    frameCount % 2 != 0 ? values[middle] : _mm256_avg_epu16( values[middle - 1], values[middle]));
+            }
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+            // SSE2 compares signed 16-bit values, the values are shifted into that range and back.
+            __m128i values[c_maxVectorMedianFrames];
+            const __m128i bias = _mm_set1_epi16( static_cast<short>(0x8000));
+            for (; frameCount <= c_maxVectorMedianFrames && x + 8 <= width; x += 8)
+            {
+                for (size_t i = 0; i < frameCount; ++i)
+                {
+                    values[i] = _mm_xor_si128( _mm_loadu_si128( reinterpret_cast<const __m128i*>(pRows[i] + x)), bias);
+                }
+                for (size_t pass = 0; pass < frameCount; ++pass)
+                {
+                    for (size_t i = pass & 1; i + 1 < frameCount; i += 2)
+                    {
+                        const __m128i low = _mm_min_epi16( values[i], values[i + 1]);
+                        values[i + 1] = _mm_max_epi16( values[i], values[i + 1]);
+                        values[i] = low;
+                    }
+                }
+                const __m128i median = frameCount % 2 != 0 ? _mm_xor_si128( values[middle], bias)
+                    : _mm_avg_epu16( _mm_xor_si128( values[middle - 1], bias), _mm_xor_si128( values[middle], bias));
+                _mm_storeu_si128( reinterpret_cast<__m128i*>(pOut + x), median);
+            }
+#endif
+            MedianPixelsScalar( pRows, frameCount, x, width, pOut);
+        }
+    }
+
+    // Stacks the frames of bursts. The buffers are reused from burst to burst as long as the format does not change.
+    class CBurstStacker
+    {
+    public:
+        explicit CBurstStacker( const SBurstStackSettings& settings = SBurstStackSettings())
+            : m_settings( settings)
+            , m_mode( settings.Mode)
+            , m_pixelType( PixelType_Undefined)
+            , m_width( 0)
+            , m_height( 0)
+            , m_frameCount( 0)
+        {
+            if (m_settings.StripRows == 0)
+            {
+                throw RUNTIME_EXCEPTION( "The strip height of the burst stack must not be 0.");
+            }
+        }
+
+        const SBurstStackSettings& GetSettings() const
+        {
+            return m_settings;
+        }
+
+        // Takes effect with the next Reset().
+        void SetMode( EStackMode mode)
+        {
+            m_settings.Mode = mode;
+        }
+
+        // Same formats as the HDR merge: all with 16 bits per pixel.
+        static bool IsSupported( EPixelType pixelType)
+        {
+            return BitPerPixel( pixelType) == 16 && !IsPacked( pixelType);
+        }
+
+        // Starts a new stack.
+        void Reset()
+        {
+            m_frameCount = 0;
+            m_mode = m_settings.Mode;
+        }
+
+        void Add( const void* pBuffer, EPixelType pixelType, uint32_t width, uint32_t height, size_t paddingX)
+        {
+            if (!IsSupported( pixelType))
+            {
+                throw RUNTIME_EXCEPTION( "The burst stack does not support the pixel type 0x%08x.", static_cast<unsigned int>(pixelType));
+            }
+            if (m_frameCount == 0)
+            {
+                Prepare( pixelType, width, height);
+            }
+            else if (pixelType != m_pixelType || width != m_width || height != m_height)
+            {
+                throw RUNTIME_EXCEPTION( "The frames of a burst stack must have the same size and pixel type.");
+            }
+            if (m_mode != StackMode_Mean && m_frameCount >= m_settings.MaxFrames)
+            {
+                return;
+            }
+
+            const size_t rowSize = width * sizeof( uint16_t) + paddingX;
+            const uint8_t* pFirst = static_cast<const uint8_t*>(pBuffer);
+            if (m_mode == StackMode_Mean)
+            {
+                for (uint32_t y = 0; y < height; ++y)
+                {
+                    BurstStackerDetail::AccumulateRow( reinterpret_cast<const uint16_t*>(pFirst + y * rowSize), width, &m_sums[static_cast<size_t>(y) * width]);
+                }
+            }
+            else
+            {
+                if (m_frames.size() <= m_frameCount)
+                {
+                    m_frames.push_back( std::vector<uint16_t>());
+                }
+                std::vector<uint16_t>& frame = m_frames[m_frameCount];
+                frame.resize( static_cast<size_t>(width) * height);
+                for (uint32_t y = 0; y < height; ++y)
+                {
+                    memcpy( &frame[static_cast<size_t>(y) * width], pFirst + y * rowSize, width * sizeof( uint16_t));
+                }
+            }
+            ++m_frameCount;
+        }
+
+        // Adds a grab result. Returns false if the grab failed or the pixel type is not supported.
+        template <typename GrabResultPtrT>
+        bool Add( const GrabResultPtrT& ptrGrabResult)
+        {
+            if (!ptrGrabResult->GrabSucceeded() || !IsSupported( ptrGrabResult->GetPixelType()))
+            {
+                return false;
+            }
+            Add( ptrGrabResult->GetBuffer(), ptrGrabResult->GetPixelType(), ptrGrabResult->GetWidth(), ptrGrabResult->GetHeight(),
+                ptrGrabResult->GetPaddingX());
+            return true;
+        }
+
+        // Combines the frames added since the last reset into the stacked frame.
+        void Finish()
+        {
+            if (m_frameCount == 0)
+            {
+                throw RUNTIME_EXCEPTION( "The burst stack has no frames.");
+            }
+            const size_t frameCount = std::min( m_frameCount, m_mode == StackMode_Mean ? m_frameCount : m_settings.MaxFrames);
+            const uint32_t stripCount = (m_height + m_settings.StripRows - 1) / m_settings.StripRows;
+            std::atomic<uint32_t> nextStrip( 0);
+            auto finishStrips = [&]()
+            {
+                std::vector<const uint16_t*> pRows( frameCount);
+                for (uint32_t strip = nextStrip++; strip < stripCount; strip = nextStrip++)
+                {
+                    const uint32_t endRow = std::min( m_height, (strip + 1) * m_settings.StripRows);
+                    for (uint32_t y = strip * m_settings.StripRows; y < endRow; ++y)
+                    {
+                        const size_t rowStart = static_cast<size_t>(y) * m_width;
+                        if (m_mode == StackMode_Mean)
+                        {
+                            const uint32_t rounding = static_cast<uint32_t>(frameCount / 2);
+                            for (uint32_t x = 0; x < m_width; ++x)
+                            {
+                                m_output[rowStart + x] = static_cast<uint16_t>((m_sums[rowStart + x] + rounding) / frameCount);
+                            }
+                            continue;
+                        }
+                        for (size_t i = 0; i < frameCount; ++i)
+                        {
+                            pRows[i] = &m_frames[i][rowStart];
+                        }
+                        if (m_mode == StackMode_Median)
+                        {
+                            BurstStackerDetail::MedianRow( &pRows[0], frameCount, m_width, &m_output[rowStart]);
+                        }
+                        else
+                        {
+                            BurstStackerDetail::SigmaClipRow( &pRows[0], frameCount, static_cast<float>(m_settings.ClipSigma), m_width, &m_output[rowStart]);
+                        }
+                    }
+                }
+            };
+
+            unsigned int numThreads = m_settings.NumThreads != 0 ? m_settings.NumThreads : std::thread::hardware_concurrency();
+            numThreads = std::max( 1u, std::min( numThreads, stripCount));
+            std::vector<std::thread> threads;
+            for (unsigned int i = 1; i < numThreads; ++i)
+            {
+                threads.push_back( std::thread( finishStrips));
+            }
+            finishStrips();
+            for (size_t i = 0; i < threads.size(); ++i)
+            {
+                threads[i].join();
+            }
+            m_image.AttachUserBuffer( &m_output[0], m_output.size() * sizeof( uint16_t), m_pixelType, m_width, m_height, 0);
+        }
+
+        // Frames added since the last reset, including those ignored beyond MaxFrames.
+        size_t GetFrameCount() const
+        {
+            return m_frameCount;
+        }
+
+        EStackMode GetMode() const
+        {
+            return m_mode;
+        }
+
+        // The stacked frame of the last Finish(). Refers to the buffer of the stacker.
+        const CPylonImage& GetImage() const
+        {
+            return m_image;
+        }
+
+        // Bytes held for the frames of the current stack and the stacked frame.
+        size_t GetMemorySize() const
+        {
+            size_t size = m_sums.capacity() * sizeof( uint32_t) + m_output.capacity() * sizeof( uint16_t);
+            for (size_t i = 0; i < m_frames.size(); ++i)
+            {
+                size += m_frames[i].capacity() * sizeof( uint16_t);
+            }
+            return size;
+        }
+
+    private:
+        // Allocates the buffers of the first frame of a stack. Buffers of a mode not used are released.
+        void Prepare( EPixelType pixelType, uint32_t width, uint32_t height)
+        {
+            if (pixelType != m_pixelType || width != m_width || height != m_height)
+            {
+                m_frames.clear();
+            }
+            m_pixelType = pixelType;
+            m_width = width;
+            m_height = height;
+            const size_t pixelCount = static_cast<size_t>(width) * height;
+            m_output.resize( pixelCount);
+            if (m_mode == StackMode_Mean)
+            {
+                m_sums.assign( pixelCount, 0);
+                std::vector< std::vector<uint16_t> >().swap( m_frames);
+            }
+            else
+            {
+                std::vector<uint32_t>().swap( m_sums);
+            }
+        }
+
+        SBurstStackSettings m_settings;
+        EStackMode m_mode;
+        EPixelType m_pixelType;
+        uint32_t m_width;
+        uint32_t m_height;
+        size_t m_frameCount;
+        std::vector<uint32_t> m_sums;
+        std::vector< std::vector<uint16_t> > m_frames;
+        std::vector<uint16_t> m_output;
+        CPylonImage m_image;
+    };
+}
+
+#endif /* INCLUDED_BURSTSTACKER_H_5130962 */
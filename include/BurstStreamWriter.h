@@ -0,0 +1,335 @@
+// Contains the streaming of long bursts to a frame container with bounded memory.
+/*
+   A burst kept as grab results holds one driver buffer per frame until it is stored, so its length is
+   limited by MaxNumBuffer and the memory of the buffers. CBurstStreamWriter instead copies every frame
+   into a staging arena of fixed size and writes it to a frame container, see FrameStorage.h, on its own
+   thread. The image event handler returns the buffer to the driver as soon as the copy is made, so the
+   memory used does not depend on the length of the burst:
+
+       arena   ArenaSize bytes allocated by Open(), divided into slots of the size of the first frame
+       queue   the slots filled and not yet written, a ring in the order of the frames
+
+   Add() claims the next free slot, copies the frame and queues it for the writer thread. If the disk is
+   slower than the cameras for longer than the arena can buffer, no slot is free: Add() waits up to
+   MaxWaitMs for the writer and then drops the frame, counted by GetDroppedCount(). With the default of 0
+   the grab threads never wait. GetMaxQueuedCount() shows how close a burst came to dropping frames.
+
+   Add() may be called from the grab threads of several cameras, the camera index is kept in the records.
+   Close() writes the queued frames, ends the writer thread and closes the file. An error of the writer
+   thread is thrown by Close(), the frames added after it are dropped.
+*/
+
+#ifndef INCLUDED_BURSTSTREAMWRITER_H_6180342
+#define INCLUDED_BURSTSTREAMWRITER_H_6180342
+
+#include <pylon/PylonIncludes.h>
+#include "FrameStorage.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Pylon
+{
+    struct SBurstStreamSettings
+    {
+        SBurstStreamSettings()
+            : ArenaSize( 256 * 1024 * 1024)
+            , MaxWaitMs( 0)
+            , StreamBufferSize( 16 * 1024 * 1024)
+            , Encoding( FrameEncoding_None)
+        {
+        }
+
+        size_t ArenaSize;               // Memory of the staging slots in bytes, at least 2 slots are made.
+        unsigned int MaxWaitMs;         // Time Add() waits for a free slot before it drops the frame.
+        size_t StreamBufferSize;        // Stream buffer of the frame container.
+        EFrameEncoding Encoding;        // Encoding of the payloads, done on the writer thread.
+    };
+
+    class CBurstStreamWriter
+    {
+    public:
+        explicit CBurstStreamWriter( const SBurstStreamSettings& settings = SBurstStreamSettings())
+            : m_settings( settings)
+            , m_slotSize( 0)
+            , m_head( 0)
+            , m_queuedCount( 0)
+            , m_isOpen( false)
+            , m_isClosing( false)
+            , m_addedCount( 0)
+            , m_droppedCount( 0)
+            , m_writtenCount( 0)
+            , m_bytesWritten( 0)
+            , m_maxQueuedCount( 0)
+        {
+        }
+
+        ~CBurstStreamWriter()
+        {
+            try
+            {
+                Close();
+            }
+            catch (...)
+            {
+            }
+        }
+
+        // Creates the frame container, allocates the arena and starts the writer thread.
+        void Open( const char* fileName)
+        {
+            Close();
+            m_writer.Open( fileName, m_settings.StreamBufferSize);
+            m_writer.SetEncoding( m_settings.Encoding);
+            // Touches the pages, so that the first frames are not slowed down by page faults.
+            m_arena.assign( m_settings.ArenaSize, 0);
+            m_slots.clear();
+            m_slotSize = 0;
+            m_head = 0;
+            m_queuedCount = 0;
+            m_addedCount = 0;
+            m_droppedCount = 0;
+            m_writtenCount = 0;
+            m_bytesWritten = 0;
+            m_maxQueuedCount = 0;
+            m_error = std::exception_ptr();
+            m_isClosing = false;
+            m_isOpen = true;
+            m_thread = std::thread( [this]() { WriteLoop(); });
+        }
+
+        bool IsOpen() const
+        {
+            return m_isOpen;
+        }
+
+        // Copies a frame into the arena and queues it. Returns false if the frame was dropped.
+        bool Add( const SFrameContainerRecord& record, const void* pBuffer, size_t bufferSize)
+        {
+            size_t slotIndex = 0;
+            {
+                std::unique_lock<std::mutex> lock( m_lock);
+                if (!m_isOpen || m_isClosing || m_error)
+                {
+                    return false;
+                }
+                ++m_addedCount;
+                // The slots are sized by the first frame, the frames of a burst have the same size.
+                if (m_slots.empty())
+                {
+                    m_slotSize = static_cast<size_t>(GetFrameContainerPaddedSize( bufferSize));
+                    m_slots.resize( std::max<size_t>( 2, m_slotSize != 0 ? m_arena.size() / m_slotSize : 2));
+                    if (m_arena.size() < m_slots.size() * m_slotSize)
+                    {
+                        m_arena.resize( m_slots.size() * m_slotSize);
+                    }
+                }
+                if (bufferSize > m_slotSize
+                    || !m_freed.wait_for( lock, std::chrono::milliseconds( m_settings.MaxWaitMs), [this]() { return m_queuedCount < m_slots.size() || m_error; })
+                    || m_error)
+                {
+                    ++m_droppedCount;
+                    return false;
+                }
+                slotIndex = (m_head + m_queuedCount) % m_slots.size();
+                m_slots[slotIndex].IsReady = false;
+                ++m_queuedCount;
+                m_maxQueuedCount = std::max( m_maxQueuedCount, m_queuedCount);
+            }
+
+            // Copied without the lock, the grab threads of several cameras fill their slots at once.
+            m_slots[slotIndex].Record = record;
+            m_slots[slotIndex].Size = bufferSize;
+            memcpy( &m_arena[slotIndex * m_slotSize], pBuffer, bufferSize);
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                m_slots[slotIndex].IsReady = true;
+            }
+            m_queued.notify_one();
+            return true;
+        }
+
+        // Copies the image of a grab result into the arena and queues it. Returns false if the frame was dropped.
+        template <typename GrabResultPtrT>
+        bool Add( const GrabResultPtrT& ptrGrabResult, uint32_t cameraIndex = 0)
+        {
+            SFrameContainerRecord record;
+            memset( &record, 0, sizeof( record));
+            record.PixelType = static_cast<uint32_t>(ptrGrabResult->GetPixelType());
+            record.Width = ptrGrabResult->GetWidth();
+            record.Height = ptrGrabResult->GetHeight();
+            record.PaddingX = static_cast<uint32_t>(ptrGrabResult->GetPaddingX());
+            record.CameraIndex = cameraIndex;
+            record.TimeStamp = ptrGrabResult->GetTimeStamp();
+            record.BlockID = ptrGrabResult->GetBlockID();
+            record.ImageNumber = static_cast<uint64_t>(ptrGrabResult->GetImageNumber());
+            return Add( record, ptrGrabResult->GetBuffer(), ptrGrabResult->GetImageSize());
+        }
+
+        // Writes the queued frames and closes the file. Throws the error of the writer thread, if there was one.
+        void Close()
+        {
+            if (!m_isOpen)
+            {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                m_isClosing = true;
+            }
+            m_queued.notify_one();
+            m_thread.join();
+            m_isOpen = false;
+            std::exception_ptr error = m_error;
+            if (!error)
+            {
+                m_writer.Close();
+            }
+            else
+            {
+                try
+                {
+                    m_writer.Close();
+                }
+                catch (...)
+                {
+                }
+                std::rethrow_exception( error);
+            }
+        }
+
+        // Frames passed to Add(), including the dropped ones.
+        uint64_t GetAddedCount() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_addedCount;
+        }
+
+        uint64_t GetDroppedCount() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_droppedCount;
+        }
+
+        // Frames written to the file. Complete after Close().
+        uint64_t GetWrittenCount() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_writtenCount;
+        }
+
+        size_t GetQueuedCount() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_queuedCount;
+        }
+
+        // The largest number of frames waiting for the writer, at most GetSlotCount().
+        size_t GetMaxQueuedCount() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_maxQueuedCount;
+        }
+
+        // The number of slots, 0 before the first frame.
+        size_t GetSlotCount() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_slots.size();
+        }
+
+        size_t GetArenaSize() const
+        {
+            return m_arena.size();
+        }
+
+        // Bytes written to the file, including the headers. Complete after Close().
+        uint64_t GetBytesWritten() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_bytesWritten;
+        }
+
+    private:
+        // Not copyable.
+        CBurstStreamWriter( const CBurstStreamWriter&);
+        CBurstStreamWriter& operator=( const CBurstStreamWriter&);
+
+        struct SSlot
+        {
+            SSlot()
+                : Size( 0)
+                , IsReady( false)
+            {
+            }
+
+            SFrameContainerRecord Record;
+            size_t Size;
+            bool IsReady;           // The copy into the slot is complete.
+        };
+
+        // Writes the slots in the order they were claimed until Close() and the queue is empty.
+        void WriteLoop()
+        {
+            std::unique_lock<std::mutex> lock( m_lock);
+            for (;;)
+            {
+                m_queued.wait( lock, [this]() { return (m_queuedCount != 0 && m_slots[m_head].IsReady) || (m_isClosing && m_queuedCount == 0); });
+                if (m_queuedCount == 0)
+                {
+                    return;
+                }
+                const SSlot& slot = m_slots[m_head];
+                const uint8_t* pPayload = &m_arena[m_head * m_slotSize];
+                lock.unlock();
+                try
+                {
+                    m_writer.Append( slot.Record, pPayload, slot.Size);
+                }
+                catch (...)
+                {
+                    lock.lock();
+                    m_error = std::current_exception();
+                    m_queuedCount = 0;
+                    m_freed.notify_all();
+                    return;
+                }
+                lock.lock();
+                m_slots[m_head].IsReady = false;
+                m_head = (m_head + 1) % m_slots.size();
+                --m_queuedCount;
+                m_writtenCount = m_writer.GetFrameCount();
+                m_bytesWritten = m_writer.GetBytesWritten();
+                m_freed.notify_one();
+            }
+        }
+
+        const SBurstStreamSettings m_settings;
+        CFrameContainerWriter m_writer;
+        std::vector<uint8_t> m_arena;
+        size_t m_slotSize;
+        std::vector<SSlot> m_slots;
+        size_t m_head;                  // The oldest queued slot.
+        size_t m_queuedCount;
+        bool m_isOpen;
+        bool m_isClosing;
+        std::exception_ptr m_error;
+        std::thread m_thread;
+        mutable std::mutex m_lock;
+        std::condition_variable m_queued;
+        std::condition_variable m_freed;
+        uint64_t m_addedCount;
+        uint64_t m_droppedCount;
+        uint64_t m_writtenCount;
+        uint64_t m_bytesWritten;
+        size_t m_maxQueuedCount;
+    };
+}
+
+#endif /* INCLUDED_BURSTSTREAMWRITER_H_6180342 */
@@ -0,0 +1,302 @@
+// Contains typed access to camera and chunk nodes, looked up by name once.
+/*
+   INodeMap::GetNode() finds a node by its name in the map of the node map, and the smart pointer made
+   from it checks the interface of the node. Done for every frame, as Grab_ChunkImage did for the
+   ChunkTimestamp, the lookup costs more than reading the value. The classes here look a node up once
+   and keep the typed pointer:
+
+       CCachedNodeT<NodePtrT>      a node of a node map, looked up by Resolve(), e.g. in OnOpened
+       CChunkNodeCacheT<NodePtrT>  a chunk node of the grab results. Every buffer has its own chunk node
+                                   map, the node is looked up the first time a buffer is seen
+       CAoiNodesT<CameraT>         the image AOI and the pixel format of a camera
+
+   Only the GenApi interfaces are used, so the same code compiles for the camera types of every
+   transport, see CameraTransport.h, and for the generic CInstantCamera.
+
+   A node pointer is valid as long as its node map. The chunk node maps are destroyed with the buffers
+   when grabbing stops: Clear() a CChunkNodeCacheT before grabbing is started again. A CChunkNodeCacheT
+   is used by one grab thread, e.g. as a member of the image event handler of one camera.
+*/
+
+#ifndef INCLUDED_CAMERANODEACCESS_H_7730518
+#define INCLUDED_CAMERANODEACCESS_H_7730518
+
+#include <pylon/PylonIncludes.h>
+
+#include <string>
+#include <vector>
+
+namespace Pylon
+{
+    template <typename NodePtrT>
+    class CCachedNodeT
+    {
+    public:
+        explicit CCachedNodeT( const char* name)
+            : m_name( name)
+        {
+        }
+
+        // Looks the node up in the node map. Returns false if the node map has no such node.
+        bool Resolve( GenApi::INodeMap& nodeMap)
+        {
+            m_node = nodeMap.GetNode( m_name.c_str());
+            return m_node.IsValid();
+        }
+
+        void Reset()
+        {
+            m_node = NodePtrT();
+        }
+
+        bool IsValid() const
+        {
+            return m_node.IsValid();
+        }
+
+        bool IsReadable() const
+        {
+            return m_node.IsValid() && GenApi::IsReadable( m_node);
+        }
+
+        bool IsWritable() const
+        {
+            return m_node.IsValid() && GenApi::IsWritable( m_node);
+        }
+
+        const std::string& GetName() const
+        {
+            return m_name;
+        }
+
+        // The typed pointer, e.g. node->GetValue().
+        const NodePtrT& operator->() const
+        {
+            return m_node;
+        }
+
+        const NodePtrT& Get() const
+        {
+            return m_node;
+        }
+
+    private:
+        std::string m_name;
+        NodePtrT m_node;
+    };
+
+    typedef CCachedNodeT<GenApi::CIntegerPtr> CCachedIntegerNode;
+    typedef CCachedNodeT<GenApi::CFloatPtr> CCachedFloatNode;
+    typedef CCachedNodeT<GenApi::CBooleanPtr> CCachedBooleanNode;
+    typedef CCachedNodeT<GenApi::CEnumerationPtr> CCachedEnumerationNode;
+
+    template <typename NodePtrT>
+    class CChunkNodeCacheT
+    {
+    public:
+        // The cache starts over when more than maxNodeMaps chunk node maps were seen, a few more than MaxNumBuffer.
+        explicit CChunkNodeCacheT( const char* name, size_t maxNodeMaps = 64)
+            : m_name( name)
+            , m_maxNodeMaps( maxNodeMaps)
+            , m_last( 0)
+            , m_lookupCount( 0)
+        {
+        }
+
+        // Returns the node of the chunk node map, valid until the next call.
+        const NodePtrT& Get( GenApi::INodeMap& nodeMap)
+        {
+            // The buffers are mostly returned in the order they were queued, the entry after the last one is checked first.
+            const size_t count = m_entries.size();
+            size_t index = m_last;
+            for (size_t i = 0; i < count; ++i)
+            {
+                index = index + 1 < count ? index + 1 : 0;
+                if (m_entries[index].pNodeMap == &nodeMap)
+                {
+                    m_last = index;
+                    return m_entries[index].Node;
+                }
+            }
+
+            if (count >= m_maxNodeMaps)
+            {
+                m_entries.clear();
+            }
+            SEntry entry;
+            entry.pNodeMap = &nodeMap;
+            entry.Node = nodeMap.GetNode( m_name.c_str());
+            m_entries.push_back( entry);
+            m_last = m_entries.size() - 1;
+            ++m_lookupCount;
+            return m_entries.back().Node;
+        }
+
+        template <typename GrabResultPtrT>
+        const NodePtrT& Get( const GrabResultPtrT& ptrGrabResult)
+        {
+            return Get( ptrGrabResult->GetChunkDataNodeMap());
+        }
+
+        // Reads the chunk of the grab result. Returns false if it is not readable.
+        template <typename GrabResultPtrT, typename ValueT>
+        bool TryGetValue( const GrabResultPtrT& ptrGrabResult, ValueT& value)
+        {
+            const NodePtrT& node = Get( ptrGrabResult);
+            if (!node.IsValid() || !GenApi::IsReadable( node))
+            {
+                return false;
+            }
+            value = node->GetValue();
+            return true;
+        }
+
+        // Forgets the chunk node maps, before grabbing is started again.
+        void Clear()
+        {
+            m_entries.clear();
+            m_last = 0;
+        }
+
+        // The number of lookups by name, one per buffer unless the cache started over.
+        uint64_t GetLookupCount() const
+        {
+            return m_lookupCount;
+        }
+
+        size_t GetNodeMapCount() const
+        {
+            return m_entries.size();
+        }
+
+    private:
+        struct SEntry
+        {
+            GenApi::INodeMap* pNodeMap;
+            NodePtrT Node;
+        };
+
+        std::string m_name;
+        size_t m_maxNodeMaps;
+        std::vector<SEntry> m_entries;
+        size_t m_last;
+        uint64_t m_lookupCount;
+    };
+
+    typedef CChunkNodeCacheT<GenApi::CIntegerPtr> CChunkIntegerNodeCache;
+    typedef CChunkNodeCacheT<GenApi::CFloatPtr> CChunkFloatNodeCache;
+
+    template <typename CameraT>
+    class CAoiNodesT
+    {
+    public:
+        CAoiNodesT()
+            : m_width( "Width")
+            , m_height( "Height")
+            , m_offsetX( "OffsetX")
+            , m_offsetY( "OffsetY")
+            , m_pixelFormat( "PixelFormat")
+        {
+        }
+
+        // Looks the nodes up in the node map of the opened camera. Cameras without offsets have a fixed AOI position.
+        void Resolve( CameraT& camera)
+        {
+            GenApi::INodeMap& control = camera.GetNodeMap();
+            if (!m_width.Resolve( control) || !m_height.Resolve( control) || !m_pixelFormat.Resolve( control))
+            {
+                throw RUNTIME_EXCEPTION( "The camera has no Width, Height or PixelFormat.");
+            }
+            m_offsetX.Resolve( control);
+            m_offsetY.Resolve( control);
+        }
+
+        int64_t GetWidth() const
+        {
+            return m_width->GetValue();
+        }
+
+        int64_t GetHeight() const
+        {
+            return m_height->GetValue();
+        }
+
+        int64_t GetOffsetX() const
+        {
+            return m_offsetX.IsReadable() ? m_offsetX->GetValue() : 0;
+        }
+
+        int64_t GetOffsetY() const
+        {
+            return m_offsetY.IsReadable() ? m_offsetY->GetValue() : 0;
+        }
+
+        // The value of the PixelFormat enumeration, the PFNC pixel type.
+        int64_t GetPixelFormat() const
+        {
+            return m_pixelFormat->GetIntValue();
+        }
+
+        void SetPixelFormat( const char* pixelFormat)
+        {
+            m_pixelFormat->FromString( pixelFormat);
+        }
+
+        // Sets the image AOI. The offsets are moved to the origin first, so that every size fits the sensor.
+        void SetAoi( int64_t width, int64_t height, int64_t offsetX, int64_t offsetY)
+        {
+            WriteAoi( *m_width.Get(), *m_height.Get(), m_offsetX.IsWritable() ? &*m_offsetX.Get() : NULL,
+                m_offsetY.IsWritable() ? &*m_offsetY.Get() : NULL, width, height, offsetX, offsetY);
+        }
+
+        // Sets the image AOI through integer parameters, the nodes above or the typed parameters of a camera
+        // without a node map like CSyntheticFrameSource. Offsets that are not writable are passed as NULL.
+        template <typename IntegerT>
+        static void WriteAoi( IntegerT& width, IntegerT& height, IntegerT* pOffsetX, IntegerT* pOffsetY,
+            int64_t widthValue, int64_t heightValue, int64_t offsetXValue, int64_t offsetYValue)
+        {
+            if (pOffsetX != NULL)
+            {
+                pOffsetX->SetValue( pOffsetX->GetMin());
+            }
+            if (pOffsetY != NULL)
+            {
+                pOffsetY->SetValue( pOffsetY->GetMin());
+            }
+            width.SetValue( widthValue);
+            height.SetValue( heightValue);
+            if (pOffsetX != NULL)
+            {
+                pOffsetX->SetValue( offsetXValue);
+            }
+            if (pOffsetY != NULL)
+            {
+                pOffsetY->SetValue( offsetYValue);
+            }
+        }
+
+        // Sets the image AOI to the full sensor.
+        void Maximize()
+        {
+            if (m_offsetX.IsWritable())
+            {
+                m_offsetX->SetValue( m_offsetX->GetMin());
+            }
+            if (m_offsetY.IsWritable())
+            {
+                m_offsetY->SetValue( m_offsetY->GetMin());
+            }
+            m_width->SetValue( m_width->GetMax());
+            m_height->SetValue( m_height->GetMax());
+        }
+
+    private:
+        CCachedIntegerNode m_width;
+        CCachedIntegerNode m_height;
+        CCachedIntegerNode m_offsetX;
+        CCachedIntegerNode m_offsetY;
+        CCachedEnumerationNode m_pixelFormat;
+    };
+}
+
+#endif /* INCLUDED_CAMERANODEACCESS_H_7730518 */
@@ -0,0 +1,345 @@
+// Contains a cache of camera parameter writes.
+/*
+   Every write of a camera parameter such as Gain or ExposureTime is a control transaction to the
+   device, on USB about a millisecond or more. CCameraParameterCache remembers the last value written
+   through it per parameter and skips writes that do not change the value.
+
+   Writes can also be queued. Queuing a parameter again before the queue is flushed replaces the queued
+   value, so repeated key presses between two frames end up in one transaction. The queued writes are
+   applied in the order the parameters were first queued, e.g. GainAuto before Gain. Queue and Flush may
+   be called from different threads, e.g. from the thread reading the keys and from the grab loop thread
+   of the camera, which flushes once per frame. FlushParameterCaches flushes several cameras in parallel.
+   If a write of Flush() throws, e.g. for a value out of range, that write is dropped and the exception
+   passed on, the writes queued after it stay queued for the next Flush().
+
+   The cache only knows the values written through it. After a parameter was changed otherwise, e.g. by
+   a camera reset or a user set, Invalidate() makes the next write go to the device.
+*/
+
+#ifndef INCLUDED_CAMERAPARAMETERCACHE_H_4471926
+#define INCLUDED_CAMERAPARAMETERCACHE_H_4471926
+
+#include <pylon/PylonIncludes.h>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Pylon
+{
+    // Write statistics of one parameter.
+    struct SParameterWriteStatistics
+    {
+        SParameterWriteStatistics()
+            : Requests( 0)
+            , Transactions( 0)
+            , Redundant( 0)
+            , Coalesced( 0)
+            , TotalSeconds( 0.0)
+            , MaxSeconds( 0.0)
+        {
+        }
+
+        // Transactions saved by the cache.
+        uint64_t GetSaved() const
+        {
+            return Redundant + Coalesced;
+        }
+
+        double GetMeanSeconds() const
+        {
+            return Transactions > 0 ? TotalSeconds / Transactions : 0.0;
+        }
+
+        void Add( const SParameterWriteStatistics& other)
+        {
+            Requests += other.Requests;
+            Transactions += other.Transactions;
+            Redundant += other.Redundant;
+            Coalesced += other.Coalesced;
+            TotalSeconds += other.TotalSeconds;
+            MaxSeconds = std::max( MaxSeconds, other.MaxSeconds);
+        }
+
+        uint64_t Requests;      // Writes requested, written at once or queued.
+        uint64_t Transactions;  // Writes that reached the device.
+        uint64_t Redundant;     // Writes skipped because the value was already set.
+        uint64_t Coalesced;     // Queued writes replaced by a later one before the flush.
+        double TotalSeconds;    // Time spent in the transactions.
+        double MaxSeconds;
+    };
+
+    class CCameraParameterCache
+    {
+    public:
+        CCameraParameterCache()
+        {
+        }
+
+        // Writes the value at once unless it is already set. Pending queued writes of the parameter are dropped.
+        // Returns true if the device was written.
+        template <typename ParameterT, typename ValueT>
+        bool Write( const char* name, ParameterT& parameter, ValueT value)
+        {
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                SEntry& entry = m_entries[name];
+                ++entry.Statistics.Requests;
+                RemovePending( name);
+                if (entry.IsKnown && entry.Value == static_cast<double>(value))
+                {
+                    ++entry.Statistics.Redundant;
+                    return false;
+                }
+            }
+            SetValue( name, parameter, value);
+            return true;
+        }
+
+        // Queues the value for the next Flush(), replacing a value queued before.
+        template <typename ParameterT, typename ValueT>
+        void Queue( const char* name, ParameterT& parameter, ValueT value)
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            SEntry& entry = m_entries[name];
+            ++entry.Statistics.Requests;
+            for (size_t i = 0; i < m_pending.size(); ++i)
+            {
+                if (m_pending[i].Name == name)
+                {
+                    ++entry.Statistics.Coalesced;
+                    m_pending[i].Value = static_cast<double>(value);
+                    m_pending[i].Write = MakeWrite( name, parameter, value);
+                    return;
+                }
+            }
+            SPendingWrite pending;
+            pending.Name = name;
+            pending.Value = static_cast<double>(value);
+            pending.Write = MakeWrite( name, parameter, value);
+            m_pending.push_back( pending);
+        }
+
+        bool HasPending() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return !m_pending.empty();
+        }
+
+        // Applies the queued writes that change a value. Returns the number of transactions.
+        size_t Flush()
+        {
+            std::vector<SPendingWrite> pending;
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                pending.swap( m_pending);
+            }
+
+            size_t transactionCount = 0;
+            for (size_t i = 0; i < pending.size(); ++i)
+            {
+                {
+                    std::lock_guard<std::mutex> lock( m_lock);
+                    const SEntry& entry = m_entries[pending[i].Name];
+                    if (entry.IsKnown && entry.Value == pending[i].Value)
+                    {
+                        ++m_entries[pending[i].Name].Statistics.Redundant;
+                        continue;
+                    }
+                }
+                try
+                {
+                    pending[i].Write();
+                }
+                catch (...)
+                {
+                    Requeue( pending, i + 1);
+                    throw;
+                }
+                ++transactionCount;
+            }
+            return transactionCount;
+        }
+
+        // Forgets the cached values, the next write of every parameter goes to the device.
+        void Invalidate()
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            for (std::map<std::string, SEntry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+            {
+                it->second.IsKnown = false;
+            }
+        }
+
+        // Returns the write statistics per parameter name.
+        std::map<std::string, SParameterWriteStatistics> GetStatistics() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            std::map<std::string, SParameterWriteStatistics> statistics;
+            for (std::map<std::string, SEntry>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+            {
+                statistics[it->first] = it->second.Statistics;
+            }
+            return statistics;
+        }
+
+    private:
+        CCameraParameterCache( const CCameraParameterCache&);
+        CCameraParameterCache& operator=( const CCameraParameterCache&);
+
+        struct SEntry
+        {
+            SEntry()
+                : IsKnown( false)
+                , Value( 0.0)
+            {
+            }
+
+            bool IsKnown;
+            double Value;
+            SParameterWriteStatistics Statistics;
+        };
+
+        struct SPendingWrite
+        {
+            std::string Name;
+            double Value;
+            std::function<void()> Write;
+        };
+
+        template <typename ParameterT, typename ValueT>
+        std::function<void()> MakeWrite( const char* name, ParameterT& parameter, ValueT value)
+        {
+            const std::string nameCopy( name);
+            ParameterT* pParameter = &parameter;
+            return [this, nameCopy, pParameter, value]() { SetValue( nameCopy.c_str(), *pParameter, value); };
+        }
+
+        // Puts the writes from first on back in front of the queue, unless the parameter was queued again meanwhile.
+        void Requeue( const std::vector<SPendingWrite>& pending, size_t first)
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            std::vector<SPendingWrite> requeued;
+            for (size_t i = first; i < pending.size(); ++i)
+            {
+                bool isQueued = false;
+                for (size_t j = 0; j < m_pending.size() && !isQueued; ++j)
+                {
+                    isQueued = m_pending[j].Name == pending[i].Name;
+                }
+                if (!isQueued)
+                {
+                    requeued.push_back( pending[i]);
+                }
+            }
+            m_pending.insert( m_pending.begin(), requeued.begin(), requeued.end());
+        }
+
+        // Writes to the device and records the value and the time taken. A failed write leaves the value unknown.
+        template <typename ParameterT, typename ValueT>
+        void SetValue( const char* name, ParameterT& parameter, ValueT value)
+        {
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                m_entries[name].IsKnown = false;
+            }
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            parameter.SetValue( value);
+            const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+
+            std::lock_guard<std::mutex> lock( m_lock);
+            SEntry& entry = m_entries[name];
+            entry.IsKnown = true;
+            entry.Value = static_cast<double>(value);
+            ++entry.Statistics.Transactions;
+            entry.Statistics.TotalSeconds += seconds;
+            entry.Statistics.MaxSeconds = std::max( entry.Statistics.MaxSeconds, seconds);
+        }
+
+        void RemovePending( const std::string& name)
+        {
+            for (size_t i = 0; i < m_pending.size(); ++i)
+            {
+                if (m_pending[i].Name == name)
+                {
+                    m_pending.erase( m_pending.begin() + i);
+                    return;
+                }
+            }
+        }
+
+        mutable std::mutex m_lock;
+        std::map<std::string, SEntry> m_entries;
+        std::vector<SPendingWrite> m_pending;
+    };
+
+    // Calls function( i) for i in [0, count), each on its own thread if count is larger than 1.
+    // An exception of a call is passed on to the caller after all threads finished.
+    inline void RunInParallel( size_t count, const std::function<void( size_t)>& function)
+    {
+        if (count == 1)
+        {
+            function( 0);
+            return;
+        }
+
+        std::vector<std::exception_ptr> errors( count);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < count; ++i)
+        {
+            threads.push_back( std::thread( [&function, &errors, i]()
+            {
+                try
+                {
+                    function( i);
+                }
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+            }));
+        }
+        for (size_t i = 0; i < threads.size(); ++i)
+        {
+            threads[i].join();
+        }
+        for (size_t i = 0; i < errors.size(); ++i)
+        {
+            if (errors[i])
+            {
+                std::rethrow_exception( errors[i]);
+            }
+        }
+    }
+
+    // Flushes the caches of several cameras in parallel. Returns the number of transactions.
+    inline size_t FlushParameterCaches( std::vector<CCameraParameterCache*>& caches)
+    {
+        std::vector<CCameraParameterCache*> pending;
+        for (size_t i = 0; i < caches.size(); ++i)
+        {
+            if (caches[i]->HasPending())
+            {
+                pending.push_back( caches[i]);
+            }
+        }
+
+        std::vector<size_t> transactionCounts( pending.size(), 0);
+        RunInParallel( pending.size(), [&pending, &transactionCounts]( size_t i) { transactionCounts[i] = pending[i]->Flush(); });
+
+        size_t transactionCount = 0;
+        for (size_t i = 0; i < transactionCounts.size(); ++i)
+        {
+            transactionCount += transactionCounts[i];
+        }
+        return transactionCount;
+    }
+}
+
+#endif /* INCLUDED_CAMERAPARAMETERCACHE_H_4471926 */
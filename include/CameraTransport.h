@@ -0,0 +1,46 @@
+// Contains the selection of the camera types of a transport.
+/*
+   A sample defines USE_USB, USE_GIGE or USE_1394 before including this file and gets the camera types
+   of that transport:
+       Camera_t, CameraArray_t, ImageEventHandler_t, GrabResultPtr_t
+   and the parameter enumerations of the transport, e.g. PixelFormat_Mono12. Code written with these
+   types and the node access of CameraNodeAccess.h compiles for every transport.
+*/
+
+#ifndef INCLUDED_CAMERATRANSPORT_H_2914736
+#define INCLUDED_CAMERATRANSPORT_H_2914736
+
+#include <pylon/PylonIncludes.h>
+
+#if defined( USE_1394 )
+// Settings to use Basler IEEE 1394 cameras.
+#include <pylon/1394/Basler1394InstantCamera.h>
+#include <pylon/1394/Basler1394InstantCameraArray.h>
+typedef Pylon::CBasler1394InstantCamera Camera_t;
+typedef Pylon::CBasler1394InstantCameraArray CameraArray_t;
+typedef Camera_t::ImageEventHandler_t ImageEventHandler_t;
+typedef Camera_t::GrabResultPtr_t GrabResultPtr_t;
+using namespace Basler_IIDC1394CameraParams;
+#elif defined( USE_GIGE )
+// Settings to use Basler GigE cameras.
+#include <pylon/gige/BaslerGigEInstantCamera.h>
+#include <pylon/gige/BaslerGigEInstantCameraArray.h>
+typedef Pylon::CBaslerGigEInstantCamera Camera_t;
+typedef Pylon::CBaslerGigEInstantCameraArray CameraArray_t;
+typedef Camera_t::ImageEventHandler_t ImageEventHandler_t;
+typedef Camera_t::GrabResultPtr_t GrabResultPtr_t;
+using namespace Basler_GigECameraParams;
+#elif defined( USE_USB )
+// Settings to use Basler USB cameras.
+#include <pylon/usb/BaslerUsbInstantCamera.h>
+#include <pylon/usb/BaslerUsbInstantCameraArray.h>
+typedef Pylon::CBaslerUsbInstantCamera Camera_t;
+typedef Pylon::CBaslerUsbInstantCameraArray CameraArray_t;
+typedef Camera_t::ImageEventHandler_t ImageEventHandler_t;
+typedef Camera_t::GrabResultPtr_t GrabResultPtr_t;
+using namespace Basler_UsbCameraParams;
+#else
+#error camera type is not specified. For example, define USE_GIGE for using GigE cameras
+#endif
+
+#endif /* INCLUDED_CAMERATRANSPORT_H_2914736 */
@@ -0,0 +1,160 @@
+// Contains the start synchronization and the skew statistics of cameras capturing concurrently.
+/*
+   Cameras capturing one after the other are neither fast nor simultaneous. When every camera has its own
+   grab thread, their start is synchronized in one of two ways:
+       barrier   every thread configures its camera and waits at a CStartBarrier, then all start grabbing
+                 free-running at once. The cameras are as close as their start latencies and frame phases allow.
+       trigger   the cameras are configured for software triggering and start grabbing first, then one
+                 thread triggers every frame on all cameras in turn, waiting until all of them are ready.
+                 The frames of one trigger round form a set, apart by the time of a trigger write per camera.
+   The mode is selected on the command line with -concurrent sequential|barrier|trigger.
+
+   GetCaptureSkew() compares the times of the frames of all cameras with the same index, host arrival
+   times or trigger times in seconds. The skew of a frame set is the time between its first and its last
+   frame. A camera that lost a frame shifts its later frames by one set, which shows as a skew of about
+   a frame period.
+*/
+
+#ifndef INCLUDED_CONCURRENTCAPTURE_H_7390214
+#define INCLUDED_CONCURRENTCAPTURE_H_7390214
+
+#include <pylon/PylonIncludes.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace Pylon
+{
+    enum ECaptureSync
+    {
+        CaptureSync_Sequential,         // One camera after the other.
+        CaptureSync_Barrier,
+        CaptureSync_SoftwareTrigger
+    };
+
+    inline ECaptureSync GetCaptureSync( const char* name)
+    {
+        if (strcmp( name, "sequential") == 0)
+        {
+            return CaptureSync_Sequential;
+        }
+        if (strcmp( name, "barrier") == 0)
+        {
+            return CaptureSync_Barrier;
+        }
+        if (strcmp( name, "trigger") == 0)
+        {
+            return CaptureSync_SoftwareTrigger;
+        }
+        throw RUNTIME_EXCEPTION( "Unknown capture synchronization %s. Use sequential, barrier or trigger.", name);
+    }
+
+    // Releases the waiting threads together when the last of them arrived.
+    class CStartBarrier
+    {
+    public:
+        explicit CStartBarrier( size_t count)
+            : m_count( count)
+            , m_arrived( 0)
+            , m_isCancelled( false)
+        {
+        }
+
+        // Blocks until all threads arrived. Returns false if the barrier was cancelled.
+        bool Wait()
+        {
+            std::unique_lock<std::mutex> lock( m_lock);
+            if (++m_arrived >= m_count)
+            {
+                m_condition.notify_all();
+            }
+            m_condition.wait( lock, [this]() { return m_arrived >= m_count || m_isCancelled; });
+            return !m_isCancelled;
+        }
+
+        // Releases the waiting threads without the missing ones, e.g. when a camera failed to start.
+        void Cancel()
+        {
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                m_isCancelled = true;
+            }
+            m_condition.notify_all();
+        }
+
+        bool IsCancelled() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_isCancelled;
+        }
+
+    private:
+        CStartBarrier( const CStartBarrier&);
+        CStartBarrier& operator=( const CStartBarrier&);
+
+        mutable std::mutex m_lock;
+        std::condition_variable m_condition;
+        const size_t m_count;
+        size_t m_arrived;
+        bool m_isCancelled;
+    };
+
+    struct SCaptureSkew
+    {
+        SCaptureSkew()
+            : FrameSetCount( 0)
+            , FirstSkew( 0.0)
+            , MeanSkew( 0.0)
+            , MaxSkew( 0.0)
+        {
+        }
+
+        size_t FrameSetCount;       // Frame indices all cameras delivered.
+        double FirstSkew;           // Skews in seconds, of the first set,
+        double MeanSkew;            // the mean over the sets
+        double MaxSkew;             // and the largest.
+    };
+
+    // Computes the skew of the frame sets from the times of the frames of each camera, in the order of the frames.
+    inline SCaptureSkew GetCaptureSkew( const std::vector< std::vector<double> >& times)
+    {
+        SCaptureSkew skew;
+        if (times.size() < 2)
+        {
+            return skew;
+        }
+
+        skew.FrameSetCount = times[0].size();
+        for (size_t camera = 1; camera < times.size(); ++camera)
+        {
+            skew.FrameSetCount = std::min( skew.FrameSetCount, times[camera].size());
+        }
+        for (size_t frame = 0; frame < skew.FrameSetCount; ++frame)
+        {
+            double first = times[0][frame];
+            double last = first;
+            for (size_t camera = 1; camera < times.size(); ++camera)
+            {
+                first = std::min( first, times[camera][frame]);
+                last = std::max( last, times[camera][frame]);
+            }
+            if (frame == 0)
+            {
+                skew.FirstSkew = last - first;
+            }
+            skew.MeanSkew += last - first;
+            skew.MaxSkew = std::max( skew.MaxSkew, last - first);
+        }
+        if (skew.FrameSetCount != 0)
+        {
+            skew.MeanSkew /= skew.FrameSetCount;
+        }
+        return skew;
+    }
+}
+
+#endif /* INCLUDED_CONCURRENTCAPTURE_H_7390214 */
@@ -0,0 +1,544 @@
+// Contains an append-only columnar log of the metadata of the frames of a camera and a mapped reader of it.
+/*
+   The frames of a camera stored during a run were only described by their file names, the AOI, a
+   counter and an index, and by the times of the last burst. CFrameMetadataWriter appends one record
+   per frame to a sidecar file per camera:
+
+       host time           ns since 1970 (system clock) when the frame arrived, the key of the queries
+       camera time         the Timestamp chunk, 0 without it
+       frame counter       the block ID of the grab result
+       exposure, gain      as set, in us and dB
+       chunk exposure      the ExposureTime and Gain chunks, NaN when the camera does not deliver them
+       chunk gain
+       burst, index        the burst and the index of the frame in it, as in the file names
+       CRC status          of the payload CRC chunk, see EFrameCrcStatus
+
+   The serial number of the camera is stored once in the file header. The records are kept in blocks of
+   c_frameMetadataBlockCapacity records, column by column, so a query reads only the columns it needs.
+   A block is written when it is full or on Flush(), the last block being rewritten until it is full.
+   Opening an existing log of the same camera appends to it. The host times of a log never decrease, a
+   record with an earlier time, e.g. after the clock was set back, gets the time of the previous record.
+
+   CFrameMetadataReader maps a log into memory. FindFrames() returns the records between two host times
+   with a binary search over the blocks and then over the host times of one block, without reading the
+   other records:
+
+       CFrameMetadataReader log( "Burst-21234567.meta");
+       size_t first = 0, last = 0;
+       log.FindFrames( t0, t1, first, last);
+       for (size_t i = first; i < last; ++i) ... log.GetRecord( i) ...
+
+   File layout, little endian:
+       SFrameMetadataFileHeader
+       blocks of GetFrameMetadataBlockSize() bytes: SFrameMetadataBlockHeader, then the columns of
+       c_frameMetadataBlockCapacity values each, in the order of SFrameMetadata
+*/
+
+#ifndef INCLUDED_FRAMEMETADATALOG_H_7390264
+#define INCLUDED_FRAMEMETADATALOG_H_7390264
+
+#include <pylon/PylonIncludes.h>
+#include "FrameReplayReader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace Pylon
+{
+    enum EFrameCrcStatus
+    {
+        FrameCrcStatus_None,        // No payload CRC chunk.
+        FrameCrcStatus_Ok,
+        FrameCrcStatus_Failed
+    };
+
+    // The metadata of a frame, a record of the log.
+    struct SFrameMetadata
+    {
+        SFrameMetadata()
+            : HostTime( 0)
+            , CameraTime( 0)
+            , FrameCounter( 0)
+            , ExposureTime( 0.0)
+            , Gain( 0.0)
+            , ChunkExposureTime( std::numeric_limits<double>::quiet_NaN())
+            , ChunkGain( std::numeric_limits<double>::quiet_NaN())
+            , Burst( 0)
+            , FrameIndex( 0)
+            , CrcStatus( FrameCrcStatus_None)
+        {
+        }
+
+        int64_t HostTime;
+        int64_t CameraTime;
+        uint64_t FrameCounter;
+        double ExposureTime;
+        double Gain;
+        double ChunkExposureTime;
+        double ChunkGain;
+        uint32_t Burst;
+        uint32_t FrameIndex;
+        EFrameCrcStatus CrcStatus;
+    };
+
+    // The host time of the metadata in ns since 1970.
+    inline int64_t GetFrameMetadataTimeNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // The CRC status of a grab result, for camera and synthetic grab results.
+    template <typename GrabResultPtrT>
+    EFrameCrcStatus GetFrameCrcStatus( const GrabResultPtrT& ptrGrabResult)
+    {
+        if (!ptrGrabResult->HasCRC())
+        {
+            return FrameCrcStatus_None;
+        }
+        return ptrGrabResult->CheckCRC() ? FrameCrcStatus_Ok : FrameCrcStatus_Failed;
+    }
+
+    struct SFrameMetadataFileHeader
+    {
+        char Magic[8];              // "PYMETA\0\0"
+        uint32_t Version;
+        uint32_t HeaderSize;
+        uint32_t BlockCapacity;
+        uint32_t BlockSize;
+        char SerialNumber[32];
+        uint64_t Reserved[4];
+    };
+
+    struct SFrameMetadataBlockHeader
+    {
+        uint32_t Count;
+        uint32_t Reserved0;
+        int64_t FirstHostTime;
+        int64_t LastHostTime;
+        uint64_t Reserved;
+    };
+
+    static const uint32_t c_frameMetadataVersion = 1;
+    // Records per block, 65 kB.
+    static const size_t c_frameMetadataBlockCapacity = 1024;
+
+    namespace FrameMetadataDetail
+    {
+        // The offsets of the columns in a block.
+        static const size_t c_hostTimeOffset = sizeof( SFrameMetadataBlockHeader);
+        static const size_t c_cameraTimeOffset = c_hostTimeOffset + sizeof( int64_t) * c_frameMetadataBlockCapacity;
+        static const size_t c_frameCounterOffset = c_cameraTimeOffset + sizeof( int64_t) * c_frameMetadataBlockCapacity;
+        static const size_t c_exposureTimeOffset = c_frameCounterOffset + sizeof( uint64_t) * c_frameMetadataBlockCapacity;
+        static const size_t c_gainOffset = c_exposureTimeOffset + sizeof( double) * c_frameMetadataBlockCapacity;
+        static const size_t c_chunkExposureTimeOffset = c_gainOffset + sizeof( double) * c_frameMetadataBlockCapacity;
+        static const size_t c_chunkGainOffset = c_chunkExposureTimeOffset + sizeof( double) * c_frameMetadataBlockCapacity;
+        static const size_t c_burstOffset = c_chunkGainOffset + sizeof( double) * c_frameMetadataBlockCapacity;
+        static const size_t c_frameIndexOffset = c_burstOffset + sizeof( uint32_t) * c_frameMetadataBlockCapacity;
+        static const size_t c_crcStatusOffset = c_frameIndexOffset + sizeof( uint32_t) * c_frameMetadataBlockCapacity;
+        static const size_t c_blockSize = c_crcStatusOffset + sizeof( uint8_t) * c_frameMetadataBlockCapacity;
+
+        template <typename T>
+        T* GetColumn( uint8_t* pBlock, size_t offset)
+        {
+            return reinterpret_cast<T*>(pBlock + offset);
+        }
+
+        template <typename T>
+        const T* GetColumn( const uint8_t* pBlock, size_t offset)
+        {
+            return reinterpret_cast<const T*>(pBlock + offset);
+        }
+
+        inline bool Seek( FILE* pFile, uint64_t offset)
+        {
+#if defined(_WIN32)
+            return _fseeki64( pFile, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+            return fseeko( pFile, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+        }
+
+        inline uint64_t GetFileSize( FILE* pFile)
+        {
+#if defined(_WIN32)
+            return _fseeki64( pFile, 0, SEEK_END) == 0 ? static_cast<uint64_t>(_ftelli64( pFile)) : 0;
+#else
+            return fseeko( pFile, 0, SEEK_END) == 0 ? static_cast<uint64_t>(ftello( pFile)) : 0;
+#endif
+        }
+
+        inline SFrameMetadata GetRecord( const uint8_t* pBlock, size_t slot)
+        {
+            SFrameMetadata record;
+            record.HostTime = GetColumn<int64_t>( pBlock, c_hostTimeOffset)[slot];
+            record.CameraTime = GetColumn<int64_t>( pBlock, c_cameraTimeOffset)[slot];
+            record.FrameCounter = GetColumn<uint64_t>( pBlock, c_frameCounterOffset)[slot];
+            record.ExposureTime = GetColumn<double>( pBlock, c_exposureTimeOffset)[slot];
+            record.Gain = GetColumn<double>( pBlock, c_gainOffset)[slot];
+            record.ChunkExposureTime = GetColumn<double>( pBlock, c_chunkExposureTimeOffset)[slot];
+            record.ChunkGain = GetColumn<double>( pBlock, c_chunkGainOffset)[slot];
+            record.Burst = GetColumn<uint32_t>( pBlock, c_burstOffset)[slot];
+            record.FrameIndex = GetColumn<uint32_t>( pBlock, c_frameIndexOffset)[slot];
+            record.CrcStatus = static_cast<EFrameCrcStatus>(GetColumn<uint8_t>( pBlock, c_crcStatusOffset)[slot]);
+            return record;
+        }
+    }
+
+    inline size_t GetFrameMetadataBlockSize()
+    {
+        return FrameMetadataDetail::c_blockSize;
+    }
+
+    // Appends the records of the frames of one camera to a log. Append() is called by one thread at a time.
+    class CFrameMetadataWriter
+    {
+    public:
+        CFrameMetadataWriter()
+            : m_pFile( NULL)
+            , m_block( FrameMetadataDetail::c_blockSize, 0)
+            , m_blockIndex( 0)
+            , m_recordCount( 0)
+            , m_lastHostTime( 0)
+            , m_isDirty( false)
+        {
+        }
+
+        ~CFrameMetadataWriter()
+        {
+            try
+            {
+                Close();
+            }
+            catch (const GenICam::GenericException&)
+            {
+            }
+        }
+
+        // Opens the log of a camera, appending to it if it exists.
+        void Open( const std::string& fileName, const std::string& serialNumber)
+        {
+            Close();
+            using namespace FrameMetadataDetail;
+            m_fileName = fileName;
+            std::fill( m_block.begin(), m_block.end(), 0);
+            m_blockIndex = 0;
+            m_recordCount = 0;
+            m_lastHostTime = 0;
+            m_isDirty = false;
+
+            SFrameMetadataFileHeader header;
+            m_pFile = fopen( fileName.c_str(), "r+b");
+            if (m_pFile != NULL && fread( &header, sizeof( header), 1, m_pFile) == 1)
+            {
+                if (memcmp( header.Magic, "PYMETA", 7) != 0 || header.Version != c_frameMetadataVersion || header.HeaderSize != sizeof( header)
+                    || header.BlockCapacity != c_frameMetadataBlockCapacity || header.BlockSize != c_blockSize)
+                {
+                    Abort( "The file %s is no frame metadata log of this version.");
+                }
+                if (serialNumber.compare( 0, sizeof( header.SerialNumber) - 1, header.SerialNumber) != 0)
+                {
+                    Abort( "The frame metadata log %s is the one of another camera.");
+                }
+                // Full blocks stay as they are, a partial last block is read to be continued.
+                const size_t blockCount = static_cast<size_t>((GetFileSize( m_pFile) - sizeof( header)) / c_blockSize);
+                if (blockCount != 0)
+                {
+                    if (!Seek( m_pFile, sizeof( header) + static_cast<uint64_t>(blockCount - 1) * c_blockSize) || fread( &m_block[0], c_blockSize, 1, m_pFile) != 1)
+                    {
+                        Abort( "Could not read the frame metadata log %s.");
+                    }
+                    m_blockIndex = blockCount - 1;
+                    m_recordCount = m_blockIndex * c_frameMetadataBlockCapacity + GetBlockHeader().Count;
+                    if (GetBlockHeader().Count == c_frameMetadataBlockCapacity)
+                    {
+                        StartBlock( m_blockIndex + 1);
+                    }
+                }
+                return;
+            }
+
+            if (m_pFile != NULL)
+            {
+                fclose( m_pFile);
+            }
+            m_pFile = fopen( fileName.c_str(), "w+b");
+            if (m_pFile == NULL)
+            {
+                throw RUNTIME_EXCEPTION( "Could not create the frame metadata log %s.", fileName.c_str());
+            }
+            memset( &header, 0, sizeof( header));
+            memcpy( header.Magic, "PYMETA", 7);
+            header.Version = c_frameMetadataVersion;
+            header.HeaderSize = sizeof( header);
+            header.BlockCapacity = c_frameMetadataBlockCapacity;
+            header.BlockSize = static_cast<uint32_t>(c_blockSize);
+            strncpy( header.SerialNumber, serialNumber.c_str(), sizeof( header.SerialNumber) - 1);
+            if (fwrite( &header, sizeof( header), 1, m_pFile) != 1)
+            {
+                Abort( "Could not write the frame metadata log %s.");
+            }
+        }
+
+        bool IsOpen() const
+        {
+            return m_pFile != NULL;
+        }
+
+        void Append( const SFrameMetadata& metadata)
+        {
+            using namespace FrameMetadataDetail;
+            SFrameMetadataBlockHeader& blockHeader = GetBlockHeader();
+            const size_t slot = blockHeader.Count;
+            const int64_t lastHostTime = slot != 0 ? blockHeader.LastHostTime : m_lastHostTime;
+            const int64_t hostTime = m_recordCount != 0 ? std::max( metadata.HostTime, lastHostTime) : metadata.HostTime;
+
+            uint8_t* pBlock = &m_block[0];
+            GetColumn<int64_t>( pBlock, c_hostTimeOffset)[slot] = hostTime;
+            GetColumn<int64_t>( pBlock, c_cameraTimeOffset)[slot] = metadata.CameraTime;
+            GetColumn<uint64_t>( pBlock, c_frameCounterOffset)[slot] = metadata.FrameCounter;
+            GetColumn<double>( pBlock, c_exposureTimeOffset)[slot] = metadata.ExposureTime;
+            GetColumn<double>( pBlock, c_gainOffset)[slot] = metadata.Gain;
+            GetColumn<double>( pBlock, c_chunkExposureTimeOffset)[slot] = metadata.ChunkExposureTime;
+            GetColumn<double>( pBlock, c_chunkGainOffset)[slot] = metadata.ChunkGain;
+            GetColumn<uint32_t>( pBlock, c_burstOffset)[slot] = metadata.Burst;
+            GetColumn<uint32_t>( pBlock, c_frameIndexOffset)[slot] = metadata.FrameIndex;
+            GetColumn<uint8_t>( pBlock, c_crcStatusOffset)[slot] = static_cast<uint8_t>(metadata.CrcStatus);
+            if (slot == 0)
+            {
+                blockHeader.FirstHostTime = hostTime;
+            }
+            blockHeader.LastHostTime = hostTime;
+            blockHeader.Count += 1;
+            m_recordCount += 1;
+            m_isDirty = true;
+
+            if (blockHeader.Count == c_frameMetadataBlockCapacity)
+            {
+                WriteBlock();
+                StartBlock( m_blockIndex + 1);
+            }
+        }
+
+        // Writes the records not yet written.
+        void Flush()
+        {
+            if (m_pFile == NULL)
+            {
+                return;
+            }
+            if (m_isDirty)
+            {
+                WriteBlock();
+            }
+            if (fflush( m_pFile) != 0)
+            {
+                throw RUNTIME_EXCEPTION( "Could not write the frame metadata log %s.", m_fileName.c_str());
+            }
+        }
+
+        void Close()
+        {
+            if (m_pFile == NULL)
+            {
+                return;
+            }
+            const bool isWritten = !m_isDirty || WriteBlock( false);
+            if (fclose( m_pFile) != 0 || !isWritten)
+            {
+                m_pFile = NULL;
+                throw RUNTIME_EXCEPTION( "Could not write the frame metadata log %s.", m_fileName.c_str());
+            }
+            m_pFile = NULL;
+        }
+
+        size_t GetRecordCount() const
+        {
+            return m_recordCount;
+        }
+
+        const std::string& GetFileName() const
+        {
+            return m_fileName;
+        }
+
+    private:
+        CFrameMetadataWriter( const CFrameMetadataWriter&);
+        CFrameMetadataWriter& operator=( const CFrameMetadataWriter&);
+
+        SFrameMetadataBlockHeader& GetBlockHeader()
+        {
+            return *reinterpret_cast<SFrameMetadataBlockHeader*>(&m_block[0]);
+        }
+
+        void StartBlock( size_t blockIndex)
+        {
+            m_lastHostTime = GetBlockHeader().LastHostTime;
+            std::fill( m_block.begin(), m_block.end(), 0);
+            m_blockIndex = blockIndex;
+        }
+
+        // Writes the current block at its place in the file.
+        bool WriteBlock( bool throwOnError = true)
+        {
+            const bool isWritten = FrameMetadataDetail::Seek( m_pFile, sizeof( SFrameMetadataFileHeader) + static_cast<uint64_t>(m_blockIndex) * m_block.size())
+                && fwrite( &m_block[0], m_block.size(), 1, m_pFile) == 1;
+            m_isDirty = !isWritten;
+            if (!isWritten && throwOnError)
+            {
+                throw RUNTIME_EXCEPTION( "Could not write the frame metadata log %s.", m_fileName.c_str());
+            }
+            return isWritten;
+        }
+
+        // Closes the file and throws message, its %s replaced by the file name.
+        void Abort( const char* message)
+        {
+            fclose( m_pFile);
+            m_pFile = NULL;
+            std::string text( message);
+            text.replace( text.find( "%s"), 2, m_fileName);
+            throw RUNTIME_EXCEPTION( "%s", text.c_str());
+        }
+
+        std::string m_fileName;
+        FILE* m_pFile;
+        std::vector<uint8_t> m_block;
+        size_t m_blockIndex;
+        size_t m_recordCount;
+        int64_t m_lastHostTime;
+        bool m_isDirty;
+    };
+
+    // Maps a frame metadata log into memory to query it.
+    class CFrameMetadataReader
+    {
+    public:
+        CFrameMetadataReader()
+            : m_blockCount( 0)
+            , m_recordCount( 0)
+        {
+        }
+
+        explicit CFrameMetadataReader( const std::string& fileName)
+            : m_blockCount( 0)
+            , m_recordCount( 0)
+        {
+            Open( fileName);
+        }
+
+        void Open( const std::string& fileName)
+        {
+            m_file.Open( fileName);
+            m_blockCount = 0;
+            m_recordCount = 0;
+            const SFrameMetadataFileHeader* pHeader = reinterpret_cast<const SFrameMetadataFileHeader*>(m_file.GetData());
+            if (m_file.GetSize() < sizeof( SFrameMetadataFileHeader) || memcmp( pHeader->Magic, "PYMETA", 7) != 0
+                || pHeader->Version != c_frameMetadataVersion || pHeader->BlockCapacity != c_frameMetadataBlockCapacity
+                || pHeader->BlockSize != FrameMetadataDetail::c_blockSize)
+            {
+                m_file.Close();
+                throw RUNTIME_EXCEPTION( "The file %s is no frame metadata log of this version.", fileName.c_str());
+            }
+            m_serialNumber.assign( pHeader->SerialNumber, strnlen( pHeader->SerialNumber, sizeof( pHeader->SerialNumber)));
+            m_blockCount = (m_file.GetSize() - pHeader->HeaderSize) / FrameMetadataDetail::c_blockSize;
+            if (m_blockCount != 0)
+            {
+                m_recordCount = (m_blockCount - 1) * c_frameMetadataBlockCapacity + GetBlockHeader( m_blockCount - 1).Count;
+            }
+        }
+
+        void Close()
+        {
+            m_file.Close();
+            m_blockCount = 0;
+            m_recordCount = 0;
+        }
+
+        size_t GetRecordCount() const
+        {
+            return m_recordCount;
+        }
+
+        const std::string& GetSerialNumber() const
+        {
+            return m_serialNumber;
+        }
+
+        SFrameMetadata GetRecord( size_t index) const
+        {
+            return FrameMetadataDetail::GetRecord( GetBlock( index / c_frameMetadataBlockCapacity), index % c_frameMetadataBlockCapacity);
+        }
+
+        int64_t GetHostTime( size_t index) const
+        {
+            return GetHostTimes( index / c_frameMetadataBlockCapacity)[index % c_frameMetadataBlockCapacity];
+        }
+
+        // Returns the records [first, last) with host times in [startTime, endTime].
+        void FindFrames( int64_t startTime, int64_t endTime, size_t& first, size_t& last) const
+        {
+            first = LowerBound( startTime, false);
+            last = std::max( first, LowerBound( endTime, true));
+        }
+
+    private:
+        CFrameMetadataReader( const CFrameMetadataReader&);
+        CFrameMetadataReader& operator=( const CFrameMetadataReader&);
+
+        const uint8_t* GetBlock( size_t block) const
+        {
+            return m_file.GetData() + sizeof( SFrameMetadataFileHeader) + block * FrameMetadataDetail::c_blockSize;
+        }
+
+        const SFrameMetadataBlockHeader& GetBlockHeader( size_t block) const
+        {
+            return *reinterpret_cast<const SFrameMetadataBlockHeader*>(GetBlock( block));
+        }
+
+        const int64_t* GetHostTimes( size_t block) const
+        {
+            return FrameMetadataDetail::GetColumn<int64_t>( GetBlock( block), FrameMetadataDetail::c_hostTimeOffset);
+        }
+
+        // The first record with a host time >= time, or > time if isAfter.
+        size_t LowerBound( int64_t time, bool isAfter) const
+        {
+            // The first block whose last time is not before the time, the records of the blocks before it are.
+            size_t low = 0;
+            size_t high = m_blockCount;
+            while (low < high)
+            {
+                const size_t middle = low + (high - low) / 2;
+                const int64_t lastHostTime = GetBlockHeader( middle).LastHostTime;
+                if (isAfter ? lastHostTime <= time : lastHostTime < time)
+                {
+                    low = middle + 1;
+                }
+                else
+                {
+                    high = middle;
+                }
+            }
+            if (low == m_blockCount)
+            {
+                return m_recordCount;
+            }
+            const int64_t* pBegin = GetHostTimes( low);
+            const int64_t* pEnd = pBegin + GetBlockHeader( low).Count;
+            const int64_t* pFound = isAfter ? std::upper_bound( pBegin, pEnd, time) : std::lower_bound( pBegin, pEnd, time);
+            return low * c_frameMetadataBlockCapacity + (pFound - pBegin);
+        }
+
+        CMappedFile m_file;
+        std::string m_serialNumber;
+        size_t m_blockCount;
+        size_t m_recordCount;
+    };
+}
+
+#endif /* INCLUDED_FRAMEMETADATALOG_H_7390264 */
@@ -0,0 +1,397 @@
+// Contains a reader for recorded frames used by the replay of the synthetic frame source.
+/*
+   The reader maps frame containers written by CFrameContainerWriter (see FrameStorage.h) or .raw files
+   as written by the samples into memory. The frames are not copied when the files are opened, only an
+   index of the frames is built. Prefetch() asks the operating system to read ahead the next frames so
+   that a replay is limited by the processing of the frames and not by the disk.
+
+   Compressed frames (FrameEncoding_Lossless12) are decoded by ReadFrame().
+
+   .raw files hold no geometry. It is given by the caller or taken from the file name the samples use,
+   e.g. burst-BW-2592X1944-0-1-3.raw. Their time stamps are derived from the given frame rate.
+*/
+
+#ifndef INCLUDED_FRAMEREPLAYREADER_H_4482915
+#define INCLUDED_FRAMEREPLAYREADER_H_4482915
+
+#include <pylon/PylonIncludes.h>
+#include "FrameStorage.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace Pylon
+{
+    // A file mapped read only into memory.
+    class CMappedFile
+    {
+    public:
+        CMappedFile()
+            : m_pData( NULL)
+            , m_size( 0)
+#if defined(_WIN32)
+            , m_hFile( INVALID_HANDLE_VALUE)
+            , m_hMapping( NULL)
+#endif
+        {
+        }
+
+        ~CMappedFile()
+        {
+            Close();
+        }
+
+        void Open( const std::string& fileName)
+        {
+            Close();
+#if defined(_WIN32)
+            // Files still being written, e.g. frame metadata logs, can be mapped as well.
+            m_hFile = CreateFileA( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+            LARGE_INTEGER size;
+            if (m_hFile == INVALID_HANDLE_VALUE || !GetFileSizeEx( m_hFile, &size))
+            {
+                Close();
+                throw RUNTIME_EXCEPTION( "Could not open the recorded file %s.", fileName.c_str());
+            }
+            m_size = static_cast<size_t>(size.QuadPart);
+            if (m_size != 0)
+            {
+                m_hMapping = CreateFileMappingA( m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+                m_pData = m_hMapping != NULL ? static_cast<const uint8_t*>(MapViewOfFile( m_hMapping, FILE_MAP_READ, 0, 0, 0)) : NULL;
+            }
+#else
+            const int file = open( fileName.c_str(), O_RDONLY);
+            struct stat info;
+            if (file < 0 || fstat( file, &info) != 0)
+            {
+                if (file >= 0)
+                {
+                    close( file);
+                }
+                throw RUNTIME_EXCEPTION( "Could not open the recorded file %s.", fileName.c_str());
+            }
+            m_size = static_cast<size_t>(info.st_size);
+            if (m_size != 0)
+            {
+                void* pData = mmap( NULL, m_size, PROT_READ, MAP_SHARED, file, 0);
+                m_pData = pData != MAP_FAILED ? static_cast<const uint8_t*>(pData) : NULL;
+                if (m_pData != NULL)
+                {
+                    madvise( pData, m_size, MADV_SEQUENTIAL);
+                }
+            }
+            // The mapping stays valid after the file is closed.
+            close( file);
+#endif
+            if (m_size != 0 && m_pData == NULL)
+            {
+                Close();
+                throw RUNTIME_EXCEPTION( "Could not map the recorded file %s.", fileName.c_str());
+            }
+        }
+
+        void Close()
+        {
+#if defined(_WIN32)
+            if (m_pData != NULL)
+            {
+                UnmapViewOfFile( m_pData);
+            }
+            if (m_hMapping != NULL)
+            {
+                CloseHandle( m_hMapping);
+            }
+            if (m_hFile != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle( m_hFile);
+            }
+            m_hMapping = NULL;
+            m_hFile = INVALID_HANDLE_VALUE;
+#else
+            if (m_pData != NULL)
+            {
+                munmap( const_cast<uint8_t*>(m_pData), m_size);
+            }
+#endif
+            m_pData = NULL;
+            m_size = 0;
+        }
+
+        const uint8_t* GetData() const
+        {
+            return m_pData;
+        }
+
+        size_t GetSize() const
+        {
+            return m_size;
+        }
+
+        // Asks the operating system to read the range in the background.
+        void Prefetch( size_t offset, size_t size) const
+        {
+            if (m_pData == NULL || offset >= m_size)
+            {
+                return;
+            }
+            size = std::min( size, m_size - offset);
+#if defined(_WIN32)
+            // PrefetchVirtualMemory is available from Windows 8 on.
+            typedef BOOL (WINAPI *PrefetchVirtualMemory_t)( HANDLE, ULONG_PTR, PWIN32_MEMORY_RANGE_ENTRY, ULONG);
+            static const PrefetchVirtualMemory_t pPrefetchVirtualMemory = reinterpret_cast<PrefetchVirtualMemory_t>(
+                GetProcAddress( GetModuleHandleA( "kernel32.dll"), "PrefetchVirtualMemory"));
+            if (pPrefetchVirtualMemory != NULL)
+            {
+                WIN32_MEMORY_RANGE_ENTRY range;
+                range.VirtualAddress = const_cast<uint8_t*>(m_pData + offset);
+                range.NumberOfBytes = size;
+                pPrefetchVirtualMemory( GetCurrentProcess(), 1, &range, 0);
+            }
+#else
+            const size_t pageSize = static_cast<size_t>(sysconf( _SC_PAGESIZE));
+            const size_t start = offset / pageSize * pageSize;
+            madvise( const_cast<uint8_t*>(m_pData + start), size + (offset - start), MADV_WILLNEED);
+#endif
+        }
+
+    private:
+        // Not copyable.
+        CMappedFile( const CMappedFile&);
+        CMappedFile& operator=( const CMappedFile&);
+
+        const uint8_t* m_pData;
+        size_t m_size;
+#if defined(_WIN32)
+        HANDLE m_hFile;
+        HANDLE m_hMapping;
+#endif
+    };
+
+
+    // Geometry of recorded .raw files.
+    struct SRawFileFormat
+    {
+        SRawFileFormat()
+            : Width( 0)
+            , Height( 0)
+            , PixelType( PixelType_Mono12)
+            , FrameRate( 14.0)
+        {
+        }
+
+        uint32_t Width;         // 0 takes the size from the file name.
+        uint32_t Height;
+        EPixelType PixelType;
+        double FrameRate;       // Used for the time stamps of the frames.
+    };
+
+    // Reads the image size from a file name like name-BW-2592X1944-0-1-3.raw. Returns false if there is none.
+    inline bool GetRawFileSizeFromName( const std::string& fileName, uint32_t& width, uint32_t& height)
+    {
+        for (size_t pos = fileName.find( '-'); pos != std::string::npos; pos = fileName.find( '-', pos + 1))
+        {
+            unsigned int w = 0;
+            unsigned int h = 0;
+            char separator = 0;
+            if (sscanf( fileName.c_str() + pos + 1, "%u%c%u", &w, &separator, &h) == 3 && (separator == 'X' || separator == 'x') && w != 0 && h != 0)
+            {
+                width = w;
+                height = h;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Provides random access to recorded frames.
+    class CFrameReplayReader
+    {
+    public:
+        CFrameReplayReader()
+        {
+        }
+
+        // Opens the files in the given order. Each file is either a frame container or a .raw file holding one or more frames.
+        void Open( const std::vector<std::string>& fileNames, const SRawFileFormat& rawFormat = SRawFileFormat())
+        {
+            m_files.clear();
+            m_frames.clear();
+
+            for (size_t f = 0; f < fileNames.size(); ++f)
+            {
+                m_files.push_back( std::unique_ptr<CMappedFile>( new CMappedFile));
+                CMappedFile& file = *m_files.back();
+                file.Open( fileNames[f]);
+
+                if (file.GetSize() >= sizeof( SFrameContainerFileHeader) && memcmp( file.GetData(), "PYFRAMES", 8) == 0)
+                {
+                    IndexContainer( f, fileNames[f]);
+                }
+                else
+                {
+                    IndexRawFile( f, fileNames[f], rawFormat);
+                }
+            }
+
+            if (m_frames.empty())
+            {
+                throw RUNTIME_EXCEPTION( "The recorded files contain no frames.");
+            }
+        }
+
+        size_t GetFrameCount() const
+        {
+            return m_frames.size();
+        }
+
+        // The record holds the geometry and the recorded time stamp of the frame.
+        const SFrameContainerRecord& GetRecord( size_t index) const
+        {
+            return m_frames[index].Record;
+        }
+
+        // Returns the stored payload, which is compressed if the record's encoding is not FrameEncoding_None.
+        const void* GetFrameData( size_t index) const
+        {
+            const SFrameIndex& frame = m_frames[index];
+            return m_files[frame.FileIndex]->GetData() + frame.Offset;
+        }
+
+        // Returns the size of the image after decoding.
+        size_t GetImageSize( size_t index) const
+        {
+            const SFrameContainerRecord& record = m_frames[index].Record;
+            if (record.Encoding == FrameEncoding_None)
+            {
+                return static_cast<size_t>(record.PayloadSize);
+            }
+            return static_cast<size_t>(record.Width) * record.Height * ((Pylon::BitPerPixel( static_cast<EPixelType>(record.PixelType)) + 7) / 8);
+        }
+
+        // Copies or decodes the image of a frame into a buffer of at least GetImageSize() bytes.
+        void ReadFrame( size_t index, void* pBuffer, size_t bufferSize) const
+        {
+            const SFrameContainerRecord& record = m_frames[index].Record;
+            const size_t imageSize = GetImageSize( index);
+            if (bufferSize < imageSize)
+            {
+                throw RUNTIME_EXCEPTION( "The buffer is too small for the recorded frame.");
+            }
+            switch (record.Encoding)
+            {
+            case FrameEncoding_None:
+                memcpy( pBuffer, GetFrameData( index), imageSize);
+                break;
+            case FrameEncoding_Lossless12:
+                DecodeLossless12( GetFrameData( index), static_cast<size_t>(record.PayloadSize), pBuffer, bufferSize);
+                break;
+            default:
+                throw RUNTIME_EXCEPTION( "The recorded frame has the unknown encoding %u.", record.Encoding);
+            }
+        }
+
+        // Reads ahead the frames [first, first + count).
+        void Prefetch( size_t first, size_t count) const
+        {
+            for (size_t i = first; i < std::min( first + count, m_frames.size()); ++i)
+            {
+                const SFrameIndex& frame = m_frames[i];
+                m_files[frame.FileIndex]->Prefetch( frame.Offset, static_cast<size_t>(frame.Record.PayloadSize));
+            }
+        }
+
+    private:
+        // Not copyable.
+        CFrameReplayReader( const CFrameReplayReader&);
+        CFrameReplayReader& operator=( const CFrameReplayReader&);
+
+        struct SFrameIndex
+        {
+            size_t FileIndex;
+            size_t Offset;
+            SFrameContainerRecord Record;
+        };
+
+        void IndexContainer( size_t fileIndex, const std::string& fileName)
+        {
+            const CMappedFile& file = *m_files[fileIndex];
+            SFrameContainerFileHeader header;
+            memcpy( &header, file.GetData(), sizeof( header));
+            if (header.Version != c_frameContainerVersion || header.RecordSize != sizeof( SFrameContainerRecord))
+            {
+                const std::string message = "The frame container " + fileName + " has an unsupported version.";
+                throw RUNTIME_EXCEPTION( "%s", message.c_str());
+            }
+
+            size_t offset = header.HeaderSize;
+            while (offset + sizeof( SFrameContainerRecord) <= file.GetSize())
+            {
+                SFrameIndex frame;
+                memcpy( &frame.Record, file.GetData() + offset, sizeof( frame.Record));
+                frame.FileIndex = fileIndex;
+                frame.Offset = offset + sizeof( SFrameContainerRecord);
+
+                // A frame cut off by an aborted recording ends the container.
+                if (frame.Record.Magic != c_frameContainerRecordMagic || frame.Offset + frame.Record.PayloadSize > file.GetSize())
+                {
+                    break;
+                }
+                m_frames.push_back( frame);
+                offset = frame.Offset + static_cast<size_t>(GetFrameContainerPaddedSize( frame.Record.PayloadSize));
+            }
+        }
+
+        void IndexRawFile( size_t fileIndex, const std::string& fileName, const SRawFileFormat& rawFormat)
+        {
+            uint32_t width = rawFormat.Width;
+            uint32_t height = rawFormat.Height;
+            if ((width == 0 || height == 0) && !GetRawFileSizeFromName( fileName, width, height))
+            {
+                throw RUNTIME_EXCEPTION( "The image size of %s is unknown.", fileName.c_str());
+            }
+
+            const size_t bytesPerPixel = (Pylon::BitPerPixel( rawFormat.PixelType) + 7) / 8;
+            const size_t frameSize = static_cast<size_t>(width) * height * bytesPerPixel;
+            const CMappedFile& file = *m_files[fileIndex];
+            const uint64_t framePeriod = static_cast<uint64_t>(1e9 / rawFormat.FrameRate);
+
+            for (size_t offset = 0; offset + frameSize <= file.GetSize(); offset += frameSize)
+            {
+                SFrameIndex frame;
+                memset( &frame.Record, 0, sizeof( frame.Record));
+                frame.Record.Magic = c_frameContainerRecordMagic;
+                frame.Record.PixelType = rawFormat.PixelType;
+                frame.Record.Width = width;
+                frame.Record.Height = height;
+                frame.Record.PayloadSize = frameSize;
+                frame.Record.TimeStamp = m_frames.size() * framePeriod;
+                frame.Record.BlockID = m_frames.size();
+                frame.Record.ImageNumber = m_frames.size() + 1;
+                frame.FileIndex = fileIndex;
+                frame.Offset = offset;
+                m_frames.push_back( frame);
+            }
+        }
+
+        std::vector< std::unique_ptr<CMappedFile> > m_files;
+        std::vector<SFrameIndex> m_frames;
+    };
+}
+
+#endif /* INCLUDED_FRAMEREPLAYREADER_H_4482915 */
@@ -0,0 +1,231 @@
+// Contains helpers for selecting where a sample takes its frames from.
+/*
+   A sample can grab from a physical camera, from the pylon camera emulator or from the synthetic frame
+   source in SyntheticFrameSource.h. The source is selected on the command line with
+       -source camera|emulator|synthetic
+   or with the SAMPLE_FRAME_SOURCE environment variable. The synthetic frame source is configured with
+       -synthetic-size 2592x1944 -synthetic-format Mono8|Mono12|BayerGB12 -synthetic-fps 14
+       -synthetic-jitter <us> -synthetic-drop <probability> -synthetic-pattern julia|mandelbrot|<file.raw>
+       -synthetic-seed <n>
+   The time a camera takes to start and stop grabbing and to write a parameter is emulated with
+       -synthetic-start-latency <ms> -synthetic-stop-latency <ms> -synthetic-write-latency <us>
+   and a camera lacking the FrameBurstStart trigger with -synthetic-no-burst.
+   Recorded frames are replayed by the synthetic frame source with
+       -source replay -replay <file>[,<file>...] -replay-timing original|asap -replay-loop
+   where the files are frame containers or .raw files. The format of .raw files is given with
+   -synthetic-format and -synthetic-size, or taken from their names, and their frame rate with -synthetic-fps.
+*/
+
+#ifndef INCLUDED_FRAMESOURCESELECTION_H_5170382
+#define INCLUDED_FRAMESOURCESELECTION_H_5170382
+
+#include "SyntheticFrameSource.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace Pylon
+{
+    enum EFrameSource
+    {
+        FrameSource_Camera,
+        FrameSource_Emulator,
+        FrameSource_Synthetic
+    };
+
+    // Returns the value following the command line option, or NULL if the option is not present.
+    inline const char* GetCommandLineOption( int argc, char* argv[], const char* option)
+    {
+        for (int i = 1; i + 1 < argc; ++i)
+        {
+            if (strcmp( argv[i], option) == 0)
+            {
+                return argv[i + 1];
+            }
+        }
+        return NULL;
+    }
+
+    inline EFrameSource GetFrameSource( int argc, char* argv[])
+    {
+        const char* source = GetCommandLineOption( argc, argv, "-source");
+        if (source == NULL)
+        {
+            source = getenv( "SAMPLE_FRAME_SOURCE");
+        }
+        if (source == NULL || strcmp( source, "camera") == 0)
+        {
+            return FrameSource_Camera;
+        }
+        if (strcmp( source, "emulator") == 0)
+        {
+            return FrameSource_Emulator;
+        }
+        // A replay is a mode of the synthetic frame source.
+        if (strcmp( source, "synthetic") == 0 || strcmp( source, "replay") == 0)
+        {
+            return FrameSource_Synthetic;
+        }
+        throw RUNTIME_EXCEPTION( "Unknown frame source %s. Use camera, emulator, synthetic or replay.", source);
+    }
+
+    inline SSyntheticFrameSourceSettings GetSyntheticSettings( int argc, char* argv[])
+    {
+        SSyntheticFrameSourceSettings settings;
+        const char* value = NULL;
+
+        if ((value = GetCommandLineOption( argc, argv, "-synthetic-size")) != NULL)
+        {
+            unsigned int width = 0;
+            unsigned int height = 0;
+            if (sscanf( value, "%ux%u", &width, &height) != 2 || width == 0 || height == 0)
+            {
+                throw RUNTIME_EXCEPTION( "Invalid synthetic frame size %s. Expected <width>x<height>.", value);
+            }
+            settings.Width = width;
+            settings.Height = height;
+        }
+        if ((value = GetCommandLineOption( argc, argv, "-synthetic-format")) != NULL)
+        {
+            if (strcmp( value, "Mono8") == 0)
+            {
+                settings.PixelType = PixelType_Mono8;
+            }
+            else if (strcmp( value, "Mono12") == 0)
+            {
+                settings.PixelType = PixelType_Mono12;
+            }
+            else if (strcmp( value, "BayerGB12") == 0)
+            {
+                settings.PixelType = PixelType_BayerGB12;
+            }
+            else
+            {
+                throw RUNTIME_EXCEPTION( "Invalid synthetic pixel format %s. Use Mono8, Mono12 or BayerGB12.", value);
+            }
+        }
+        if ((value = GetCommandLineOption( argc, argv, "-synthetic-fps")) != NULL)
+        {
+            settings.FrameRate = atof( value);
+            if (settings.FrameRate <= 0.0)
+            {
+                throw RUNTIME_EXCEPTION( "Invalid synthetic frame rate %s.", value);
+            }
+        }
+        if ((value = GetCommandLineOption( argc, argv, "-synthetic-jitter")) != NULL)
+        {
+            settings.JitterUs = atof( value);
+        }
+        if ((value = GetCommandLineOption( argc, argv, "-synthetic-drop")) != NULL)
+        {
+            settings.DropProbability = atof( value);
+        }
+        if ((value = GetCommandLineOption( argc, argv, "-synthetic-seed")) != NULL)
+        {
+            settings.Seed = static_cast<uint32_t>(atoi( value));
+        }
+        if ((value = GetCommandLineOption( argc, argv, "-synthetic-start-latency")) != NULL)
+        {
+            settings.StartLatencyMs = atof( value);
+        }
+        if ((value = GetCommandLineOption( argc, argv, "-synthetic-stop-latency")) != NULL)
+        {
+            settings.StopLatencyMs = atof( value);
+        }
+        if ((value = GetCommandLineOption( argc, argv, "-synthetic-write-latency")) != NULL)
+        {
+            settings.WriteLatencyUs = atof( value);
+        }
+        if ((value = GetCommandLineOption( argc, argv, "-synthetic-pattern")) != NULL)
+        {
+            if (strcmp( value, "julia") == 0)
+            {
+                settings.Pattern = SyntheticPattern_JuliaFractal;
+            }
+            else if (strcmp( value, "mandelbrot") == 0)
+            {
+                settings.Pattern = SyntheticPattern_MandelbrotFractal;
+            }
+            else
+            {
+                settings.Pattern = SyntheticPattern_RawFile;
+                settings.RawFileName = value;
+            }
+        }
+
+        if ((value = GetCommandLineOption( argc, argv, "-replay")) != NULL)
+        {
+            settings.Pattern = SyntheticPattern_Replay;
+            const std::string fileNames( value);
+            for (size_t start = 0; start < fileNames.size();)
+            {
+                const size_t end = std::min( fileNames.find( ',', start), fileNames.size());
+                if (end > start)
+                {
+                    settings.ReplayFileNames.push_back( fileNames.substr( start, end - start));
+                }
+                start = end + 1;
+            }
+            if (GetCommandLineOption( argc, argv, "-synthetic-size") != NULL)
+            {
+                settings.ReplayRawFormat.Width = settings.Width;
+                settings.ReplayRawFormat.Height = settings.Height;
+            }
+            settings.ReplayRawFormat.PixelType = settings.PixelType;
+            settings.ReplayRawFormat.FrameRate = settings.FrameRate;
+        }
+        else if (GetCommandLineOption( argc, argv, "-source") != NULL && strcmp( GetCommandLineOption( argc, argv, "-source"), "replay") == 0)
+        {
+            throw RUNTIME_EXCEPTION( "The replay requires the recorded files to be given with -replay <file>[,<file>...].");
+        }
+        if ((value = GetCommandLineOption( argc, argv, "-replay-timing")) != NULL)
+        {
+            if (strcmp( value, "original") == 0)
+            {
+                settings.ReplayTiming = ReplayTiming_Original;
+            }
+            else if (strcmp( value, "asap") == 0)
+            {
+                settings.ReplayTiming = ReplayTiming_AsFastAsPossible;
+            }
+            else
+            {
+                throw RUNTIME_EXCEPTION( "Invalid replay timing %s. Use original or asap.", value);
+            }
+        }
+        for (int i = 1; i < argc; ++i)
+        {
+            if (strcmp( argv[i], "-replay-loop") == 0)
+            {
+                settings.ReplayLoop = true;
+            }
+            else if (strcmp( argv[i], "-synthetic-no-burst") == 0)
+            {
+                settings.IsFrameBurstStartAvailable = false;
+            }
+        }
+        return settings;
+    }
+
+    // Makes the pylon camera emulator provide numberOfCameras devices.
+    // Must be called before the pylon runtime is initialized.
+    inline void EnableCameraEmulator( size_t numberOfCameras)
+    {
+        char count[32];
+        sprintf( count, "%u", static_cast<unsigned int>(numberOfCameras));
+#if defined(_WIN32)
+        _putenv_s( "PYLON_CAMEMU", count);
+#else
+        setenv( "PYLON_CAMEMU", count, 1);
+#endif
+    }
+
+    // Returns the device class to enumerate for the selected frame source.
+    inline String_t GetFrameSourceDeviceClass( EFrameSource source, const String_t& cameraDeviceClass)
+    {
+        return source == FrameSource_Emulator ? String_t( "BaslerCamEmu") : cameraDeviceClass;
+    }
+}
+
+#endif /* INCLUDED_FRAMESOURCESELECTION_H_5170382 */
@@ -0,0 +1,539 @@
+// Contains a calculator of per-frame image statistics.
+/*
+   CFrameStatisticsCalculator computes for Mono and Bayer buffers with up to 12 significant bits
+   (Mono8, Mono12, BayerGB12, ...) a 4096-bin histogram of the pixel values, the mean and variance per
+   channel and the fractions of saturated and black pixels. Bayer images have the channels red, green
+   and blue, mono images one gray channel.
+
+   The pixels are counted per Bayer site, i.e. per combination of even and odd row and column. With the
+   histogram enabled every pixel increments the table of its site and all other values are derived from
+   the tables, which is exact and keeps the pass over the image to one load and one increment per pixel.
+   A scatter into a histogram does not vectorize on AVX2, using one table per site hides most of the
+   store to load dependencies between neighboring pixels instead. Without the histogram the moments and
+   clipping counts are accumulated with SSE2 or, if the compiler targets it, AVX2.
+
+   The statistics can be restricted to a region of interest and sub-sampled: with Subsample n every
+   n-th row and column is used, for Bayer images every n-th 2x2 cell so that all channels are kept.
+*/
+
+#ifndef INCLUDED_FRAMESTATISTICS_H_5183027
+#define INCLUDED_FRAMESTATISTICS_H_5183027
+
+#include <pylon/PylonIncludes.h>
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#    include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace Pylon
+{
+    static const uint32_t c_frameStatisticsBins = 4096;
+
+    // Channel indices of SFrameStatistics::Channels. Mono images only have StatisticsChannel_Gray.
+    enum EStatisticsChannel
+    {
+        StatisticsChannel_Gray = 0,
+        StatisticsChannel_Red = 0,
+        StatisticsChannel_Green = 1,
+        StatisticsChannel_Blue = 2
+    };
+
+    struct SChannelStatistics
+    {
+        uint64_t PixelCount;
+        double Mean;
+        double Variance;
+    };
+
+    struct SFrameStatistics
+    {
+        SFrameStatistics()
+            : PixelType( PixelType_Undefined)
+            , MaxValue( 0)
+            , PixelCount( 0)
+            , ChannelCount( 0)
+            , SaturatedFraction( 0.0)
+            , BlackFraction( 0.0)
+        {
+            memset( Channels, 0, sizeof( Channels));
+        }
+
+        // Mean over all channels.
+        double GetMean() const
+        {
+            double sum = 0.0;
+            for (uint32_t c = 0; c < ChannelCount; ++c)
+            {
+                sum += Channels[c].Mean * Channels[c].PixelCount;
+            }
+            return PixelCount != 0 ? sum / PixelCount : 0.0;
+        }
+
+        EPixelType PixelType;
+        uint32_t MaxValue;                  // Largest value of the pixel format, e.g. 4095 for Mono12.
+        uint64_t PixelCount;                // Pixels evaluated after ROI and sub-sampling.
+        uint32_t ChannelCount;              // 1 for mono, 3 for Bayer images.
+        SChannelStatistics Channels[3];     // Indexed by EStatisticsChannel.
+        double SaturatedFraction;           // Pixels at or above the saturation level.
+        double BlackFraction;               // Pixels at or below the black level.
+        std::vector<uint32_t> Histogram;    // c_frameStatisticsBins bins of all channels, empty if disabled.
+    };
+
+    struct SFrameStatisticsSettings
+    {
+        SFrameStatisticsSettings()
+            : ComputeHistogram( true)
+            , Subsample( 1)
+            , RoiX( 0)
+            , RoiY( 0)
+            , RoiWidth( 0)
+            , RoiHeight( 0)
+            , SaturationLevel( 0)
+            , BlackLevel( 0)
+        {
+        }
+
+        bool ComputeHistogram;      // Without the histogram only the moments and clipping fractions are computed.
+        uint32_t Subsample;         // Use every n-th row and column (2x2 cell for Bayer images).
+        uint32_t RoiX;              // Region of interest. Rounded down to even positions for Bayer images.
+        uint32_t RoiY;
+        uint32_t RoiWidth;          // 0 uses the image up to its right border.
+        uint32_t RoiHeight;         // 0 uses the image up to its bottom border.
+        uint32_t SaturationLevel;   // 0 uses the largest value of the pixel format.
+        uint32_t BlackLevel;
+    };
+
+    namespace FrameStatisticsDetail
+    {
+        // Sums of the pixels of one Bayer site.
+        struct SSiteSums
+        {
+            uint64_t Count;
+            uint64_t Sum;
+            uint64_t SumSquares;
+            uint64_t Saturated;
+            uint64_t Black;
+        };
+
+        struct SLevels
+        {
+            uint32_t MaxValue;
+            uint32_t Saturation;
+            uint32_t Black;
+        };
+
+        // Adds the pixels of one row to the site histograms. The pixels alternate between the even and the odd site:
+        // pRow[0], pRow[pitch] form the first pair, the next pair starts at pRow[stride].
+        template <typename PixelT>
+        inline void AddRowToHistograms( const PixelT* pRow, uint32_t pairCount, bool hasTail, uint32_t pitch, uint32_t stride,
+            uint32_t maxValue, uint32_t* pEven, uint32_t* pOdd)
+        {
+            uint32_t i = 0;
+            if (pitch == 1 && stride == 2)
+            {
+                // Two pairs per iteration give the processor four independent increments.
+                for (; i + 2 <= pairCount; i += 2)
+                {
+                    const PixelT* p = pRow + 2 * i;
+                    const uint32_t v0 = std::min<uint32_t>( p[0], maxValue);
+                    const uint32_t v1 = std::min<uint32_t>( p[1], maxValue);
+                    const uint32_t v2 = std::min<uint32_t>( p[2], maxValue);
+                    const uint32_t v3 = std::min<uint32_t>( p[3], maxValue);
+                    ++pEven[v0];
+                    ++pOdd[v1];
+                    ++pEven[v2];
+                    ++pOdd[v3];
+                }
+            }
+            for (; i < pairCount; ++i)
+            {
+                const PixelT* p = pRow + static_cast<size_t>(i) * stride;
+                ++pEven[std::min<uint32_t>( p[0], maxValue)];
+                ++pOdd[std::min<uint32_t>( p[pitch], maxValue)];
+            }
+            if (hasTail)
+            {
+                ++pEven[std::min<uint32_t>( pRow[static_cast<size_t>(pairCount) * stride], maxValue)];
+            }
+        }
+
+        template <typename PixelT>
+        inline void AddPixelToSums( PixelT pixel, const SLevels& levels, SSiteSums& sums)
+        {
+            const uint64_t v = std::min<uint32_t>( pixel, levels.MaxValue);
+            ++sums.Count;
+            sums.Sum += v;
+            sums.SumSquares += v * v;
+            sums.Saturated += v >= levels.Saturation ? 1 : 0;
+            sums.Black += v <= levels.Black ? 1 : 0;
+        }
+
+#if defined(__AVX2__) || defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#    if defined(__AVX2__)
+        typedef __m256i Vector_t;
+        static const uint32_t c_vectorLanes16 = 16;
+        inline Vector_t Set1( int16_t value) { return _mm256_set1_epi16( value); }
+        inline Vector_t SetPairs( int16_t even, int16_t odd) { return _mm256_set1_epi32( (static_cast<uint32_t>(static_cast<uint16_t>(odd)) << 16) | static_cast<uint16_t>(even)); }
+        inline Vector_t Zero() { return _mm256_setzero_si256(); }
+        inline Vector_t Load16( const uint16_t* p) { return _mm256_loadu_si256( reinterpret_cast<const __m256i*>(p)); }
+        inline Vector_t Load8( const uint8_t* p) { return _mm256_cvtepu8_epi16( _mm_loadu_si128( reinterpret_cast<const __m128i*>(p))); }
+        inline Vector_t Add32( Vector_t a, Vector_t b) { return _mm256_add_epi32( a, b); }
+        inline Vector_t Sub16( Vector_t a, Vector_t b) { return _mm256_sub_epi16( a, b); }
+        inline Vector_t SubSaturateU16( Vector_t a, Vector_t b) { return _mm256_subs_epu16( a, b); }
+        inline Vector_t CompareEqual16( Vector_t a, Vector_t b) { return _mm256_cmpeq_epi16( a, b); }
+        inline Vector_t MultiplyAdd16( Vector_t a, Vector_t b) { return _mm256_madd_epi16( a, b); }
+        inline Vector_t And( Vector_t a, Vector_t b) { return _mm256_and_si256( a, b); }
+        inline void Store( uint32_t* p, Vector_t a) { _mm256_storeu_si256( reinterpret_cast<__m256i*>(p), a); }
+#    else
+        typedef __m128i Vector_t;
+        static const uint32_t c_vectorLanes16 = 8;
+        inline Vector_t Set1( int16_t value) { return _mm_set1_epi16( value); }
+        inline Vector_t SetPairs( int16_t even, int16_t odd) { return _mm_set1_epi32( (static_cast<uint32_t>(static_cast<uint16_t>(odd)) << 16) | static_cast<uint16_t>(even)); }
+        inline Vector_t Zero() { return _mm_setzero_si128(); }
+        inline Vector_t Load16( const uint16_t* p) { return _mm_loadu_si128( reinterpret_cast<const __m128i*>(p)); }
+        inline Vector_t Load8( const uint8_t* p) { return _mm_unpacklo_epi8( _mm_loadl_epi64( reinterpret_cast<const __m128i*>(p)), _mm_setzero_si128()); }
+        inline Vector_t Add32( Vector_t a, Vector_t b) { return _mm_add_epi32( a, b); }
+        inline Vector_t Sub16( Vector_t a, Vector_t b) { return _mm_sub_epi16( a, b); }
+        inline Vector_t SubSaturateU16( Vector_t a, Vector_t b) { return _mm_subs_epu16( a, b); }
+        inline Vector_t CompareEqual16( Vector_t a, Vector_t b) { return _mm_cmpeq_epi16( a, b); }
+        inline Vector_t MultiplyAdd16( Vector_t a, Vector_t b) { return _mm_madd_epi16( a, b); }
+        inline Vector_t And( Vector_t a, Vector_t b) { return _mm_and_si128( a, b); }
+        inline void Store( uint32_t* p, Vector_t a) { _mm_storeu_si128( reinterpret_cast<__m128i*>(p), a); }
+#    endif
+
+        inline Vector_t LoadPixels( const uint16_t* p) { return Load16( p); }
+        inline Vector_t LoadPixels( const uint8_t* p) { return Load8( p); }
+
+        // Adds the 32-bit lanes of a vector to a 64-bit sum.
+        inline void AddLanes( Vector_t a, uint64_t& sum)
+        {
+            uint32_t lanes[sizeof( Vector_t) / sizeof( uint32_t)];
+            Store( lanes, a);
+            for (size_t i = 0; i < sizeof( lanes) / sizeof( lanes[0]); ++i)
+            {
+                sum += lanes[i];
+            }
+        }
+
+        // Adds the 16-bit lanes of a vector to a 64-bit sum.
+        inline void AddCounts( Vector_t a, uint64_t& sum)
+        {
+            uint32_t lanes[sizeof( Vector_t) / sizeof( uint32_t)];
+            Store( lanes, a);
+            for (size_t i = 0; i < sizeof( lanes) / sizeof( lanes[0]); ++i)
+            {
+                sum += (lanes[i] & 0xFFFF) + (lanes[i] >> 16);
+            }
+        }
+
+        // Accumulates a contiguous row, the even pixels belonging to one site and the odd pixels to the other.
+        // The products of madd fit 32 bits for values up to 4095, the lanes are flushed before they can overflow.
+        template <typename PixelT>
+        inline void AddRowToSums( const PixelT* pRow, uint32_t count, const SLevels& levels, SSiteSums& even, SSiteSums& odd)
+        {
+            static const uint32_t c_flushInterval = 64;
+            const Vector_t maxValue = Set1( static_cast<int16_t>(levels.MaxValue));
+            const Vector_t saturationMinusOne = Set1( static_cast<int16_t>(levels.Saturation - 1));
+            const Vector_t black = Set1( static_cast<int16_t>(levels.Black));
+            const Vector_t evenOnes = SetPairs( 1, 0);
+            const Vector_t oddOnes = SetPairs( 0, 1);
+            const Vector_t evenMask = SetPairs( -1, 0);
+            const Vector_t oddMask = SetPairs( 0, -1);
+
+            uint32_t x = 0;
+            while (x + c_vectorLanes16 <= count)
+            {
+                Vector_t sumEven = Zero();
+                Vector_t sumOdd = Zero();
+                Vector_t squaresEven = Zero();
+                Vector_t squaresOdd = Zero();
+                Vector_t saturated = Zero();
+                Vector_t blackCount = Zero();
+                for (uint32_t i = 0; i < c_flushInterval && x + c_vectorLanes16 <= count; ++i, x += c_vectorLanes16)
+                {
+                    Vector_t v = LoadPixels( pRow + x);
+                    // min( v, maxValue) without SSE4.1.
+                    v = Sub16( v, SubSaturateU16( v, maxValue));
+                    sumEven = Add32( sumEven, MultiplyAdd16( v, evenOnes));
+                    sumOdd = Add32( sumOdd, MultiplyAdd16( v, oddOnes));
+                    squaresEven = Add32( squaresEven, MultiplyAdd16( v, And( v, evenMask)));
+                    squaresOdd = Add32( squaresOdd, MultiplyAdd16( v, And( v, oddMask)));
+                    // The comparisons yield -1 per matching lane, subtracting counts them: v >= saturation and v <= black.
+                    saturated = Sub16( saturated, CompareEqual16( SubSaturateU16( saturationMinusOne, v), Zero()));
+                    blackCount = Sub16( blackCount, CompareEqual16( SubSaturateU16( v, black), Zero()));
+                }
+                AddLanes( sumEven, even.Sum);
+                AddLanes( sumOdd, odd.Sum);
+                AddLanes( squaresEven, even.SumSquares);
+                AddLanes( squaresOdd, odd.SumSquares);
+                // The clipping fractions are not needed per site, the counts go to the even site.
+                AddCounts( saturated, even.Saturated);
+                AddCounts( blackCount, even.Black);
+            }
+            even.Count += x / 2;
+            odd.Count += x / 2;
+
+            for (; x < count; ++x)
+            {
+                AddPixelToSums( pRow[x], levels, (x & 1) == 0 ? even : odd);
+            }
+        }
+#else
+        template <typename PixelT>
+        inline void AddRowToSums( const PixelT* pRow, uint32_t count, const SLevels& levels, SSiteSums& even, SSiteSums& odd)
+        {
+            for (uint32_t x = 0; x < count; ++x)
+            {
+                AddPixelToSums( pRow[x], levels, (x & 1) == 0 ? even : odd);
+            }
+        }
+#endif
+
+        // Accumulates a sub-sampled row, see AddRowToHistograms for the layout.
+        template <typename PixelT>
+        inline void AddSampledRowToSums( const PixelT* pRow, uint32_t pairCount, bool hasTail, uint32_t pitch, uint32_t stride,
+            const SLevels& levels, SSiteSums& even, SSiteSums& odd)
+        {
+            for (uint32_t i = 0; i < pairCount; ++i)
+            {
+                const PixelT* p = pRow + static_cast<size_t>(i) * stride;
+                AddPixelToSums( p[0], levels, even);
+                AddPixelToSums( p[pitch], levels, odd);
+            }
+            if (hasTail)
+            {
+                AddPixelToSums( pRow[static_cast<size_t>(pairCount) * stride], levels, even);
+            }
+        }
+
+        // Returns the channel of each Bayer site (even row even column, even row odd column, odd row even column, odd row odd column).
+        inline void GetSiteChannels( EPixelType pixelType, uint32_t channels[4])
+        {
+            static const uint32_t R = StatisticsChannel_Red;
+            static const uint32_t G = StatisticsChannel_Green;
+            static const uint32_t B = StatisticsChannel_Blue;
+            uint32_t gb[4] = { G, B, R, G };
+            uint32_t rg[4] = { R, G, G, B };
+            uint32_t gr[4] = { G, R, B, G };
+            uint32_t bg[4] = { B, G, G, R };
+            const uint32_t* pLayout = gb;
+            switch (pixelType)
+            {
+            case PixelType_BayerRG8:
+            case PixelType_BayerRG10:
+            case PixelType_BayerRG12:
+                pLayout = rg;
+                break;
+            case PixelType_BayerGR8:
+            case PixelType_BayerGR10:
+            case PixelType_BayerGR12:
+                pLayout = gr;
+                break;
+            case PixelType_BayerBG8:
+            case PixelType_BayerBG10:
+            case PixelType_BayerBG12:
+                pLayout = bg;
+                break;
+            default:
+                break;
+            }
+            std::copy( pLayout, pLayout + 4, channels);
+        }
+    }
+
+    // Computes the statistics of frames. The tables of one calculator are reused from frame to frame.
+    class CFrameStatisticsCalculator
+    {
+    public:
+        explicit CFrameStatisticsCalculator( const SFrameStatisticsSettings& settings = SFrameStatisticsSettings())
+            : m_settings( settings)
+        {
+            if (m_settings.Subsample == 0)
+            {
+                throw RUNTIME_EXCEPTION( "The sub-sampling factor of the frame statistics must not be 0.");
+            }
+        }
+
+        const SFrameStatisticsSettings& GetSettings() const
+        {
+            return m_settings;
+        }
+
+        // Returns true for unpacked mono and Bayer formats with up to 12 significant bits.
+        static bool IsSupported( EPixelType pixelType)
+        {
+            return (IsMono( pixelType) || IsBayer( pixelType)) && !IsPacked( pixelType)
+                && (BitPerPixel( pixelType) == 8 || BitPerPixel( pixelType) == 16) && BitDepth( pixelType) <= 12;
+        }
+
+        void Compute( const void* pBuffer, EPixelType pixelType, uint32_t width, uint32_t height, size_t paddingX, SFrameStatistics& statistics)
+        {
+            using namespace FrameStatisticsDetail;
+
+            if (!IsSupported( pixelType))
+            {
+                throw RUNTIME_EXCEPTION( "The frame statistics do not support the pixel type 0x%08x.", static_cast<unsigned int>(pixelType));
+            }
+
+            // Geometry after ROI and sub-sampling. Bayer images are sampled in 2x2 cells, mono images in pairs of
+            // pixels n apart, so both are processed as pairs of an even and an odd site.
+            const bool isBayer = IsBayer( pixelType);
+            const uint32_t subsample = m_settings.Subsample;
+            uint32_t roiX = std::min( m_settings.RoiX, width);
+            uint32_t roiY = std::min( m_settings.RoiY, height);
+            if (isBayer)
+            {
+                roiX &= ~1u;
+                roiY &= ~1u;
+            }
+            const uint32_t roiWidth = m_settings.RoiWidth != 0 ? std::min( m_settings.RoiWidth, width - roiX) : width - roiX;
+            const uint32_t roiHeight = m_settings.RoiHeight != 0 ? std::min( m_settings.RoiHeight, height - roiY) : height - roiY;
+            const uint32_t pitch = isBayer ? 1 : subsample;
+            const uint32_t stride = 2 * subsample;
+            // A row holds pairs at k * stride and k * stride + pitch, possibly followed by a single pixel.
+            const uint32_t pairCount = roiWidth > pitch ? (roiWidth - pitch - 1) / stride + 1 : 0;
+            const bool hasTail = static_cast<uint64_t>(pairCount) * stride < roiWidth;
+
+            SLevels levels;
+            levels.MaxValue = (1u << BitDepth( pixelType)) - 1;
+            levels.Saturation = std::max( 1u, std::min( m_settings.SaturationLevel != 0 ? m_settings.SaturationLevel : levels.MaxValue, levels.MaxValue));
+            levels.Black = std::min( m_settings.BlackLevel, levels.MaxValue);
+
+            SSiteSums sums[4];
+            memset( sums, 0, sizeof( sums));
+            if (m_settings.ComputeHistogram)
+            {
+                m_siteHistograms.assign( 4 * c_frameStatisticsBins, 0);
+            }
+
+            const size_t bytesPerPixel = BitPerPixel( pixelType) / 8;
+            const size_t rowSize = width * bytesPerPixel + paddingX;
+            const uint8_t* pFirst = static_cast<const uint8_t*>(pBuffer) + roiY * rowSize + roiX * bytesPerPixel;
+            for (uint32_t y = 0; y < roiHeight; y += stride)
+            {
+                for (uint32_t parity = 0; parity < 2; ++parity)
+                {
+                    const uint32_t row = y + parity * pitch;
+                    if (row >= roiHeight)
+                    {
+                        break;
+                    }
+                    const uint8_t* pRow = pFirst + row * rowSize;
+                    if (bytesPerPixel == 1)
+                    {
+                        AddRow( reinterpret_cast<const uint8_t*>(pRow), roiWidth, pairCount, hasTail, pitch, stride, levels, parity, sums);
+                    }
+                    else
+                    {
+                        AddRow( reinterpret_cast<const uint16_t*>(pRow), roiWidth, pairCount, hasTail, pitch, stride, levels, parity, sums);
+                    }
+                }
+            }
+
+            if (m_settings.ComputeHistogram)
+            {
+                statistics.Histogram.assign( c_frameStatisticsBins, 0);
+                for (uint32_t site = 0; site < 4; ++site)
+                {
+                    const uint32_t* pHistogram = &m_siteHistograms[site * c_frameStatisticsBins];
+                    SSiteSums& siteSums = sums[site];
+                    for (uint32_t v = 0; v <= levels.MaxValue; ++v)
+                    {
+                        const uint64_t n = pHistogram[v];
+                        statistics.Histogram[v] += pHistogram[v];
+                        siteSums.Count += n;
+                        siteSums.Sum += n * v;
+                        siteSums.SumSquares += n * v * v;
+                        siteSums.Saturated += v >= levels.Saturation ? n : 0;
+                        siteSums.Black += v <= levels.Black ? n : 0;
+                    }
+                }
+            }
+            else
+            {
+                statistics.Histogram.clear();
+            }
+
+            uint32_t siteChannels[4] = { 0, 0, 0, 0 };
+            if (isBayer)
+            {
+                GetSiteChannels( pixelType, siteChannels);
+            }
+            uint64_t channelSum[3] = { 0, 0, 0 };
+            uint64_t channelSumSquares[3] = { 0, 0, 0 };
+            uint64_t saturated = 0;
+            uint64_t black = 0;
+
+            statistics.PixelType = pixelType;
+            statistics.MaxValue = levels.MaxValue;
+            statistics.PixelCount = 0;
+            statistics.ChannelCount = isBayer ? 3 : 1;
+            memset( statistics.Channels, 0, sizeof( statistics.Channels));
+            for (uint32_t site = 0; site < 4; ++site)
+            {
+                const uint32_t channel = siteChannels[site];
+                statistics.Channels[channel].PixelCount += sums[site].Count;
+                channelSum[channel] += sums[site].Sum;
+                channelSumSquares[channel] += sums[site].SumSquares;
+                statistics.PixelCount += sums[site].Count;
+                saturated += sums[site].Saturated;
+                black += sums[site].Black;
+            }
+            for (uint32_t c = 0; c < statistics.ChannelCount; ++c)
+            {
+                SChannelStatistics& channel = statistics.Channels[c];
+                if (channel.PixelCount != 0)
+                {
+                    channel.Mean = static_cast<double>(channelSum[c]) / channel.PixelCount;
+                    channel.Variance = std::max( 0.0, static_cast<double>(channelSumSquares[c]) / channel.PixelCount - channel.Mean * channel.Mean);
+                }
+            }
+            statistics.SaturatedFraction = statistics.PixelCount != 0 ? static_cast<double>(saturated) / statistics.PixelCount : 0.0;
+            statistics.BlackFraction = statistics.PixelCount != 0 ? static_cast<double>(black) / statistics.PixelCount : 0.0;
+        }
+
+        // Computes the statistics of a grab result. Returns false if the grab failed or the pixel type is not supported.
+        template <typename GrabResultPtrT>
+        bool Compute( const GrabResultPtrT& ptrGrabResult, SFrameStatistics& statistics)
+        {
+            if (!ptrGrabResult->GrabSucceeded() || !IsSupported( ptrGrabResult->GetPixelType()))
+            {
+                return false;
+            }
+            Compute( ptrGrabResult->GetBuffer(), ptrGrabResult->GetPixelType(), ptrGrabResult->GetWidth(), ptrGrabResult->GetHeight(),
+                ptrGrabResult->GetPaddingX(), statistics);
+            return true;
+        }
+
+    private:
+        template <typename PixelT>
+        void AddRow( const PixelT* pRow, uint32_t roiWidth, uint32_t pairCount, bool hasTail, uint32_t pitch, uint32_t stride,
+            const FrameStatisticsDetail::SLevels& levels, uint32_t rowParity, FrameStatisticsDetail::SSiteSums sums[4])
+        {
+            if (m_settings.ComputeHistogram)
+            {
+                uint32_t* pEven = &m_siteHistograms[(2 * rowParity) * c_frameStatisticsBins];
+                FrameStatisticsDetail::AddRowToHistograms( pRow, pairCount, hasTail, pitch, stride, levels.MaxValue, pEven, pEven + c_frameStatisticsBins);
+            }
+            else if (stride == 2)
+            {
+                FrameStatisticsDetail::AddRowToSums( pRow, roiWidth, levels, sums[2 * rowParity], sums[2 * rowParity + 1]);
+            }
+            else
+            {
+                FrameStatisticsDetail::AddSampledRowToSums( pRow, pairCount, hasTail, pitch, stride, levels, sums[2 * rowParity], sums[2 * rowParity + 1]);
+            }
+        }
+
+        SFrameStatisticsSettings m_settings;
+        std::vector<uint32_t> m_siteHistograms;
+    };
+}
+
+#endif /* INCLUDED_FRAMESTATISTICS_H_5183027 */
@@ -0,0 +1,302 @@
+// Contains the functions the samples use for storing grabbed frames.
+/*
+   A frame can be stored as a .raw file holding the image buffer as is, as a .png file written by
+   CPylonImage::Save, or appended to a frame container. A frame container is a single file holding a
+   sequence of frames, each preceded by a record header with the image geometry and the time stamp:
+
+       SFrameContainerFileHeader
+       SFrameContainerRecord, payload padded to c_frameContainerAlignment bytes
+       SFrameContainerRecord, payload ...
+
+   All values are stored little endian. Writing a container avoids creating and closing a file per frame.
+   With FrameStorageMode_CompressedContainer the payloads of 16-bit frames are compressed with the lossless
+   codec in Lossless12Codec.h, marked by FrameEncoding_Lossless12 in the record.
+*/
+
+#ifndef INCLUDED_FRAMESTORAGE_H_7120964
+#define INCLUDED_FRAMESTORAGE_H_7120964
+
+#include <pylon/PylonIncludes.h>
+#include "Lossless12Codec.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace Pylon
+{
+    enum EFrameStorageMode
+    {
+        FrameStorageMode_RawAndPng,     // The samples' default: one .raw and one .png file per frame.
+        FrameStorageMode_Raw,
+        FrameStorageMode_Png,
+        FrameStorageMode_Container,
+        FrameStorageMode_CompressedContainer    // A frame container with losslessly compressed payloads.
+    };
+
+    // Returns the storage mode for the names raw+png, raw, png, container and compressed.
+    inline EFrameStorageMode GetFrameStorageMode( const char* name)
+    {
+        if (strcmp( name, "raw+png") == 0)
+        {
+            return FrameStorageMode_RawAndPng;
+        }
+        if (strcmp( name, "raw") == 0)
+        {
+            return FrameStorageMode_Raw;
+        }
+        if (strcmp( name, "png") == 0)
+        {
+            return FrameStorageMode_Png;
+        }
+        if (strcmp( name, "container") == 0)
+        {
+            return FrameStorageMode_Container;
+        }
+        if (strcmp( name, "compressed") == 0)
+        {
+            return FrameStorageMode_CompressedContainer;
+        }
+        throw RUNTIME_EXCEPTION( "Unknown storage mode %s. Use raw+png, raw, png, container or compressed.", name);
+    }
+
+    inline const char* GetFrameStorageModeName( EFrameStorageMode mode)
+    {
+        switch (mode)
+        {
+        case FrameStorageMode_RawAndPng: return "raw+png";
+        case FrameStorageMode_Raw: return "raw";
+        case FrameStorageMode_Png: return "png";
+        case FrameStorageMode_Container: return "container";
+        case FrameStorageMode_CompressedContainer: return "compressed";
+        }
+        return "unknown";
+    }
+
+    // Writes the image buffer to a .raw file. Returns false if the file could not be written.
+    inline bool WriteRawFrame( const char* fileName, const void* pBuffer, size_t bufferSize)
+    {
+        FILE* pFile = fopen( fileName, "wb");
+        if (!pFile)
+        {
+            return false;
+        }
+        const bool written = fwrite( pBuffer, 1, bufferSize, pFile) == bufferSize;
+        return fclose( pFile) == 0 && written;
+    }
+
+    // Saves the image buffer as .png file. Throws if the file could not be written.
+    inline void SavePngFrame( const char* fileName, void* pBuffer, size_t bufferSize, EPixelType pixelType, uint32_t width, uint32_t height, size_t paddingX)
+    {
+        CPylonImage imageToSave;
+        imageToSave.AttachUserBuffer( pBuffer, bufferSize, pixelType, width, height, paddingX);
+        imageToSave.Save( ImageFileFormat_Png, fileName);
+    }
+
+
+    // Payloads in a frame container start at multiples of this size.
+    static const uint32_t c_frameContainerAlignment = 64;
+
+    struct SFrameContainerFileHeader
+    {
+        char Magic[8];              // "PYFRAMES"
+        uint32_t Version;
+        uint32_t HeaderSize;        // Size of this header, the first record follows.
+        uint32_t RecordSize;        // Size of SFrameContainerRecord.
+        uint32_t Alignment;         // c_frameContainerAlignment.
+        uint64_t Reserved[5];
+    };
+
+    // Encoding of the payload of a frame container record.
+    enum EFrameEncoding
+    {
+        FrameEncoding_None = 0,         // The image buffer as is.
+        FrameEncoding_Lossless12 = 1    // A stream of the lossless codec, the decoded image is unpadded.
+    };
+
+    struct SFrameContainerRecord
+    {
+        uint32_t Magic;             // c_frameContainerRecordMagic
+        uint32_t PixelType;         // EPixelType
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t PaddingX;
+        uint32_t CameraIndex;
+        uint64_t PayloadSize;       // Image bytes following the record, without the alignment padding.
+        uint64_t TimeStamp;         // Camera time stamp in ticks (ns for USB cameras).
+        uint64_t BlockID;
+        uint64_t ImageNumber;
+        uint32_t Encoding;          // EFrameEncoding
+        uint32_t Reserved;
+    };
+
+    static const uint32_t c_frameContainerVersion = 1;
+    static const uint32_t c_frameContainerRecordMagic = 0x454d5246; // "FRME"
+
+    // Returns the size a payload occupies in a container including its padding.
+    inline uint64_t GetFrameContainerPaddedSize( uint64_t payloadSize)
+    {
+        return (payloadSize + c_frameContainerAlignment - 1) / c_frameContainerAlignment * c_frameContainerAlignment;
+    }
+
+    // Appends frames to a frame container file.
+    class CFrameContainerWriter
+    {
+    public:
+        CFrameContainerWriter()
+            : m_pFile( NULL)
+            , m_encoding( FrameEncoding_None)
+            , m_frameCount( 0)
+            , m_bytesWritten( 0)
+        {
+        }
+
+        ~CFrameContainerWriter()
+        {
+            if (m_pFile != NULL)
+            {
+                fclose( m_pFile);
+            }
+        }
+
+        // Creates the file. The stream buffer is sized to hold several frames so that frames are written in large blocks.
+        void Open( const char* fileName, size_t streamBufferSize = 16 * 1024 * 1024)
+        {
+            Close();
+            m_pFile = fopen( fileName, "wb");
+            if (m_pFile == NULL)
+            {
+                throw RUNTIME_EXCEPTION( "Could not create the frame container %s.", fileName);
+            }
+            m_streamBuffer.resize( streamBufferSize);
+            setvbuf( m_pFile, &m_streamBuffer[0], _IOFBF, m_streamBuffer.size());
+
+            SFrameContainerFileHeader header;
+            memset( &header, 0, sizeof( header));
+            memcpy( header.Magic, "PYFRAMES", sizeof( header.Magic));
+            header.Version = c_frameContainerVersion;
+            header.HeaderSize = sizeof( header);
+            header.RecordSize = sizeof( SFrameContainerRecord);
+            header.Alignment = c_frameContainerAlignment;
+            Write( &header, sizeof( header));
+            m_frameCount = 0;
+            m_bytesWritten = sizeof( header);
+        }
+
+        bool IsOpen() const
+        {
+            return m_pFile != NULL;
+        }
+
+        // Selects the encoding of the payloads appended from now on. Frames the codec does not support are stored as is.
+        void SetEncoding( EFrameEncoding encoding, const SLossless12Settings& settings = SLossless12Settings())
+        {
+            m_encoding = encoding;
+            m_ptrEncoder.reset( encoding == FrameEncoding_Lossless12 ? new CLossless12Encoder( settings) : NULL);
+        }
+
+        // Appends one frame. The magic, the encoding and the payload size of the record are filled in.
+        void Append( const SFrameContainerRecord& record, const void* pBuffer, size_t bufferSize)
+        {
+            static const uint8_t padding[c_frameContainerAlignment] = { 0 };
+            if (m_pFile == NULL)
+            {
+                throw RUNTIME_EXCEPTION( "The frame container is not open.");
+            }
+
+            SFrameContainerRecord header = record;
+            header.Magic = c_frameContainerRecordMagic;
+            header.Encoding = FrameEncoding_None;
+            if (m_encoding == FrameEncoding_Lossless12 && CLossless12Encoder::IsSupported( static_cast<EPixelType>(record.PixelType)))
+            {
+                bufferSize = m_ptrEncoder->Encode( pBuffer, static_cast<EPixelType>(record.PixelType), record.Width, record.Height, record.PaddingX, m_encoded);
+                pBuffer = &m_encoded[0];
+                header.Encoding = FrameEncoding_Lossless12;
+                header.PaddingX = 0;
+            }
+            header.PayloadSize = bufferSize;
+            Write( &header, sizeof( header));
+            Write( pBuffer, bufferSize);
+            const size_t paddingSize = static_cast<size_t>(GetFrameContainerPaddedSize( bufferSize) - bufferSize);
+            if (paddingSize != 0)
+            {
+                Write( padding, paddingSize);
+            }
+            ++m_frameCount;
+            m_bytesWritten += sizeof( header) + bufferSize + paddingSize;
+        }
+
+        // Appends the image of a grab result.
+        template <typename GrabResultPtrT>
+        void Append( const GrabResultPtrT& ptrGrabResult, uint32_t cameraIndex = 0)
+        {
+            SFrameContainerRecord record;
+            memset( &record, 0, sizeof( record));
+            record.PixelType = static_cast<uint32_t>(ptrGrabResult->GetPixelType());
+            record.Width = ptrGrabResult->GetWidth();
+            record.Height = ptrGrabResult->GetHeight();
+            record.PaddingX = static_cast<uint32_t>(ptrGrabResult->GetPaddingX());
+            record.CameraIndex = cameraIndex;
+            record.TimeStamp = ptrGrabResult->GetTimeStamp();
+            record.BlockID = ptrGrabResult->GetBlockID();
+            record.ImageNumber = static_cast<uint64_t>(ptrGrabResult->GetImageNumber());
+            Append( record, ptrGrabResult->GetBuffer(), ptrGrabResult->GetImageSize());
+        }
+
+        // Writes the buffered data to the operating system.
+        void Flush()
+        {
+            if (m_pFile != NULL && fflush( m_pFile) != 0)
+            {
+                throw RUNTIME_EXCEPTION( "Could not write to the frame container.");
+            }
+        }
+
+        void Close()
+        {
+            if (m_pFile != NULL)
+            {
+                FILE* pFile = m_pFile;
+                m_pFile = NULL;
+                if (fclose( pFile) != 0)
+                {
+                    throw RUNTIME_EXCEPTION( "Could not write to the frame container.");
+                }
+            }
+        }
+
+        uint64_t GetFrameCount() const
+        {
+            return m_frameCount;
+        }
+
+        uint64_t GetBytesWritten() const
+        {
+            return m_bytesWritten;
+        }
+
+    private:
+        // Not copyable.
+        CFrameContainerWriter( const CFrameContainerWriter&);
+        CFrameContainerWriter& operator=( const CFrameContainerWriter&);
+
+        void Write( const void* pData, size_t size)
+        {
+            if (fwrite( pData, 1, size, m_pFile) != size)
+            {
+                throw RUNTIME_EXCEPTION( "Could not write to the frame container.");
+            }
+        }
+
+        FILE* m_pFile;
+        std::vector<char> m_streamBuffer;
+        EFrameEncoding m_encoding;
+        std::unique_ptr<CLossless12Encoder> m_ptrEncoder;
+        std::vector<uint8_t> m_encoded;
+        uint64_t m_frameCount;
+        uint64_t m_bytesWritten;
+    };
+}
+
+#endif /* INCLUDED_FRAMESTORAGE_H_7120964 */
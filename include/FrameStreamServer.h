@@ -0,0 +1,846 @@
+// Contains a server streaming frames and their metadata to TCP clients and a client receiving them.
+/*
+   Frames for remote viewing and recording were copied off the capture computer as files after a run.
+   CFrameStreamServer accepts TCP clients and sends them the frames published to it while grabbing:
+
+       CFrameStreamServer server;
+       server.Start( 5600);
+       ... in the image event handler:
+       server.Publish( ptrGrabResult, timestamp);
+
+   A client subscribes to the full frames or to a preview, 8-bit frames reduced by
+   SFrameStreamSettings::Preview.Decimation with CPreviewRenderer, and optionally to every n-th frame
+   only. Each frame is sent as an SFrameStreamHeader followed by its rows without padding.
+
+   Publish() does not copy the full frames, the queues of the clients hold views of them, which keep the
+   grab results and so their buffers until the frame is sent, see FrameView.h. The sockets send from the
+   buffers with one vectored send per frame, a buffer per row if the rows are padded. The preview is
+   rendered once per frame for all its clients. MSG_ZEROCOPY is not used, it does not apply to loopback,
+   where the kernel copies anyway, and pays off only for frames much larger than the socket buffers.
+
+   Every client has its own thread and a queue of QueueDepth frames. When a client falls behind, the
+   oldest queued frame is dropped for DropPolicy FrameStreamDrop_Oldest, or the new one for
+   FrameStreamDrop_Newest, so a slow client never holds up the grab or the other clients. The frames
+   dropped for a client are sent in the headers. The thread of a client receives its subscription first,
+   a client not sending it within 5 s is closed, it holds up neither the server nor the other clients.
+   With buffers from a camera, the buffers held by the queues, up to MaxClients * QueueDepth, have to be
+   added to MaxNumBuffer.
+
+   CFrameStreamClient connects, subscribes and receives the frames. It checks the headers, that the
+   frame numbers increase and, if the server computes them (ComputeChecksum), the checksums.
+*/
+
+#ifndef INCLUDED_FRAMESTREAMSERVER_H_5819346
+#define INCLUDED_FRAMESTREAMSERVER_H_5819346
+
+#include <pylon/PylonIncludes.h>
+#include "FrameView.h"
+#include "FrameTimeSeries.h"
+#include "PreviewRenderer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <winsock2.h>
+#    include <ws2tcpip.h>
+#    if defined(_MSC_VER)
+#        pragma comment(lib, "ws2_32.lib")
+#    endif
+#else
+#    include <arpa/inet.h>
+#    include <netinet/in.h>
+#    include <netinet/tcp.h>
+#    include <sys/select.h>
+#    include <sys/socket.h>
+#    include <sys/uio.h>
+#    include <unistd.h>
+#endif
+
+namespace Pylon
+{
+    enum EFrameStream
+    {
+        FrameStream_Full,       // The frames as grabbed.
+        FrameStream_Preview     // Reduced 8-bit frames, see CPreviewRenderer.
+    };
+
+    enum EFrameStreamDropPolicy
+    {
+        FrameStreamDrop_Oldest,
+        FrameStreamDrop_Newest
+    };
+
+    struct SFrameStreamSettings
+    {
+        SFrameStreamSettings()
+            : BindAddress( "0.0.0.0")
+            , QueueDepth( 2)
+            , MaxClients( 4)
+            , DropPolicy( FrameStreamDrop_Oldest)
+            , ComputeChecksum( false)
+        {
+            Preview.Decimation = 4;
+        }
+
+        std::string BindAddress;        // 127.0.0.1 to accept local clients only.
+        uint32_t QueueDepth;            // Frames queued per client.
+        uint32_t MaxClients;
+        EFrameStreamDropPolicy DropPolicy;
+        bool ComputeChecksum;           // Costs a pass over each frame per client.
+        SPreviewSettings Preview;
+    };
+
+    // Sent by the client after connecting.
+    struct SFrameStreamSubscription
+    {
+        char Magic[4];              // "PYSS"
+        uint32_t Version;
+        uint32_t Stream;            // EFrameStream
+        uint32_t FrameInterval;     // Every n-th frame, 1 for all.
+    };
+
+    // Precedes the rows of each frame.
+    struct SFrameStreamHeader
+    {
+        char Magic[4];              // "PYFS"
+        uint32_t HeaderSize;
+        uint64_t FrameNumber;       // Counts the frames published to the server.
+        uint64_t BlockID;
+        int64_t Timestamp;          // As given to Publish(), e.g. the Timestamp chunk.
+        int64_t PublishTime;        // GetHostTimeNs() of the server when the frame was published.
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t PixelType;
+        uint32_t Stream;
+        uint64_t Size;              // Bytes of the rows following the header.
+        uint64_t Checksum;          // 0 if the server computes none.
+        uint64_t DroppedCount;      // Frames dropped for this client so far.
+    };
+
+    static const uint32_t c_frameStreamVersion = 1;
+
+    // The checksum of the frames, a multiply-add over the 64-bit words and the remaining bytes. Never 0.
+    // The data can be added in parts, e.g. the rows of a padded frame, a word continues across the parts.
+    class CFrameStreamChecksum
+    {
+    public:
+        CFrameStreamChecksum()
+            : m_checksum( 0x84222325CBF29CE4ULL)
+            , m_pendingCount( 0)
+        {
+        }
+
+        void Add( const uint8_t* pData, size_t size)
+        {
+            size_t i = 0;
+            for (; m_pendingCount != 0 && i < size; ++i)
+            {
+                m_pending[m_pendingCount++] = pData[i];
+                if (m_pendingCount == 8)
+                {
+                    AddWord( m_pending);
+                    m_pendingCount = 0;
+                }
+            }
+            for (; i + 8 <= size; i += 8)
+            {
+                AddWord( pData + i);
+            }
+            for (; i < size; ++i)
+            {
+                m_pending[m_pendingCount++] = pData[i];
+            }
+        }
+
+        uint64_t Get() const
+        {
+            uint64_t checksum = m_checksum;
+            for (size_t i = 0; i < m_pendingCount; ++i)
+            {
+                checksum = (checksum ^ m_pending[i]) * 0x100000001B3ULL;
+            }
+            return checksum != 0 ? checksum : 1;
+        }
+
+    private:
+        void AddWord( const uint8_t* pWord)
+        {
+            uint64_t word;
+            memcpy( &word, pWord, 8);
+            m_checksum = (m_checksum ^ word) * 0x100000001B3ULL;
+        }
+
+        uint64_t m_checksum;
+        uint8_t m_pending[8];
+        size_t m_pendingCount;
+    };
+
+    inline uint64_t GetFrameStreamChecksum( const uint8_t* pData, size_t size)
+    {
+        CFrameStreamChecksum checksum;
+        checksum.Add( pData, size);
+        return checksum.Get();
+    }
+
+    namespace FrameStreamDetail
+    {
+#if defined(_WIN32)
+        typedef SOCKET Socket_t;
+        static const Socket_t c_invalidSocket = INVALID_SOCKET;
+
+        inline void InitializeSockets()
+        {
+            static const bool isInitialized = []()
+            {
+                WSADATA data;
+                return WSAStartup( MAKEWORD( 2, 2), &data) == 0;
+            }();
+            if (!isInitialized)
+            {
+                throw RUNTIME_EXCEPTION( "Could not initialize Windows Sockets.");
+            }
+        }
+
+        inline void CloseSocket( Socket_t socket)
+        {
+            closesocket( socket);
+        }
+#else
+        typedef int Socket_t;
+        static const Socket_t c_invalidSocket = -1;
+
+        inline void InitializeSockets()
+        {
+        }
+
+        inline void CloseSocket( Socket_t socket)
+        {
+            close( socket);
+        }
+#endif
+
+        struct SSendBuffer
+        {
+            const uint8_t* pData;
+            size_t Size;
+        };
+
+        // Sends the buffers, at most c_maxBuffers per call. Returns false if the connection is lost.
+        inline bool SendBuffers( Socket_t socket, const SSendBuffer* pBuffers, size_t count)
+        {
+            static const size_t c_maxBuffers = 64;
+            size_t index = 0;
+            size_t offset = 0;
+            while (index < count)
+            {
+                const size_t batch = std::min( count - index, c_maxBuffers);
+#if defined(_WIN32)
+                WSABUF buffers[c_maxBuffers];
+                for (size_t b = 0; b < batch; ++b)
+                {
+                    buffers[b].buf = reinterpret_cast<char*>(const_cast<uint8_t*>(pBuffers[index + b].pData)) + (b == 0 ? offset : 0);
+                    buffers[b].len = static_cast<ULONG>(pBuffers[index + b].Size - (b == 0 ? offset : 0));
+                }
+                DWORD sent = 0;
+                if (WSASend( socket, buffers, static_cast<DWORD>(batch), &sent, 0, NULL, NULL) != 0)
+                {
+                    return false;
+                }
+#else
+                iovec buffers[c_maxBuffers];
+                for (size_t b = 0; b < batch; ++b)
+                {
+                    buffers[b].iov_base = const_cast<uint8_t*>(pBuffers[index + b].pData) + (b == 0 ? offset : 0);
+                    buffers[b].iov_len = pBuffers[index + b].Size - (b == 0 ? offset : 0);
+                }
+                msghdr message;
+                memset( &message, 0, sizeof( message));
+                message.msg_iov = buffers;
+                message.msg_iovlen = batch;
+                const ssize_t sent = sendmsg( socket, &message, MSG_NOSIGNAL);
+                if (sent <= 0)
+                {
+                    return false;
+                }
+#endif
+                // Skips the buffers sent, a partial send continues within a buffer.
+                size_t remaining = static_cast<size_t>(sent);
+                while (index < count && remaining >= pBuffers[index].Size - offset)
+                {
+                    remaining -= pBuffers[index].Size - offset;
+                    offset = 0;
+                    ++index;
+                }
+                offset += remaining;
+            }
+            return true;
+        }
+
+        // Time a client has to send its subscription after connecting.
+        static const unsigned int c_subscriptionTimeoutMs = 5000;
+
+        inline void SetReceiveTimeout( Socket_t socket, unsigned int timeoutMs)
+        {
+#if defined(_WIN32)
+            const DWORD timeout = timeoutMs;
+#else
+            timeval timeout = { static_cast<time_t>(timeoutMs / 1000), static_cast<suseconds_t>(timeoutMs % 1000 * 1000) };
+#endif
+            setsockopt( socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof( timeout));
+        }
+
+        // Returns false if the connection is closed before size bytes are received or the receive timeout elapses.
+        inline bool ReceiveAll( Socket_t socket, void* pData, size_t size)
+        {
+            uint8_t* pBytes = static_cast<uint8_t*>(pData);
+            while (size > 0)
+            {
+                const int received = recv( socket, reinterpret_cast<char*>(pBytes), static_cast<int>(std::min( size, static_cast<size_t>(1) << 30)), 0);
+                if (received <= 0)
+                {
+                    return false;
+                }
+                pBytes += received;
+                size -= static_cast<size_t>(received);
+            }
+            return true;
+        }
+
+        // A frame queued for a client, a view of the grabbed frame or a rendered preview.
+        struct SQueuedFrame
+        {
+            CFrameView View;
+            std::shared_ptr< std::vector<uint8_t> > ptrPreview;
+            SFrameStreamHeader Header;
+        };
+
+        struct SClient
+        {
+            SClient()
+                : Socket( c_invalidSocket)
+                , Stream( FrameStream_Full)
+                , FrameInterval( 1)
+                , IsStopping( false)
+                , IsSubscribed( false)
+                , IsClosed( false)
+                , SentCount( 0)
+                , DroppedCount( 0)
+                , BytesSent( 0)
+            {
+            }
+
+            Socket_t Socket;
+            EFrameStream Stream;
+            uint32_t FrameInterval;
+            std::thread Thread;
+            std::mutex Lock;
+            std::condition_variable QueueChanged;
+            std::deque<SQueuedFrame> Queue;
+            bool IsStopping;
+            std::atomic<bool> IsSubscribed;     // Stream and FrameInterval are set.
+            std::atomic<bool> IsClosed;
+            std::atomic<uint64_t> SentCount;
+            std::atomic<uint64_t> DroppedCount;
+            std::atomic<uint64_t> BytesSent;
+        };
+    }
+
+    // The counts of a client of the server.
+    struct SFrameStreamClientStatistics
+    {
+        EFrameStream Stream;
+        uint64_t SentCount;
+        uint64_t DroppedCount;
+        uint64_t BytesSent;
+    };
+
+    class CFrameStreamServer
+    {
+    public:
+        explicit CFrameStreamServer( const SFrameStreamSettings& settings = SFrameStreamSettings())
+            : m_settings( settings)
+            , m_listenSocket( FrameStreamDetail::c_invalidSocket)
+            , m_port( 0)
+            , m_isStopping( false)
+            , m_publishedCount( 0)
+            , m_previewRenderer( settings.Preview)
+        {
+            if (m_settings.QueueDepth == 0)
+            {
+                throw RUNTIME_EXCEPTION( "The frame stream needs a queue depth of at least 1.");
+            }
+        }
+
+        ~CFrameStreamServer()
+        {
+            Stop();
+        }
+
+        // Listens on the port, 0 for any free port, see GetPort().
+        void Start( uint16_t port)
+        {
+            using namespace FrameStreamDetail;
+            Stop();
+            InitializeSockets();
+            m_listenSocket = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            sockaddr_in address;
+            memset( &address, 0, sizeof( address));
+            address.sin_family = AF_INET;
+            address.sin_port = htons( port);
+            inet_pton( AF_INET, m_settings.BindAddress.c_str(), &address.sin_addr);
+            const int reuse = 1;
+            setsockopt( m_listenSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof( reuse));
+            socklen_t addressSize = sizeof( address);
+            if (m_listenSocket == c_invalidSocket || bind( m_listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof( address)) != 0
+                || listen( m_listenSocket, 8) != 0 || getsockname( m_listenSocket, reinterpret_cast<sockaddr*>(&address), &addressSize) != 0)
+            {
+                if (m_listenSocket != c_invalidSocket)
+                {
+                    CloseSocket( m_listenSocket);
+                }
+                m_listenSocket = c_invalidSocket;
+                throw RUNTIME_EXCEPTION( "Could not listen on %s:%u for frame stream clients.", m_settings.BindAddress.c_str(), static_cast<unsigned int>(port));
+            }
+            m_port = ntohs( address.sin_port);
+            m_isStopping = false;
+            m_acceptThread = std::thread( &CFrameStreamServer::Accept, this);
+        }
+
+        // Closes the connections, the frames queued are not sent.
+        void Stop()
+        {
+            if (m_listenSocket == FrameStreamDetail::c_invalidSocket)
+            {
+                return;
+            }
+            m_isStopping = true;
+            m_acceptThread.join();
+            FrameStreamDetail::CloseSocket( m_listenSocket);
+            m_listenSocket = FrameStreamDetail::c_invalidSocket;
+
+            std::lock_guard<std::mutex> lock( m_clientsLock);
+            for (size_t i = 0; i < m_clients.size(); ++i)
+            {
+                CloseClient( *m_clients[i]);
+            }
+            m_clients.clear();
+        }
+
+        uint16_t GetPort() const
+        {
+            return m_port;
+        }
+
+        // Queues a frame for the clients. The view keeps its buffer until the frame is sent to all of them.
+        void Publish( const CFrameView& frame, uint64_t blockID = 0, int64_t timestamp = 0)
+        {
+            using namespace FrameStreamDetail;
+            SQueuedFrame queued;
+            memset( &queued.Header, 0, sizeof( queued.Header));
+            memcpy( queued.Header.Magic, "PYFS", 4);
+            queued.Header.HeaderSize = sizeof( SFrameStreamHeader);
+            queued.Header.FrameNumber = m_publishedCount++;
+            queued.Header.BlockID = blockID;
+            queued.Header.Timestamp = timestamp;
+            queued.Header.PublishTime = GetHostTimeNs();
+
+            std::lock_guard<std::mutex> lock( m_clientsLock);
+            SQueuedFrame preview;
+            for (size_t i = 0; i < m_clients.size(); ++i)
+            {
+                SClient& client = *m_clients[i];
+                if (!client.IsSubscribed || client.IsClosed || queued.Header.FrameNumber % client.FrameInterval != 0)
+                {
+                    continue;
+                }
+                if (client.Stream == FrameStream_Full)
+                {
+                    queued.View = frame;
+                    queued.Header.Width = frame.GetWidth();
+                    queued.Header.Height = frame.GetHeight();
+                    queued.Header.PixelType = static_cast<uint32_t>(frame.GetPixelType());
+                    queued.Header.Stream = FrameStream_Full;
+                    queued.Header.Size = static_cast<uint64_t>(frame.GetWidth()) * frame.GetBytesPerPixel() * frame.GetHeight();
+                    Enqueue( client, queued);
+                }
+                else if (RenderPreview( frame, queued.Header, preview))
+                {
+                    Enqueue( client, preview);
+                }
+            }
+        }
+
+        template <typename GrabResultPtrT>
+        void Publish( const GrabResultPtrT& ptrGrabResult, int64_t timestamp = 0)
+        {
+            if (ptrGrabResult->GrabSucceeded())
+            {
+                Publish( CFrameView::FromGrabResult( ptrGrabResult), ptrGrabResult->GetBlockID(), timestamp);
+            }
+        }
+
+        // The clients connected and subscribed.
+        size_t GetClientCount()
+        {
+            std::lock_guard<std::mutex> lock( m_clientsLock);
+            size_t count = 0;
+            for (size_t i = 0; i < m_clients.size(); ++i)
+            {
+                count += m_clients[i]->IsSubscribed && !m_clients[i]->IsClosed ? 1 : 0;
+            }
+            return count;
+        }
+
+        std::vector<SFrameStreamClientStatistics> GetClientStatistics()
+        {
+            std::lock_guard<std::mutex> lock( m_clientsLock);
+            std::vector<SFrameStreamClientStatistics> statistics;
+            for (size_t i = 0; i < m_clients.size(); ++i)
+            {
+                SFrameStreamClientStatistics client;
+                client.Stream = m_clients[i]->Stream;
+                client.SentCount = m_clients[i]->SentCount;
+                client.DroppedCount = m_clients[i]->DroppedCount;
+                client.BytesSent = m_clients[i]->BytesSent;
+                statistics.push_back( client);
+            }
+            return statistics;
+        }
+
+        uint64_t GetPublishedCount() const
+        {
+            return m_publishedCount;
+        }
+
+    private:
+        CFrameStreamServer( const CFrameStreamServer&);
+        CFrameStreamServer& operator=( const CFrameStreamServer&);
+
+        // Renders the preview of the frame once for all its clients. Returns false for unsupported pixel types.
+        bool RenderPreview( const CFrameView& frame, const SFrameStreamHeader& header, FrameStreamDetail::SQueuedFrame& preview)
+        {
+            if (preview.ptrPreview)
+            {
+                return true;
+            }
+            if (!CPreviewRenderer::IsSupported( frame.GetPixelType()))
+            {
+                return false;
+            }
+            m_previewRenderer.Render( frame.GetBuffer(), frame.GetPixelType(), frame.GetWidth(), frame.GetHeight(), frame.GetPaddingX());
+            const CPylonImage& image = m_previewRenderer.GetImage();
+            const uint8_t* pImage = static_cast<const uint8_t*>(image.GetBuffer());
+            preview.ptrPreview = std::make_shared< std::vector<uint8_t> >( pImage, pImage + image.GetImageSize());
+            preview.Header = header;
+            preview.Header.Width = image.GetWidth();
+            preview.Header.Height = image.GetHeight();
+            preview.Header.PixelType = static_cast<uint32_t>(image.GetPixelType());
+            preview.Header.Stream = FrameStream_Preview;
+            preview.Header.Size = image.GetImageSize();
+            return true;
+        }
+
+        void Enqueue( FrameStreamDetail::SClient& client, const FrameStreamDetail::SQueuedFrame& frame)
+        {
+            {
+                std::lock_guard<std::mutex> lock( client.Lock);
+                if (client.Queue.size() >= m_settings.QueueDepth)
+                {
+                    ++client.DroppedCount;
+                    if (m_settings.DropPolicy == FrameStreamDrop_Newest)
+                    {
+                        return;
+                    }
+                    client.Queue.pop_front();
+                }
+                client.Queue.push_back( frame);
+            }
+            client.QueueChanged.notify_one();
+        }
+
+        // The clients connected, including those not yet subscribed.
+        size_t GetConnectionCount()
+        {
+            std::lock_guard<std::mutex> lock( m_clientsLock);
+            size_t count = 0;
+            for (size_t i = 0; i < m_clients.size(); ++i)
+            {
+                count += m_clients[i]->IsClosed ? 0 : 1;
+            }
+            return count;
+        }
+
+        // Accepts the clients and removes the closed ones.
+        void Accept()
+        {
+            using namespace FrameStreamDetail;
+            while (!m_isStopping)
+            {
+                {
+                    std::lock_guard<std::mutex> lock( m_clientsLock);
+                    for (size_t i = 0; i < m_clients.size(); )
+                    {
+                        if (m_clients[i]->IsClosed)
+                        {
+                            CloseClient( *m_clients[i]);
+                            m_clients.erase( m_clients.begin() + i);
+                        }
+                        else
+                        {
+                            ++i;
+                        }
+                    }
+                }
+
+                fd_set sockets;
+                FD_ZERO( &sockets);
+                FD_SET( m_listenSocket, &sockets);
+                timeval timeout = { 0, 100000 };
+                if (select( static_cast<int>(m_listenSocket) + 1, &sockets, NULL, NULL, &timeout) <= 0)
+                {
+                    continue;
+                }
+                const Socket_t socket = accept( m_listenSocket, NULL, NULL);
+                if (socket == c_invalidSocket)
+                {
+                    continue;
+                }
+
+                if (GetConnectionCount() >= m_settings.MaxClients)
+                {
+                    CloseSocket( socket);
+                    continue;
+                }
+                // The thread of the client receives the subscription, a client not sending it does not hold up the others.
+                std::unique_ptr<SClient> ptrClient( new SClient());
+                ptrClient->Socket = socket;
+                const int noDelay = 1;
+                setsockopt( socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof( noDelay));
+
+                std::lock_guard<std::mutex> lock( m_clientsLock);
+                ptrClient->Thread = std::thread( &CFrameStreamServer::Send, this, ptrClient.get());
+                m_clients.push_back( std::shared_ptr<SClient>( ptrClient.release()));
+            }
+        }
+
+        // The thread of a client, receives its subscription and sends its queued frames.
+        void Send( FrameStreamDetail::SClient* pClient)
+        {
+            using namespace FrameStreamDetail;
+            SFrameStreamSubscription subscription;
+            SetReceiveTimeout( pClient->Socket, c_subscriptionTimeoutMs);
+            if (!ReceiveAll( pClient->Socket, &subscription, sizeof( subscription)) || memcmp( subscription.Magic, "PYSS", 4) != 0
+                || subscription.Version != c_frameStreamVersion)
+            {
+                pClient->IsClosed = true;
+                return;
+            }
+            pClient->Stream = subscription.Stream == FrameStream_Preview ? FrameStream_Preview : FrameStream_Full;
+            pClient->FrameInterval = std::max( subscription.FrameInterval, 1u);
+            pClient->IsSubscribed = true;
+
+            std::vector<SSendBuffer> buffers;
+            for (;;)
+            {
+                SQueuedFrame frame;
+                {
+                    std::unique_lock<std::mutex> lock( pClient->Lock);
+                    while (pClient->Queue.empty() && !pClient->IsStopping)
+                    {
+                        pClient->QueueChanged.wait( lock);
+                    }
+                    if (pClient->IsStopping)
+                    {
+                        break;
+                    }
+                    frame = pClient->Queue.front();
+                    pClient->Queue.pop_front();
+                }
+
+                frame.Header.DroppedCount = pClient->DroppedCount;
+                buffers.clear();
+                SSendBuffer header = { reinterpret_cast<const uint8_t*>(&frame.Header), sizeof( frame.Header) };
+                buffers.push_back( header);
+                if (frame.ptrPreview)
+                {
+                    SSendBuffer preview = { &(*frame.ptrPreview)[0], frame.ptrPreview->size() };
+                    buffers.push_back( preview);
+                }
+                else if (frame.View.GetPaddingX() == 0)
+                {
+                    SSendBuffer rows = { frame.View.GetBuffer(), static_cast<size_t>(frame.Header.Size) };
+                    buffers.push_back( rows);
+                }
+                else
+                {
+                    for (uint32_t y = 0; y < frame.View.GetHeight(); ++y)
+                    {
+                        SSendBuffer row = { frame.View.GetRow( y), frame.View.GetWidth() * frame.View.GetBytesPerPixel() };
+                        buffers.push_back( row);
+                    }
+                }
+                if (m_settings.ComputeChecksum)
+                {
+                    CFrameStreamChecksum checksum;
+                    for (size_t b = 1; b < buffers.size(); ++b)
+                    {
+                        checksum.Add( buffers[b].pData, buffers[b].Size);
+                    }
+                    frame.Header.Checksum = checksum.Get();
+                }
+
+                if (!SendBuffers( pClient->Socket, &buffers[0], buffers.size()))
+                {
+                    break;
+                }
+                ++pClient->SentCount;
+                pClient->BytesSent += sizeof( frame.Header) + frame.Header.Size;
+            }
+            pClient->IsClosed = true;
+        }
+
+        void CloseClient( FrameStreamDetail::SClient& client)
+        {
+            {
+                std::lock_guard<std::mutex> lock( client.Lock);
+                client.IsStopping = true;
+                client.Queue.clear();
+            }
+            client.QueueChanged.notify_one();
+            // Ends a send in progress.
+#if defined(_WIN32)
+            shutdown( client.Socket, SD_BOTH);
+#else
+            shutdown( client.Socket, SHUT_RDWR);
+#endif
+            client.Thread.join();
+            FrameStreamDetail::CloseSocket( client.Socket);
+        }
+
+        SFrameStreamSettings m_settings;
+        FrameStreamDetail::Socket_t m_listenSocket;
+        uint16_t m_port;
+        std::atomic<bool> m_isStopping;
+        std::thread m_acceptThread;
+        std::mutex m_clientsLock;
+        std::vector< std::shared_ptr<FrameStreamDetail::SClient> > m_clients;
+        uint64_t m_publishedCount;
+        CPreviewRenderer m_previewRenderer;
+    };
+
+    // Receives the frames of a CFrameStreamServer and checks them.
+    class CFrameStreamClient
+    {
+    public:
+        CFrameStreamClient()
+            : m_socket( FrameStreamDetail::c_invalidSocket)
+            , m_receivedCount( 0)
+            , m_nextFrameNumber( 0)
+        {
+        }
+
+        ~CFrameStreamClient()
+        {
+            Close();
+        }
+
+        void Connect( const std::string& host, uint16_t port, EFrameStream stream = FrameStream_Full, uint32_t frameInterval = 1)
+        {
+            using namespace FrameStreamDetail;
+            Close();
+            InitializeSockets();
+            sockaddr_in address;
+            memset( &address, 0, sizeof( address));
+            address.sin_family = AF_INET;
+            address.sin_port = htons( port);
+            m_socket = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            SFrameStreamSubscription subscription;
+            memcpy( subscription.Magic, "PYSS", 4);
+            subscription.Version = c_frameStreamVersion;
+            subscription.Stream = stream;
+            subscription.FrameInterval = frameInterval;
+            if (m_socket == c_invalidSocket || inet_pton( AF_INET, host.c_str(), &address.sin_addr) != 1
+                || connect( m_socket, reinterpret_cast<sockaddr*>(&address), sizeof( address)) != 0)
+            {
+                Close();
+                throw RUNTIME_EXCEPTION( "Could not connect to the frame stream %s:%u.", host.c_str(), static_cast<unsigned int>(port));
+            }
+            SSendBuffer buffer = { reinterpret_cast<const uint8_t*>(&subscription), sizeof( subscription) };
+            if (!SendBuffers( m_socket, &buffer, 1))
+            {
+                Close();
+                throw RUNTIME_EXCEPTION( "Could not subscribe to the frame stream %s:%u.", host.c_str(), static_cast<unsigned int>(port));
+            }
+            m_receivedCount = 0;
+            m_nextFrameNumber = 0;
+        }
+
+        // Receives the next frame. Returns false when the server closed the connection. Throws if the frame is corrupt.
+        bool Receive( SFrameStreamHeader& header, std::vector<uint8_t>& rows)
+        {
+            using namespace FrameStreamDetail;
+            if (!ReceiveAll( m_socket, &header, sizeof( header)))
+            {
+                return false;
+            }
+            if (memcmp( header.Magic, "PYFS", 4) != 0 || header.HeaderSize != sizeof( header)
+                || header.Size != static_cast<uint64_t>(header.Width) * header.Height * (BitPerPixel( static_cast<EPixelType>(header.PixelType)) / 8))
+            {
+                throw RUNTIME_EXCEPTION( "The frame stream sent an invalid header.");
+            }
+            if (header.FrameNumber < m_nextFrameNumber)
+            {
+                throw RUNTIME_EXCEPTION( "The frame stream sent frame %u after frame %u.", static_cast<unsigned int>(header.FrameNumber),
+                    static_cast<unsigned int>(m_nextFrameNumber - 1));
+            }
+            rows.resize( static_cast<size_t>(header.Size));
+            if (!ReceiveAll( m_socket, rows.empty() ? NULL : &rows[0], rows.size()))
+            {
+                return false;
+            }
+            if (header.Checksum != 0 && header.Checksum != GetFrameStreamChecksum( rows.empty() ? NULL : &rows[0], rows.size()))
+            {
+                throw RUNTIME_EXCEPTION( "Frame %u of the frame stream has a wrong checksum.", static_cast<unsigned int>(header.FrameNumber));
+            }
+            m_nextFrameNumber = header.FrameNumber + 1;
+            ++m_receivedCount;
+            return true;
+        }
+
+        void Close()
+        {
+            if (m_socket != FrameStreamDetail::c_invalidSocket)
+            {
+                FrameStreamDetail::CloseSocket( m_socket);
+            }
+            m_socket = FrameStreamDetail::c_invalidSocket;
+        }
+
+        uint64_t GetReceivedCount() const
+        {
+            return m_receivedCount;
+        }
+
+    private:
+        CFrameStreamClient( const CFrameStreamClient&);
+        CFrameStreamClient& operator=( const CFrameStreamClient&);
+
+        FrameStreamDetail::Socket_t m_socket;
+        uint64_t m_receivedCount;
+        uint64_t m_nextFrameNumber;
+    };
+}
+
+#endif /* INCLUDED_FRAMESTREAMSERVER_H_5819346 */
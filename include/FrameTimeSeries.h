@@ -0,0 +1,429 @@
+// Contains the per camera time series of the host and camera times of the frames of a run.
+/*
+   CFrameTimeSeries keeps two columns per camera, the host times and the camera times of the frames in
+   nanoseconds, as int64 values. It is sized at runtime by Reset() with the number of cameras and the
+   expected number of frames, so that a run of that length writes the times without allocating. A longer
+   run grows the columns by chunks of c_frameTimeChunkSize values, the chunks written never move, so
+   no time is copied while frames arrive. Every column has one writer, the grab thread of its camera or
+   the thread triggering it, so the columns need no lock. Frames without a time, e.g. without a Timestamp
+   chunk, are 0 when a later frame has one.
+
+       host times      GetHostTimeNs(), a steady clock, when a frame was triggered or arrived
+       camera times    the Timestamp chunk, ticks of the camera clock (ns for USB cameras)
+
+   GetFrameTiming() of a column gives the frame rate, mean, minimum and maximum interval and the interval
+   jitter like the function of the same name in FrameTiming.h, in seconds. The intervals are computed
+   in chunks with SSE2 or, if the compiler targets it, AVX2, converting the int64 differences to double
+   without leaving the vector registers, which is exact for intervals below 2^51 ns (26 days).
+
+   The series can be exported as CSV, one row per frame: camera,frame,host_ns,camera_ns, or in a binary
+   format holding the columns as they are:
+
+       SFrameTimeSeriesFileHeader
+       per camera: uint64 host count, uint64 camera count, the host times, the camera times
+
+   All values are stored little endian.
+*/
+
+#ifndef INCLUDED_FRAMETIMESERIES_H_5076133
+#define INCLUDED_FRAMETIMESERIES_H_5076133
+
+#include <pylon/PylonIncludes.h>
+#include "FrameTiming.h"
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#    include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace Pylon
+{
+    // Values per chunk of a column, 32 kB.
+    static const size_t c_frameTimeChunkSize = 4096;
+
+    // The host clock of the time series in ns.
+    inline int64_t GetHostTimeNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // A column of times in ns, stored in chunks that do not move when the column grows.
+    class CFrameTimeColumn
+    {
+    public:
+        CFrameTimeColumn()
+            : m_size( 0)
+        {
+        }
+
+        // Allocates the chunks for count values.
+        void Reserve( size_t count)
+        {
+            const size_t chunkCount = (count + c_frameTimeChunkSize - 1) / c_frameTimeChunkSize;
+            m_chunks.reserve( chunkCount);
+            while (m_chunks.size() < chunkCount)
+            {
+                m_chunks.push_back( std::vector<int64_t>( c_frameTimeChunkSize, 0));
+            }
+        }
+
+        // Empties the column and keeps its chunks.
+        void Clear()
+        {
+            for (size_t c = 0; c * c_frameTimeChunkSize < m_size; ++c)
+            {
+                std::fill( m_chunks[c].begin(), m_chunks[c].end(), 0);
+            }
+            m_size = 0;
+        }
+
+        // Sets the value of a frame. The column grows to index + 1 values, skipped values are 0.
+        void Set( size_t index, int64_t value)
+        {
+            if (index >= m_chunks.size() * c_frameTimeChunkSize)
+            {
+                Reserve( index + 1);
+            }
+            m_chunks[index / c_frameTimeChunkSize][index % c_frameTimeChunkSize] = value;
+            m_size = std::max( m_size, index + 1);
+        }
+
+        int64_t operator[]( size_t index) const
+        {
+            return m_chunks[index / c_frameTimeChunkSize][index % c_frameTimeChunkSize];
+        }
+
+        size_t GetSize() const
+        {
+            return m_size;
+        }
+
+        // The chunks hold the values [c * c_frameTimeChunkSize, (c + 1) * c_frameTimeChunkSize).
+        size_t GetChunkCount() const
+        {
+            return (m_size + c_frameTimeChunkSize - 1) / c_frameTimeChunkSize;
+        }
+
+        const int64_t* GetChunk( size_t chunk) const
+        {
+            return &m_chunks[chunk][0];
+        }
+
+        // The number of values of the column in a chunk.
+        size_t GetChunkSize( size_t chunk) const
+        {
+            return std::min( c_frameTimeChunkSize, m_size - chunk * c_frameTimeChunkSize);
+        }
+
+    private:
+        std::vector< std::vector<int64_t> > m_chunks;
+        size_t m_size;
+    };
+
+    namespace FrameTimeSeriesDetail
+    {
+        // Sums of the intervals minus a pivot close to them, so that the sum of squares keeps its precision.
+        struct SIntervalSums
+        {
+            SIntervalSums()
+                : Count( 0)
+                , Sum( 0.0)
+                , SumOfSquares( 0.0)
+                , Min( std::numeric_limits<double>::max())
+                , Max( -std::numeric_limits<double>::max())
+            {
+            }
+
+            size_t Count;
+            double Sum;
+            double SumOfSquares;
+            double Min;
+            double Max;
+        };
+
+        inline void AddIntervalsScalar( const int64_t* pTimes, size_t first, size_t count, double pivot, SIntervalSums& sums)
+        {
+            for (size_t i = first; i < count; ++i)
+            {
+                const double interval = static_cast<double>(pTimes[i + 1] - pTimes[i]);
+                const double deviation = interval - pivot;
+                sums.Sum += deviation;
+                sums.SumOfSquares += deviation * deviation;
+                sums.Min = std::min( sums.Min, interval);
+                sums.Max = std::max( sums.Max, interval);
+            }
+            sums.Count += count > first ? count - first : 0;
+        }
+
+        // Adds the count intervals pTimes[i + 1] - pTimes[i]. Converts int64 to double by adding the bits of
+        // 2^52 + 2^51, which leaves the value in the mantissa, and subtracting 2^52 + 2^51 as double.
+        inline void AddIntervals( const int64_t* pTimes, size_t count, double pivot, SIntervalSums& sums)
+        {
+            size_t i = 0;
+#if defined(__AVX2__)
+            if (count >= 4)
+            {
+                const __m256d magic = _mm256_set1_pd( 6755399441055744.0);
+                const __m256d pivots = _mm256_set1_pd( pivot);
+                __m256d sum = _mm256_setzero_pd();
+                __m256d sumOfSquares = _mm256_setzero_pd();
+                __m256d minimum = _mm256_set1_pd( sums.Min);
+                __m256d maximum = _mm256_set1_pd( sums.Max);
+                for (; i + 4 <= count; i += 4)
+                {
+                    const __m256i intervals = _mm256_sub_epi64( _mm256_loadu_si256( reinterpret_cast<const __m256i*>(pTimes + i + 1)),
+                        _mm256_loadu_si256( reinterpret_cast<const __m256i*>(pTimes + i)));
+                    const __m256d values = _mm256_sub_pd( _mm256_castsi256_pd( _mm256_add_epi64( intervals, _mm256_castpd_si256( magic))), magic);
+                    const __m256d deviations = _mm256_sub_pd( values, pivots);
+                    sum = _mm256_add_pd( sum, deviations);
+                    sumOfSquares = _mm256_add_pd( sumOfSquares, _mm256_mul_pd( deviations, deviations));
+                    minimum = _mm256_min_pd( minimum, values);
+                    maximum = _mm256_max_pd( maximum, values);
+                }
+                double lanes[4][4];
+                _mm256_storeu_pd( lanes[0], sum);
+                _mm256_storeu_pd( lanes[1], sumOfSquares);
+                _mm256_storeu_pd( lanes[2], minimum);
+                _mm256_storeu_pd( lanes[3], maximum);
+                for (int l = 0; l < 4; ++l)
+                {
+                    sums.Sum += lanes[0][l];
+                    sums.SumOfSquares += lanes[1][l];
+                    sums.Min = std::min( sums.Min, lanes[2][l]);
+                    sums.Max = std::max( sums.Max, lanes[3][l]);
+                }
+                sums.Count += i;
+            }
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+            if (count >= 2)
+            {
+                const __m128d magic = _mm_set1_pd( 6755399441055744.0);
+                const __m128d pivots = _mm_set1_pd( pivot);
+                __m128d sum = _mm_setzero_pd();
+                __m128d sumOfSquares = _mm_setzero_pd();
+                __m128d minimum = _mm_set1_pd( sums.Min);
+                __m128d maximum = _mm_set1_pd( sums.Max);
+                for (; i + 2 <= count; i += 2)
+                {
+                    const __m128i intervals = _mm_sub_epi64( _mm_loadu_si128( reinterpret_cast<const __m128i*>(pTimes + i + 1)),
+                        _mm_loadu_si128( reinterpret_cast<const __m128i*>(pTimes + i)));
+                    const __m128d values = _mm_sub_pd( _mm_castsi128_pd( _mm_add_epi64( intervals, _mm_castpd_si128( magic))), magic);
+                    const __m128d deviations = _mm_sub_pd( values, pivots);
+                    sum = _mm_add_pd( sum, deviations);
+                    sumOfSquares = _mm_add_pd( sumOfSquares, _mm_mul_pd( deviations, deviations));
+                    minimum = _mm_min_pd( minimum, values);
+                    maximum = _mm_max_pd( maximum, values);
+                }
+                double lanes[4][2];
+                _mm_storeu_pd( lanes[0], sum);
+                _mm_storeu_pd( lanes[1], sumOfSquares);
+                _mm_storeu_pd( lanes[2], minimum);
+                _mm_storeu_pd( lanes[3], maximum);
+                for (int l = 0; l < 2; ++l)
+                {
+                    sums.Sum += lanes[0][l];
+                    sums.SumOfSquares += lanes[1][l];
+                    sums.Min = std::min( sums.Min, lanes[2][l]);
+                    sums.Max = std::max( sums.Max, lanes[3][l]);
+                }
+                sums.Count += i;
+            }
+#endif
+            AddIntervalsScalar( pTimes, i, count, pivot, sums);
+        }
+    }
+
+    // Computes the timing of the frames with the times of a column in ns, in the order of the frames. The figures are in seconds.
+    inline SFrameTiming GetFrameTiming( const CFrameTimeColumn& times)
+    {
+        SFrameTiming timing;
+        timing.FrameCount = times.GetSize();
+        if (times.GetSize() < 2)
+        {
+            return timing;
+        }
+
+        const double pivot = static_cast<double>(times[1] - times[0]);
+        FrameTimeSeriesDetail::SIntervalSums sums;
+        for (size_t c = 0; c < times.GetChunkCount(); ++c)
+        {
+            const int64_t* pChunk = times.GetChunk( c);
+            const size_t chunkSize = times.GetChunkSize( c);
+            FrameTimeSeriesDetail::AddIntervals( pChunk, chunkSize - 1, pivot, sums);
+            // The interval to the first frame of the next chunk.
+            if (c + 1 < times.GetChunkCount())
+            {
+                const int64_t pair[2] = { pChunk[chunkSize - 1], times.GetChunk( c + 1)[0] };
+                FrameTimeSeriesDetail::AddIntervalsScalar( pair, 0, 1, pivot, sums);
+            }
+        }
+
+        const size_t intervalCount = times.GetSize() - 1;
+        const double meanDeviation = sums.Sum / intervalCount;
+        timing.MeanInterval = static_cast<double>(times[times.GetSize() - 1] - times[0]) / intervalCount * 1e-9;
+        timing.FrameRate = timing.MeanInterval > 0.0 ? 1.0 / timing.MeanInterval : 0.0;
+        timing.IntervalJitter = std::sqrt( std::max( sums.SumOfSquares / intervalCount - meanDeviation * meanDeviation, 0.0)) * 1e-9;
+        timing.MinInterval = sums.Min * 1e-9;
+        timing.MaxInterval = sums.Max * 1e-9;
+        return timing;
+    }
+
+    struct SFrameTimeSeriesFileHeader
+    {
+        char Magic[8];              // "PYTIMES\0"
+        uint32_t Version;
+        uint32_t HeaderSize;
+        uint32_t CameraCount;
+        uint32_t Reserved0;
+        uint64_t Reserved[4];
+    };
+
+    static const uint32_t c_frameTimeSeriesVersion = 1;
+
+    // The host and camera times of the frames of every camera.
+    class CFrameTimeSeries
+    {
+    public:
+        CFrameTimeSeries()
+        {
+        }
+
+        CFrameTimeSeries( size_t cameraCount, size_t expectedFrameCount)
+        {
+            Reset( cameraCount, expectedFrameCount);
+        }
+
+        // Empties the columns and allocates them for expectedFrameCount frames per camera.
+        void Reset( size_t cameraCount, size_t expectedFrameCount)
+        {
+            m_hostTimes.resize( cameraCount);
+            m_cameraTimes.resize( cameraCount);
+            for (size_t i = 0; i < cameraCount; ++i)
+            {
+                m_hostTimes[i].Clear();
+                m_hostTimes[i].Reserve( expectedFrameCount);
+                m_cameraTimes[i].Clear();
+                m_cameraTimes[i].Reserve( expectedFrameCount);
+            }
+        }
+
+        size_t GetCameraCount() const
+        {
+            return m_hostTimes.size();
+        }
+
+        void SetHostTime( size_t camera, size_t frame, int64_t timeNs)
+        {
+            m_hostTimes[camera].Set( frame, timeNs);
+        }
+
+        void SetCameraTime( size_t camera, size_t frame, int64_t timeNs)
+        {
+            m_cameraTimes[camera].Set( frame, timeNs);
+        }
+
+        const CFrameTimeColumn& GetHostTimes( size_t camera) const
+        {
+            return m_hostTimes[camera];
+        }
+
+        const CFrameTimeColumn& GetCameraTimes( size_t camera) const
+        {
+            return m_cameraTimes[camera];
+        }
+
+        // The larger of the frame counts of the two columns of a camera.
+        size_t GetFrameCount( size_t camera) const
+        {
+            return std::max( m_hostTimes[camera].GetSize(), m_cameraTimes[camera].GetSize());
+        }
+
+        // Writes one row per frame and camera. Times a column lacks are left empty.
+        void WriteCsv( const char* fileName) const
+        {
+            FILE* pFile = fopen( fileName, "w");
+            if (pFile == NULL)
+            {
+                throw RUNTIME_EXCEPTION( "Could not create the time series %s.", fileName);
+            }
+            fprintf( pFile, "camera,frame,host_ns,camera_ns\n");
+            for (size_t camera = 0; camera < GetCameraCount(); ++camera)
+            {
+                const CFrameTimeColumn& hostTimes = m_hostTimes[camera];
+                const CFrameTimeColumn& cameraTimes = m_cameraTimes[camera];
+                for (size_t frame = 0; frame < GetFrameCount( camera); ++frame)
+                {
+                    char host[32] = "";
+                    char cameraTime[32] = "";
+                    if (frame < hostTimes.GetSize())
+                    {
+                        sprintf( host, "%lld", static_cast<long long>(hostTimes[frame]));
+                    }
+                    if (frame < cameraTimes.GetSize())
+                    {
+                        sprintf( cameraTime, "%lld", static_cast<long long>(cameraTimes[frame]));
+                    }
+                    fprintf( pFile, "%u,%u,%s,%s\n", static_cast<unsigned int>(camera), static_cast<unsigned int>(frame), host, cameraTime);
+                }
+            }
+            if (fclose( pFile) != 0)
+            {
+                throw RUNTIME_EXCEPTION( "Could not write the time series %s.", fileName);
+            }
+        }
+
+        void WriteBinary( const char* fileName) const
+        {
+            FILE* pFile = fopen( fileName, "wb");
+            if (pFile == NULL)
+            {
+                throw RUNTIME_EXCEPTION( "Could not create the time series %s.", fileName);
+            }
+            SFrameTimeSeriesFileHeader header;
+            memset( &header, 0, sizeof( header));
+            memcpy( header.Magic, "PYTIMES", 8);
+            header.Version = c_frameTimeSeriesVersion;
+            header.HeaderSize = sizeof( header);
+            header.CameraCount = static_cast<uint32_t>(GetCameraCount());
+            bool isWritten = fwrite( &header, sizeof( header), 1, pFile) == 1;
+            for (size_t camera = 0; camera < GetCameraCount() && isWritten; ++camera)
+            {
+                const uint64_t counts[2] = { m_hostTimes[camera].GetSize(), m_cameraTimes[camera].GetSize() };
+                isWritten = fwrite( counts, sizeof( counts), 1, pFile) == 1
+                    && WriteColumn( m_hostTimes[camera], pFile)
+                    && WriteColumn( m_cameraTimes[camera], pFile);
+            }
+            if (fclose( pFile) != 0 || !isWritten)
+            {
+                throw RUNTIME_EXCEPTION( "Could not write the time series %s.", fileName);
+            }
+        }
+
+    private:
+        static bool WriteColumn( const CFrameTimeColumn& column, FILE* pFile)
+        {
+            for (size_t c = 0; c < column.GetChunkCount(); ++c)
+            {
+                if (fwrite( column.GetChunk( c), sizeof( int64_t), column.GetChunkSize( c), pFile) != column.GetChunkSize( c))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        std::vector<CFrameTimeColumn> m_hostTimes;
+        std::vector<CFrameTimeColumn> m_cameraTimes;
+    };
+}
+
+#endif /* INCLUDED_FRAMETIMESERIES_H_5076133 */
@@ -0,0 +1,71 @@
+// Contains the frame rate and interval jitter of a sequence of frame time stamps.
+/*
+   The time stamps are the camera clock of the Timestamp chunk, so the figures describe when the sensor
+   exposed the frames and not when the host received them. The frame rate counts the intervals between
+   the first and the last frame, the jitter is the standard deviation of the intervals. A lost frame
+   shows as an interval of about twice the mean and raises the jitter.
+*/
+
+#ifndef INCLUDED_FRAMETIMING_H_6352018
+#define INCLUDED_FRAMETIMING_H_6352018
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace Pylon
+{
+    struct SFrameTiming
+    {
+        SFrameTiming()
+            : FrameCount( 0)
+            , FrameRate( 0.0)
+            , MeanInterval( 0.0)
+            , IntervalJitter( 0.0)
+            , MinInterval( 0.0)
+            , MaxInterval( 0.0)
+        {
+        }
+
+        size_t FrameCount;
+        double FrameRate;           // Frames per second.
+        double MeanInterval;        // Intervals in seconds.
+        double IntervalJitter;      // Standard deviation of the intervals.
+        double MinInterval;
+        double MaxInterval;
+    };
+
+    // Computes the timing of the frames with the given time stamps in seconds, in the order of the frames.
+    inline SFrameTiming GetFrameTiming( const std::vector<double>& timeStamps)
+    {
+        SFrameTiming timing;
+        timing.FrameCount = timeStamps.size();
+        if (timeStamps.size() < 2)
+        {
+            return timing;
+        }
+
+        const size_t intervalCount = timeStamps.size() - 1;
+        timing.MinInterval = timeStamps[1] - timeStamps[0];
+        timing.MaxInterval = timing.MinInterval;
+        for (size_t i = 1; i < timeStamps.size(); ++i)
+        {
+            const double interval = timeStamps[i] - timeStamps[i - 1];
+            timing.MinInterval = std::min( timing.MinInterval, interval);
+            timing.MaxInterval = std::max( timing.MaxInterval, interval);
+        }
+        timing.MeanInterval = (timeStamps.back() - timeStamps.front()) / intervalCount;
+        timing.FrameRate = timing.MeanInterval > 0.0 ? 1.0 / timing.MeanInterval : 0.0;
+
+        double sumOfSquares = 0.0;
+        for (size_t i = 1; i < timeStamps.size(); ++i)
+        {
+            const double deviation = timeStamps[i] - timeStamps[i - 1] - timing.MeanInterval;
+            sumOfSquares += deviation * deviation;
+        }
+        timing.IntervalJitter = std::sqrt( sumOfSquares / intervalCount);
+        return timing;
+    }
+}
+
+#endif /* INCLUDED_FRAMETIMING_H_6352018 */
@@ -0,0 +1,229 @@
+// Contains a view of a rectangle of a frame buffer that does not copy the pixels.
+/*
+   Several algorithms working on their own rectangles of the same frame either copied them, e.g. into a
+   CPylonImage, or got the whole buffer and its size. A CFrameView describes a rectangle of a buffer by the
+   address of its first pixel, its size, the stride between its rows and its pixel type:
+
+       CFrameView frame = CFrameView::FromGrabResult( ptrGrabResult);
+       CFrameView spot = frame.Crop( 100, 80, 64, 64);
+       const uint16_t* pRow = spot.GetRow<uint16_t>( 0);
+
+   Crop() returns a view of a part of a view, without copying. Cropping a Bayer frame at an odd column or
+   row changes the color of the first pixel, the pixel type of the view tells the pattern as seen from its
+   origin, e.g. BayerBG12 for a BayerGB12 frame cropped at an odd column. CropBayerCells() extends the
+   rectangle to whole 2x2 cells instead, so that the pattern stays the one of the frame. GetPaddingX()
+   gives the bytes after each row, a view can be passed to functions taking a buffer, its size and the
+   padding, like CFrameStatisticsCalculator::Compute().
+
+   The views of a grab result share the reference to it. The buffer is returned to the camera when the
+   last view and the grab result are released, a view held for long keeps a buffer from the driver like a
+   held grab result. Views of other buffers take a shared pointer to the owner, or none if the caller
+   keeps the buffer alive. Packed pixel types are not supported.
+*/
+
+#ifndef INCLUDED_FRAMEVIEW_H_6158203
+#define INCLUDED_FRAMEVIEW_H_6158203
+
+#include <pylon/PylonIncludes.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace Pylon
+{
+    // Returns the pixel type of the Bayer pattern seen from the pixel x, y of a frame with the given pattern.
+    // Other pixel types are returned unchanged.
+    inline EPixelType GetBayerPixelTypeAt( EPixelType pixelType, uint32_t x, uint32_t y)
+    {
+        // The patterns of one bit depth in the order GR, RG, BG, GB: an odd column toggles bit 0 of the index, an odd row bit 1.
+        static const EPixelType patterns[3][4] =
+        {
+            { PixelType_BayerGR8, PixelType_BayerRG8, PixelType_BayerBG8, PixelType_BayerGB8 },
+            { PixelType_BayerGR10, PixelType_BayerRG10, PixelType_BayerBG10, PixelType_BayerGB10 },
+            { PixelType_BayerGR12, PixelType_BayerRG12, PixelType_BayerBG12, PixelType_BayerGB12 }
+        };
+        for (int depth = 0; depth < 3; ++depth)
+        {
+            for (int phase = 0; phase < 4; ++phase)
+            {
+                if (patterns[depth][phase] == pixelType)
+                {
+                    return patterns[depth][phase ^ static_cast<int>((x & 1) | ((y & 1) << 1))];
+                }
+            }
+        }
+        return pixelType;
+    }
+
+    class CFrameView
+    {
+    public:
+        CFrameView()
+            : m_pBuffer( NULL)
+            , m_pixelType( PixelType_Undefined)
+            , m_width( 0)
+            , m_height( 0)
+            , m_stride( 0)
+            , m_offsetX( 0)
+            , m_offsetY( 0)
+        {
+        }
+
+        // A view of a buffer with the given stride in bytes. The owner keeps the buffer alive, it may be empty.
+        CFrameView( const void* pBuffer, EPixelType pixelType, uint32_t width, uint32_t height, size_t stride,
+            const std::shared_ptr<const void>& ptrOwner = std::shared_ptr<const void>(), uint32_t offsetX = 0, uint32_t offsetY = 0)
+            : m_pBuffer( static_cast<const uint8_t*>(pBuffer))
+            , m_pixelType( pixelType)
+            , m_width( width)
+            , m_height( height)
+            , m_stride( stride)
+            , m_offsetX( offsetX)
+            , m_offsetY( offsetY)
+            , m_ptrOwner( ptrOwner)
+        {
+            if (IsPacked( pixelType) || BitPerPixel( pixelType) % 8 != 0)
+            {
+                throw RUNTIME_EXCEPTION( "Frame views of packed pixel types are not supported.");
+            }
+            if (stride < width * GetBytesPerPixel())
+            {
+                throw RUNTIME_EXCEPTION( "The stride of %u bytes is smaller than a row of %u pixels.", static_cast<unsigned int>(stride), width);
+            }
+        }
+
+        // A view of the whole image of a grab result. The views share one reference to the grab result.
+        template <typename GrabResultPtrT>
+        static CFrameView FromGrabResult( const GrabResultPtrT& ptrGrabResult)
+        {
+            const EPixelType pixelType = ptrGrabResult->GetPixelType();
+            const uint32_t width = ptrGrabResult->GetWidth();
+            const size_t stride = static_cast<size_t>(width) * (BitPerPixel( pixelType) / 8) + ptrGrabResult->GetPaddingX();
+            return CFrameView( ptrGrabResult->GetBuffer(), pixelType, width, ptrGrabResult->GetHeight(), stride,
+                std::make_shared<GrabResultPtrT>( ptrGrabResult), ptrGrabResult->GetOffsetX(), ptrGrabResult->GetOffsetY());
+        }
+
+        bool IsValid() const
+        {
+            return m_pBuffer != NULL;
+        }
+
+        // Returns a view of the rectangle x, y, width, height of this view.
+        CFrameView Crop( uint32_t x, uint32_t y, uint32_t width, uint32_t height) const
+        {
+            if (x > m_width || y > m_height || width > m_width - x || height > m_height - y)
+            {
+                throw RUNTIME_EXCEPTION( "The rectangle %ux%u+%u+%u is not within the %ux%u view.", width, height, x, y, m_width, m_height);
+            }
+            CFrameView view( *this);
+            view.m_pBuffer = m_pBuffer + y * m_stride + x * GetBytesPerPixel();
+            view.m_pixelType = GetBayerPixelTypeAt( m_pixelType, x, y);
+            view.m_width = width;
+            view.m_height = height;
+            view.m_offsetX = m_offsetX + x;
+            view.m_offsetY = m_offsetY + y;
+            return view;
+        }
+
+        // Like Crop(), but a Bayer view is extended to whole 2x2 cells and keeps the pattern of this view.
+        CFrameView CropBayerCells( uint32_t x, uint32_t y, uint32_t width, uint32_t height) const
+        {
+            if (!IsBayer( m_pixelType))
+            {
+                return Crop( x, y, width, height);
+            }
+            const uint32_t left = x & ~1u;
+            const uint32_t top = y & ~1u;
+            const uint32_t right = std::min( (x + width + 1) & ~1u, m_width & ~1u);
+            const uint32_t bottom = std::min( (y + height + 1) & ~1u, m_height & ~1u);
+            return Crop( left, top, right > left ? right - left : 0, bottom > top ? bottom - top : 0);
+        }
+
+        const uint8_t* GetBuffer() const
+        {
+            return m_pBuffer;
+        }
+
+        const uint8_t* GetRow( uint32_t y) const
+        {
+            return m_pBuffer + y * m_stride;
+        }
+
+        // The pixels of a row, e.g. GetRow<uint16_t>( y) for Mono12.
+        template <typename PixelT>
+        const PixelT* GetRow( uint32_t y) const
+        {
+            return reinterpret_cast<const PixelT*>(m_pBuffer + y * m_stride);
+        }
+
+        // Copies the pixels to a buffer with the given stride.
+        void CopyTo( void* pDestination, size_t destinationStride) const
+        {
+            const size_t rowSize = m_width * GetBytesPerPixel();
+            for (uint32_t y = 0; y < m_height; ++y)
+            {
+                memcpy( static_cast<uint8_t*>(pDestination) + y * destinationStride, GetRow( y), rowSize);
+            }
+        }
+
+        EPixelType GetPixelType() const
+        {
+            return m_pixelType;
+        }
+
+        uint32_t GetWidth() const
+        {
+            return m_width;
+        }
+
+        uint32_t GetHeight() const
+        {
+            return m_height;
+        }
+
+        size_t GetStride() const
+        {
+            return m_stride;
+        }
+
+        // The bytes following the pixels of each row.
+        size_t GetPaddingX() const
+        {
+            return m_stride - m_width * GetBytesPerPixel();
+        }
+
+        size_t GetBytesPerPixel() const
+        {
+            return BitPerPixel( m_pixelType) / 8;
+        }
+
+        // The position of the view on the sensor, the offsets of the grab result plus the crops.
+        uint32_t GetOffsetX() const
+        {
+            return m_offsetX;
+        }
+
+        uint32_t GetOffsetY() const
+        {
+            return m_offsetY;
+        }
+
+        // Releases the reference to the owner of the buffer.
+        void Release()
+        {
+            *this = CFrameView();
+        }
+
+    private:
+        const uint8_t* m_pBuffer;
+        EPixelType m_pixelType;
+        uint32_t m_width;
+        uint32_t m_height;
+        size_t m_stride;
+        uint32_t m_offsetX;
+        uint32_t m_offsetY;
+        std::shared_ptr<const void> m_ptrOwner;
+    };
+}
+
+#endif /* INCLUDED_FRAMEVIEW_H_6158203 */
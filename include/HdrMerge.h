@@ -0,0 +1,319 @@
+// Contains the merge of exposure-bracketed frames into a linear high dynamic range image.
+/*
+   Every frame of a bracket measures the radiance of each pixel, scaled by its exposure time and gain.
+   CHdrMerger converts the pixel values of all frames to the scale of the frame with the largest exposure,
+   i.e. exposure time times linear gain, and averages them weighted by the inverse of their variance:
+   shot noise of ConversionGain DN per electron plus read noise. Values at or above SaturationLevel are not
+   used. A pixel saturated in all frames gets the saturation level of the shortest exposure, the lower bound
+   of its radiance. The result is a float per pixel, linear in the radiance, in DN above BlackLevel of the
+   longest exposure, ranging up to the saturation level times the ratio of the longest to the shortest exposure.
+
+   The frames are 16-bit images like Mono12 or BayerGB12; pixels are merged independently, so Bayer frames
+   give a merged Bayer image. The image is split into strips of rows merged in parallel, and within a row
+   the pixels of all frames are combined in registers, 4 with SSE2 or 8 with AVX2 if the compiler targets
+   it, in one pass over the frames.
+*/
+
+#ifndef INCLUDED_HDRMERGE_H_8053716
+#define INCLUDED_HDRMERGE_H_8053716
+
+#include <pylon/PylonIncludes.h>
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#    include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace Pylon
+{
+    struct SHdrMergeSettings
+    {
+        SHdrMergeSettings()
+            : BlackLevel( 0.0)
+            , SaturationLevel( 4000.0)
+            , ConversionGain( 1.0)
+            , ReadNoise( 2.0)
+            , StripRows( 32)
+            , NumThreads( 0)
+        {
+        }
+
+        double BlackLevel;          // DN
+        double SaturationLevel;     // DN, values at or above are clipped.
+        double ConversionGain;      // DN per electron at gain 0 dB, for the shot noise.
+        double ReadNoise;           // DN rms.
+        uint32_t StripRows;         // Rows per strip merged by one thread.
+        unsigned int NumThreads;    // 0 uses one thread per hardware thread.
+    };
+
+    // One frame of a bracket.
+    struct SHdrFrame
+    {
+        SHdrFrame()
+            : pBuffer( NULL)
+            , PixelType( PixelType_Undefined)
+            , Width( 0)
+            , Height( 0)
+            , PaddingX( 0)
+            , ExposureTime( 0.0)
+            , Gain( 0.0)
+        {
+        }
+
+        const void* pBuffer;
+        EPixelType PixelType;
+        uint32_t Width;
+        uint32_t Height;
+        size_t PaddingX;
+        double ExposureTime;        // us
+        double Gain;                // dB
+    };
+
+    namespace HdrMergeDetail
+    {
+        // Constants of the merge of one row.
+        struct SRowConstants
+        {
+            float BlackLevel;
+            float SaturationLevel;
+            float ConversionGain;
+            float ReadNoiseVariance;
+            float Fallback;                 // Result of pixels saturated in all frames.
+            const float* pScales;           // Per frame: factor to the scale of the longest exposure,
+            const float* pWeights;          // and the weight of its inverse squared.
+            const float* pConversionGains;  // DN per electron at the gain of the frame.
+            size_t FrameCount;
+        };
+
+        inline void MergePixelsScalar( const uint16_t* const* pRows, const SRowConstants& k, uint32_t first, uint32_t count, float* pOut)
+        {
+            for (uint32_t x = first; x < count; ++x)
+            {
+                float sum = 0.0f;
+                float weightSum = 0.0f;
+                for (size_t i = 0; i < k.FrameCount; ++i)
+                {
+                    const float value = pRows[i][x];
+                    if (value < k.SaturationLevel)
+                    {
+                        const float signal = std::max( value - k.BlackLevel, 0.0f);
+                        const float weight = k.pWeights[i] / (k.pConversionGains[i] * signal + k.ReadNoiseVariance);
+                        sum += weight * signal * k.pScales[i];
+                        weightSum += weight;
+                    }
+                }
+                pOut[x] = weightSum > 0.0f ? sum / weightSum : k.Fallback;
+            }
+        }
+
+        inline void MergeRow( const uint16_t* const* pRows, const SRowConstants& k, uint32_t width, float* pOut)
+        {
+            uint32_t x = 0;
+#if defined(__AVX2__)
+            const __m256 blackLevel = _mm256_set1_ps( k.BlackLevel);
+            const __m256 saturationLevel = _mm256_set1_ps( k.SaturationLevel);
+            const __m256 readNoiseVariance = _mm256_set1_ps( k.ReadNoiseVariance);
+            const __m256 fallback = _mm256_set1_ps( k.Fallback);
+            const __m256 zero = _mm256_setzero_ps();
+            for (; x + 8 <= width; x += 8)
+            {
+                __m256 sum = zero;
+                __m256 weightSum = zero;
+                for (size_t i = 0; i < k.FrameCount; ++i)
+                {
+                    const __m256 value = _mm256_cvtepi32_ps( _mm256_cvtepu16_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>(pRows[i] + x))));
+                    const __m256 isValid = _mm256_cmp_ps( value, saturationLevel, _CMP_LT_OQ);
+                    const __m256 signal = _mm256_max_ps( _mm256_sub_ps( value, blackLevel), zero);
+                    const __m256 variance = _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( k.pConversionGains[i]), signal), readNoiseVariance);
+                    const __m256 weight = _mm256_and_ps( isValid, _mm256_div_ps( _mm256_set1_ps( k.pWeights[i]), variance));
+                    sum = _mm256_add_ps( sum, _mm256_mul_ps( weight, _mm256_mul_ps( signal, _mm256_set1_ps( k.pScales[i]))));
+                    weightSum = _mm256_add_ps( weightSum, weight);
+                }
+                const __m256 hasWeight = _mm256_cmp_ps( weightSum, zero, _CMP_GT_OQ);
+                const __m256 merged = _mm256_div_ps( sum, _mm256_blendv_ps( _mm256_set1_ps( 1.0f), weightSum, hasWeight));
+                _mm256_storeu_ps( pOut + x, _mm256_blendv_ps( fallback, merged, hasWeight));
+            }
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+            const __m128 blackLevel = _mm_set1_ps( k.BlackLevel);
+            const __m128 saturationLevel = _mm_set1_ps( k.SaturationLevel);
+            const __m128 readNoiseVariance = _mm_set1_ps( k.ReadNoiseVariance);
+            const __m128 fallback = _mm_set1_ps( k.Fallback);
+            const __m128 one = _mm_set1_ps( 1.0f);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128i zero16 = _mm_setzero_si128();
+            for (; x + 4 <= width; x += 4)
+            {
+                __m128 sum = zero;
+                __m128 weightSum = zero;
+                for (size_t i = 0; i < k.FrameCount; ++i)
+                {
+                    const __m128 value = _mm_cvtepi32_ps( _mm_unpacklo_epi16( _mm_loadl_epi64( reinterpret_cast<const __m128i*>(pRows[i] + x)), zero16));
+                    const __m128 isValid = _mm_cmplt_ps( value, saturationLevel);
+                    const __m128 signal = _mm_max_ps( _mm_sub_ps( value, blackLevel), zero);
+                    const __m128 variance = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( k.pConversionGains[i]), signal), readNoiseVariance);
+                    const __m128 weight = _mm_and_ps( isValid, _mm_div_ps( _mm_set1_ps( k.pWeights[i]), variance));
+                    sum = _mm_add_ps( sum, _mm_mul_ps( weight, _mm_mul_ps( signal, _mm_set1_ps( k.pScales[i]))));
+                    weightSum = _mm_add_ps( weightSum, weight);
+                }
+                const __m128 hasWeight = _mm_cmpgt_ps( weightSum, zero);
+                const __m128 merged = _mm_div_ps( sum, _mm_or_ps( _mm_and_ps( hasWeight, weightSum), _mm_andnot_ps( hasWeight, one)));
+                _mm_storeu_ps( pOut + x, _mm_or_ps( _mm_and_ps( hasWeight, merged), _mm_andnot_ps( hasWeight, fallback)));
+            }
+#endif
+            MergePixelsScalar( pRows, k, x, width, pOut);
+        }
+    }
+
+    // Merges brackets of frames. The result buffer is reused from bracket to bracket.
+    class CHdrMerger
+    {
+    public:
+        explicit CHdrMerger( const SHdrMergeSettings& settings = SHdrMergeSettings())
+            : m_settings( settings)
+            , m_width( 0)
+            , m_height( 0)
+            , m_maxRadiance( 0.0f)
+        {
+            if (m_settings.StripRows == 0)
+            {
+                throw RUNTIME_EXCEPTION( "The strip height of the HDR merge must not be 0.");
+            }
+        }
+
+        // Returns true for the pixel types that can be merged: all with 16 bits per pixel.
+        static bool IsSupported( EPixelType pixelType)
+        {
+            return BitPerPixel( pixelType) == 16 && !IsPacked( pixelType);
+        }
+
+        // Merges the frames of a bracket. All frames must have the same size and pixel type.
+        void Merge( const std::vector<SHdrFrame>& frames)
+        {
+            if (frames.empty())
+            {
+                throw RUNTIME_EXCEPTION( "The HDR merge needs at least one frame.");
+            }
+            const SHdrFrame& first = frames[0];
+            double maxExposure = 0.0;
+            double minExposure = 0.0;
+            for (size_t i = 0; i < frames.size(); ++i)
+            {
+                if (!IsSupported( frames[i].PixelType) || frames[i].PixelType != first.PixelType || frames[i].Width != first.Width || frames[i].Height != first.Height)
+                {
+                    throw RUNTIME_EXCEPTION( "The frames of an HDR merge must have the same size and a 16-bit pixel type.");
+                }
+                const double exposure = GetExposure( frames[i]);
+                if (exposure <= 0.0)
+                {
+                    throw RUNTIME_EXCEPTION( "The frames of an HDR merge must have a positive exposure time.");
+                }
+                maxExposure = i == 0 ? exposure : std::max( maxExposure, exposure);
+                minExposure = i == 0 ? exposure : std::min( minExposure, exposure);
+            }
+
+            // The weight of a frame is the inverse variance of its value on the scale of the longest exposure.
+            std::vector<float> scales( frames.size());
+            std::vector<float> weights( frames.size());
+            std::vector<float> conversionGains( frames.size());
+            for (size_t i = 0; i < frames.size(); ++i)
+            {
+                const double scale = maxExposure / GetExposure( frames[i]);
+                scales[i] = static_cast<float>(scale);
+                weights[i] = static_cast<float>(1.0 / (scale * scale));
+                conversionGains[i] = static_cast<float>(m_settings.ConversionGain * std::pow( 10.0, frames[i].Gain / 20.0));
+            }
+
+            HdrMergeDetail::SRowConstants k;
+            k.BlackLevel = static_cast<float>(m_settings.BlackLevel);
+            k.SaturationLevel = static_cast<float>(m_settings.SaturationLevel);
+            k.ConversionGain = static_cast<float>(m_settings.ConversionGain);
+            k.ReadNoiseVariance = static_cast<float>(std::max( m_settings.ReadNoise * m_settings.ReadNoise, 1e-3));
+            k.Fallback = static_cast<float>(std::max( m_settings.SaturationLevel - m_settings.BlackLevel, 0.0) * maxExposure / minExposure);
+            k.pScales = &scales[0];
+            k.pWeights = &weights[0];
+            k.pConversionGains = &conversionGains[0];
+            k.FrameCount = frames.size();
+
+            m_width = first.Width;
+            m_height = first.Height;
+            m_maxRadiance = k.Fallback;
+            m_radiance.resize( static_cast<size_t>(m_width) * m_height);
+
+            const uint32_t stripCount = (m_height + m_settings.StripRows - 1) / m_settings.StripRows;
+            std::atomic<uint32_t> nextStrip( 0);
+            auto mergeStrips = [&]()
+            {
+                std::vector<const uint16_t*> pRows( frames.size());
+                for (uint32_t strip = nextStrip++; strip < stripCount; strip = nextStrip++)
+                {
+                    const uint32_t endRow = std::min( m_height, (strip + 1) * m_settings.StripRows);
+                    for (uint32_t y = strip * m_settings.StripRows; y < endRow; ++y)
+                    {
+                        for (size_t i = 0; i < frames.size(); ++i)
+                        {
+                            const size_t stride = m_width * sizeof( uint16_t) + frames[i].PaddingX;
+                            pRows[i] = reinterpret_cast<const uint16_t*>(static_cast<const uint8_t*>(frames[i].pBuffer) + y * stride);
+                        }
+                        HdrMergeDetail::MergeRow( &pRows[0], k, m_width, &m_radiance[static_cast<size_t>(y) * m_width]);
+                    }
+                }
+            };
+
+            unsigned int numThreads = m_settings.NumThreads != 0 ? m_settings.NumThreads : std::thread::hardware_concurrency();
+            numThreads = std::max( 1u, std::min( numThreads, stripCount));
+            std::vector<std::thread> threads;
+            for (unsigned int i = 1; i < numThreads; ++i)
+            {
+                threads.push_back( std::thread( mergeStrips));
+            }
+            mergeStrips();
+            for (size_t i = 0; i < threads.size(); ++i)
+            {
+                threads[i].join();
+            }
+        }
+
+        // The merged image, one float per pixel without padding.
+        const float* GetRadiance() const
+        {
+            return m_radiance.empty() ? NULL : &m_radiance[0];
+        }
+
+        uint32_t GetWidth() const
+        {
+            return m_width;
+        }
+
+        uint32_t GetHeight() const
+        {
+            return m_height;
+        }
+
+        // The largest value the merge can produce, that of a pixel saturated in all frames.
+        float GetMaxRadiance() const
+        {
+            return m_maxRadiance;
+        }
+
+    private:
+        static double GetExposure( const SHdrFrame& frame)
+        {
+            return frame.ExposureTime * std::pow( 10.0, frame.Gain / 20.0);
+        }
+
+        SHdrMergeSettings m_settings;
+        std::vector<float> m_radiance;
+        uint32_t m_width;
+        uint32_t m_height;
+        float m_maxRadiance;
+    };
+}
+
+#endif /* INCLUDED_HDRMERGE_H_8053716 */
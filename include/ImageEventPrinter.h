@@ -5,6 +5,7 @@
 
 #include <pylon/ImageEventHandler.h>
 #include <pylon/GrabResultPtr.h>
+#include "FrameStatistics.h"
 #include <iostream>
 
 namespace Pylon
@@ -14,6 +15,10 @@ namespace Pylon
     class CImageEventPrinter : public CImageEventHandler
     {
     public:
+        CImageEventPrinter()
+            : m_statistics( GetPrinterStatisticsSettings())
+        {
+        }
 
         virtual void OnImagesSkipped( CInstantCamera& camera, size_t countOfSkippedImages)
         {
@@ -32,8 +37,23 @@ namespace Pylon
             {
                 std::cout << "SizeX: " << ptrGrabResult->GetWidth() << std::endl;
                 std::cout << "SizeY: " << ptrGrabResult->GetHeight() << std::endl;
-                const uint8_t *pImageBuffer = (uint8_t *) ptrGrabResult->GetBuffer();
-                std::cout << "Gray value of first pixel: " << (uint32_t) pImageBuffer[0] << std::endl;
+                SFrameStatistics statistics;
+                if (m_statistics.Compute( ptrGrabResult, statistics))
+                {
+                    std::cout << "Mean: " << statistics.GetMean() << " of " << statistics.MaxValue;
+                    if (statistics.ChannelCount == 3)
+                    {
+                        std::cout << " (R " << statistics.Channels[StatisticsChannel_Red].Mean << " G " << statistics.Channels[StatisticsChannel_Green].Mean
+                            << " B " << statistics.Channels[StatisticsChannel_Blue].Mean << ")";
+                    }
+                    std::cout << std::endl;
+                    std::cout << "Saturated: " << statistics.SaturatedFraction * 100.0 << "% Black: " << statistics.BlackFraction * 100.0 << "%" << std::endl;
+                }
+                else
+                {
+                    const uint8_t *pImageBuffer = (uint8_t *) ptrGrabResult->GetBuffer();
+                    std::cout << "Gray value of first pixel: " << (uint32_t) pImageBuffer[0] << std::endl;
+                }
                 std::cout << std::endl;
             }
             else
@@ -41,6 +61,18 @@ namespace Pylon
                 std::cout << "Error: " << ptrGrabResult->GetErrorCode() << " " << ptrGrabResult->GetErrorDescription() << std::endl;
             }
         }
+
+    private:
+        // Printing needs no histogram, every other row and column is enough for the mean.
+        static SFrameStatisticsSettings GetPrinterStatisticsSettings()
+        {
+            SFrameStatisticsSettings settings;
+            settings.ComputeHistogram = false;
+            settings.Subsample = 2;
+            return settings;
+        }
+
+        CFrameStatisticsCalculator m_statistics;
     };
 }
 
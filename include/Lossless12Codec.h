@@ -0,0 +1,631 @@
+// Contains a fast lossless codec for 12-bit sensor images.
+/*
+   The codec is designed for Mono12 and BayerGB12 buffers as delivered by the cameras (LSB aligned,
+   16 bits per pixel), but accepts any 16-bit image.
+
+   Each pixel is predicted from its already coded neighbors with the median edge detector of LOCO-I
+   (left, above and above left). For Bayer images the neighbors of the same color, two pixels away, are
+   used. The first row of a strip is predicted from the left neighbor only. The residuals are mapped to
+   unsigned values and stored in groups of 16: one byte holding the bit width of the largest value of
+   the group, followed by the 16 values packed with that width. A group of 16 always occupies 2 * width
+   bytes, so no bit position has to be carried from one group to the next.
+
+   The image is split into strips of rows that are coded independently, which allows encoding them in
+   parallel and decoding them as they arrive. The stream layout is:
+
+       SLossless12Header
+       uint32_t size of strip 0, strip 0 data
+       uint32_t size of strip 1, strip 1 data
+       ...
+*/
+
+#ifndef INCLUDED_LOSSLESS12CODEC_H_6629108
+#define INCLUDED_LOSSLESS12CODEC_H_6629108
+
+#include <pylon/PylonIncludes.h>
+
+#if defined(_MSC_VER)
+#    include <intrin.h>
+#endif
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#    include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace Pylon
+{
+    struct SLossless12Header
+    {
+        char Magic[4];          // "L12C"
+        uint16_t Version;
+        uint16_t Flags;         // c_lossless12FlagBayer
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t PixelType;     // EPixelType of the original image.
+        uint32_t StripRows;
+    };
+
+    static const uint16_t c_lossless12Version = 1;
+    static const uint16_t c_lossless12FlagBayer = 1;
+    static const uint32_t c_lossless12GroupSize = 16;
+
+    // Settings of the lossless encoder.
+    struct SLossless12Settings
+    {
+        SLossless12Settings()
+            : StripRows( 64)
+            , NumThreads( 1)
+        {
+        }
+
+        uint32_t StripRows;         // Rows per independently coded strip.
+        unsigned int NumThreads;    // 0 uses one thread per hardware thread.
+    };
+
+    namespace Lossless12Detail
+    {
+        // Returns the number of bits needed to store the value.
+        inline uint32_t BitWidth( uint32_t value)
+        {
+            if (value == 0)
+            {
+                return 0;
+            }
+#if defined(_MSC_VER)
+            unsigned long index = 0;
+            _BitScanReverse( &index, value);
+            return index + 1;
+#else
+            return 32 - __builtin_clz( value);
+#endif
+        }
+
+        // Median edge detector prediction of LOCO-I: a + b - c clamped to the range of a and b.
+        inline int32_t PredictMed( int32_t a, int32_t b, int32_t c)
+        {
+            return std::min( std::max( a + b - c, std::min( a, b)), std::max( a, b));
+        }
+
+        inline uint32_t ZigZag( int32_t residual)
+        {
+            return (static_cast<uint32_t>(residual) << 1) ^ static_cast<uint32_t>(residual >> 31);
+        }
+
+        inline int32_t UnZigZag( uint32_t value)
+        {
+            return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+        }
+
+#if defined(__AVX2__)
+        // Computes the mapped MED residuals of 8 pixels.
+        inline void ComputeMedResiduals8( const uint16_t* pRow, const uint16_t* pLeft, const uint16_t* pAbove, const uint16_t* pAboveLeft, uint32_t* pResiduals)
+        {
+            const __m256i x = _mm256_cvtepu16_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>(pRow)));
+            const __m256i a = _mm256_cvtepu16_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>(pLeft)));
+            const __m256i b = _mm256_cvtepu16_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>(pAbove)));
+            const __m256i c = _mm256_cvtepu16_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>(pAboveLeft)));
+            const __m256i gradient = _mm256_sub_epi32( _mm256_add_epi32( a, b), c);
+            const __m256i prediction = _mm256_min_epi32( _mm256_max_epi32( gradient, _mm256_min_epi32( a, b)), _mm256_max_epi32( a, b));
+            const __m256i residual = _mm256_sub_epi32( x, prediction);
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>(pResiduals), _mm256_xor_si256( _mm256_slli_epi32( residual, 1), _mm256_srai_epi32( residual, 31)));
+        }
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+        inline __m128i Min32( __m128i a, __m128i b)
+        {
+            const __m128i isGreater = _mm_cmpgt_epi32( a, b);
+            return _mm_or_si128( _mm_and_si128( isGreater, b), _mm_andnot_si128( isGreater, a));
+        }
+
+        inline __m128i Max32( __m128i a, __m128i b)
+        {
+            const __m128i isGreater = _mm_cmpgt_epi32( a, b);
+            return _mm_or_si128( _mm_and_si128( isGreater, a), _mm_andnot_si128( isGreater, b));
+        }
+
+        inline void ComputeMedResiduals4( __m128i x, __m128i a, __m128i b, __m128i c, uint32_t* pResiduals)
+        {
+            const __m128i gradient = _mm_sub_epi32( _mm_add_epi32( a, b), c);
+            const __m128i prediction = Min32( Max32( gradient, Min32( a, b)), Max32( a, b));
+            const __m128i residual = _mm_sub_epi32( x, prediction);
+            _mm_storeu_si128( reinterpret_cast<__m128i*>(pResiduals), _mm_xor_si128( _mm_slli_epi32( residual, 1), _mm_srai_epi32( residual, 31)));
+        }
+
+        // Computes the mapped MED residuals of 8 pixels.
+        inline void ComputeMedResiduals8( const uint16_t* pRow, const uint16_t* pLeft, const uint16_t* pAbove, const uint16_t* pAboveLeft, uint32_t* pResiduals)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i x = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pRow));
+            const __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pLeft));
+            const __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pAbove));
+            const __m128i c = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pAboveLeft));
+            ComputeMedResiduals4( _mm_unpacklo_epi16( x, zero), _mm_unpacklo_epi16( a, zero), _mm_unpacklo_epi16( b, zero), _mm_unpacklo_epi16( c, zero), pResiduals);
+            ComputeMedResiduals4( _mm_unpackhi_epi16( x, zero), _mm_unpackhi_epi16( a, zero), _mm_unpackhi_epi16( b, zero), _mm_unpackhi_epi16( c, zero), pResiduals + 4);
+        }
+#else
+        inline void ComputeMedResiduals8( const uint16_t* pRow, const uint16_t* pLeft, const uint16_t* pAbove, const uint16_t* pAboveLeft, uint32_t* pResiduals)
+        {
+            for (int i = 0; i < 8; ++i)
+            {
+                pResiduals[i] = ZigZag( static_cast<int32_t>(pRow[i]) - PredictMed( pLeft[i], pAbove[i], pAboveLeft[i]));
+            }
+        }
+#endif
+
+        // Computes the mapped residuals of one row. pAbove is NULL for the first row of a strip.
+        // step is 1 for monochrome and 2 for Bayer images. For Bayer images pAbove is the row two rows up.
+        inline void ComputeResiduals( const uint16_t* pRow, const uint16_t* pAbove, uint32_t width, uint32_t step, uint32_t* pResiduals)
+        {
+            uint32_t x = 0;
+            if (pAbove == NULL)
+            {
+                for (; x < std::min( step, width); ++x)
+                {
+                    pResiduals[x] = ZigZag( pRow[x]);
+                }
+                for (; x < width; ++x)
+                {
+                    pResiduals[x] = ZigZag( static_cast<int32_t>(pRow[x]) - pRow[x - step]);
+                }
+                return;
+            }
+            for (; x < std::min( step, width); ++x)
+            {
+                pResiduals[x] = ZigZag( static_cast<int32_t>(pRow[x]) - pAbove[x]);
+            }
+            // The encoder knows all neighbors in advance, so the prediction is computed for 8 pixels at once.
+            for (; x + 8 <= width; x += 8)
+            {
+                ComputeMedResiduals8( pRow + x, pRow + x - step, pAbove + x, pAbove + x - step, pResiduals + x);
+            }
+            for (; x < width; ++x)
+            {
+                pResiduals[x] = ZigZag( static_cast<int32_t>(pRow[x]) - PredictMed( pRow[x - step], pAbove[x], pAbove[x - step]));
+            }
+        }
+
+        // Inverse of ComputeResiduals. The left neighbor is only known after it is decoded, so this runs pixel by pixel.
+        inline void ReconstructRow( const uint32_t* pResiduals, const uint16_t* pAbove, uint32_t width, uint32_t step, uint16_t* pRow)
+        {
+            uint32_t x = 0;
+            if (pAbove == NULL)
+            {
+                for (; x < std::min( step, width); ++x)
+                {
+                    pRow[x] = static_cast<uint16_t>(UnZigZag( pResiduals[x]));
+                }
+                for (; x < width; ++x)
+                {
+                    pRow[x] = static_cast<uint16_t>(UnZigZag( pResiduals[x]) + pRow[x - step]);
+                }
+                return;
+            }
+            for (; x < std::min( step, width); ++x)
+            {
+                pRow[x] = static_cast<uint16_t>(UnZigZag( pResiduals[x]) + pAbove[x]);
+            }
+            if (step == 1)
+            {
+                // Keeping the neighbors in registers shortens the dependency chain from one pixel to the next.
+                int32_t left = pRow[0];
+                int32_t aboveLeft = pAbove[0];
+                for (; x < width; ++x)
+                {
+                    const int32_t above = pAbove[x];
+                    left = (UnZigZag( pResiduals[x]) + PredictMed( left, above, aboveLeft)) & 0xFFFF;
+                    pRow[x] = static_cast<uint16_t>(left);
+                    aboveLeft = above;
+                }
+                return;
+            }
+            for (; x < width; ++x)
+            {
+                pRow[x] = static_cast<uint16_t>(UnZigZag( pResiduals[x]) + PredictMed( pRow[x - step], pAbove[x], pAbove[x - step]));
+            }
+        }
+
+        // Returns the maximum size of the packed data of count residuals.
+        inline size_t GetMaxPackedSize( size_t count)
+        {
+            const size_t groups = (count + c_lossless12GroupSize - 1) / c_lossless12GroupSize;
+            return groups * (1 + 2 * 17);
+        }
+
+        // Packs a full group of 16 values with a bit width known at compile time into 2 * Width bytes.
+        template <uint32_t Width>
+        inline void PackGroup( const uint32_t* pGroup, uint8_t* pOut)
+        {
+            uint64_t bits = 0;
+            uint32_t bitCount = 0;
+            for (uint32_t i = 0; i < c_lossless12GroupSize; ++i)
+            {
+                bits |= static_cast<uint64_t>(pGroup[i]) << bitCount;
+                bitCount += Width;
+                if (bitCount >= 32)
+                {
+                    const uint32_t word = static_cast<uint32_t>(bits);
+                    memcpy( pOut, &word, sizeof( word));
+                    pOut += 4;
+                    bits >>= 32;
+                    bitCount -= 32;
+                }
+            }
+            for (; bitCount > 0; bitCount -= 8)
+            {
+                *pOut++ = static_cast<uint8_t>(bits);
+                bits >>= 8;
+            }
+        }
+
+        // Unpacks a full group of 16 values with a bit width known at compile time.
+        template <uint32_t Width>
+        inline void UnpackGroup( const uint8_t* pIn, uint32_t* pGroup)
+        {
+            // Copying the group to a padded buffer allows reading every value with one unaligned 64-bit load.
+            uint8_t group[2 * 17 + 8] = { 0 };
+            memcpy( group, pIn, 2 * Width);
+            const uint64_t mask = (static_cast<uint64_t>(1) << Width) - 1;
+            for (uint32_t i = 0; i < c_lossless12GroupSize; ++i)
+            {
+                uint64_t bits;
+                memcpy( &bits, group + (i * Width) / 8, sizeof( bits));
+                pGroup[i] = static_cast<uint32_t>((bits >> ((i * Width) % 8)) & mask);
+            }
+        }
+
+        typedef void (*PackGroupFunction_t)( const uint32_t*, uint8_t*);
+        typedef void (*UnpackGroupFunction_t)( const uint8_t*, uint32_t*);
+
+        inline PackGroupFunction_t GetPackGroupFunction( uint32_t width)
+        {
+            static const PackGroupFunction_t functions[] =
+            {
+                PackGroup<0>, PackGroup<1>, PackGroup<2>, PackGroup<3>, PackGroup<4>, PackGroup<5>, PackGroup<6>, PackGroup<7>, PackGroup<8>,
+                PackGroup<9>, PackGroup<10>, PackGroup<11>, PackGroup<12>, PackGroup<13>, PackGroup<14>, PackGroup<15>, PackGroup<16>, PackGroup<17>
+            };
+            return functions[width];
+        }
+
+        inline UnpackGroupFunction_t GetUnpackGroupFunction( uint32_t width)
+        {
+            static const UnpackGroupFunction_t functions[] =
+            {
+                UnpackGroup<0>, UnpackGroup<1>, UnpackGroup<2>, UnpackGroup<3>, UnpackGroup<4>, UnpackGroup<5>, UnpackGroup<6>, UnpackGroup<7>, UnpackGroup<8>,
+                UnpackGroup<9>, UnpackGroup<10>, UnpackGroup<11>, UnpackGroup<12>, UnpackGroup<13>, UnpackGroup<14>, UnpackGroup<15>, UnpackGroup<16>, UnpackGroup<17>
+            };
+            return functions[width];
+        }
+
+        // Packs the residuals in groups. Returns the end of the written data.
+        inline uint8_t* PackResiduals( const uint32_t* pResiduals, size_t count, uint8_t* pOut)
+        {
+            size_t start = 0;
+            for (; start + c_lossless12GroupSize <= count; start += c_lossless12GroupSize)
+            {
+                const uint32_t* pGroup = pResiduals + start;
+                uint32_t combined = 0;
+                for (uint32_t i = 0; i < c_lossless12GroupSize; ++i)
+                {
+                    combined |= pGroup[i];
+                }
+                const uint32_t width = BitWidth( combined);
+                *pOut++ = static_cast<uint8_t>(width);
+                GetPackGroupFunction( width)( pGroup, pOut);
+                pOut += 2 * width;
+            }
+
+            // The last group may be incomplete. It is padded with zeros.
+            if (start < count)
+            {
+                uint32_t group[c_lossless12GroupSize] = { 0 };
+                memcpy( group, pResiduals + start, (count - start) * sizeof( uint32_t));
+                uint32_t combined = 0;
+                for (uint32_t i = 0; i < c_lossless12GroupSize; ++i)
+                {
+                    combined |= group[i];
+                }
+                const uint32_t width = BitWidth( combined);
+                *pOut++ = static_cast<uint8_t>(width);
+                GetPackGroupFunction( width)( group, pOut);
+                pOut += 2 * width;
+            }
+            return pOut;
+        }
+
+        // Inverse of PackResiduals. Returns the end of the consumed data, or NULL if the data is corrupt.
+        inline const uint8_t* UnpackResiduals( const uint8_t* pIn, const uint8_t* pEnd, size_t count, uint32_t* pResiduals)
+        {
+            for (size_t start = 0; start < count; start += c_lossless12GroupSize)
+            {
+                if (pIn >= pEnd)
+                {
+                    return NULL;
+                }
+                const uint32_t width = *pIn++;
+                if (width > 17 || static_cast<size_t>(pEnd - pIn) < 2 * width)
+                {
+                    return NULL;
+                }
+                if (start + c_lossless12GroupSize <= count)
+                {
+                    GetUnpackGroupFunction( width)( pIn, pResiduals + start);
+                }
+                else
+                {
+                    uint32_t group[c_lossless12GroupSize];
+                    GetUnpackGroupFunction( width)( pIn, group);
+                    memcpy( pResiduals + start, group, (count - start) * sizeof( uint32_t));
+                }
+                pIn += 2 * width;
+            }
+            return pIn;
+        }
+    }
+
+
+    // Compresses images. The buffers of one encoder are reused from frame to frame.
+    class CLossless12Encoder
+    {
+    public:
+        explicit CLossless12Encoder( const SLossless12Settings& settings = SLossless12Settings())
+            : m_settings( settings)
+        {
+            if (m_settings.StripRows == 0)
+            {
+                throw RUNTIME_EXCEPTION( "The strip height of the lossless encoder must not be 0.");
+            }
+        }
+
+        // Returns true for the pixel types the codec handles: all with 16 bits per pixel.
+        static bool IsSupported( EPixelType pixelType)
+        {
+            return BitPerPixel( pixelType) == 16 && !IsPacked( pixelType);
+        }
+
+        // Encodes an image and replaces the content of output with the compressed stream. Returns the compressed size.
+        size_t Encode( const void* pImage, EPixelType pixelType, uint32_t width, uint32_t height, size_t paddingX, std::vector<uint8_t>& output)
+        {
+            if (!IsSupported( pixelType))
+            {
+                throw RUNTIME_EXCEPTION( "The lossless codec supports 16-bit pixel types only.");
+            }
+
+            SLossless12Header header;
+            memcpy( header.Magic, "L12C", sizeof( header.Magic));
+            header.Version = c_lossless12Version;
+            header.Flags = IsBayer( pixelType) ? c_lossless12FlagBayer : 0;
+            header.Width = width;
+            header.Height = height;
+            header.PixelType = static_cast<uint32_t>(pixelType);
+            header.StripRows = (header.Flags & c_lossless12FlagBayer) != 0 ? (m_settings.StripRows + 1) & ~1u : m_settings.StripRows;
+
+            const uint32_t stripCount = (height + header.StripRows - 1) / header.StripRows;
+            const size_t stride = width * sizeof( uint16_t) + paddingX;
+            m_strips.resize( stripCount);
+            std::atomic<uint32_t> nextStrip( 0);
+
+            auto encodeStrips = [&]()
+            {
+                std::vector<uint32_t> residuals;
+                for (uint32_t strip = nextStrip++; strip < stripCount; strip = nextStrip++)
+                {
+                    const uint32_t firstRow = strip * header.StripRows;
+                    const uint32_t rowCount = std::min( header.StripRows, height - firstRow);
+                    EncodeStrip( header, static_cast<const uint8_t*>(pImage) + firstRow * stride, stride, rowCount, residuals, m_strips[strip]);
+                }
+            };
+
+            unsigned int numThreads = m_settings.NumThreads != 0 ? m_settings.NumThreads : std::thread::hardware_concurrency();
+            numThreads = std::max( 1u, std::min( numThreads, stripCount));
+            std::vector<std::thread> threads;
+            for (unsigned int i = 1; i < numThreads; ++i)
+            {
+                threads.push_back( std::thread( encodeStrips));
+            }
+            encodeStrips();
+            for (size_t i = 0; i < threads.size(); ++i)
+            {
+                threads[i].join();
+            }
+
+            size_t totalSize = sizeof( header);
+            for (uint32_t i = 0; i < stripCount; ++i)
+            {
+                totalSize += sizeof( uint32_t) + m_strips[i].size();
+            }
+            output.resize( totalSize);
+            uint8_t* pOut = &output[0];
+            memcpy( pOut, &header, sizeof( header));
+            pOut += sizeof( header);
+            for (uint32_t i = 0; i < stripCount; ++i)
+            {
+                const uint32_t stripSize = static_cast<uint32_t>(m_strips[i].size());
+                memcpy( pOut, &stripSize, sizeof( stripSize));
+                pOut += sizeof( stripSize);
+                if (stripSize != 0)
+                {
+                    memcpy( pOut, &m_strips[i][0], stripSize);
+                    pOut += stripSize;
+                }
+            }
+            return totalSize;
+        }
+
+    private:
+        static void EncodeStrip( const SLossless12Header& header, const uint8_t* pFirstRow, size_t stride, uint32_t rowCount,
+            std::vector<uint32_t>& residuals, std::vector<uint8_t>& strip)
+        {
+            const uint32_t step = (header.Flags & c_lossless12FlagBayer) != 0 ? 2 : 1;
+            const size_t count = static_cast<size_t>(header.Width) * rowCount;
+            residuals.resize( count);
+            for (uint32_t row = 0; row < rowCount; ++row)
+            {
+                const uint16_t* pRow = reinterpret_cast<const uint16_t*>(pFirstRow + row * stride);
+                const uint16_t* pAbove = row >= step ? reinterpret_cast<const uint16_t*>(pFirstRow + (row - step) * stride) : NULL;
+                Lossless12Detail::ComputeResiduals( pRow, pAbove, header.Width, step, &residuals[row * header.Width]);
+            }
+
+            strip.resize( Lossless12Detail::GetMaxPackedSize( count));
+            const uint8_t* pEnd = Lossless12Detail::PackResiduals( &residuals[0], count, &strip[0]);
+            strip.resize( pEnd - &strip[0]);
+        }
+
+        SLossless12Settings m_settings;
+        std::vector< std::vector<uint8_t> > m_strips;
+    };
+
+
+    // Decodes a compressed stream that may arrive in pieces. Each strip is decoded as soon as it is complete.
+    class CLossless12StreamDecoder
+    {
+    public:
+        CLossless12StreamDecoder()
+            : m_hasHeader( false)
+            , m_nextStrip( 0)
+        {
+        }
+
+        void Reset()
+        {
+            m_hasHeader = false;
+            m_nextStrip = 0;
+            m_pending.clear();
+        }
+
+        // Appends compressed data. For every completed strip onStrip( firstRow, rowCount, pRows) is called,
+        // pRows pointing to rowCount unpadded rows of 16-bit pixels.
+        template <typename StripCallbackT>
+        void Feed( const void* pData, size_t size, StripCallbackT onStrip)
+        {
+            // Data is only copied if a strip is split between two calls.
+            const uint8_t* pInput = static_cast<const uint8_t*>(pData);
+            size_t inputSize = size;
+            if (!m_pending.empty())
+            {
+                m_pending.insert( m_pending.end(), pInput, pInput + size);
+                pInput = &m_pending[0];
+                inputSize = m_pending.size();
+            }
+            size_t consumed = 0;
+
+            if (!m_hasHeader)
+            {
+                if (inputSize < sizeof( m_header))
+                {
+                    KeepPending( pInput + consumed, inputSize - consumed);
+                    return;
+                }
+                memcpy( &m_header, pInput, sizeof( m_header));
+                if (memcmp( m_header.Magic, "L12C", sizeof( m_header.Magic)) != 0 || m_header.Version != c_lossless12Version || m_header.StripRows == 0)
+                {
+                    throw RUNTIME_EXCEPTION( "The data is not a supported lossless 12-bit stream.");
+                }
+                consumed = sizeof( m_header);
+                m_hasHeader = true;
+                m_nextStrip = 0;
+            }
+
+            const uint32_t stripCount = (m_header.Height + m_header.StripRows - 1) / m_header.StripRows;
+            while (m_nextStrip < stripCount && inputSize - consumed >= sizeof( uint32_t))
+            {
+                uint32_t stripSize = 0;
+                memcpy( &stripSize, pInput + consumed, sizeof( stripSize));
+                if (inputSize - consumed - sizeof( stripSize) < stripSize)
+                {
+                    break;
+                }
+                const uint8_t* pStrip = pInput + consumed + sizeof( stripSize);
+                const uint32_t firstRow = m_nextStrip * m_header.StripRows;
+                const uint32_t rowCount = std::min( m_header.StripRows, m_header.Height - firstRow);
+                DecodeStrip( pStrip, stripSize, rowCount);
+                onStrip( firstRow, rowCount, static_cast<const uint16_t*>(m_rows.empty() ? NULL : &m_rows[0]));
+                consumed += sizeof( stripSize) + stripSize;
+                ++m_nextStrip;
+            }
+            KeepPending( pInput + consumed, inputSize - consumed);
+        }
+
+        bool HasHeader() const
+        {
+            return m_hasHeader;
+        }
+
+        const SLossless12Header& GetHeader() const
+        {
+            return m_header;
+        }
+
+        bool IsComplete() const
+        {
+            return m_hasHeader && m_nextStrip * static_cast<uint64_t>(m_header.StripRows) >= m_header.Height;
+        }
+
+    private:
+        // Keeps the data of an incomplete strip for the next call of Feed.
+        void KeepPending( const uint8_t* pRemaining, size_t size)
+        {
+            std::vector<uint8_t> remaining( pRemaining, pRemaining + size);
+            m_pending.swap( remaining);
+        }
+
+        void DecodeStrip( const uint8_t* pStrip, size_t stripSize, uint32_t rowCount)
+        {
+            const uint32_t width = m_header.Width;
+            const uint32_t step = (m_header.Flags & c_lossless12FlagBayer) != 0 ? 2 : 1;
+            const size_t count = static_cast<size_t>(width) * rowCount;
+            m_residuals.resize( count);
+            m_rows.resize( count);
+            if (count == 0)
+            {
+                return;
+            }
+            if (Lossless12Detail::UnpackResiduals( pStrip, pStrip + stripSize, count, &m_residuals[0]) == NULL)
+            {
+                throw RUNTIME_EXCEPTION( "The lossless 12-bit stream is corrupt.");
+            }
+            for (uint32_t row = 0; row < rowCount; ++row)
+            {
+                const uint16_t* pAbove = row >= step ? &m_rows[(row - step) * width] : NULL;
+                Lossless12Detail::ReconstructRow( &m_residuals[row * width], pAbove, width, step, &m_rows[row * width]);
+            }
+        }
+
+        bool m_hasHeader;
+        SLossless12Header m_header;
+        uint32_t m_nextStrip;
+        std::vector<uint8_t> m_pending;
+        std::vector<uint32_t> m_residuals;
+        std::vector<uint16_t> m_rows;
+    };
+
+    // Decodes a complete compressed stream into an unpadded image buffer of the original size.
+    inline void DecodeLossless12( const void* pData, size_t size, void* pImage, size_t imageSize)
+    {
+        CLossless12StreamDecoder decoder;
+        uint8_t* pOut = static_cast<uint8_t*>(pImage);
+        decoder.Feed( pData, size, [&]( uint32_t firstRow, uint32_t rowCount, const uint16_t* pRows)
+        {
+            const size_t rowSize = decoder.GetHeader().Width * sizeof( uint16_t);
+            if ((static_cast<size_t>(firstRow) + rowCount) * rowSize > imageSize)
+            {
+                throw RUNTIME_EXCEPTION( "The image buffer is too small for the decoded image.");
+            }
+            if (rowCount != 0)
+            {
+                memcpy( pOut + firstRow * rowSize, pRows, rowCount * rowSize);
+            }
+        });
+        if (!decoder.IsComplete())
+        {
+            throw RUNTIME_EXCEPTION( "The lossless 12-bit stream is truncated.");
+        }
+    }
+}
+
+#endif /* INCLUDED_LOSSLESS12CODEC_H_6629108 */
@@ -4,11 +4,8 @@
 #define INCLUDED_PIXELFORMATANDAOICONFIGURATION_H_00104928
 
 #include <pylon/ConfigurationEventHandler.h>
+#include "CameraNodeAccess.h"
 
-namespace Pylon
-{
-    class CInstantCamera;
-}
 class CPixelFormatAndAoiConfiguration : public Pylon::CConfigurationEventHandler
 {
 public:
@@ -16,32 +13,15 @@ public:
     {
         try
         {
-            // Allow all the names in the namespace GenApi to be used without qualification.
-            using namespace GenApi;
-
-            // Get the camera control object.
-            INodeMap &control = camera.GetNodeMap();
-
-            // Get the parameters for setting the image area of interest (Image AOI).
-            const CIntegerPtr width = control.GetNode("Width");
-            const CIntegerPtr height = control.GetNode("Height");
-            const CIntegerPtr offsetX = control.GetNode("OffsetX");
-            const CIntegerPtr offsetY = control.GetNode("OffsetY");
+            // Look up the parameters for setting the image area of interest (Image AOI) and the pixel format, see CameraNodeAccess.h.
+            Pylon::CAoiNodesT<Pylon::CInstantCamera> aoi;
+            aoi.Resolve( camera);
 
             // Maximize the Image AOI.
-            if (IsWritable(offsetX))
-            {
-                offsetX->SetValue(offsetX->GetMin());
-            }
-            if (IsWritable(offsetY))
-            {
-                offsetY->SetValue(offsetY->GetMin());
-            }
-            width->SetValue(width->GetMax());
-            height->SetValue(height->GetMax());
+            aoi.Maximize();
 
             // Set the pixel data format.
-            CEnumerationPtr(control.GetNode("PixelFormat"))->FromString("Mono8");
+            aoi.SetPixelFormat( "Mono8");
         }
         catch (GenICam::GenericException& e)
         {
@@ -0,0 +1,517 @@
+// Contains a renderer of small 8-bit preview images from camera frames.
+/*
+   Displaying the full-resolution Mono12 or BayerGB12 frames converts every pixel of every frame, although
+   the preview window shows only a fraction of them. CPreviewRenderer reduces the frame by 1, 2 or 4 in
+   both directions and maps the values with a lookup table to 8 bits in one pass over the frame. The
+   result is written to a buffer owned by the renderer, which is allocated with the first frame and
+   reused as long as the format does not change.
+
+   The reduction either bins, i.e. averages the pixels of each block, or sub-samples, i.e. takes one pixel
+   per block. Binning reads every pixel and lowers the noise, sub-sampling reads only the pixels it uses.
+   The sums of the binned rows are formed with SSE2 or, if the compiler targets it, AVX2. Bayer frames are
+   rendered as RGB from the 2x2 cells, so their reduction is 2 or 4: with 2 each cell gives one pixel with
+   the average of both greens, with 4 the cells of each 2x2 block of cells are averaged.
+
+   The lookup table applies black and white point and the gamma. With AutoContrast the points are taken
+   from the histogram of the rendered values, of green for Bayer frames, so that ClipFraction of them end
+   up black and as many white. The points follow the frames over a few frames so that the preview does
+   not flicker, and apply from the next frame on.
+*/
+
+#ifndef INCLUDED_PREVIEWRENDERER_H_3860527
+#define INCLUDED_PREVIEWRENDERER_H_3860527
+
+#include <pylon/PylonIncludes.h>
+#include "FrameStatistics.h"
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#    include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace Pylon
+{
+    enum EPreviewReduction
+    {
+        PreviewReduction_Binning,
+        PreviewReduction_Subsampling
+    };
+
+    struct SPreviewSettings
+    {
+        SPreviewSettings()
+            : Decimation( 2)
+            , Reduction( PreviewReduction_Binning)
+            , Gamma( 2.2)
+            , AutoContrast( true)
+            , ClipFraction( 0.002)
+            , BlackLevel( 0)
+            , WhiteLevel( 0)
+        {
+        }
+
+        uint32_t Decimation;            // 1, 2 or 4. Bayer frames use at least 2.
+        EPreviewReduction Reduction;
+        double Gamma;                   // 1 is linear, 2.2 brightens the dark values like a display gamma.
+        bool AutoContrast;
+        double ClipFraction;            // Fraction of the values clipped at each end with AutoContrast.
+        uint32_t BlackLevel;            // Points without AutoContrast. A WhiteLevel of 0 uses the largest value.
+        uint32_t WhiteLevel;
+    };
+
+    namespace PreviewRendererDetail
+    {
+        // Entries of the gamma table the lookup table is built from.
+        static const uint32_t c_gammaTableSize = 1024;
+
+        inline void AddPixelsScalar( const uint16_t* pIn, uint16_t* pSum, uint32_t first, uint32_t count, bool isFirstRow)
+        {
+            for (uint32_t x = first; x < count; ++x)
+            {
+                pSum[x] = static_cast<uint16_t>(isFirstRow ? pIn[x] : pSum[x] + pIn[x]);
+            }
+        }
+
+        inline void AddPixelsScalar( const uint8_t* pIn, uint16_t* pSum, uint32_t first, uint32_t count, bool isFirstRow)
+        {
+            for (uint32_t x = first; x < count; ++x)
+            {
+                pSum[x] = static_cast<uint16_t>(isFirstRow ? pIn[x] : pSum[x] + pIn[x]);
+            }
+        }
+
+        inline void HalveRowScalar( const uint16_t* pIn, uint32_t first, uint32_t count, uint16_t* pOut, int shift)
+        {
+            for (uint32_t x = first; x < count; ++x)
+            {
+                pOut[x] = static_cast<uint16_t>((pIn[2 * x] + pIn[2 * x + 1]) >> shift);
+            }
+        }
+
+        inline void SplitRowScalar( const uint16_t* pIn, uint32_t first, uint32_t count, uint16_t* pEven, uint16_t* pOdd)
+        {
+            for (uint32_t x = first; x < count; ++x)
+            {
+                pEven[x] = pIn[2 * x];
+                pOdd[x] = pIn[2 * x + 1];
+            }
+        }
+
+#if defined(__AVX2__) || defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#    if defined(__AVX2__)
+        typedef __m256i Vector_t;
+        static const uint32_t c_vectorLanes16 = 16;
+        inline Vector_t Load16( const uint16_t* p) { return _mm256_loadu_si256( reinterpret_cast<const __m256i*>(p)); }
+        inline Vector_t Load8( const uint8_t* p) { return _mm256_cvtepu8_epi16( _mm_loadu_si128( reinterpret_cast<const __m128i*>(p))); }
+        inline void Store16( uint16_t* p, Vector_t a) { _mm256_storeu_si256( reinterpret_cast<__m256i*>(p), a); }
+        inline Vector_t Add16( Vector_t a, Vector_t b) { return _mm256_add_epi16( a, b); }
+        inline Vector_t PairSums( Vector_t a) { return _mm256_madd_epi16( a, _mm256_set1_epi16( 1)); }
+        inline Vector_t EvenLanes( Vector_t a) { return _mm256_srai_epi32( _mm256_slli_epi32( a, 16), 16); }
+        inline Vector_t OddLanes( Vector_t a) { return _mm256_srai_epi32( a, 16); }
+        inline Vector_t ShiftRight32( Vector_t a, int shift) { return _mm256_sra_epi32( a, _mm_cvtsi32_si128( shift)); }
+        // The AVX2 pack works per 128-bit half, the permutation restores the order of the lanes.
+        inline Vector_t Pack32( Vector_t a, Vector_t b) { return _mm256_permute4x64_epi64( _mm256_packs_epi32( a, b), 0xD8); }
+#    else
+        typedef __m128i Vector_t;
+        static const uint32_t c_vectorLanes16 = 8;
+        inline Vector_t Load16( const uint16_t* p) { return _mm_loadu_si128( reinterpret_cast<const __m128i*>(p)); }
+        inline Vector_t Load8( const uint8_t* p) { return _mm_unpacklo_epi8( _mm_loadl_epi64( reinterpret_cast<const __m128i*>(p)), _mm_setzero_si128()); }
+        inline void Store16( uint16_t* p, Vector_t a) { _mm_storeu_si128( reinterpret_cast<__m128i*>(p), a); }
+        inline Vector_t Add16( Vector_t a, Vector_t b) { return _mm_add_epi16( a, b); }
+        inline Vector_t PairSums( Vector_t a) { return _mm_madd_epi16( a, _mm_set1_epi16( 1)); }
+        inline Vector_t EvenLanes( Vector_t a) { return _mm_srai_epi32( _mm_slli_epi32( a, 16), 16); }
+        inline Vector_t OddLanes( Vector_t a) { return _mm_srai_epi32( a, 16); }
+        inline Vector_t ShiftRight32( Vector_t a, int shift) { return _mm_sra_epi32( a, _mm_cvtsi32_si128( shift)); }
+        inline Vector_t Pack32( Vector_t a, Vector_t b) { return _mm_packs_epi32( a, b); }
+#    endif
+
+        inline Vector_t LoadPixels( const uint16_t* p) { return Load16( p); }
+        inline Vector_t LoadPixels( const uint8_t* p) { return Load8( p); }
+
+        // Copies the first row of a block to the sums or adds a further row.
+        template <typename PixelT>
+        inline void AddRow( const PixelT* pIn, uint16_t* pSum, uint32_t count, bool isFirstRow)
+        {
+            uint32_t x = 0;
+            if (isFirstRow)
+            {
+                for (; x + c_vectorLanes16 <= count; x += c_vectorLanes16)
+                {
+                    Store16( pSum + x, LoadPixels( pIn + x));
+                }
+            }
+            else
+            {
+                for (; x + c_vectorLanes16 <= count; x += c_vectorLanes16)
+                {
+                    Store16( pSum + x, Add16( Load16( pSum + x), LoadPixels( pIn + x)));
+                }
+            }
+            AddPixelsScalar( pIn, pSum, x, count, isFirstRow);
+        }
+
+        // pOut[x] = (pIn[2x] + pIn[2x+1]) >> shift for x < count. The sums must stay below 32768. pOut may be pIn.
+        inline void HalveRow( const uint16_t* pIn, uint32_t count, uint16_t* pOut, int shift)
+        {
+            uint32_t x = 0;
+            for (; x + c_vectorLanes16 <= count; x += c_vectorLanes16)
+            {
+                const Vector_t low = ShiftRight32( PairSums( Load16( pIn + 2 * x)), shift);
+                const Vector_t high = ShiftRight32( PairSums( Load16( pIn + 2 * x + c_vectorLanes16)), shift);
+                Store16( pOut + x, Pack32( low, high));
+            }
+            HalveRowScalar( pIn, x, count, pOut, shift);
+        }
+
+        // Separates count pairs into the even and the odd pixels. The values must stay below 32768.
+        inline void SplitRow( const uint16_t* pIn, uint32_t count, uint16_t* pEven, uint16_t* pOdd)
+        {
+            uint32_t x = 0;
+            for (; x + c_vectorLanes16 <= count; x += c_vectorLanes16)
+            {
+                const Vector_t low = Load16( pIn + 2 * x);
+                const Vector_t high = Load16( pIn + 2 * x + c_vectorLanes16);
+                Store16( pEven + x, Pack32( EvenLanes( low), EvenLanes( high)));
+                Store16( pOdd + x, Pack32( OddLanes( low), OddLanes( high)));
+            }
+            SplitRowScalar( pIn, x, count, pEven, pOdd);
+        }
+#else
+        template <typename PixelT>
+        inline void AddRow( const PixelT* pIn, uint16_t* pSum, uint32_t count, bool isFirstRow)
+        {
+            AddPixelsScalar( pIn, pSum, 0, count, isFirstRow);
+        }
+
+        inline void HalveRow( const uint16_t* pIn, uint32_t count, uint16_t* pOut, int shift)
+        {
+            HalveRowScalar( pIn, 0, count, pOut, shift);
+        }
+
+        inline void SplitRow( const uint16_t* pIn, uint32_t count, uint16_t* pEven, uint16_t* pOdd)
+        {
+            SplitRowScalar( pIn, 0, count, pEven, pOdd);
+        }
+#endif
+    }
+
+    // Renders the preview of the frames of one camera. The tables and the output buffer are reused from frame to frame.
+    class CPreviewRenderer
+    {
+    public:
+        explicit CPreviewRenderer( const SPreviewSettings& settings = SPreviewSettings())
+            : m_settings( settings)
+            , m_pixelType( PixelType_Undefined)
+            , m_maxValue( 0)
+            , m_blackPoint( 0.0)
+            , m_whitePoint( 0.0)
+            , m_lutBlack( 0)
+            , m_lutWhite( 0)
+        {
+            if (m_settings.Decimation != 1 && m_settings.Decimation != 2 && m_settings.Decimation != 4)
+            {
+                throw RUNTIME_EXCEPTION( "The preview decimation must be 1, 2 or 4.");
+            }
+            m_gammaTable.resize( PreviewRendererDetail::c_gammaTableSize);
+            for (uint32_t i = 0; i < m_gammaTable.size(); ++i)
+            {
+                const double value = static_cast<double>(i) / (m_gammaTable.size() - 1);
+                m_gammaTable[i] = static_cast<uint8_t>(255.0 * std::pow( value, 1.0 / std::max( 0.1, m_settings.Gamma)) + 0.5);
+            }
+        }
+
+        const SPreviewSettings& GetSettings() const
+        {
+            return m_settings;
+        }
+
+        // Same formats as the frame statistics: unpacked mono and Bayer formats with up to 12 significant bits.
+        static bool IsSupported( EPixelType pixelType)
+        {
+            return CFrameStatisticsCalculator::IsSupported( pixelType);
+        }
+
+        void Render( const void* pBuffer, EPixelType pixelType, uint32_t width, uint32_t height, size_t paddingX)
+        {
+            if (!IsSupported( pixelType))
+            {
+                throw RUNTIME_EXCEPTION( "The preview does not support the pixel type 0x%08x.", static_cast<unsigned int>(pixelType));
+            }
+            const bool isBayer = IsBayer( pixelType);
+            const uint32_t decimation = isBayer ? std::max( 2u, m_settings.Decimation) : m_settings.Decimation;
+            const uint32_t outWidth = width / decimation;
+            const uint32_t outHeight = height / decimation;
+            Prepare( pixelType, width, outWidth, outHeight, isBayer ? 3 : 1);
+
+            const size_t bytesPerPixel = BitPerPixel( pixelType) / 8;
+            const size_t rowSize = width * bytesPerPixel + paddingX;
+            const uint8_t* pFirst = static_cast<const uint8_t*>(pBuffer);
+            if (bytesPerPixel == 1)
+            {
+                RenderRows<uint8_t>( pFirst, rowSize, isBayer, decimation, outWidth, outHeight);
+            }
+            else
+            {
+                RenderRows<uint16_t>( pFirst, rowSize, isBayer, decimation, outWidth, outHeight);
+            }
+            UpdateContrast();
+            m_image.AttachUserBuffer( m_output.empty() ? NULL : &m_output[0], m_output.size(), isBayer ? PixelType_RGB8packed : PixelType_Mono8,
+                outWidth, outHeight, 0);
+        }
+
+        // Renders a grab result. Returns false if the grab failed or the pixel type is not supported.
+        template <typename GrabResultPtrT>
+        bool Render( const GrabResultPtrT& ptrGrabResult)
+        {
+            if (!ptrGrabResult->GrabSucceeded() || !IsSupported( ptrGrabResult->GetPixelType()))
+            {
+                return false;
+            }
+            Render( ptrGrabResult->GetBuffer(), ptrGrabResult->GetPixelType(), ptrGrabResult->GetWidth(), ptrGrabResult->GetHeight(),
+                ptrGrabResult->GetPaddingX());
+            return true;
+        }
+
+        // The last rendered preview, Mono8 for mono and RGB8packed for Bayer frames. Refers to the buffer of the renderer.
+        const CPylonImage& GetImage() const
+        {
+            return m_image;
+        }
+
+        // Points of the lookup table in pixel values of the frame.
+        uint32_t GetBlackPoint() const
+        {
+            return m_lutBlack;
+        }
+
+        uint32_t GetWhitePoint() const
+        {
+            return m_lutWhite;
+        }
+
+    private:
+        // Allocates the buffers for the format and resets the points if it changed.
+        void Prepare( EPixelType pixelType, uint32_t width, uint32_t outWidth, uint32_t outHeight, uint32_t channelCount)
+        {
+            const uint32_t maxValue = (1u << BitDepth( pixelType)) - 1;
+            if (pixelType != m_pixelType || maxValue != m_maxValue)
+            {
+                m_pixelType = pixelType;
+                m_maxValue = maxValue;
+                m_blackPoint = std::min<double>( m_settings.BlackLevel, maxValue);
+                m_whitePoint = m_settings.WhiteLevel != 0 ? std::min<double>( m_settings.WhiteLevel, maxValue) : maxValue;
+                m_histogram.assign( maxValue + 1, 0);
+                BuildLut();
+            }
+            const size_t outputSize = static_cast<size_t>(outWidth) * outHeight * channelCount;
+            if (m_output.size() != outputSize)
+            {
+                m_output.assign( outputSize, 0);
+            }
+            // Sums of a row, then the four sites of Bayer frames.
+            if (m_rows.size() < 6 * static_cast<size_t>(width) + 32)
+            {
+                m_rows.assign( 6 * static_cast<size_t>(width) + 32, 0);
+            }
+        }
+
+        template <typename PixelT>
+        void RenderRows( const uint8_t* pFirst, size_t rowSize, bool isBayer, uint32_t decimation, uint32_t outWidth, uint32_t outHeight)
+        {
+            using namespace PreviewRendererDetail;
+
+            uint8_t* pOut = m_output.empty() ? NULL : &m_output[0];
+            const size_t rowCapacity = m_rows.size() / 6;
+            uint16_t* pSum = &m_rows[0];
+            uint16_t* pSums[2] = { pSum, pSum + rowCapacity };
+            uint16_t* pSites[4] = { pSum + 2 * rowCapacity, pSum + 3 * rowCapacity, pSum + 4 * rowCapacity, pSum + 5 * rowCapacity };
+            const bool isBinning = m_settings.Reduction == PreviewReduction_Binning;
+
+            // Sites of the Bayer cell in the order of FrameStatisticsDetail::GetSiteChannels.
+            uint32_t siteChannels[4] = { 0, 0, 0, 0 };
+            if (isBayer)
+            {
+                FrameStatisticsDetail::GetSiteChannels( m_pixelType, siteChannels);
+            }
+            int red = 0;
+            int blue = 0;
+            int green[2] = { 0, 0 };
+            for (int site = 0, greens = 0; site < 4; ++site)
+            {
+                if (siteChannels[site] == StatisticsChannel_Red)
+                {
+                    red = site;
+                }
+                else if (siteChannels[site] == StatisticsChannel_Blue)
+                {
+                    blue = site;
+                }
+                else
+                {
+                    green[greens++ & 1] = site;
+                }
+            }
+
+            for (uint32_t y = 0; y < outHeight; ++y)
+            {
+                const uint8_t* pBlock = pFirst + static_cast<size_t>(y) * decimation * rowSize;
+                if (!isBayer && isBinning)
+                {
+                    for (uint32_t k = 0; k < decimation; ++k)
+                    {
+                        AddRow( reinterpret_cast<const PixelT*>(pBlock + k * rowSize), pSum, outWidth * decimation, k == 0);
+                    }
+                    if (decimation == 2)
+                    {
+                        HalveRow( pSum, outWidth, pSum, 2);
+                    }
+                    else if (decimation == 4)
+                    {
+                        // The pair sums of four rows would exceed 16 bits, the first halving drops a bit.
+                        HalveRow( pSum, 2 * outWidth, pSum, 1);
+                        HalveRow( pSum, outWidth, pSum, 3);
+                    }
+                    MapMonoRow( pSum, outWidth, pOut);
+                }
+                else if (isBayer && isBinning)
+                {
+                    const uint32_t cells = decimation / 2;
+                    for (uint32_t parity = 0; parity < 2; ++parity)
+                    {
+                        for (uint32_t k = 0; k < cells; ++k)
+                        {
+                            AddRow( reinterpret_cast<const PixelT*>(pBlock + (2 * k + parity) * rowSize), pSums[parity], outWidth * decimation, k == 0);
+                        }
+                        SplitRow( pSums[parity], outWidth * cells, pSites[2 * parity], pSites[2 * parity + 1]);
+                        if (cells == 2)
+                        {
+                            HalveRow( pSites[2 * parity], outWidth, pSites[2 * parity], 2);
+                            HalveRow( pSites[2 * parity + 1], outWidth, pSites[2 * parity + 1], 2);
+                        }
+                    }
+                    MapRgbRow( pSites[red], pSites[green[0]], pSites[green[1]], pSites[blue], outWidth, pOut);
+                }
+                else if (!isBayer)
+                {
+                    const PixelT* pRow = reinterpret_cast<const PixelT*>(pBlock);
+                    for (uint32_t x = 0; x < outWidth; ++x)
+                    {
+                        pSum[x] = pRow[x * decimation];
+                    }
+                    MapMonoRow( pSum, outWidth, pOut);
+                }
+                else
+                {
+                    const PixelT* pRows[2] = { reinterpret_cast<const PixelT*>(pBlock), reinterpret_cast<const PixelT*>(pBlock + rowSize) };
+                    for (uint32_t x = 0; x < outWidth; ++x)
+                    {
+                        pSites[0][x] = pRows[0][x * decimation];
+                        pSites[1][x] = pRows[0][x * decimation + 1];
+                        pSites[2][x] = pRows[1][x * decimation];
+                        pSites[3][x] = pRows[1][x * decimation + 1];
+                    }
+                    MapRgbRow( pSites[red], pSites[green[0]], pSites[green[1]], pSites[blue], outWidth, pOut);
+                }
+                pOut += static_cast<size_t>(outWidth) * (isBayer ? 3 : 1);
+            }
+        }
+
+        void MapMonoRow( const uint16_t* pValues, uint32_t count, uint8_t* pOut)
+        {
+            const uint8_t* pLut = &m_lut[0];
+            uint32_t* pHistogram = &m_histogram[0];
+            for (uint32_t x = 0; x < count; ++x)
+            {
+                const uint32_t v = std::min<uint32_t>( pValues[x], m_maxValue);
+                ++pHistogram[v];
+                pOut[x] = pLut[v];
+            }
+        }
+
+        void MapRgbRow( const uint16_t* pRed, const uint16_t* pGreen0, const uint16_t* pGreen1, const uint16_t* pBlue, uint32_t count, uint8_t* pOut)
+        {
+            const uint8_t* pLut = &m_lut[0];
+            uint32_t* pHistogram = &m_histogram[0];
+            for (uint32_t x = 0; x < count; ++x)
+            {
+                const uint32_t r = std::min<uint32_t>( pRed[x], m_maxValue);
+                const uint32_t g = std::min<uint32_t>( (pGreen0[x] + pGreen1[x] + 1) >> 1, m_maxValue);
+                const uint32_t b = std::min<uint32_t>( pBlue[x], m_maxValue);
+                ++pHistogram[g];
+                pOut[3 * x] = pLut[r];
+                pOut[3 * x + 1] = pLut[g];
+                pOut[3 * x + 2] = pLut[b];
+            }
+        }
+
+        // Moves the points towards the clip levels of the histogram of the frame and rebuilds the table if they moved.
+        void UpdateContrast()
+        {
+            if (m_settings.AutoContrast)
+            {
+                uint64_t total = 0;
+                for (size_t v = 0; v < m_histogram.size(); ++v)
+                {
+                    total += m_histogram[v];
+                }
+                if (total != 0)
+                {
+                    const uint64_t clipCount = static_cast<uint64_t>(m_settings.ClipFraction * total);
+                    uint32_t black = 0;
+                    for (uint64_t count = m_histogram[0]; black < m_maxValue && count <= clipCount; count += m_histogram[++black])
+                    {
+                    }
+                    uint32_t white = m_maxValue;
+                    for (uint64_t count = m_histogram[m_maxValue]; white > black && count <= clipCount; count += m_histogram[--white])
+                    {
+                    }
+                    // A flat frame would be stretched to noise, the range spans at least a 64th of the values.
+                    const double minRange = (m_maxValue + 1) / 64.0;
+                    const double target = std::max<double>( white, black + minRange);
+                    m_blackPoint += 0.3 * (black - m_blackPoint);
+                    m_whitePoint += 0.3 * (std::min<double>( target, m_maxValue) - m_whitePoint);
+                }
+            }
+            std::fill( m_histogram.begin(), m_histogram.end(), 0);
+            if (static_cast<uint32_t>(m_blackPoint + 0.5) != m_lutBlack || static_cast<uint32_t>(m_whitePoint + 0.5) != m_lutWhite)
+            {
+                BuildLut();
+            }
+        }
+
+        void BuildLut()
+        {
+            m_lutBlack = static_cast<uint32_t>(m_blackPoint + 0.5);
+            m_lutWhite = std::max( m_lutBlack + 1, static_cast<uint32_t>(m_whitePoint + 0.5));
+            const uint32_t range = m_lutWhite - m_lutBlack;
+            const uint32_t lastIndex = static_cast<uint32_t>(m_gammaTable.size() - 1);
+            m_lut.resize( m_maxValue + 1);
+            for (uint32_t v = 0; v <= m_maxValue; ++v)
+            {
+                const uint32_t offset = std::min( std::max( v, m_lutBlack), m_lutWhite) - m_lutBlack;
+                m_lut[v] = m_gammaTable[(offset * lastIndex + range / 2) / range];
+            }
+        }
+
+        SPreviewSettings m_settings;
+        EPixelType m_pixelType;
+        uint32_t m_maxValue;
+        double m_blackPoint;            // Smoothed points.
+        double m_whitePoint;
+        uint32_t m_lutBlack;            // Points the table was built with.
+        uint32_t m_lutWhite;
+        std::vector<uint8_t> m_gammaTable;
+        std::vector<uint8_t> m_lut;
+        std::vector<uint32_t> m_histogram;
+        std::vector<uint16_t> m_rows;
+        std::vector<uint8_t> m_output;
+        CPylonImage m_image;
+    };
+}
+
+#endif /* INCLUDED_PREVIEWRENDERER_H_3860527 */
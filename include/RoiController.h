@@ -0,0 +1,497 @@
+// Contains a controller that switches the image AOI of a grabbing camera.
+/*
+   The payload of a frame and, on CMOS sensors read out row by row, the frame period shrink with the
+   image AOI. A processing stage asks CRoiController for a smaller AOI, e.g. around a target found by
+   GetBrightCentroid(), and the controller applies it with the least disruption of the grab:
+
+       RoiSwitch_Move     only the offsets change. They are written while grabbing, the next exposure
+                          uses the new position. No frame is lost.
+       RoiSwitch_Restart  the size changes. Width and Height are not writable while grabbing, grabbing
+                          is stopped, the AOI is written and grabbing is started again.
+
+   Requests are fitted to the sensor and the increments of the camera, see FitRoi(). Request() may be
+   called from any thread. Apply( false) only moves and can be called by the image event handler, a
+   pending size change waits for Apply( true) from a thread that may stop grabbing. Apply( true) while
+   not grabbing only writes the AOI, for an application restarting the grab itself. OnFrame() measures
+   the switch latency, from Apply() to the first frame delivered with the new AOI.
+
+   When grabbing starts the instant camera allocates MaxNumBuffer buffers of PayloadSize from its buffer
+   factory and frees them when grabbing stops. CPooledBufferFactory keeps the freed buffers and hands
+   them out again for every payload that fits, so restarts with a smaller AOI allocate nothing. It is
+   owned by the application, attach it with SetBufferFactory( &factory, Cleanup_None) and destroy it
+   after the camera. The synthetic frame source keeps its buffers the same way.
+
+   The controller uses the parameters Width, Height, OffsetX and OffsetY of the camera types of
+   CameraTransport.h and of CSyntheticFrameSource.
+*/
+
+#ifndef INCLUDED_ROICONTROLLER_H_4471926
+#define INCLUDED_ROICONTROLLER_H_4471926
+
+#include <pylon/PylonIncludes.h>
+#include "CameraNodeAccess.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace Pylon
+{
+    // An image AOI in sensor pixels.
+    struct SRoi
+    {
+        SRoi()
+            : OffsetX( 0)
+            , OffsetY( 0)
+            , Width( 0)
+            , Height( 0)
+        {
+        }
+
+        SRoi( int64_t offsetX, int64_t offsetY, int64_t width, int64_t height)
+            : OffsetX( offsetX)
+            , OffsetY( offsetY)
+            , Width( width)
+            , Height( height)
+        {
+        }
+
+        bool operator==( const SRoi& other) const
+        {
+            return OffsetX == other.OffsetX && OffsetY == other.OffsetY && Width == other.Width && Height == other.Height;
+        }
+
+        bool operator!=( const SRoi& other) const
+        {
+            return !(*this == other);
+        }
+
+        bool IsSameSize( const SRoi& other) const
+        {
+            return Width == other.Width && Height == other.Height;
+        }
+
+        int64_t OffsetX;
+        int64_t OffsetY;
+        int64_t Width;
+        int64_t Height;
+    };
+
+    // The sensor size and the constraints of the AOI parameters of a camera.
+    struct SRoiLimits
+    {
+        SRoiLimits()
+            : SensorWidth( 0)
+            , SensorHeight( 0)
+            , MinWidth( 1)
+            , MinHeight( 1)
+            , WidthIncrement( 1)
+            , HeightIncrement( 1)
+            , OffsetXIncrement( 1)
+            , OffsetYIncrement( 1)
+            , IsMovable( false)
+        {
+        }
+
+        int64_t SensorWidth;
+        int64_t SensorHeight;
+        int64_t MinWidth;
+        int64_t MinHeight;
+        int64_t WidthIncrement;
+        int64_t HeightIncrement;
+        int64_t OffsetXIncrement;
+        int64_t OffsetYIncrement;
+        bool IsMovable;             // The offsets can be written while grabbing.
+    };
+
+    // Reads the limits of an opened camera. The maximum of Width is the sensor width minus OffsetX.
+    template <typename CameraT>
+    SRoiLimits GetRoiLimits( CameraT& camera)
+    {
+        using GenApi::IsWritable;
+
+        SRoiLimits limits;
+        limits.SensorWidth = camera.Width.GetMax() + camera.OffsetX.GetValue();
+        limits.SensorHeight = camera.Height.GetMax() + camera.OffsetY.GetValue();
+        limits.MinWidth = camera.Width.GetMin();
+        limits.MinHeight = camera.Height.GetMin();
+        limits.WidthIncrement = std::max<int64_t>( 1, camera.Width.GetInc());
+        limits.HeightIncrement = std::max<int64_t>( 1, camera.Height.GetInc());
+        limits.OffsetXIncrement = std::max<int64_t>( 1, camera.OffsetX.GetInc());
+        limits.OffsetYIncrement = std::max<int64_t>( 1, camera.OffsetY.GetInc());
+        limits.IsMovable = IsWritable( camera.OffsetX) && IsWritable( camera.OffsetY);
+        return limits;
+    }
+
+    // Fits an AOI to the sensor and the increments. The size is rounded down, the AOI is shifted into the sensor.
+    inline SRoi FitRoi( const SRoi& roi, const SRoiLimits& limits)
+    {
+        SRoi fitted;
+        fitted.Width = std::min( std::max( roi.Width, limits.MinWidth), limits.SensorWidth);
+        fitted.Width -= (fitted.Width - limits.MinWidth) % limits.WidthIncrement;
+        fitted.Height = std::min( std::max( roi.Height, limits.MinHeight), limits.SensorHeight);
+        fitted.Height -= (fitted.Height - limits.MinHeight) % limits.HeightIncrement;
+        fitted.OffsetX = std::min( std::max<int64_t>( roi.OffsetX, 0), limits.SensorWidth - fitted.Width);
+        fitted.OffsetX -= fitted.OffsetX % limits.OffsetXIncrement;
+        fitted.OffsetY = std::min( std::max<int64_t>( roi.OffsetY, 0), limits.SensorHeight - fitted.Height);
+        fitted.OffsetY -= fitted.OffsetY % limits.OffsetYIncrement;
+        return fitted;
+    }
+
+    inline SRoi GetFullSensorRoi( const SRoiLimits& limits)
+    {
+        return FitRoi( SRoi( 0, 0, limits.SensorWidth, limits.SensorHeight), limits);
+    }
+
+    // An AOI of the given size centered on the sensor position x, y.
+    inline SRoi GetCenteredRoi( const SRoiLimits& limits, int64_t width, int64_t height, int64_t x, int64_t y)
+    {
+        return FitRoi( SRoi( x - width / 2, y - height / 2, width, height), limits);
+    }
+
+    // Writes the AOI with CAoiNodesT, the offsets only if they are writable.
+    template <typename CameraT>
+    void WriteRoi( CameraT& camera, const SRoi& roi)
+    {
+        using GenApi::IsWritable;
+
+        CAoiNodesT<CameraT>::WriteAoi( camera.Width, camera.Height, IsWritable( camera.OffsetX) ? &camera.OffsetX : NULL,
+            IsWritable( camera.OffsetY) ? &camera.OffsetY : NULL, roi.Width, roi.Height, roi.OffsetX, roi.OffsetY);
+    }
+
+    // Finds the centroid of the pixels brighter than the middle of the darkest and the brightest pixel, in sensor
+    // coordinates. Every subsample-th row and column is used. Returns false for an image without contrast.
+    template <typename GrabResultPtrT>
+    bool GetBrightCentroid( const GrabResultPtrT& ptrGrabResult, double& x, double& y, uint32_t subsample = 4)
+    {
+        const uint32_t width = ptrGrabResult->GetWidth();
+        const uint32_t height = ptrGrabResult->GetHeight();
+        const bool is8Bit = ptrGrabResult->GetPixelType() == PixelType_Mono8;
+        const size_t stride = static_cast<size_t>(width) * (is8Bit ? 1 : 2) + ptrGrabResult->GetPaddingX();
+        const uint8_t* pImage = static_cast<const uint8_t*>(ptrGrabResult->GetBuffer());
+        const uint32_t step = std::max( 1u, subsample);
+
+        uint32_t minimum = 0xFFFF;
+        uint32_t maximum = 0;
+        for (uint32_t row = 0; row < height; row += step)
+        {
+            const uint8_t* pRow = pImage + row * stride;
+            for (uint32_t column = 0; column < width; column += step)
+            {
+                const uint32_t value = is8Bit ? pRow[column] : reinterpret_cast<const uint16_t*>(pRow)[column];
+                minimum = std::min( minimum, value);
+                maximum = std::max( maximum, value);
+            }
+        }
+        if (maximum <= minimum)
+        {
+            return false;
+        }
+
+        const uint32_t threshold = minimum + (maximum - minimum) / 2;
+        double sum = 0.0;
+        double sumX = 0.0;
+        double sumY = 0.0;
+        for (uint32_t row = 0; row < height; row += step)
+        {
+            const uint8_t* pRow = pImage + row * stride;
+            for (uint32_t column = 0; column < width; column += step)
+            {
+                const uint32_t value = is8Bit ? pRow[column] : reinterpret_cast<const uint16_t*>(pRow)[column];
+                if (value > threshold)
+                {
+                    const double weight = value - threshold;
+                    sum += weight;
+                    sumX += weight * column;
+                    sumY += weight * row;
+                }
+            }
+        }
+        x = ptrGrabResult->GetOffsetX() + sumX / sum;
+        y = ptrGrabResult->GetOffsetY() + sumY / sum;
+        return true;
+    }
+
+
+    // A buffer factory keeping its buffers. A buffer is handed out again for every payload it can hold.
+    class CPooledBufferFactory : public IBufferFactory
+    {
+    public:
+        CPooledBufferFactory()
+            : m_allocationCount( 0)
+            , m_reuseCount( 0)
+        {
+        }
+
+        virtual ~CPooledBufferFactory()
+        {
+            for (size_t i = 0; i < m_buffers.size(); ++i)
+            {
+                delete[] m_buffers[i].pBuffer;
+            }
+        }
+
+        // Allocates count buffers of size bytes ahead, e.g. the payload of the full sensor.
+        void Reserve( size_t count, size_t size)
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            for (size_t i = m_buffers.size(); i < count; ++i)
+            {
+                SBuffer buffer = { new uint8_t[size], size, false };
+                m_buffers.push_back( buffer);
+                ++m_allocationCount;
+            }
+        }
+
+        virtual void AllocateBuffer( size_t bufferSize, void** pCreatedBuffer, intptr_t& bufferContext)
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            // The smallest free buffer that fits, so that large buffers remain for large payloads.
+            size_t best = m_buffers.size();
+            for (size_t i = 0; i < m_buffers.size(); ++i)
+            {
+                if (!m_buffers[i].IsInUse && m_buffers[i].Size >= bufferSize && (best == m_buffers.size() || m_buffers[i].Size < m_buffers[best].Size))
+                {
+                    best = i;
+                }
+            }
+            if (best == m_buffers.size())
+            {
+                SBuffer buffer = { new uint8_t[bufferSize], bufferSize, false };
+                m_buffers.push_back( buffer);
+                ++m_allocationCount;
+            }
+            else
+            {
+                ++m_reuseCount;
+            }
+            m_buffers[best].IsInUse = true;
+            *pCreatedBuffer = m_buffers[best].pBuffer;
+            bufferContext = static_cast<intptr_t>(best);
+        }
+
+        virtual void FreeBuffer( void* /*pCreatedBuffer*/, intptr_t bufferContext)
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            m_buffers.at( static_cast<size_t>(bufferContext)).IsInUse = false;
+        }
+
+        // The factory is owned by the application.
+        virtual void DestroyBufferFactory()
+        {
+        }
+
+        size_t GetAllocationCount() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_allocationCount;
+        }
+
+        size_t GetReuseCount() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_reuseCount;
+        }
+
+    private:
+        CPooledBufferFactory( const CPooledBufferFactory&);
+        CPooledBufferFactory& operator=( const CPooledBufferFactory&);
+
+        struct SBuffer
+        {
+            uint8_t* pBuffer;
+            size_t Size;
+            bool IsInUse;
+        };
+
+        mutable std::mutex m_lock;
+        std::vector<SBuffer> m_buffers;
+        size_t m_allocationCount;
+        size_t m_reuseCount;
+    };
+
+
+    // How an AOI was applied.
+    enum ERoiSwitch
+    {
+        RoiSwitch_None,
+        RoiSwitch_Move,
+        RoiSwitch_Restart
+    };
+
+    template <typename CameraT>
+    class CRoiController
+    {
+    public:
+        typedef std::chrono::steady_clock Clock_t;
+
+        explicit CRoiController( CameraT& camera)
+            : m_camera( camera)
+            , m_isPending( false)
+            , m_isSwitching( false)
+            , m_switch( RoiSwitch_None)
+        {
+        }
+
+        // Reads the limits and the current AOI of the opened camera.
+        void Open()
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            m_limits = GetRoiLimits( m_camera);
+            m_roi = SRoi( m_camera.OffsetX.GetValue(), m_camera.OffsetY.GetValue(), m_camera.Width.GetValue(), m_camera.Height.GetValue());
+            m_requested = m_roi;
+            m_isPending = false;
+        }
+
+        // Sets the function restarting the grab, by default StartGrabbing() of the camera.
+        void SetStartGrabbing( const std::function<void()>& startGrabbing)
+        {
+            m_startGrabbing = startGrabbing;
+        }
+
+        void Request( const SRoi& roi)
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            m_requested = FitRoi( roi, m_limits);
+            m_isPending = m_requested != m_roi;
+        }
+
+        // Keeps the size of the requested AOI and centers it on the sensor position x, y, e.g. to follow a target.
+        void RequestCenter( double x, double y)
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            m_requested = GetCenteredRoi( m_limits, m_requested.Width, m_requested.Height, static_cast<int64_t>(x), static_cast<int64_t>(y));
+            m_isPending = m_requested != m_roi;
+        }
+
+        void RequestFullSensor()
+        {
+            Request( GetFullSensorRoi( GetLimits()));
+        }
+
+        bool IsPending() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_isPending;
+        }
+
+        // Applies the requested AOI. A size change while grabbing needs isRestartAllowed, else it stays pending.
+        ERoiSwitch Apply( bool isRestartAllowed)
+        {
+            std::unique_lock<std::mutex> lock( m_lock);
+            if (!m_isPending)
+            {
+                return RoiSwitch_None;
+            }
+            const SRoi roi = m_requested;
+            const bool isGrabbing = m_camera.IsGrabbing();
+            const bool isMove = isGrabbing && roi.IsSameSize( m_roi) && m_limits.IsMovable;
+            if (isGrabbing && !isMove && !isRestartAllowed)
+            {
+                return RoiSwitch_None;
+            }
+            m_isPending = false;
+            m_roi = roi;
+            m_switchStart = Clock_t::now();
+            m_isSwitching = true;
+            m_switch = isMove ? RoiSwitch_Move : RoiSwitch_Restart;
+            // The grab thread calls OnFrame() while the camera is restarted.
+            lock.unlock();
+
+            if (isMove)
+            {
+                m_camera.OffsetX.SetValue( roi.OffsetX);
+                m_camera.OffsetY.SetValue( roi.OffsetY);
+                return RoiSwitch_Move;
+            }
+
+            if (isGrabbing)
+            {
+                m_camera.StopGrabbing();
+            }
+            WriteRoi( m_camera, roi);
+            if (isGrabbing)
+            {
+                if (m_startGrabbing)
+                {
+                    m_startGrabbing();
+                }
+                else
+                {
+                    m_camera.StartGrabbing();
+                }
+            }
+            return RoiSwitch_Restart;
+        }
+
+        // Records the switch latency when the first frame with the applied AOI arrives. Returns true for that frame.
+        template <typename GrabResultPtrT>
+        bool OnFrame( const GrabResultPtrT& ptrGrabResult)
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            if (!m_isSwitching || ptrGrabResult->GetOffsetX() != m_roi.OffsetX || ptrGrabResult->GetOffsetY() != m_roi.OffsetY
+                || ptrGrabResult->GetWidth() != m_roi.Width || ptrGrabResult->GetHeight() != m_roi.Height)
+            {
+                return false;
+            }
+            m_isSwitching = false;
+            const double latency = std::chrono::duration<double>( Clock_t::now() - m_switchStart).count();
+            (m_switch == RoiSwitch_Move ? m_moveLatencies : m_restartLatencies).push_back( latency);
+            return true;
+        }
+
+        SRoi GetRoi() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_roi;
+        }
+
+        SRoiLimits GetLimits() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_limits;
+        }
+
+        // The latency in seconds of the last switch completed.
+        double GetLastLatency() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            const std::vector<double>& latencies = m_switch == RoiSwitch_Move ? m_moveLatencies : m_restartLatencies;
+            return latencies.empty() ? 0.0 : latencies.back();
+        }
+
+        // The latencies in seconds of the switches completed so far.
+        std::vector<double> GetMoveLatencies() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_moveLatencies;
+        }
+
+        std::vector<double> GetRestartLatencies() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_restartLatencies;
+        }
+
+    private:
+        CRoiController( const CRoiController&);
+        CRoiController& operator=( const CRoiController&);
+
+        CameraT& m_camera;
+        std::function<void()> m_startGrabbing;
+        mutable std::mutex m_lock;
+        SRoiLimits m_limits;
+        SRoi m_roi;                 // The AOI applied last.
+        SRoi m_requested;
+        bool m_isPending;
+        bool m_isSwitching;         // Waiting for the first frame with m_roi.
+        ERoiSwitch m_switch;
+        Clock_t::time_point m_switchStart;
+        std::vector<double> m_moveLatencies;
+        std::vector<double> m_restartLatencies;
+    };
+}
+
+#endif /* INCLUDED_ROICONTROLLER_H_4471926 */
@@ -1,4 +1,14 @@
 // Contains functions for creating sample images.
+/*
+   The fractal test patterns are computed by a pattern engine:
+   - The iteration runs in SIMD lanes (float or double) with a per-lane active mask. A vector of pixels
+     leaves the iteration loop as soon as all of its lanes have escaped.
+   - The image is split into row bands that are processed by several threads.
+   - Mono8, Mono12, BayerGB12 and RGB8packed are written directly through lookup tables, without a
+     format conversion pass. Mono12 and BayerGB12 are LSB aligned like the camera buffers.
+   - CFractalFramePool precomputes a cycle of frames that can be replayed at camera rate.
+   The original scalar generators are kept in the namespace SampleImageCreator::Reference.
+*/
 
 #ifndef INCLUDED_SAMPLEIMAGECREATOR_H_2792867
 #define INCLUDED_SAMPLEIMAGECREATOR_H_2792867
@@ -7,157 +17,681 @@
 #include <pylon/Pixel.h>
 #include <pylon/ImageFormatConverter.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__AVX__)
+#    include <immintrin.h>
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#    include <emmintrin.h>
+#    define SAMPLEIMAGECREATOR_USE_SSE2
+#endif
+
 namespace SampleImageCreator
 {
-    Pylon::CPylonImage CreateJuliaFractal( Pylon::EPixelType pixelType, uint32_t width, uint32_t height)
+    enum EFractalType
     {
-        // Allow all the names in the namespace Pylon to be used without qualification.
-        using namespace Pylon;
+        FractalType_Julia,
+        FractalType_Mandelbrot
+    };
 
-        // Define Constants.
-        static const SRGB8Pixel palette[]=
+    enum EFractalPrecision
+    {
+        FractalPrecision_Float,
+        FractalPrecision_Double
+    };
+
+    // Settings of the fractal pattern engine.
+    struct SFractalSettings
+    {
+        SFractalSettings()
+            : Type( FractalType_Julia)
+            , PixelType( Pylon::PixelType_Mono8)
+            , Width( 640)
+            , Height( 480)
+            , MaxIterations( 50)
+            , Precision( FractalPrecision_Float)
+            , NumThreads( 0)
+            , Phase( 0.0)
+        {
+        }
+
+        EFractalType Type;
+        Pylon::EPixelType PixelType;    // Mono8, Mono12, BayerGB12 or RGB8packed.
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t MaxIterations;         // At most 255.
+        EFractalPrecision Precision;
+        unsigned int NumThreads;        // 0 uses one thread per hardware thread.
+        double Phase;                   // Animation phase in [0, 1). Frames with phase 0 and 1 are equal.
+    };
+
+
+    namespace Detail
+    {
+        // Lane types used by the iteration kernel. Each provides the same set of static functions so that the
+        // kernel is written only once.
+        template <typename T>
+        struct SScalarLanes
         {
-            {0, 28, 50}, {0, 42, 75}, {0, 56, 100}, {0, 70, 125}, {0, 84, 150},
-            {0, 50, 0}, {0, 100, 0}, {0, 150, 0}, {0, 200, 0}, {0, 250, 0},
-            {50, 0, 0}, {100, 0, 0}, {150, 0, 0}, {200, 0, 0}, {250, 0, 0}
+            typedef T Scalar;
+            typedef T Vec;
+            enum { Count = 1 };
+            static Vec Set1( T value) { return value; }
+            static Vec Ramp( T start, T /*step*/) { return start; }
+            static Vec Add( Vec a, Vec b) { return a + b; }
+            static Vec Sub( Vec a, Vec b) { return a - b; }
+            static Vec Mul( Vec a, Vec b) { return a * b; }
+            static Vec LessEqual( Vec a, Vec b) { return a <= b ? T( 1) : T( 0); }
+            static Vec And( Vec mask, Vec value) { return mask != T( 0) ? value : T( 0); }
+            static Vec AllSet() { return T( 1); }
+            static bool Any( Vec mask) { return mask != T( 0); }
+            static void Store( T* p, Vec v) { *p = v; }
         };
-        uint32_t numColors = sizeof( palette) / sizeof( palette[0]);
 
-        const double cX = -0.735;
-        const double cY = 0.11;
-        const double cMaxX = 1.6;
-        const double cMinX = -1.6;
-        const double cMaxY = 1;
-        const double cMinY = -1;
-        const uint32_t cMaxIterations = 50;
+#if defined(__AVX2__) || defined(__AVX__)
+        struct SFloatLanes
+        {
+            typedef float Scalar;
+            typedef __m256 Vec;
+            enum { Count = 8 };
+            static Vec Set1( float value) { return _mm256_set1_ps( value); }
+            static Vec Ramp( float start, float step)
+            {
+                return _mm256_add_ps( _mm256_set1_ps( start), _mm256_mul_ps( _mm256_set1_ps( step), _mm256_setr_ps( 0, 1, 2, 3, 4, 5, 6, 7)));
+            }
+            static Vec Add( Vec a, Vec b) { return _mm256_add_ps( a, b); }
+            static Vec Sub( Vec a, Vec b) { return _mm256_sub_ps( a, b); }
+            static Vec Mul( Vec a, Vec b) { return _mm256_mul_ps( a, b); }
+            static Vec LessEqual( Vec a, Vec b) { return _mm256_cmp_ps( a, b, _CMP_LE_OQ); }
+            static Vec And( Vec mask, Vec value) { return _mm256_and_ps( mask, value); }
+            static Vec AllSet() { return _mm256_castsi256_ps( _mm256_set1_epi32( -1)); }
+            static bool Any( Vec mask) { return _mm256_movemask_ps( mask) != 0; }
+            static void Store( float* p, Vec v) { _mm256_storeu_ps( p, v); }
+        };
 
-        // Create image.
-        CPylonImage juliaFractal( CPylonImage::Create( PixelType_RGB8packed, width, height));
+        struct SDoubleLanes
+        {
+            typedef double Scalar;
+            typedef __m256d Vec;
+            enum { Count = 4 };
+            static Vec Set1( double value) { return _mm256_set1_pd( value); }
+            static Vec Ramp( double start, double step)
+            {
+                return _mm256_add_pd( _mm256_set1_pd( start), _mm256_mul_pd( _mm256_set1_pd( step), _mm256_setr_pd( 0, 1, 2, 3)));
+            }
+            static Vec Add( Vec a, Vec b) { return _mm256_add_pd( a, b); }
+            static Vec Sub( Vec a, Vec b) { return _mm256_sub_pd( a, b); }
+            static Vec Mul( Vec a, Vec b) { return _mm256_mul_pd( a, b); }
+            static Vec LessEqual( Vec a, Vec b) { return _mm256_cmp_pd( a, b, _CMP_LE_OQ); }
+            static Vec And( Vec mask, Vec value) { return _mm256_and_pd( mask, value); }
+            static Vec AllSet() { return _mm256_castsi256_pd( _mm256_set1_epi32( -1)); }
+            static bool Any( Vec mask) { return _mm256_movemask_pd( mask) != 0; }
+            static void Store( double* p, Vec v) { _mm256_storeu_pd( p, v); }
+        };
+#elif defined(SAMPLEIMAGECREATOR_USE_SSE2)
+        struct SFloatLanes
+        {
+            typedef float Scalar;
+            typedef __m128 Vec;
+            enum { Count = 4 };
+            static Vec Set1( float value) { return _mm_set1_ps( value); }
+            static Vec Ramp( float start, float step)
+            {
+                return _mm_add_ps( _mm_set1_ps( start), _mm_mul_ps( _mm_set1_ps( step), _mm_setr_ps( 0, 1, 2, 3)));
+            }
+            static Vec Add( Vec a, Vec b) { return _mm_add_ps( a, b); }
+            static Vec Sub( Vec a, Vec b) { return _mm_sub_ps( a, b); }
+            static Vec Mul( Vec a, Vec b) { return _mm_mul_ps( a, b); }
+            static Vec LessEqual( Vec a, Vec b) { return _mm_cmple_ps( a, b); }
+            static Vec And( Vec mask, Vec value) { return _mm_and_ps( mask, value); }
+            static Vec AllSet() { return _mm_castsi128_ps( _mm_set1_epi32( -1)); }
+            static bool Any( Vec mask) { return _mm_movemask_ps( mask) != 0; }
+            static void Store( float* p, Vec v) { _mm_storeu_ps( p, v); }
+        };
 
-        // Get the pointer to the first pixel.
-        SRGB8Pixel* pCurrentPixel = (SRGB8Pixel*) juliaFractal.GetBuffer();
+        struct SDoubleLanes
+        {
+            typedef double Scalar;
+            typedef __m128d Vec;
+            enum { Count = 2 };
+            static Vec Set1( double value) { return _mm_set1_pd( value); }
+            static Vec Ramp( double start, double step) { return _mm_setr_pd( start, start + step); }
+            static Vec Add( Vec a, Vec b) { return _mm_add_pd( a, b); }
+            static Vec Sub( Vec a, Vec b) { return _mm_sub_pd( a, b); }
+            static Vec Mul( Vec a, Vec b) { return _mm_mul_pd( a, b); }
+            static Vec LessEqual( Vec a, Vec b) { return _mm_cmple_pd( a, b); }
+            static Vec And( Vec mask, Vec value) { return _mm_and_pd( mask, value); }
+            static Vec AllSet() { return _mm_castsi128_pd( _mm_set1_epi32( -1)); }
+            static bool Any( Vec mask) { return _mm_movemask_pd( mask) != 0; }
+            static void Store( double* p, Vec v) { _mm_storeu_pd( p, v); }
+        };
+#else
+        typedef SScalarLanes<float> SFloatLanes;
+        typedef SScalarLanes<double> SDoubleLanes;
+#endif
 
-        // Compute the fractal.
-        for ( uint32_t pixelY = 0; pixelY < height; ++pixelY )
+        // The view of a fractal frame.
+        struct SFractalView
         {
-            for ( uint32_t pixelX = 0; pixelX < width; ++pixelX, ++pCurrentPixel )
+            double MinX;
+            double MaxX;
+            double MinY;
+            double MaxY;
+            double CX;          // Julia constant.
+            double CY;
+            bool IsJulia;
+        };
+
+        inline SFractalView GetFractalView( const SFractalSettings& settings)
+        {
+            const double pi = 3.14159265358979323846;
+            const double angle = 2.0 * pi * settings.Phase;
+            SFractalView view;
+            if (settings.Type == FractalType_Julia)
             {
-                long double x = ((cMaxX-cMinX) / width) * pixelX + cMinX;
-                long double y = cMaxY - pixelY * ((cMaxY-cMinY) / height);
-                long double xd = 0;
-                long double yd = 0;
-                int i = 0;
+                // The constant moves on a small circle, which makes the structures breathe.
+                view.MinX = -1.6; view.MaxX = 1.6; view.MinY = -1.0; view.MaxY = 1.0;
+                view.CX = -0.735 + 0.02 * (cos( angle) - 1.0);
+                view.CY = 0.11 + 0.02 * sin( angle);
+                view.IsJulia = true;
+            }
+            else
+            {
+                // The view pans on a small circle.
+                const double shiftX = 0.05 * (cos( angle) - 1.0);
+                const double shiftY = 0.05 * sin( angle);
+                view.MinX = -2.0 + shiftX; view.MaxX = 1.0 + shiftX; view.MinY = -1.2 + shiftY; view.MaxY = 1.2 + shiftY;
+                view.CX = 0.0;
+                view.CY = 0.0;
+                view.IsJulia = false;
+            }
+            return view;
+        }
+
+        // Computes the escape iteration counts of one row. Counts equal to maxIterations mark points that did not escape.
+        template <typename Lanes>
+        void IterateRow( const SFractalView& view, uint32_t width, uint32_t height, uint32_t row, uint32_t maxIterations, uint8_t* pCounts)
+        {
+            typedef typename Lanes::Scalar Scalar;
+            typedef typename Lanes::Vec Vec;
+
+            const double stepX = (view.MaxX - view.MinX) / width;
+            const Scalar y0 = static_cast<Scalar>(view.MaxY - row * ((view.MaxY - view.MinY) / height));
+            const Vec four = Lanes::Set1( Scalar( 4));
+            const Vec one = Lanes::Set1( Scalar( 1));
+            Scalar counts[Lanes::Count];
 
-                for(; i < cMaxIterations; ++i)
+            uint32_t pixelX = 0;
+            for (; pixelX < width; pixelX += Lanes::Count)
+            {
+                // The last vector of a row may be incomplete, its surplus lanes are computed and dropped.
+                Vec x = Lanes::Ramp( static_cast<Scalar>(view.MinX + stepX * pixelX), static_cast<Scalar>(stepX));
+                Vec y = Lanes::Set1( y0);
+                const Vec cx = view.IsJulia ? Lanes::Set1( static_cast<Scalar>(view.CX)) : x;
+                const Vec cy = view.IsJulia ? Lanes::Set1( static_cast<Scalar>(view.CY)) : y;
+                Vec active = Lanes::AllSet();
+                Vec count = Lanes::Set1( Scalar( 0));
+
+                for (uint32_t i = 0; i < maxIterations; ++i)
                 {
-                    xd = x * x - y * y + cX;
-                    yd = 2 *x * y + cY;
-                    x = xd;
-                    y = yd;
-                    if ( (x * x + y * y) > 4 )
+                    const Vec xx = Lanes::Mul( x, x);
+                    const Vec yy = Lanes::Mul( y, y);
+                    const Vec xy = Lanes::Mul( x, y);
+                    x = Lanes::Add( Lanes::Sub( xx, yy), cx);
+                    y = Lanes::Add( Lanes::Add( xy, xy), cy);
+
+                    // A lane stays inactive once it has escaped.
+                    active = Lanes::And( active, Lanes::LessEqual( Lanes::Add( Lanes::Mul( x, x), Lanes::Mul( y, y)), four));
+                    if (!Lanes::Any( active))
                     {
                         break;
                     }
+                    count = Lanes::Add( count, Lanes::And( active, one));
+                }
+
+                Lanes::Store( counts, count);
+                const uint32_t lanes = std::min<uint32_t>( Lanes::Count, width - pixelX);
+                for (uint32_t lane = 0; lane < lanes; ++lane)
+                {
+                    pCounts[pixelX + lane] = static_cast<uint8_t>(counts[lane]);
+                }
+            }
+        }
+
+        // Lookup tables mapping iteration counts to output values.
+        struct SFractalPalette
+        {
+            explicit SFractalPalette( uint32_t maxIterations)
+                : Rgb( maxIterations + 1)
+                , Mono8( maxIterations + 1)
+                , Red12( maxIterations + 1)
+                , Green12( maxIterations + 1)
+                , Blue12( maxIterations + 1)
+                , Mono12( maxIterations + 1)
+            {
+                static const Pylon::SRGB8Pixel palette[]=
+                {
+                    {0, 28, 50}, {0, 42, 75}, {0, 56, 100}, {0, 70, 125}, {0, 84, 150},
+                    {0, 50, 0}, {0, 100, 0}, {0, 150, 0}, {0, 200, 0}, {0, 250, 0},
+                    {50, 0, 0}, {100, 0, 0}, {150, 0, 0}, {200, 0, 0}, {250, 0, 0}
+                };
+                const uint32_t numColors = sizeof( palette) / sizeof( palette[0]);
+
+                for (uint32_t i = 0; i <= maxIterations; ++i)
+                {
+                    const Pylon::SRGB8Pixel color = i >= maxIterations ? palette[0] : palette[i % numColors];
+                    Rgb[i] = color;
+                    Mono8[i] = static_cast<uint8_t>((77 * color.R + 150 * color.G + 29 * color.B) >> 8);
+                    Mono12[i] = Expand12( Mono8[i]);
+                    Red12[i] = Expand12( color.R);
+                    Green12[i] = Expand12( color.G);
+                    Blue12[i] = Expand12( color.B);
                 }
+            }
+
+            static uint16_t Expand12( uint8_t value)
+            {
+                return static_cast<uint16_t>((value << 4) | (value >> 4));
+            }
 
-                if ( i >= cMaxIterations)
+            std::vector<Pylon::SRGB8Pixel> Rgb;
+            std::vector<uint8_t> Mono8;
+            std::vector<uint16_t> Red12;
+            std::vector<uint16_t> Green12;
+            std::vector<uint16_t> Blue12;
+            std::vector<uint16_t> Mono12;
+        };
+
+        // Writes one row of iteration counts in the output pixel format.
+        inline void WriteRow( const SFractalPalette& palette, Pylon::EPixelType pixelType, uint32_t row, uint32_t width, const uint8_t* pCounts, void* pRow)
+        {
+            using namespace Pylon;
+            switch (pixelType)
+            {
+            case PixelType_Mono8:
+                {
+                    uint8_t* pOut = static_cast<uint8_t*>(pRow);
+                    for (uint32_t x = 0; x < width; ++x)
+                    {
+                        pOut[x] = palette.Mono8[pCounts[x]];
+                    }
+                }
+                break;
+            case PixelType_Mono12:
+                {
+                    uint16_t* pOut = static_cast<uint16_t*>(pRow);
+                    for (uint32_t x = 0; x < width; ++x)
+                    {
+                        pOut[x] = palette.Mono12[pCounts[x]];
+                    }
+                }
+                break;
+            case PixelType_BayerGB12:
+                {
+                    // GB layout: even rows G B G B ..., odd rows R G R G ...
+                    const uint16_t* pEven = (row & 1) == 0 ? &palette.Green12[0] : &palette.Red12[0];
+                    const uint16_t* pOdd = (row & 1) == 0 ? &palette.Blue12[0] : &palette.Green12[0];
+                    uint16_t* pOut = static_cast<uint16_t*>(pRow);
+                    uint32_t x = 0;
+                    for (; x + 1 < width; x += 2)
+                    {
+                        pOut[x] = pEven[pCounts[x]];
+                        pOut[x + 1] = pOdd[pCounts[x + 1]];
+                    }
+                    if (x < width)
+                    {
+                        pOut[x] = pEven[pCounts[x]];
+                    }
+                }
+                break;
+            case PixelType_RGB8packed:
                 {
-                    *pCurrentPixel = palette[0];
+                    SRGB8Pixel* pOut = static_cast<SRGB8Pixel*>(pRow);
+                    for (uint32_t x = 0; x < width; ++x)
+                    {
+                        pOut[x] = palette.Rgb[pCounts[x]];
+                    }
                 }
-                else
+                break;
+            default:
+                throw RUNTIME_EXCEPTION( "The fractal pattern engine does not write pixel type 0x%x directly.", static_cast<unsigned int>(pixelType));
+            }
+        }
+
+        template <typename Lanes>
+        void RenderBands( const SFractalSettings& settings, void* pBuffer, size_t stride)
+        {
+            static const uint32_t c_bandHeight = 16;
+            const SFractalView view = GetFractalView( settings);
+            const SFractalPalette palette( settings.MaxIterations);
+            const uint32_t numBands = (settings.Height + c_bandHeight - 1) / c_bandHeight;
+            std::atomic<uint32_t> nextBand( 0);
+
+            // Bands are handed out dynamically because rows inside the fractal set take much longer than the others.
+            auto renderBands = [&]()
+            {
+                std::vector<uint8_t> counts( settings.Width + Lanes::Count);
+                for (uint32_t band = nextBand++; band < numBands; band = nextBand++)
                 {
-                    *pCurrentPixel = palette[ i % numColors ];
+                    const uint32_t lastRow = std::min( settings.Height, (band + 1) * c_bandHeight);
+                    for (uint32_t row = band * c_bandHeight; row < lastRow; ++row)
+                    {
+                        IterateRow<Lanes>( view, settings.Width, settings.Height, row, settings.MaxIterations, &counts[0]);
+                        WriteRow( palette, settings.PixelType, row, settings.Width, &counts[0], static_cast<uint8_t*>(pBuffer) + row * stride);
+                    }
                 }
+            };
+
+            unsigned int numThreads = settings.NumThreads != 0 ? settings.NumThreads : std::thread::hardware_concurrency();
+            numThreads = std::max( 1u, std::min( numThreads, numBands));
+            std::vector<std::thread> threads;
+            for (unsigned int i = 1; i < numThreads; ++i)
+            {
+                threads.push_back( std::thread( renderBands));
             }
+            renderBands();
+            for (size_t i = 0; i < threads.size(); ++i)
+            {
+                threads[i].join();
+            }
+        }
+    }
+
+
+    // Returns true if the pattern engine writes the pixel type directly.
+    inline bool IsDirectFractalPixelType( Pylon::EPixelType pixelType)
+    {
+        return pixelType == Pylon::PixelType_Mono8 || pixelType == Pylon::PixelType_Mono12
+            || pixelType == Pylon::PixelType_BayerGB12 || pixelType == Pylon::PixelType_RGB8packed;
+    }
+
+    // Returns the number of bytes per pixel of the pixel types written directly.
+    inline size_t FractalBytesPerPixel( Pylon::EPixelType pixelType)
+    {
+        switch (pixelType)
+        {
+        case Pylon::PixelType_Mono8: return 1;
+        case Pylon::PixelType_Mono12: return 2;
+        case Pylon::PixelType_BayerGB12: return 2;
+        case Pylon::PixelType_RGB8packed: return 3;
+        default: break;
         }
+        throw RUNTIME_EXCEPTION( "The fractal pattern engine does not write pixel type 0x%x directly.", static_cast<unsigned int>(pixelType));
+    }
+
+    // Renders a fractal into a user buffer. The stride is the distance of two rows in bytes.
+    inline void RenderFractal( const SFractalSettings& settings, void* pBuffer, size_t stride)
+    {
+        if (settings.MaxIterations == 0 || settings.MaxIterations > 255)
+        {
+            throw RUNTIME_EXCEPTION( "The fractal pattern engine supports 1 to 255 iterations.");
+        }
+        FractalBytesPerPixel( settings.PixelType);
+
+        if (settings.Precision == FractalPrecision_Double)
+        {
+            Detail::RenderBands<Detail::SDoubleLanes>( settings, pBuffer, stride);
+        }
+        else
+        {
+            Detail::RenderBands<Detail::SFloatLanes>( settings, pBuffer, stride);
+        }
+    }
+
+    // Renders a fractal into a new image.
+    inline Pylon::CPylonImage RenderFractal( const SFractalSettings& settings)
+    {
+        Pylon::CPylonImage image( Pylon::CPylonImage::Create( settings.PixelType, settings.Width, settings.Height));
+        RenderFractal( settings, image.GetBuffer(), settings.Width * FractalBytesPerPixel( settings.PixelType));
+        return image;
+    }
+
+
+    // A cycle of precomputed fractal frames. Frame n of the cycle is rendered with phase n / cycle length.
+    class CFractalFramePool
+    {
+    public:
+        CFractalFramePool()
+            : m_frameSize( 0)
+        {
+        }
+
+        void Create( const SFractalSettings& settings, uint32_t cycleLength)
+        {
+            m_settings = settings;
+            m_frameSize = static_cast<size_t>(settings.Width) * settings.Height * FractalBytesPerPixel( settings.PixelType);
+            m_frames.assign( std::max( 1u, cycleLength), std::vector<uint8_t>( m_frameSize));
+            for (size_t i = 0; i < m_frames.size(); ++i)
+            {
+                SFractalSettings frameSettings = settings;
+                frameSettings.Phase = static_cast<double>(i) / m_frames.size();
+                RenderFractal( frameSettings, &m_frames[i][0], settings.Width * FractalBytesPerPixel( settings.PixelType));
+            }
+        }
+
+        size_t GetSize() const
+        {
+            return m_frames.size();
+        }
+
+        size_t GetFrameSize() const
+        {
+            return m_frameSize;
+        }
+
+        const SFractalSettings& GetSettings() const
+        {
+            return m_settings;
+        }
+
+        // Returns frame index modulo the cycle length.
+        const void* GetFrame( uint64_t index) const
+        {
+            return &m_frames[static_cast<size_t>(index % m_frames.size())][0];
+        }
+
+    private:
+        SFractalSettings m_settings;
+        size_t m_frameSize;
+        std::vector< std::vector<uint8_t> > m_frames;
+    };
+
+
+    inline Pylon::CPylonImage CreateFractal( EFractalType type, Pylon::EPixelType pixelType, uint32_t width, uint32_t height)
+    {
+        // Allow all the names in the namespace Pylon to be used without qualification.
+        using namespace Pylon;
+
+        SFractalSettings settings;
+        settings.Type = type;
+        settings.Width = width;
+        settings.Height = height;
+        settings.PixelType = IsDirectFractalPixelType( pixelType) ? pixelType : PixelType_RGB8packed;
+
+        // Create image.
+        CPylonImage fractal( RenderFractal( settings));
 
         // Convert the image to the target format if needed.
-        if ( juliaFractal.GetPixelType() != pixelType)
+        if ( fractal.GetPixelType() != pixelType)
         {
             CImageFormatConverter converter;
             converter.OutputPixelFormat = pixelType;
             converter.OutputBitAlignment = OutputBitAlignment_MsbAligned;
-            converter.Convert( juliaFractal, CPylonImage( juliaFractal));
+            converter.Convert( fractal, CPylonImage( fractal));
         }
 
         // Return the image.
-        return juliaFractal;
+        return fractal;
     }
 
+    inline Pylon::CPylonImage CreateJuliaFractal( Pylon::EPixelType pixelType, uint32_t width, uint32_t height)
+    {
+        return CreateFractal( FractalType_Julia, pixelType, width, height);
+    }
 
-    Pylon::CPylonImage CreateMandelbrotFractal( Pylon::EPixelType pixelType, uint32_t width, uint32_t height)
+    inline Pylon::CPylonImage CreateMandelbrotFractal( Pylon::EPixelType pixelType, uint32_t width, uint32_t height)
     {
-        // Allow all the names in the namespace Pylon to be used without qualification.
-        using namespace Pylon;
+        return CreateFractal( FractalType_Mandelbrot, pixelType, width, height);
+    }
+
 
-        // Define constants.
-        static const SRGB8Pixel palette[]=
+    // The original scalar generators, used as reference by the benchmarks.
+    namespace Reference
+    {
+        inline Pylon::CPylonImage CreateJuliaFractal( Pylon::EPixelType pixelType, uint32_t width, uint32_t height)
         {
-            {0, 28, 50}, {0, 42, 75}, {0, 56, 100}, {0, 70, 125}, {0, 84, 150},
-            {0, 50, 0}, {0, 100, 0}, {0, 150, 0}, {0, 200, 0}, {0, 250, 0},
-            {50, 0, 0}, {100, 0, 0}, {150, 0, 0}, {200, 0, 0}, {250, 0, 0}
-        };
-        uint32_t numColors = sizeof( palette) / sizeof( palette[0]);
+            // Allow all the names in the namespace Pylon to be used without qualification.
+            using namespace Pylon;
 
-        const double  cMaxX = 1.0;
-        const double  cMinX = -2.0;
-        const double  cMaxY = 1.2;
-        const double  cMinY = -1.2;
-        const uint32_t cMaxIterations = 50;
+            // Define Constants.
+            static const SRGB8Pixel palette[]=
+            {
+                {0, 28, 50}, {0, 42, 75}, {0, 56, 100}, {0, 70, 125}, {0, 84, 150},
+                {0, 50, 0}, {0, 100, 0}, {0, 150, 0}, {0, 200, 0}, {0, 250, 0},
+                {50, 0, 0}, {100, 0, 0}, {150, 0, 0}, {200, 0, 0}, {250, 0, 0}
+            };
+            uint32_t numColors = sizeof( palette) / sizeof( palette[0]);
 
-        // Create image.
-        CPylonImage mandelbrotFractal( CPylonImage::Create( PixelType_RGB8packed, width, height));
+            const double cX = -0.735;
+            const double cY = 0.11;
+            const double cMaxX = 1.6;
+            const double cMinX = -1.6;
+            const double cMaxY = 1;
+            const double cMinY = -1;
+            const uint32_t cMaxIterations = 50;
 
-        // Get the pointer to the first pixel.
-        SRGB8Pixel* pCurrentPixel = (SRGB8Pixel*) mandelbrotFractal.GetBuffer();
+            // Create image.
+            CPylonImage juliaFractal( CPylonImage::Create( PixelType_RGB8packed, width, height));
 
-        // Compute the fractal.
-        for ( uint32_t pixelY = 0; pixelY < height; ++pixelY )
-        {
-            for ( uint32_t pixelX = 0; pixelX < width; ++pixelX, ++pCurrentPixel )
-            {
-                long double xStart = ((cMaxX-cMinX) / width) * pixelX + cMinX;
-                long double yStart = cMaxY - pixelY * ((cMaxY-cMinY) / height);
-                long double x = xStart;
-                long double y = yStart;
-                long double xd =0;
-                long double yd =0;
-                int i = 0;
+            // Get the pointer to the first pixel.
+            SRGB8Pixel* pCurrentPixel = (SRGB8Pixel*) juliaFractal.GetBuffer();
 
-                for(; i < cMaxIterations; ++i)
+            // Compute the fractal.
+            for ( uint32_t pixelY = 0; pixelY < height; ++pixelY )
+            {
+                for ( uint32_t pixelX = 0; pixelX < width; ++pixelX, ++pCurrentPixel )
                 {
-                    xd = x * x - y * y + xStart;
-                    yd = 2 *x * y + yStart;
-                    x = xd;
-                    y = yd;
-                    if ( (x * x + y * y) > 4 )
+                    long double x = ((cMaxX-cMinX) / width) * pixelX + cMinX;
+                    long double y = cMaxY - pixelY * ((cMaxY-cMinY) / height);
+                    long double xd = 0;
+                    long double yd = 0;
+                    uint32_t i = 0;
+
+                    for(; i < cMaxIterations; ++i)
                     {
-                        break;
+                        xd = x * x - y * y + cX;
+                        yd = 2 *x * y + cY;
+                        x = xd;
+                        y = yd;
+                        if ( (x * x + y * y) > 4 )
+                        {
+                            break;
+                        }
                     }
-                }
 
-                if ( i >= cMaxIterations)
-                {
-                    *pCurrentPixel = palette[0];
-                }
-                else
-                {
-                    *pCurrentPixel = palette[ i % numColors ];
+                    if ( i >= cMaxIterations)
+                    {
+                        *pCurrentPixel = palette[0];
+                    }
+                    else
+                    {
+                        *pCurrentPixel = palette[ i % numColors ];
+                    }
                 }
             }
+
+            // Convert the image to the target format if needed.
+            if ( juliaFractal.GetPixelType() != pixelType)
+            {
+                CImageFormatConverter converter;
+                converter.OutputPixelFormat = pixelType;
+                converter.OutputBitAlignment = OutputBitAlignment_MsbAligned;
+                converter.Convert( juliaFractal, CPylonImage( juliaFractal));
+            }
+
+            // Return the image.
+            return juliaFractal;
         }
 
-        // Convert the image to the target format if needed.
-        if ( mandelbrotFractal.GetPixelType() != pixelType)
+
+        inline Pylon::CPylonImage CreateMandelbrotFractal( Pylon::EPixelType pixelType, uint32_t width, uint32_t height)
         {
-            CImageFormatConverter converter;
-            converter.OutputPixelFormat = pixelType;
-            converter.OutputBitAlignment = OutputBitAlignment_MsbAligned;
-            converter.Convert( mandelbrotFractal, CPylonImage( mandelbrotFractal));
-        }
+            // Allow all the names in the namespace Pylon to be used without qualification.
+            using namespace Pylon;
 
-        // Return the image.
-        return mandelbrotFractal;
+            // Define constants.
+            static const SRGB8Pixel palette[]=
+            {
+                {0, 28, 50}, {0, 42, 75}, {0, 56, 100}, {0, 70, 125}, {0, 84, 150},
+                {0, 50, 0}, {0, 100, 0}, {0, 150, 0}, {0, 200, 0}, {0, 250, 0},
+                {50, 0, 0}, {100, 0, 0}, {150, 0, 0}, {200, 0, 0}, {250, 0, 0}
+            };
+            uint32_t numColors = sizeof( palette) / sizeof( palette[0]);
+
+            const double  cMaxX = 1.0;
+            const double  cMinX = -2.0;
+            const double  cMaxY = 1.2;
+            const double  cMinY = -1.2;
+            const uint32_t cMaxIterations = 50;
+
+            // Create image.
+            CPylonImage mandelbrotFractal( CPylonImage::Create( PixelType_RGB8packed, width, height));
+
+            // Get the pointer to the first pixel.
+            SRGB8Pixel* pCurrentPixel = (SRGB8Pixel*) mandelbrotFractal.GetBuffer();
+
+            // Compute the fractal.
+            for ( uint32_t pixelY = 0; pixelY < height; ++pixelY )
+            {
+                for ( uint32_t pixelX = 0; pixelX < width; ++pixelX, ++pCurrentPixel )
+                {
+                    long double xStart = ((cMaxX-cMinX) / width) * pixelX + cMinX;
+                    long double yStart = cMaxY - pixelY * ((cMaxY-cMinY) / height);
+                    long double x = xStart;
+                    long double y = yStart;
+                    long double xd =0;
+                    long double yd =0;
+                    uint32_t i = 0;
+
+                    for(; i < cMaxIterations; ++i)
+                    {
+                        xd = x * x - y * y + xStart;
+                        yd = 2 *x * y + yStart;
+                        x = xd;
+                        y = yd;
+                        if ( (x * x + y * y) > 4 )
+                        {
+                            break;
+                        }
+                    }
+
+                    if ( i >= cMaxIterations)
+                    {
+                        *pCurrentPixel = palette[0];
+                    }
+                    else
+                    {
+                        *pCurrentPixel = palette[ i % numColors ];
+                    }
+                }
+            }
+
+            // Convert the image to the target format if needed.
+            if ( mandelbrotFractal.GetPixelType() != pixelType)
+            {
+                CImageFormatConverter converter;
+                converter.OutputPixelFormat = pixelType;
+                converter.OutputBitAlignment = OutputBitAlignment_MsbAligned;
+                converter.Convert( mandelbrotFractal, CPylonImage( mandelbrotFractal));
+            }
+
+            // Return the image.
+            return mandelbrotFractal;
+        }
     }
 
 }
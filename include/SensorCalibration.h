@@ -0,0 +1,400 @@
+// Contains the dark-frame and flat-field correction of frames and the cache of the calibrations on disk.
+/*
+   A calibration holds two master frames of a camera, both for one exposure time, gain, AOI and pixel type:
+       dark      the mean of frames taken with the lens covered: black level, dark current and fixed pattern
+       gain map  from the mean of frames of a uniformly lit scene minus the dark: the factor bringing each
+                 pixel to the mean of its color, i.e. of all pixels for mono and of the pixels at the same
+                 position in the 2x2 cell for Bayer frames, so the white balance is not changed
+   The correction of a frame is (raw - dark) * gain, in place or into another buffer. The gain is a 16-bit
+   fixed point value with 14 fraction bits, so the correction needs no floating point: SSE2 or, if the compiler
+   targets it, AVX2 multiply 8 or 16 pixels at once to 32 bits, take the rounded upper half and clip to the
+   maximum of the pixel type. Supported are 16-bit pixel types with up to 14 significant bits, like Mono12 or
+   BayerGB12. The corrected frames have a black level of 0.
+
+   A calibration is stored in one file: SSensorCalibrationFileHeader followed by the dark and the gain map,
+   each starting at a multiple of 64 bytes, so that the file is mapped into memory and used as is. The files
+   are named after their key, see GetSensorCalibrationName(), and kept in one directory.
+   CSensorCalibrationCache finds the calibration for a key with one hash lookup. The first lookup of a key maps
+   its file, if there is one, and the result, including a missing file, is kept for the following lookups, so
+   that a change of exposure or gain costs no disk access after its first use.
+*/
+
+#ifndef INCLUDED_SENSORCALIBRATION_H_2846093
+#define INCLUDED_SENSORCALIBRATION_H_2846093
+
+#include <pylon/PylonIncludes.h>
+#include "FrameReplayReader.h"
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#    include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Pylon
+{
+    // The parameters a calibration is valid for.
+    struct SSensorCalibrationKey
+    {
+        SSensorCalibrationKey()
+            : ExposureTime( 0.0)
+            , Gain( 0.0)
+            , OffsetX( 0)
+            , OffsetY( 0)
+            , Width( 0)
+            , Height( 0)
+            , PixelType( PixelType_Undefined)
+        {
+        }
+
+        std::string SerialNumber;
+        double ExposureTime;        // us
+        double Gain;                // dB
+        uint32_t OffsetX;
+        uint32_t OffsetY;
+        uint32_t Width;
+        uint32_t Height;
+        EPixelType PixelType;
+    };
+
+    // The serial number calibrations are stored under. Sources without one in their device info use their DeviceUserID.
+    template <typename CameraT>
+    std::string GetCalibrationSerialNumber( CameraT& camera)
+    {
+        const std::string serialNumber = camera.GetDeviceInfo().GetSerialNumber().c_str();
+        return !serialNumber.empty() ? serialNumber : std::string( camera.DeviceUserID.GetValue().c_str());
+    }
+
+    // Returns the key of the frames of a grab result taken with the exposure time and gain.
+    template <typename GrabResultPtrT>
+    SSensorCalibrationKey GetSensorCalibrationKey( const std::string& serialNumber, double exposureTime, double gain, const GrabResultPtrT& ptrGrabResult)
+    {
+        SSensorCalibrationKey key;
+        key.SerialNumber = serialNumber;
+        key.ExposureTime = exposureTime;
+        key.Gain = gain;
+        key.OffsetX = static_cast<uint32_t>(ptrGrabResult->GetOffsetX());
+        key.OffsetY = static_cast<uint32_t>(ptrGrabResult->GetOffsetY());
+        key.Width = ptrGrabResult->GetWidth();
+        key.Height = ptrGrabResult->GetHeight();
+        key.PixelType = ptrGrabResult->GetPixelType();
+        return key;
+    }
+
+    // The name of the calibration of a key, also the name of its file without extension. Exposure times are
+    // rounded to us and gains to 0.01 dB.
+    inline std::string GetSensorCalibrationName( const SSensorCalibrationKey& key)
+    {
+        char name[256];
+        sprintf( name, "%s-e%.0f-g%.2f-%ux%u+%u+%u-%08x", key.SerialNumber.c_str(), key.ExposureTime, key.Gain,
+            key.Width, key.Height, key.OffsetX, key.OffsetY, static_cast<unsigned int>(key.PixelType));
+        return name;
+    }
+
+    // Fraction bits of the gain map.
+    static const uint32_t c_sensorCalibrationGainBits = 14;
+    static const uint32_t c_sensorCalibrationVersion = 1;
+
+    struct SSensorCalibrationFileHeader
+    {
+        char Magic[8];              // "PYCALIBR"
+        uint32_t Version;
+        uint32_t HeaderSize;
+        uint32_t PixelType;         // EPixelType
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t OffsetX;
+        uint32_t OffsetY;
+        uint32_t GainBits;          // c_sensorCalibrationGainBits
+        uint32_t DarkFrameCount;
+        uint32_t FlatFrameCount;
+        double ExposureTime;        // us
+        double Gain;                // dB
+        uint64_t DarkOffset;        // From the start of the file, both multiples of c_frameContainerAlignment.
+        uint64_t GainMapOffset;
+        char SerialNumber[64];
+        uint64_t Reserved[4];
+    };
+
+    namespace SensorCalibrationDetail
+    {
+        inline void CorrectPixelsScalar( const uint16_t* pIn, const uint16_t* pDark, const uint16_t* pGain, uint32_t first, uint32_t width,
+            uint16_t maxValue, uint16_t* pOut)
+        {
+            for (uint32_t x = first; x < width; ++x)
+            {
+                const uint32_t value = std::min( pIn[x], maxValue);
+                const uint32_t signal = value > pDark[x] ? value - pDark[x] : 0;
+                pOut[x] = static_cast<uint16_t>(std::min<uint32_t>( (signal * pGain[x] + (1u << (c_sensorCalibrationGainBits - 1))) >> c_sensorCalibrationGainBits, maxValue));
+            }
+        }
+
+        // (in - dark) * gain, rounded and clipped. The signal is shifted to 16 bits so that the upper half of the product is the result.
+        inline void CorrectRow( const uint16_t* pIn, const uint16_t* pDark, const uint16_t* pGain, uint32_t width, uint16_t maxValue, uint16_t* pOut)
+        {
+            uint32_t x = 0;
+            const int shift = 16 - c_sensorCalibrationGainBits;
+#if defined(__AVX2__)
+            const __m256i maxValues = _mm256_set1_epi16( static_cast<short>(maxValue));
+            for (; x + 16 <= width; x += 16)
+            {
+                const __m256i value = _mm256_min_epu16( _mm256_loadu_si256( reinterpret_cast<const __m256i*>(pIn + x)), maxValues);
+                const __m256i signal = _mm256_slli_epi16( _mm256_subs_epu16( value, _mm256_loadu_si256( reinterpret_cast<const __m256i*>(pDark + x))), shift);
+                const __m256i gain = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(pGain + x));
+                const __m256i rounded = _mm256_add_epi16( _mm256_mulhi_epu16( signal, gain), _mm256_srli_epi16( _mm256_mullo_epi16( signal, gain), 15));
+                _mm256_storeu_si256( reinterpret_cast<__m256i*>(pOut + x), _mm256_min_epu16( rounded, maxValues));
+            }
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+            // SSE2 has no unsigned 16-bit minimum, min( a, b) is a - max( a - b, 0).
+            const __m128i maxValues = _mm_set1_epi16( static_cast<short>(maxValue));
+            for (; x + 8 <= width; x += 8)
+            {
+                __m128i value = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pIn + x));
+                value = _mm_sub_epi16( value, _mm_subs_epu16( value, maxValues));
+                const __m128i signal = _mm_slli_epi16( _mm_subs_epu16( value, _mm_loadu_si128( reinterpret_cast<const __m128i*>(pDark + x))), shift);
+                const __m128i gain = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pGain + x));
+                const __m128i rounded = _mm_add_epi16( _mm_mulhi_epu16( signal, gain), _mm_srli_epi16( _mm_mullo_epi16( signal, gain), 15));
+                _mm_storeu_si128( reinterpret_cast<__m128i*>(pOut + x), _mm_sub_epi16( rounded, _mm_subs_epu16( rounded, maxValues)));
+            }
+#endif
+            CorrectPixelsScalar( pIn, pDark, pGain, x, width, maxValue, pOut);
+        }
+    }
+
+    // A calibration mapped from its file.
+    class CSensorCalibration
+    {
+    public:
+        // Same formats as the fixed point correction allows: 16 bits per pixel, up to 14 of them significant.
+        static bool IsSupported( EPixelType pixelType)
+        {
+            return BitPerPixel( pixelType) == 16 && !IsPacked( pixelType) && BitDepth( pixelType) <= 14;
+        }
+
+        explicit CSensorCalibration( const std::string& fileName)
+        {
+            m_file.Open( fileName);
+            if (m_file.GetSize() < sizeof( SSensorCalibrationFileHeader))
+            {
+                throw RUNTIME_EXCEPTION( "The calibration %s is truncated.", fileName.c_str());
+            }
+            memcpy( &m_header, m_file.GetData(), sizeof( m_header));
+            const uint64_t planeSize = static_cast<uint64_t>(m_header.Width) * m_header.Height * sizeof( uint16_t);
+            if (memcmp( m_header.Magic, "PYCALIBR", sizeof( m_header.Magic)) != 0 || m_header.Version != c_sensorCalibrationVersion
+                || m_header.GainBits != c_sensorCalibrationGainBits || !IsSupported( static_cast<EPixelType>(m_header.PixelType))
+                || m_header.DarkOffset % c_frameContainerAlignment != 0 || m_header.GainMapOffset % c_frameContainerAlignment != 0
+                || m_header.DarkOffset + planeSize > m_file.GetSize() || m_header.GainMapOffset + planeSize > m_file.GetSize())
+            {
+                throw RUNTIME_EXCEPTION( "%s is not a valid calibration.", fileName.c_str());
+            }
+        }
+
+        const SSensorCalibrationFileHeader& GetHeader() const
+        {
+            return m_header;
+        }
+
+        const uint16_t* GetDark() const
+        {
+            return reinterpret_cast<const uint16_t*>(m_file.GetData() + m_header.DarkOffset);
+        }
+
+        // Gains with c_sensorCalibrationGainBits fraction bits.
+        const uint16_t* GetGainMap() const
+        {
+            return reinterpret_cast<const uint16_t*>(m_file.GetData() + m_header.GainMapOffset);
+        }
+
+        // Corrects a frame of the size and pixel type of the calibration. pIn and pOut may be the same buffer.
+        void Correct( const void* pIn, size_t inPaddingX, void* pOut, size_t outPaddingX) const
+        {
+            const uint16_t maxValue = static_cast<uint16_t>((1u << BitDepth( static_cast<EPixelType>(m_header.PixelType))) - 1);
+            const size_t inRowSize = m_header.Width * sizeof( uint16_t) + inPaddingX;
+            const size_t outRowSize = m_header.Width * sizeof( uint16_t) + outPaddingX;
+            for (uint32_t y = 0; y < m_header.Height; ++y)
+            {
+                const size_t rowStart = static_cast<size_t>(y) * m_header.Width;
+                SensorCalibrationDetail::CorrectRow( reinterpret_cast<const uint16_t*>(static_cast<const uint8_t*>(pIn) + y * inRowSize),
+                    GetDark() + rowStart, GetGainMap() + rowStart, m_header.Width, maxValue,
+                    reinterpret_cast<uint16_t*>(static_cast<uint8_t*>(pOut) + y * outRowSize));
+            }
+        }
+
+        // Corrects the buffer of a grab result in place. Returns false if the frame does not match the calibration.
+        template <typename GrabResultPtrT>
+        bool Correct( const GrabResultPtrT& ptrGrabResult) const
+        {
+            if (!ptrGrabResult->GrabSucceeded() || ptrGrabResult->GetPixelType() != static_cast<EPixelType>(m_header.PixelType)
+                || ptrGrabResult->GetWidth() != m_header.Width || ptrGrabResult->GetHeight() != m_header.Height)
+            {
+                return false;
+            }
+            Correct( ptrGrabResult->GetBuffer(), ptrGrabResult->GetPaddingX(), ptrGrabResult->GetBuffer(), ptrGrabResult->GetPaddingX());
+            return true;
+        }
+
+    private:
+        CSensorCalibration( const CSensorCalibration&);
+        CSensorCalibration& operator=( const CSensorCalibration&);
+
+        CMappedFile m_file;
+        SSensorCalibrationFileHeader m_header;
+    };
+
+    // Computes the gain map of the masters, both unpadded frames of the key, and writes the calibration file.
+    inline void WriteSensorCalibration( const std::string& fileName, const SSensorCalibrationKey& key, const uint16_t* pDark, const uint16_t* pFlat,
+        uint32_t darkFrameCount, uint32_t flatFrameCount)
+    {
+        if (!CSensorCalibration::IsSupported( key.PixelType))
+        {
+            throw RUNTIME_EXCEPTION( "The calibration does not support the pixel type 0x%08x.", static_cast<unsigned int>(key.PixelType));
+        }
+        const size_t pixelCount = static_cast<size_t>(key.Width) * key.Height;
+
+        // The mean of the flat of each color, the positions in the 2x2 cell for Bayer frames.
+        const bool isBayer = IsBayer( key.PixelType);
+        double sums[4] = { 0.0, 0.0, 0.0, 0.0 };
+        double counts[4] = { 0.0, 0.0, 0.0, 0.0 };
+        for (uint32_t y = 0; y < key.Height; ++y)
+        {
+            for (uint32_t x = 0; x < key.Width; ++x)
+            {
+                const size_t i = static_cast<size_t>(y) * key.Width + x;
+                const size_t color = isBayer ? ((y & 1) << 1) | (x & 1) : 0;
+                sums[color] += std::max( static_cast<int>(pFlat[i]) - static_cast<int>(pDark[i]), 0);
+                counts[color] += 1.0;
+            }
+        }
+
+        // Pixels without signal in the flat keep their value.
+        const double maxGain = 65535.0 / (1u << c_sensorCalibrationGainBits);
+        std::vector<uint16_t> gainMap( pixelCount);
+        for (uint32_t y = 0; y < key.Height; ++y)
+        {
+            for (uint32_t x = 0; x < key.Width; ++x)
+            {
+                const size_t i = static_cast<size_t>(y) * key.Width + x;
+                const size_t color = isBayer ? ((y & 1) << 1) | (x & 1) : 0;
+                const int signal = static_cast<int>(pFlat[i]) - static_cast<int>(pDark[i]);
+                const double gain = signal > 0 ? std::min( sums[color] / counts[color] / signal, maxGain) : 1.0;
+                gainMap[i] = static_cast<uint16_t>(gain * (1u << c_sensorCalibrationGainBits) + 0.5);
+            }
+        }
+
+        SSensorCalibrationFileHeader header;
+        memset( &header, 0, sizeof( header));
+        memcpy( header.Magic, "PYCALIBR", sizeof( header.Magic));
+        header.Version = c_sensorCalibrationVersion;
+        header.HeaderSize = sizeof( header);
+        header.PixelType = static_cast<uint32_t>(key.PixelType);
+        header.Width = key.Width;
+        header.Height = key.Height;
+        header.OffsetX = key.OffsetX;
+        header.OffsetY = key.OffsetY;
+        header.GainBits = c_sensorCalibrationGainBits;
+        header.DarkFrameCount = darkFrameCount;
+        header.FlatFrameCount = flatFrameCount;
+        header.ExposureTime = key.ExposureTime;
+        header.Gain = key.Gain;
+        header.DarkOffset = GetFrameContainerPaddedSize( sizeof( header));
+        header.GainMapOffset = header.DarkOffset + GetFrameContainerPaddedSize( pixelCount * sizeof( uint16_t));
+        strncpy( header.SerialNumber, key.SerialNumber.c_str(), sizeof( header.SerialNumber) - 1);
+
+        FILE* pFile = fopen( fileName.c_str(), "wb");
+        if (pFile == NULL)
+        {
+            throw RUNTIME_EXCEPTION( "Could not create the calibration %s.", fileName.c_str());
+        }
+        static const uint8_t padding[c_frameContainerAlignment] = { 0 };
+        const size_t planePadding = static_cast<size_t>(GetFrameContainerPaddedSize( pixelCount * sizeof( uint16_t)) - pixelCount * sizeof( uint16_t));
+        bool isWritten = fwrite( &header, sizeof( header), 1, pFile) == 1
+            && fwrite( padding, 1, static_cast<size_t>(header.DarkOffset - sizeof( header)), pFile) == header.DarkOffset - sizeof( header)
+            && fwrite( pDark, sizeof( uint16_t), pixelCount, pFile) == pixelCount
+            && fwrite( padding, 1, planePadding, pFile) == planePadding
+            && fwrite( &gainMap[0], sizeof( uint16_t), pixelCount, pFile) == pixelCount;
+        isWritten = fclose( pFile) == 0 && isWritten;
+        if (!isWritten)
+        {
+            throw RUNTIME_EXCEPTION( "Could not write the calibration %s.", fileName.c_str());
+        }
+    }
+
+    // The calibrations of a directory by key. Thread safe.
+    class CSensorCalibrationCache
+    {
+    public:
+        explicit CSensorCalibrationCache( const std::string& directory = ".")
+            : m_directory( directory)
+        {
+        }
+
+        std::string GetFileName( const SSensorCalibrationKey& key) const
+        {
+            return m_directory + "/" + GetSensorCalibrationName( key) + ".cal";
+        }
+
+        // Returns the calibration of the key, or an empty pointer if there is none.
+        std::shared_ptr<const CSensorCalibration> Find( const SSensorCalibrationKey& key)
+        {
+            const std::string name = GetSensorCalibrationName( key);
+            std::lock_guard<std::mutex> lock( m_lock);
+            std::unordered_map< std::string, std::shared_ptr<const CSensorCalibration> >::const_iterator it = m_calibrations.find( name);
+            if (it != m_calibrations.end())
+            {
+                return it->second;
+            }
+
+            std::shared_ptr<const CSensorCalibration> ptrCalibration;
+            const std::string fileName = GetFileName( key);
+            FILE* pFile = fopen( fileName.c_str(), "rb");
+            if (pFile != NULL)
+            {
+                fclose( pFile);
+                ptrCalibration = std::make_shared<const CSensorCalibration>( fileName);
+            }
+            m_calibrations[name] = ptrCalibration;
+            return ptrCalibration;
+        }
+
+        // Writes the calibration of the masters and returns it. Frames still corrected with a previous calibration
+        // of the key keep its mapping, on Windows this fails as long as they do.
+        std::shared_ptr<const CSensorCalibration> Store( const SSensorCalibrationKey& key, const uint16_t* pDark, const uint16_t* pFlat,
+            uint32_t darkFrameCount, uint32_t flatFrameCount)
+        {
+            const std::string name = GetSensorCalibrationName( key);
+            const std::string fileName = GetFileName( key);
+            std::lock_guard<std::mutex> lock( m_lock);
+            m_calibrations.erase( name);
+            WriteSensorCalibration( fileName, key, pDark, pFlat, darkFrameCount, flatFrameCount);
+            std::shared_ptr<const CSensorCalibration> ptrCalibration = std::make_shared<const CSensorCalibration>( fileName);
+            m_calibrations[name] = ptrCalibration;
+            return ptrCalibration;
+        }
+
+        // Keys looked up or stored so far, including those without a calibration.
+        size_t GetSize() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_calibrations.size();
+        }
+
+    private:
+        CSensorCalibrationCache( const CSensorCalibrationCache&);
+        CSensorCalibrationCache& operator=( const CSensorCalibrationCache&);
+
+        const std::string m_directory;
+        mutable std::mutex m_lock;
+        std::unordered_map< std::string, std::shared_ptr<const CSensorCalibration> > m_calibrations;
+    };
+}
+
+#endif /* INCLUDED_SENSORCALIBRATION_H_2846093 */
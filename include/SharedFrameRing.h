@@ -0,0 +1,612 @@
+// Contains a ring of frames in shared memory published by one process and read by others on the same host.
+/*
+   Processes analyzing the frames of a capture process got them from the files it stored, a round trip
+   through the disk per frame. CSharedFrameRingWriter creates a named shared memory, shm_open() and
+   mmap() or a named file mapping on Windows, holding a ring of slots of a fixed capacity. Publish()
+   copies a frame with its geometry, pixel type, block ID and time stamp into the next slot; readers
+   in other processes map the same memory and use the frames in place, without copying them:
+
+       capture process                              analysis process
+       CSharedFrameRingWriter ring;                 CSharedFrameRingReader ring( "camera0");
+       ring.Create( "camera0", 8, payloadSize);     CSharedFrame frame;
+       ...                                          while (ring.Acquire( frame, 1000))
+       ring.Publish( ptrGrabResult);                {
+                                                        ... frame.GetView() ...
+                                                        if (!ring.Release( frame)) ... overwritten, discard ...
+                                                    }
+
+   The writer never waits for the readers. Each slot has a sequence number, odd while the writer fills
+   it and even when the frame is complete. A reader takes a frame when the number is the even one of
+   that frame and checks in Release() that it did not change while the frame was used. A reader falling
+   more than the slot count behind skips to the oldest frame still in the ring. Frames lost that way,
+   or overwritten while in use, are counted by GetOverrunCount(), so a slow reader sees what it missed
+   instead of slowing the capture. A reader gets the frames published after it opened the ring.
+
+   The time a frame was published is GetHostTimeNs() of FrameTimeSeries.h, the steady clock is the same
+   for the processes of a host, so readers can measure the latency of the hand-off. Acquire() polls: it
+   spins and yields for 50 us after it started waiting, then sleeps 100 us between the checks. A frame
+   published while a reader sleeps is taken up to 100 us plus the wake-up of the thread later, on Windows
+   a sleep lasts at least the timer resolution, 1 ms with timeBeginPeriod( 1) and 15.6 ms by default.
+*/
+
+#ifndef INCLUDED_SHAREDFRAMERING_H_9152738
+#define INCLUDED_SHAREDFRAMERING_H_9152738
+
+#include <pylon/PylonIncludes.h>
+#include "FrameTimeSeries.h"
+#include "FrameView.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32)
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace Pylon
+{
+    struct SSharedFrameRingHeader
+    {
+        char Magic[8];              // "PYRING\0\0"
+        uint32_t Version;
+        uint32_t HeaderSize;
+        uint32_t SlotCount;
+        uint32_t Reserved0;
+        uint64_t SlotSize;          // Bytes per slot, the SSharedFrameSlot and the frame.
+        uint64_t FrameCapacity;     // The largest frame in bytes.
+        std::atomic<uint64_t> PublishedCount;
+        std::atomic<uint32_t> ReaderCount;
+        std::atomic<uint32_t> IsClosed;
+        uint64_t Reserved[2];
+    };
+
+    // The header of a slot, followed by the frame. 64 bytes, so that the frames start on a cache line.
+    struct SSharedFrameSlot
+    {
+        std::atomic<uint64_t> Sequence;     // 2 * frame + 1 while written, 2 * frame + 2 when complete.
+        uint64_t FrameNumber;
+        int64_t PublishTime;
+        int64_t Timestamp;
+        uint64_t BlockID;
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t PixelType;
+        uint32_t PaddingX;
+        uint64_t Size;
+    };
+
+    static const uint32_t c_sharedFrameRingVersion = 1;
+
+    namespace SharedFrameRingDetail
+    {
+        // A named shared memory, removed by the process that created it when it is closed.
+        class CSharedMemory
+        {
+        public:
+            CSharedMemory()
+                : m_pData( NULL)
+                , m_size( 0)
+                , m_isCreated( false)
+#if defined(_WIN32)
+                , m_hMapping( NULL)
+#endif
+            {
+            }
+
+            ~CSharedMemory()
+            {
+                Close();
+            }
+
+            void Create( const std::string& name, size_t size)
+            {
+                Close();
+                m_name = name;
+#if defined(_WIN32)
+                m_hMapping = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+                    static_cast<DWORD>(size), ("Local\\" + name).c_str());
+                m_pData = m_hMapping != NULL ? static_cast<uint8_t*>(MapViewOfFile( m_hMapping, FILE_MAP_ALL_ACCESS, 0, 0, size)) : NULL;
+#else
+                // A ring left by a process that ended without closing it is replaced, its readers keep the old memory.
+                shm_unlink( ("/" + name).c_str());
+                const int file = shm_open( ("/" + name).c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+                if (file >= 0 && ftruncate( file, static_cast<off_t>(size)) == 0)
+                {
+                    void* pData = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+                    m_pData = pData != MAP_FAILED ? static_cast<uint8_t*>(pData) : NULL;
+                }
+                if (file >= 0)
+                {
+                    close( file);
+                }
+#endif
+                m_size = size;
+                m_isCreated = true;
+                if (m_pData == NULL)
+                {
+                    Close();
+                    throw RUNTIME_EXCEPTION( "Could not create the shared memory %s of %u MB.", name.c_str(), static_cast<unsigned int>(size >> 20));
+                }
+            }
+
+            // Returns false if there is no shared memory of that name.
+            bool Open( const std::string& name)
+            {
+                Close();
+                m_name = name;
+#if defined(_WIN32)
+                m_hMapping = OpenFileMappingA( FILE_MAP_ALL_ACCESS, FALSE, ("Local\\" + name).c_str());
+                m_pData = m_hMapping != NULL ? static_cast<uint8_t*>(MapViewOfFile( m_hMapping, FILE_MAP_ALL_ACCESS, 0, 0, 0)) : NULL;
+                MEMORY_BASIC_INFORMATION info;
+                m_size = m_pData != NULL && VirtualQuery( m_pData, &info, sizeof( info)) != 0 ? info.RegionSize : 0;
+#else
+                const int file = shm_open( ("/" + name).c_str(), O_RDWR, 0600);
+                struct stat info;
+                if (file >= 0 && fstat( file, &info) == 0 && info.st_size != 0)
+                {
+                    m_size = static_cast<size_t>(info.st_size);
+                    void* pData = mmap( NULL, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+                    m_pData = pData != MAP_FAILED ? static_cast<uint8_t*>(pData) : NULL;
+                }
+                if (file >= 0)
+                {
+                    close( file);
+                }
+#endif
+                if (m_pData == NULL)
+                {
+                    Close();
+                    return false;
+                }
+                return true;
+            }
+
+            void Close()
+            {
+#if defined(_WIN32)
+                if (m_pData != NULL)
+                {
+                    UnmapViewOfFile( m_pData);
+                }
+                if (m_hMapping != NULL)
+                {
+                    CloseHandle( m_hMapping);
+                }
+                m_hMapping = NULL;
+#else
+                if (m_pData != NULL)
+                {
+                    munmap( m_pData, m_size);
+                }
+                // The memory stays mapped by the readers until they close it.
+                if (m_isCreated)
+                {
+                    shm_unlink( ("/" + m_name).c_str());
+                }
+#endif
+                m_pData = NULL;
+                m_size = 0;
+                m_isCreated = false;
+            }
+
+            uint8_t* GetData() const
+            {
+                return m_pData;
+            }
+
+            size_t GetSize() const
+            {
+                return m_size;
+            }
+
+        private:
+            CSharedMemory( const CSharedMemory&);
+            CSharedMemory& operator=( const CSharedMemory&);
+
+            std::string m_name;
+            uint8_t* m_pData;
+            size_t m_size;
+            bool m_isCreated;
+#if defined(_WIN32)
+            HANDLE m_hMapping;
+#endif
+        };
+    }
+
+    // A frame of the ring acquired by a reader. The pixels are in the shared memory, valid until the writer
+    // reuses the slot, which Release() tells.
+    class CSharedFrame
+    {
+    public:
+        CSharedFrame()
+            : m_pSlot( NULL)
+            , m_sequence( 0)
+            , m_frameNumber( 0)
+            , m_publishTime( 0)
+            , m_timestamp( 0)
+            , m_blockID( 0)
+            , m_pixelType( PixelType_Undefined)
+            , m_width( 0)
+            , m_height( 0)
+            , m_paddingX( 0)
+            , m_size( 0)
+        {
+        }
+
+        const void* GetBuffer() const
+        {
+            return m_pSlot + 1;
+        }
+
+        // A view of the pixels in the shared memory. Not for packed pixel types.
+        CFrameView GetView() const
+        {
+            return CFrameView( GetBuffer(), m_pixelType, m_width, m_height, static_cast<size_t>(m_width) * (BitPerPixel( m_pixelType) / 8) + m_paddingX);
+        }
+
+        size_t GetSize() const { return static_cast<size_t>(m_size); }
+        uint64_t GetFrameNumber() const { return m_frameNumber; }
+        int64_t GetPublishTime() const { return m_publishTime; }
+        int64_t GetTimestamp() const { return m_timestamp; }
+        uint64_t GetBlockID() const { return m_blockID; }
+        EPixelType GetPixelType() const { return m_pixelType; }
+        uint32_t GetWidth() const { return m_width; }
+        uint32_t GetHeight() const { return m_height; }
+        uint32_t GetPaddingX() const { return m_paddingX; }
+
+    private:
+        friend class CSharedFrameRingReader;
+
+        const SSharedFrameSlot* m_pSlot;
+        uint64_t m_sequence;
+        uint64_t m_frameNumber;
+        int64_t m_publishTime;
+        int64_t m_timestamp;
+        uint64_t m_blockID;
+        EPixelType m_pixelType;
+        uint32_t m_width;
+        uint32_t m_height;
+        uint32_t m_paddingX;
+        uint64_t m_size;
+    };
+
+    // Publishes frames to a ring in shared memory. Publish() is called by one thread at a time.
+    class CSharedFrameRingWriter
+    {
+    public:
+        CSharedFrameRingWriter()
+            : m_pHeader( NULL)
+            , m_rejectedCount( 0)
+        {
+        }
+
+        ~CSharedFrameRingWriter()
+        {
+            Close();
+        }
+
+        // Creates the ring of slotCount slots for frames of up to frameCapacity bytes.
+        void Create( const std::string& name, uint32_t slotCount, size_t frameCapacity)
+        {
+            Close();
+            if (slotCount == 0)
+            {
+                throw RUNTIME_EXCEPTION( "A frame ring needs at least one slot.");
+            }
+            const size_t slotSize = (sizeof( SSharedFrameSlot) + frameCapacity + 63) & ~static_cast<size_t>(63);
+            const size_t headerSize = (sizeof( SSharedFrameRingHeader) + 63) & ~static_cast<size_t>(63);
+            m_memory.Create( name, headerSize + slotSize * slotCount);
+            m_rejectedCount = 0;
+
+            m_pHeader = new (m_memory.GetData()) SSharedFrameRingHeader;
+            memcpy( m_pHeader->Magic, "PYRING", 7);
+            m_pHeader->Version = c_sharedFrameRingVersion;
+            m_pHeader->HeaderSize = static_cast<uint32_t>(headerSize);
+            m_pHeader->SlotCount = slotCount;
+            m_pHeader->SlotSize = slotSize;
+            m_pHeader->FrameCapacity = frameCapacity;
+            m_pHeader->ReaderCount.store( 0);
+            m_pHeader->IsClosed.store( 0);
+            for (uint32_t s = 0; s < slotCount; ++s)
+            {
+                new (GetSlot( s)) SSharedFrameSlot;
+                GetSlot( s)->Sequence.store( 0);
+            }
+            // Last, readers opening the ring meanwhile find no frames before the slots are set up.
+            m_pHeader->PublishedCount.store( 0, std::memory_order_release);
+        }
+
+        bool IsOpen() const
+        {
+            return m_pHeader != NULL;
+        }
+
+        // Copies a frame into the next slot. Returns false for frames larger than the capacity of the slots.
+        bool Publish( const void* pBuffer, size_t size, EPixelType pixelType, uint32_t width, uint32_t height, uint32_t paddingX,
+            uint64_t blockID = 0, int64_t timestamp = 0)
+        {
+            if (size > m_pHeader->FrameCapacity)
+            {
+                ++m_rejectedCount;
+                return false;
+            }
+            const uint64_t frameNumber = m_pHeader->PublishedCount.load( std::memory_order_relaxed);
+            SSharedFrameSlot* pSlot = GetSlot( static_cast<uint32_t>(frameNumber % m_pHeader->SlotCount));
+            pSlot->Sequence.store( 2 * frameNumber + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence( std::memory_order_release);
+
+            pSlot->FrameNumber = frameNumber;
+            pSlot->Timestamp = timestamp;
+            pSlot->BlockID = blockID;
+            pSlot->Width = width;
+            pSlot->Height = height;
+            pSlot->PixelType = static_cast<uint32_t>(pixelType);
+            pSlot->PaddingX = paddingX;
+            pSlot->Size = size;
+            memcpy( reinterpret_cast<uint8_t*>(pSlot) + sizeof( SSharedFrameSlot), pBuffer, size);
+            pSlot->PublishTime = GetHostTimeNs();
+
+            pSlot->Sequence.store( 2 * frameNumber + 2, std::memory_order_release);
+            m_pHeader->PublishedCount.store( frameNumber + 1, std::memory_order_release);
+            return true;
+        }
+
+        template <typename GrabResultPtrT>
+        bool Publish( const GrabResultPtrT& ptrGrabResult, int64_t timestamp = 0)
+        {
+            return Publish( ptrGrabResult->GetBuffer(), ptrGrabResult->GetImageSize(), ptrGrabResult->GetPixelType(), ptrGrabResult->GetWidth(),
+                ptrGrabResult->GetHeight(), static_cast<uint32_t>(ptrGrabResult->GetPaddingX()), ptrGrabResult->GetBlockID(), timestamp);
+        }
+
+        // Tells the readers that no more frames follow and removes the name of the ring.
+        void Close()
+        {
+            if (m_pHeader == NULL)
+            {
+                return;
+            }
+            m_pHeader->IsClosed.store( 1, std::memory_order_release);
+            m_pHeader = NULL;
+            m_memory.Close();
+        }
+
+        uint64_t GetPublishedCount() const
+        {
+            return m_pHeader->PublishedCount.load( std::memory_order_relaxed);
+        }
+
+        uint32_t GetReaderCount() const
+        {
+            return m_pHeader->ReaderCount.load( std::memory_order_relaxed);
+        }
+
+        uint64_t GetRejectedCount() const
+        {
+            return m_rejectedCount;
+        }
+
+    private:
+        CSharedFrameRingWriter( const CSharedFrameRingWriter&);
+        CSharedFrameRingWriter& operator=( const CSharedFrameRingWriter&);
+
+        SSharedFrameSlot* GetSlot( uint32_t slot) const
+        {
+            return reinterpret_cast<SSharedFrameSlot*>(m_memory.GetData() + m_pHeader->HeaderSize + slot * m_pHeader->SlotSize);
+        }
+
+        SharedFrameRingDetail::CSharedMemory m_memory;
+        SSharedFrameRingHeader* m_pHeader;
+        uint64_t m_rejectedCount;
+    };
+
+    // Reads the frames of a ring published by another process.
+    class CSharedFrameRingReader
+    {
+    public:
+        CSharedFrameRingReader()
+            : m_pHeader( NULL)
+            , m_nextFrame( 0)
+            , m_overrunCount( 0)
+        {
+        }
+
+        explicit CSharedFrameRingReader( const std::string& name)
+            : m_pHeader( NULL)
+            , m_nextFrame( 0)
+            , m_overrunCount( 0)
+        {
+            if (!Open( name))
+            {
+                throw RUNTIME_EXCEPTION( "There is no frame ring %s.", name.c_str());
+            }
+        }
+
+        ~CSharedFrameRingReader()
+        {
+            Close();
+        }
+
+        // Returns false if there is no ring of that name.
+        bool Open( const std::string& name)
+        {
+            Close();
+            if (!m_memory.Open( name))
+            {
+                return false;
+            }
+            SSharedFrameRingHeader* pHeader = reinterpret_cast<SSharedFrameRingHeader*>(m_memory.GetData());
+            if (m_memory.GetSize() < sizeof( SSharedFrameRingHeader) || memcmp( pHeader->Magic, "PYRING", 7) != 0
+                || pHeader->Version != c_sharedFrameRingVersion)
+            {
+                m_memory.Close();
+                throw RUNTIME_EXCEPTION( "The shared memory %s is no frame ring of this version.", name.c_str());
+            }
+            // The slots must lie within the memory, the division avoids the overflow of SlotCount * SlotSize.
+            const uint64_t size = m_memory.GetSize();
+            if (pHeader->HeaderSize < sizeof( SSharedFrameRingHeader) || pHeader->HeaderSize > size || pHeader->SlotCount == 0
+                || pHeader->FrameCapacity > pHeader->SlotSize || pHeader->SlotSize < sizeof( SSharedFrameSlot) + pHeader->FrameCapacity
+                || pHeader->SlotCount > (size - pHeader->HeaderSize) / pHeader->SlotSize)
+            {
+                const unsigned int slotCount = pHeader->SlotCount;
+                m_memory.Close();
+                throw RUNTIME_EXCEPTION( "The frame ring %s claims %u slots that do not fit into its %u MB.", name.c_str(), slotCount,
+                    static_cast<unsigned int>(size >> 20));
+            }
+            m_pHeader = pHeader;
+            m_pHeader->ReaderCount.fetch_add( 1);
+            m_nextFrame = m_pHeader->PublishedCount.load( std::memory_order_acquire);
+            m_overrunCount = 0;
+            return true;
+        }
+
+        void Close()
+        {
+            if (m_pHeader == NULL)
+            {
+                return;
+            }
+            m_pHeader->ReaderCount.fetch_sub( 1);
+            m_pHeader = NULL;
+            m_memory.Close();
+        }
+
+        // Takes the next frame if it has been published.
+        bool TryAcquire( CSharedFrame& frame)
+        {
+            for (;;)
+            {
+                const uint64_t publishedCount = m_pHeader->PublishedCount.load( std::memory_order_acquire);
+                if (m_nextFrame >= publishedCount)
+                {
+                    return false;
+                }
+                // The frames before the oldest one in the ring are lost.
+                if (publishedCount - m_nextFrame > m_pHeader->SlotCount)
+                {
+                    m_overrunCount += publishedCount - m_pHeader->SlotCount - m_nextFrame;
+                    m_nextFrame = publishedCount - m_pHeader->SlotCount;
+                }
+
+                const SSharedFrameSlot* pSlot = GetSlot( static_cast<uint32_t>(m_nextFrame % m_pHeader->SlotCount));
+                const uint64_t sequence = 2 * m_nextFrame + 2;
+                if (pSlot->Sequence.load( std::memory_order_acquire) == sequence)
+                {
+                    frame.m_pSlot = pSlot;
+                    frame.m_sequence = sequence;
+                    frame.m_frameNumber = pSlot->FrameNumber;
+                    frame.m_publishTime = pSlot->PublishTime;
+                    frame.m_timestamp = pSlot->Timestamp;
+                    frame.m_blockID = pSlot->BlockID;
+                    frame.m_pixelType = static_cast<EPixelType>(pSlot->PixelType);
+                    frame.m_width = pSlot->Width;
+                    frame.m_height = pSlot->Height;
+                    frame.m_paddingX = pSlot->PaddingX;
+                    frame.m_size = std::min( pSlot->Size, m_pHeader->FrameCapacity);
+                    if (IsUnchanged( frame))
+                    {
+                        ++m_nextFrame;
+                        return true;
+                    }
+                }
+                // Overwritten by a later frame.
+                ++m_overrunCount;
+                ++m_nextFrame;
+            }
+        }
+
+        // Waits up to timeoutMs for the next frame. Returns false on timeout or when the writer closed the ring.
+        // The reader spins for frames following closely, yields for c_acquireYieldNs and then sleeps c_acquireSleepUs
+        // between the checks, so a reader waiting for the next frame of a camera does not keep a core busy.
+        bool Acquire( CSharedFrame& frame, unsigned int timeoutMs)
+        {
+            const int64_t start = GetHostTimeNs();
+            const int64_t end = start + static_cast<int64_t>(timeoutMs) * 1000000;
+            for (unsigned int spin = 0; ; ++spin)
+            {
+                if (TryAcquire( frame))
+                {
+                    return true;
+                }
+                const int64_t now = GetHostTimeNs();
+                if (IsClosed() || now > end)
+                {
+                    return false;
+                }
+                if (now - start >= c_acquireYieldNs)
+                {
+                    std::this_thread::sleep_for( std::chrono::microseconds( c_acquireSleepUs));
+                }
+                else if (spin >= c_acquireSpinCount)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        // Returns true if the frame was not overwritten while it was used. Frames that were are counted as overruns.
+        bool Release( const CSharedFrame& frame)
+        {
+            if (IsUnchanged( frame))
+            {
+                return true;
+            }
+            ++m_overrunCount;
+            return false;
+        }
+
+        bool IsClosed() const
+        {
+            return m_pHeader->IsClosed.load( std::memory_order_acquire) != 0;
+        }
+
+        // The frames published and not read, skipped or overwritten while used.
+        uint64_t GetOverrunCount() const
+        {
+            return m_overrunCount;
+        }
+
+        uint64_t GetPublishedCount() const
+        {
+            return m_pHeader->PublishedCount.load( std::memory_order_acquire);
+        }
+
+    private:
+        CSharedFrameRingReader( const CSharedFrameRingReader&);
+        CSharedFrameRingReader& operator=( const CSharedFrameRingReader&);
+
+        const SSharedFrameSlot* GetSlot( uint32_t slot) const
+        {
+            return reinterpret_cast<const SSharedFrameSlot*>(m_memory.GetData() + m_pHeader->HeaderSize + slot * m_pHeader->SlotSize);
+        }
+
+        static bool IsUnchanged( const CSharedFrame& frame)
+        {
+            std::atomic_thread_fence( std::memory_order_acquire);
+            return frame.m_pSlot->Sequence.load( std::memory_order_relaxed) == frame.m_sequence;
+        }
+
+        // The checks Acquire() spins, the time it yields and then sleeps between the checks.
+        static const unsigned int c_acquireSpinCount = 1000;
+        static const int64_t c_acquireYieldNs = 50000;
+        static const unsigned int c_acquireSleepUs = 100;
+
+        SharedFrameRingDetail::CSharedMemory m_memory;
+        SSharedFrameRingHeader* m_pHeader;
+        uint64_t m_nextFrame;
+        uint64_t m_overrunCount;
+    };
+}
+
+#endif /* INCLUDED_SHAREDFRAMERING_H_9152738 */
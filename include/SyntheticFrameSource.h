@@ -0,0 +1,1483 @@
+// Contains a synthetic frame source that stands in for a Basler USB camera.
+/*
+   The synthetic frame source delivers frames with the timing of a free-running or software-triggered
+   camera without requiring any hardware. The frame content is taken from the fractal pattern engine in
+   SampleImageCreator.h or from a recorded .raw file as written by the samples.
+
+   The source provides the part of the instant camera interface the samples use: StartGrabbing,
+   RetrieveResult, a grab loop thread calling image event handlers, software triggering and the
+   parameters Gain, ExposureTime, PixelFormat and MaxNumBuffer. The grab results provide the accessors of
+   the pylon grab results, including a chunk-style time stamp in nanoseconds.
+
+   TriggerMode can be switched while grabbing. The next frame after switching it on waits for a trigger,
+   switching it off restarts free-running from the end of the current frame. A triggered frame is exposed
+   for ExposureTime and then read out in one frame period. Like a camera with overlapping exposure, the
+   source accepts the next trigger when the readout starts, and ExposureTime and Gain written before a
+   trigger apply to its frame, as the ExposureTime and Gain chunks show. Free-running frames follow the
+   frame period. TimestampLatch latches the
+   clock of the time stamps to TimestampLatchValue. The time StartGrabbing, StopGrabbing and parameter
+   writes take on a camera can be emulated with the latency settings, they are 0 by default.
+
+   With TriggerSelector set to FrameBurstStart when TriggerMode is switched on, one trigger starts
+   AcquisitionBurstFrameCount frames back to back. Unlike a camera the source has one trigger mode for
+   both selectors. The frame rate is limited by AcquisitionFrameRate if AcquisitionFrameRateEnable is set
+   when grabbing starts. Without IsFrameBurstStartAvailable in the settings the source behaves like a
+   camera lacking the burst trigger.
+
+   Jitter and frame drops can be injected. Dropped frames and frames lost because all buffers are held
+   by the application are reported via GetNumberOfSkippedImages() and leave a gap in GetBlockID().
+
+   With SyntheticPattern_Replay the source replays recorded frame containers or .raw files, see
+   FrameReplayReader.h, with their recorded time stamps and block IDs. ReplayTiming_Original keeps the
+   recorded frame intervals and loses frames like a camera when the application holds all buffers.
+   ReplayTiming_AsFastAsPossible delivers the next frame as soon as a buffer is free and loses none.
+
+   The settings Width and Height are the size of the sensor. The image AOI is set by the parameters
+   Width, Height, OffsetX and OffsetY, in steps of 2 to keep the Bayer pattern. Like on a camera, Width
+   and Height can only be written while not grabbing, the offsets can be moved while grabbing and apply
+   from the next exposure on. The frame period shrinks with the AOI height, as the readout of a CMOS
+   sensor takes time per row. The buffers are allocated for the full sensor and kept across grabs if no
+   grab result holds them, so a smaller AOI needs no new buffers, see GetBufferAllocationCount(). Replays
+   deliver the recorded frames, the AOI does not apply.
+*/
+
+#ifndef INCLUDED_SYNTHETICFRAMESOURCE_H_3318405
+#define INCLUDED_SYNTHETICFRAMESOURCE_H_3318405
+
+#include <pylon/PylonIncludes.h>
+#include <pylon/usb/BaslerUsbInstantCamera.h>
+#include "SampleImageCreator.h"
+#include "FrameReplayReader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Pylon
+{
+    class CSyntheticFrameSource;
+
+    // Frame content of a synthetic frame source.
+    enum ESyntheticPattern
+    {
+        SyntheticPattern_JuliaFractal,
+        SyntheticPattern_MandelbrotFractal,
+        SyntheticPattern_RawFile,
+        SyntheticPattern_Replay
+    };
+
+    // Timing of a replay.
+    enum EReplayTiming
+    {
+        ReplayTiming_Original,
+        ReplayTiming_AsFastAsPossible
+    };
+
+    // Settings of a synthetic frame source.
+    struct SSyntheticFrameSourceSettings
+    {
+        SSyntheticFrameSourceSettings()
+            : Width(2592)
+            , Height(1944)
+            , PixelType(PixelType_Mono12)
+            , FrameRate(14.0)
+            , JitterUs(0.0)
+            , DropProbability(0.0)
+            , Pattern(SyntheticPattern_JuliaFractal)
+            , CycleLength(8)
+            , Seed(1)
+            , ReplayTiming(ReplayTiming_Original)
+            , ReplayLoop(false)
+            , StartLatencyMs(0.0)
+            , StopLatencyMs(0.0)
+            , WriteLatencyUs(0.0)
+            , IsFrameBurstStartAvailable(true)
+        {
+        }
+
+        uint32_t Width;
+        uint32_t Height;
+        EPixelType PixelType;       // PixelType_Mono8, PixelType_Mono12 or PixelType_BayerGB12.
+        double FrameRate;           // Frame rate when free-running, maximum frame rate when triggered.
+        double JitterUs;            // Standard deviation of the frame start jitter in microseconds.
+        double DropProbability;     // Probability that a frame is lost between sensor and host.
+        ESyntheticPattern Pattern;
+        std::string RawFileName;    // Recorded frames used by SyntheticPattern_RawFile.
+        uint32_t CycleLength;       // Number of different frames the fractal patterns cycle through.
+        uint32_t Seed;              // Seed of the jitter and drop injection. Equal seeds give equal runs.
+        std::vector<std::string> ReplayFileNames;   // Recordings replayed by SyntheticPattern_Replay, in this order.
+        SRawFileFormat ReplayRawFormat;             // Format of replayed .raw files.
+        EReplayTiming ReplayTiming;
+        bool ReplayLoop;            // Restart the replay after the last frame instead of ending the grab.
+        double StartLatencyMs;      // Time StartGrabbing takes.
+        double StopLatencyMs;       // Time StopGrabbing takes when grabbing.
+        double WriteLatencyUs;      // Time a write of a camera parameter or a command takes.
+        bool IsFrameBurstStartAvailable;    // The source supports the FrameBurstStart trigger.
+    };
+
+
+    // Returns the number of bytes per pixel of the pixel types a synthetic frame source can deliver.
+    inline size_t SyntheticBytesPerPixel( EPixelType pixelType)
+    {
+        switch (pixelType)
+        {
+        case PixelType_Mono8: return 1;
+        case PixelType_Mono12: return 2;
+        case PixelType_BayerGB12: return 2;
+        default: break;
+        }
+        throw RUNTIME_EXCEPTION( "The synthetic frame source supports Mono8, Mono12 and BayerGB12 only.");
+    }
+
+    // Maps the camera pixel format parameter to the pixel type of the delivered buffers.
+    inline EPixelType SyntheticPixelType( Basler_UsbCameraParams::PixelFormatEnums pixelFormat)
+    {
+        switch (pixelFormat)
+        {
+        case Basler_UsbCameraParams::PixelFormat_Mono8: return PixelType_Mono8;
+        case Basler_UsbCameraParams::PixelFormat_Mono12: return PixelType_Mono12;
+        case Basler_UsbCameraParams::PixelFormat_BayerGB12: return PixelType_BayerGB12;
+        default: break;
+        }
+        throw RUNTIME_EXCEPTION( "The synthetic frame source supports Mono8, Mono12 and BayerGB12 only.");
+    }
+
+
+    // Maps a pixel type to the camera pixel format parameter.
+    inline Basler_UsbCameraParams::PixelFormatEnums SyntheticPixelFormat( EPixelType pixelType)
+    {
+        switch (pixelType)
+        {
+        case PixelType_Mono8: return Basler_UsbCameraParams::PixelFormat_Mono8;
+        case PixelType_Mono12: return Basler_UsbCameraParams::PixelFormat_Mono12;
+        case PixelType_BayerGB12: return Basler_UsbCameraParams::PixelFormat_BayerGB12;
+        default: break;
+        }
+        throw RUNTIME_EXCEPTION( "The synthetic frame source supports Mono8, Mono12 and BayerGB12 only.");
+    }
+
+
+    // A parameter of the synthetic frame source. Mimics the SetValue/GetValue interface of camera parameters.
+    template <typename T>
+    class CSyntheticParameter
+    {
+    public:
+        explicit CSyntheticParameter( T value = T())
+            : m_value( value)
+            , m_writeLatency( 0)
+        {
+        }
+
+        void SetValue( T value)
+        {
+            if (m_writeLatency.count() > 0)
+            {
+                std::this_thread::sleep_for( m_writeLatency);
+            }
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                m_value = value;
+            }
+            if (m_onChanged)
+            {
+                m_onChanged();
+            }
+        }
+
+        T GetValue() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_value;
+        }
+
+        CSyntheticParameter& operator=( T value)
+        {
+            SetValue( value);
+            return *this;
+        }
+
+        operator T() const
+        {
+            return GetValue();
+        }
+
+        // Makes every write take the given time, like a control transaction to a camera.
+        void SetWriteLatency( std::chrono::microseconds latency)
+        {
+            m_writeLatency = latency;
+        }
+
+        // Sets a function called after every write.
+        void SetOnChanged( const std::function<void()>& onChanged)
+        {
+            m_onChanged = onChanged;
+        }
+
+    private:
+        CSyntheticParameter( const CSyntheticParameter&);
+        CSyntheticParameter& operator=( const CSyntheticParameter&);
+
+        mutable std::mutex m_lock;
+        T m_value;
+        std::chrono::microseconds m_writeLatency;
+        std::function<void()> m_onChanged;
+    };
+
+
+    // An integer parameter with the range and increment of a camera parameter, such as Width or OffsetX.
+    // Writing a value out of range or while the parameter is locked, e.g. Width while grabbing, throws.
+    class CSyntheticIntegerParameter : public CSyntheticParameter<int64_t>
+    {
+    public:
+        CSyntheticIntegerParameter( int64_t value, int64_t minimum, int64_t increment)
+            : CSyntheticParameter<int64_t>( value)
+            , m_minimum( minimum)
+            , m_increment( increment)
+        {
+        }
+
+        void SetValue( int64_t value)
+        {
+            if (!IsWritable())
+            {
+                throw RUNTIME_EXCEPTION( "The parameter is not writable while the synthetic frame source is grabbing.");
+            }
+            if (value < GetMin() || value > GetMax() || (value - GetMin()) % m_increment != 0)
+            {
+                throw RUNTIME_EXCEPTION( "The value %lld is out of the range %lld..%lld with increment %lld.",
+                    static_cast<long long>(value), static_cast<long long>(GetMin()), static_cast<long long>(GetMax()), static_cast<long long>(m_increment));
+            }
+            CSyntheticParameter<int64_t>::SetValue( value);
+        }
+
+        CSyntheticIntegerParameter& operator=( int64_t value)
+        {
+            SetValue( value);
+            return *this;
+        }
+
+        int64_t GetMin() const
+        {
+            return m_minimum;
+        }
+
+        // The maximum may depend on other parameters, e.g. the maximum OffsetX on Width.
+        int64_t GetMax() const
+        {
+            return m_getMaximum ? m_getMaximum() : GetValue();
+        }
+
+        int64_t GetInc() const
+        {
+            return m_increment;
+        }
+
+        bool IsWritable() const
+        {
+            return !m_isLocked || !m_isLocked();
+        }
+
+        void SetMaximum( const std::function<int64_t()>& getMaximum)
+        {
+            m_getMaximum = getMaximum;
+        }
+
+        void SetLock( const std::function<bool()>& isLocked)
+        {
+            m_isLocked = isLocked;
+        }
+
+    private:
+        int64_t m_minimum;
+        int64_t m_increment;
+        std::function<int64_t()> m_getMaximum;
+        std::function<bool()> m_isLocked;
+    };
+
+    // Allows IsWritable( camera.OffsetX) to be written the same way for cameras and synthetic frame sources.
+    inline bool IsWritable( const CSyntheticIntegerParameter& parameter)
+    {
+        return parameter.IsWritable();
+    }
+
+
+    // A command of the synthetic frame source. Mimics the Execute interface of camera commands.
+    class CSyntheticCommand
+    {
+    public:
+        CSyntheticCommand()
+            : m_writeLatency( 0)
+        {
+        }
+
+        void Execute()
+        {
+            if (m_writeLatency.count() > 0)
+            {
+                std::this_thread::sleep_for( m_writeLatency);
+            }
+            if (m_action)
+            {
+                m_action();
+            }
+        }
+
+        void SetWriteLatency( std::chrono::microseconds latency)
+        {
+            m_writeLatency = latency;
+        }
+
+        void SetAction( const std::function<void()>& action)
+        {
+            m_action = action;
+        }
+
+    private:
+        CSyntheticCommand( const CSyntheticCommand&);
+        CSyntheticCommand& operator=( const CSyntheticCommand&);
+
+        std::chrono::microseconds m_writeLatency;
+        std::function<void()> m_action;
+    };
+
+
+    // Chunk value attached to a synthetic grab result.
+    template <typename T>
+    class CSyntheticChunkValueT
+    {
+    public:
+        CSyntheticChunkValueT()
+            : m_isReadable( false)
+            , m_value( 0)
+        {
+        }
+
+        void SetValue( T value)
+        {
+            m_value = value;
+            m_isReadable = true;
+        }
+
+        T GetValue() const
+        {
+            if (!m_isReadable)
+            {
+                throw RUNTIME_EXCEPTION( "The chunk is not available for this grab result.");
+            }
+            return m_value;
+        }
+
+        bool IsReadable() const
+        {
+            return m_isReadable;
+        }
+
+    private:
+        bool m_isReadable;
+        T m_value;
+    };
+
+    typedef CSyntheticChunkValueT<int64_t> CSyntheticChunkValue;
+    typedef CSyntheticChunkValueT<double> CSyntheticFloatChunkValue;
+
+    // Allows IsReadable( ptrGrabResult->ChunkTimestamp) to be written the same way for camera and synthetic grab results.
+    template <typename T>
+    inline bool IsReadable( const CSyntheticChunkValueT<T>& chunkValue)
+    {
+        return chunkValue.IsReadable();
+    }
+
+
+    // The buffers of a synthetic frame source. Shared with the grab results so that buffers can be returned
+    // after the source has been destroyed.
+    struct SSyntheticBufferPool
+    {
+        std::mutex Lock;
+        std::condition_variable Returned;
+        std::vector< std::vector<uint8_t> > Buffers;
+        std::vector<size_t> FreeBuffers;
+
+        // Sizes every buffer to imageSize. The buffers are reserved with capacity bytes, resizing them within the capacity
+        // does not reallocate. Returns the number of buffers allocated.
+        size_t Resize( size_t numBuffers, size_t imageSize, size_t capacity)
+        {
+            std::lock_guard<std::mutex> lock( Lock);
+            size_t allocationCount = 0;
+            Buffers.resize( numBuffers);
+            for (size_t i = 0; i < numBuffers; ++i)
+            {
+                if (Buffers[i].capacity() < imageSize)
+                {
+                    Buffers[i].reserve( std::max( imageSize, capacity));
+                    ++allocationCount;
+                }
+                Buffers[i].resize( imageSize);
+            }
+            FreeBuffers.clear();
+            for (size_t i = numBuffers; i > 0; --i)
+            {
+                FreeBuffers.push_back( i - 1);
+            }
+            return allocationCount;
+        }
+
+        bool Acquire( size_t& bufferIndex)
+        {
+            std::lock_guard<std::mutex> lock( Lock);
+            if (FreeBuffers.empty())
+            {
+                return false;
+            }
+            bufferIndex = FreeBuffers.back();
+            FreeBuffers.pop_back();
+            return true;
+        }
+
+        // Waits up to timeout for a buffer to be returned.
+        bool Acquire( size_t& bufferIndex, std::chrono::milliseconds timeout)
+        {
+            std::unique_lock<std::mutex> lock( Lock);
+            if (!Returned.wait_for( lock, timeout, [this]() { return !FreeBuffers.empty(); }))
+            {
+                return false;
+            }
+            bufferIndex = FreeBuffers.back();
+            FreeBuffers.pop_back();
+            return true;
+        }
+
+        void Return( size_t bufferIndex)
+        {
+            {
+                std::lock_guard<std::mutex> lock( Lock);
+                FreeBuffers.push_back( bufferIndex);
+            }
+            Returned.notify_one();
+        }
+    };
+
+
+    // The data of a grab result delivered by a synthetic frame source.
+    class CSyntheticGrabResultData
+    {
+    public:
+        CSyntheticGrabResultData( const std::shared_ptr<SSyntheticBufferPool>& pool, size_t bufferIndex)
+            : m_pool( pool)
+            , m_bufferIndex( bufferIndex)
+            , m_width( 0)
+            , m_height( 0)
+            , m_offsetX( 0)
+            , m_offsetY( 0)
+            , m_pixelType( PixelType_Mono8)
+            , m_imageSize( 0)
+            , m_cameraContext( 0)
+            , m_blockID( 0)
+            , m_timeStamp( 0)
+            , m_imageNumber( 0)
+            , m_skippedImages( 0)
+            , m_chunksEnabled( true)
+        {
+        }
+
+        ~CSyntheticGrabResultData()
+        {
+            m_pool->Return( m_bufferIndex);
+        }
+
+        bool GrabSucceeded() const { return true; }
+        uint32_t GetErrorCode() const { return 0; }
+        String_t GetErrorDescription() const { return String_t(); }
+        EPayloadType GetPayloadType() const { return m_chunksEnabled ? PayloadType_ChunkData : PayloadType_Image; }
+
+        void* GetBuffer() const { return &m_pool->Buffers[m_bufferIndex][0]; }
+        size_t GetImageSize() const { return m_imageSize; }
+        size_t GetPayloadSize() const { return m_imageSize; }
+        uint32_t GetWidth() const { return m_width; }
+        uint32_t GetHeight() const { return m_height; }
+        uint32_t GetOffsetX() const { return m_offsetX; }
+        uint32_t GetOffsetY() const { return m_offsetY; }
+        uint32_t GetPaddingX() const { return 0; }
+        EPixelType GetPixelType() const { return m_pixelType; }
+
+        intptr_t GetCameraContext() const { return m_cameraContext; }
+        uint64_t GetBlockID() const { return m_blockID; }
+        uint64_t GetTimeStamp() const { return m_timeStamp; }
+        int64_t GetImageNumber() const { return m_imageNumber; }
+        int64_t GetNumberOfSkippedImages() const { return m_skippedImages; }
+        // The frames are not transferred, they have no payload CRC.
+        bool HasCRC() const { return false; }
+        bool CheckCRC() const { return true; }
+
+        // Time stamp of the exposure start in nanoseconds, as delivered by the ChunkTimestamp of Basler USB cameras.
+        CSyntheticChunkValue ChunkTimestamp;
+        // Exposure time in us and gain in dB the frame was exposed with.
+        CSyntheticFloatChunkValue ChunkExposureTime;
+        CSyntheticFloatChunkValue ChunkGain;
+
+    private:
+        friend class CSyntheticFrameSource;
+
+        CSyntheticGrabResultData( const CSyntheticGrabResultData&);
+        CSyntheticGrabResultData& operator=( const CSyntheticGrabResultData&);
+
+        std::shared_ptr<SSyntheticBufferPool> m_pool;
+        size_t m_bufferIndex;
+        uint32_t m_width;
+        uint32_t m_height;
+        uint32_t m_offsetX;
+        uint32_t m_offsetY;
+        EPixelType m_pixelType;
+        size_t m_imageSize;
+        intptr_t m_cameraContext;
+        uint64_t m_blockID;
+        uint64_t m_timeStamp;
+        int64_t m_imageNumber;
+        int64_t m_skippedImages;
+        bool m_chunksEnabled;
+    };
+
+
+    // Smart pointer to the data of a synthetic grab result. The buffer is returned to the source when the last
+    // pointer referencing it is released.
+    class CSyntheticGrabResultPtr
+    {
+    public:
+        CSyntheticGrabResultPtr()
+        {
+        }
+
+        CSyntheticGrabResultData* operator->() const
+        {
+            return m_ptrData.get();
+        }
+
+        CSyntheticGrabResultData& operator*() const
+        {
+            return *m_ptrData;
+        }
+
+        bool IsValid() const
+        {
+            return m_ptrData != nullptr;
+        }
+
+        void Release()
+        {
+            m_ptrData.reset();
+        }
+
+    private:
+        friend class CSyntheticFrameSource;
+
+        std::shared_ptr<CSyntheticGrabResultData> m_ptrData;
+    };
+
+
+    // Image event handler for synthetic frame sources.
+    class CSyntheticImageEventHandler
+    {
+    public:
+        virtual ~CSyntheticImageEventHandler()
+        {
+        }
+
+        virtual void OnImagesSkipped( CSyntheticFrameSource& /*camera*/, size_t /*countOfSkippedImages*/)
+        {
+        }
+
+        virtual void OnImageGrabbed( CSyntheticFrameSource& /*camera*/, const CSyntheticGrabResultPtr& /*ptrGrabResult*/)
+        {
+        }
+    };
+
+
+    // A frame source that stands in for a camera.
+    class CSyntheticFrameSource
+    {
+    public:
+        typedef CSyntheticImageEventHandler ImageEventHandler_t;
+        typedef CSyntheticGrabResultPtr GrabResultPtr_t;
+        typedef std::chrono::steady_clock Clock_t;
+
+        explicit CSyntheticFrameSource( const SSyntheticFrameSourceSettings& settings = SSyntheticFrameSourceSettings())
+            : Gain( 0.0)
+            , GainAuto( Basler_UsbCameraParams::GainAuto_Off)
+            , ExposureTime( 10000.0)
+            , PixelFormat( SyntheticPixelFormat( settings.PixelType))
+            , Width( settings.Width, 16, 2)
+            , Height( settings.Height, 16, 2)
+            , OffsetX( 0, 0, 2)
+            , OffsetY( 0, 0, 2)
+            , TriggerMode( Basler_UsbCameraParams::TriggerMode_Off)
+            , TriggerSelector( Basler_UsbCameraParams::TriggerSelector_FrameStart)
+            , TriggerSource( Basler_UsbCameraParams::TriggerSource_Software)
+            , AcquisitionBurstFrameCount( 1)
+            , AcquisitionFrameRateEnable( false)
+            , AcquisitionFrameRate( settings.FrameRate)
+            , MaxNumBuffer( 10)
+            , ChunkModeActive( true)
+            , DeviceUserID( "")
+            , TimestampLatchValue( 0)
+            , m_settings( settings)
+            , m_cameraContext( 0)
+            , m_isOpen( false)
+            , m_patternPixelType( PixelType_Undefined)
+            , m_isGrabbing( false)
+            , m_stopRequested( false)
+            , m_isGrabLoopRequested( false)
+            , m_isSourceExhausted( false)
+            , m_maxImages( 0)
+            , m_producedImages( 0)
+            , m_retrievedImages( 0)
+            , m_skippedImages( 0)
+            , m_burstFramesLeft( 0)
+            , m_deviceStartTime( Clock_t::now())
+            , m_bufferAllocationCount( 0)
+        {
+            SyntheticBytesPerPixel( m_settings.PixelType);
+            DeviceUserID.SetValue( GetSerialNumber().c_str());
+
+            // A sensor waiting for a trigger resumes free-running when the trigger mode is switched off.
+            TriggerMode.SetOnChanged( [this]()
+            {
+                {
+                    std::lock_guard<std::mutex> lock( m_lock);
+                }
+                m_condition.notify_all();
+            });
+            TimestampLatch.SetAction( [this]()
+            {
+                TimestampLatchValue.SetValue( std::chrono::duration_cast<std::chrono::nanoseconds>(Clock_t::now() - m_deviceStartTime).count());
+            });
+
+            // The AOI must lie within the sensor. The size determines the payload and is fixed while grabbing.
+            Width.SetMaximum( [this]() { return static_cast<int64_t>(m_settings.Width) - OffsetX.GetValue(); });
+            Height.SetMaximum( [this]() { return static_cast<int64_t>(m_settings.Height) - OffsetY.GetValue(); });
+            OffsetX.SetMaximum( [this]() { return static_cast<int64_t>(m_settings.Width) - Width.GetValue(); });
+            OffsetY.SetMaximum( [this]() { return static_cast<int64_t>(m_settings.Height) - Height.GetValue(); });
+            Width.SetLock( [this]() { return IsGrabbing(); });
+            Height.SetLock( [this]() { return IsGrabbing(); });
+
+            const std::chrono::microseconds writeLatency( static_cast<int64_t>(m_settings.WriteLatencyUs));
+            Gain.SetWriteLatency( writeLatency);
+            GainAuto.SetWriteLatency( writeLatency);
+            ExposureTime.SetWriteLatency( writeLatency);
+            PixelFormat.SetWriteLatency( writeLatency);
+            Width.SetWriteLatency( writeLatency);
+            Height.SetWriteLatency( writeLatency);
+            OffsetX.SetWriteLatency( writeLatency);
+            OffsetY.SetWriteLatency( writeLatency);
+            TriggerMode.SetWriteLatency( writeLatency);
+            TriggerSelector.SetWriteLatency( writeLatency);
+            TriggerSource.SetWriteLatency( writeLatency);
+            AcquisitionBurstFrameCount.SetWriteLatency( writeLatency);
+            AcquisitionFrameRateEnable.SetWriteLatency( writeLatency);
+            AcquisitionFrameRate.SetWriteLatency( writeLatency);
+            ChunkModeActive.SetWriteLatency( writeLatency);
+            TimestampLatch.SetWriteLatency( writeLatency);
+        }
+
+        virtual ~CSyntheticFrameSource()
+        {
+            StopGrabbing();
+            JoinThreads();
+            for (std::vector<SHandlerRegistration>::iterator it = m_handlers.begin(); it != m_handlers.end(); ++it)
+            {
+                if (it->Cleanup == Cleanup_Delete)
+                {
+                    delete it->pHandler;
+                }
+            }
+        }
+
+        // Parameters. The names match the Basler USB camera parameters.
+        CSyntheticParameter<double> Gain;
+        CSyntheticParameter<Basler_UsbCameraParams::GainAutoEnums> GainAuto;
+        CSyntheticParameter<double> ExposureTime;
+        CSyntheticParameter<Basler_UsbCameraParams::PixelFormatEnums> PixelFormat;
+        CSyntheticIntegerParameter Width;       // The image AOI.
+        CSyntheticIntegerParameter Height;
+        CSyntheticIntegerParameter OffsetX;
+        CSyntheticIntegerParameter OffsetY;
+        CSyntheticParameter<Basler_UsbCameraParams::TriggerModeEnums> TriggerMode;
+        CSyntheticParameter<Basler_UsbCameraParams::TriggerSelectorEnums> TriggerSelector;
+        CSyntheticParameter<Basler_UsbCameraParams::TriggerSourceEnums> TriggerSource;  // Only software triggers are supported.
+        CSyntheticParameter<int64_t> AcquisitionBurstFrameCount;
+        CSyntheticParameter<bool> AcquisitionFrameRateEnable;
+        CSyntheticParameter<double> AcquisitionFrameRate;
+        CSyntheticParameter<int> MaxNumBuffer;
+        CSyntheticParameter<bool> ChunkModeActive;
+        CSyntheticParameter<String_t> DeviceUserID;
+        CSyntheticCommand TimestampLatch;
+        CSyntheticParameter<int64_t> TimestampLatchValue;     // In ns, the clock of the time stamps.
+
+        const SSyntheticFrameSourceSettings& GetSettings() const
+        {
+            return m_settings;
+        }
+
+        CDeviceInfo GetDeviceInfo() const
+        {
+            CDeviceInfo info;
+            // The model name follows the real cameras so that samples detect BW and color cameras the usual way.
+            info.SetModelName( m_settings.PixelType == PixelType_BayerGB12 ? "Synthetic acA2500-14uc" : "Synthetic acA2500-14um");
+            info.SetSerialNumber( GetSerialNumber().c_str());
+            info.SetUserDefinedName( GetSerialNumber().c_str());
+            info.SetDeviceClass( "Synthetic");
+            return info;
+        }
+
+        std::string GetSerialNumber() const
+        {
+            char serialNumber[32];
+            sprintf( serialNumber, "SYN%05u", static_cast<unsigned int>(m_cameraContext));
+            return serialNumber;
+        }
+
+        void SetCameraContext( intptr_t context)
+        {
+            m_cameraContext = context;
+            DeviceUserID.SetValue( GetSerialNumber().c_str());
+        }
+
+        intptr_t GetCameraContext() const
+        {
+            return m_cameraContext;
+        }
+
+        // The number of buffers allocated by StartGrabbing so far. Restarting with the same MaxNumBuffer allocates none.
+        size_t GetBufferAllocationCount() const
+        {
+            return m_bufferAllocationCount;
+        }
+
+        // Renders the frame pattern. Called implicitly by StartGrabbing.
+        void Open()
+        {
+            if (m_settings.Pattern == SyntheticPattern_Replay)
+            {
+                // The recording determines the image format.
+                if (!m_ptrReplayReader)
+                {
+                    OpenReplay();
+                }
+                m_isOpen = true;
+                return;
+            }
+
+            const EPixelType pixelType = SyntheticPixelType( PixelFormat.GetValue());
+            if (m_patternPixelType != pixelType)
+            {
+                m_settings.PixelType = pixelType;
+                CreatePatterns();
+                m_patternPixelType = pixelType;
+            }
+            m_isOpen = true;
+        }
+
+        void Close()
+        {
+            StopGrabbing();
+            m_isOpen = false;
+        }
+
+        bool IsOpen() const
+        {
+            return m_isOpen;
+        }
+
+        void RegisterImageEventHandler( CSyntheticImageEventHandler* pHandler, ERegistrationMode mode, ECleanup cleanup)
+        {
+            if (mode == RegistrationMode_ReplaceAll)
+            {
+                for (std::vector<SHandlerRegistration>::iterator it = m_handlers.begin(); it != m_handlers.end(); ++it)
+                {
+                    if (it->Cleanup == Cleanup_Delete)
+                    {
+                        delete it->pHandler;
+                    }
+                }
+                m_handlers.clear();
+            }
+            SHandlerRegistration registration = { pHandler, cleanup };
+            m_handlers.push_back( registration);
+        }
+
+        void StartGrabbing( EGrabStrategy strategy = GrabStrategy_OneByOne, EGrabLoop grabLoopType = GrabLoop_ProvidedByUser)
+        {
+            StartGrabbing( 0, strategy, grabLoopType);
+        }
+
+        // Starts grabbing. Grabbing stops automatically after maxImages results have been retrieved. 0 means no limit.
+        void StartGrabbing( size_t maxImages, EGrabStrategy /*strategy*/ = GrabStrategy_OneByOne, EGrabLoop grabLoopType = GrabLoop_ProvidedByUser)
+        {
+            if (IsGrabbing())
+            {
+                throw RUNTIME_EXCEPTION( "The synthetic frame source is already grabbing.");
+            }
+            JoinThreads();
+            Open();
+            if (m_settings.StartLatencyMs > 0.0)
+            {
+                std::this_thread::sleep_for( std::chrono::microseconds( static_cast<int64_t>(m_settings.StartLatencyMs * 1e3)));
+            }
+
+            // The buffers are kept unless grab results of the previous grab still hold them.
+            const size_t bytesPerPixel = SyntheticBytesPerPixel( m_settings.PixelType);
+            const size_t sensorSize = static_cast<size_t>(m_settings.Width) * m_settings.Height * bytesPerPixel;
+            const size_t imageSize = m_ptrReplayReader ? sensorSize : static_cast<size_t>(Width.GetValue() * Height.GetValue()) * bytesPerPixel;
+            const size_t numBuffers = static_cast<size_t>(std::max( 1, MaxNumBuffer.GetValue()));
+            if (!m_ptrPool || m_ptrPool.use_count() > 1)
+            {
+                m_ptrPool = std::make_shared<SSyntheticBufferPool>();
+            }
+            m_bufferAllocationCount += m_ptrPool->Resize( numBuffers, imageSize, sensorSize);
+
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                m_outputQueue.clear();
+                m_maxImages = maxImages;
+                m_producedImages = 0;
+                m_retrievedImages = 0;
+                m_skippedImages = 0;
+                m_pendingTriggers.clear();
+                m_burstFramesLeft = 0;
+                m_sensorIdleAt = Clock_t::now();
+                m_readoutEndAt = m_sensorIdleAt;
+                m_stopRequested = false;
+                m_isSourceExhausted = false;
+                m_isGrabbing = true;
+                m_isGrabLoopRequested = grabLoopType == GrabLoop_ProvidedByInstantCamera;
+            }
+
+            m_sensorThread = std::thread( &CSyntheticFrameSource::SensorLoop, this);
+            // Started from an image event handler, the running grab loop thread goes on with the new grab or ends.
+            if (grabLoopType == GrabLoop_ProvidedByInstantCamera && !IsGrabLoopThread())
+            {
+                m_grabLoopThread = std::thread( &CSyntheticFrameSource::GrabLoop, this);
+            }
+        }
+
+        void StopGrabbing()
+        {
+            if (m_settings.StopLatencyMs > 0.0 && m_sensorThread.joinable())
+            {
+                std::this_thread::sleep_for( std::chrono::microseconds( static_cast<int64_t>(m_settings.StopLatencyMs * 1e3)));
+            }
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                m_stopRequested = true;
+                m_isGrabbing = false;
+                m_outputQueue.clear();
+            }
+            m_condition.notify_all();
+
+            JoinThreads();
+        }
+
+        bool IsGrabbing() const
+        {
+            std::lock_guard<std::mutex> lock( m_lock);
+            return m_isGrabbing;
+        }
+
+        bool RetrieveResult( unsigned int timeoutMs, CSyntheticGrabResultPtr& grabResult, ETimeoutHandling timeoutHandling = TimeoutHandling_ThrowException)
+        {
+            grabResult.Release();
+            std::unique_lock<std::mutex> lock( m_lock);
+            const bool isAvailable = m_condition.wait_for( lock, std::chrono::milliseconds( timeoutMs),
+                [this]() { return !m_outputQueue.empty() || !m_isGrabbing; });
+
+            if (!isAvailable || m_outputQueue.empty())
+            {
+                lock.unlock();
+                if (timeoutHandling == TimeoutHandling_ThrowException)
+                {
+                    throw TIMEOUT_EXCEPTION( "Grab timed out. The synthetic frame source did not deliver a frame within %u ms.", timeoutMs);
+                }
+                return false;
+            }
+
+            grabResult = m_outputQueue.front();
+            m_outputQueue.pop_front();
+            if ((m_maxImages != 0 && ++m_retrievedImages >= m_maxImages) || (m_isSourceExhausted && m_outputQueue.empty()))
+            {
+                m_isGrabbing = false;
+                m_condition.notify_all();
+            }
+            return true;
+        }
+
+        bool WaitForFrameTriggerReady( unsigned int timeoutMs, ETimeoutHandling timeoutHandling = TimeoutHandling_ThrowException)
+        {
+            std::unique_lock<std::mutex> lock( m_lock);
+            const Clock_t::time_point deadline = Clock_t::now() + std::chrono::milliseconds( timeoutMs);
+            while (m_isGrabbing && (!m_pendingTriggers.empty() || m_burstFramesLeft != 0 || Clock_t::now() < m_sensorIdleAt))
+            {
+                const Clock_t::time_point wakeUp = !m_pendingTriggers.empty() || m_burstFramesLeft != 0 ? deadline : std::min( deadline, m_sensorIdleAt);
+                if (m_condition.wait_until( lock, wakeUp) == std::cv_status::timeout && Clock_t::now() >= deadline)
+                {
+                    break;
+                }
+            }
+
+            const bool isReady = m_isGrabbing && m_pendingTriggers.empty() && m_burstFramesLeft == 0 && Clock_t::now() >= m_sensorIdleAt;
+            lock.unlock();
+            if (!isReady && timeoutHandling == TimeoutHandling_ThrowException)
+            {
+                throw TIMEOUT_EXCEPTION( "The synthetic frame source was not ready for a frame trigger within %u ms.", timeoutMs);
+            }
+            return isReady;
+        }
+
+        // Like TriggerSoftware of a camera the trigger takes the time of a parameter write.
+        void ExecuteSoftwareTrigger()
+        {
+            if (m_settings.WriteLatencyUs > 0.0)
+            {
+                std::this_thread::sleep_for( std::chrono::microseconds( static_cast<int64_t>(m_settings.WriteLatencyUs)));
+            }
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                if (!m_isGrabbing)
+                {
+                    throw RUNTIME_EXCEPTION( "Software trigger executed while the synthetic frame source is not grabbing.");
+                }
+                // Like a camera the trigger starts the frames selected when it is executed, a later change of TriggerSelector does not shorten its burst.
+                SPendingTrigger trigger;
+                trigger.Time = Clock_t::now();
+                trigger.FrameCount = m_settings.IsFrameBurstStartAvailable && TriggerSelector.GetValue() == Basler_UsbCameraParams::TriggerSelector_FrameBurstStart
+                    ? static_cast<size_t>(std::max<int64_t>( 1, AcquisitionBurstFrameCount.GetValue())) : 1;
+                m_pendingTriggers.push_back( trigger);
+            }
+            m_condition.notify_all();
+        }
+
+    protected:
+        // Fills the pattern pool the frames are copied from.
+        void CreatePatterns()
+        {
+            const size_t imageSize = static_cast<size_t>(m_settings.Width) * m_settings.Height * SyntheticBytesPerPixel( m_settings.PixelType);
+            m_patterns.clear();
+
+            if (m_settings.Pattern == SyntheticPattern_RawFile)
+            {
+                LoadRawFile( imageSize);
+                return;
+            }
+
+            // Each frame of the cycle is rendered with its own animation phase by the pattern engine, which
+            // writes the camera pixel formats directly.
+            SampleImageCreator::SFractalSettings fractalSettings;
+            fractalSettings.Type = m_settings.Pattern == SyntheticPattern_MandelbrotFractal
+                ? SampleImageCreator::FractalType_Mandelbrot : SampleImageCreator::FractalType_Julia;
+            fractalSettings.PixelType = m_settings.PixelType;
+            fractalSettings.Width = m_settings.Width;
+            fractalSettings.Height = m_settings.Height;
+
+            const uint32_t cycleLength = std::max( 1u, m_settings.CycleLength);
+            m_patterns.assign( cycleLength, std::vector<uint8_t>( imageSize));
+            for (uint32_t i = 0; i < cycleLength; ++i)
+            {
+                fractalSettings.Phase = static_cast<double>(i) / cycleLength;
+                SampleImageCreator::RenderFractal( fractalSettings, &m_patterns[i][0], imageSize / m_settings.Height);
+            }
+        }
+
+        void LoadRawFile( size_t imageSize)
+        {
+            FILE* pFile = fopen( m_settings.RawFileName.c_str(), "rb");
+            if (!pFile)
+            {
+                throw RUNTIME_EXCEPTION( "Could not open the recorded file %s.", m_settings.RawFileName.c_str());
+            }
+
+            std::vector<uint8_t> frame( imageSize);
+            while (fread( &frame[0], 1, imageSize, pFile) == imageSize)
+            {
+                m_patterns.push_back( frame);
+            }
+            fclose( pFile);
+
+            if (m_patterns.empty())
+            {
+                throw RUNTIME_EXCEPTION( "The recorded file %s is smaller than one %ux%u frame.", m_settings.RawFileName.c_str(), m_settings.Width, m_settings.Height);
+            }
+        }
+
+        void OpenReplay()
+        {
+            std::unique_ptr<CFrameReplayReader> ptrReader( new CFrameReplayReader);
+            ptrReader->Open( m_settings.ReplayFileNames, m_settings.ReplayRawFormat);
+
+            // The buffers of the pool are sized by the first frame.
+            const SFrameContainerRecord& first = ptrReader->GetRecord( 0);
+            for (size_t i = 1; i < ptrReader->GetFrameCount(); ++i)
+            {
+                const SFrameContainerRecord& record = ptrReader->GetRecord( i);
+                if (record.Width != first.Width || record.Height != first.Height || record.PixelType != first.PixelType || record.PaddingX != 0)
+                {
+                    throw RUNTIME_EXCEPTION( "The replay requires all recorded frames to have the same unpadded format.");
+                }
+            }
+            m_settings.Width = first.Width;
+            m_settings.Height = first.Height;
+            m_settings.PixelType = static_cast<EPixelType>(first.PixelType);
+            PixelFormat.SetValue( SyntheticPixelFormat( m_settings.PixelType));
+            OffsetX.CSyntheticParameter<int64_t>::SetValue( 0);
+            OffsetY.CSyntheticParameter<int64_t>::SetValue( 0);
+            Width.CSyntheticParameter<int64_t>::SetValue( first.Width);
+            Height.CSyntheticParameter<int64_t>::SetValue( first.Height);
+            m_ptrReplayReader.reset( ptrReader.release());
+        }
+
+        // Returns the offset of a replayed frame from the start of the replay according to the recorded time stamps.
+        std::chrono::nanoseconds GetReplayOffset( uint64_t sensorFrame) const
+        {
+            const CFrameReplayReader& reader = *m_ptrReplayReader;
+            const size_t frameCount = reader.GetFrameCount();
+            const uint64_t firstTimeStamp = reader.GetRecord( 0).TimeStamp;
+            const uint64_t lastTimeStamp = reader.GetRecord( frameCount - 1).TimeStamp;
+            // A loop lasts the recorded span plus one mean frame interval.
+            const uint64_t loopDuration = frameCount > 1 ? (lastTimeStamp - firstTimeStamp) * frameCount / (frameCount - 1) : 0;
+            const uint64_t offset = (sensorFrame / frameCount) * loopDuration + (reader.GetRecord( sensorFrame % frameCount).TimeStamp - firstTimeStamp);
+            return std::chrono::nanoseconds( static_cast<int64_t>(offset));
+        }
+
+        // Ends the grab once the frames produced so far have been retrieved.
+        void SetSourceExhausted()
+        {
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                m_isSourceExhausted = true;
+                if (m_outputQueue.empty())
+                {
+                    m_isGrabbing = false;
+                }
+            }
+            m_condition.notify_all();
+        }
+
+        // Simulates the sensor and the transport. Runs until grabbing is stopped or all images have been produced.
+        void SensorLoop()
+        {
+            std::mt19937 random( m_settings.Seed + static_cast<uint32_t>(m_cameraContext));
+            std::normal_distribution<double> jitter( 0.0, m_settings.JitterUs > 0.0 ? m_settings.JitterUs : 1.0);
+            std::uniform_real_distribution<double> uniform( 0.0, 1.0);
+
+            const bool isReplay = m_ptrReplayReader != nullptr;
+            const bool isAsFastAsPossible = isReplay && m_settings.ReplayTiming == ReplayTiming_AsFastAsPossible;
+            // The readout time is proportional to the rows of the AOI.
+            const uint32_t width = isReplay ? m_settings.Width : static_cast<uint32_t>(Width.GetValue());
+            const uint32_t height = isReplay ? m_settings.Height : static_cast<uint32_t>(Height.GetValue());
+            const double sensorFrameRate = m_settings.FrameRate * m_settings.Height / height;
+            const double frameRate = AcquisitionFrameRateEnable.GetValue() && AcquisitionFrameRate.GetValue() > 0.0
+                ? std::min( sensorFrameRate, AcquisitionFrameRate.GetValue()) : sensorFrameRate;
+            const std::chrono::nanoseconds framePeriod( isAsFastAsPossible ? 0 : static_cast<int64_t>(1e9 / frameRate));
+            const Clock_t::time_point startTime = Clock_t::now();
+            const size_t prefetchCount = static_cast<size_t>(std::max( 1, MaxNumBuffer.GetValue()));
+            uint64_t sensorFrame = 0;
+            // Free-running restarts from here after triggered frames.
+            Clock_t::time_point freeRunStart = startTime;
+            uint64_t freeRunFrame = 0;
+            bool isFreeRunning = true;
+
+            if (isReplay)
+            {
+                m_ptrReplayReader->Prefetch( 0, prefetchCount);
+            }
+
+            for (;;)
+            {
+                if (isReplay && !m_settings.ReplayLoop && sensorFrame >= m_ptrReplayReader->GetFrameCount())
+                {
+                    SetSourceExhausted();
+                    return;
+                }
+
+                Clock_t::time_point exposureStart;
+                double exposureTime = 0.0;
+                double gain = 0.0;
+                uint32_t offsetX = 0;
+                uint32_t offsetY = 0;
+                bool isTriggered = false;
+                bool isBurstFrame = false;
+                {
+                    std::unique_lock<std::mutex> lock( m_lock);
+                    if (m_burstFramesLeft != 0)
+                    {
+                        // The frames of a burst follow each other at the frame rate, timed by the sensor and not by the host.
+                        exposureStart = m_sensorIdleAt;
+                        --m_burstFramesLeft;
+                        isBurstFrame = true;
+                        isFreeRunning = false;
+                    }
+                    else if (TriggerMode.GetValue() == Basler_UsbCameraParams::TriggerMode_On)
+                    {
+                        m_condition.wait( lock, [this]()
+                        {
+                            return m_stopRequested || !m_pendingTriggers.empty() || TriggerMode.GetValue() != Basler_UsbCameraParams::TriggerMode_On;
+                        });
+                        if (m_stopRequested)
+                        {
+                            return;
+                        }
+                        if (m_pendingTriggers.empty())
+                        {
+                            continue;
+                        }
+                        // The trigger starts the exposure, at the earliest when the sensor accepts it.
+                        exposureStart = std::max( m_pendingTriggers.front().Time, m_sensorIdleAt);
+                        m_burstFramesLeft = m_pendingTriggers.front().FrameCount - 1;
+                        m_pendingTriggers.pop_front();
+                        isTriggered = true;
+                        isFreeRunning = false;
+                    }
+                    else if (isAsFastAsPossible)
+                    {
+                        exposureStart = Clock_t::now();
+                    }
+                    else if (isReplay)
+                    {
+                        exposureStart = startTime + std::chrono::duration_cast<Clock_t::duration>(GetReplayOffset( sensorFrame));
+                    }
+                    else
+                    {
+                        if (!isFreeRunning)
+                        {
+                            freeRunStart = std::max( Clock_t::now(), m_sensorIdleAt);
+                            freeRunFrame = 0;
+                            isFreeRunning = true;
+                        }
+                        exposureStart = freeRunStart + framePeriod * static_cast<int64_t>(freeRunFrame++);
+                    }
+
+                    if (m_settings.JitterUs > 0.0)
+                    {
+                        exposureStart += std::chrono::duration_cast<Clock_t::duration>(std::chrono::duration<double, std::micro>( jitter( random)));
+                    }
+                    // The exposure settings apply from the start of the exposure on.
+                    exposureTime = ExposureTime.GetValue();
+                    gain = Gain.GetValue();
+                    if (!isReplay)
+                    {
+                        offsetX = static_cast<uint32_t>(OffsetX.GetValue());
+                        offsetY = static_cast<uint32_t>(OffsetY.GetValue());
+                    }
+                    if (isTriggered || isBurstFrame)
+                    {
+                        // The frame is read out after its exposure and the readout of the previous frame. The sensor
+                        // accepts the next trigger when the readout starts, so the next exposure overlaps it.
+                        const Clock_t::time_point exposureEnd = exposureStart
+                            + std::chrono::duration_cast<Clock_t::duration>(std::chrono::duration<double, std::micro>( exposureTime));
+                        const Clock_t::time_point readoutStart = std::max( exposureEnd, m_readoutEndAt);
+                        m_sensorIdleAt = readoutStart;
+                        m_readoutEndAt = readoutStart + framePeriod;
+                    }
+                    else
+                    {
+                        m_sensorIdleAt = exposureStart + framePeriod;
+                        m_readoutEndAt = m_sensorIdleAt;
+                    }
+                    m_condition.notify_all();
+
+                    // The frame is available after exposure and readout.
+                    if (m_condition.wait_until( lock, m_readoutEndAt, [this]() { return m_stopRequested; }))
+                    {
+                        return;
+                    }
+                }
+                m_condition.notify_all();
+
+                const uint64_t blockID = sensorFrame++;
+                size_t bufferIndex = 0;
+                bool isBufferAvailable = false;
+                if (isAsFastAsPossible)
+                {
+                    // A replay as fast as possible waits for the application instead of losing frames.
+                    while (!(isBufferAvailable = m_ptrPool->Acquire( bufferIndex, std::chrono::milliseconds( 10))))
+                    {
+                        std::lock_guard<std::mutex> lock( m_lock);
+                        if (m_stopRequested)
+                        {
+                            return;
+                        }
+                    }
+                }
+                else
+                {
+                    isBufferAvailable = m_ptrPool->Acquire( bufferIndex);
+                }
+                if (uniform( random) < m_settings.DropProbability || !isBufferAvailable)
+                {
+                    if (isBufferAvailable)
+                    {
+                        m_ptrPool->Return( bufferIndex);
+                    }
+                    std::lock_guard<std::mutex> lock( m_lock);
+                    ++m_skippedImages;
+                    continue;
+                }
+
+                std::shared_ptr<CSyntheticGrabResultData> ptrData = std::make_shared<CSyntheticGrabResultData>( m_ptrPool, bufferIndex);
+                ptrData->m_width = width;
+                ptrData->m_height = height;
+                ptrData->m_offsetX = offsetX;
+                ptrData->m_offsetY = offsetY;
+                ptrData->m_pixelType = m_settings.PixelType;
+                ptrData->m_cameraContext = m_cameraContext;
+                if (isReplay)
+                {
+                    // Replayed frames keep their recorded time stamps and block IDs.
+                    const size_t frameIndex = static_cast<size_t>(blockID % m_ptrReplayReader->GetFrameCount());
+                    const SFrameContainerRecord& record = m_ptrReplayReader->GetRecord( frameIndex);
+                    ptrData->m_imageSize = m_ptrReplayReader->GetImageSize( frameIndex);
+                    m_ptrReplayReader->ReadFrame( frameIndex, ptrData->GetBuffer(), ptrData->m_imageSize);
+                    m_ptrReplayReader->Prefetch( frameIndex + prefetchCount, 1);
+                    ptrData->m_blockID = record.BlockID;
+                    ptrData->m_timeStamp = record.TimeStamp;
+                }
+                else
+                {
+                    // The rows of the AOI are cut out of the full sensor frame.
+                    const std::vector<uint8_t>& pattern = m_patterns[blockID % m_patterns.size()];
+                    const size_t bytesPerPixel = SyntheticBytesPerPixel( m_settings.PixelType);
+                    const size_t sensorStride = static_cast<size_t>(m_settings.Width) * bytesPerPixel;
+                    const size_t stride = static_cast<size_t>(width) * bytesPerPixel;
+                    uint8_t* pBuffer = static_cast<uint8_t*>(ptrData->GetBuffer());
+                    if (stride == sensorStride)
+                    {
+                        memcpy( pBuffer, &pattern[offsetY * sensorStride], stride * height);
+                    }
+                    else
+                    {
+                        for (uint32_t y = 0; y < height; ++y)
+                        {
+                            memcpy( pBuffer + y * stride, &pattern[(offsetY + y) * sensorStride + offsetX * bytesPerPixel], stride);
+                        }
+                    }
+                    ptrData->m_imageSize = stride * height;
+                    ptrData->m_blockID = blockID;
+                    // Like the camera clock, the time stamp counts from the creation of the source, not from the grab start.
+                    ptrData->m_timeStamp = static_cast<uint64_t>(std::max<int64_t>( 0,
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(exposureStart - m_deviceStartTime).count()));
+                }
+                ptrData->m_chunksEnabled = ChunkModeActive.GetValue();
+                if (ptrData->m_chunksEnabled)
+                {
+                    ptrData->ChunkTimestamp.SetValue( static_cast<int64_t>(ptrData->m_timeStamp));
+                    ptrData->ChunkExposureTime.SetValue( exposureTime);
+                    ptrData->ChunkGain.SetValue( gain);
+                }
+
+                bool isLastImage = false;
+                {
+                    std::lock_guard<std::mutex> lock( m_lock);
+                    if (m_stopRequested)
+                    {
+                        return;
+                    }
+                    ptrData->m_imageNumber = static_cast<int64_t>(++m_producedImages);
+                    ptrData->m_skippedImages = m_skippedImages;
+                    m_skippedImages = 0;
+
+                    CSyntheticGrabResultPtr grabResult;
+                    grabResult.m_ptrData = ptrData;
+                    m_outputQueue.push_back( grabResult);
+                    isLastImage = m_maxImages != 0 && m_producedImages >= m_maxImages;
+                }
+                m_condition.notify_all();
+
+                if (isLastImage)
+                {
+                    return;
+                }
+                if (isReplay && m_settings.ReplayLoop && blockID % m_ptrReplayReader->GetFrameCount() == m_ptrReplayReader->GetFrameCount() - 1)
+                {
+                    m_ptrReplayReader->Prefetch( 0, prefetchCount);
+                }
+            }
+        }
+
+        // Calls the registered image event handlers, like the grab loop thread of the instant camera.
+        void GrabLoop()
+        {
+            CSyntheticGrabResultPtr grabResult;
+            for (;;)
+            {
+                {
+                    std::lock_guard<std::mutex> lock( m_lock);
+                    if (!m_isGrabbing || !m_isGrabLoopRequested)
+                    {
+                        break;
+                    }
+                }
+                if (!RetrieveResult( 100, grabResult, TimeoutHandling_Return))
+                {
+                    continue;
+                }
+
+                if (grabResult->GetNumberOfSkippedImages() != 0)
+                {
+                    for (std::vector<SHandlerRegistration>::iterator it = m_handlers.begin(); it != m_handlers.end(); ++it)
+                    {
+                        it->pHandler->OnImagesSkipped( *this, static_cast<size_t>(grabResult->GetNumberOfSkippedImages()));
+                    }
+                }
+                for (std::vector<SHandlerRegistration>::iterator it = m_handlers.begin(); it != m_handlers.end(); ++it)
+                {
+                    it->pHandler->OnImageGrabbed( *this, grabResult);
+                }
+                grabResult.Release();
+            }
+        }
+
+        bool IsGrabLoopThread() const
+        {
+            return m_grabLoopThread.joinable() && m_grabLoopThread.get_id() == std::this_thread::get_id();
+        }
+
+        // Joins the threads of the last grab. Called from an image event handler, i.e. from the grab loop thread itself,
+        // the grab loop thread is left running, it ends when it returns from the handler unless a new grab needs it,
+        // and is joined by the next call from another thread. The source must not be destroyed by its own handlers.
+        void JoinThreads()
+        {
+            if (m_grabLoopThread.joinable() && !IsGrabLoopThread())
+            {
+                m_grabLoopThread.join();
+            }
+            if (m_sensorThread.joinable())
+            {
+                m_sensorThread.join();
+            }
+        }
+
+        struct SHandlerRegistration
+        {
+            CSyntheticImageEventHandler* pHandler;
+            ECleanup Cleanup;
+        };
+
+        // A trigger not yet accepted and the number of frames it starts.
+        struct SPendingTrigger
+        {
+            Clock_t::time_point Time;
+            size_t FrameCount;
+        };
+
+        SSyntheticFrameSourceSettings m_settings;
+        intptr_t m_cameraContext;
+        bool m_isOpen;
+        EPixelType m_patternPixelType;
+        std::vector< std::vector<uint8_t> > m_patterns;
+        std::unique_ptr<CFrameReplayReader> m_ptrReplayReader;
+        std::vector<SHandlerRegistration> m_handlers;
+        std::shared_ptr<SSyntheticBufferPool> m_ptrPool;
+
+        mutable std::mutex m_lock;
+        std::condition_variable m_condition;
+        std::deque<CSyntheticGrabResultPtr> m_outputQueue;
+        bool m_isGrabbing;
+        bool m_stopRequested;
+        bool m_isGrabLoopRequested;     // The grab loop thread calls the handlers while grabbing.
+        bool m_isSourceExhausted;       // The replay has delivered its last frame.
+        size_t m_maxImages;
+        size_t m_producedImages;
+        size_t m_retrievedImages;
+        int64_t m_skippedImages;
+        std::deque<SPendingTrigger> m_pendingTriggers;     // The triggers not yet accepted.
+        size_t m_burstFramesLeft;       // Frames of the current burst not yet started.
+        Clock_t::time_point m_sensorIdleAt;                     // When the sensor accepts the next trigger.
+        Clock_t::time_point m_readoutEndAt;
+        Clock_t::time_point m_deviceStartTime;
+        size_t m_bufferAllocationCount;
+
+        std::thread m_sensorThread;
+        std::thread m_grabLoopThread;
+
+    private:
+        CSyntheticFrameSource( const CSyntheticFrameSource&);
+        CSyntheticFrameSource& operator=( const CSyntheticFrameSource&);
+    };
+
+
+    // An array of synthetic frame sources. Mimics the camera arrays: the camera context is set to the index.
+    class CSyntheticFrameSourceArray
+    {
+    public:
+        explicit CSyntheticFrameSourceArray( size_t numberOfSources, const SSyntheticFrameSourceSettings& settings = SSyntheticFrameSourceSettings())
+        {
+            for (size_t i = 0; i < numberOfSources; ++i)
+            {
+                m_sources.push_back( std::unique_ptr<CSyntheticFrameSource>( new CSyntheticFrameSource( settings)));
+                m_sources.back()->SetCameraContext( static_cast<intptr_t>(i));
+            }
+        }
+
+        CSyntheticFrameSource& operator[]( size_t index)
+        {
+            return *m_sources.at( index);
+        }
+
+        size_t GetSize() const
+        {
+            return m_sources.size();
+        }
+
+        void StopGrabbing()
+        {
+            for (size_t i = 0; i < m_sources.size(); ++i)
+            {
+                m_sources[i]->StopGrabbing();
+            }
+        }
+
+    private:
+        std::vector< std::unique_ptr<CSyntheticFrameSource> > m_sources;
+    };
+
+
+    // Counterparts of the standard configurations for synthetic frame sources.
+    inline void ConfigureSoftwareTrigger( CSyntheticFrameSource& camera)
+    {
+        camera.TriggerMode.SetValue( Basler_UsbCameraParams::TriggerMode_On);
+    }
+
+    inline void ConfigureContinuousAcquisition( CSyntheticFrameSource& camera)
+    {
+        camera.TriggerMode.SetValue( Basler_UsbCameraParams::TriggerMode_Off);
+    }
+
+    inline bool IsFrameBurstStartAvailable( CSyntheticFrameSource& camera)
+    {
+        return camera.GetSettings().IsFrameBurstStartAvailable;
+    }
+
+    // A burst trigger is accepted when the previous burst has been read out.
+    inline bool WaitForBurstTriggerReady( CSyntheticFrameSource& camera, unsigned int timeoutMs)
+    {
+        return camera.WaitForFrameTriggerReady( timeoutMs, TimeoutHandling_Return);
+    }
+
+#ifdef PYLON_WIN_BUILD
+    inline void DisplayImage( size_t winIndex, const CSyntheticGrabResultPtr& ptrGrabResult)
+    {
+        CPylonImage image;
+        image.AttachUserBuffer( ptrGrabResult->GetBuffer(), ptrGrabResult->GetImageSize(), ptrGrabResult->GetPixelType(),
+            ptrGrabResult->GetWidth(), ptrGrabResult->GetHeight(), ptrGrabResult->GetPaddingX());
+        DisplayImage( winIndex, image);
+    }
+#endif
+}
+
+#endif /* INCLUDED_SYNTHETICFRAMESOURCE_H_3318405 */
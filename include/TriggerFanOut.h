@@ -0,0 +1,340 @@
+// Contains the coordinator firing the software triggers of several cameras at once and the measurement of their skew.
+/*
+   Triggering the cameras of an array one after the other starts their exposures apart by the time a
+   trigger takes, the write of TriggerSoftware, hundreds of microseconds over USB, times the number of
+   cameras. CTriggerFanOut fires the triggers of all cameras from its own threads, one per camera,
+   started once and pinned to a core each:
+
+       CTriggerFanOut<CameraArray_t> fanOut( cameras);
+       fanOut.Fire();      // waits until all cameras are ready, then triggers them
+
+   Fire() first waits until every camera is ready for a frame trigger, so no trigger of a set is lost
+   because one camera is still exposing or reading out. The threads then wait spinning at a barrier,
+   which releases all of them with one store, and each executes the trigger of its camera. The host
+   times the triggers were fired give the skew of the firing; the skew of the exposures is measured from
+   the Timestamp chunks.
+
+   The camera clocks are not synchronized. GetCameraClockOffset() latches the clock of a camera with
+   TimestampLatch between two host times and keeps the latch with the shortest round trip; the
+   uncertainty of the offset is half of that round trip. GetTriggerSkewNs() maps the Timestamp chunks
+   of a trigger set to the host clock with the offsets and returns their spread. An error of the
+   offsets shared by all cameras, e.g. the time of the latch command, does not change the spread.
+
+   With more cameras than cores the threads of a core share it and yield while they wait at the
+   barrier, the skew then depends on the scheduler.
+*/
+
+#ifndef INCLUDED_TRIGGERFANOUT_H_6402817
+#define INCLUDED_TRIGGERFANOUT_H_6402817
+
+#include <pylon/PylonIncludes.h>
+#include "FrameTimeSeries.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#elif defined(__linux__)
+#    include <pthread.h>
+#    include <sched.h>
+#endif
+
+namespace Pylon
+{
+    struct STriggerFanOutSettings
+    {
+        STriggerFanOutSettings()
+            : ReadyTimeoutMs( 300)
+            , PinThreads( true)
+            , FirstCore( 1)
+        {
+        }
+
+        unsigned int ReadyTimeoutMs;    // Time Fire() waits for the cameras to be ready for a trigger.
+        bool PinThreads;
+        unsigned int FirstCore;         // The thread of camera i runs on core (FirstCore + i) modulo the number of cores.
+    };
+
+    // Pins the calling thread to the core. Returns false if the platform or the core does not allow it.
+    inline bool PinCurrentThread( unsigned int core)
+    {
+#if defined(_WIN32)
+        return core < 64 && SetThreadAffinityMask( GetCurrentThread(), static_cast<DWORD_PTR>(1) << core) != 0;
+#elif defined(__linux__)
+        cpu_set_t cores;
+        CPU_ZERO( &cores);
+        CPU_SET( core, &cores);
+        return pthread_setaffinity_np( pthread_self(), sizeof( cores), &cores) == 0;
+#else
+        return false;
+#endif
+    }
+
+    template <typename CameraArrayT>
+    class CTriggerFanOut
+    {
+    public:
+        // Starts the threads, the cameras are only accessed by Fire().
+        explicit CTriggerFanOut( CameraArrayT& cameras, const STriggerFanOutSettings& settings = STriggerFanOutSettings())
+            : m_cameras( cameras)
+            , m_settings( settings)
+            , m_fireTimes( cameras.GetSize(), 0)
+            , m_errors( cameras.GetSize())
+            , m_generation( 0)
+            , m_isStopping( false)
+            , m_arrivedCount( 0)
+            , m_release( 0)
+            , m_doneCount( 0)
+        {
+            const unsigned int coreCount = std::max( 1u, std::thread::hardware_concurrency());
+            m_isSharingCores = m_cameras.GetSize() + 1 > coreCount;
+            for (size_t i = 0; i < m_cameras.GetSize(); ++i)
+            {
+                m_threads.push_back( std::thread( &CTriggerFanOut::Run, this, i, static_cast<unsigned int>((m_settings.FirstCore + i) % coreCount)));
+            }
+        }
+
+        ~CTriggerFanOut()
+        {
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                m_isStopping = true;
+            }
+            m_armed.notify_all();
+            for (size_t i = 0; i < m_threads.size(); ++i)
+            {
+                m_threads[i].join();
+            }
+        }
+
+        // Triggers all cameras at once when all are ready. Returns false, triggering none, if a camera is not ready in time.
+        bool Fire()
+        {
+            for (size_t i = 0; i < m_cameras.GetSize(); ++i)
+            {
+                if (!m_cameras[i].WaitForFrameTriggerReady( m_settings.ReadyTimeoutMs, TimeoutHandling_Return))
+                {
+                    return false;
+                }
+            }
+
+            // Arms the threads, then releases them when all wait at the barrier.
+            uint32_t generation = 0;
+            {
+                std::lock_guard<std::mutex> lock( m_lock);
+                generation = ++m_generation;
+                m_doneCount = 0;
+                m_arrivedCount = 0;
+            }
+            m_armed.notify_all();
+            while (m_arrivedCount.load() != m_cameras.GetSize())
+            {
+                std::this_thread::yield();
+            }
+            m_release.store( generation);
+
+            std::unique_lock<std::mutex> lock( m_lock);
+            while (m_doneCount != m_cameras.GetSize())
+            {
+                m_done.wait( lock);
+            }
+            for (size_t i = 0; i < m_errors.size(); ++i)
+            {
+                if (!m_errors[i].empty())
+                {
+                    const std::string error = m_errors[i];
+                    m_errors[i].clear();
+                    throw RUNTIME_EXCEPTION( "The trigger of camera %u failed: %s", static_cast<unsigned int>(i), error.c_str());
+                }
+            }
+            return true;
+        }
+
+        // GetHostTimeNs() when the triggers of the last set were fired.
+        const std::vector<int64_t>& GetFireTimes() const
+        {
+            return m_fireTimes;
+        }
+
+        // The spread of the fire times of the last set.
+        int64_t GetFireSkewNs() const
+        {
+            return *std::max_element( m_fireTimes.begin(), m_fireTimes.end()) - *std::min_element( m_fireTimes.begin(), m_fireTimes.end());
+        }
+
+    private:
+        CTriggerFanOut( const CTriggerFanOut&);
+        CTriggerFanOut& operator=( const CTriggerFanOut&);
+
+        void Run( size_t camera, unsigned int core)
+        {
+            if (m_settings.PinThreads)
+            {
+                PinCurrentThread( core);
+            }
+            uint32_t generation = 0;
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock( m_lock);
+                    while (m_generation == generation && !m_isStopping)
+                    {
+                        m_armed.wait( lock);
+                    }
+                    if (m_isStopping)
+                    {
+                        return;
+                    }
+                    generation = m_generation;
+                }
+
+                ++m_arrivedCount;
+                while (m_release.load() != generation)
+                {
+                    if (m_isSharingCores)
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+                m_fireTimes[camera] = GetHostTimeNs();
+                try
+                {
+                    m_cameras[camera].ExecuteSoftwareTrigger();
+                }
+                catch (const GenICam::GenericException& e)
+                {
+                    m_errors[camera] = e.GetDescription();
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock( m_lock);
+                    ++m_doneCount;
+                }
+                m_done.notify_one();
+            }
+        }
+
+        CameraArrayT& m_cameras;
+        STriggerFanOutSettings m_settings;
+        std::vector<std::thread> m_threads;
+        std::vector<int64_t> m_fireTimes;
+        std::vector<std::string> m_errors;
+        bool m_isSharingCores;
+
+        std::mutex m_lock;
+        std::condition_variable m_armed;
+        std::condition_variable m_done;
+        uint32_t m_generation;
+        bool m_isStopping;
+        std::atomic<size_t> m_arrivedCount;
+        std::atomic<uint32_t> m_release;
+        size_t m_doneCount;
+    };
+
+    // Triggers the cameras one after the other, each when it is ready, like the samples did. Returns false if a camera is not ready in time.
+    template <typename CameraArrayT>
+    bool FireSequentially( CameraArrayT& cameras, unsigned int readyTimeoutMs, std::vector<int64_t>* pFireTimes = NULL)
+    {
+        for (size_t i = 0; i < cameras.GetSize(); ++i)
+        {
+            if (!cameras[i].WaitForFrameTriggerReady( readyTimeoutMs, TimeoutHandling_Return))
+            {
+                return false;
+            }
+            if (pFireTimes != NULL)
+            {
+                pFireTimes->resize( cameras.GetSize());
+                (*pFireTimes)[i] = GetHostTimeNs();
+            }
+            cameras[i].ExecuteSoftwareTrigger();
+        }
+        return true;
+    }
+
+    // The offset of a camera clock to GetHostTimeNs(), camera time = host time + OffsetNs.
+    struct SCameraClockOffset
+    {
+        SCameraClockOffset()
+            : OffsetNs( 0)
+            , UncertaintyNs( 0)
+        {
+        }
+
+        int64_t OffsetNs;
+        int64_t UncertaintyNs;
+    };
+
+    // Latches the camera clock latchCount times and keeps the latch with the shortest round trip.
+    template <typename CameraT>
+    SCameraClockOffset GetCameraClockOffset( CameraT& camera, int latchCount = 8)
+    {
+        SCameraClockOffset offset;
+        int64_t shortestRoundTrip = std::numeric_limits<int64_t>::max();
+        for (int i = 0; i < latchCount; ++i)
+        {
+            const int64_t before = GetHostTimeNs();
+            camera.TimestampLatch.Execute();
+            const int64_t after = GetHostTimeNs();
+            const int64_t cameraTime = camera.TimestampLatchValue.GetValue();
+            if (after - before < shortestRoundTrip)
+            {
+                shortestRoundTrip = after - before;
+                offset.OffsetNs = cameraTime - (before + (after - before) / 2);
+                offset.UncertaintyNs = (after - before + 1) / 2;
+            }
+        }
+        return offset;
+    }
+
+    // The spread of the Timestamp chunks of a trigger set on the host clock in ns, cameraTimes[i] from camera i.
+    inline int64_t GetTriggerSkewNs( const std::vector<int64_t>& cameraTimes, const std::vector<SCameraClockOffset>& offsets)
+    {
+        int64_t first = std::numeric_limits<int64_t>::max();
+        int64_t last = std::numeric_limits<int64_t>::min();
+        for (size_t i = 0; i < cameraTimes.size(); ++i)
+        {
+            const int64_t hostTime = cameraTimes[i] - offsets[i].OffsetNs;
+            first = std::min( first, hostTime);
+            last = std::max( last, hostTime);
+        }
+        return cameraTimes.empty() ? 0 : last - first;
+    }
+
+    // The skew of every trigger set of a run, frame f of all cameras being set f. Sets missing a camera time are left out.
+    inline std::vector<int64_t> GetTriggerSkewsNs( const CFrameTimeSeries& times, const std::vector<SCameraClockOffset>& offsets)
+    {
+        size_t frameCount = std::numeric_limits<size_t>::max();
+        for (size_t i = 0; i < times.GetCameraCount(); ++i)
+        {
+            frameCount = std::min( frameCount, times.GetCameraTimes( i).GetSize());
+        }
+        std::vector<int64_t> skews;
+        std::vector<int64_t> cameraTimes( times.GetCameraCount());
+        for (size_t f = 0; f < frameCount && !cameraTimes.empty(); ++f)
+        {
+            bool isComplete = true;
+            for (size_t i = 0; i < cameraTimes.size(); ++i)
+            {
+                cameraTimes[i] = times.GetCameraTimes( i)[f];
+                isComplete = isComplete && cameraTimes[i] != 0;
+            }
+            if (isComplete)
+            {
+                skews.push_back( GetTriggerSkewNs( cameraTimes, offsets));
+            }
+        }
+        return skews;
+    }
+}
+
+#endif /* INCLUDED_TRIGGERFANOUT_H_6402817 */